@@ -52,10 +52,10 @@ cbuffer cbPerObject : register(b0)
     float4x4 gWorld;
     float4x4 gInvTransposeWorld;
     float4x4 gTexTransform;
+    float3 gPosDequantScale;
     uint gMaterialIndex;
+    float3 gPosDequantBias;
     uint gObjPad;
-    uint gObjPad1;
-    uint gObjPad2;
 };
 
 struct InstanceData
@@ -64,6 +64,11 @@ struct InstanceData
     Light gLight;
 };
 
+cbuffer cbPerDraw : register(b2)
+{
+    uint gCascadeMask; // bit i is set if the drawn item overlaps cascade i
+};
+
 cbuffer cbPerPass : register(b1)
 {
     float4x4 gView;
@@ -90,11 +95,21 @@ cbuffer cbPerPass : register(b1)
     uint NumPointLights = 0u;
     
     Light gDirLight;
+    
+    // Clustered lighting, see LightClusters
+    uint gClusterTilesX;
+    uint gClusterTilesY;
+    uint gClusterSlicesZ;
+    float gClusterDepthSliceScale;
+    float gClusterDepthSliceBias;
 };
 
 StructuredBuffer<MaterialData> gMaterialData : register(t0);
 StructuredBuffer<InstanceData/*Light*/> gPointLights : register(t1);
 StructuredBuffer<InstanceData/*Light*/> gSpotLights : register(t2);
+// Per cluster (offset, count) into gClusterLightIndices, which holds indices into gPointLights
+StructuredBuffer<uint2> gClusterLightRanges : register(t3);
+StructuredBuffer<uint> gClusterLightIndices : register(t4);
 
 Texture2DArray gShadowMaps : register(t0, space1);
 Texture2D gGBuffer[GBufferSize] : register(t1, space1); // t1, t2, t3, t4, t5, t6 in space1
@@ -127,15 +142,16 @@ float3 ComputeWorldPos(float3 texcoord)
     return worldPos.xyz;
 }
 
-float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float3 tangentW)
+// tangentW.w is the bitangent sign
+float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float4 tangentW)
 {
 	// Uncompress each component from [0,1] to [-1,1].
     float3 normalT = 2.0f * normalMapSample - 1.0f;
 
 	// Build orthonormal basis.
     float3 N = unitNormalW;
-    float3 T = normalize(tangentW - dot(tangentW, N) * N);
-    float3 B = cross(N, T);
+    float3 T = normalize(tangentW.xyz - dot(tangentW.xyz, N) * N);
+    float3 B = cross(N, T) * tangentW.w;
 
     float3x3 TBN = float3x3(T, B, N);
 
@@ -143,4 +159,50 @@ float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, floa
     float3 bumpedNormalW = mul(normalT, TBN);
 
     return bumpedNormalW;
+}
+
+// Packed vertices (VertexPositionNormalTangentUVPacked), must match VertexCompression on CPU side.
+float3 DequantizePosition(float3 posQ)
+{
+    return posQ * gPosDequantScale + gPosDequantBias;
+}
+
+float2 OctahedralEncode(float3 n)
+{
+    // Project onto the octahedron |x| + |y| + |z| = 1
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    // Lower hemisphere is folded over the diagonals onto the outer triangles of the square
+    float2 folded = (1.0f - abs(n.yx)) * ((n.xy >= 0.0f) ? 1.0f : -1.0f);
+    return (n.z >= 0.0f) ? n.xy : folded;
+}
+
+float3 OctahedralDecode(float2 e)
+{
+    float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    // Lower hemisphere is folded over the diagonals
+    float t = saturate(-n.z);
+    n.xy += (n.xy >= 0.0f) ? -t : t;
+    return normalize(n);
+}
+
+float BitangentSign(float posW)
+{
+    return posW * 2.0f - 1.0f;
+}
+
+// GBuffer NORMAL layer (R10G10B10A2_UNORM): octahedral normal in rg, shininess in b, a is unused.
+// Must match GBufferPacking on CPU side.
+float4 PackGBufferNormal(float3 normal, float shininess)
+{
+    return float4(OctahedralEncode(normal) * 0.5f + 0.5f, shininess, 0.0f);
+}
+
+float3 UnpackGBufferNormal(float4 normalTex)
+{
+    return OctahedralDecode(normalTex.xy * 2.0f - 1.0f);
+}
+
+float UnpackGBufferShininess(float4 normalTex)
+{
+    return normalTex.z;
 }
\ No newline at end of file
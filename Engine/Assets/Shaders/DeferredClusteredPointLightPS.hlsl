@@ -0,0 +1,46 @@
+#include "Common.hlsl"
+
+struct PSInput
+{
+    float4 iPosH : SV_POSITION;
+    float2 iTexC : TEXCOORD0;
+};
+
+// Must match LightClusters on CPU side.
+uint GetClusterIndex(float2 screenPos, float viewDepth)
+{
+    uint2 tile = min(uint2(screenPos * gInvRTSize * float2(gClusterTilesX, gClusterTilesY)), uint2(gClusterTilesX, gClusterTilesY) - 1u);
+    uint slice = (uint)clamp(floor(log(viewDepth) * gClusterDepthSliceScale + gClusterDepthSliceBias), 0.0f, (float)(gClusterSlicesZ - 1u));
+    return (slice * gClusterTilesY + tile.y) * gClusterTilesX + tile.x;
+}
+
+float4 main(PSInput input) : SV_TARGET
+{
+    float2 texCoord = input.iPosH.xy;
+
+    float4 diffuseAlbedo = gGBuffer[G_DIFF_ALBEDO].Load(input.iPosH.xyz);
+    float4 normalTex = gGBuffer[G_NORMAL].Load(input.iPosH.xyz);
+    float4 specularTex = gGBuffer[G_SPECULAR].Load(input.iPosH.xyz);
+    float3 posW = ComputeWorldPos(float3(texCoord, 0.0f));
+
+    float3 fresnelR0 = specularTex.xyz;
+    float3 normalW = UnpackGBufferNormal(normalTex);
+    const float shininess = UnpackGBufferShininess(normalTex);
+
+    Material mat = { diffuseAlbedo, fresnelR0, shininess };
+
+    float3 toEye = gEyePos - posW;
+    float3 viewDir = toEye / length(toEye);
+
+    float viewDepth = mul(float4(posW, 1.0f), gView).z;
+    uint2 range = gClusterLightRanges[GetClusterIndex(texCoord, viewDepth)];
+
+    float3 pointLight = 0.0f.rrr;
+    for (uint i = 0; i < range.y; ++i)
+    {
+        InstanceData instData = gPointLights[gClusterLightIndices[range.x + i]];
+        pointLight += CalcPointLight(instData.gLight, normalW, posW, viewDir, mat);
+    }
+
+    return float4(pointLight, 1.0f);
+}
@@ -67,7 +67,8 @@ float4 main(PSInput input) : SV_TARGET
     float3 posW = ComputeWorldPos(float3(texCoord, 0.0f));
     
     float3 fresnelR0 = specularTex.xyz;
-    const float shininess = exp2(specularTex.a * 10.5f) * normalTex.a;
+    float3 normalW = UnpackGBufferNormal(normalTex);
+    const float shininess = UnpackGBufferShininess(normalTex);
     
     Material mat = { diffuseAlbedo, fresnelR0, shininess };
     
@@ -109,7 +110,7 @@ float4 main(PSInput input) : SV_TARGET
 #endif
     
     float shadowFactor = GetShadowFactor(posW, layer);
-    float3 dirLight = CalcDirLight(gDirLight, normalTex.xyz, viewDir, mat, shadowFactor);
+    float3 dirLight = CalcDirLight(gDirLight, normalW, viewDir, mat, shadowFactor);
     litColor += float4(dirLight, 0.0f);
     
     // linear fog
@@ -118,7 +119,7 @@ float4 main(PSInput input) : SV_TARGET
     litColor = (1-fogAmount) * litColor + fogAmount * gFogColor;
 #endif
     
-    litColor.rgb += ComputeSpecularReflections(toEye, normalTex.xyz, mat);
+    litColor.rgb += ComputeSpecularReflections(toEye, normalW, mat);
     
     // set the alpha channel of the diffuse material of the object itself
     litColor.a = diffuseAlbedo.a;
@@ -21,14 +21,15 @@ float4 main(PSInput input) : SV_TARGET
     float3 posW = ComputeWorldPos(float3(texCoord, 0.0f));
     
     float3 fresnelR0 = specularTex.xyz;
-    const float shininess = exp2(specularTex.a * 10.5f) * normalTex.a;
+    float3 normalW = UnpackGBufferNormal(normalTex);
+    const float shininess = UnpackGBufferShininess(normalTex);
     
     Material mat = { diffuseAlbedo, fresnelR0, shininess };
     
     float3 toEye = gEyePos - posW;
     float3 viewDir = toEye / length(toEye);
     
-    float3 pointLight = CalcPointLight(instData.gLight, normalTex.xyz, posW, viewDir, mat);
+    float3 pointLight = CalcPointLight(instData.gLight, normalW, posW, viewDir, mat);
     // Does not work properly
     //pointLight += ComputeSpecularReflections(toEye, N, mat);
     
@@ -3,10 +3,31 @@
 struct PSInput
 {
     float4 iPosH : SV_POSITION;
+    
+    nointerpolation uint iInstanceID : InstanceID;
 };
 
 float4 main(PSInput input) : SV_TARGET
 {
-    // look at the DeferredPointLightPS.hlsl, they are almost identical (in terms of deferred shading logic)
-    return 1.0f.rrrr;
-}
\ No newline at end of file
+    float2 texCoord = input.iPosH.xy;
+    
+    InstanceData instData = gSpotLights[input.iInstanceID];
+    
+    float4 diffuseAlbedo = gGBuffer[G_DIFF_ALBEDO].Load(input.iPosH.xyz);
+    float4 normalTex = gGBuffer[G_NORMAL].Load(input.iPosH.xyz);
+    float4 specularTex = gGBuffer[G_SPECULAR].Load(input.iPosH.xyz);
+    float3 posW = ComputeWorldPos(float3(texCoord, 0.0f));
+    
+    float3 fresnelR0 = specularTex.xyz;
+    float3 normalW = UnpackGBufferNormal(normalTex);
+    const float shininess = UnpackGBufferShininess(normalTex);
+    
+    Material mat = { diffuseAlbedo, fresnelR0, shininess };
+    
+    float3 toEye = gEyePos - posW;
+    float3 viewDir = toEye / length(toEye);
+    
+    float3 spotLight = CalcSpotLight(instData.gLight, normalW, posW, viewDir, mat);
+    
+    return float4(spotLight, 1.0f);
+}
@@ -3,17 +3,16 @@
 struct PSInput
 {
     float4 iPosH     : SV_POSITION;
-    float3 iPosW     : POSITION0;
     float3 iNormalW  : NORMAL;
-    float3 iTangentW : TANGENT;
+    float4 iTangentW : TANGENT;
     float2 iTexC     : TEXCOORD0;
 };
 
 struct GBuffer
 {
     float4 DiffuseAlbedo     : SV_Target0;
-    float4 AmbientOcclusion  : SV_Target1;
-    float4 Normal            : SV_Target2; // could be used only 2 components instead of 4
+    float  AmbientOcclusion  : SV_Target1;
+    float4 Normal            : SV_Target2; // PackGBufferNormal
     float4 Specular          : SV_Target3;
     float2 MotionVectors     : SV_Target4;
 };
@@ -37,18 +36,23 @@ GBuffer main(PSInput input)
     diffuseAlbedo *= gTextures[diffuseMapIndex].Sample(gSamplerAnisotropicWrap, input.iTexC);
     output.DiffuseAlbedo = diffuseAlbedo;
 
-    output.AmbientOcclusion = float4(input.iPosW, 0.0f); // temporary
+    // Unoccluded until SSAO writes here, world position is reconstructed from depth by ComputeWorldPos.
+    output.AmbientOcclusion = 1.0f;
 
-    output.Normal = float4(input.iNormalW, 0.0f);
+    float3 normalW = input.iNormalW;
+    float gloss = 1.0f;
     
     if (normalMapIndex != INVALID_INDEX)
     {
         float4 normalMapSample = gTextures[512 + normalMapIndex].Sample(gSamplerAnisotropicWrap, input.iTexC);
-        output.Normal.xyz = NormalSampleToWorldSpace(normalMapSample.rgb, input.iNormalW, input.iTangentW);
-        output.Normal.a = normalMapSample.a;
+        normalW = NormalSampleToWorldSpace(normalMapSample.rgb, input.iNormalW, input.iTangentW);
+        gloss = normalMapSample.a;
     }
     
-    output.Specular = float4(fresnelR0, log2(1.0f - roughness) / 10.5f);
+    const float shininess = (1.0f - roughness) * gloss;
+    output.Normal = PackGBufferNormal(normalW, shininess);
+    
+    output.Specular = float4(fresnelR0, 0.0f);
     // TO DO: prev and curr frames camera diffs
     output.MotionVectors;
     
@@ -2,18 +2,17 @@
 
 struct VSInput
 {
-    float3 iPosL     : POSITION0;
-    float3 iNormalL  : NORMAL;
-    float3 iTangentU : TANGENT;
+    float4 iPosQ     : POSITION0; // w is the bitangent sign
+    float2 iNormalL  : NORMAL;    // octahedral
+    float2 iTangentU : TANGENT;   // octahedral
     float2 iTexC     : TEXCOORD0;
 };
 
 struct VSOutput
 {
     float4 oPosH     : SV_POSITION;
-    float3 oPosW     : POSITION0;
     float3 oNormalW  : NORMAL;
-    float3 oTangentW : TANGENT;
+    float4 oTangentW : TANGENT;
     float2 oTexC     : TEXCOORD0;
 };
 
@@ -23,11 +22,12 @@ VSOutput main(VSInput input)
     
     MaterialData matData = gMaterialData[gMaterialIndex];
     
-    float4 oPosW = mul(float4(input.iPosL, 1.0f), gWorld);
-    output.oPosH = mul(oPosW, gViewProj);
-    output.oPosW = oPosW.xyz;
-    output.oNormalW = mul(input.iNormalL, (float3x3) gInvTransposeWorld);
-    output.oTangentW = mul(input.iTangentU, (float3x3) gInvTransposeWorld);
+    float3 posL = DequantizePosition(input.iPosQ.xyz);
+    
+    float4 posW = mul(float4(posL, 1.0f), gWorld);
+    output.oPosH = mul(posW, gViewProj);
+    output.oNormalW = mul(OctahedralDecode(input.iNormalL), (float3x3) gInvTransposeWorld);
+    output.oTangentW = float4(mul(OctahedralDecode(input.iTangentU), (float3x3) gInvTransposeWorld), BitangentSign(input.iPosQ.w));
     
     float4 texCoord = mul(float4(input.iTexC, 0.0f, 1.0f), gTexTransform);
     output.oTexC = mul(texCoord, matData.MatTransform).xy;
@@ -19,6 +19,12 @@ struct GSOutput
 [maxvertexcount(3)]
 void main(triangle GSInput p[3], in uint id : SV_GSInstanceID, inout TriangleStream<GSOutput> stream)
 {
+    // the item was culled against this cascade on CPU
+    if ((gCascadeMask & (1u << id)) == 0u)
+    {
+        return;
+    }
+
     [unroll]
     for (int i = 0; i < 3; ++i)
     {
@@ -0,0 +1,18 @@
+#include "Common.hlsl"
+
+struct VSOutput
+{
+    float4 oPosH : SV_POSITION;
+    nointerpolation uint oInstanceID : InstanceID;
+};
+
+// Full screen quad per light instance, drawn as a 4 vertex strip. Lights are bounded by the scissor rect.
+VSOutput main(uint id : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+    VSOutput output = (VSOutput) 0;
+
+    float2 texC = float2(id & 1, (id & 2) >> 1);
+    output.oPosH = float4(texC * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    output.oInstanceID = instanceID;
+    return output;
+}
@@ -85,6 +85,25 @@ float3 CalcPointLight(Light L, float3 N, float3 posW, float3 viewDir, Material m
     return BlinnPhong(lightStrength, lightDir, N, viewDir, mat);
 }
 
+float3 CalcSpotLight(Light L, float3 N, float3 posW, float3 viewDir, Material mat)
+{
+    float3 lightVec = L.Position - posW;
+    
+    float d = length(lightVec);
+    
+    if (d > L.FalloffEnd)
+        return 0.0f.rrr;
+    
+    float3 lightDir = lightVec / d;
+    float NdotL = max(dot(lightDir, N), 0.0f);
+    float attenuation = CalcAttenuation(d, L.FalloffStart, L.FalloffEnd);
+    // L.Direction is unit length, the factor falls off towards the edge of the cone
+    float spotFactor = pow(max(dot(-lightDir, L.Direction), 0.0f), L.SpotPower);
+    float3 lightStrength = L.Strength * NdotL * attenuation * spotFactor;
+    
+    return BlinnPhong(lightStrength, lightDir, N, viewDir, mat);
+}
+
 float3 ComputeSpotLight(Light L, Material mat, float3 posW, float3 normal, float3 toEye)
 {
     // The vector from the surface to the light.
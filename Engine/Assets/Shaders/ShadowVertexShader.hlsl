@@ -2,7 +2,7 @@
 
 struct VSInput
 {
-    float3 iPosL : POSITION0;
+    float4 iPosQ : POSITION0;
 };
 
 struct VSOutput
@@ -13,6 +13,6 @@ struct VSOutput
 VSOutput main(VSInput input)
 {
     VSOutput output = (VSOutput) 0;
-    output.oPosH = mul(float4(input.iPosL, 1.0f), gWorld);
+    output.oPosH = mul(float4(DequantizePosition(input.iPosQ.xyz), 1.0f), gWorld);
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "Common.hlsl"
+
+struct VSInput
+{
+    float3 iPosL : POSITION0;
+};
+
+struct VSOutput
+{
+    float4 oPosH : SV_POSITION;
+    nointerpolation uint oInstanceID : InstanceID;
+};
+
+// Cone proxy per spot light instance, gWorld maps the unit cone onto the light's bounding cone.
+VSOutput main(VSInput input, uint instanceID : SV_InstanceID)
+{
+    VSOutput output = (VSOutput) 0;
+    
+    InstanceData instData = gSpotLights[instanceID];
+    
+    float4 posW = mul(float4(input.iPosL, 1.0f), instData.gWorld);
+    output.oPosH = mul(posW, gViewProj);
+    output.oInstanceID = instanceID;
+    return output;
+}
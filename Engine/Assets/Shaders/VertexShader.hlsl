@@ -2,9 +2,9 @@
 
 struct VSInput
 {
-    float3 iPosL    : POSITION0;
-    float3 iNormalL : NORMAL;
-    float3 iTangent : TANGENT;
+    float4 iPosQ    : POSITION0;
+    float2 iNormalL : NORMAL;  // octahedral
+    float2 iTangent : TANGENT; // octahedral
     float2 iTexC    : TEXCOORD0;
 };
 
@@ -22,11 +22,11 @@ VSOutput main(VSInput input)
  
     MaterialData matData = gMaterialData[gMaterialIndex];
     
-    float4 oPosW = mul(float4(input.iPosL, 1.0f), gWorld);
+    float4 oPosW = mul(float4(DequantizePosition(input.iPosQ.xyz), 1.0f), gWorld);
     
     output.oPosW = oPosW.xyz;
     output.oPosH = mul(oPosW, gViewProj);
-    output.oNormalW = mul(input.iNormalL, (float3x3) gInvTransposeWorld);
+    output.oNormalW = mul(OctahedralDecode(input.iNormalL), (float3x3) gInvTransposeWorld);
 
     float4 texCoord = mul(float4(input.iTexC, 0.0f, 1.0f), gTexTransform);
     output.oTexC = mul(texCoord, matData.MatTransform).xy;
@@ -0,0 +1,102 @@
+//--------------------------------------------------------------------------------------
+// File: DDSTextureData.h
+//
+// Parsing half of DDSTextureLoader: reads a DDS file into memory and lays out its
+// subresources for the upload. Needs neither a device nor the Windows headers.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "DDS.h"
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+namespace DirectX
+{
+    enum DDS_ALPHA_MODE
+    {
+        DDS_ALPHA_MODE_UNKNOWN = 0,
+        DDS_ALPHA_MODE_STRAIGHT = 1,
+        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+        DDS_ALPHA_MODE_OPAQUE = 3,
+        DDS_ALPHA_MODE_CUSTOM = 4,
+    };
+
+    // CPU side of a DDS texture: the file contents and the subresource layout pointing into them.
+    // Producing it needs no device, so it can be built on a worker thread and uploaded later.
+    struct DDSTextureData
+    {
+        std::unique_ptr<uint8_t[]> FileData;
+        std::vector<D3D12_SUBRESOURCE_DATA> Subresources;
+
+        D3D12_RESOURCE_DIMENSION Dimension = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+        size_t Width = 0;
+        size_t Height = 0;
+        size_t Depth = 0;
+        size_t MipCount = 0;
+        size_t ArraySize = 0;
+        DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+        bool IsCubeMap = false;
+        DDS_ALPHA_MODE AlphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    };
+
+    // Reads and parses a DDS file without touching D3D. Thread safe.
+    HRESULT LoadDDSTextureDataFromFile(_In_z_ const wchar_t* szFileName,
+        _Out_ DDSTextureData& outData,
+        _In_ size_t maxsize = 0
+    );
+
+    // Same as LoadDDSTextureDataFromFile, but outData.FileData stays empty and the subresources point into ddsData,
+    // which has to outlive outData.
+    HRESULT LoadDDSTextureDataFromMemory(_In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        _In_ size_t ddsDataSize,
+        _Out_ DDSTextureData& outData,
+        _In_ size_t maxsize = 0
+    );
+
+    // Stages of the parsing, shared with the D3D11 and D3D12 resource creation in DDSTextureLoader.cpp
+    namespace DDSParsing
+    {
+        HRESULT ValidateTextureData(_In_reads_bytes_(ddsDataSize) uint8_t* ddsData,
+            size_t ddsDataSize,
+            DDS_HEADER** header,
+            uint8_t** bitData,
+            size_t* bitSize
+        );
+
+        size_t BitsPerPixel(_In_ DXGI_FORMAT fmt);
+
+        void GetSurfaceInfo(_In_ size_t width,
+            _In_ size_t height,
+            _In_ DXGI_FORMAT fmt,
+            _Out_opt_ size_t* outNumBytes,
+            _Out_opt_ size_t* outRowBytes,
+            _Out_opt_ size_t* outNumRows
+        );
+
+        DXGI_FORMAT GetDXGIFormat(const DDS_PIXELFORMAT& ddpf);
+        DXGI_FORMAT MakeSRGB(_In_ DXGI_FORMAT format);
+        DDS_ALPHA_MODE GetAlphaMode(_In_ const DDS_HEADER* header);
+
+        // Subresources are ordered by array slice, then by mip. Mips larger than maxsize are skipped.
+        HRESULT ParseTextureFromDDS12(
+            _In_ const DDS_HEADER* header,
+            _In_reads_bytes_(bitSize) const uint8_t* bitData,
+            _In_ size_t bitSize,
+            _In_ size_t maxsize,
+            DDSTextureData& outData
+        );
+    }
+}
@@ -8,6 +8,7 @@
 #include "DDSTextureLoader.h"
 #include "ScaldCoreTypes.h"
 #include "ScaldCoreDefines.h"
+#include "MeshData.h"
 
 #include <unordered_map>
 #include <unordered_set>
@@ -20,19 +21,6 @@
 
 using Microsoft::WRL::ComPtr;
 
-template<typename TVertex = VertexPositionNormalTangentUV, typename TIndex = uint16_t> 
-struct MeshData
-{
-    static_assert(std::is_same<TIndex, unsigned>() || std::is_same<TIndex, unsigned short>()); // to make sure that index type either uint16_t or uint32_t
-
-    MeshData(UINT numLODs = 1u) : LODVertices(numLODs), LODIndices(numLODs), LODBounds(numLODs), NumLODs(numLODs) {}
-
-    std::vector<std::vector<TVertex>> LODVertices;
-    std::vector<std::vector<TIndex>> LODIndices;
-    std::vector<BoundingBox> LODBounds;
-    UINT NumLODs;
-};
-
 // Note that while ComPtr is used to manage the lifetime of resources on the CPU,
 // it has no understanding of the lifetime of resources on the GPU. Apps must account
 // for the GPU lifetime of resources to avoid destroying objects that may still be
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ScaldMath.h"
+
+// Placement alignment of constant buffer views (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT), checked in ScaldCoreTypes.h.
+static constexpr UINT ObjectConstantsAlignment = 256u;
+
+// Constant buffers
+struct ObjectConstants
+{
+	XMFLOAT4X4 World;
+	XMFLOAT4X4 InvTransposeWorld;
+	XMFLOAT4X4 TexTransform;
+	// Quantized positions of packed vertices are decoded as posQ * PositionDequantScale + PositionDequantBias
+	XMFLOAT3 PositionDequantScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	UINT MaterialIndex = 0u;
+	XMFLOAT3 PositionDequantBias = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	UINT objPad0 = 0u;
+};
+
+// ObjectConstants padded to constant buffer placement, so CPU copy has the same layout as the upload buffer.
+struct alignas(ObjectConstantsAlignment) PaddedObjectConstants : ObjectConstants
+{
+};
+
+// Structured buffers
+struct LightData
+{
+	XMFLOAT3 Strength = { 0.5f, 0.5f, 0.5f };
+	float FallOfStart = 1.0f;					// spot/point
+	XMFLOAT3 Direction = { 0.5f, -1.0f, 0.5f }; // spot/dir
+	float FallOfEnd = 10.0f;					// spot/point
+	XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };	// spot/point
+	float SpotPower = 64.0f;					// spot only
+};
+
+struct LightInstanceData
+{
+	XMFLOAT4X4 World;
+	LightData Light;
+};
+
+struct InstanceData
+{
+	XMFLOAT4X4 World;
+	LightData Light;
+};
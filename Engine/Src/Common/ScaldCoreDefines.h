@@ -4,7 +4,11 @@
  * Engine CPP wrappers
  */
 #ifndef FORCEINLINE
-	#define FORCEINLINE __forceinline
+	#if defined(_MSC_VER)
+		#define FORCEINLINE __forceinline
+	#else
+		#define FORCEINLINE inline __attribute__((always_inline))
+	#endif
 #endif
 
 #ifndef VVOID
@@ -1,6 +1,7 @@
 #pragma once
 
-#include "VertexTypes.h"
+#include "VertexInputLayouts.h"
+#include "ObjectConstants.h"
 #include <DirectXColors.h>
 
 constexpr int INVALID_ID = -1;
@@ -24,9 +25,7 @@ enum class EPassType : UINT
 #define MaxCascades 4
 
 #define MaxDirLights 1u
-#define MaxPointLights 128u
 #define MaxSpotLights 128u
-#define MaxLightsPool (MaxPointLights + MaxSpotLights)
 
 struct CascadesShadows
 {
@@ -43,39 +42,7 @@ struct CascadesShadows
 	float Distances[MaxCascades];
 };
 
-struct LightData
-{
-	XMFLOAT3 Strength = { 0.5f, 0.5f, 0.5f };
-	float FallOfStart = 1.0f;					// spot/point
-	XMFLOAT3 Direction = { 0.5f, -1.0f, 0.5f }; // spot/dir
-	float FallOfEnd = 10.0f;					// spot/point
-	XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };	// spot/point
-	float SpotPower = 64.0f;					// spot only
-};
-
-struct LightInstanceData
-{
-	XMFLOAT4X4 World;
-	LightData Light;
-};
-
-// Constant buffers
-struct ObjectConstants
-{
-	XMFLOAT4X4 World;
-	XMFLOAT4X4 InvTransposeWorld;
-	XMFLOAT4X4 TexTransform;
-	UINT MaterialIndex = 0u;
-	UINT objPad0 = 0u;
-	UINT objPad1 = 0u;
-	UINT objPad2 = 0u;
-};
-
-struct InstanceData
-{
-	XMFLOAT4X4 World;
-	LightData Light;
-};
+static_assert(ObjectConstantsAlignment == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, "PaddedObjectConstants must match CBV placement");
 
 // Fprward Rendering
 #define MaxLights 16
@@ -110,6 +77,12 @@ struct PassConstants
 	uint32_t NumPointLights = 0u;
 
 	LightData DirLight;
+
+	UINT ClusterTilesX = 0u;
+	UINT ClusterTilesY = 0u;
+	UINT ClusterSlicesZ = 0u;
+	float ClusterDepthSliceScale = 0.0f;
+	float ClusterDepthSliceBias = 0.0f;
 };
 
 // Structured buffers
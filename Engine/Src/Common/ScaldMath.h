@@ -1,5 +1,15 @@
 #pragma once
 
+#include "ScaldPlatform.h"
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace DirectX;
+
 class ScaldMath
 {
 public:
@@ -45,6 +55,102 @@ public:
 		return a + RandF() * (b - a);
 	}
 
+	// Inverts an affine matrix (last column is (0, 0, 0, 1), true for any TRS transform).
+	// Upper 3x3 is inverted through cross products of its rows, which is much cheaper than general 4x4 XMMatrixInverse.
+	static XMMATRIX InverseAffine(FXMMATRIX m)
+	{
+		// Rows of the cofactor matrix, inverse of the 3x3 part is its transpose divided by determinant.
+		const XMVECTOR c0 = XMVector3Cross(m.r[1], m.r[2]);
+		const XMVECTOR c1 = XMVector3Cross(m.r[2], m.r[0]);
+		const XMVECTOR c2 = XMVector3Cross(m.r[0], m.r[1]);
+		const XMVECTOR invDet = XMVectorReciprocal(XMVector3Dot(m.r[0], c0));
+
+		XMMATRIX inv;
+		inv.r[0] = XMVectorMultiply(c0, invDet);
+		inv.r[1] = XMVectorMultiply(c1, invDet);
+		inv.r[2] = XMVectorMultiply(c2, invDet);
+		inv.r[3] = XMVectorZero();
+		inv = XMMatrixTranspose(inv);
+
+		// Translation row is -t * inverse(A)
+		const XMVECTOR t = m.r[3];
+		XMVECTOR invT = XMVectorMultiply(XMVectorSplatX(t), inv.r[0]);
+		invT = XMVectorMultiplyAdd(XMVectorSplatY(t), inv.r[1], invT);
+		invT = XMVectorMultiplyAdd(XMVectorSplatZ(t), inv.r[2], invT);
+		inv.r[3] = XMVectorSelect(g_XMIdentityR3, XMVectorNegate(invT), g_XMSelect1110);
+		return inv;
+	}
+
+	// InverseAffine over an array, outInverses may be inMatrices.
+	// Four matrices at a time are transposed into SoA form (a vector per element, one matrix per lane),
+	// so the cofactors are plain multiplies instead of the shuffles of per-matrix cross products. The tail goes one by one.
+	static void InverseAffineBatch(const XMFLOAT4X4* inMatrices, XMFLOAT4X4* outInverses, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 4u <= count; i += 4u)
+		{
+			// a[r][c] holds element (r, c) of the four matrices.
+			XMVECTOR a[4][3];
+			for (UINT r = 0; r < 4u; ++r)
+			{
+				const XMMATRIX rows = XMMatrixTranspose(XMMATRIX(
+					XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(inMatrices[i + 0].m[r])),
+					XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(inMatrices[i + 1].m[r])),
+					XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(inMatrices[i + 2].m[r])),
+					XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(inMatrices[i + 3].m[r]))));
+				a[r][0] = rows.r[0];
+				a[r][1] = rows.r[1];
+				a[r][2] = rows.r[2];
+			}
+
+			// Cofactor rows c0 = a1 x a2, c1 = a2 x a0, c2 = a0 x a1, inverse(A)[r][c] = c[c][r] / det.
+			XMVECTOR c[3][3];
+			for (UINT k = 0; k < 3u; ++k)
+			{
+				const XMVECTOR* u = a[(k + 1u) % 3u];
+				const XMVECTOR* v = a[(k + 2u) % 3u];
+				c[k][0] = XMVectorNegativeMultiplySubtract(u[2], v[1], XMVectorMultiply(u[1], v[2]));
+				c[k][1] = XMVectorNegativeMultiplySubtract(u[0], v[2], XMVectorMultiply(u[2], v[0]));
+				c[k][2] = XMVectorNegativeMultiplySubtract(u[1], v[0], XMVectorMultiply(u[0], v[1]));
+			}
+			const XMVECTOR det = XMVectorMultiplyAdd(a[0][2], c[0][2], XMVectorMultiplyAdd(a[0][1], c[0][1], XMVectorMultiply(a[0][0], c[0][0])));
+			const XMVECTOR invDet = XMVectorReciprocal(det);
+
+			XMVECTOR inv[3][3];
+			for (UINT r = 0; r < 3u; ++r)
+			{
+				for (UINT col = 0; col < 3u; ++col)
+				{
+					inv[r][col] = XMVectorMultiply(c[col][r], invDet);
+				}
+			}
+
+			// Translation row is -t * inverse(A)
+			XMVECTOR invT[3];
+			for (UINT col = 0; col < 3u; ++col)
+			{
+				invT[col] = XMVectorNegate(XMVectorMultiplyAdd(a[3][2], inv[2][col], XMVectorMultiplyAdd(a[3][1], inv[1][col], XMVectorMultiply(a[3][0], inv[0][col]))));
+			}
+
+			// Back to one matrix per row: row r of the four inverses.
+			for (UINT r = 0; r < 4u; ++r)
+			{
+				const XMMATRIX rows = r < 3u
+					? XMMatrixTranspose(XMMATRIX(inv[r][0], inv[r][1], inv[r][2], XMVectorZero()))
+					: XMMatrixTranspose(XMMATRIX(invT[0], invT[1], invT[2], XMVectorSplatOne()));
+				for (UINT k = 0; k < 4u; ++k)
+				{
+					XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(outInverses[i + k].m[r]), rows.r[k]);
+				}
+			}
+		}
+
+		for (; i < count; ++i)
+		{
+			XMStoreFloat4x4(&outInverses[i], InverseAffine(XMLoadFloat4x4(&inMatrices[i])));
+		}
+	}
+
 	static inline const XMVECTOR ForwardVector = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
 	static inline const XMVECTOR RightVector = XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
 	static inline const XMVECTOR UpVector = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
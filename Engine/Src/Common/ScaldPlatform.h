@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * Base header of the code that doesn't talk to the device (math, containers, jobs, asset formats).
+ * Gives the Windows integer types and the engine defines without windows.h/d3d12.h,
+ * so those modules also build in the CPU-only test target (Engine/Tests).
+ */
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <cstdint>
+
+	using BYTE = uint8_t;
+	using UINT8 = uint8_t;
+	using UINT16 = uint16_t;
+	using UINT = uint32_t;
+	using UINT32 = uint32_t;
+	using UINT64 = uint64_t;
+	using INT = int32_t;
+	using INT64 = int64_t;
+#endif
+
+#include "ScaldCoreDefines.h"
+
+#include <array>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
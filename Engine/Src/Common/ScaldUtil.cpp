@@ -1,6 +1,55 @@
 #include "stdafx.h"
 
 #include "ScaldUtil.h"
+#include "Core/AssetArchive.h"
+#include "Core/ShaderCache.h"
+
+namespace
+{
+    // Resolves #include directives like D3D_COMPILE_STANDARD_FILE_INCLUDE does, relative to the including file,
+    // but reads them through ShaderCache::ReadSource, so they come out of the archive as well.
+    class ArchiveShaderInclude : public ID3DInclude
+    {
+    public:
+        ArchiveShaderInclude(const AssetArchive* pArchive, const std::filesystem::path& fileName)
+            : m_pArchive(pArchive)
+            , m_directory(fileName.parent_path())
+        {
+        }
+
+        HRESULT STDMETHODCALLTYPE Open(D3D_INCLUDE_TYPE, LPCSTR pFileName, LPCVOID pParentData, LPCVOID* ppData, UINT* pBytes) override
+        {
+            // The compiler only tells which source includes by its data, so the directory of every opened one is kept.
+            auto parent = m_directories.find(pParentData);
+            const std::filesystem::path fileName = (parent != m_directories.end() ? parent->second : m_directory) / std::filesystem::u8path(pFileName);
+
+            auto source = std::make_unique<std::string>();
+            if (!ShaderCache::ReadSource(m_pArchive, fileName, *source))
+            {
+                return E_FAIL;
+            }
+
+            *ppData = source->data();
+            *pBytes = (UINT)source->size();
+            m_directories[source->data()] = fileName.parent_path();
+            m_sources.push_back(std::move(source));
+            return S_OK;
+        }
+
+        // Sources are freed with the object, after the compile.
+        HRESULT STDMETHODCALLTYPE Close(LPCVOID) override
+        {
+            return S_OK;
+        }
+
+    private:
+        const AssetArchive* m_pArchive;
+        std::filesystem::path m_directory;
+
+        std::vector<std::unique_ptr<std::string>> m_sources;
+        std::unordered_map<LPCVOID, std::filesystem::path> m_directories;
+    };
+}
 
 ComPtr<ID3D12Resource> ScaldUtil::CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, ComPtr<ID3D12Resource>& uploadBuffer)
 {
@@ -51,7 +100,24 @@ UINT ScaldUtil::CalcConstantBufferByteSize(const UINT byteSize)
     return (byteSize + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
 }
 
-ComPtr<ID3DBlob> ScaldUtil::CompileShader(const std::wstring& fileName, const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target)
+ComPtr<ID3DBlob> ScaldUtil::CompileShader(const std::wstring& fileName, const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target, ShaderCache* pCache/*= nullptr*/)
+{
+    ShaderCompileDesc desc;
+    desc.FileName = fileName;
+    for (const D3D_SHADER_MACRO* define = defines; define && define->Name; ++define)
+    {
+        desc.Defines.push_back({ define->Name, define->Definition ? define->Definition : "" });
+    }
+    desc.EntryPoint = entrypoint;
+    desc.Target = target;
+
+    std::vector<uint8_t> byteCode;
+    ThrowIfFailed(CompileShader(desc, pCache, byteCode) ? S_OK : E_FAIL);
+
+    return CreateBlob(byteCode.data(), byteCode.size());
+}
+
+bool ScaldUtil::CompileShader(const ShaderCompileDesc& desc, ShaderCache* pCache, std::vector<uint8_t>& outByteCode, const AssetArchive* pArchive/*= nullptr*/)
 {
 #if defined(_DEBUG) | defined(DEBUG)
     // Enable better shader debugging with the graphics debugging tools.
@@ -60,18 +126,72 @@ ComPtr<ID3DBlob> ScaldUtil::CompileShader(const std::wstring& fileName, const D3
     UINT compileFlags = 0;
 #endif
 
-    HRESULT hr = S_OK;
+    // Flags and compiler are part of the cache key.
+    ShaderCompileDesc compileDesc = desc;
+    compileDesc.Flags = compileFlags;
+    compileDesc.CompilerVersion = D3D_COMPILER_VERSION;
+
+    UINT64 cacheKey = 0u;
+    const bool bIsCacheable = pCache && pCache->ComputeKey(compileDesc, cacheKey);
+    if (bIsCacheable && pCache->Load(cacheKey, outByteCode))
+    {
+        return true;
+    }
+
+    std::vector<D3D_SHADER_MACRO> defines;
+    defines.reserve(compileDesc.Defines.size() + 1u);
+    for (const ShaderDefine& define : compileDesc.Defines)
+    {
+        defines.push_back({ define.Name.c_str(), define.Value.c_str() });
+    }
+    defines.push_back({ nullptr, nullptr });
 
     ComPtr<ID3DBlob> byteCode = nullptr;
     ComPtr<ID3DBlob> errors;
 
-    hr = D3DCompileFromFile(fileName.c_str(), defines, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-        entrypoint.c_str(), target.c_str(), compileFlags, 0u, &byteCode, &errors);
+    HRESULT hr;
+    if (pArchive && pArchive->Find(compileDesc.FileName))
+    {
+        std::string source;
+        const std::string sourceName = compileDesc.FileName.u8string();
+        ArchiveShaderInclude include(pArchive, compileDesc.FileName);
+
+        hr = ShaderCache::ReadSource(pArchive, compileDesc.FileName, source)
+            ? D3DCompile(source.data(), source.size(), sourceName.c_str(), defines.data(), &include,
+                compileDesc.EntryPoint.c_str(), compileDesc.Target.c_str(), compileFlags, 0u, &byteCode, &errors)
+            : E_FAIL;
+    }
+    else
+    {
+        hr = D3DCompileFromFile(compileDesc.FileName.c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+            compileDesc.EntryPoint.c_str(), compileDesc.Target.c_str(), compileFlags, 0u, &byteCode, &errors);
+    }
 
     if (errors != nullptr)
         OutputDebugStringA((char*)errors->GetBufferPointer());
 
-    ThrowIfFailed(hr);
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
+    const uint8_t* pByteCode = static_cast<const uint8_t*>(byteCode->GetBufferPointer());
+    outByteCode.assign(pByteCode, pByteCode + byteCode->GetBufferSize());
+
+    // A failed store only means the next launch compiles again.
+    if (bIsCacheable)
+    {
+        pCache->Store(cacheKey, outByteCode.data(), outByteCode.size());
+    }
+
+    return true;
+}
+
+ComPtr<ID3DBlob> ScaldUtil::CreateBlob(const void* pData, size_t size)
+{
+    ComPtr<ID3DBlob> blob;
+    ThrowIfFailed(D3DCreateBlob(size, &blob));
+    memcpy(blob->GetBufferPointer(), pData, size);
 
-    return byteCode;
+    return blob;
 }
\ No newline at end of file
@@ -4,6 +4,10 @@
 
 using Microsoft::WRL::ComPtr;
 
+class AssetArchive;
+class ShaderCache;
+struct ShaderCompileDesc;
+
 class ScaldUtil
 {
 public:
@@ -13,13 +17,26 @@ public:
 
     static UINT CalcConstantBufferByteSize(const UINT byteSize);
 
-	static ComPtr<ID3DBlob> CompileShader(const std::wstring& fileName, const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target);
+	// With a cache, the bytecode is loaded from it when nothing it depends on has changed and stored into it after compiling otherwise.
+	static ComPtr<ID3DBlob> CompileShader(const std::wstring& fileName, const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target, ShaderCache* pCache = nullptr);
+	// Thread safe and does not throw, compile errors go to the debug output.
+	// Shaders packed into the archive are compiled from it, includes it lacks are read from disk.
+	static bool CompileShader(const ShaderCompileDesc& desc, ShaderCache* pCache, std::vector<uint8_t>& outByteCode, const AssetArchive* pArchive = nullptr);
+
+	static ComPtr<ID3DBlob> CreateBlob(const void* pData, size_t size);
 };
 
 // Defines a subrange of geometry in a MeshGeometry.  This is for when multiple
 // geometries are stored in one vertex and index buffer.  It provides the offsets
 // and data needed to draw a subset of geometry stores in the vertex and index 
 // buffers so that we can implement the technique described by Figure 6.3.
+struct SubmeshLOD
+{
+	UINT IndexCount = 0;
+	UINT StartIndexLocation = 0;
+	INT BaseVertexLocation = 0;
+};
+
 struct SubmeshGeometry
 {
 	UINT IndexCount = 0;
@@ -28,6 +45,13 @@ struct SubmeshGeometry
 
 	// Bounding box of the geometry defined by this submesh. 
 	BoundingBox Bounds;
+
+	// Decodes quantized positions, when the geometry uses packed vertices
+	XMFLOAT3 PositionDequantScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	XMFLOAT3 PositionDequantBias = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	// Draw arguments of every level of detail, LODs[0] matches the arguments above. Empty if the submesh has no LODs.
+	std::vector<SubmeshLOD> LODs;
 };
 
 struct MeshGeometry
@@ -60,6 +84,12 @@ struct MeshGeometry
 	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R16_UINT;
 	UINT IndexBufferByteSize = 0u;
 
+	// Optional position only copy of the vertices, so depth only passes don't fetch the other attributes.
+	Microsoft::WRL::ComPtr<ID3D12Resource> PositionBufferGPU = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Resource> PositionBufferUploader = nullptr;
+	UINT PositionByteStride = 0u;
+	UINT PositionBufferByteSize = 0u;
+
 	// A MeshGeometry may store multiple geometries in one vertex/index buffer.
 	// Use this container to define the Submesh geometries so we can draw
 	// the Submeshes individually.
@@ -75,6 +105,23 @@ struct MeshGeometry
 		return vbv;
 	}
 
+	bool HasPositionStream()const
+	{
+		return PositionBufferGPU != nullptr;
+	}
+
+	D3D12_VERTEX_BUFFER_VIEW PositionBufferView()const
+	{
+		assert(HasPositionStream());
+
+		D3D12_VERTEX_BUFFER_VIEW vbv = {};
+		vbv.BufferLocation = PositionBufferGPU->GetGPUVirtualAddress();
+		vbv.StrideInBytes = PositionByteStride;
+		vbv.SizeInBytes = PositionBufferByteSize;
+
+		return vbv;
+	}
+
 	D3D12_INDEX_BUFFER_VIEW IndexBufferView()const
 	{
 		D3D12_INDEX_BUFFER_VIEW ibv = {};
@@ -90,6 +137,7 @@ struct MeshGeometry
 	{
 		VertexBufferUploader = nullptr;
 		IndexBufferUploader = nullptr;
+		PositionBufferUploader = nullptr;
 	}
 
 	template<typename TVertex, typename  TIndex = uint16_t>
@@ -124,6 +172,21 @@ struct MeshGeometry
 			IndexFormat = (std::is_same<TIndex, unsigned short>()) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 		}
 	}
+
+	// Uploads the position stream (see SplitPositionStream), must have the same vertex count and order as the vertex buffer, so the same draw arguments work for both.
+	template<typename TPosition>
+	void CreatePositionStream(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<TPosition>& positions)
+	{
+		assert(positions.size() * VertexByteStride == VertexBufferByteSize);
+
+		const UINT64 byteSize = positions.size() * sizeof(TPosition);
+		if (byteSize)
+		{
+			PositionBufferGPU = ScaldUtil::CreateDefaultBuffer(device, cmdList, positions.data(), byteSize, PositionBufferUploader);
+			PositionBufferByteSize = (UINT)byteSize;
+			PositionByteStride = sizeof(TPosition);
+		}
+	}
 };
 
 struct Texture
@@ -150,6 +213,14 @@ struct Texture
 		ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, Filename.c_str(), Resource, UploadHeap));
 	}
 
+	// Deferred version, the resource is created later by the TextureLoader.
+	Texture(const char* name, const wchar_t* fileName, TextureType type = TextureType::ALBEDO)
+		: Name(std::string(name))
+		, Filename(std::wstring(fileName))
+		, Type(type)
+	{
+	}
+
 	TextureType Type = TextureType::NONE;
 	// Unique material name for lookup.
 	std::string Name;
@@ -158,4 +229,14 @@ struct Texture
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap = nullptr;
+	// Replaced by a streaming request, the GPU may still be reading it.
+	Microsoft::WRL::ComPtr<ID3D12Resource> PreviousResource = nullptr;
+
+	// Parsed file, kept for textures whose mips are streamed.
+	std::unique_ptr<DirectX::DDSTextureData> SourceData;
+	// Resource holds mips [FirstResidentMip, MipCount) of the source.
+	UINT FirstResidentMip = 0u;
+
+	// Set once the data is on the GPU and the resource can be sampled.
+	bool bIsResident = false;
 };
\ No newline at end of file
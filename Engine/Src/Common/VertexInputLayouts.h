@@ -0,0 +1,73 @@
+#pragma once
+
+#include "VertexTypes.h"
+
+// D3D12 input layout of a vertex type from VertexTypes.h, e.g. psoDesc.InputLayout = VertexInputLayout<VertexPosition>::Desc.
+template<typename TVertex>
+struct VertexInputLayout;
+
+template<>
+struct VertexInputLayout<VertexPosition>
+{
+	static constexpr inline UINT ElementCount = 1u;
+	static constexpr inline const D3D12_INPUT_ELEMENT_DESC Elements[ElementCount] =
+	{
+		{ "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 0u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+	};
+	static constexpr inline D3D12_INPUT_LAYOUT_DESC Desc =
+	{
+		Elements,
+		ElementCount
+	};
+};
+
+template<>
+struct VertexInputLayout<VertexPositionNormalTangentUV>
+{
+	static constexpr inline UINT ElementCount = 4u;
+	static constexpr inline const D3D12_INPUT_ELEMENT_DESC Elements[ElementCount] =
+	{
+		{ "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 0u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+		{ "NORMAL", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 12u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+		{ "TANGENT", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 24u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+		{ "TEXCOORD", 0u, DXGI_FORMAT_R32G32_FLOAT, 0u, 36u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+	};
+	static constexpr inline D3D12_INPUT_LAYOUT_DESC Desc =
+	{
+		Elements,
+		ElementCount
+	};
+};
+
+template<>
+struct VertexInputLayout<VertexPositionPacked>
+{
+	static constexpr inline UINT ElementCount = 1u;
+	static constexpr inline const D3D12_INPUT_ELEMENT_DESC Elements[ElementCount] =
+	{
+		{ "POSITION", 0u, DXGI_FORMAT_R16G16B16A16_UNORM, 0u, 0u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+	};
+	static constexpr inline D3D12_INPUT_LAYOUT_DESC Desc =
+	{
+		Elements,
+		ElementCount
+	};
+};
+
+template<>
+struct VertexInputLayout<VertexPositionNormalTangentUVPacked>
+{
+	static constexpr inline UINT ElementCount = 4u;
+	static constexpr inline const D3D12_INPUT_ELEMENT_DESC Elements[ElementCount] =
+	{
+		{ "POSITION", 0u, DXGI_FORMAT_R16G16B16A16_UNORM, 0u, 0u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+		{ "NORMAL", 0u, DXGI_FORMAT_R16G16_SNORM, 0u, 8u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+		{ "TANGENT", 0u, DXGI_FORMAT_R16G16_SNORM, 0u, 12u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+		{ "TEXCOORD", 0u, DXGI_FORMAT_R16G16_FLOAT, 0u, 16u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
+	};
+	static constexpr inline D3D12_INPUT_LAYOUT_DESC Desc =
+	{
+		Elements,
+		ElementCount
+	};
+};
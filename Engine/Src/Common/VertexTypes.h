@@ -1,6 +1,14 @@
 #pragma once
 
+// Plain vertex data, input layouts for the pipeline states are in VertexInputLayouts.h.
+
+#include "ScaldPlatform.h"
+
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include <cstddef>
+#include <vector>
 
 using namespace DirectX;
 
@@ -17,20 +25,6 @@ struct VertexPosition
 	{}
 
 	XMFLOAT3 position = XMFLOAT3(0.0f, 0.0f, 0.0f);
-
-private:
-	static constexpr inline UINT InputElementCount = 1u;
-	static constexpr inline const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount] =
-	{
-		{ "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 0u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
-	};
-
-public:
-	static constexpr inline D3D12_INPUT_LAYOUT_DESC InputLayout =
-	{
-		InputElements,
-		InputElementCount
-	};
 };
 
 struct VertexPositionNormalTangentUV
@@ -61,20 +55,41 @@ struct VertexPositionNormalTangentUV
 	XMFLOAT3 normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
 	XMFLOAT3 tangent = XMFLOAT3(0.0f, 0.0f, 0.0f);
 	XMFLOAT2 texCoord = XMFLOAT2(0.0f, 0.0f);
-private:
-	static constexpr inline UINT InputElementCount = 4u;
-	static constexpr inline const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount] =
-	{
-		{ "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 0u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
-		{ "NORMAL", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 12u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
-		{ "TANGENT", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 24u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
-		{ "TEXCOORD", 0u, DXGI_FORMAT_R32G32_FLOAT, 0u, 36u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u },
-	};
-
-public:
-	static constexpr inline D3D12_INPUT_LAYOUT_DESC InputLayout =
+};
+
+// Position stream of VertexPositionNormalTangentUVPacked for depth only passes
+struct VertexPositionPacked
+{
+	VertexPositionPacked() {}
+
+	VertexPositionPacked(const PackedVector::XMUSHORTN4& p)
+		: position(p)
+	{}
+
+	PackedVector::XMUSHORTN4 position;
+};
+
+// 20 bytes counterpart of VertexPositionNormalTangentUV, see VertexCompression for the encoding.
+struct VertexPositionNormalTangentUVPacked
+{
+	// xyz quantized to the mesh's bounding box, w is the bitangent sign (0 means -1, 1 means +1)
+	PackedVector::XMUSHORTN4 position;
+	// Octahedral encoded normal (xy) and tangent (zw)
+	PackedVector::XMSHORTN4 normalTangent;
+	PackedVector::XMHALF2 texCoord;
+};
+static_assert(sizeof(VertexPositionNormalTangentUVPacked) == 20u);
+// Geometry without a position stream is drawn by the depth only passes straight from the packed vertices.
+static_assert(offsetof(VertexPositionNormalTangentUVPacked, position) == offsetof(VertexPositionPacked, position));
+
+// Extracts positions into their own tightly packed stream, TPosition must be constructible from TVertex::position.
+template<typename TPosition, typename TVertex>
+void SplitPositionStream(const std::vector<TVertex>& vertices, std::vector<TPosition>& outPositions)
+{
+	outPositions.clear();
+	outPositions.reserve(vertices.size());
+	for (const TVertex& vertex : vertices)
 	{
-		InputElements,
-		InputElementCount
-	};
-};
\ No newline at end of file
+		outPositions.emplace_back(vertex.position);
+	}
+}
@@ -0,0 +1,528 @@
+#include "AssetArchive.h"
+#include "JobSystem.h"
+#include "LZ4Block.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	FORCEINLINE UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+
+	FORCEINLINE UINT64 GetNumChunks(UINT64 size, UINT chunkSize)
+	{
+		return (size + chunkSize - 1u) / chunkSize;
+	}
+
+	// Maps the whole file read only, the view stays valid after the handles are closed.
+	const uint8_t* MapFile(const std::filesystem::path& fileName, UINT64& outSize)
+	{
+#if defined(_WIN32)
+		HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER fileSize = {};
+		HANDLE mapping = GetFileSizeEx(file, &fileSize) ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0u, 0u, nullptr) : nullptr;
+		CloseHandle(file);
+		if (!mapping)
+		{
+			return nullptr;
+		}
+
+		void* pView = MapViewOfFile(mapping, FILE_MAP_READ, 0u, 0u, 0u);
+		CloseHandle(mapping);
+		if (!pView)
+		{
+			return nullptr;
+		}
+
+		outSize = (UINT64)fileSize.QuadPart;
+
+#if WINVER >= _WIN32_WINNT_WIN8
+		// Pulls the file in with large sequential reads instead of a page fault per 4 KB.
+		WIN32_MEMORY_RANGE_ENTRY range = { pView, (SIZE_T)outSize };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1u, &range, 0u);
+#endif
+		return static_cast<const uint8_t*>(pView);
+#else
+		const int file = open(fileName.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			return nullptr;
+		}
+
+		struct stat fileStat = {};
+		void* pView = fstat(file, &fileStat) == 0 && fileStat.st_size > 0
+			? mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0)
+			: MAP_FAILED;
+		close(file);
+		if (pView == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		outSize = (UINT64)fileStat.st_size;
+
+		// Pulls the file in with large sequential reads instead of a page fault per 4 KB.
+		madvise(pView, (size_t)outSize, MADV_WILLNEED);
+		return static_cast<const uint8_t*>(pView);
+#endif
+	}
+
+	void UnmapFile(const uint8_t* pData, UINT64 size)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(pData);
+#else
+		munmap(const_cast<uint8_t*>(pData), (size_t)size);
+#endif
+	}
+}
+
+#pragma region AssetArchive
+
+AssetArchive::~AssetArchive()
+{
+	Close();
+}
+
+bool AssetArchive::Open(const std::filesystem::path& fileName)
+{
+	Close();
+
+	m_pData = MapFile(fileName, m_size);
+	if (!m_pData)
+	{
+		m_size = 0u;
+		return false;
+	}
+
+	if (!Validate())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void AssetArchive::Close()
+{
+	if (m_pData)
+	{
+		UnmapFile(m_pData, m_size);
+	}
+
+	m_pData = nullptr;
+	m_size = 0u;
+	m_pHeader = nullptr;
+	m_pEntries = nullptr;
+	m_pPaths = nullptr;
+}
+
+bool AssetArchive::Validate()
+{
+	if (m_size < sizeof(AssetArchiveHeader))
+	{
+		return false;
+	}
+
+	// The mapping is page aligned and so are the offsets checked below, the structures can be read in place.
+	auto* pHeader = reinterpret_cast<const AssetArchiveHeader*>(m_pData);
+	if (pHeader->Magic != AssetArchiveHeader::MagicValue || pHeader->Version != AssetArchiveHeader::CurrentVersion || pHeader->ChunkSize == 0u)
+	{
+		return false;
+	}
+
+	const UINT64 tocSize = (UINT64)pHeader->NumEntries * sizeof(AssetArchiveEntry);
+	if (pHeader->TocOffset % alignof(AssetArchiveEntry) != 0u || pHeader->TocOffset > m_size || tocSize > m_size - pHeader->TocOffset
+		|| pHeader->PathsOffset > m_size || pHeader->PathsSize > m_size - pHeader->PathsOffset)
+	{
+		return false;
+	}
+
+	auto* pEntries = reinterpret_cast<const AssetArchiveEntry*>(m_pData + pHeader->TocOffset);
+	for (UINT i = 0; i < pHeader->NumEntries; ++i)
+	{
+		const AssetArchiveEntry& entry = pEntries[i];
+		if (entry.Offset % EntryAlignment != 0u || entry.Offset > m_size || entry.StoredSize > m_size - entry.Offset
+			|| (UINT64)entry.PathOffset + entry.PathLength > pHeader->PathsSize)
+		{
+			return false;
+		}
+
+		const bool bIsValidSize = entry.IsCompressed()
+			? entry.NumChunks == GetNumChunks(entry.Size, pHeader->ChunkSize)
+			: entry.StoredSize == entry.Size;
+		if (!bIsValidSize)
+		{
+			return false;
+		}
+
+		// Find relies on the order.
+		if (i > 0u && pEntries[i - 1u].PathHash > entry.PathHash)
+		{
+			return false;
+		}
+	}
+
+	m_pHeader = pHeader;
+	m_pEntries = pEntries;
+	m_pPaths = reinterpret_cast<const char*>(m_pData + pHeader->PathsOffset);
+
+	return true;
+}
+
+const AssetArchiveEntry* AssetArchive::Find(const std::filesystem::path& path) const
+{
+	if (!IsOpen())
+	{
+		return nullptr;
+	}
+
+	const std::string normalizedPath = NormalizePath(path);
+	const UINT64 hash = HashPath(normalizedPath);
+
+	const AssetArchiveEntry* pEnd = m_pEntries + m_pHeader->NumEntries;
+	const AssetArchiveEntry* pEntry = std::lower_bound(m_pEntries, pEnd, hash, [](const AssetArchiveEntry& entry, UINT64 value) { return entry.PathHash < value; });
+
+	// Paths with the same hash are adjacent.
+	for (; pEntry != pEnd && pEntry->PathHash == hash; ++pEntry)
+	{
+		if (GetPath(*pEntry) == normalizedPath)
+		{
+			return pEntry;
+		}
+	}
+
+	return nullptr;
+}
+
+const uint8_t* AssetArchive::GetMappedData(const AssetArchiveEntry& entry) const
+{
+	return entry.IsCompressed() ? nullptr : m_pData + entry.Offset;
+}
+
+bool AssetArchive::Read(const AssetArchiveEntry& entry, uint8_t* pDst) const
+{
+	const uint8_t* pBase = m_pData + entry.Offset;
+	if (!entry.IsCompressed())
+	{
+		memcpy(pDst, pBase, (size_t)entry.Size);
+		return true;
+	}
+
+	const UINT64 tableSize = (UINT64)entry.NumChunks * sizeof(UINT32);
+	if (tableSize > entry.StoredSize)
+	{
+		return false;
+	}
+
+	// Chunk sizes are only known after the previous chunks, offsets are resolved upfront so the chunks can go wide.
+	const UINT32* pChunkSizes = reinterpret_cast<const UINT32*>(pBase);
+	std::vector<UINT64> chunkOffsets(entry.NumChunks + 1u);
+	chunkOffsets[0] = tableSize;
+	for (UINT i = 0; i < entry.NumChunks; ++i)
+	{
+		chunkOffsets[i + 1u] = chunkOffsets[i] + (pChunkSizes[i] & ~AssetArchiveEntry::StoredRawChunkBit);
+		if (chunkOffsets[i + 1u] > entry.StoredSize)
+		{
+			return false;
+		}
+	}
+
+	const UINT chunkSize = m_pHeader->ChunkSize;
+	std::atomic<bool> bIsValid = true;
+	JobSystem::Get().ParallelFor(entry.NumChunks, 1u, [&](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; ++i)
+			{
+				const uint8_t* pSrc = pBase + chunkOffsets[i];
+				const size_t srcSize = (size_t)(chunkOffsets[i + 1u] - chunkOffsets[i]);
+				uint8_t* pChunk = pDst + (UINT64)i * chunkSize;
+				const size_t dstSize = (size_t)std::min<UINT64>(chunkSize, entry.Size - (UINT64)i * chunkSize);
+
+				bool bIsChunkValid;
+				if (pChunkSizes[i] & AssetArchiveEntry::StoredRawChunkBit)
+				{
+					bIsChunkValid = srcSize == dstSize;
+					if (bIsChunkValid)
+					{
+						memcpy(pChunk, pSrc, dstSize);
+					}
+				}
+				else
+				{
+					bIsChunkValid = LZ4Block::Decompress(pSrc, srcSize, pChunk, dstSize);
+				}
+
+				if (!bIsChunkValid)
+				{
+					bIsValid.store(false, std::memory_order_relaxed);
+				}
+			}
+		});
+
+	return bIsValid.load(std::memory_order_relaxed);
+}
+
+const uint8_t* AssetArchive::Load(const AssetArchiveEntry& entry, std::unique_ptr<uint8_t[]>& outStorage) const
+{
+	if (const uint8_t* pData = GetMappedData(entry))
+	{
+		return pData;
+	}
+
+	outStorage = std::make_unique<uint8_t[]>((size_t)entry.Size);
+	if (!Read(entry, outStorage.get()))
+	{
+		outStorage.reset();
+		return nullptr;
+	}
+
+	return outStorage.get();
+}
+
+std::string_view AssetArchive::GetPath(const AssetArchiveEntry& entry) const
+{
+	return std::string_view(m_pPaths + entry.PathOffset, entry.PathLength);
+}
+
+std::string AssetArchive::NormalizePath(const std::filesystem::path& path)
+{
+	std::string normalizedPath = path.lexically_normal().generic_u8string();
+	for (char& c : normalizedPath)
+	{
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = (char)(c - 'A' + 'a');
+		}
+	}
+	return normalizedPath;
+}
+
+UINT64 AssetArchive::HashPath(std::string_view normalizedPath)
+{
+	UINT64 hash = 14695981039346656037ull;
+	for (char c : normalizedPath)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+#pragma endregion AssetArchive
+
+#pragma region AssetArchiveWriter
+
+AssetArchiveWriter::AssetArchiveWriter(UINT chunkSize)
+	: m_chunkSize(chunkSize)
+{
+	// Stored chunk sizes keep the top bit for StoredRawChunkBit.
+	assert(chunkSize > 0u && LZ4Block::GetMaxCompressedSize(chunkSize) < AssetArchiveEntry::StoredRawChunkBit);
+}
+
+void AssetArchiveWriter::AddFile(const std::filesystem::path& path, std::vector<uint8_t> data, bool bCompress)
+{
+	m_files.push_back({ AssetArchive::NormalizePath(path), std::move(data), bCompress });
+}
+
+bool AssetArchiveWriter::AddDirectory(const std::filesystem::path& directory, bool bCompress)
+{
+	std::error_code error;
+	for (auto it = std::filesystem::recursive_directory_iterator(directory, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+	{
+		if (!it->is_regular_file())
+		{
+			continue;
+		}
+
+		std::ifstream file(it->path(), std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> data((size_t)file.tellg());
+		file.seekg(0, std::ios::beg);
+		if (!file.read(reinterpret_cast<char*>(data.data()), (std::streamsize)data.size()))
+		{
+			return false;
+		}
+
+		AddFile(it->path(), std::move(data), bCompress);
+	}
+
+	return !error;
+}
+
+bool AssetArchiveWriter::Write(const std::filesystem::path& fileName)
+{
+	// Path order puts files of a directory next to each other. Of duplicates, the last added one is kept.
+	std::stable_sort(m_files.begin(), m_files.end(), [](const PendingFile& a, const PendingFile& b) { return a.Path < b.Path; });
+	std::vector<PendingFile*> files;
+	for (size_t i = 0; i < m_files.size(); ++i)
+	{
+		if (i + 1u == m_files.size() || m_files[i + 1u].Path != m_files[i].Path)
+		{
+			files.push_back(&m_files[i]);
+		}
+	}
+
+	struct ChunkRef
+	{
+		UINT File = 0u;
+		UINT Chunk = 0u;
+	};
+
+	std::vector<std::vector<std::vector<uint8_t>>> compressedChunks(files.size());
+	std::vector<ChunkRef> chunkRefs;
+	for (UINT i = 0; i < (UINT)files.size(); ++i)
+	{
+		if (files[i]->bCompress)
+		{
+			const UINT numChunks = (UINT)GetNumChunks(files[i]->Data.size(), m_chunkSize);
+			compressedChunks[i].resize(numChunks);
+			for (UINT chunk = 0; chunk < numChunks; ++chunk)
+			{
+				chunkRefs.push_back({ i, chunk });
+			}
+		}
+	}
+
+	JobSystem::Get().ParallelFor((UINT)chunkRefs.size(), 1u, [&](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; ++i)
+			{
+				const std::vector<uint8_t>& data = files[chunkRefs[i].File]->Data;
+				const size_t offset = (size_t)chunkRefs[i].Chunk * m_chunkSize;
+				const size_t size = std::min<size_t>(m_chunkSize, data.size() - offset);
+
+				std::vector<uint8_t>& compressed = compressedChunks[chunkRefs[i].File][chunkRefs[i].Chunk];
+				compressed.resize(LZ4Block::GetMaxCompressedSize(size));
+				// 0 (did not fit) or no gain leaves the chunk empty, it is stored raw.
+				const size_t compressedSize = LZ4Block::Compress(data.data() + offset, size, compressed.data(), compressed.size());
+				compressed.resize(compressedSize < size ? compressedSize : 0u);
+			}
+		});
+
+	std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		return false;
+	}
+
+	UINT64 position = 0u;
+	auto WriteBytes = [&out, &position](const void* pData, UINT64 size)
+		{
+			out.write(static_cast<const char*>(pData), (std::streamsize)size);
+			position += size;
+		};
+	auto PadTo = [&out, &position](UINT64 alignment)
+		{
+			static const char zeros[AssetArchive::EntryAlignment] = {};
+			const UINT64 padding = AlignUp(position, alignment) - position;
+			out.write(zeros, (std::streamsize)padding);
+			position += padding;
+		};
+
+	AssetArchiveHeader header;
+	header.NumEntries = (UINT)files.size();
+	header.ChunkSize = m_chunkSize;
+	WriteBytes(&header, sizeof(header));
+
+	std::vector<AssetArchiveEntry> entries(files.size());
+	std::string paths;
+	for (UINT i = 0; i < (UINT)files.size(); ++i)
+	{
+		const PendingFile& file = *files[i];
+		AssetArchiveEntry& entry = entries[i];
+		entry.PathHash = AssetArchive::HashPath(file.Path);
+		entry.Size = file.Data.size();
+		entry.PathOffset = (UINT32)paths.size();
+		entry.PathLength = (UINT32)file.Path.size();
+		paths += file.Path;
+
+		std::vector<UINT32> chunkSizes;
+		UINT64 compressedSize = 0u;
+		for (const std::vector<uint8_t>& chunk : compressedChunks[i])
+		{
+			const UINT64 rawSize = std::min<UINT64>(m_chunkSize, entry.Size - chunkSizes.size() * (UINT64)m_chunkSize);
+			chunkSizes.push_back(chunk.empty() ? (UINT32)rawSize | AssetArchiveEntry::StoredRawChunkBit : (UINT32)chunk.size());
+			compressedSize += chunk.empty() ? rawSize : chunk.size();
+		}
+		compressedSize += chunkSizes.size() * sizeof(UINT32);
+
+		// Stored entries are zero copy, compression has to be worth the decompression.
+		const bool bIsCompressed = !chunkSizes.empty() && compressedSize <= entry.Size - entry.Size / 8u;
+
+		PadTo(AssetArchive::EntryAlignment);
+		entry.Offset = position;
+		if (bIsCompressed)
+		{
+			entry.Flags |= AssetArchiveEntry::CompressedFlag;
+			entry.NumChunks = (UINT32)chunkSizes.size();
+			entry.StoredSize = compressedSize;
+
+			WriteBytes(chunkSizes.data(), chunkSizes.size() * sizeof(UINT32));
+			for (UINT chunk = 0; chunk < entry.NumChunks; ++chunk)
+			{
+				if (chunkSizes[chunk] & AssetArchiveEntry::StoredRawChunkBit)
+				{
+					WriteBytes(file.Data.data() + (size_t)chunk * m_chunkSize, chunkSizes[chunk] & ~AssetArchiveEntry::StoredRawChunkBit);
+				}
+				else
+				{
+					WriteBytes(compressedChunks[i][chunk].data(), compressedChunks[i][chunk].size());
+				}
+			}
+		}
+		else
+		{
+			entry.StoredSize = entry.Size;
+			WriteBytes(file.Data.data(), file.Data.size());
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), [&paths](const AssetArchiveEntry& a, const AssetArchiveEntry& b)
+		{
+			return a.PathHash != b.PathHash ? a.PathHash < b.PathHash : paths.compare(a.PathOffset, a.PathLength, paths, b.PathOffset, b.PathLength) < 0;
+		});
+
+	PadTo(alignof(AssetArchiveEntry));
+	header.TocOffset = position;
+	WriteBytes(entries.data(), entries.size() * sizeof(AssetArchiveEntry));
+
+	header.PathsOffset = position;
+	header.PathsSize = paths.size();
+	WriteBytes(paths.data(), paths.size());
+
+	out.seekp(0, std::ios::beg);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	return out.good();
+}
+
+bool AssetArchiveWriter::PackDirectory(const std::filesystem::path& directory, const std::filesystem::path& archiveName)
+{
+	AssetArchiveWriter writer;
+	return writer.AddDirectory(directory) && writer.Write(archiveName);
+}
+
+#pragma endregion AssetArchiveWriter
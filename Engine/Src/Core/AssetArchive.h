@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+
+#include <filesystem>
+#include <string_view>
+
+// Packed assets. Layout of the file:
+//   AssetArchiveHeader, padded to EntryAlignment
+//   entry data, every entry starts EntryAlignment aligned, entries are sorted by path, so files of a directory are adjacent
+//   AssetArchiveEntry table sorted by PathHash, then the paths (not null terminated)
+//
+// Stored entries are the file contents as is, so they can be used straight from the mapped file.
+// Compressed entries start with a UINT32 per chunk holding its stored size (StoredRawChunkBit set for chunks kept uncompressed),
+// followed by the LZ4 blocks of ChunkSize bytes of the file each, which decompress independently of each other.
+struct AssetArchiveHeader
+{
+	static constexpr UINT32 MagicValue = 0x4B415053u; // "SPAK"
+	static constexpr UINT32 CurrentVersion = 1u;
+
+	UINT32 Magic = MagicValue;
+	UINT32 Version = CurrentVersion;
+	UINT32 NumEntries = 0u;
+	UINT32 ChunkSize = 0u;
+	UINT64 TocOffset = 0u;
+	UINT64 PathsOffset = 0u;
+	UINT64 PathsSize = 0u;
+};
+
+struct AssetArchiveEntry
+{
+	static constexpr UINT32 CompressedFlag = 1u << 0u;
+	static constexpr UINT32 StoredRawChunkBit = 1u << 31u;
+
+	UINT64 PathHash = 0u;
+	UINT64 Offset = 0u;
+	// Size of the file and the bytes it takes in the archive.
+	UINT64 Size = 0u;
+	UINT64 StoredSize = 0u;
+	// Relative to AssetArchiveHeader::PathsOffset.
+	UINT32 PathOffset = 0u;
+	UINT32 PathLength = 0u;
+	UINT32 NumChunks = 0u;
+	UINT32 Flags = 0u;
+
+	FORCEINLINE bool IsCompressed() const { return (Flags & CompressedFlag) != 0u; }
+};
+
+// Read only view of an archive. The whole file is memory mapped (MapViewOfFile on Windows, mmap elsewhere),
+// opening it reads nothing but the table of contents. Find and the reads are thread safe.
+class AssetArchive
+{
+public:
+	static constexpr UINT64 EntryAlignment = 4096u;
+
+	AssetArchive() = default;
+	AssetArchive(const AssetArchive& lhs) = delete;
+	AssetArchive& operator=(const AssetArchive& lhs) = delete;
+
+	~AssetArchive();
+
+	// Returns false if the file is missing or is not a valid archive.
+	bool Open(const std::filesystem::path& fileName);
+	void Close();
+
+	FORCEINLINE bool IsOpen() const { return m_pData != nullptr; }
+
+	// Paths are matched after NormalizePath, so "./Assets\\Textures/Stone.dds" finds "assets/textures/stone.dds".
+	const AssetArchiveEntry* Find(const std::filesystem::path& path) const;
+
+	// Contents of a stored entry in place, nullptr for compressed ones. Valid until the archive is closed.
+	const uint8_t* GetMappedData(const AssetArchiveEntry& entry) const;
+	// Writes entry.Size bytes to pDst, the chunks are decompressed in parallel on the job system. Fails on corrupt data.
+	bool Read(const AssetArchiveEntry& entry, uint8_t* pDst) const;
+	// Mapped data of stored entries, otherwise the entry is decompressed into outStorage. nullptr on corrupt data.
+	const uint8_t* Load(const AssetArchiveEntry& entry, std::unique_ptr<uint8_t[]>& outStorage) const;
+
+	std::string_view GetPath(const AssetArchiveEntry& entry) const;
+	FORCEINLINE const AssetArchiveEntry* GetEntries() const { return m_pEntries; }
+	FORCEINLINE UINT GetNumEntries() const { return m_pHeader ? m_pHeader->NumEntries : 0u; }
+
+public:
+	// Lexically normal, forward slashes, lower case ASCII.
+	static std::string NormalizePath(const std::filesystem::path& path);
+	// FNV-1a of the normalized path.
+	static UINT64 HashPath(std::string_view normalizedPath);
+
+private:
+	// Points the header and table of contents into the mapping, if they describe a well formed archive.
+	bool Validate();
+
+private:
+	const uint8_t* m_pData = nullptr;
+	UINT64 m_size = 0u;
+
+	const AssetArchiveHeader* m_pHeader = nullptr;
+	const AssetArchiveEntry* m_pEntries = nullptr;
+	const char* m_pPaths = nullptr;
+};
+
+// Builds archives offline. Entries are compressed in parallel when the archive is written, those which
+// do not shrink by at least 1/8 are stored instead, so they stay readable in place.
+class AssetArchiveWriter
+{
+public:
+	static constexpr UINT DefaultChunkSize = 64u * 1024u;
+
+	AssetArchiveWriter(UINT chunkSize = DefaultChunkSize);
+	AssetArchiveWriter(const AssetArchiveWriter& lhs) = delete;
+	AssetArchiveWriter& operator=(const AssetArchiveWriter& lhs) = delete;
+
+	~AssetArchiveWriter() noexcept = default;
+
+	// The path is normalized, it is how the file is found later. A path added twice keeps the last data.
+	void AddFile(const std::filesystem::path& path, std::vector<uint8_t> data, bool bCompress = true);
+	// Returns false if a file cannot be read.
+	bool AddDirectory(const std::filesystem::path& directory, bool bCompress = true);
+
+	// Returns false if the file cannot be written.
+	bool Write(const std::filesystem::path& fileName);
+
+	// Offline packer: packs every file under directory into archiveName, keeping the paths as they are
+	// referenced from the working directory, e.g. PackDirectory("./Assets", "Assets.pak") stores "assets/textures/stone.dds".
+	static bool PackDirectory(const std::filesystem::path& directory, const std::filesystem::path& archiveName);
+
+private:
+	struct PendingFile
+	{
+		std::string Path;
+		std::vector<uint8_t> Data;
+		bool bCompress = true;
+	};
+
+	UINT m_chunkSize;
+	std::vector<PendingFile> m_files;
+};
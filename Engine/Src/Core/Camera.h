@@ -18,6 +18,7 @@ public:
 
 	FORCEINLINE float GetNearZ() const { return m_nearZ; }
 	FORCEINLINE float GetFarZ() const { return m_farZ; }
+	FORCEINLINE float GetAspectRatio() const { return m_aspectRatio; }
 
 	float GetFovYRad() const;
 	float GetFovXRad() const;
@@ -0,0 +1,48 @@
+#include "CascadeFitting.h"
+
+CascadeFit XM_CALLCONV CascadeFitting::Fit(FXMMATRIX invView, FXMVECTOR lightDir, float tanHalfFovY, float aspectRatio, float nearZ, float farZ, UINT mapWidth, UINT mapHeight)
+{
+	// Squared slope of the frustum corner edges, corners at depth z are at distance z * sqrt(k2) from the view axis.
+	const float tanHalfFovX = tanHalfFovY * aspectRatio;
+	const float k2 = tanHalfFovX * tanHalfFovX + tanHalfFovY * tanHalfFovY;
+
+	// Center of the sphere equidistant from near and far corners lies on the view axis.
+	// For wide slices it goes past the far plane, then far corners alone bound the slice.
+	float centerZ = 0.5f * (nearZ + farZ) * (1.0f + k2);
+	float radius = 0.0f;
+	if (centerZ >= farZ)
+	{
+		centerZ = farZ;
+		radius = farZ * sqrtf(k2);
+	}
+	else
+	{
+		radius = sqrtf((farZ - centerZ) * (farZ - centerZ) + farZ * farZ * k2);
+	}
+
+	// Round radius up, so float noise doesn't change projection size between frames.
+	radius = ceilf(radius * 16.0f) / 16.0f;
+
+	const XMVECTOR center = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, centerZ, 1.0f), invView);
+
+	// Light looking straight down/up would make default up vector degenerate.
+	const XMVECTOR up = fabsf(XMVectorGetY(lightDir)) > 0.99f ? ScaldMath::ForwardVector : ScaldMath::UpVector;
+
+	const XMMATRIX lightView = XMMatrixLookAtLH(XMVectorSubtract(center, XMVectorScale(lightDir, radius)), center, up);
+	// Casters between the light and the near plane are pancaked by depth clamping in the shadow pass.
+	XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+
+	// Snap to shadow map texels: move projection, so world origin always projects onto a texel corner.
+	const XMVECTOR halfMapSize = XMVectorSet(0.5f * mapWidth, 0.5f * mapHeight, 1.0f, 1.0f);
+	XMVECTOR shadowOrigin = XMVector3TransformCoord(XMVectorZero(), XMMatrixMultiply(lightView, lightProj));
+	shadowOrigin = XMVectorMultiply(shadowOrigin, halfMapSize);
+	XMVECTOR offset = XMVectorDivide(XMVectorSubtract(XMVectorRound(shadowOrigin), shadowOrigin), halfMapSize);
+	offset = XMVectorSelect(XMVectorZero(), offset, XMVectorSelectControl(1u, 1u, 0u, 0u));
+	lightProj.r[3] = XMVectorAdd(lightProj.r[3], offset);
+
+	CascadeFit fit;
+	XMStoreFloat4x4(&fit.View, lightView);
+	XMStoreFloat4x4(&fit.Proj, lightProj);
+	fit.Radius = radius;
+	return fit;
+}
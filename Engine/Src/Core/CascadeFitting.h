@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Common/ScaldMath.h"
+
+// Light space matrices of a shadow cascade
+struct CascadeFit
+{
+	XMFLOAT4X4 View;
+	XMFLOAT4X4 Proj;
+	// Half extent of the orthographic projection, in world units.
+	float Radius = 0.0f;
+};
+
+// Device independent part of CascadeShadowMap, fits a cascade to a slice of the camera frustum.
+class CascadeFitting
+{
+public:
+	// Fits cascade into bounding sphere of the [nearZ, farZ] camera frustum slice.
+	// Sphere radius doesn't depend on camera orientation, so projection size is constant and can be snapped to texels
+	// of a mapWidth x mapHeight shadow map: world space texel grid stays put while the camera moves.
+	static CascadeFit XM_CALLCONV Fit(FXMMATRIX invView, FXMVECTOR lightDir, float tanHalfFovY, float aspectRatio, float nearZ, float farZ, UINT mapWidth, UINT mapHeight);
+};
@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "CascadeShadowMap.h"
+#include "CascadeFitting.h"
+#include "Camera.h"
 
 CascadeShadowMap::CascadeShadowMap(ID3D12Device* device, UINT width, UINT height, UINT cascadesCount)
 	: ShadowMap(device, width, height, cascadesCount)
@@ -11,6 +13,63 @@ CascadeShadowMap::~CascadeShadowMap() noexcept
 {
 }
 
+bool CascadeShadowMap::Update(const Camera& camera, const XMFLOAT3& lightDir)
+{
+	XMFLOAT4X4 cameraView;
+	XMStoreFloat4x4(&cameraView, camera.GetViewMatrix());
+
+	const bool bFrustumChanged = camera.GetNearZ() != m_cachedNearZ || camera.GetFarZ() != m_cachedFarZ;
+	const bool bProjectionChanged = bFrustumChanged || camera.GetFovYRad() != m_cachedFovYRad || camera.GetAspectRatio() != m_cachedAspectRatio;
+	const bool bViewChanged = memcmp(&cameraView, &m_cachedCameraView, sizeof(XMFLOAT4X4)) != 0;
+	const bool bLightChanged = memcmp(&lightDir, &m_cachedLightDir, sizeof(XMFLOAT3)) != 0;
+
+	if (m_bCascadesFitted && !bProjectionChanged && !bViewChanged && !bLightChanged)
+	{
+		return false;
+	}
+
+	if (!m_bCascadesFitted || bFrustumChanged)
+	{
+		CreateShadowCascadeSplits(camera.GetNearZ(), camera.GetFarZ());
+	}
+
+	const XMMATRIX view = XMLoadFloat4x4(&cameraView);
+	XMVECTOR det = XMMatrixDeterminant(view);
+	const XMMATRIX invView = XMMatrixInverse(&det, view);
+
+	const XMVECTOR lightDirection = XMVector3Normalize(XMLoadFloat3(&lightDir));
+	const float tanHalfFovY = tanf(0.5f * camera.GetFovYRad());
+
+	for (UINT i = 0; i < MaxCascades; ++i)
+	{
+		const float nearZ = (i == 0u) ? camera.GetNearZ() : m_shadowCascadeLevels[i - 1u];
+		const CascadeFit fit = CascadeFitting::Fit(invView, lightDirection, tanHalfFovY, camera.GetAspectRatio(), nearZ, m_shadowCascadeLevels[i], m_mapWidth, m_mapHeight);
+		m_cascadeView[i] = fit.View;
+		m_cascadeProj[i] = fit.Proj;
+	}
+
+	m_cachedCameraView = cameraView;
+	m_cachedLightDir = lightDir;
+	m_cachedFovYRad = camera.GetFovYRad();
+	m_cachedAspectRatio = camera.GetAspectRatio();
+	m_cachedNearZ = camera.GetNearZ();
+	m_cachedFarZ = camera.GetFarZ();
+	m_bCascadesFitted = true;
+
+	return true;
+}
+
+void CascadeShadowMap::PlaceResource(ID3D12Heap* pHeap, UINT64 heapOffset)
+{
+	assert(pHeap);
+
+	m_heap = pHeap;
+	m_heapOffset = heapOffset;
+
+	CreateResource();
+	CreateDescriptors();
+}
+
 void CascadeShadowMap::CreateDescriptors()
 {
 	// Create SRV to resource so we can sample the shadow map in a shader program.
@@ -60,11 +119,24 @@ void CascadeShadowMap::CreateResource()
 	optClear.DepthStencil.Depth = 1.0f;
 	optClear.DepthStencil.Stencil = (UINT8)0;
 
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&textureDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		&optClear,
-		IID_PPV_ARGS(&m_shadowMap)));
+	if (m_heap)
+	{
+		ThrowIfFailed(m_device->CreatePlacedResource(
+			m_heap,
+			m_heapOffset,
+			&textureDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			&optClear,
+			IID_PPV_ARGS(&m_shadowMap)));
+	}
+	else
+	{
+		ThrowIfFailed(m_device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&textureDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			&optClear,
+			IID_PPV_ARGS(&m_shadowMap)));
+	}
 }
@@ -2,6 +2,8 @@
 
 #include "ShadowMap.h"
 
+class Camera;
+
 class CascadeShadowMap : public ShadowMap
 {
 public:
@@ -11,8 +13,37 @@ public:
 
 	virtual ~CascadeShadowMap() noexcept override;
 
+public:
+	// Refits cascades to the camera frustum slices, if camera or light direction have changed since the last call.
+	// Returns true if cascades have been refitted.
+	bool Update(const Camera& camera, const XMFLOAT3& lightDir);
+
+	FORCEINLINE XMMATRIX GetCascadeView(UINT cascade) const { return XMLoadFloat4x4(&m_cascadeView[cascade]); }
+	FORCEINLINE XMMATRIX GetCascadeProj(UINT cascade) const { return XMLoadFloat4x4(&m_cascadeProj[cascade]); }
+	FORCEINLINE XMMATRIX GetCascadeViewProj(UINT cascade) const { return GetCascadeView(cascade) * GetCascadeProj(cascade); }
+
+	// Recreates the cascades' array as a placed resource in the heap, which has to outlive it.
+	void PlaceResource(ID3D12Heap* pHeap, UINT64 heapOffset);
+
 protected:
 	virtual void CreateDescriptors() override;
 private:
 	void CreateResource();
-};
\ No newline at end of file
+
+private:
+	XMFLOAT4X4 m_cascadeView[MaxCascades];
+	XMFLOAT4X4 m_cascadeProj[MaxCascades];
+
+	// State cascades were fitted with
+	XMFLOAT4X4 m_cachedCameraView = {};
+	XMFLOAT3 m_cachedLightDir = { 0.0f, 0.0f, 0.0f };
+	float m_cachedFovYRad = 0.0f;
+	float m_cachedAspectRatio = 0.0f;
+	float m_cachedNearZ = 0.0f;
+	float m_cachedFarZ = 0.0f;
+	bool m_bCascadesFitted = false;
+
+	// Committed resource if null
+	ID3D12Heap* m_heap = nullptr;
+	UINT64 m_heapOffset = 0u;
+};
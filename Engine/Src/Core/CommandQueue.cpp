@@ -51,6 +51,16 @@ bool CommandQueue::IsFenceComplete(UINT64 fenceValue) const
     return fenceValue <= m_fence->GetCompletedValue();
 }
 
+UINT64 CommandQueue::GetCompletedFenceValue() const
+{
+    return m_fence->GetCompletedValue();
+}
+
+UINT64 CommandQueue::GetLastSignaledFenceValue() const
+{
+    return m_fenceValue;
+}
+
 void CommandQueue::WaitForFenceValue(UINT64 fenceValue)
 {
     if (!IsFenceComplete(fenceValue))
@@ -64,6 +74,11 @@ void CommandQueue::WaitForFenceValue(UINT64 fenceValue)
     }
 }
 
+void CommandQueue::Wait(const CommandQueue& other, UINT64 fenceValue)
+{
+    ThrowIfFailed(m_commandQueue->Wait(other.m_fence.Get(), fenceValue));
+}
+
 void CommandQueue::Flush()
 {
     WaitForFenceValue(Signal());
@@ -117,6 +132,22 @@ void CommandQueue::ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList2> command
     m_commandListQueue.push(commandList);
 }
 
+void CommandQueue::ExecuteCommandLists(const ComPtr<ID3D12GraphicsCommandList2>* pCommandLists, UINT numCommandLists)
+{
+    std::vector<ID3D12CommandList*> ppCommandLists(numCommandLists);
+    for (UINT i = 0; i < numCommandLists; ++i)
+    {
+        ThrowIfFailed(pCommandLists[i]->Close());
+        ppCommandLists[i] = pCommandLists[i].Get();
+    }
+    m_commandQueue->ExecuteCommandLists(numCommandLists, ppCommandLists.data());
+
+    for (UINT i = 0; i < numCommandLists; ++i)
+    {
+        m_commandListQueue.push(pCommandLists[i]);
+    }
+}
+
 ComPtr<ID3D12CommandQueue> CommandQueue::GetCommandQueue() const
 {
     return m_commandQueue;
@@ -17,10 +17,16 @@ public:
 
     // Execute a command list.
     void ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList2> cmdList);
+    // Execute several command lists in a single submission, in the given order.
+    void ExecuteCommandLists(const ComPtr<ID3D12GraphicsCommandList2>* pCommandLists, UINT numCommandLists);
 
     UINT64 Signal();
     bool IsFenceComplete(UINT64 fenceValue) const;
+    UINT64 GetCompletedFenceValue() const;
+    UINT64 GetLastSignaledFenceValue() const;
     void WaitForFenceValue(UINT64 fenceValue);
+    // GPU side wait: work submitted to this queue afterwards starts once other queue reaches fenceValue.
+    void Wait(const CommandQueue& other, UINT64 fenceValue);
     void Flush();
 
     ComPtr<ID3D12CommandQueue> GetCommandQueue() const;
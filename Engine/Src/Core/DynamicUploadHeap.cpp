@@ -0,0 +1,32 @@
+#include "stdafx.h"
+#include "DynamicUploadHeap.h"
+
+static_assert(DynamicUploadRing::DefaultAlignment == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+static_assert(std::is_same_v<D3D12_GPU_VIRTUAL_ADDRESS, UINT64>);
+
+DynamicUploadHeap::DynamicUploadHeap(ID3D12Device* device, UINT64 capacity)
+{
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(capacity),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_uploadHeap)));
+	SCALD_NAME_D3D12_OBJECT(m_uploadHeap, L"Dynamic Upload Heap");
+
+	// We do not need to unmap until we are done with the resource.
+	BYTE* mappedData = nullptr;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(m_uploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&mappedData)));
+
+	m_ring = std::make_unique<DynamicUploadRing>(mappedData, m_uploadHeap->GetGPUVirtualAddress(), capacity);
+}
+
+DynamicUploadHeap::~DynamicUploadHeap() noexcept
+{
+	if (m_uploadHeap)
+	{
+		m_uploadHeap->Unmap(0, nullptr);
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Common/DXHelper.h"
+#include "DynamicUploadRing.h"
+
+using namespace Microsoft::WRL;
+
+// Persistently mapped upload heap, which hands out transient per-frame memory for constant and structured buffers.
+// Memory is valid until the fence value of the frame it was allocated in is completed.
+class DynamicUploadHeap
+{
+public:
+	DynamicUploadHeap(ID3D12Device* device, UINT64 capacity);
+	DynamicUploadHeap(const DynamicUploadHeap& lhs) = delete;
+	DynamicUploadHeap& operator=(const DynamicUploadHeap& lhs) = delete;
+
+	~DynamicUploadHeap() noexcept;
+
+public:
+	FORCEINLINE DynamicAllocation Allocate(UINT64 size, UINT64 alignment = DynamicUploadRing::DefaultAlignment) { return m_ring->Allocate(size, alignment); }
+
+	template<typename T>
+	D3D12_GPU_VIRTUAL_ADDRESS AllocateConstants(const T& data)
+	{
+		return m_ring->AllocateConstants(data);
+	}
+
+	FORCEINLINE void FinishFrame(UINT64 fenceValue) { m_ring->FinishFrame(fenceValue); }
+	FORCEINLINE void ReleaseCompletedFrames(UINT64 completedFenceValue) { m_ring->ReleaseCompletedFrames(completedFenceValue); }
+
+private:
+	ComPtr<ID3D12Resource> m_uploadHeap;
+	// Sub-allocates the mapped heap
+	std::unique_ptr<DynamicUploadRing> m_ring;
+};
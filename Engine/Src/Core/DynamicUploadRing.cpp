@@ -0,0 +1,27 @@
+#include "DynamicUploadRing.h"
+
+#include <stdexcept>
+
+DynamicUploadRing::DynamicUploadRing(BYTE* mappedData, UINT64 gpuAddress, UINT64 capacity)
+	: m_mappedData(mappedData)
+	, m_gpuAddress(gpuAddress)
+	, m_allocator(capacity)
+{
+}
+
+DynamicAllocation DynamicUploadRing::Allocate(UINT64 size, UINT64 alignment)
+{
+	const UINT64 offset = m_allocator.Allocate(size, alignment);
+
+	// Frames in flight use the whole ring, it has to be created bigger.
+	if (offset == LinearAllocator::InvalidOffset)
+	{
+		throw std::runtime_error("Dynamic upload ring is out of memory");
+	}
+
+	DynamicAllocation allocation;
+	allocation.CpuAddress = m_mappedData + offset;
+	allocation.GpuAddress = m_gpuAddress + offset;
+	allocation.Size = size;
+	return allocation;
+}
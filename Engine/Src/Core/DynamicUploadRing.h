@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+#include "LinearAllocator.h"
+
+#include <cstring>
+
+struct DynamicAllocation
+{
+	void* CpuAddress = nullptr;
+	// D3D12_GPU_VIRTUAL_ADDRESS
+	UINT64 GpuAddress = 0u;
+	UINT64 Size = 0u;
+};
+
+// Transient per-frame sub-allocations of persistently mapped memory, which is owned by the caller (see DynamicUploadHeap).
+// Memory is valid until the fence value of the frame it was allocated in is completed.
+class DynamicUploadRing
+{
+public:
+	// D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, which suits root SRVs too.
+	static constexpr UINT64 DefaultAlignment = 256u;
+
+public:
+	DynamicUploadRing(BYTE* mappedData, UINT64 gpuAddress, UINT64 capacity);
+	DynamicUploadRing(const DynamicUploadRing& lhs) = delete;
+	DynamicUploadRing& operator=(const DynamicUploadRing& lhs) = delete;
+
+	~DynamicUploadRing() noexcept = default;
+
+public:
+	// Throws if frames in flight use the whole ring.
+	DynamicAllocation Allocate(UINT64 size, UINT64 alignment = DefaultAlignment);
+
+	template<typename T>
+	UINT64 AllocateConstants(const T& data)
+	{
+		DynamicAllocation allocation = Allocate(sizeof(T));
+		memcpy(allocation.CpuAddress, &data, sizeof(T));
+		return allocation.GpuAddress;
+	}
+
+	FORCEINLINE void FinishFrame(UINT64 fenceValue) { m_allocator.FinishFrame(fenceValue); }
+	FORCEINLINE void ReleaseCompletedFrames(UINT64 completedFenceValue) { m_allocator.ReleaseCompletedFrames(completedFenceValue); }
+
+	FORCEINLINE UINT64 GetCapacity() const { return m_allocator.GetCapacity(); }
+	FORCEINLINE UINT64 GetUsedSize() const { return m_allocator.GetUsedSize(); }
+
+private:
+	BYTE* m_mappedData = nullptr;
+	UINT64 m_gpuAddress = 0u;
+
+	LinearAllocator m_allocator;
+};
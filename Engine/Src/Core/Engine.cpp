@@ -4,8 +4,14 @@
 #include "GameFramework/Components/Scene.h"
 #include "GameFramework/Components/Transform.h"
 #include "GameFramework/Components/Renderer.h"
+#include "GameFramework/Components/TransformSystem.h"
 #include "CommandQueue.h"
+#include "JobSystem.h"
+#include "MeshSimplifier.h"
+#include "VertexCompression.h"
+#include "LightUploadBuffer.h"
 #include <imgui_impl_dx12.h>
+#include <algorithm>
 
 extern const int gNumFrameResources;
 
@@ -26,6 +32,8 @@ Engine::~Engine()
 
 void Engine::OnInit()
 {
+    JobSystem::Get().Init();
+
     LoadPipeline();
 
     LoadGraphicsFeatures();
@@ -33,12 +41,6 @@ void Engine::OnInit()
     LoadAssets();
 }
 
-void Engine::TransitionResource(ID3D12GraphicsCommandList* pCommandList, ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
-{
-    auto transition = CD3DX12_RESOURCE_BARRIER::Transition(pResource, stateBefore, stateAfter);
-    pCommandList->ResourceBarrier(1u, &transition);
-}
-
 // Load the rendering pipeline dependencies.
 VOID Engine::LoadPipeline()
 {
@@ -53,8 +55,8 @@ VOID Engine::LoadGraphicsFeatures()
 
 VOID Engine::LoadCSMResources()
 {
+    // Cascade splits are (re)computed by the cascade fitter, when camera frustum changes.
     m_cascadeShadowMap = std::make_unique<CascadeShadowMap>(m_device.Get(), 2048u, 2048u, MaxCascades);
-    m_cascadeShadowMap->CreateShadowCascadeSplits(m_camera->GetNearZ(), m_camera->GetFarZ());
 }
 
 VOID Engine::LoadDeferredRenderingResources()
@@ -68,18 +70,24 @@ VOID Engine::LoadAssets()
     auto commandList = m_commandQueue->GetCommandList(m_commandAllocator.Get());
 
     LoadScene();
-    LoadTextures(commandList.Get());
+    // Parsing runs on the workers while the rest of the assets are created
+    LoadTextures();
     CreateSrvAndSamplerDescriptorHeaps();
     CreateGeometry(commandList.Get());
     CreateGeometryMaterials();
     CreateRenderItems();
     CreatePointLights(commandList.Get());
+    CreateSpotLights(commandList.Get());
     CreateFrameResources();
     CreateRootSignature();
     CreateShaders();
     CreatePSO();
+    CreateRenderGraph(commandList.Get());
+    CreateRecordingPasses();
 
     m_commandQueue->ExecuteCommandList(commandList);
+    // Nothing references the texture descriptors yet, so wait for all of them here rather than patching the heap under in-flight frames.
+    m_textureLoader->Flush(*m_commandQueue);
     m_commandQueue->Flush();
 }
 
@@ -105,6 +113,7 @@ VOID Engine::CreateRootSignature()
     
     // Perfomance TIP: Order from most frequent to least frequent.
     slotRootParameter[ERootParameter::PerObjectDataCB   ].InitAsConstantBufferView(SHADER_REGISTER(0u), REGISTER_SPACE_0, D3D12_SHADER_VISIBILITY_ALL /* gMaterialIndex used in both shaders */);  // a root descriptor for objects' CBVs.
+    slotRootParameter[ERootParameter::PerDrawConstants  ].InitAsConstants(1u, SHADER_REGISTER(2u), REGISTER_SPACE_0, D3D12_SHADER_VISIBILITY_ALL);                                          // root constants changed per draw call (cascade mask)
     slotRootParameter[ERootParameter::PerPassDataCB     ].InitAsConstantBufferView(SHADER_REGISTER(1u), REGISTER_SPACE_0, D3D12_SHADER_VISIBILITY_ALL);                                            // a root descriptor for Pass CBV.
     slotRootParameter[ERootParameter::MaterialDataSB    ].InitAsShaderResourceView(SHADER_REGISTER(0u), REGISTER_SPACE_0, D3D12_SHADER_VISIBILITY_ALL /* gMaterialData used in both shaders */);   // a srv for structured buffer with materials' data
     slotRootParameter[ERootParameter::PointLightsDataSB ].InitAsShaderResourceView(SHADER_REGISTER(1u), REGISTER_SPACE_0, D3D12_SHADER_VISIBILITY_ALL /* gPointLights used in both shaders */);    // a srv for structured buffer with point lights' data
@@ -113,6 +122,8 @@ VOID Engine::CreateRootSignature()
     slotRootParameter[ERootParameter::GBufferTextures   ].InitAsDescriptorTable(1u, &gBufferTable, D3D12_SHADER_VISIBILITY_PIXEL);                                  // a descriptor table for GBuffer
     slotRootParameter[ERootParameter::SkyBox            ].InitAsDescriptorTable(1u, &skyBoxTable, D3D12_SHADER_VISIBILITY_PIXEL);                                   // a descriptor table for sky
     slotRootParameter[ERootParameter::Textures          ].InitAsDescriptorTable(1u, &textureTable, D3D12_SHADER_VISIBILITY_PIXEL);                                  // a descriptor table for diffuse textures
+    slotRootParameter[ERootParameter::ClusterLightRangesSB ].InitAsShaderResourceView(SHADER_REGISTER(3u), REGISTER_SPACE_0, D3D12_SHADER_VISIBILITY_PIXEL);            // a srv for structured buffer with lights' ranges of the clusters
+    slotRootParameter[ERootParameter::ClusterLightIndicesSB].InitAsShaderResourceView(SHADER_REGISTER(4u), REGISTER_SPACE_0, D3D12_SHADER_VISIBILITY_PIXEL);            // a srv for structured buffer with lights' indices of the clusters
 
     m_rootSignature->Create(m_device.Get(), ARRAYSIZE(slotRootParameter), slotRootParameter, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 }
@@ -121,47 +132,68 @@ VOID Engine::CreateShaders()
 {
     //auto pixelShaderPath = GetAssetFullPath(L"./PixelShader.hlsl").c_str();
 
-    const D3D_SHADER_MACRO fogDefines[] =
-    {
-        "FOG", "1",
-        NULL, NULL
-    };
+    // Packed shaders are compiled from the archive, see LoadTextures() for where it is opened.
+    m_shaderCache = std::make_unique<ShaderCache>(ShaderCacheDirectory, m_assetArchive.get());
+    m_shaderPermutations = std::make_unique<ShaderPermutations>([this](const ShaderCompileDesc& desc, std::vector<uint8_t>& outByteCode)
+        {
+            return ScaldUtil::CompileShader(desc, m_shaderCache.get(), outByteCode, m_assetArchive.get());
+        });
 
-    const D3D_SHADER_MACRO alphaTestDefines[] =
+    // Bit order matches EShaderFeature.
+    const std::vector<std::string> lightingFeatures = { "ALPHA_TEST", "FOG", "SHADOW_DEBUG" };
+
+    struct ShaderVariantDesc
     {
-        "ALPHA_TEST", "1",
-        "FOG", "1",
-        NULL, NULL
+        EShaderType Type;
+        const wchar_t* FileName;
+        const char* EntryPoint;
+        const char* Target;
+        const std::vector<std::string>* pFeatures;
+        UINT Features;
     };
 
-    const D3D_SHADER_MACRO shadowDebugDefines[] =
+    const ShaderVariantDesc shaderVariants[] =
     {
-        "SHADOW_DEBUG", "1",
-        NULL, NULL
-    };
+        { EShaderType::DefaultVS,               L"./Assets/Shaders/VertexShader.hlsl",                  "main",     "vs_5_1", nullptr,            0u },
+        { EShaderType::DefaultOpaquePS,         L"./Assets/Shaders/PixelShader.hlsl",                   "main",     "ps_5_1", &lightingFeatures,  EShaderFeature::Fog },
 
-    m_shaders[EShaderType::DefaultVS] = ScaldUtil::CompileShader(L"./Assets/Shaders/VertexShader.hlsl", nullptr, "main", "vs_5_1");
-    m_shaders[EShaderType::DefaultOpaquePS] = ScaldUtil::CompileShader(L"./Assets/Shaders/PixelShader.hlsl", fogDefines, "main", "ps_5_1");
+        { EShaderType::CascadedShadowsVS,       L"./Assets/Shaders/ShadowVertexShader.hlsl",            "main",     "vs_5_1", nullptr,            0u },
+        { EShaderType::CascadedShadowsGS,       L"./Assets/Shaders/GeometryShader.hlsl",                "main",     "gs_5_1", nullptr,            0u },
 
-    m_shaders[EShaderType::CascadedShadowsVS] = ScaldUtil::CompileShader(L"./Assets/Shaders/ShadowVertexShader.hlsl", nullptr, "main", "vs_5_1");
-    m_shaders[EShaderType::CascadedShadowsGS] = ScaldUtil::CompileShader(L"./Assets/Shaders/GeometryShader.hlsl", nullptr, "main", "gs_5_1");
+        // Deferred shading
+        { EShaderType::DeferredGeometryVS,      L"./Assets/Shaders/GBufferPassVS.hlsl",                 "main",     "vs_5_1", nullptr,            0u },
+        { EShaderType::DeferredGeometryPS,      L"./Assets/Shaders/GBufferPassPS.hlsl",                 "main",     "ps_5_1", nullptr,            0u },
 
-#pragma region DeferredShading
-    m_shaders[EShaderType::DeferredGeometryVS] = ScaldUtil::CompileShader(L"./Assets/Shaders/GBufferPassVS.hlsl", nullptr, "main", "vs_5_1");
-    m_shaders[EShaderType::DeferredGeometryPS] = ScaldUtil::CompileShader(L"./Assets/Shaders/GBufferPassPS.hlsl", nullptr, "main", "ps_5_1");
+        { EShaderType::DeferredDirVS,           L"./Assets/Shaders/DeferredDirectionalLightVS.hlsl",    "main",     "vs_5_1", nullptr,            0u },
+        { EShaderType::DeferredDirPS,           L"./Assets/Shaders/DeferredDirectionalLightPS.hlsl",    "main",     "ps_5_1", &lightingFeatures,  0u },
 
-    m_shaders[EShaderType::DeferredDirVS] = ScaldUtil::CompileShader(L"./Assets/Shaders/DeferredDirectionalLightVS.hlsl", nullptr, "main", "vs_5_1");
-    m_shaders[EShaderType::DeferredDirPS] = ScaldUtil::CompileShader(L"./Assets/Shaders/DeferredDirectionalLightPS.hlsl", nullptr, "main", "ps_5_1");
+        { EShaderType::DeferredLightVolumesVS,  L"./Assets/Shaders/LightVolumesVS.hlsl",                "main",     "vs_5_1", nullptr,            0u },
+        { EShaderType::DeferredLightQuadVS,     L"./Assets/Shaders/LightQuadVS.hlsl",                   "main",     "vs_5_1", nullptr,            0u },
+        { EShaderType::DeferredSpotLightVolumesVS, L"./Assets/Shaders/SpotLightVolumesVS.hlsl",         "main",     "vs_5_1", nullptr,            0u },
+        { EShaderType::DeferredPointPS,         L"./Assets/Shaders/DeferredPointLightPS.hlsl",          "main",     "ps_5_1", nullptr,            0u },
+        { EShaderType::DeferredClusteredPointPS,L"./Assets/Shaders/DeferredClusteredPointLightPS.hlsl", "main",     "ps_5_1", nullptr,            0u },
+        { EShaderType::DeferredSpotPS,          L"./Assets/Shaders/DeferredSpotLightPS.hlsl",           "main",     "ps_5_1", nullptr,            0u },
 
-    m_shaders[EShaderType::DeferredLightVolumesVS] = ScaldUtil::CompileShader(L"./Assets/Shaders/LightVolumesVS.hlsl", nullptr, "main", "vs_5_1");
-    m_shaders[EShaderType::DeferredPointPS] = ScaldUtil::CompileShader(L"./Assets/Shaders/DeferredPointLightPS.hlsl", nullptr, "main", "ps_5_1");
-    m_shaders[EShaderType::DeferredSpotPS] = ScaldUtil::CompileShader(L"./Assets/Shaders/DeferredSpotLightPS.hlsl", nullptr, "main", "ps_5_1");
-#pragma endregion DeferredShading
+        // Sky
+        { EShaderType::SkyBoxVS,                L"./Assets/Shaders/SkyBox.hlsl",                        "VSMain",   "vs_5_1", nullptr,            0u },
+        { EShaderType::SkyBoxPS,                L"./Assets/Shaders/SkyBox.hlsl",                        "PSMain",   "ps_5_1", nullptr,            0u },
+    };
 
-#pragma region Sky
-    m_shaders[EShaderType::SkyBoxVS] = ScaldUtil::CompileShader(L"./Assets/Shaders/SkyBox.hlsl", nullptr, "VSMain", "vs_5_1");
-    m_shaders[EShaderType::SkyBoxPS] = ScaldUtil::CompileShader(L"./Assets/Shaders/SkyBox.hlsl", nullptr, "PSMain", "ps_5_1");
-#pragma endregion Sky
+    UINT64 shaderKeys[EShaderType::NumShaders] = {};
+    for (const ShaderVariantDesc& variant : shaderVariants)
+    {
+        const auto shader = m_shaderPermutations->Declare(variant.FileName, variant.EntryPoint, variant.Target, variant.pFeatures ? *variant.pFeatures : std::vector<std::string>());
+        shaderKeys[variant.Type] = m_shaderPermutations->Require(shader, variant.Features);
+    }
+
+    // All of the variants at once, spread over the workers.
+    ThrowIfFailed(m_shaderPermutations->CompileRequired() ? S_OK : E_FAIL);
+
+    for (const ShaderVariantDesc& variant : shaderVariants)
+    {
+        const std::vector<uint8_t>* pByteCode = m_shaderPermutations->Find(shaderKeys[variant.Type]);
+        m_shaders[variant.Type] = ScaldUtil::CreateBlob(pByteCode->data(), pByteCode->size());
+    }
 }
 
 VOID Engine::CreatePSO()
@@ -173,7 +205,7 @@ VOID Engine::CreatePSO()
     defaultPsoDesc.SampleMask = UINT_MAX;
     defaultPsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     defaultPsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-    defaultPsoDesc.InputLayout = VertexPositionNormalTangentUV::InputLayout;
+    defaultPsoDesc.InputLayout = VertexInputLayout<VertexPositionNormalTangentUVPacked>::Desc;
     defaultPsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
     defaultPsoDesc.NumRenderTargets = 1u;
     defaultPsoDesc.RTVFormats[0] = BackBufferFormat;
@@ -195,7 +227,7 @@ VOID Engine::CreatePSO()
     cascadeShadowPsoDesc.RasterizerState.DepthBias = 10000;
     cascadeShadowPsoDesc.RasterizerState.DepthClipEnable = (BOOL)0.0f;
     cascadeShadowPsoDesc.RasterizerState.SlopeScaledDepthBias = 1.0f;
-    cascadeShadowPsoDesc.InputLayout = VertexPosition::InputLayout;
+    cascadeShadowPsoDesc.InputLayout = VertexInputLayout<VertexPositionPacked>::Desc;
     cascadeShadowPsoDesc.NumRenderTargets = 0u;
     cascadeShadowPsoDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
     ThrowIfFailed(m_device->CreateGraphicsPipelineState(&cascadeShadowPsoDesc, IID_PPV_ARGS(&m_pipelineStates[EPsoType::CascadedShadowsOpaque])));
@@ -247,7 +279,7 @@ VOID Engine::CreatePSO()
             reinterpret_cast<BYTE*>(m_shaders.at(EShaderType::DeferredDirPS)->GetBufferPointer()),
             m_shaders.at(EShaderType::DeferredDirPS)->GetBufferSize()
         });
-    dirLightPsoDesc.InputLayout = VertexPosition::InputLayout;
+    dirLightPsoDesc.InputLayout = VertexInputLayout<VertexPosition>::Desc;
     ThrowIfFailed(m_device->CreateGraphicsPipelineState(&dirLightPsoDesc, IID_PPV_ARGS(&m_pipelineStates[EPsoType::DeferredDirectional])));
 #pragma endregion DeferredDirectional
 
@@ -290,16 +322,48 @@ VOID Engine::CreatePSO()
     pointLightWithinFrustumPsoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
     ThrowIfFailed(m_device->CreateGraphicsPipelineState(&pointLightWithinFrustumPsoDesc, IID_PPV_ARGS(&m_pipelineStates[EPsoType::DeferredPointWithinFrustum])));
 
+    // Volumes clipped by both near and far planes, a quad per light bounded by its scissor rect
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC pointLightFullQuadPsoDesc = pointLightIntersectsFarPlanePsoDesc;
+    pointLightFullQuadPsoDesc.VS = D3D12_SHADER_BYTECODE(
+        {
+            reinterpret_cast<BYTE*>(m_shaders.at(EShaderType::DeferredLightQuadVS)->GetBufferPointer()),
+            m_shaders.at(EShaderType::DeferredLightQuadVS)->GetBufferSize()
+        });
+    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&pointLightFullQuadPsoDesc, IID_PPV_ARGS(&m_pipelineStates[EPsoType::DeferredPointFullQuad])));
+
+    // Full screen quad, every pixel only loops over the lights of its cluster
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC pointLightClusteredPsoDesc = dirLightPsoDesc;
+    pointLightClusteredPsoDesc.PS = D3D12_SHADER_BYTECODE(
+        {
+            reinterpret_cast<BYTE*>(m_shaders.at(EShaderType::DeferredClusteredPointPS)->GetBufferPointer()),
+            m_shaders.at(EShaderType::DeferredClusteredPointPS)->GetBufferSize()
+        });
+    pointLightClusteredPsoDesc.BlendState.RenderTarget[0] = RTBlendDesc;
+    pointLightClusteredPsoDesc.DepthStencilState.DepthEnable = FALSE;
+    pointLightClusteredPsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&pointLightClusteredPsoDesc, IID_PPV_ARGS(&m_pipelineStates[EPsoType::DeferredPointClustered])));
+
 #pragma endregion DeferredPointLight
 
 #pragma region DeferredSpotLight
+    // Cone proxies, front faces cover exactly the pixels of a cone in front of the near plane
     D3D12_GRAPHICS_PIPELINE_STATE_DESC spotLightPsoDesc = pointLightIntersectsFarPlanePsoDesc;
+    spotLightPsoDesc.VS = D3D12_SHADER_BYTECODE(
+        {
+            reinterpret_cast<BYTE*>(m_shaders.at(EShaderType::DeferredSpotLightVolumesVS)->GetBufferPointer()),
+            m_shaders.at(EShaderType::DeferredSpotLightVolumesVS)->GetBufferSize()
+        });
     spotLightPsoDesc.PS = D3D12_SHADER_BYTECODE(
         {
             reinterpret_cast<BYTE*>(m_shaders.at(EShaderType::DeferredSpotPS)->GetBufferPointer()),
             m_shaders.at(EShaderType::DeferredSpotPS)->GetBufferSize()
         });
     ThrowIfFailed(m_device->CreateGraphicsPipelineState(&spotLightPsoDesc, IID_PPV_ARGS(&m_pipelineStates[EPsoType::DeferredSpot])));
+
+    // Cones clipped by the near plane lose their front faces, back faces still cover them
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC spotLightInsideVolumePsoDesc = spotLightPsoDesc;
+    spotLightInsideVolumePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_FRONT;
+    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&spotLightInsideVolumePsoDesc, IID_PPV_ARGS(&m_pipelineStates[EPsoType::DeferredSpotInsideVolume])));
 #pragma endregion DeferredSpotLight
 
     // Transparent objects are drawn in forward rendering style
@@ -350,7 +414,7 @@ VOID Engine::CreatePSO()
     // fail the depth test if the depth buffer was cleared to 1.
     skyPsoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
     skyPsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; // Disable writing explicitly (Depth still enable)
-    skyPsoDesc.InputLayout = VertexPosition::InputLayout;
+    skyPsoDesc.InputLayout = VertexInputLayout<VertexPosition>::Desc;
     skyPsoDesc.VS =
     {
         reinterpret_cast<BYTE*>(m_shaders.at(EShaderType::SkyBoxVS)->GetBufferPointer()),
@@ -371,35 +435,53 @@ VOID Engine::LoadScene()
     m_scene = std::make_shared<Scald::Scene>();
 }
 
-VOID Engine::LoadTextures(ID3D12GraphicsCommandList* pCommandList)
+VOID Engine::LoadTextures()
 {
+    // Packed assets take precedence over the loose files, see AssetArchiveWriter::PackDirectory.
+    m_assetArchive = std::make_unique<AssetArchive>();
+    if (!m_assetArchive->Open(AssetArchiveFileName))
+    {
+        m_assetArchive.reset();
+    }
+
+    m_textureLoader = std::make_unique<TextureLoader>(m_device, m_assetArchive.get());
+    m_textureStreamer = std::make_unique<TextureStreamer>(TextureStreamingBudget);
+
     m_skyTextures.reserve(1); // only one cube map for now
     m_diffuseTextures.reserve(TextureMapsMaxCount);
     m_normalTextures.reserve(TextureMapsMaxCount);
 
-    auto brickTex = std::make_unique<Texture>("brickTex", L"./Assets/Textures/bricks.dds", m_device.Get(), pCommandList);
-    auto brickNTex = std::make_unique<Texture>("brickNTex", L"./Assets/Textures/bricks_nmap.dds", m_device.Get(), pCommandList, Texture::TextureType::NORMAL);
-    
-    auto grassTex = std::make_unique<Texture>("grassTex", L"./Assets/Textures/grass.dds", m_device.Get(), pCommandList);
-    auto iceTex = std::make_unique<Texture>("iceTex", L"./Assets/Textures/ice.dds", m_device.Get(), pCommandList);
-    auto stoneTex = std::make_unique<Texture>("stoneTex", L"./Assets/Textures/stone.dds", m_device.Get(), pCommandList);
-    auto planksTex = std::make_unique<Texture>("planksTex", L"./Assets/Textures/planks.dds", m_device.Get(), pCommandList);
-    
-    auto tileTex = std::make_unique<Texture>("tileTex", L"./Assets/Textures/tile.dds", m_device.Get(), pCommandList);
-    auto tileNTex = std::make_unique<Texture>("tileNTex", L"./Assets/Textures/tile_nmap.dds", m_device.Get(), pCommandList, Texture::TextureType::NORMAL);
-        
-    auto skyTex = std::make_unique<Texture>("skyTex", L"./Assets/Textures/snowcube1024.dds", m_device.Get(), pCommandList);
+    // Order defines the srv heap slots, so it has to match the material indices.
+    auto stoneTex = std::make_unique<Texture>("stoneTex", L"./Assets/Textures/stone.dds");
+    auto brickTex = std::make_unique<Texture>("brickTex", L"./Assets/Textures/bricks.dds");
+    auto grassTex = std::make_unique<Texture>("grassTex", L"./Assets/Textures/grass.dds");
+    auto planksTex = std::make_unique<Texture>("planksTex", L"./Assets/Textures/planks.dds");
+    auto tileTex = std::make_unique<Texture>("tileTex", L"./Assets/Textures/tile.dds");
+    auto iceTex = std::make_unique<Texture>("iceTex", L"./Assets/Textures/ice.dds");
+
+    auto brickNTex = std::make_unique<Texture>("brickNTex", L"./Assets/Textures/bricks_nmap.dds", Texture::TextureType::NORMAL);
+    auto tileNTex = std::make_unique<Texture>("tileNTex", L"./Assets/Textures/tile_nmap.dds", Texture::TextureType::NORMAL);
 
-    m_diffuseTextures[stoneTex->Name] = std::move(stoneTex);
-    m_diffuseTextures[brickTex->Name] = std::move(brickTex);
-    m_diffuseTextures[grassTex->Name] = std::move(grassTex);
-    m_diffuseTextures[planksTex->Name] = std::move(planksTex);
-    m_diffuseTextures[tileTex->Name] = std::move(tileTex);
-    m_diffuseTextures[iceTex->Name] = std::move(iceTex);
+    auto skyTex = std::make_unique<Texture>("skyTex", L"./Assets/Textures/snowcube1024.dds", Texture::TextureType::SKYCUBE);
 
-    m_normalTextures[brickNTex->Name] = std::move(brickNTex);
-    m_normalTextures[tileNTex->Name] = std::move(tileNTex);
+    // Heap start indices are known by the time the callbacks run
+    UINT slot = 0u;
+    for (auto* pTex : { &stoneTex, &brickTex, &grassTex, &planksTex, &tileTex, &iceTex })
+    {
+        m_textureLoader->Request(pTex->get(), [this, slot](Texture& tex) { RegisterStreamedTexture(tex, false, slot); }, true);
+        m_diffuseTextures[(*pTex)->Name] = std::move(*pTex);
+        ++slot;
+    }
 
+    slot = 0u;
+    for (auto* pTex : { &brickNTex, &tileNTex })
+    {
+        m_textureLoader->Request(pTex->get(), [this, slot](Texture& tex) { RegisterStreamedTexture(tex, true, slot); }, true);
+        m_normalTextures[(*pTex)->Name] = std::move(*pTex);
+        ++slot;
+    }
+
+    m_textureLoader->Request(skyTex.get(), [this](Texture& tex) { CreateTextureSrv(tex, m_skyCubeSrvHeapStartIndex); });
     m_skyTextures[skyTex->Name] = std::move(skyTex);
 }
 
@@ -464,172 +546,157 @@ VOID Engine::CreateSrvAndSamplerDescriptorHeaps()
     m_GBuffer->CreateDescriptors();
 
     m_skyCubeSrvHeapStartIndex = m_GBufferTexturesSrvHeapStartIndex + GBuffer::EGBufferLayer::MAX;
-    localHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, m_skyCubeSrvHeapStartIndex, m_cbvSrvUavDescriptorSize);
-    for (auto& e : m_skyTextures)
+    m_diffuseSrvHeapStartIndex = m_skyCubeSrvHeapStartIndex + (UINT)m_skyTextures.size();
+    m_normalSrvHeapStartIndex = m_diffuseSrvHeapStartIndex + TextureMapsMaxCount;
+    // Texture srvs are written by the texture loader callbacks, see LoadTextures().
+}
+
+VOID Engine::CreateTextureSrv(const Texture& texture, UINT heapIndex)
+{
+    auto& texD3DResource = texture.Resource;
+    const auto texDesc = texD3DResource->GetDesc();
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = texDesc.Format;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    if (texture.Type == Texture::TextureType::SKYCUBE)
     {
-        auto& texD3DResource = e.second->Resource;
-        srvDesc.Format = texD3DResource->GetDesc().Format;
         srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
         srvDesc.TextureCube.MostDetailedMip = 0u;
-        srvDesc.TextureCube.MipLevels = texD3DResource->GetDesc().MipLevels;
+        srvDesc.TextureCube.MipLevels = texDesc.MipLevels;
         srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
-        m_device->CreateShaderResourceView(texD3DResource.Get(), &srvDesc, localHandle);
-
-        localHandle.Offset(1, m_cbvSrvUavDescriptorSize);
     }
-
-    m_diffuseSrvHeapStartIndex = m_skyCubeSrvHeapStartIndex + (UINT)m_skyTextures.size();
-    localHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, m_diffuseSrvHeapStartIndex, m_cbvSrvUavDescriptorSize);
-    for (auto& e : m_diffuseTextures)
+    else
     {
-        auto& texD3DResource = e.second->Resource;
-        srvDesc.Format = texD3DResource->GetDesc().Format;
         srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
         srvDesc.Texture2D.MostDetailedMip = 0u;
-        srvDesc.Texture2D.MipLevels = texD3DResource->GetDesc().MipLevels;
-        srvDesc.Texture2D.PlaneSlice;
+        srvDesc.Texture2D.MipLevels = texDesc.MipLevels;
+        srvDesc.Texture2D.PlaneSlice = 0u;
         srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-        m_device->CreateShaderResourceView(texD3DResource.Get(), &srvDesc, localHandle);
-
-        localHandle.Offset(1, m_cbvSrvUavDescriptorSize);
     }
 
-    m_normalSrvHeapStartIndex = m_diffuseSrvHeapStartIndex + TextureMapsMaxCount;
-    localHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, m_normalSrvHeapStartIndex, m_cbvSrvUavDescriptorSize);
-    for (auto& e : m_normalTextures)
-    {
-        auto& texD3DResource = e.second->Resource;
-        srvDesc.Format = texD3DResource->GetDesc().Format;
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.Texture2D.MostDetailedMip = 0u;
-        srvDesc.Texture2D.MipLevels = texD3DResource->GetDesc().MipLevels;
-        srvDesc.Texture2D.PlaneSlice;
-        srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-        m_device->CreateShaderResourceView(texD3DResource.Get(), &srvDesc, localHandle);
-
-        localHandle.Offset(1, m_cbvSrvUavDescriptorSize);
-    }
+    m_device->CreateShaderResourceView(texD3DResource.Get(), &srvDesc,
+        CD3DX12_CPU_DESCRIPTOR_HANDLE(m_srvHeap->GetCPUDescriptorHandleForHeapStart(), heapIndex, m_cbvSrvUavDescriptorSize));
 }
 
-VOID Engine::CreateGeometry(ID3D12GraphicsCommandList* pCommandList)
+VOID Engine::RegisterStreamedTexture(Texture& texture, bool bIsNormalMap, UINT slot)
 {
-    auto sphereMesh = m_scene->GetBuiltInMesh(Scald::EBuiltInMeshes::SPHERE);
-    auto gridMesh = m_scene->GetBuiltInMesh(Scald::EBuiltInMeshes::GRID);
+    assert(slot < StreamingSrvSlotOffset && texture.SourceData);
+    CreateTextureSrv(texture, (bIsNormalMap ? m_normalSrvHeapStartIndex : m_diffuseSrvHeapStartIndex) + slot);
 
-    // Create shared vertex/index buffer for all geometry.
-    UINT sunVertexOffset = 0u;
-    UINT mercuryVertexOffset = sunVertexOffset + (UINT)sphereMesh.LODVertices[0].size();
-    UINT venusVertexOffset = mercuryVertexOffset + (UINT)sphereMesh.LODVertices[0].size();
-    UINT earthVertexOffset = venusVertexOffset + (UINT)sphereMesh.LODVertices[0].size();
-    UINT marsVertexOffset = earthVertexOffset + (UINT)sphereMesh.LODVertices[0].size();
-    UINT planeVertexOffset = marsVertexOffset + (UINT)sphereMesh.LODVertices[0].size();
-
-    UINT sunIndexOffset = 0u;
-    UINT mercuryIndexOffset = sunIndexOffset + (UINT)sphereMesh.LODIndices[0].size();
-    UINT venusIndexOffset = mercuryIndexOffset + (UINT)sphereMesh.LODIndices[0].size();
-    UINT earthIndexOffset = venusIndexOffset + (UINT)sphereMesh.LODIndices[0].size();
-    UINT marsIndexOffset = earthIndexOffset + (UINT)sphereMesh.LODIndices[0].size();
-    UINT planeIndexOffset = marsIndexOffset + (UINT)sphereMesh.LODIndices[0].size();
-
-    auto createSubmeshWithParams = [](const MeshData<>& mesh, const UINT indexOffset, const UINT vertexOffset) -> SubmeshGeometry
+    // Size of every mip over all array slices
+    const auto& data = *texture.SourceData;
+    std::vector<UINT64> mipByteSizes(data.MipCount, 0u);
+    for (size_t slice = 0; slice < data.ArraySize; ++slice)
+    {
+        for (size_t mip = 0; mip < data.MipCount; ++mip)
         {
-            SubmeshGeometry submesh;
-            submesh.IndexCount = (UINT)mesh.LODIndices[0].size();
-            submesh.StartIndexLocation = indexOffset;
-            submesh.BaseVertexLocation = vertexOffset;
-            submesh.Bounds = mesh.LODBounds[0];
-            return submesh;
-        };
+            mipByteSizes[mip] += data.Subresources[slice * data.MipCount + mip].SlicePitch * std::max<size_t>(data.Depth >> mip, 1u);
+        }
+    }
 
-    auto totalVertexCount = 
-        sphereMesh.LODVertices[0].size() // sun
-        + sphereMesh.LODVertices[0].size() // merc
-        + sphereMesh.LODVertices[0].size() // venus
-        + sphereMesh.LODVertices[0].size() //earth
-        + sphereMesh.LODVertices[0].size() //mars
-        + gridMesh.LODVertices[0].size() //mars
-        ;
-    auto totalIndexCount = 
-        sphereMesh.LODIndices[0].size()
-        + sphereMesh.LODIndices[0].size()
-        + sphereMesh.LODIndices[0].size()
-        + sphereMesh.LODIndices[0].size()
-        + sphereMesh.LODIndices[0].size()
-        + gridMesh.LODIndices[0].size()
-        ;
+    const UINT handle = m_textureStreamer->Register((UINT)data.Width, (UINT)data.Height, (UINT)data.MipCount, mipByteSizes.data());
+    assert(m_textureStreamer->GetFirstResidentMip(handle) == texture.FirstResidentMip && "Loader and streamer disagree on the mip tail");
 
-    std::vector<VertexPositionNormalTangentUV> vertices(totalVertexCount);
+    m_streamedTextures.push_back({ &texture, bIsNormalMap, slot });
 
-    int k = 0;
-    for (size_t i = 0; i < sphereMesh.LODVertices[0].size(); ++i, ++k)
+    auto& handles = bIsNormalMap ? m_normalStreamingHandles : m_diffuseStreamingHandles;
+    if (handles.size() <= slot)
     {
-        vertices[k].position = sphereMesh.LODVertices[0][i].position;
-        vertices[k].normal = sphereMesh.LODVertices[0][i].normal;
-        vertices[k].texCoord = sphereMesh.LODVertices[0][i].texCoord;
-        vertices[k].tangent = sphereMesh.LODVertices[0][i].tangent;
+        handles.resize(slot + 1u, UINT(-1));
     }
+    handles[slot] = handle;
+}
 
-    for (size_t i = 0; i < sphereMesh.LODVertices[0].size(); ++i, ++k)
-    {
-        vertices[k].position = sphereMesh.LODVertices[0][i].position;
-        vertices[k].normal = sphereMesh.LODVertices[0][i].normal;
-        vertices[k].texCoord = sphereMesh.LODVertices[0][i].texCoord;
-        vertices[k].tangent = sphereMesh.LODVertices[0][i].tangent;
-    }
+VOID Engine::OnStreamedMipsLoaded(UINT handle, Texture& texture)
+{
+    StreamedTextureView& view = m_streamedTextures[handle];
+    const UINT oldSlot = view.Slot;
+    const UINT newSlot = oldSlot < StreamingSrvSlotOffset ? oldSlot + StreamingSrvSlotOffset : oldSlot - StreamingSrvSlotOffset;
 
-    for (size_t i = 0; i < sphereMesh.LODVertices[0].size(); ++i, ++k)
-    {
-        vertices[k].position = sphereMesh.LODVertices[0][i].position;
-        vertices[k].normal = sphereMesh.LODVertices[0][i].normal;
-        vertices[k].texCoord = sphereMesh.LODVertices[0][i].texCoord;
-        vertices[k].tangent = sphereMesh.LODVertices[0][i].tangent;
-    }
+    // Nothing references the new slot: its previous resource was released before the streamer took another request.
+    CreateTextureSrv(texture, (view.bIsNormalMap ? m_normalSrvHeapStartIndex : m_diffuseSrvHeapStartIndex) + newSlot);
+    view.Slot = newSlot;
 
-    for (size_t i = 0; i < sphereMesh.LODVertices[0].size(); ++i, ++k)
+    for (auto& e : m_materials)
     {
-        vertices[k].position = sphereMesh.LODVertices[0][i].position;
-        vertices[k].normal = sphereMesh.LODVertices[0][i].normal;
-        vertices[k].texCoord = sphereMesh.LODVertices[0][i].texCoord;
-        vertices[k].tangent = sphereMesh.LODVertices[0][i].tangent;
+        Material* mat = e.second.get();
+        int& srvIndex = view.bIsNormalMap ? mat->NormalSrvHeapIndex : mat->DiffuseSrvHeapIndex;
+        if (srvIndex == (int)oldSlot)
+        {
+            srvIndex = (int)newSlot;
+            mat->NumFramesDirty = gNumFrameResources;
+        }
     }
 
-    for (size_t i = 0; i < sphereMesh.LODVertices[0].size(); ++i, ++k)
-    {
-        vertices[k].position = sphereMesh.LODVertices[0][i].position;
-        vertices[k].normal = sphereMesh.LODVertices[0][i].normal;
-        vertices[k].texCoord = sphereMesh.LODVertices[0][i].texCoord;
-        vertices[k].tangent = sphereMesh.LODVertices[0][i].tangent;
-    }
+    // Frames recorded from now on use the new slot, the old one (and its resource) is free once the submitted ones are done.
+    m_pendingTextureReleases.push_back({ handle, m_commandQueue->GetLastSignaledFenceValue(), std::move(texture.PreviousResource) });
+}
 
-    for (size_t i = 0; i < gridMesh.LODVertices[0].size(); ++i, ++k)
+VOID Engine::CreateGeometry(ID3D12GraphicsCommandList* pCommandList)
+{
+    auto sphereMesh = m_scene->GetBuiltInMesh(Scald::EBuiltInMeshes::SPHERE);
+    auto gridMesh = m_scene->GetBuiltInMesh(Scald::EBuiltInMeshes::GRID);
+
+    // Create shared vertex/index buffer for all geometry, every LOD of every mesh included.
+    const std::pair<const char*, const MeshData<>*> meshes[] =
     {
-        vertices[k].position = gridMesh.LODVertices[0][i].position;
-        vertices[k].normal = gridMesh.LODVertices[0][i].normal;
-        vertices[k].texCoord = gridMesh.LODVertices[0][i].texCoord;
-        vertices[k].tangent = gridMesh.LODVertices[0][i].tangent;
-    }
+        { "sun", &sphereMesh },
+        { "mercury", &sphereMesh },
+        { "venus", &sphereMesh },
+        { "earth", &sphereMesh },
+        { "mars", &sphereMesh },
+        { "plane", &gridMesh },
+    };
 
+    std::vector<VertexPositionNormalTangentUVPacked> vertices;
     std::vector<uint16_t> indices;
-    indices.insert(indices.end(), sphereMesh.LODIndices[0].begin(), sphereMesh.LODIndices[0].end());
-    indices.insert(indices.end(), sphereMesh.LODIndices[0].begin(), sphereMesh.LODIndices[0].end());
-    indices.insert(indices.end(), sphereMesh.LODIndices[0].begin(), sphereMesh.LODIndices[0].end());
-    indices.insert(indices.end(), sphereMesh.LODIndices[0].begin(), sphereMesh.LODIndices[0].end());
-    indices.insert(indices.end(), sphereMesh.LODIndices[0].begin(), sphereMesh.LODIndices[0].end());
-    indices.insert(indices.end(), gridMesh.LODIndices[0].begin(), gridMesh.LODIndices[0].end());
 
     auto solarSystem = std::make_unique<MeshGeometry>("solarSystem");
 
-    solarSystem->DrawArgs["sun"] = createSubmeshWithParams(sphereMesh, sunIndexOffset, sunVertexOffset);
-    solarSystem->DrawArgs["mercury"] = createSubmeshWithParams(sphereMesh, mercuryIndexOffset, mercuryVertexOffset);
-    solarSystem->DrawArgs["venus"] = createSubmeshWithParams(sphereMesh, venusIndexOffset, venusVertexOffset);
-    solarSystem->DrawArgs["earth"] = createSubmeshWithParams(sphereMesh, earthIndexOffset, earthVertexOffset);
-    solarSystem->DrawArgs["mars"] = createSubmeshWithParams(sphereMesh, marsIndexOffset, marsVertexOffset);
-    solarSystem->DrawArgs["plane"] = createSubmeshWithParams(gridMesh, planeIndexOffset, planeVertexOffset);
+    for (const auto& [name, pMesh] : meshes)
+    {
+        SubmeshGeometry submesh;
+
+        // Every LOD is quantized to the same box, so switching LODs keeps the same object constants.
+        BoundingBox quantizationBounds = pMesh->LODBounds[0];
+        for (UINT lod = 1; lod < pMesh->NumLODs; ++lod)
+        {
+            BoundingBox::CreateMerged(quantizationBounds, quantizationBounds, pMesh->LODBounds[lod]);
+        }
+        const PositionDequantization dequantization = PositionDequantization::FromBounds(quantizationBounds);
+        submesh.PositionDequantScale = dequantization.Scale;
+        submesh.PositionDequantBias = dequantization.Bias;
+
+        for (UINT lod = 0; lod < pMesh->NumLODs; ++lod)
+        {
+            SubmeshLOD submeshLOD;
+            submeshLOD.IndexCount = (UINT)pMesh->LODIndices[lod].size();
+            submeshLOD.StartIndexLocation = (UINT)indices.size();
+            submeshLOD.BaseVertexLocation = (INT)vertices.size();
+            submesh.LODs.push_back(submeshLOD);
+
+            const std::vector<VertexPositionNormalTangentUV>& lodVertices = pMesh->LODVertices[lod];
+            vertices.resize(vertices.size() + lodVertices.size());
+            VertexCompression::Encode(lodVertices.data(), lodVertices.size(), dequantization, &vertices[submeshLOD.BaseVertexLocation]);
+            indices.insert(indices.end(), pMesh->LODIndices[lod].begin(), pMesh->LODIndices[lod].end());
+        }
+
+        submesh.IndexCount = submesh.LODs[0].IndexCount;
+        submesh.StartIndexLocation = submesh.LODs[0].StartIndexLocation;
+        submesh.BaseVertexLocation = submesh.LODs[0].BaseVertexLocation;
+        // LOD 0 bounds enclose the coarser levels too, since they reuse its vertices.
+        submesh.Bounds = pMesh->LODBounds[0];
+
+        solarSystem->DrawArgs[name] = std::move(submesh);
+    }
 
     solarSystem->CreateGPUBuffers(m_device.Get(), pCommandList, vertices, indices);
+
+    // Shadow casters are drawn from positions only
+    std::vector<VertexPositionPacked> positions;
+    SplitPositionStream(vertices, positions);
+    solarSystem->CreatePositionStream(m_device.Get(), pCommandList, positions);
     m_geometries[solarSystem->Name] = std::move(solarSystem);
 
     
@@ -694,9 +761,9 @@ VOID Engine::CreateGeometryMaterials()
 
 VOID Engine::CreateSceneObjects()
 {
-    auto testObj = std::make_shared<Scald::SObject>();
-    testObj->AddComponent<Scald::Transform>(ScaldMath::ZeroVector, ScaldMath::ZeroVector, ScaldMath::One);
-    testObj->AddComponent<Scald::Renderer>();
+    Scald::SObject& testObj = m_sceneObjects.emplace_back();
+    testObj.AddComponent<Scald::Transform>(ScaldMath::ZeroVector, ScaldMath::ZeroVector, ScaldMath::One);
+    testObj.AddComponent<Scald::Renderer>();
 }
 
 VOID Engine::CreateRenderItems()
@@ -713,6 +780,7 @@ VOID Engine::CreateRenderItems()
     sunRenderItem->StartIndexLocation = sunRenderItem->Geo->DrawArgs.at("sun").StartIndexLocation;
     sunRenderItem->BaseVertexLocation = sunRenderItem->Geo->DrawArgs.at("sun").BaseVertexLocation;
     sunRenderItem->Bounds = sunRenderItem->Geo->DrawArgs.at("sun").Bounds;
+    sunRenderItem->Submesh = &sunRenderItem->Geo->DrawArgs.at("sun");
 
     auto mercuryRenderItem = std::make_unique<RenderItem>(ObjectCBIndex++);
     mercuryRenderItem->World = XMMatrixScaling(1.0f, 1.0f, 1.0f) * XMMatrixTranslation(0.0f, 0.0f, 5.0f);
@@ -723,6 +791,7 @@ VOID Engine::CreateRenderItems()
     mercuryRenderItem->StartIndexLocation = mercuryRenderItem->Geo->DrawArgs.at("mercury").StartIndexLocation;
     mercuryRenderItem->BaseVertexLocation = mercuryRenderItem->Geo->DrawArgs.at("mercury").BaseVertexLocation;
     mercuryRenderItem->Bounds = mercuryRenderItem->Geo->DrawArgs.at("mercury").Bounds;
+    mercuryRenderItem->Submesh = &mercuryRenderItem->Geo->DrawArgs.at("mercury");
 
     auto venusRenderItem = std::make_unique<RenderItem>(ObjectCBIndex++);
     venusRenderItem->World = XMMatrixScaling(0.5f, 0.5f, 0.5f) * XMMatrixTranslation(3.0f, 0.0f, 3.0f);
@@ -733,6 +802,7 @@ VOID Engine::CreateRenderItems()
     venusRenderItem->StartIndexLocation = venusRenderItem->Geo->DrawArgs.at("venus").StartIndexLocation;
     venusRenderItem->BaseVertexLocation = venusRenderItem->Geo->DrawArgs.at("venus").BaseVertexLocation;
     venusRenderItem->Bounds = venusRenderItem->Geo->DrawArgs.at("venus").Bounds;
+    venusRenderItem->Submesh = &venusRenderItem->Geo->DrawArgs.at("venus");
 
     auto earthRenderItem = std::make_unique<RenderItem>(ObjectCBIndex++);
     earthRenderItem->World = XMMatrixScaling(0.6f, 0.6f, 0.6f) * XMMatrixTranslation(4.0f, 0.0f, 4.0f);
@@ -743,6 +813,7 @@ VOID Engine::CreateRenderItems()
     earthRenderItem->StartIndexLocation = earthRenderItem->Geo->DrawArgs.at("earth").StartIndexLocation;
     earthRenderItem->BaseVertexLocation = earthRenderItem->Geo->DrawArgs.at("earth").BaseVertexLocation;
     earthRenderItem->Bounds = earthRenderItem->Geo->DrawArgs.at("earth").Bounds;
+    earthRenderItem->Submesh = &earthRenderItem->Geo->DrawArgs.at("earth");
 
     auto marsRenderItem = std::make_unique<RenderItem>(ObjectCBIndex++);
     marsRenderItem->World = XMMatrixScaling(1.0f, 1.0f, 1.0f) * XMMatrixTranslation(8.0f, 0.0f, 8.0f);
@@ -753,6 +824,7 @@ VOID Engine::CreateRenderItems()
     marsRenderItem->StartIndexLocation = marsRenderItem->Geo->DrawArgs.at("mars").StartIndexLocation;
     marsRenderItem->BaseVertexLocation = marsRenderItem->Geo->DrawArgs.at("mars").BaseVertexLocation;
     marsRenderItem->Bounds = marsRenderItem->Geo->DrawArgs.at("mars").Bounds;
+    marsRenderItem->Submesh = &marsRenderItem->Geo->DrawArgs.at("mars");
 
     auto planeRenderItem = std::make_unique<RenderItem>(ObjectCBIndex++);
     planeRenderItem->World = XMMatrixScaling(1.0f, 1.0f, 1.0f) * XMMatrixTranslation(0.0f, -1.5f, 0.0f);
@@ -762,6 +834,8 @@ VOID Engine::CreateRenderItems()
     planeRenderItem->IndexCount = planeRenderItem->Geo->DrawArgs.at("plane").IndexCount;
     planeRenderItem->StartIndexLocation = planeRenderItem->Geo->DrawArgs.at("plane").StartIndexLocation;
     planeRenderItem->BaseVertexLocation = planeRenderItem->Geo->DrawArgs.at("plane").BaseVertexLocation;
+    planeRenderItem->Bounds = planeRenderItem->Geo->DrawArgs.at("plane").Bounds;
+    planeRenderItem->Submesh = &planeRenderItem->Geo->DrawArgs.at("plane");
 
     auto sphereMesh = m_scene->GetBuiltInMesh(Scald::EBuiltInMeshes::SPHERE);
 
@@ -784,8 +858,41 @@ VOID Engine::CreateRenderItems()
 
     for (auto& ri : m_renderItems)
     {
+        ri->CullingIndex = (UINT)m_opaqueItems.size();
         m_opaqueItems.push_back(ri.get());
     }
+
+    m_objectsCBStaging.resize(m_renderItems.size() + 1u/*skyBox*/);
+    m_renderItemsByObjCBIndex.resize(m_objectsCBStaging.size());
+    m_changedObjCBIndices.reserve(m_objectsCBStaging.size());
+
+    // Hard-coded world matrices above are just the initial placement, from now on items are driven by their transforms.
+    m_sceneObjects.reserve(m_sceneObjects.size() + m_objectsCBStaging.size());
+    auto bindTransform = [this](RenderItem* ri)
+        {
+            XMVECTOR scale, orientation, translation;
+            XMMatrixDecompose(&scale, &orientation, &translation, ri->World);
+
+            Scald::SObject& obj = m_sceneObjects.emplace_back();
+            obj.AddComponent<Scald::Transform>(translation, ScaldMath::ZeroVector, scale).SetOrientation(orientation);
+            Scald::Renderer& renderer = obj.AddComponent<Scald::Renderer>();
+            renderer.Bounds = ri->Bounds;
+            renderer.ObjCBIndex = ri->ObjCBIndex;
+            renderer.TexTransform = ri->TexTransform;
+
+            m_renderItemsByObjCBIndex[ri->ObjCBIndex] = ri;
+            MarkRenderItemDirty(ri);
+        };
+
+    for (auto& ri : m_renderItems)
+    {
+        bindTransform(ri.get());
+    }
+    bindTransform(m_skyRenderItem.get());
+
+    m_frustumCuller.Resize((UINT)m_opaqueItems.size());
+    m_visibleIndices.reserve(m_opaqueItems.size());
+    m_visibleOpaqueItems.reserve(m_opaqueItems.size());
 }
 
 VOID Engine::CreatePointLights(ID3D12GraphicsCommandList* pCommandList)
@@ -797,10 +904,12 @@ VOID Engine::CreatePointLights(ID3D12GraphicsCommandList* pCommandList)
     pointLightMesh->CreateGPUBuffers(m_device.Get(), pCommandList, sphereMesh.LODVertices[0], sphereMesh.LODIndices[0]);
     m_geometries[pointLightMesh->Name] = std::move(pointLightMesh);
 
+    m_lightManager = std::make_unique<LightManager>([this](UINT capacity) { return std::make_unique<LightUploadBuffer>(m_device.Get(), capacity); }, gNumFrameResources);
+
     const int n = 10;
 
+    // The item only carries the volume mesh, instances come from the light manager.
     auto pointLight = std::make_unique<RenderItem>();
-    pointLight->Instances.resize(n * n);
     pointLight->World = XMMatrixIdentity();
     pointLight->Geo = m_geometries.at("pointLightMesh").get();
     pointLight->StartIndexLocation = 0u;
@@ -819,33 +928,81 @@ VOID Engine::CreatePointLights(ID3D12GraphicsCommandList* pCommandList)
     {
         for (int j = 0; j < n; ++j)
         {
-            int index = k*n + j;
-            
-            const float lightRange = ScaldMath::RandF(2.5, 3.0f);
-            XMVECTOR pos = XMVectorSet(x + j * dx, -0.5f, z + k * dz, 1.0f);
-            // scale should be dependent from range of light source
-            XMMATRIX world = XMMatrixScalingFromVector(XMVectorReplicate(lightRange)) * XMMatrixTranslationFromVector(pos);
-
-            XMStoreFloat4x4(&pointLight->Instances[index].World, world);
-
-            XMStoreFloat3(&pointLight->Instances[index].Light.Position, pos);
-            pointLight->Instances[index].Light.FallOfStart = ScaldMath::RandF(1.0, 2.0f);
-            pointLight->Instances[index].Light.FallOfEnd = lightRange;
-            pointLight->Instances[index].Light.Strength = { ScaldMath::RandF(0.0f, 1.0f), ScaldMath::RandF(0.0f, 1.0f), ScaldMath::RandF(0.0f, 1.0f) };
+            LightData light;
+            light.Position = { x + j * dx, -0.5f, z + k * dz };
+            light.FallOfStart = ScaldMath::RandF(1.0, 2.0f);
+            // volume is scaled by the range of light source
+            light.FallOfEnd = ScaldMath::RandF(2.5, 3.0f);
+            light.Strength = { ScaldMath::RandF(0.0f, 1.0f), ScaldMath::RandF(0.0f, 1.0f), ScaldMath::RandF(0.0f, 1.0f) };
+
+            m_lightManager->AddPointLight(light);
         }
     }
 
     m_pointLights.push_back(std::move(pointLight));
 }
 
+VOID Engine::CreateSpotLights(ID3D12GraphicsCommandList* pCommandList)
+{
+    // Low-poly proxy, scaled out per light so it still bounds the round cone
+    MeshData<> coneMesh = Shapes::CreateCone(1.0f, 1.0f, SpotLightCuller::ProxySliceCount);
+
+    auto spotLightMesh = std::make_unique<MeshGeometry>("spotLightMesh");
+    spotLightMesh->CreateGPUBuffers(m_device.Get(), pCommandList, coneMesh.LODVertices[0], coneMesh.LODIndices[0]);
+    m_geometries[spotLightMesh->Name] = std::move(spotLightMesh);
+
+    const int n = 4;
+
+    auto spotLight = std::make_unique<RenderItem>();
+    spotLight->Instances.resize(n * n);
+    spotLight->World = XMMatrixIdentity();
+    spotLight->Geo = m_geometries.at("spotLightMesh").get();
+    spotLight->StartIndexLocation = 0u;
+    spotLight->BaseVertexLocation = 0;
+    spotLight->IndexCount = (UINT)coneMesh.LODIndices[0].size();
+    assert(spotLight->Instances.size() <= MaxSpotLights);
+
+    float width = 40.0f;
+    float depth = 40.0f;
+
+    float x = -0.5f * width;
+    float z = -0.5f * depth;
+    float dx = width / (n - 1);
+    float dz = depth / (n - 1);
+
+    for (int k = 0; k < n; ++k)
+    {
+        for (int j = 0; j < n; ++j)
+        {
+            LightData& light = spotLight->Instances[k * n + j].Light;
+            light.Position = { x + j * dx, 6.0f, z + k * dz };
+            light.Direction = { ScaldMath::RandF(-0.3f, 0.3f), -1.0f, ScaldMath::RandF(-0.3f, 0.3f) };
+            light.FallOfStart = ScaldMath::RandF(4.0f, 6.0f);
+            light.FallOfEnd = ScaldMath::RandF(10.0f, 12.0f);
+            light.SpotPower = ScaldMath::RandF(8.0f, 64.0f);
+            light.Strength = { ScaldMath::RandF(0.0f, 1.0f), ScaldMath::RandF(0.0f, 1.0f), ScaldMath::RandF(0.0f, 1.0f) };
+
+            // Shaders expect a unit direction
+            const SpotLightCone cone = SpotLightCuller::ComputeCone(light);
+            light.Direction = cone.Direction;
+            XMStoreFloat4x4(&spotLight->Instances[k * n + j].World, SpotLightCuller::ComputeProxyWorld(cone));
+        }
+    }
+
+    m_spotLights.push_back(std::move(spotLight));
+}
+
 VOID Engine::CreateFrameResources()
 {
     for (int i = 0; i < gNumFrameResources; i++)
     {
         m_frameResources.push_back(std::make_unique<FrameResource>(
             m_device.Get(), 
-            static_cast<UINT>(EPassType::NumPasses), (UINT)m_renderItems.size() + 1u/*skyBox*/, (UINT)m_materials.size(), MaxPointLights));
+            (UINT)m_renderItems.size() + 1u/*skyBox*/, (UINT)m_materials.size(), MaxRecordingTasks));
     }
+
+    // Shared by all frames in flight.
+    m_dynamicUploadHeap = std::make_unique<DynamicUploadHeap>(m_device.Get(), DynamicUploadHeapSize);
 }
 
 VOID Engine::Reset()
@@ -854,9 +1011,24 @@ VOID Engine::Reset()
 
     // Init/Reinit camera
     m_camera->Reset(75.0f, m_aspectRatio, 0.1f, 250.0f);
-    // need tests
-    //m_cascadeShadowMap->OnResize(m_width, m_height);
-    //m_GBuffer->OnResize(m_width, m_height);
+
+    // The shadow map doesn't depend on the window, but the resized GBuffer moves every transient around the heap.
+    if (m_renderGraphHeap && (m_GBuffer->GetWidth() != m_width || m_GBuffer->GetHeight() != m_height))
+    {
+        auto commandList = m_commandQueue->GetCommandList(m_commandAllocator.Get());
+
+        m_GBuffer->OnResize(m_width, m_height);
+        for (UINT i = 0; i < GBuffer::EGBufferLayer::MAX; ++i)
+        {
+            const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = GetRenderGraphAllocationInfo(i);
+            m_renderGraph.SetTransientSize(i, allocationInfo.SizeInBytes, allocationInfo.Alignment);
+        }
+        m_renderGraph.Compile();
+        PlaceRenderGraphTransients(commandList.Get());
+
+        m_commandQueue->ExecuteCommandList(commandList);
+        m_commandQueue->Flush();
+    }
 }
 
 VOID Engine::CreateRtvAndDsvDescriptorHeaps()
@@ -900,12 +1072,28 @@ void Engine::OnUpdate(const ScaldTimer& st)
     {
         m_commandQueue->WaitForFenceValue(m_currFrameResource->Fence);
     }
+    m_dynamicUploadHeap->ReleaseCompletedFrames(m_commandQueue->GetCompletedFenceValue());
+    m_textureLoader->Update(*m_commandQueue);
 
+    UpdateTransforms(st);
+    UpdateFrustumCulling(st); // must run before UpdateObjectsCB, since it consumes NumFramesDirty too
+    UpdateLODSelection(st);
+    UpdateTextureStreaming(st);
     UpdateObjectsCB(st);
     UpdateMaterialBuffer(st);
     UpdateLightsBuffer(st);
+    if (m_isClusteredLightingEnabled)
+    {
+        UpdateLightClusters(st);
+    }
+    else
+    {
+        UpdatePointLightVolumes(st);
+    }
+    UpdateSpotLights(st);
     
     UpdateShadowTransform(st);
+    UpdateShadowCastersCulling(st);
     UpdateShadowPassCB(st); // pass
     
     UpdateGeometryPassCB(st); // pass
@@ -915,33 +1103,46 @@ void Engine::OnUpdate(const ScaldTimer& st)
 // Render the scene.
 void Engine::OnRender(const ScaldTimer& st)
 {
-    auto currCmdAlloc = m_currFrameResource->commandAllocator.Get();
-    ThrowIfFailed(currCmdAlloc->Reset());
-    
+    if (m_isParallelRecordingEnabled)
+    {
+        RecordCommandListsParallel();
+    }
+    else
+    {
+        auto currCmdAlloc = m_currFrameResource->commandAllocator.Get();
+        ThrowIfFailed(currCmdAlloc->Reset());
+
 #if defined(DEBUG) || defined(_DEBUG)
-    wchar_t name[32] = {};
-    UINT size = sizeof(name);
-    currCmdAlloc->GetPrivateData(WKPDID_D3DDebugObjectNameW, &size, name);
+        wchar_t name[32] = {};
+        UINT size = sizeof(name);
+        currCmdAlloc->GetPrivateData(WKPDID_D3DDebugObjectNameW, &size, name);
 #endif
 
-    auto commandList = m_commandQueue->GetCommandList(currCmdAlloc);
+        auto commandList = m_commandQueue->GetCommandList(currCmdAlloc);
 
-    // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList(commandList.Get());
+        // Record all the commands we need to render the scene into the command list.
+        PopulateCommandList(commandList.Get());
 
-    //ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList.Get());
-    // Execute the command list.
-    m_commandQueue->ExecuteCommandList(commandList);
+        //ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList.Get());
+        // Execute the command list.
+        m_commandQueue->ExecuteCommandList(commandList);
+    }
 
     Present();
 
     // Advance the fence value to mark commands up to this fence point.
     m_currFrameResource->Fence = m_commandQueue->Signal();
+    m_dynamicUploadHeap->FinishFrame(m_currFrameResource->Fence);
 }
 
 void Engine::OnDestroy()
 {
     m_commandQueue->Flush();
+
+    // Both wait for their jobs, so they have to go before the workers
+    m_textureLoader.reset();
+    m_shaderPermutations.reset();
+    JobSystem::Get().Shutdown();
 }
 
 void Engine::OnMouseDown(WPARAM btnState, int x, int y)
@@ -1033,41 +1234,206 @@ void Engine::OnKeyboardInput(const ScaldTimer& st)
 #pragma endregion GlobalLightDirection
 }
 
+void Engine::UpdateTransforms(const ScaldTimer& st)
+{
+    m_changedObjCBIndices.clear();
+    m_transformSystem.Update(m_objectsCBStaging.data(), m_changedObjCBIndices);
+
+    for (UINT objCBIndex : m_changedObjCBIndices)
+    {
+        RenderItem* ri = m_renderItemsByObjCBIndex[objCBIndex];
+        // Culling still reads the item's world matrix, staging already has the transposed one.
+        ri->World = XMMatrixTranspose(XMLoadFloat4x4(&m_objectsCBStaging[objCBIndex].World));
+        MarkRenderItemDirty(ri);
+    }
+}
+
+void Engine::UpdateFrustumCulling(const ScaldTimer& st)
+{
+    // Refresh world space bounds only for items that have been moved since the last frame.
+    for (RenderItem* ri : m_dirtyRenderItems)
+    {
+        if (ri->CullingIndex != RenderItem::InvalidCullingIndex && ri->NumFramesDirty == gNumFrameResources)
+        {
+            BoundingBox worldBounds;
+            ri->Bounds.Transform(worldBounds, ri->World);
+            m_frustumCuller.SetBounds(ri->CullingIndex, worldBounds);
+        }
+    }
+
+    // Camera frustum is in view space, bring it to world space.
+    XMMATRIX view = m_camera->GetViewMatrix();
+    XMVECTOR det = XMMatrixDeterminant(view);
+    XMMATRIX invView = XMMatrixInverse(&det, view);
+
+    BoundingFrustum worldFrustum;
+    m_camera->GetCameraFrustum().Transform(worldFrustum, invView);
+
+    m_frustumCuller.Cull(CullingVolume::FromFrustum(worldFrustum), m_visibleIndices);
+
+    m_visibleOpaqueItems.clear();
+    for (UINT index : m_visibleIndices)
+    {
+        m_visibleOpaqueItems.push_back(m_opaqueItems[index]);
+    }
+}
+
+void Engine::UpdateLODSelection(const ScaldTimer& st)
+{
+    const XMVECTOR cameraPos = m_camera->GetPosition();
+
+    for (RenderItem* ri : m_opaqueItems)
+    {
+        if (!ri->Submesh || ri->Submesh->LODs.size() <= 1u)
+        {
+            continue;
+        }
+
+        BoundingSphere worldSphere;
+        BoundingSphere::CreateFromBoundingBox(worldSphere, ri->Bounds);
+        worldSphere.Transform(worldSphere, ri->World);
+
+        const float distance = ScaldMath::Max(XMVectorGetX(XMVector3Length(XMLoadFloat3(&worldSphere.Center) - cameraPos)), m_camera->GetNearZ());
+        const float screenSize = MeshSimplifier::ComputeScreenSize(worldSphere.Radius, distance, m_camera->GetFovYRad());
+        const UINT lod = MeshSimplifier::SelectLOD(screenSize, (UINT)ri->Submesh->LODs.size(), LOD1ScreenSize);
+
+        // Draw arguments are read by command recording only, so switching them needs no CB update.
+        const SubmeshLOD& submeshLOD = ri->Submesh->LODs[lod];
+        ri->LODIndex = lod;
+        ri->IndexCount = submeshLOD.IndexCount;
+        ri->StartIndexLocation = submeshLOD.StartIndexLocation;
+        ri->BaseVertexLocation = submeshLOD.BaseVertexLocation;
+    }
+}
+
+void Engine::UpdateTextureStreaming(const ScaldTimer& st)
+{
+    const UINT64 completedFenceValue = m_commandQueue->GetCompletedFenceValue();
+    while (!m_pendingTextureReleases.empty() && m_pendingTextureReleases.front().FenceValue <= completedFenceValue)
+    {
+        m_textureStreamer->OnRequestComplete(m_pendingTextureReleases.front().Handle);
+        m_pendingTextureReleases.pop_front();
+    }
+
+    const XMVECTOR cameraPos = m_camera->GetPosition();
+    const float screenHeightAtUnitDistance = 2.0f * tanf(0.5f * m_camera->GetFovYRad());
+
+    m_textureStreamer->BeginFrame();
+    for (RenderItem* ri : m_visibleOpaqueItems)
+    {
+        const Material* mat = ri->Mat;
+        if (!mat)
+        {
+            continue;
+        }
+
+        BoundingSphere worldSphere;
+        BoundingSphere::CreateFromBoundingBox(worldSphere, ri->Bounds);
+        worldSphere.Transform(worldSphere, ri->World);
+
+        const float distance = ScaldMath::Max(XMVectorGetX(XMVector3Length(XMLoadFloat3(&worldSphere.Center) - cameraPos)), m_camera->GetNearZ());
+        const float projectedSize = 2.0f * worldSphere.Radius / (distance * screenHeightAtUnitDistance) * (float)m_height;
+        // Texture repeats this many times across the item
+        const float uvScale = ScaldMath::Max(XMVectorGetX(XMVector3Length(ri->TexTransform.r[0])), XMVectorGetX(XMVector3Length(ri->TexTransform.r[1])));
+
+        auto RequestMip = [&](const std::vector<UINT>& handles, int srvIndex)
+            {
+                if (srvIndex < 0)
+                {
+                    return;
+                }
+
+                const UINT slot = (UINT)srvIndex % StreamingSrvSlotOffset;
+                if (slot >= handles.size() || handles[slot] == UINT(-1))
+                {
+                    return;
+                }
+
+                const Texture* pTexture = m_streamedTextures[handles[slot]].pTexture;
+                const float mip = TextureStreamer::ComputeRequiredMip((UINT)pTexture->SourceData->Width, (UINT)pTexture->SourceData->Height, uvScale, projectedSize);
+                m_textureStreamer->RequestMip(handles[slot], mip);
+            };
+        RequestMip(m_diffuseStreamingHandles, mat->DiffuseSrvHeapIndex);
+        RequestMip(m_normalStreamingHandles, mat->NormalSrvHeapIndex);
+    }
+
+    m_textureStreamer->Update(m_streamingRequests);
+    for (const TextureStreamingRequest& request : m_streamingRequests)
+    {
+        const UINT handle = request.Handle;
+        m_textureLoader->RequestMips(m_streamedTextures[handle].pTexture, request.FirstResidentMip, [this, handle](Texture& tex) { OnStreamedMipsLoaded(handle, tex); });
+    }
+}
+
 void Engine::UpdateObjectsCB(const ScaldTimer& st)
 {
-    auto objectCB = m_currFrameResource->ObjectsCB.get();
+    if (m_dirtyRenderItems.empty())
+    {
+        return;
+    }
 
-    for (auto& ri : m_renderItems)
+    // Sorted by CB index, so neighbouring dirty items form contiguous ranges in the buffer.
+    if (!m_isDirtyListSorted)
+    {
+        std::sort(m_dirtyRenderItems.begin(), m_dirtyRenderItems.end(), [](const RenderItem* a, const RenderItem* b) { return a->ObjCBIndex < b->ObjCBIndex; });
+        m_isDirtyListSorted = true;
+    }
+
+    // Staging data is rebuilt only once, when the item has just been changed. Other frame resources just get a copy.
+    // World matrices are already in the staging, the TransformSystem writes them there.
+    for (RenderItem* ri : m_dirtyRenderItems)
     {
-        // Luna stuff. Try to remove 'if' statement.
-        // Have tried. It does not affect anything. 
-        // Looks like it just forces the code to update the object's constant buffer regardless of whether it has been modified or not.
-        if (ri->NumFramesDirty > 0)
+        if (ri->NumFramesDirty == gNumFrameResources)
         {
-            XMMATRIX transposeWorld = XMMatrixTranspose(ri->World);
-            XMVECTOR det = XMMatrixDeterminant(transposeWorld);
+            PaddedObjectConstants& objectConstants = m_objectsCBStaging[ri->ObjCBIndex];
+            XMStoreFloat4x4(&objectConstants.TexTransform, XMMatrixTranspose(ri->TexTransform));
+            objectConstants.MaterialIndex = ri->Mat ? ri->Mat->MatBufferIndex : 0u;
+            if (ri->Submesh)
+            {
+                objectConstants.PositionDequantScale = ri->Submesh->PositionDequantScale;
+                objectConstants.PositionDequantBias = ri->Submesh->PositionDequantBias;
+            }
+        }
+    }
 
-            XMStoreFloat4x4(&m_perObjectCBData.World, transposeWorld);
-            XMStoreFloat4x4(&m_perObjectCBData.InvTransposeWorld, XMMatrixTranspose(XMMatrixInverse(&det, transposeWorld)));
-            XMStoreFloat4x4(&m_perObjectCBData.TexTransform, XMMatrixTranspose(ri->TexTransform));
-            m_perObjectCBData.MaterialIndex = ri->Mat->MatBufferIndex;
+    // Upload contiguous ranges of dirty items
+    auto objectCB = m_currFrameResource->ObjectsCB.get();
+    assert(objectCB->GetElementByteSize() == sizeof(PaddedObjectConstants));
 
-            objectCB->CopyData(ri->ObjCBIndex, m_perObjectCBData); // In this case ri->ObjCBIndex would be equal to index 'i' of traditional for loop
-            ri->NumFramesDirty--;
+    size_t rangeStart = 0;
+    for (size_t i = 1; i <= m_dirtyRenderItems.size(); ++i)
+    {
+        if (i == m_dirtyRenderItems.size() || m_dirtyRenderItems[i]->ObjCBIndex != m_dirtyRenderItems[i - 1]->ObjCBIndex + 1u)
+        {
+            const UINT firstIndex = m_dirtyRenderItems[rangeStart]->ObjCBIndex;
+            objectCB->CopyRange(firstIndex, &m_objectsCBStaging[firstIndex], (UINT)(i - rangeStart));
+            rangeStart = i;
         }
     }
 
-    if (m_skyRenderItem->NumFramesDirty > 0)
+    // Remove items that are up to date in all frame resources, keeping the order.
+    size_t numStillDirty = 0;
+    for (RenderItem* ri : m_dirtyRenderItems)
     {
-        XMMATRIX transposeWorld = XMMatrixTranspose(m_skyRenderItem->World);
-        XMVECTOR det = XMMatrixDeterminant(transposeWorld);
+        ri->NumFramesDirty--;
+        ri->IsInDirtyList = ri->NumFramesDirty > 0;
+        if (ri->IsInDirtyList)
+        {
+            m_dirtyRenderItems[numStillDirty++] = ri;
+        }
+    }
+    m_dirtyRenderItems.resize(numStillDirty);
+}
 
-        XMStoreFloat4x4(&m_perObjectCBData.World, transposeWorld);
-        XMStoreFloat4x4(&m_perObjectCBData.InvTransposeWorld, XMMatrixTranspose(XMMatrixInverse(&det, transposeWorld)));
-        XMStoreFloat4x4(&m_perObjectCBData.TexTransform, XMMatrixTranspose(m_skyRenderItem->TexTransform));
+void Engine::MarkRenderItemDirty(RenderItem* ri)
+{
+    ri->NumFramesDirty = gNumFrameResources;
 
-        objectCB->CopyData(m_skyRenderItem->ObjCBIndex, m_perObjectCBData);
-        m_skyRenderItem->NumFramesDirty--;
+    if (!ri->IsInDirtyList)
+    {
+        ri->IsInDirtyList = true;
+        m_dirtyRenderItems.push_back(ri);
+        m_isDirtyListSorted = false;
     }
 }
 
@@ -1096,46 +1462,196 @@ void Engine::UpdateMaterialBuffer(const ScaldTimer& st)
 
 void Engine::UpdateLightsBuffer(const ScaldTimer& st)
 {
-    auto currPointLightSB = m_currFrameResource->PointLightSB.get();
+    // Only lights changed since this frame resource's copy was last written are uploaded.
+    m_pointLightsSBAddress = m_lightManager->Upload(m_urrFrameResourceIndex);
 
+    const auto& instances = m_lightManager->GetPointLightInstances();
     for (auto& e : m_pointLights)
     {
-        // we have many instances, not the one objects, so think about it (we can't update all instances, if only one point light gets dirty)
-        //if (e->NumFramesDirty > 0)
-        //{
-        
-        int pointLightIndex = 0;
-        const auto& instances = e->Instances;
+        e->InstancesSBAddress = m_pointLightsSBAddress;
+        e->InstanceCount = (UINT)instances.size();
+    }
+
+    const XMMATRIX view = m_camera->GetViewMatrix();
+
+    m_pointLightSpheres.resize(instances.size());
+    for (UINT i = 0; i < (UINT)instances.size(); ++i)
+    {
+        // Light has no effect past FallOfEnd
+        XMStoreFloat4(&m_pointLightSpheres[i], XMVector3TransformCoord(XMLoadFloat3(&instances[i].Light.Position), view));
+        m_pointLightSpheres[i].w = instances[i].Light.FallOfEnd;
+    }
+}
+
+void Engine::UpdatePointLightVolumes(const ScaldTimer& st)
+{
+    const XMMATRIX projMatrix = m_camera->GetPerspectiveProjectionMatrix();
+    m_lightVolumeClassifier.Classify(m_pointLightSpheres.data(), (UINT)m_pointLightSpheres.size(),
+        XMVectorGetX(projMatrix.r[0]), XMVectorGetY(projMatrix.r[1]), m_camera->GetNearZ(), m_camera->GetFarZ(), m_width, m_height);
+
+    UINT numVisible = 0u;
+    for (UINT volumeClass = LightVolumeClassifier::WithinFrustum; volumeClass < LightVolumeClassifier::NumClasses; ++volumeClass)
+    {
+        numVisible += (UINT)m_lightVolumeClassifier.GetLights((LightVolumeClassifier::EVolumeClass)volumeClass).size();
+    }
+
+    m_pointLightVolumesSBAddresses = {};
+    if (numVisible == 0u)
+    {
+        return;
+    }
+
+    // Regrouped by class, so every class is drawn with a single instanced draw from its own range.
+    const auto& instances = m_lightManager->GetPointLightInstances();
+    DynamicAllocation volumesSB = m_dynamicUploadHeap->Allocate(numVisible * sizeof(InstanceData));
+    InstanceData* mappedInstances = reinterpret_cast<InstanceData*>(volumesSB.CpuAddress);
+
+    UINT instanceIndex = 0u;
+    for (UINT volumeClass = LightVolumeClassifier::WithinFrustum; volumeClass < LightVolumeClassifier::NumClasses; ++volumeClass)
+    {
+        m_pointLightVolumesSBAddresses[volumeClass] = volumesSB.GpuAddress + instanceIndex * sizeof(InstanceData);
+        for (UINT light : m_lightVolumeClassifier.GetLights((LightVolumeClassifier::EVolumeClass)volumeClass))
+        {
+            mappedInstances[instanceIndex++] = instances[light];
+        }
+    }
+}
+
+void Engine::UpdateSpotLights(const ScaldTimer& st)
+{
+    for (UINT batch = 0; batch < NumSpotLightBatches; ++batch)
+    {
+        m_visibleSpotLights[batch].clear();
+        m_spotLightScissorRects[batch] = LightScissorRect();
+    }
+    m_spotLightsSBAddresses = {};
+
+    if (m_spotLights.empty())
+    {
+        return;
+    }
+
+    // Cones are culled and bounded on screen in view space
+    const XMMATRIX view = m_camera->GetViewMatrix();
+    const XMMATRIX proj = m_camera->GetPerspectiveProjectionMatrix();
+    const CullingVolume viewFrustum = CullingVolume::FromViewProjection(proj);
+    const float nearZ = m_camera->GetNearZ();
 
-        for (UINT i = 0; i < (UINT)instances.size(); ++i)
+    // Every spot light item shares the same cone proxy, so one item holds all of them
+    const auto& instances = m_spotLights.front()->Instances;
+    UINT numVisible = 0u;
+    for (UINT i = 0; i < (UINT)instances.size(); ++i)
+    {
+        const SpotLightCone viewCone = SpotLightCuller::TransformCone(SpotLightCuller::ComputeCone(instances[i].Light), view);
+        if (SpotLightCuller::IsOutside(viewCone, viewFrustum))
         {
-            XMStoreFloat4x4(&m_perInstanceSBData.World, XMMatrixTranspose(XMLoadFloat4x4(&instances[i].World)));
-            m_perInstanceSBData.Light.Strength = instances[i].Light.Strength;
-            m_perInstanceSBData.Light.FallOfStart = instances[i].Light.FallOfStart;
-            m_perInstanceSBData.Light.FallOfEnd = instances[i].Light.FallOfEnd;
-            m_perInstanceSBData.Light.Position = instances[i].Light.Position;
-            // copy all instances to structured buffer
-            currPointLightSB->CopyData(pointLightIndex++, m_perInstanceSBData);
+            continue;
         }
-        e->InstanceCount = pointLightIndex;
 
-        //e->NumFramesDirty--;
-        //}
+        const LightScissorRect rect = SpotLightCuller::ComputeScissorRect(viewCone, XMVectorGetX(proj.r[0]), XMVectorGetY(proj.r[1]), nearZ, m_width, m_height);
+        if (rect.Left >= rect.Right || rect.Top >= rect.Bottom)
+        {
+            continue;
+        }
+
+        const ESpotLightBatch batch = SpotLightCuller::CrossesNearPlane(viewCone, nearZ) ? SpotLightsInsideCone : SpotLightsOutsideCone;
+        LightScissorRect& batchRect = m_spotLightScissorRects[batch];
+        if (m_visibleSpotLights[batch].empty())
+        {
+            batchRect = rect;
+        }
+        else
+        {
+            batchRect.Left = std::min(batchRect.Left, rect.Left);
+            batchRect.Top = std::min(batchRect.Top, rect.Top);
+            batchRect.Right = std::max(batchRect.Right, rect.Right);
+            batchRect.Bottom = std::max(batchRect.Bottom, rect.Bottom);
+        }
+        m_visibleSpotLights[batch].push_back(i);
+        ++numVisible;
     }
+
+    if (numVisible == 0u)
+    {
+        return;
+    }
+
+    // Visible instances only, every batch is contiguous for its instanced draw
+    DynamicAllocation spotLightsSB = m_dynamicUploadHeap->Allocate(numVisible * sizeof(InstanceData));
+    InstanceData* mappedInstances = reinterpret_cast<InstanceData*>(spotLightsSB.CpuAddress);
+
+    UINT instanceIndex = 0u;
+    for (UINT batch = 0; batch < NumSpotLightBatches; ++batch)
+    {
+        m_spotLightsSBAddresses[batch] = spotLightsSB.GpuAddress + instanceIndex * sizeof(InstanceData);
+        for (UINT light : m_visibleSpotLights[batch])
+        {
+            InstanceData& instance = mappedInstances[instanceIndex++];
+            XMStoreFloat4x4(&instance.World, XMMatrixTranspose(XMLoadFloat4x4(&instances[light].World)));
+            instance.Light = instances[light].Light;
+        }
+    }
+}
+
+void Engine::UpdateLightClusters(const ScaldTimer& st)
+{
+    m_lightClusters.Build(m_camera->GetFovYRad(), m_camera->GetAspectRatio(), m_camera->GetNearZ(), m_camera->GetFarZ());
+    m_lightClusters.Assign(m_pointLightSpheres.data(), (UINT)m_pointLightSpheres.size());
+
+    const auto& ranges = m_lightClusters.GetRanges();
+    DynamicAllocation rangesSB = m_dynamicUploadHeap->Allocate(ranges.size() * sizeof(LightClusterRange));
+    memcpy(rangesSB.CpuAddress, ranges.data(), ranges.size() * sizeof(LightClusterRange));
+    m_clusterLightRangesSBAddress = rangesSB.GpuAddress;
+
+    // Never empty, so the root SRV always points to a valid allocation.
+    const auto& indices = m_lightClusters.GetLightIndices();
+    DynamicAllocation indicesSB = m_dynamicUploadHeap->Allocate(std::max<size_t>(indices.size(), 1u) * sizeof(UINT));
+    if (!indices.empty())
+    {
+        memcpy(indicesSB.CpuAddress, indices.data(), indices.size() * sizeof(UINT));
+    }
+    m_clusterLightIndicesSBAddress = indicesSB.GpuAddress;
 }
 
 void Engine::UpdateShadowTransform(const ScaldTimer& st)
 {
-    std::vector<std::pair<XMMATRIX, XMMATRIX>> lightSpaceMatrices;
-    GetLightSpaceMatrices(lightSpaceMatrices);
+    // Cascades are refitted only when camera or sun have moved, otherwise last frame data is still valid.
+    if (!m_cascadeShadowMap->Update(*m_camera, m_mainPassCBData.DirLight.Direction))
+    {
+        return;
+    }
 
     for (UINT i = 0; i < MaxCascades; ++i)
     {
-        XMMATRIX shadowTransform = lightSpaceMatrices[i].first * lightSpaceMatrices[i].second;
+        XMMATRIX shadowTransform = m_cascadeShadowMap->GetCascadeViewProj(i);
         m_shadowPassCBData.Cascades.CascadeViewProj[i] = XMMatrixTranspose(shadowTransform);
 
         m_mainPassCBData.Cascades.CascadeViewProj[i] = XMMatrixTranspose(shadowTransform);
         m_mainPassCBData.Cascades.Distances[i] = m_cascadeShadowMap->GetCascadeLevel(i);
+
+        // Shadow PSO has depth clip disabled, so casters between the light and the near plane still render.
+        m_cascadeCullingVolumes[i] = CullingVolume::FromViewProjection(shadowTransform, false);
+    }
+}
+
+void Engine::UpdateShadowCastersCulling(const ScaldTimer& st)
+{
+    // World bounds are already refreshed by UpdateFrustumCulling.
+    m_frustumCuller.CullMasks(m_cascadeCullingVolumes.data(), MaxCascades, m_cascadeMasks);
+
+    m_shadowCasterItems.clear();
+    m_shadowCasterMasks.clear();
+
+    for (UINT i = 0; i < (UINT)m_opaqueItems.size(); ++i)
+    {
+        const UINT mask = m_cascadeMasks[i];
+        if (mask == 0u)
+        {
+            continue;
+        }
+
+        m_shadowCasterItems.push_back(m_opaqueItems[i]);
+        m_shadowCasterMasks.push_back(mask);
     }
 }
 
@@ -1151,8 +1667,7 @@ void Engine::UpdateShadowPassCB(const ScaldTimer& st)
     XMStoreFloat4x4(&m_shadowPassCBData.ViewProj, XMMatrixTranspose(viewProj));
     XMStoreFloat4x4(&m_shadowPassCBData.InvViewProj, XMMatrixTranspose(invViewProj));
 
-    auto currPassCB = m_currFrameResource->PassCB.get();
-    currPassCB->CopyData(static_cast<int>(EPassType::DepthShadow), m_shadowPassCBData);
+    m_passCBAddresses[static_cast<UINT>(EPassType::DepthShadow)] = m_dynamicUploadHeap->AllocateConstants(m_shadowPassCBData);
 }
 
 void Engine::UpdateGeometryPassCB(const ScaldTimer& st)
@@ -1175,8 +1690,7 @@ void Engine::UpdateGeometryPassCB(const ScaldTimer& st)
     m_geometryPassCBData.DeltaTime = st.DeltaTime();
     m_geometryPassCBData.TotalTime = st.TotalTime();
 
-    auto currPassCB = m_currFrameResource->PassCB.get();
-    currPassCB->CopyData(static_cast<int>(EPassType::DeferredGeometry), m_geometryPassCBData);
+    m_passCBAddresses[static_cast<UINT>(EPassType::DeferredGeometry)] = m_dynamicUploadHeap->AllocateConstants(m_geometryPassCBData);
 }
 
 void Engine::UpdateMainPassCB(const ScaldTimer& st)
@@ -1201,6 +1715,13 @@ void Engine::UpdateMainPassCB(const ScaldTimer& st)
 
     m_mainPassCBData.Ambient = { 0.25f, 0.25f, 0.35f, 1.0f };
 
+    m_mainPassCBData.NumPointLights = (UINT)m_pointLightSpheres.size();
+    m_mainPassCBData.ClusterTilesX = m_lightClusters.GetTilesX();
+    m_mainPassCBData.ClusterTilesY = m_lightClusters.GetTilesY();
+    m_mainPassCBData.ClusterSlicesZ = m_lightClusters.GetSlicesZ();
+    m_mainPassCBData.ClusterDepthSliceScale = m_lightClusters.GetDepthSliceScale();
+    m_mainPassCBData.ClusterDepthSliceBias = m_lightClusters.GetDepthSliceBias();
+
 #pragma region DirLight
     // Invert sign because other way light would be pointing up
     XMVECTOR lightDir = -ScaldMath::SphericalToCarthesian(1.0f, m_sunTheta, m_sunPhi);
@@ -1208,18 +1729,13 @@ void Engine::UpdateMainPassCB(const ScaldTimer& st)
     m_mainPassCBData.DirLight.Strength = { 1.0f, 1.0f, 0.9f };
 #pragma endregion DirLight
 
-    auto currPassCB = m_currFrameResource->PassCB.get();
-    currPassCB->CopyData(static_cast<int>(EPassType::DeferredLighting), m_mainPassCBData);
+    m_passCBAddresses[static_cast<UINT>(EPassType::DeferredLighting)] = m_dynamicUploadHeap->AllocateConstants(m_mainPassCBData);
 }
 
 VOID Engine::PopulateCommandList(ID3D12GraphicsCommandList* pCommandList)
 {
     // Set necessary state.
-    pCommandList->SetGraphicsRootSignature(m_rootSignature->Get());
-
-    // Access for setting and using root descriptor table
-    ID3D12DescriptorHeap* descriptorHeaps[] = { m_srvHeap.Get() };
-    pCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+    BindCommonState(pCommandList);
 
     RenderDepthOnlyPass(pCommandList);
     RenderGeometryPass(pCommandList);
@@ -1227,49 +1743,195 @@ VOID Engine::PopulateCommandList(ID3D12GraphicsCommandList* pCommandList)
     RenderForwardPasses(pCommandList);
 }
 
+VOID Engine::CreateRecordingPasses()
+{
+    using Pass = ParallelCommandRecorder<ID3D12GraphicsCommandList>::Pass;
+    m_recordingPasses.resize(NumRecordingPasses);
+
+    Pass& shadowPass = m_recordingPasses[ERecordingPass::ShadowDepth];
+    shadowPass.BindState = [this](ID3D12GraphicsCommandList* pCommandList) { BindCommonState(pCommandList); BindDepthOnlyPassState(pCommandList); };
+    shadowPass.Begin = [this](ID3D12GraphicsCommandList* pCommandList) { BeginDepthOnlyPass(pCommandList); };
+    shadowPass.DrawRange = [this](ID3D12GraphicsCommandList* pCommandList, UINT begin, UINT end) { DrawShadowCasters(pCommandList, begin, end); };
+
+    Pass& geometryPass = m_recordingPasses[ERecordingPass::GBufferGeometry];
+    geometryPass.BindState = [this](ID3D12GraphicsCommandList* pCommandList) { BindCommonState(pCommandList); BindGeometryPassState(pCommandList); };
+    geometryPass.Begin = [this](ID3D12GraphicsCommandList* pCommandList) { BeginGeometryPass(pCommandList); };
+    geometryPass.DrawRange = [this](ID3D12GraphicsCommandList* pCommandList, UINT begin, UINT end) { DrawRenderItems(pCommandList, m_visibleOpaqueItems.data() + begin, end - begin); };
+
+    // Full screen and instanced light volumes are just a handful of draws, not worth splitting.
+    Pass& lightingPass = m_recordingPasses[ERecordingPass::LightingAndForward];
+    lightingPass.BindState = [this](ID3D12GraphicsCommandList* pCommandList) { BindCommonState(pCommandList); };
+    lightingPass.Begin = [this](ID3D12GraphicsCommandList* pCommandList) { RenderLightingPass(pCommandList); RenderForwardPasses(pCommandList); };
+}
+
+VOID Engine::CreateRenderGraph(ID3D12GraphicsCommandList* pCommandList)
+{
+    static const char* GBufferLayerNames[GBuffer::EGBufferLayer::MAX] = { "Diffuse Albedo", "Ambient Occlusion", "Normal", "Specular", "Motion Vectors", "GBuffer Depth" };
+
+    // GBuffer and the shadow map are written and consumed within a frame. They are created committed to be measured,
+    // then placed in the graph's heap once it is compiled.
+    auto AddTransient = [this](const char* name)
+        {
+            const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = GetRenderGraphAllocationInfo(m_renderGraph.GetNumResources());
+
+            RenderGraphResourceDesc desc;
+            desc.Name = name;
+            desc.bIsTransient = true;
+            desc.InitialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+            desc.SizeInBytes = allocationInfo.SizeInBytes;
+            desc.Alignment = allocationInfo.Alignment;
+            m_renderGraph.AddResource(desc);
+        };
+
+    for (UINT i = 0; i < GBuffer::EGBufferLayer::MAX; ++i)
+    {
+        AddTransient(GBufferLayerNames[i]);
+    }
+    AddTransient("Cascade Shadow Map");
+
+    RenderGraphResourceDesc backBufferDesc;
+    backBufferDesc.Name = "Back Buffer";
+    backBufferDesc.InitialState = D3D12_RESOURCE_STATE_PRESENT;
+    m_renderGraph.AddResource(backBufferDesc);
+    assert(m_renderGraph.GetNumResources() == NumRenderGraphResources);
+
+    m_renderGraph.AddPass("Shadow Depth");
+    m_renderGraph.AddPass("GBuffer Geometry");
+    m_renderGraph.AddPass("Lighting");
+    m_renderGraph.AddPass("Sky Box");
+    assert(m_renderGraph.GetNumPasses() == NumRenderGraphPasses);
+
+    m_renderGraph.Write(RenderGraphShadowDepth, RenderGraphShadowMap, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    for (UINT i = 0; i < GBuffer::EGBufferLayer::DEPTH; ++i)
+    {
+        m_renderGraph.Write(RenderGraphGeometry, i, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+    m_renderGraph.Write(RenderGraphGeometry, GBuffer::EGBufferLayer::DEPTH, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    // The whole GBuffer table is bound to the light shaders
+    for (UINT i = 0; i < GBuffer::EGBufferLayer::MAX; ++i)
+    {
+        m_renderGraph.Read(RenderGraphLighting, i, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    }
+    m_renderGraph.Read(RenderGraphLighting, RenderGraphShadowMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    m_renderGraph.Write(RenderGraphLighting, RenderGraphBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    m_renderGraph.Read(RenderGraphSkyBox, GBuffer::EGBufferLayer::DEPTH, D3D12_RESOURCE_STATE_DEPTH_READ);
+    m_renderGraph.Write(RenderGraphSkyBox, RenderGraphBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    m_renderGraph.Compile();
+    // Every pass ends up in the back buffer.
+    assert(m_renderGraph.GetStats().NumCulledPasses == 0u);
+
+    PlaceRenderGraphTransients(pCommandList);
+}
+
+VOID Engine::PlaceRenderGraphTransients(ID3D12GraphicsCommandList* pCommandList)
+{
+    // Transients are all render targets and depth stencils, the only textures a tier 1 heap lets them share.
+    const CD3DX12_HEAP_DESC heapDesc(m_renderGraph.GetTransientHeapSize(), D3D12_HEAP_TYPE_DEFAULT, 0u, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+    ComPtr<ID3D12Heap> heap;
+    ThrowIfFailed(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)));
+    SCALD_NAME_D3D12_OBJECT(heap, L"Render Graph Transients");
+
+    UINT64 GBufferHeapOffsets[GBuffer::EGBufferLayer::MAX];
+    for (UINT i = 0; i < GBuffer::EGBufferLayer::MAX; ++i)
+    {
+        GBufferHeapOffsets[i] = m_renderGraph.GetHeapOffset(i);
+        assert(GBufferHeapOffsets[i] != RenderGraph::InvalidOffset);
+    }
+    assert(m_renderGraph.GetHeapOffset(RenderGraphShadowMap) != RenderGraph::InvalidOffset);
+
+    m_GBuffer->PlaceResources(heap.Get(), GBufferHeapOffsets);
+    m_cascadeShadowMap->PlaceResource(heap.Get(), m_renderGraph.GetHeapOffset(RenderGraphShadowMap));
+    // Nothing is placed in the previous heap anymore.
+    m_renderGraphHeap = heap;
+
+    // Placed resources start in their initial state. Every first writer clears its targets, which also initializes
+    // memory taken over through aliasing barriers.
+    RecordRenderGraphBarriers(pCommandList, m_renderGraph.GetSetupBarriers(), m_renderGraphBarriers[NumRenderGraphPasses]);
+}
+
+VOID Engine::RecordCommandListsParallel()
+{
+    m_recordingPasses[ERecordingPass::ShadowDepth].NumDraws = (UINT)m_shadowCasterItems.size();
+    m_recordingPasses[ERecordingPass::GBufferGeometry].NumDraws = (UINT)m_visibleOpaqueItems.size();
+
+    const std::vector<RecordingTask>& tasks = m_commandRecorder.Schedule(m_recordingPasses, MaxRecordingTasks);
+
+    // Lists are acquired on this thread, the queue's pool of command lists is not thread safe.
+    m_recordingCommandLists.resize(tasks.size());
+    m_recordingCommandListPtrs.resize(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        // The frame resource's fence has been waited for in OnUpdate, so the GPU is done with its allocators.
+        ID3D12CommandAllocator* pAllocator = m_currFrameResource->RecordingAllocators[i].Get();
+        ThrowIfFailed(pAllocator->Reset());
+
+        m_recordingCommandLists[i] = m_commandQueue->GetCommandList(pAllocator);
+        m_recordingCommandListPtrs[i] = m_recordingCommandLists[i].Get();
+    }
+
+    m_commandRecorder.Record(m_recordingPasses, m_recordingCommandListPtrs.data());
+
+    m_commandQueue->ExecuteCommandLists(m_recordingCommandLists.data(), (UINT)m_recordingCommandLists.size());
+}
+
+void Engine::BindCommonState(ID3D12GraphicsCommandList* pCommandList)
+{
+    pCommandList->SetGraphicsRootSignature(m_rootSignature->Get());
+
+    // Access for setting and using root descriptor table
+    ID3D12DescriptorHeap* descriptorHeaps[] = { m_srvHeap.Get() };
+    pCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+}
+
 void Engine::RenderDepthOnlyPass(ID3D12GraphicsCommandList* pCommandList)
 {
-    UINT passCBByteSize = ScaldUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
+    BindDepthOnlyPassState(pCommandList);
+    BeginDepthOnlyPass(pCommandList);
+    DrawShadowCasters(pCommandList, 0u, m_shadowCasterItems.size());
+}
 
+void Engine::BindDepthOnlyPassState(ID3D12GraphicsCommandList* pCommandList)
+{
     pCommandList->RSSetViewports(1u, &m_cascadeShadowMap->GetViewport());
     pCommandList->RSSetScissorRects(1u, &m_cascadeShadowMap->GetScissorRect());
 
-    // change to depth write state
-    TransitionResource(pCommandList, m_cascadeShadowMap->Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE);
-
 #pragma region BypassResources
-    auto currFramePassCB = m_currFrameResource->PassCB->Get();
-    auto currFrameGPUVirtualAddress = ScaldUtil::GetGPUVirtualAddress(currFramePassCB->GetGPUVirtualAddress(), passCBByteSize, static_cast<UINT>(EPassType::DepthShadow));
+    auto currFrameGPUVirtualAddress = m_passCBAddresses[static_cast<UINT>(EPassType::DepthShadow)];
     pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerPassDataCB, currFrameGPUVirtualAddress);
 #pragma endregion BypassResources
 
     CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_cascadeShadowMap->GetDsv());
     pCommandList->OMSetRenderTargets(0u, nullptr, TRUE, &dsvHandle);
-    pCommandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0u, 0u, nullptr);
 
     pCommandList->SetPipelineState(m_pipelineStates.at(EPsoType::CascadedShadowsOpaque).Get());
-    DrawRenderItems(pCommandList, m_renderItems);
+}
+
+void Engine::BeginDepthOnlyPass(ID3D12GraphicsCommandList* pCommandList)
+{
+    RecordRenderGraphBarriers(pCommandList, RenderGraphShadowDepth);
 
-    TransitionResource(pCommandList, m_cascadeShadowMap->Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ);
+    pCommandList->ClearDepthStencilView(m_cascadeShadowMap->GetDsv(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0u, 0u, nullptr);
 }
 
 void Engine::RenderGeometryPass(ID3D12GraphicsCommandList* pCommandList)
 {
-    UINT passCBByteSize = ScaldUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
+    BindGeometryPassState(pCommandList);
+    BeginGeometryPass(pCommandList);
+    DrawRenderItems(pCommandList, m_visibleOpaqueItems.data(), m_visibleOpaqueItems.size());
+}
+
+void Engine::BindGeometryPassState(ID3D12GraphicsCommandList* pCommandList)
+{
     // The viewport needs to be reset whenever the command list is reset.
     pCommandList->RSSetViewports(1u, &m_viewport);
     pCommandList->RSSetScissorRects(1u, &m_scissorRect);
 
-    // barrier
-    for (unsigned i = 0; i < GBuffer::EGBufferLayer::MAX - 1u; i++)
-    {
-        TransitionResource(pCommandList, m_GBuffer->Get(i), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    }
-    TransitionResource(pCommandList, m_GBuffer->Get(GBuffer::EGBufferLayer::DEPTH), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE);
-
 #pragma region BypassResources
-    auto currFramePassCB = m_currFrameResource->PassCB->Get();
-    auto currFrameGPUVirtualAddress = ScaldUtil::GetGPUVirtualAddress(currFramePassCB->GetGPUVirtualAddress(), passCBByteSize, static_cast<UINT>(EPassType::DeferredGeometry));
+    auto currFrameGPUVirtualAddress = m_passCBAddresses[static_cast<UINT>(EPassType::DeferredGeometry)];
     pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerPassDataCB, currFrameGPUVirtualAddress);
 
     // Bind all the materials used in this scene. For structured buffers, we can bypass the heap and set as a root descriptor.
@@ -1287,6 +1949,13 @@ void Engine::RenderGeometryPass(ID3D12GraphicsCommandList* pCommandList)
     CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_GBuffer->GetDsv(GBuffer::EGBufferLayer::DEPTH));
     pCommandList->OMSetRenderTargets(GBuffer::EGBufferLayer::DEPTH, &rtvHandle, TRUE, &dsvHandle);
 
+    pCommandList->SetPipelineState(m_pipelineStates.at(EPsoType::DeferredGeometry).Get());
+}
+
+void Engine::BeginGeometryPass(ID3D12GraphicsCommandList* pCommandList)
+{
+    RecordRenderGraphBarriers(pCommandList, RenderGraphGeometry);
+
     const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
     pCommandList->ClearRenderTargetView(m_GBuffer->GetRtv(GBuffer::EGBufferLayer::DIFFUSE_ALBEDO), Colors::LightSteelBlue, 0u, nullptr);
     pCommandList->ClearRenderTargetView(m_GBuffer->GetRtv(GBuffer::EGBufferLayer::AMBIENT_OCCLUSION), clearColor, 0u, nullptr);
@@ -1294,31 +1963,21 @@ void Engine::RenderGeometryPass(ID3D12GraphicsCommandList* pCommandList)
     pCommandList->ClearRenderTargetView(m_GBuffer->GetRtv(GBuffer::EGBufferLayer::SPECULAR), clearColor, 0u, nullptr);
     pCommandList->ClearRenderTargetView(m_GBuffer->GetRtv(GBuffer::EGBufferLayer::MOTION_VECTORS), Colors::Yellow, 0u, nullptr);
     pCommandList->ClearDepthStencilView(m_GBuffer->GetDsv(GBuffer::EGBufferLayer::DEPTH), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0u, 0u, nullptr);
-
-    pCommandList->SetPipelineState(m_pipelineStates.at(EPsoType::DeferredGeometry).Get());
-    DrawRenderItems(pCommandList, m_renderItems);
-
-    for (unsigned i = 0; i < GBuffer::EGBufferLayer::MAX - 1u; i++)
-    {
-        TransitionResource(pCommandList, m_GBuffer->Get(i), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_GENERIC_READ);
-    }
-    TransitionResource(pCommandList, m_GBuffer->Get(GBuffer::EGBufferLayer::DEPTH), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ);
 }
 
 // lighting pass (including all subpasses) uses the same render target
 void Engine::RenderLightingPass(ID3D12GraphicsCommandList* pCommandList)
 {
+    // GBuffer and shadow map to shader reads, the back buffer to the render target.
+    RecordRenderGraphBarriers(pCommandList, RenderGraphLighting);
+
     DeferredDirectionalLightPass(pCommandList);
     DeferredPointLightPass(pCommandList);
-    //DeferredSpotLightPass(pCommandList);
+    DeferredSpotLightPass(pCommandList);
 }
 
 void Engine::DeferredDirectionalLightPass(ID3D12GraphicsCommandList* pCommandList)
 {
-    UINT passCBByteSize = ScaldUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
-    // Indicate that the back buffer will be used as a render target.
-    TransitionResource(pCommandList, m_renderTargets[m_currBackBuffer].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-
     // The viewport needs to be reset whenever the command list is reset.
     pCommandList->RSSetViewports(1u, &m_viewport);
     pCommandList->RSSetScissorRects(1u, &m_scissorRect);
@@ -1332,8 +1991,7 @@ void Engine::DeferredDirectionalLightPass(ID3D12GraphicsCommandList* pCommandLis
     pCommandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0u, 0u, nullptr);
 
 #pragma region BypassResources
-    auto currFramePassCB = m_currFrameResource->PassCB->Get();
-    auto currFrameGPUVirtualAddress = ScaldUtil::GetGPUVirtualAddress(currFramePassCB->GetGPUVirtualAddress(), passCBByteSize, static_cast<UINT>(EPassType::DeferredLighting));
+    auto currFrameGPUVirtualAddress = m_passCBAddresses[static_cast<UINT>(EPassType::DeferredLighting)];
     pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerPassDataCB, currFrameGPUVirtualAddress);
     
     auto srvGpuStart = m_srvHeap->GetGPUDescriptorHandleForHeapStart();
@@ -1352,23 +2010,134 @@ void Engine::DeferredDirectionalLightPass(ID3D12GraphicsCommandList* pCommandLis
 
 void Engine::DeferredPointLightPass(ID3D12GraphicsCommandList* pCommandList)
 {
-    UINT passCBByteSize = ScaldUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
+    if (m_isClusteredLightingEnabled)
+    {
+        DeferredClusteredPointLightPass(pCommandList);
+        return;
+    }
 
-    auto currFramePassCB = m_currFrameResource->PassCB->Get();
-    auto currFrameGPUVirtualAddress = ScaldUtil::GetGPUVirtualAddress(currFramePassCB->GetGPUVirtualAddress(), passCBByteSize, static_cast<UINT>(EPassType::DeferredLighting));
+    auto currFrameGPUVirtualAddress = m_passCBAddresses[static_cast<UINT>(EPassType::DeferredLighting)];
     pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerPassDataCB, currFrameGPUVirtualAddress);
 
     // Bind GBuffer textures
     pCommandList->SetGraphicsRootDescriptorTable(ERootParameter::GBufferTextures, CD3DX12_GPU_DESCRIPTOR_HANDLE(m_srvHeap->GetGPUDescriptorHandleForHeapStart(), m_GBufferTexturesSrvHeapStartIndex, m_cbvSrvUavDescriptorSize));
 
-    // !!! HACK (TO DRAW EVEN IF FRUSTUM INTERSECTS LIGHT VOLUME)
-    pCommandList->SetPipelineState(m_pipelineStates.at(EPsoType::DeferredPointWithinFrustum).Get());
-    DrawInstancedRenderItems(pCommandList, m_pointLights);
+    if (m_pointLights.empty())
+    {
+        return;
+    }
+
+    // Every point light item shares the same sphere volume
+    const RenderItem* pVolume = m_pointLights.front().get();
+    pCommandList->IASetPrimitiveTopology(pVolume->PrimitiveTopologyType);
+    pCommandList->IASetVertexBuffers(0u, 1u, &pVolume->Geo->VertexBufferView());
+    pCommandList->IASetIndexBuffer(&pVolume->Geo->IndexBufferView());
+
+    auto SetScissorRect = [pCommandList](const LightScissorRect& rect)
+        {
+            const D3D12_RECT scissorRect = { (LONG)rect.Left, (LONG)rect.Top, (LONG)rect.Right, (LONG)rect.Bottom };
+            pCommandList->RSSetScissorRects(1u, &scissorRect);
+        };
+
+    // A single instanced draw per class, bounded by the union of its lights' rects
+    const std::pair<LightVolumeClassifier::EVolumeClass, EPsoType> volumePasses[] =
+    {
+        { LightVolumeClassifier::WithinFrustum, EPsoType::DeferredPointWithinFrustum },
+        { LightVolumeClassifier::IntersectsFarPlane, EPsoType::DeferredPointIntersectsFarPlane },
+    };
+    for (const auto& [volumeClass, psoType] : volumePasses)
+    {
+        const UINT numLights = (UINT)m_lightVolumeClassifier.GetLights(volumeClass).size();
+        if (numLights == 0u)
+        {
+            continue;
+        }
+
+        SetScissorRect(m_lightVolumeClassifier.GetClassScissorRect(volumeClass));
+        pCommandList->SetPipelineState(m_pipelineStates.at(psoType).Get());
+        pCommandList->SetGraphicsRootShaderResourceView(ERootParameter::PointLightsDataSB, m_pointLightVolumesSBAddresses[volumeClass]);
+        pCommandList->DrawIndexedInstanced(pVolume->IndexCount, numLights, pVolume->StartIndexLocation, pVolume->BaseVertexLocation, 0u);
+    }
+
+    // Rare (the camera is close to a light with a range reaching past the far plane), so a draw per light with its own rect is fine.
+    // SV_InstanceID ignores the start instance, the light is picked by offsetting the buffer instead.
+    const auto& fullQuadLights = m_lightVolumeClassifier.GetLights(LightVolumeClassifier::FullQuad);
+    if (!fullQuadLights.empty())
+    {
+        pCommandList->SetPipelineState(m_pipelineStates.at(EPsoType::DeferredPointFullQuad).Get());
+        pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        for (UINT i = 0; i < (UINT)fullQuadLights.size(); ++i)
+        {
+            SetScissorRect(m_lightVolumeClassifier.GetScissorRect(fullQuadLights[i]));
+            pCommandList->SetGraphicsRootShaderResourceView(ERootParameter::PointLightsDataSB, m_pointLightVolumesSBAddresses[LightVolumeClassifier::FullQuad] + i * sizeof(InstanceData));
+            pCommandList->DrawInstanced(4u, 1u, 0u, 0u);
+        }
+    }
+
+    pCommandList->RSSetScissorRects(1u, &m_scissorRect);
+}
+
+void Engine::DeferredClusteredPointLightPass(ID3D12GraphicsCommandList* pCommandList)
+{
+    if (m_pointLightSpheres.empty())
+    {
+        return;
+    }
+
+    auto currFrameGPUVirtualAddress = m_passCBAddresses[static_cast<UINT>(EPassType::DeferredLighting)];
+    pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerPassDataCB, currFrameGPUVirtualAddress);
+
+    // Bind GBuffer textures
+    pCommandList->SetGraphicsRootDescriptorTable(ERootParameter::GBufferTextures, CD3DX12_GPU_DESCRIPTOR_HANDLE(m_srvHeap->GetGPUDescriptorHandleForHeapStart(), m_GBufferTexturesSrvHeapStartIndex, m_cbvSrvUavDescriptorSize));
+
+    // Lights and their per-cluster lists
+    pCommandList->SetGraphicsRootShaderResourceView(ERootParameter::PointLightsDataSB, m_pointLightsSBAddress);
+    pCommandList->SetGraphicsRootShaderResourceView(ERootParameter::ClusterLightRangesSB, m_clusterLightRangesSBAddress);
+    pCommandList->SetGraphicsRootShaderResourceView(ERootParameter::ClusterLightIndicesSB, m_clusterLightIndicesSBAddress);
+
+    pCommandList->SetPipelineState(m_pipelineStates.at(EPsoType::DeferredPointClustered).Get());
+    pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    pCommandList->DrawInstanced(4u, 1u, 0u, 0u);
 }
 
 void Engine::DeferredSpotLightPass(ID3D12GraphicsCommandList* pCommandList)
 {
+    if (m_spotLights.empty())
+    {
+        return;
+    }
+
+    auto currFrameGPUVirtualAddress = m_passCBAddresses[static_cast<UINT>(EPassType::DeferredLighting)];
+    pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerPassDataCB, currFrameGPUVirtualAddress);
+
+    // Bind GBuffer textures
+    pCommandList->SetGraphicsRootDescriptorTable(ERootParameter::GBufferTextures, CD3DX12_GPU_DESCRIPTOR_HANDLE(m_srvHeap->GetGPUDescriptorHandleForHeapStart(), m_GBufferTexturesSrvHeapStartIndex, m_cbvSrvUavDescriptorSize));
 
+    const RenderItem* pVolume = m_spotLights.front().get();
+    pCommandList->IASetPrimitiveTopology(pVolume->PrimitiveTopologyType);
+    pCommandList->IASetVertexBuffers(0u, 1u, &pVolume->Geo->VertexBufferView());
+    pCommandList->IASetIndexBuffer(&pVolume->Geo->IndexBufferView());
+
+    // A single instanced draw per batch, bounded by the union of its cones' rects
+    const EPsoType batchPsos[NumSpotLightBatches] = { EPsoType::DeferredSpot, EPsoType::DeferredSpotInsideVolume };
+    for (UINT batch = 0; batch < NumSpotLightBatches; ++batch)
+    {
+        const UINT numLights = (UINT)m_visibleSpotLights[batch].size();
+        if (numLights == 0u)
+        {
+            continue;
+        }
+
+        const LightScissorRect& rect = m_spotLightScissorRects[batch];
+        const D3D12_RECT scissorRect = { (LONG)rect.Left, (LONG)rect.Top, (LONG)rect.Right, (LONG)rect.Bottom };
+        pCommandList->RSSetScissorRects(1u, &scissorRect);
+
+        pCommandList->SetPipelineState(m_pipelineStates.at(batchPsos[batch]).Get());
+        pCommandList->SetGraphicsRootShaderResourceView(ERootParameter::SpotLightsDataSB, m_spotLightsSBAddresses[batch]);
+        pCommandList->DrawIndexedInstanced(pVolume->IndexCount, numLights, pVolume->StartIndexLocation, pVolume->BaseVertexLocation, 0u);
+    }
+
+    pCommandList->RSSetScissorRects(1u, &m_scissorRect);
 }
 
 void Engine::RenderForwardPasses(ID3D12GraphicsCommandList* pCommandList)
@@ -1377,8 +2146,8 @@ void Engine::RenderForwardPasses(ID3D12GraphicsCommandList* pCommandList)
     // RenderTransparencyPass(pCommandList);
     RenderSkyBoxPass(pCommandList);
 
-    // Close accumulation buffer, that was opened in the light pass and indicate that the back buffer will now be used to present.
-    TransitionResource(pCommandList, m_renderTargets[m_currBackBuffer].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    // Back buffer to present
+    RecordRenderGraphBarriers(pCommandList, NumRenderGraphPasses);
 }
 
 void Engine::RenderTransparencyPass(ID3D12GraphicsCommandList* pCommandList)
@@ -1387,25 +2156,20 @@ void Engine::RenderTransparencyPass(ID3D12GraphicsCommandList* pCommandList)
 
 void Engine::RenderSkyBoxPass(ID3D12GraphicsCommandList* pCommandList)
 {
-    UINT passCBByteSize = ScaldUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
-
-    // Set GBuffer depth for read to properly draw sky box
-    TransitionResource(pCommandList, m_GBuffer->Get(GBuffer::EGBufferLayer::DEPTH), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_READ);
+    // GBuffer depth is only tested against, it stays readable by the shaders since the lighting pass.
+    RecordRenderGraphBarriers(pCommandList, RenderGraphSkyBox);
 
     CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_currBackBuffer, m_rtvDescriptorSize);
     CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), 2, m_dsvDescriptorSize);
     pCommandList->OMSetRenderTargets(1u, &rtvHandle, TRUE, &dsvHandle);
 
-    auto currFramePassCB = m_currFrameResource->PassCB->Get();
-    auto currFrameGPUVirtualAddress = ScaldUtil::GetGPUVirtualAddress(currFramePassCB->GetGPUVirtualAddress(), passCBByteSize, static_cast<UINT>(EPassType::DeferredLighting));
+    auto currFrameGPUVirtualAddress = m_passCBAddresses[static_cast<UINT>(EPassType::DeferredLighting)];
     pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerPassDataCB, currFrameGPUVirtualAddress);
 
     // Bind SkyBox texture
     pCommandList->SetGraphicsRootDescriptorTable(ERootParameter::SkyBox, CD3DX12_GPU_DESCRIPTOR_HANDLE(m_srvHeap->GetGPUDescriptorHandleForHeapStart(), m_skyCubeSrvHeapStartIndex, m_cbvSrvUavDescriptorSize));
     pCommandList->SetPipelineState(m_pipelineStates.at(EPsoType::Sky).Get());
     DrawRenderItem(pCommandList, m_skyRenderItem);
-    
-    TransitionResource(pCommandList, m_GBuffer->Get(GBuffer::EGBufferLayer::DEPTH), D3D12_RESOURCE_STATE_DEPTH_READ, D3D12_RESOURCE_STATE_GENERIC_READ);
 }
 
 void Engine::DrawRenderItem(ID3D12GraphicsCommandList* pCommandList, std::unique_ptr<RenderItem>& ri)
@@ -1447,114 +2211,115 @@ void Engine::DrawRenderItems(ID3D12GraphicsCommandList* pCommandList, std::vecto
     }
 }
 
-void Engine::DrawInstancedRenderItems(ID3D12GraphicsCommandList* pCommandList, std::vector<std::unique_ptr<RenderItem>>& renderItems)
+void Engine::DrawRenderItems(ID3D12GraphicsCommandList* pCommandList, RenderItem* const* ppRenderItems, size_t count)
 {
-    for (auto& ri : renderItems)
+    UINT objCBByteSize = (UINT)ScaldUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+    auto currFrameObjCB = m_currFrameResource->ObjectsCB->Get();
+
+    for (size_t i = 0; i < count; ++i)
     {
+        const RenderItem* ri = ppRenderItems[i];
+
         pCommandList->IASetPrimitiveTopology(ri->PrimitiveTopologyType);
         pCommandList->IASetVertexBuffers(0u, 1u, &ri->Geo->VertexBufferView());
         pCommandList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
 
-        // Set the instance buffer to use for this render-item.  For structured buffers, we can bypass 
-        // the heap and set as a root descriptor.
-        auto instanceBuffer = m_currFrameResource->PointLightSB->Get();
-
-        // now we set only objects' cbv per item, material data is set per pass
-        // we get material data by index from structured buffer
-        pCommandList->SetGraphicsRootShaderResourceView(ERootParameter::PointLightsDataSB, instanceBuffer->GetGPUVirtualAddress());
+        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = ScaldUtil::GetGPUVirtualAddress(currFrameObjCB->GetGPUVirtualAddress(), objCBByteSize, ri->ObjCBIndex);
+        pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerObjectDataCB, objCBAddress);
 
-        pCommandList->DrawIndexedInstanced(ri->IndexCount, ri->InstanceCount, ri->StartIndexLocation, ri->BaseVertexLocation, 0u);
+        pCommandList->DrawIndexedInstanced(ri->IndexCount, 1u, ri->StartIndexLocation, ri->BaseVertexLocation, 0u);
     }
 }
 
-std::pair<XMMATRIX, XMMATRIX> Engine::GetLightSpaceMatrix(const float nearZ, const float farZ)
+void Engine::DrawShadowCasters(ID3D12GraphicsCommandList* pCommandList, size_t begin, size_t end)
 {
-    const auto directionalLight = m_mainPassCBData.DirLight;
-
-    const XMFLOAT3 lightDir = directionalLight.Direction;
+    UINT objCBByteSize = (UINT)ScaldUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 
-    const auto cameraProj = XMMatrixPerspectiveFovLH(m_camera->GetFovYRad(), m_aspectRatio, nearZ, farZ);
-    const auto frustumCorners = GetFrustumCornersWorldSpace(m_camera->GetViewMatrix(), cameraProj);
+    auto currFrameObjCB = m_currFrameResource->ObjectsCB->Get();
 
-    XMVECTOR center = XMVectorZero();
-    for (const auto& v : frustumCorners)
+    for (size_t i = begin; i < end; ++i)
     {
-        center += v;
-    }
-    center /= (float)frustumCorners.size();
+        const RenderItem* ri = m_shadowCasterItems[i];
 
-    const XMMATRIX lightView = XMMatrixLookAtLH(center, center + XMVectorSet(lightDir.x, lightDir.y, lightDir.z, 1.0f), ScaldMath::UpVector);
+        pCommandList->IASetPrimitiveTopology(ri->PrimitiveTopologyType);
+        // Packed vertices start with the same position as the position stream, so the layout reads it from either buffer.
+        const D3D12_VERTEX_BUFFER_VIEW vbv = ri->Geo->HasPositionStream() ? ri->Geo->PositionBufferView() : ri->Geo->VertexBufferView();
+        pCommandList->IASetVertexBuffers(0u, 1u, &vbv);
+        pCommandList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
 
-    // Measuring cascade
-    float minX = std::numeric_limits<float>::max();
-    float minY = std::numeric_limits<float>::max();
-    float minZ = std::numeric_limits<float>::max();
-    float maxX = std::numeric_limits<float>::lowest();
-    float maxY = std::numeric_limits<float>::lowest();
-    float maxZ = std::numeric_limits<float>::lowest();
+        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = ScaldUtil::GetGPUVirtualAddress(currFrameObjCB->GetGPUVirtualAddress(), objCBByteSize, ri->ObjCBIndex);
+        pCommandList->SetGraphicsRootConstantBufferView(ERootParameter::PerObjectDataCB, objCBAddress);
 
-    for (const auto& v : frustumCorners)
-    {
-        const auto trf = XMVector4Transform(v, lightView);
+        // GS instances of cascades this item does not overlap emit nothing.
+        pCommandList->SetGraphicsRoot32BitConstant(ERootParameter::PerDrawConstants, m_shadowCasterMasks[i], 0u);
 
-        minX = std::min(minX, XMVectorGetX(trf));
-        maxX = std::max(maxX, XMVectorGetX(trf));
-        minY = std::min(minY, XMVectorGetY(trf));
-        maxY = std::max(maxY, XMVectorGetY(trf));
-        minZ = std::min(minZ, XMVectorGetZ(trf));
-        maxZ = std::max(maxZ, XMVectorGetZ(trf));
+        pCommandList->DrawIndexedInstanced(ri->IndexCount, 1u, ri->StartIndexLocation, ri->BaseVertexLocation, 0u);
     }
-    // Tune this parameter according to the scene
-    constexpr float zMult = 10.0f;
-    minZ = (minZ < 0) ? minZ * zMult : minZ / zMult;
-    maxZ = (maxZ < 0) ? maxZ / zMult : maxZ * zMult;
+}
+
+void Engine::DrawInstancedRenderItems(ID3D12GraphicsCommandList* pCommandList, std::vector<std::unique_ptr<RenderItem>>& renderItems)
+{
+    for (auto& ri : renderItems)
+    {
+        pCommandList->IASetPrimitiveTopology(ri->PrimitiveTopologyType);
+        pCommandList->IASetVertexBuffers(0u, 1u, &ri->Geo->VertexBufferView());
+        pCommandList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
 
-    const XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(minX, maxX, minY, maxY, minZ, maxZ);
+        // Set the instance buffer to use for this render-item.  For structured buffers, we can bypass 
+        // the heap and set as a root descriptor.
+        pCommandList->SetGraphicsRootShaderResourceView(ERootParameter::PointLightsDataSB, ri->InstancesSBAddress);
 
-    return std::make_pair(lightView, lightProj);
+        pCommandList->DrawIndexedInstanced(ri->IndexCount, ri->InstanceCount, ri->StartIndexLocation, ri->BaseVertexLocation, 0u);
+    }
 }
 
-void Engine::GetLightSpaceMatrices(std::vector<std::pair<XMMATRIX, XMMATRIX>>& outMatrices)
+ID3D12Resource* Engine::GetRenderGraphResource(UINT resource)
 {
-    for (UINT i = 0u; i < MaxCascades; ++i)
+    if (resource < GBuffer::EGBufferLayer::MAX)
     {
-        if (i == 0u)
-        {
-            outMatrices.push_back(GetLightSpaceMatrix(m_camera->GetNearZ(), m_cascadeShadowMap->GetCascadeLevel(i)));
-        }
-        else
-        {
-            outMatrices.push_back(GetLightSpaceMatrix(m_cascadeShadowMap->GetCascadeLevel(i-1), m_cascadeShadowMap->GetCascadeLevel(i)));
-        }
+        return m_GBuffer->Get(resource);
+    }
+    if (resource == RenderGraphShadowMap)
+    {
+        return m_cascadeShadowMap->Get();
     }
+
+    assert(resource == RenderGraphBackBuffer);
+    return m_renderTargets[m_currBackBuffer].Get();
 }
 
-std::vector<XMVECTOR> Engine::GetFrustumCornersWorldSpace(const XMMATRIX& view, const XMMATRIX& proj)
+D3D12_RESOURCE_ALLOCATION_INFO Engine::GetRenderGraphAllocationInfo(UINT resource)
 {
-    const auto viewProj = view * proj;
+    const D3D12_RESOURCE_DESC resourceDesc = GetRenderGraphResource(resource)->GetDesc();
+    return m_device->GetResourceAllocationInfo(0u, 1u, &resourceDesc);
+}
 
-    XMVECTOR det = XMMatrixDeterminant(viewProj);
-    const auto invViewProj = XMMatrixInverse(&det, viewProj);
+void Engine::RecordRenderGraphBarriers(ID3D12GraphicsCommandList* pCommandList, UINT pass)
+{
+    const std::vector<RenderGraphBarrier>& barriers = (pass == NumRenderGraphPasses) ? m_renderGraph.GetEndBarriers() : m_renderGraph.GetPassBarriers(pass);
+    RecordRenderGraphBarriers(pCommandList, barriers, m_renderGraphBarriers[pass]);
+}
 
-    std::vector<XMVECTOR> frustumCorners;
-    frustumCorners.reserve(8);
+void Engine::RecordRenderGraphBarriers(ID3D12GraphicsCommandList* pCommandList, const std::vector<RenderGraphBarrier>& barriers, std::vector<D3D12_RESOURCE_BARRIER>& scratch)
+{
+    if (barriers.empty())
+    {
+        return;
+    }
 
-    for (UINT x = 0; x < 2; ++x)
+    scratch.clear();
+    for (const RenderGraphBarrier& barrier : barriers)
     {
-        for (UINT y = 0; y < 2; ++y)
+        if (barrier.Type == RenderGraphBarrier::Aliasing)
         {
-            for (UINT z = 0; z < 2; ++z)
-            {
-                // translate NDC coords to world space
-                const XMVECTOR pt = XMVector4Transform(
-                    XMVectorSet(
-                        2.0f * x - 1.0f,
-                        2.0f * y - 1.0f,
-                        (float)z,
-                        1.0f), invViewProj);
-                frustumCorners.push_back(pt / XMVectorGetW(pt));
-            }
+            ID3D12Resource* pResourceBefore = (barrier.ResourceBefore != RenderGraph::InvalidIndex) ? GetRenderGraphResource(barrier.ResourceBefore) : nullptr;
+            scratch.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(pResourceBefore, GetRenderGraphResource(barrier.Resource)));
+        }
+        else
+        {
+            scratch.push_back(CD3DX12_RESOURCE_BARRIER::Transition(GetRenderGraphResource(barrier.Resource), barrier.StateBefore, barrier.StateAfter));
         }
     }
-    return frustumCorners;
+    pCommandList->ResourceBarrier((UINT)scratch.size(), scratch.data());
 }
\ No newline at end of file
@@ -4,10 +4,22 @@
 #include "FrameResource.h"
 #include "Camera.h"
 #include "CascadeShadowMap.h"
+#include "FrustumCuller.h"
+#include "DynamicUploadHeap.h"
+#include "ParallelCommandRecorder.h"
 #include "GBuffer.h"
 #include "GameFramework/Components/Scene.h"
 #include "GameFramework/Objects/SObject.h"
+#include "GameFramework/Components/TransformSystem.h"
 #include "RootSignature.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "ShaderPermutations.h"
+#include "LightClusters.h"
+#include "LightVolumeClassifier.h"
+#include "LightManager.h"
+#include "SpotLightCuller.h"
+#include "RenderGraph.h"
 
 const int gNumFrameResources = 3;
 
@@ -59,6 +71,8 @@ struct Material
 // F. Luna stuff: lightweight structure that stores parameters to draw a shape.
 struct RenderItem
 {
+    static constexpr UINT InvalidCullingIndex = UINT_MAX;
+
     RenderItem(int objectCBIndex = -1)
         : ObjCBIndex(objectCBIndex)
     {
@@ -70,14 +84,24 @@ struct RenderItem
 
     BoundingBox Bounds;
     std::vector<InstanceData> Instances; // for spot and point lights for now
+    // Instances of the current frame in the dynamic upload heap.
+    D3D12_GPU_VIRTUAL_ADDRESS InstancesSBAddress = 0u;
     
     int NumFramesDirty = gNumFrameResources;
 
     // Index into GPU constant buffer corresponding to the ObjectCB for this render item.
     UINT ObjCBIndex = -1;
 
+    // Index of the item's world bounds in the frustum culler, InvalidCullingIndex if the item is not culled.
+    UINT CullingIndex = InvalidCullingIndex;
+    // Whether the item is already in the engine's dirty list.
+    bool IsInDirtyList = false;
+
     MeshGeometry* Geo = nullptr;
     Material* Mat = nullptr;
+    // Source of the draw arguments, when the item has LODs they are switched every frame.
+    const SubmeshGeometry* Submesh = nullptr;
+    UINT LODIndex = 0u;
 
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopologyType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -95,6 +119,7 @@ public:
     enum ERootParameter : UINT
     {
         PerObjectDataCB = 0,
+        PerDrawConstants,
         PerPassDataCB,
         MaterialDataSB,
         PointLightsDataSB,
@@ -103,8 +128,10 @@ public:
         GBufferTextures,
         SkyBox,
         Textures,
+        ClusterLightRangesSB,
+        ClusterLightIndicesSB,
 
-        NumRootParameters = 9u
+        NumRootParameters = 12u
     };
 
     enum EPsoType : UINT
@@ -118,12 +145,14 @@ public:
         DeferredPointWithinFrustum,
         DeferredPointIntersectsFarPlane,
         DeferredPointFullQuad,
+        DeferredPointClustered,
         DeferredSpot,
+        DeferredSpotInsideVolume,
 
         Transparency,
         Sky,
         
-        NumPipelineStates = 10u
+        NumPipelineStates = 12u
     };
 
     enum EShaderType : UINT
@@ -140,12 +169,23 @@ public:
         DeferredDirVS,
         DeferredDirPS,
         DeferredLightVolumesVS,
+        DeferredLightQuadVS,
+        DeferredSpotLightVolumesVS,
         DeferredPointPS,
+        DeferredClusteredPointPS,
         DeferredSpotPS,
         SkyBoxVS,
         SkyBoxPS,
 
-        NumShaders = 13U
+        NumShaders = 16U
+    };
+
+    // Feature bits of the lit pixel shaders, see ShaderPermutations.
+    enum EShaderFeature : UINT
+    {
+        AlphaTest = 1u << 0u,
+        Fog = 1u << 1u,
+        ShadowDebug = 1u << 2u,
     };
 
 public:
@@ -165,24 +205,48 @@ public:
 
 private:
     void OnKeyboardInput(const ScaldTimer& st);
+    // Propagates changed transforms into the objects' staging CB and world matrices of their items.
+    void UpdateTransforms(const ScaldTimer& st);
+    void UpdateFrustumCulling(const ScaldTimer& st);
+    // Picks LODs of opaque items by their projected size on screen.
+    void UpdateLODSelection(const ScaldTimer& st);
+    // Requests mips of the visible items' textures, has to run before UpdateMaterialBuffer.
+    void UpdateTextureStreaming(const ScaldTimer& st);
     void UpdateObjectsCB(const ScaldTimer& st);
+    // Has to be called whenever TexTransform or material of an item is changed. World changes come from its Transform.
+    void MarkRenderItemDirty(RenderItem* ri);
     void UpdateMaterialBuffer(const ScaldTimer& st);
     void UpdateLightsBuffer(const ScaldTimer& st);
+    // Bins the point lights into the camera's clusters, has to run after UpdateLightsBuffer.
+    void UpdateLightClusters(const ScaldTimer& st);
+    // Sorts the point light volumes by the PSO they are drawn with, has to run after UpdateLightsBuffer.
+    void UpdatePointLightVolumes(const ScaldTimer& st);
+    // Culls the spot light cones and batches the visible ones by the faces they are drawn with.
+    void UpdateSpotLights(const ScaldTimer& st);
     void UpdateShadowTransform(const ScaldTimer& st);
+    void UpdateShadowCastersCulling(const ScaldTimer& st);
     void UpdateShadowPassCB(const ScaldTimer& st);
     void UpdateGeometryPassCB(const ScaldTimer& st);
     void UpdateMainPassCB(const ScaldTimer& st);
     
 private:
+    // Root signature and descriptor heaps, has to be set on every command list.
+    void BindCommonState(ID3D12GraphicsCommandList* pCommandList);
+
 #pragma region Shadows
     void RenderDepthOnlyPass(ID3D12GraphicsCommandList* pCommandList);
+    void BindDepthOnlyPassState(ID3D12GraphicsCommandList* pCommandList);
+    void BeginDepthOnlyPass(ID3D12GraphicsCommandList* pCommandList);
 #pragma endregion Shadows
 #pragma region DeferredShading
     void RenderGeometryPass(ID3D12GraphicsCommandList* pCommandList);
+    void BindGeometryPassState(ID3D12GraphicsCommandList* pCommandList);
+    void BeginGeometryPass(ID3D12GraphicsCommandList* pCommandList);
     void RenderLightingPass(ID3D12GraphicsCommandList* pCommandList);
 
     void DeferredDirectionalLightPass(ID3D12GraphicsCommandList* pCommandList);
     void DeferredPointLightPass(ID3D12GraphicsCommandList* pCommandList);
+    void DeferredClusteredPointLightPass(ID3D12GraphicsCommandList* pCommandList);
     void DeferredSpotLightPass(ID3D12GraphicsCommandList* pCommandList);
 
     void RenderForwardPasses(ID3D12GraphicsCommandList* pCommandList);
@@ -192,8 +256,19 @@ private:
 
     void DrawRenderItem(ID3D12GraphicsCommandList* pCommandList, std::unique_ptr<RenderItem>& renderItem);
     void DrawRenderItems(ID3D12GraphicsCommandList* pCommandList, std::vector<std::unique_ptr<RenderItem>>& renderItems);
+    void DrawRenderItems(ID3D12GraphicsCommandList* pCommandList, RenderItem* const* ppRenderItems, size_t count);
+    // Draws m_shadowCasterItems[begin, end)
+    void DrawShadowCasters(ID3D12GraphicsCommandList* pCommandList, size_t begin, size_t end);
     void DrawInstancedRenderItems(ID3D12GraphicsCommandList* pCommandList, std::vector<std::unique_ptr<RenderItem>>& renderItems);
 
+#pragma region RenderGraph
+    ID3D12Resource* GetRenderGraphResource(UINT resource);
+    D3D12_RESOURCE_ALLOCATION_INFO GetRenderGraphAllocationInfo(UINT resource);
+    // Records the graph's barriers of the pass in a single ResourceBarrier call, NumRenderGraphPasses records the end of the frame ones.
+    void RecordRenderGraphBarriers(ID3D12GraphicsCommandList* pCommandList, UINT pass);
+    void RecordRenderGraphBarriers(ID3D12GraphicsCommandList* pCommandList, const std::vector<RenderGraphBarrier>& barriers, std::vector<D3D12_RESOURCE_BARRIER>& scratch);
+#pragma endregion RenderGraph
+
 private:
     std::vector<std::unique_ptr<FrameResource>> m_frameResources;
     FrameResource* m_currFrameResource = nullptr;
@@ -201,15 +276,22 @@ private:
 
     UINT m_passCbvOffset = 0u;
 
+    // Transient per-frame data (pass constants, lights). Sized to hold all frames in flight.
+    static constexpr UINT64 DynamicUploadHeapSize = 16u * 1024u * 1024u;
+    std::unique_ptr<DynamicUploadHeap> m_dynamicUploadHeap;
+    std::array<D3D12_GPU_VIRTUAL_ADDRESS, static_cast<UINT>(EPassType::NumPasses)> m_passCBAddresses = {};
+
     float m_sunPhi = XM_PI / 3;
     float m_sunTheta = 1.25f * XM_PI;
     
     std::shared_ptr<RootSignature> m_rootSignature;
 
     std::unordered_map<EShaderType, ComPtr<ID3DBlob>> m_shaders;
+    static constexpr const wchar_t* ShaderCacheDirectory = L"./ShaderCache";
+    std::unique_ptr<ShaderCache> m_shaderCache;
+    std::unique_ptr<ShaderPermutations> m_shaderPermutations;
     std::unordered_map<EPsoType, ComPtr<ID3D12PipelineState>> m_pipelineStates;
 
-    ObjectConstants m_perObjectCBData;
     PassConstants m_shadowPassCBData;
     PassConstants m_geometryPassCBData;
     PassConstants m_mainPassCBData; // deferred color(light) pass
@@ -220,17 +302,103 @@ private:
     std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> m_geometries;
     std::unordered_map<std::string, std::unique_ptr<Material>> m_materials;
 
+    // Declared before the textures, which may reference its mapping.
+    static constexpr const wchar_t* AssetArchiveFileName = L"./Assets.pak";
+    std::unique_ptr<AssetArchive> m_assetArchive;
+
     std::unordered_map<std::string, std::unique_ptr<Texture>> m_diffuseTextures;
     std::unordered_map<std::string, std::unique_ptr<Texture>> m_normalTextures;
     std::unordered_map<std::string, std::unique_ptr<Texture>> m_skyTextures;
+    std::unique_ptr<TextureLoader> m_textureLoader;
+
+    // Mips of material textures are streamed under this budget.
+    static constexpr UINT64 TextureStreamingBudget = 32u * 1024u * 1024u;
+    // Streamed textures own two slots of their table: a new resource is viewed through the one in-flight frames do not use.
+    static constexpr UINT StreamingSrvSlotOffset = TextureMapsMaxCount / 2u;
+    struct StreamedTextureView
+    {
+        Texture* pTexture = nullptr;
+        bool bIsNormalMap = false;
+        // Slot the materials currently use, relative to the diffuse or normal table.
+        UINT Slot = 0u;
+    };
+    struct PendingTextureRelease
+    {
+        UINT Handle = 0u;
+        UINT64 FenceValue = 0u;
+        ComPtr<ID3D12Resource> Resource;
+    };
+    std::unique_ptr<TextureStreamer> m_textureStreamer;
+    // Indexed by streamer handle.
+    std::vector<StreamedTextureView> m_streamedTextures;
+    // Streamer handles indexed by the first slot of a texture.
+    std::vector<UINT> m_diffuseStreamingHandles;
+    std::vector<UINT> m_normalStreamingHandles;
+    std::deque<PendingTextureRelease> m_pendingTextureReleases;
+    std::vector<TextureStreamingRequest> m_streamingRequests;
 
     std::vector<std::unique_ptr<RenderItem>> m_renderItems;
     std::unique_ptr<RenderItem> m_skyRenderItem;
 
     std::vector<Scald::SObject> m_sceneObjects;
     std::vector<std::unique_ptr<RenderItem>> m_pointLights;
+    std::vector<std::unique_ptr<RenderItem>> m_spotLights;
     std::vector<RenderItem*> m_opaqueItems;
 
+#pragma region ObjectsUpload
+    // Items with NumFramesDirty > 0, so clean items are never visited.
+    std::vector<RenderItem*> m_dirtyRenderItems;
+    bool m_isDirtyListSorted = true;
+
+    // CPU copy of the objects' CB with the same layout, so contiguous dirty ranges are uploaded with a single memcpy.
+    std::vector<PaddedObjectConstants> m_objectsCBStaging;
+
+    Scald::TransformSystem m_transformSystem;
+    // Every item (sky included) is indexed by its ObjCBIndex.
+    std::vector<RenderItem*> m_renderItemsByObjCBIndex;
+    std::vector<UINT> m_changedObjCBIndices;
+#pragma endregion ObjectsUpload
+
+#pragma region FrustumCulling
+    // World space bounds of m_opaqueItems, indexed the same way.
+    FrustumCuller m_frustumCuller;
+    std::vector<UINT> m_visibleIndices;
+    std::vector<RenderItem*> m_visibleOpaqueItems;
+
+    // Projected size (bounding sphere diameter over screen height) under which the item switches to LOD 1.
+    // Every next LOD kicks in at half the size of the previous one.
+    static constexpr float LOD1ScreenSize = 0.5f;
+
+    // Light space volumes of the cascades, built along with the shadow transforms.
+    std::array<CullingVolume, MaxCascades> m_cascadeCullingVolumes;
+    // Bit i is set if an item overlaps cascade i (indexed as m_opaqueItems).
+    std::vector<UINT> m_cascadeMasks;
+    // Items overlapping at least one cascade, with their cascade masks (drawn once, GS emits only to masked cascades).
+    std::vector<RenderItem*> m_shadowCasterItems;
+    std::vector<UINT> m_shadowCasterMasks;
+#pragma endregion FrustumCulling
+
+#pragma region ParallelRecording
+    enum ERecordingPass : UINT
+    {
+        ShadowDepth = 0u,
+        GBufferGeometry,
+        LightingAndForward,
+        NumRecordingPasses
+    };
+
+    // Upper bound of command lists recorded per frame, every frame resource has an allocator per task.
+    static constexpr UINT MaxRecordingTasks = 8u;
+    // Serial mode records everything into a single command list on the render thread.
+    bool m_isParallelRecordingEnabled = true;
+
+    ParallelCommandRecorder<ID3D12GraphicsCommandList> m_commandRecorder;
+    std::vector<ParallelCommandRecorder<ID3D12GraphicsCommandList>::Pass> m_recordingPasses;
+    // Indexed as the recorder's tasks, submitted in this order.
+    std::vector<ComPtr<ID3D12GraphicsCommandList2>> m_recordingCommandLists;
+    std::vector<ID3D12GraphicsCommandList*> m_recordingCommandListPtrs;
+#pragma endregion ParallelRecording
+
     std::unique_ptr<Camera> m_camera;
     std::shared_ptr<Scald::Scene> m_scene;
 
@@ -239,9 +407,48 @@ private:
     UINT m_GBufferTexturesSrvHeapStartIndex = 0u;
 #pragma endregion DeferredShading
 
+#pragma region PointLights
+    // Point lights with stable handles, packed in the order of their structured buffer.
+    std::unique_ptr<LightManager> m_lightManager;
+#pragma endregion PointLights
+
+#pragma region ClusteredLighting
+    // Point lights are shaded in a single full screen pass from per-cluster light lists, otherwise by drawing their volumes.
+    bool m_isClusteredLightingEnabled = true;
+    LightClusters m_lightClusters;
+    // View space bounding spheres of all point light instances, in the order of the point lights' structured buffer.
+    std::vector<XMFLOAT4> m_pointLightSpheres;
+    // Light manager's copy of the point light instances for the current frame, the items' InstancesSBAddress point to it.
+    D3D12_GPU_VIRTUAL_ADDRESS m_pointLightsSBAddress = 0u;
+    D3D12_GPU_VIRTUAL_ADDRESS m_clusterLightRangesSBAddress = 0u;
+    D3D12_GPU_VIRTUAL_ADDRESS m_clusterLightIndicesSBAddress = 0u;
+#pragma endregion ClusteredLighting
+
+#pragma region LightVolumes
+    LightVolumeClassifier m_lightVolumeClassifier;
+    // Instances of every visible class, each class is contiguous.
+    std::array<D3D12_GPU_VIRTUAL_ADDRESS, LightVolumeClassifier::NumClasses> m_pointLightVolumesSBAddresses = {};
+#pragma endregion LightVolumes
+
+#pragma region SpotLights
+    enum ESpotLightBatch : UINT
+    {
+        // In front of the near plane, front faces bound the lit pixels.
+        SpotLightsOutsideCone = 0,
+        // Crossing the near plane (the camera may be inside of the cone), drawn with back faces.
+        SpotLightsInsideCone,
+
+        NumSpotLightBatches
+    };
+    // Indices into the spot light item's instances, visible ones only.
+    std::array<std::vector<UINT>, NumSpotLightBatches> m_visibleSpotLights;
+    std::array<LightScissorRect, NumSpotLightBatches> m_spotLightScissorRects;
+    std::array<D3D12_GPU_VIRTUAL_ADDRESS, NumSpotLightBatches> m_spotLightsSBAddresses = {};
+#pragma endregion SpotLights
+
 #pragma region CascadedShadows
     UINT m_cascadesShadowSrvHeapStartIndex = 0;
-    std::unique_ptr<ShadowMap> m_cascadeShadowMap;
+    std::unique_ptr<CascadeShadowMap> m_cascadeShadowMap;
 #pragma endregion CascadedShadows
 
 #pragma region TexturesAndSky
@@ -250,7 +457,31 @@ private:
     UINT m_normalSrvHeapStartIndex = 0u;
 #pragma endregion TexturesAndSky
 
-    void TransitionResource(ID3D12GraphicsCommandList* pCommandList, ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter);
+#pragma region RenderGraph
+    enum ERenderGraphPass : UINT
+    {
+        RenderGraphShadowDepth = 0u,
+        RenderGraphGeometry,
+        RenderGraphLighting,
+        RenderGraphSkyBox,
+        NumRenderGraphPasses
+    };
+
+    // GBuffer layers come first, indexed as EGBufferLayer.
+    enum ERenderGraphResource : UINT
+    {
+        RenderGraphShadowMap = GBuffer::EGBufferLayer::MAX,
+        RenderGraphBackBuffer,
+        NumRenderGraphResources
+    };
+
+    // Passes declare the states they need their resources in, the graph's barriers replace per-pass transitions.
+    RenderGraph m_renderGraph;
+    // Transients are placed in it at the offsets the graph compiled
+    ComPtr<ID3D12Heap> m_renderGraphHeap;
+    // A pass is recorded by a single task, so every pass (and the end of the frame) has its own scratch.
+    std::array<std::vector<D3D12_RESOURCE_BARRIER>, NumRenderGraphPasses + 1u> m_renderGraphBarriers;
+#pragma endregion RenderGraph
 
 private:
     VOID LoadPipeline() override;
@@ -267,7 +498,12 @@ private:
     VOID CreatePSO();
     
     VOID LoadScene();
-    VOID LoadTextures(ID3D12GraphicsCommandList* pCommandList);
+    // Textures are loaded in the background, their SRVs are written once they are resident.
+    VOID LoadTextures();
+    VOID CreateTextureSrv(const Texture& texture, UINT heapIndex);
+    VOID RegisterStreamedTexture(Texture& texture, bool bIsNormalMap, UINT slot);
+    // Switches materials to the new resource of a streamed texture.
+    VOID OnStreamedMipsLoaded(UINT handle, Texture& texture);
     // Shapes
     VOID CreateGeometry(ID3D12GraphicsCommandList* pCommandList);
     // Propertirs of shapes' surfaces to model light interaction
@@ -276,15 +512,18 @@ private:
     VOID CreateSceneObjects();
     VOID CreateRenderItems();
     VOID CreatePointLights(ID3D12GraphicsCommandList* pCommandList);
+    VOID CreateSpotLights(ID3D12GraphicsCommandList* pCommandList);
     VOID CreateFrameResources();
     // Heaps are created if there are root descriptor tables in root signature 
     VOID CreateSrvAndSamplerDescriptorHeaps();
+    // Splits the frame into passes for the parallel recorder
+    VOID CreateRecordingPasses();
+    // Declares the frame's passes with the resources they use, compiles it and records the one-time setup barriers.
+    VOID CreateRenderGraph(ID3D12GraphicsCommandList* pCommandList);
+    // Recreates the transients in a new heap at the compiled offsets and records their setup barriers.
+    VOID PlaceRenderGraphTransients(ID3D12GraphicsCommandList* pCommandList);
 
     VOID PopulateCommandList(ID3D12GraphicsCommandList* pCommandList);
-
-    std::pair<XMMATRIX, XMMATRIX> GetLightSpaceMatrix(const float nearPlane, const float farPlane);
-    // Doubt that't a good idea to return vector of matrices. Should rather pass vector as a parameter probalby and fill it inside function.
-    void GetLightSpaceMatrices(std::vector<std::pair<XMMATRIX, XMMATRIX>>& outMatrices);
-
-    std::vector<XMVECTOR> GetFrustumCornersWorldSpace(const XMMATRIX& view, const XMMATRIX& projection);
+    // Records the frame on worker threads into per-task command lists and submits them in order.
+    VOID RecordCommandListsParallel();
 };
\ No newline at end of file
@@ -4,18 +4,20 @@
 
 struct FrameResource
 {
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT pointLightsCount);
+    FrameResource(ID3D12Device* device, UINT objectCount, UINT materialCount, UINT recordingTaskCount);
     FrameResource(const FrameResource& lhs) = delete;
     FrameResource& operator=(const FrameResource& lhs) = delete;
 
     ~FrameResource();
 
     ComPtr<ID3D12CommandAllocator> commandAllocator;
+    // One per parallel recording task, so every recording thread allocates from its own allocator.
+    // Together with the other frame resources they form a ring, an allocator is reset only after its frame has been completed.
+    std::vector<ComPtr<ID3D12CommandAllocator>> RecordingAllocators;
 
+    // Persistent data, updated only when dirty. Per-frame data (passes, lights) lives in the engine's DynamicUploadHeap.
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectsCB = nullptr;
-    std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     std::unique_ptr<UploadBuffer<MaterialData>> MaterialSB = nullptr;
-    std::unique_ptr<UploadBuffer<InstanceData>> PointLightSB = nullptr;
     
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
@@ -0,0 +1,211 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+#include <cfloat>
+#include <cstring>
+
+CullingVolume CullingVolume::FromFrustum(const BoundingFrustum& frustum)
+{
+	XMVECTOR planes[MaxPlanes];
+	frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+	CullingVolume volume;
+	for (UINT i = 0; i < MaxPlanes; ++i)
+	{
+		XMStoreFloat4(&volume.Planes[i], planes[i]);
+	}
+	volume.NumPlanes = MaxPlanes;
+	return volume;
+}
+
+CullingVolume CullingVolume::FromViewProjection(const XMMATRIX& viewProj, bool bIncludeNearPlane)
+{
+	// Gribb-Hartmann: with clip = p * M, the clip space inequalities are combinations of matrix columns.
+	const XMMATRIX m = XMMatrixTranspose(viewProj);
+	const XMVECTOR colX = m.r[0];
+	const XMVECTOR colY = m.r[1];
+	const XMVECTOR colZ = m.r[2];
+	const XMVECTOR colW = m.r[3];
+
+	// Inward facing planes, -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	XMVECTOR planes[MaxPlanes];
+	UINT numPlanes = 0u;
+	planes[numPlanes++] = XMVectorAdd(colW, colX);		// left
+	planes[numPlanes++] = XMVectorSubtract(colW, colX);	// right
+	planes[numPlanes++] = XMVectorAdd(colW, colY);		// bottom
+	planes[numPlanes++] = XMVectorSubtract(colW, colY);	// top
+	planes[numPlanes++] = XMVectorSubtract(colW, colZ);	// far
+	if (bIncludeNearPlane)
+	{
+		planes[numPlanes++] = colZ;						// near
+	}
+
+	CullingVolume volume;
+	for (UINT i = 0; i < numPlanes; ++i)
+	{
+		// Flip to outward facing normals to match FromFrustum convention.
+		XMStoreFloat4(&volume.Planes[i], XMVectorNegate(XMPlaneNormalize(planes[i])));
+	}
+	volume.NumPlanes = numPlanes;
+	return volume;
+}
+
+void FrustumCuller::Resize(UINT count)
+{
+	const UINT paddedCount = (count + SimdWidth - 1u) & ~(SimdWidth - 1u);
+
+	m_centerX.resize(paddedCount, 0.0f);
+	m_centerY.resize(paddedCount, 0.0f);
+	m_centerZ.resize(paddedCount, 0.0f);
+	m_extentX.resize(paddedCount, -FLT_MAX);
+	m_extentY.resize(paddedCount, -FLT_MAX);
+	m_extentZ.resize(paddedCount, -FLT_MAX);
+
+	// Shrinking leaves stale boxes in the padded tail, so invalidate it explicitly.
+	for (UINT i = count; i < paddedCount; ++i)
+	{
+		m_extentX[i] = m_extentY[i] = m_extentZ[i] = -FLT_MAX;
+	}
+
+	m_count = count;
+}
+
+void FrustumCuller::SetBounds(UINT index, const BoundingBox& worldBounds)
+{
+	assert(index < m_count);
+
+	m_centerX[index] = worldBounds.Center.x;
+	m_centerY[index] = worldBounds.Center.y;
+	m_centerZ[index] = worldBounds.Center.z;
+	m_extentX[index] = worldBounds.Extents.x;
+	m_extentY[index] = worldBounds.Extents.y;
+	m_extentZ[index] = worldBounds.Extents.z;
+}
+
+void FrustumCuller::Cull(const CullingVolume& volume, std::vector<UINT>& outVisible) const
+{
+	const UINT paddedCount = (UINT)m_centerX.size();
+
+	// Every worker writes into its own region of the output, so the worst case (everything is visible) must fit.
+	outVisible.resize(paddedCount);
+
+	if (paddedCount < ParallelThreshold)
+	{
+		outVisible.resize(CullRange(volume, 0u, paddedCount, outVisible.data()));
+		return;
+	}
+
+	const UINT numChunks = (paddedCount + ChunkSize - 1u) / ChunkSize;
+	m_chunkVisibleCounts.resize(numChunks);
+
+	JobSystem::Get().ParallelFor(numChunks, 1u, [this, &volume, &outVisible, paddedCount](UINT firstChunk, UINT lastChunk)
+		{
+			for (UINT chunk = firstChunk; chunk < lastChunk; ++chunk)
+			{
+				const UINT begin = chunk * ChunkSize;
+				const UINT end = ScaldMath::Min(begin + ChunkSize, paddedCount);
+				m_chunkVisibleCounts[chunk] = CullRange(volume, begin, end, outVisible.data() + begin);
+			}
+		});
+
+	// Compact chunk results in order, so the visible list stays sorted.
+	UINT visibleCount = m_chunkVisibleCounts[0];
+	for (UINT chunk = 1u; chunk < numChunks; ++chunk)
+	{
+		memmove(outVisible.data() + visibleCount, outVisible.data() + chunk * ChunkSize, m_chunkVisibleCounts[chunk] * sizeof(UINT));
+		visibleCount += m_chunkVisibleCounts[chunk];
+	}
+
+	outVisible.resize(visibleCount);
+}
+
+void FrustumCuller::CullMasks(const CullingVolume* volumes, UINT numVolumes, std::vector<UINT>& outMasks) const
+{
+	assert(numVolumes <= 32u);
+
+	const UINT paddedCount = (UINT)m_centerX.size();
+	// Padded to avoid tail handling, the padded lanes are always zero.
+	outMasks.assign(paddedCount, 0u);
+
+	for (UINT v = 0; v < numVolumes; ++v)
+	{
+		SplatPlanes planes;
+		LoadPlanes(volumes[v], planes);
+
+		const XMVECTOR bit = XMVectorReplicateInt(1u << v);
+
+		for (UINT i = 0; i < paddedCount; i += SimdWidth)
+		{
+			XMVECTOR masks = XMLoadInt4(&outMasks[i]);
+			masks = XMVectorOrInt(masks, XMVectorAndCInt(bit, TestOutside(planes, i)));
+			XMStoreInt4(&outMasks[i], masks);
+		}
+	}
+
+	outMasks.resize(m_count);
+}
+
+void FrustumCuller::LoadPlanes(const CullingVolume& volume, SplatPlanes& outPlanes)
+{
+	for (UINT p = 0; p < volume.NumPlanes; ++p)
+	{
+		outPlanes.X[p] = XMVectorReplicate(volume.Planes[p].x);
+		outPlanes.Y[p] = XMVectorReplicate(volume.Planes[p].y);
+		outPlanes.Z[p] = XMVectorReplicate(volume.Planes[p].z);
+		outPlanes.D[p] = XMVectorReplicate(volume.Planes[p].w);
+		outPlanes.AbsX[p] = XMVectorAbs(outPlanes.X[p]);
+		outPlanes.AbsY[p] = XMVectorAbs(outPlanes.Y[p]);
+		outPlanes.AbsZ[p] = XMVectorAbs(outPlanes.Z[p]);
+	}
+	outPlanes.NumPlanes = volume.NumPlanes;
+}
+
+XMVECTOR FrustumCuller::TestOutside(const SplatPlanes& planes, UINT i) const
+{
+	const XMVECTOR centerX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_centerX[i]));
+	const XMVECTOR centerY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_centerY[i]));
+	const XMVECTOR centerZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_centerZ[i]));
+	const XMVECTOR extentX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_extentX[i]));
+	const XMVECTOR extentY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_extentY[i]));
+	const XMVECTOR extentZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_extentZ[i]));
+
+	XMVECTOR outsideMask = XMVectorFalseInt();
+	for (UINT p = 0; p < planes.NumPlanes; ++p)
+	{
+		// Signed distance from box center to plane vs. projected radius of the box onto the plane normal.
+		XMVECTOR distance = XMVectorMultiplyAdd(centerX, planes.X[p], planes.D[p]);
+		distance = XMVectorMultiplyAdd(centerY, planes.Y[p], distance);
+		distance = XMVectorMultiplyAdd(centerZ, planes.Z[p], distance);
+
+		XMVECTOR radius = XMVectorMultiply(extentX, planes.AbsX[p]);
+		radius = XMVectorMultiplyAdd(extentY, planes.AbsY[p], radius);
+		radius = XMVectorMultiplyAdd(extentZ, planes.AbsZ[p], radius);
+
+		outsideMask = XMVectorOrInt(outsideMask, XMVectorGreater(distance, radius));
+	}
+
+	return outsideMask;
+}
+
+UINT FrustumCuller::CullRange(const CullingVolume& volume, UINT begin, UINT end, UINT* outIndices) const
+{
+	SplatPlanes planes;
+	LoadPlanes(volume, planes);
+
+	UINT visibleCount = 0u;
+	uint32_t outside[SimdWidth];
+
+	for (UINT i = begin; i < end; i += SimdWidth)
+	{
+		XMStoreInt4(outside, TestOutside(planes, i));
+
+		// Branchless compaction
+		for (UINT lane = 0; lane < SimdWidth; ++lane)
+		{
+			outIndices[visibleCount] = i + lane;
+			visibleCount += (outside[lane] == 0u) ? 1u : 0u;
+		}
+	}
+
+	return visibleCount;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Common/ScaldMath.h"
+
+// Convex volume used for culling. Planes are stored as (nx, ny, nz, d) with normals pointing out of the volume,
+// so a point p is outside of a plane if dot(n, p) + d > 0 (same convention as DirectX::BoundingFrustum::GetPlanes).
+struct CullingVolume
+{
+	static constexpr UINT MaxPlanes = 6u;
+
+	XMFLOAT4 Planes[MaxPlanes];
+	UINT NumPlanes = 0u;
+
+	static CullingVolume FromFrustum(const BoundingFrustum& frustum);
+	// Extracts planes from a (row-vector) view-projection matrix.
+	// The near plane can be skipped for depth clamped passes (e.g. shadow pancaking), where casters in front of it still render.
+	static CullingVolume FromViewProjection(const XMMATRIX& viewProj, bool bIncludeNearPlane = true);
+};
+
+class FrustumCuller
+{
+public:
+	FrustumCuller() = default;
+	FrustumCuller(const FrustumCuller& lhs) = delete;
+	FrustumCuller& operator=(const FrustumCuller& lhs) = delete;
+
+	~FrustumCuller() noexcept = default;
+
+public:
+	FORCEINLINE UINT GetCount() const { return m_count; }
+
+	// Resizes bounds storage. New boxes are empty and culled until SetBounds is called for them.
+	void Resize(UINT count);
+	void SetBounds(UINT index, const BoundingBox& worldBounds);
+
+	// Writes indices of boxes intersecting the volume into outVisible. Indices are in ascending order.
+	void Cull(const CullingVolume& volume, std::vector<UINT>& outVisible) const;
+
+	// Tests every box against each of the volumes. Bit i of outMasks[box] is set if the box intersects volumes[i].
+	void CullMasks(const CullingVolume* volumes, UINT numVolumes, std::vector<UINT>& outMasks) const;
+
+private:
+	// Planes splatted across SIMD lanes, so tests are pure vertical SIMD over SimdWidth boxes at a time.
+	struct SplatPlanes
+	{
+		XMVECTOR X[CullingVolume::MaxPlanes];
+		XMVECTOR Y[CullingVolume::MaxPlanes];
+		XMVECTOR Z[CullingVolume::MaxPlanes];
+		XMVECTOR D[CullingVolume::MaxPlanes];
+		XMVECTOR AbsX[CullingVolume::MaxPlanes];
+		XMVECTOR AbsY[CullingVolume::MaxPlanes];
+		XMVECTOR AbsZ[CullingVolume::MaxPlanes];
+		UINT NumPlanes = 0u;
+	};
+
+	static void LoadPlanes(const CullingVolume& volume, SplatPlanes& outPlanes);
+	// Returns all ones in lanes whose box (starting at index i) is fully outside of at least one plane.
+	XMVECTOR TestOutside(const SplatPlanes& planes, UINT i) const;
+
+	// Tests [begin, end) boxes (begin and end are multiples of SimdWidth) and returns the number of visible indices written.
+	UINT CullRange(const CullingVolume& volume, UINT begin, UINT end, UINT* outIndices) const;
+
+private:
+	static constexpr UINT SimdWidth = 4u;
+	// Below this count the job of spawning workers costs more than the culling itself.
+	static constexpr UINT ParallelThreshold = 8192u;
+	// Boxes per job, multiple of SimdWidth
+	static constexpr UINT ChunkSize = 2048u;
+
+	UINT m_count = 0u;
+
+	// Scratch, visible count of every chunk of a parallel Cull
+	mutable std::vector<UINT> m_chunkVisibleCounts;
+
+	// SoA bounds, padded to a multiple of SimdWidth. Padded lanes have negative extents, so they never pass the test.
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+};
@@ -19,6 +19,7 @@ void GBuffer::OnResize(UINT newWidth, UINT newHeight)
     {
         m_width = newWidth;
         m_height = newHeight;
+        m_heap = nullptr;
         
         CreateResources();
 
@@ -27,6 +28,17 @@ void GBuffer::OnResize(UINT newWidth, UINT newHeight)
     }
 }
 
+void GBuffer::PlaceResources(ID3D12Heap* pHeap, const UINT64 (&heapOffsets)[EGBufferLayer::MAX])
+{
+    assert(pHeap);
+
+    m_heap = pHeap;
+    memcpy(m_heapOffsets, heapOffsets, sizeof(m_heapOffsets));
+
+    CreateResources();
+    CreateDescriptors();
+}
+
 ID3D12Resource* GBuffer::Get(unsigned layer)
 {
     return m_buffer[layer].m_resource.Get();
@@ -137,13 +149,7 @@ void GBuffer::CreateResources()
         else // To clear to zero
             memcpy(&optClear.Color[0], &m_optimizedClearColor[0], sizeof(optClear.Color));
     
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &texDesc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            &optClear,
-            IID_PPV_ARGS(&m_buffer[i].m_resource)));
+        CreateResource(i, texDesc, optClear);
     }
 
     auto depthIndex = static_cast<UINT>(EGBufferLayer::DEPTH);
@@ -155,18 +161,36 @@ void GBuffer::CreateResources()
     optClear.DepthStencil.Depth = 1.0f;
     optClear.DepthStencil.Stencil = (UINT8)0;
 
-    ThrowIfFailed(m_device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &texDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        &optClear,
-        IID_PPV_ARGS(&m_buffer[depthIndex].m_resource)));
+    CreateResource(depthIndex, texDesc, optClear);
 
     SCALD_NAME_D3D12_OBJECT(m_buffer[DIFFUSE_ALBEDO].m_resource, L"Diffuse Albedo");
-    SCALD_NAME_D3D12_OBJECT(m_buffer[AMBIENT_OCCLUSION].m_resource, L"World Position"); // SSAO will be
+    SCALD_NAME_D3D12_OBJECT(m_buffer[AMBIENT_OCCLUSION].m_resource, L"Ambient Occlusion");
     SCALD_NAME_D3D12_OBJECT(m_buffer[NORMAL].m_resource, L"Normal");
     SCALD_NAME_D3D12_OBJECT(m_buffer[SPECULAR].m_resource, L"Specular");
     SCALD_NAME_D3D12_OBJECT(m_buffer[MOTION_VECTORS].m_resource, L"Motion Vectors");
     SCALD_NAME_D3D12_OBJECT(m_buffer[DEPTH].m_resource, L"Depth");
+}
+
+void GBuffer::CreateResource(UINT layer, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE& optClear)
+{
+    if (m_heap)
+    {
+        ThrowIfFailed(m_device->CreatePlacedResource(
+            m_heap,
+            m_heapOffsets[layer],
+            &desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            &optClear,
+            IID_PPV_ARGS(&m_buffer[layer].m_resource)));
+    }
+    else
+    {
+        ThrowIfFailed(m_device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            &optClear,
+            IID_PPV_ARGS(&m_buffer[layer].m_resource)));
+    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Common/DXHelper.h"
+#include "GBufferPacking.h"
 
 struct FGBufferTexture
 {
@@ -35,8 +36,10 @@ public:
 	FORCEINLINE UINT GetWidth()const { return m_width; }
 	FORCEINLINE UINT GetHeight()const { return m_height; }
 
-	// if screen resized
+	// if screen resized. Placed layers don't fit their old offsets, so they are committed again until placed anew.
 	void OnResize(UINT newWidth, UINT newHeight);
+	// Recreates the layers as placed resources in the heap, one offset per layer. The heap has to outlive them.
+	void PlaceResources(ID3D12Heap* pHeap, const UINT64 (&heapOffsets)[EGBufferLayer::MAX]);
 
 	ID3D12Resource* Get(unsigned layer);
 	FGBufferTexture* GetBufferTexture(unsigned layer);
@@ -51,6 +54,7 @@ public:
 
 private:
 	void CreateResources();
+	void CreateResource(UINT layer, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE& optClear);
 
 private:
 	ID3D12Device* m_device = nullptr;
@@ -58,13 +62,16 @@ private:
 	UINT m_width, m_height;
 
 	FGBufferTexture m_buffer[EGBufferLayer::MAX];
+	// Committed resources if null
+	ID3D12Heap* m_heap = nullptr;
+	UINT64 m_heapOffsets[EGBufferLayer::MAX] = {};
 	// maybe better decision to create a map [EGBufferLayer, DXGI_FORMAT]
 	static constexpr DXGI_FORMAT m_bufferFormats[EGBufferLayer::MAX] = // order of DXGI_FORMAT should corresponds to EGBufferLayer 
 	{
 		DXGI_FORMAT_R8G8B8A8_UNORM,			//DIFFUSE_ALBEDO
-		DXGI_FORMAT_R8G8B8A8_UNORM,			//AMBIENT_OCCLUSION
-		DXGI_FORMAT_R32G32B32A32_FLOAT,		//NORMAL
-		DXGI_FORMAT_R8G8B8A8_UNORM,			//SPECULAR
+		DXGI_FORMAT_R8_UNORM,				//AMBIENT_OCCLUSION
+		GBufferPacking::NormalFormat,		//NORMAL. Octahedral normal and shininess
+		DXGI_FORMAT_R8G8B8A8_UNORM,			//SPECULAR. Fresnel R0, a is unused
 		DXGI_FORMAT_R16G16_FLOAT,			//MOTION_VECTORS
 		DXGI_FORMAT_D24_UNORM_S8_UINT		//DEPTH. Format for DSV (SRV demands R24...)
 	};
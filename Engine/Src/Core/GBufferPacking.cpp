@@ -0,0 +1,38 @@
+#include "GBufferPacking.h"
+#include "VertexCompression.h"
+
+#include <algorithm>
+
+namespace
+{
+	FORCEINLINE UINT QuantizeUNorm(float value)
+	{
+		return (UINT)(std::clamp(value, 0.0f, 1.0f) * GBufferPacking::ChannelMax + 0.5f);
+	}
+
+	FORCEINLINE float DequantizeUNorm(UINT packed, UINT channel)
+	{
+		return (float)((packed >> (channel * GBufferPacking::ChannelBits)) & GBufferPacking::ChannelMax) / GBufferPacking::ChannelMax;
+	}
+}
+
+UINT XM_CALLCONV GBufferPacking::PackNormal(FXMVECTOR normal, float shininess)
+{
+	// Octahedral coordinates from [-1, 1] to [0, 1]
+	const XMVECTOR encoded = XMVectorMultiplyAdd(VertexCompression::OctahedralEncode(normal), g_XMOneHalf, g_XMOneHalf);
+
+	return QuantizeUNorm(XMVectorGetX(encoded))
+		| (QuantizeUNorm(XMVectorGetY(encoded)) << ChannelBits)
+		| (QuantizeUNorm(shininess) << (2u * ChannelBits));
+}
+
+XMVECTOR XM_CALLCONV GBufferPacking::UnpackNormal(UINT packed)
+{
+	const XMVECTOR encoded = XMVectorSet(DequantizeUNorm(packed, 0u), DequantizeUNorm(packed, 1u), 0.0f, 0.0f);
+	return VertexCompression::OctahedralDecode(XMVectorMultiplyAdd(encoded, g_XMTwo, g_XMNegativeOne));
+}
+
+float GBufferPacking::UnpackShininess(UINT packed)
+{
+	return DequantizeUNorm(packed, 2u);
+}
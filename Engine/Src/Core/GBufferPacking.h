@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Common/ScaldMath.h"
+#include "Common/ScaldD3DTypes.h"
+
+// Encoding of the GBuffer NORMAL layer, a R10G10B10A2_UNORM texel: the octahedral normal in r and g,
+// shininess in b, a is unused. Mirrors PackGBufferNormal/UnpackGBufferNormal in Common.hlsl,
+// PackNormal rounds to the nearest step like the render target write does.
+class GBufferPacking
+{
+public:
+	static constexpr DXGI_FORMAT NormalFormat = DXGI_FORMAT_R10G10B10A2_UNORM;
+	static constexpr UINT ChannelBits = 10u;
+	static constexpr UINT ChannelMax = (1u << ChannelBits) - 1u;
+
+	// Largest angle between a unit normal and its unpacked one, in radians (~0.24 degrees).
+	static constexpr float MaxNormalError = 0.0042f;
+	// Shininess comes back within half a step.
+	static constexpr float MaxShininessError = 0.5f / ChannelMax;
+
+	// The normal doesn't have to be unit length, shininess is clamped to [0, 1].
+	static UINT XM_CALLCONV PackNormal(FXMVECTOR normal, float shininess);
+	static XMVECTOR XM_CALLCONV UnpackNormal(UINT packed);
+	static float UnpackShininess(UINT packed);
+};
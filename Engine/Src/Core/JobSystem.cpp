@@ -0,0 +1,308 @@
+#include "JobSystem.h"
+
+namespace
+{
+	// Main thread and threads not owned by the job system use index 0.
+	thread_local UINT tls_threadIndex = 0u;
+	// Only the owner may push to and pop from a deque, foreign threads use the shared queue.
+	thread_local bool tls_isJobThread = false;
+}
+
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+void JobSystem::Init(UINT numWorkers)
+{
+	assert(!m_isRunning && "Job system is already initialized");
+
+	if (numWorkers == 0u)
+	{
+		const UINT numHardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = numHardwareThreads > 1u ? numHardwareThreads - 1u : 0u;
+	}
+
+	m_queues.clear();
+	for (UINT i = 0; i < numWorkers + 1u; ++i)
+	{
+		m_queues.push_back(std::make_unique<WorkStealingDeque<Job>>());
+	}
+
+	tls_threadIndex = 0u;
+	tls_isJobThread = true;
+	m_isRunning = true;
+
+	for (UINT i = 1; i <= numWorkers; ++i)
+	{
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	if (!m_isRunning)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_isRunning = false;
+	}
+	m_wakeCondition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+
+	// Anything left has been queued after the last wait, run it here, so counters still reach zero.
+	while (Job* pJob = TryGetJob())
+	{
+		Execute(pJob);
+	}
+	m_queues.clear();
+	tls_isJobThread = false;
+}
+
+UINT JobSystem::GetThreadIndex()
+{
+	return tls_threadIndex;
+}
+
+void JobSystem::Run(std::function<void()> func, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->m_numPending.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	// Not initialized (or already shut down), so just run it inline.
+	if (m_queues.empty())
+	{
+		func();
+		OnJobFinished(counter);
+		return;
+	}
+
+	Push(Job{ std::move(func), counter });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> func, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->m_numPending.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	{
+		// Checked under the lock, so the dependency can't reach zero between the check and adding the continuation.
+		std::lock_guard<std::mutex> lock(dependency.m_continuationsMutex);
+		if (!dependency.IsDone())
+		{
+			dependency.m_continuations.push_back(Job{ std::move(func), counter });
+			return;
+		}
+	}
+
+	if (m_queues.empty())
+	{
+		func();
+		OnJobFinished(counter);
+		return;
+	}
+
+	Push(Job{ std::move(func), counter });
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+	while (!counter.IsDone())
+	{
+		if (Job* pJob = TryGetJob())
+		{
+			Execute(pJob);
+			continue;
+		}
+
+		// Remaining jobs are being executed by other threads. Sleep until one of them finishes the counter,
+		// or pushes a job this thread could help with (which may be the one the counter waits for).
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		++m_numWaiters;
+		m_waitCondition.wait(lock, [this, &counter]() { return counter.IsDone() || m_numQueuedJobs.load(std::memory_order_acquire) > 0u; });
+		--m_numWaiters;
+	}
+
+	// The thread which finished the last job may still hold the lock, wait for it to leave, so the counter can be destroyed right after.
+	std::lock_guard<std::mutex> lock(counter.m_continuationsMutex);
+}
+
+JobSystemStats JobSystem::GetStats() const
+{
+	JobSystemStats stats;
+	stats.NumExecutedJobs = m_numExecutedJobs.load(std::memory_order_relaxed);
+	stats.NumStolenJobs = m_numStolenJobs.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void JobSystem::ResetStats()
+{
+	m_numExecutedJobs = 0u;
+	m_numStolenJobs = 0u;
+}
+
+void JobSystem::Push(Job&& job)
+{
+	Job* pJob = new Job(std::move(job));
+	if (tls_isJobThread)
+	{
+		m_queues[tls_threadIndex]->Push(pJob);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_foreignJobsMutex);
+		m_foreignJobs.push_back(pJob);
+	}
+
+	bool bHasWaiters = false;
+	{
+		// Increment under the wake mutex, otherwise a worker can check the count and fall asleep missing the notification.
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_numQueuedJobs.fetch_add(1u, std::memory_order_release);
+		bHasWaiters = m_numWaiters > 0u;
+	}
+	m_wakeCondition.notify_one();
+	if (bHasWaiters)
+	{
+		m_waitCondition.notify_all();
+	}
+}
+
+Job* JobSystem::TrySteal(UINT thiefIndex)
+{
+	const UINT numQueues = (UINT)m_queues.size();
+
+	// Start from the neighbour, so thieves don't all hammer the same victim. Foreign threads may steal from every deque.
+	const UINT first = tls_isJobThread ? 1u : 0u;
+	for (UINT i = first; i < numQueues; ++i)
+	{
+		// Oldest jobs are stolen, they tend to be the biggest ones in fork-join workloads.
+		if (Job* pJob = m_queues[(thiefIndex + i) % numQueues]->Steal())
+		{
+			m_numStolenJobs.fetch_add(1u, std::memory_order_relaxed);
+			return pJob;
+		}
+	}
+	return nullptr;
+}
+
+Job* JobSystem::TryGetJob()
+{
+	const UINT threadIndex = GetThreadIndex();
+
+	Job* pJob = tls_isJobThread ? m_queues[threadIndex]->Pop() : nullptr;
+	if (!pJob)
+	{
+		pJob = TrySteal(threadIndex);
+	}
+	if (!pJob)
+	{
+		std::lock_guard<std::mutex> lock(m_foreignJobsMutex);
+		if (!m_foreignJobs.empty())
+		{
+			pJob = m_foreignJobs.front();
+			m_foreignJobs.pop_front();
+		}
+	}
+
+	if (pJob)
+	{
+		m_numQueuedJobs.fetch_sub(1u, std::memory_order_acq_rel);
+	}
+	return pJob;
+}
+
+void JobSystem::Execute(Job* pJob)
+{
+	pJob->Func();
+	m_numExecutedJobs.fetch_add(1u, std::memory_order_relaxed);
+	OnJobFinished(pJob->Counter);
+	delete pJob;
+}
+
+void JobSystem::OnJobFinished(JobCounter* counter)
+{
+	if (!counter)
+	{
+		return;
+	}
+
+	std::vector<Job> continuations;
+	bool bIsDone = false;
+	{
+		// Decrement under the lock to pair with RunAfter's check.
+		std::lock_guard<std::mutex> lock(counter->m_continuationsMutex);
+		if (counter->m_numPending.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+		{
+			continuations.swap(counter->m_continuations);
+			bIsDone = true;
+		}
+	}
+
+	// Counter may be destroyed by its waiter from now on.
+	if (bIsDone)
+	{
+		NotifyWaiters();
+	}
+
+	for (Job& continuation : continuations)
+	{
+		if (m_queues.empty())
+		{
+			Execute(new Job(std::move(continuation)));
+		}
+		else
+		{
+			Push(std::move(continuation));
+		}
+	}
+}
+
+void JobSystem::NotifyWaiters()
+{
+	bool bHasWaiters = false;
+	{
+		// Waiters check the counter under this mutex, so they either see it done or are already asleep and get notified.
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		bHasWaiters = m_numWaiters > 0u;
+	}
+	if (bHasWaiters)
+	{
+		m_waitCondition.notify_all();
+	}
+}
+
+void JobSystem::WorkerLoop(UINT threadIndex)
+{
+	tls_threadIndex = threadIndex;
+
+	tls_isJobThread = true;
+
+	while (true)
+	{
+		if (Job* pJob = TryGetJob())
+		{
+			Execute(pJob);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wakeCondition.wait(lock, [this]() { return !m_isRunning || m_numQueuedJobs.load(std::memory_order_acquire) > 0u; });
+		if (!m_isRunning)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+#include "WorkStealingDeque.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+
+class JobCounter;
+
+struct Job
+{
+	std::function<void()> Func;
+	// Decremented once the job has finished, may be null.
+	JobCounter* Counter = nullptr;
+};
+
+// Tracks completion of a group of jobs. Jobs can be chained after a counter with JobSystem::RunAfter.
+// Counter must outlive all of the jobs referencing it.
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter& lhs) = delete;
+	JobCounter& operator=(const JobCounter& lhs) = delete;
+
+	~JobCounter() noexcept = default;
+
+	FORCEINLINE bool IsDone() const { return m_numPending.load(std::memory_order_acquire) == 0u; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<UINT> m_numPending = 0u;
+
+	// Jobs waiting for this counter to reach zero. Also guards the final decrement, see JobSystem::Wait.
+	mutable std::mutex m_continuationsMutex;
+	std::vector<Job> m_continuations;
+};
+
+struct JobSystemStats
+{
+	UINT64 NumExecutedJobs = 0u;
+	UINT64 NumStolenJobs = 0u;
+};
+
+// Work-stealing scheduler. Every thread (workers and the main thread) owns a lock-free Chase-Lev deque:
+// the owner pushes and pops jobs at the back (LIFO, cache friendly for fork-join), idle threads steal from the front of the others.
+// Threads not owned by the job system push into a shared locked queue instead. Jobs must not throw.
+class JobSystem
+{
+public:
+	static JobSystem& Get()
+	{
+		static JobSystem inst;
+		return inst;
+	}
+
+	// 0 workers means one per hardware thread except the calling one. The calling thread becomes thread 0.
+	void Init(UINT numWorkers = 0u);
+	void Shutdown();
+
+	// Workers plus the main thread
+	FORCEINLINE UINT GetNumThreads() const { return (UINT)m_queues.size(); }
+	// Index of the calling thread in [0, GetNumThreads()), the main thread (and any foreign thread) is 0.
+	static UINT GetThreadIndex();
+
+	void Run(std::function<void()> func, JobCounter* counter = nullptr);
+	// Job is queued once dependency reaches zero (immediately, if it is already done).
+	void RunAfter(JobCounter& dependency, std::function<void()> func, JobCounter* counter = nullptr);
+
+	// Runs other jobs while waiting, so it is safe to wait from inside of a job.
+	// Sleeps once there is nothing left to run, until the counter is done or new jobs are queued.
+	void Wait(const JobCounter& counter);
+
+	// Calls func(begin, end) over [0, count) split into batches of at least minBatchSize and returns when all of them are done.
+	// The calling thread takes the first batch itself.
+	template<typename Func>
+	void ParallelFor(UINT count, UINT minBatchSize, Func&& func)
+	{
+		if (count == 0u)
+		{
+			return;
+		}
+
+		if (GetNumThreads() <= 1u)
+		{
+			func(0u, count);
+			return;
+		}
+
+		// A few batches per thread, so stealing can even out imbalanced batches.
+		const UINT maxBatches = GetNumThreads() * BatchesPerThread;
+		const UINT batchSize = std::max(std::max(minBatchSize, 1u), (count + maxBatches - 1u) / maxBatches);
+
+		if (count <= batchSize)
+		{
+			func(0u, count);
+			return;
+		}
+
+		JobCounter counter;
+		for (UINT begin = batchSize; begin < count; begin += batchSize)
+		{
+			const UINT end = std::min(begin + batchSize, count);
+			Run([&func, begin, end]() { func(begin, end); }, &counter);
+		}
+
+		func(0u, batchSize);
+		Wait(counter);
+	}
+
+	JobSystemStats GetStats() const;
+	void ResetStats();
+
+private:
+	JobSystem() = default;
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	JobSystem(JobSystem&&) = delete;
+	JobSystem& operator=(JobSystem&&) = delete;
+
+	void Push(Job&& job);
+	Job* TrySteal(UINT thiefIndex);
+	// Takes a job from own deque, steals one or takes one pushed by a foreign thread.
+	Job* TryGetJob();
+	// Runs and frees the job
+	void Execute(Job* pJob);
+	void OnJobFinished(JobCounter* counter);
+	void NotifyWaiters();
+
+	void WorkerLoop(UINT threadIndex);
+
+private:
+	static constexpr UINT BatchesPerThread = 4u;
+
+	// Indexed by thread, jobs are heap allocated, so the deques only move pointers.
+	std::vector<std::unique_ptr<WorkStealingDeque<Job>>> m_queues;
+	std::vector<std::thread> m_workers;
+
+	// Jobs pushed by threads which don't own a deque
+	std::mutex m_foreignJobsMutex;
+	std::deque<Job*> m_foreignJobs;
+
+	// Sleeping workers are woken when jobs are pushed.
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	// Threads sleeping in Wait are woken when jobs are pushed or a counter is done. Guarded by m_wakeMutex.
+	std::condition_variable m_waitCondition;
+	UINT m_numWaiters = 0u;
+	std::atomic<UINT> m_numQueuedJobs = 0u;
+	std::atomic<bool> m_isRunning = false;
+
+	std::atomic<UINT64> m_numExecutedJobs = 0u;
+	std::atomic<UINT64> m_numStolenJobs = 0u;
+};
@@ -0,0 +1,240 @@
+#include "LZ4Block.h"
+#include "Common/ScaldCoreDefines.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	constexpr size_t MinMatch = 4u;
+	// The format requires the last 5 bytes to be literals and the last match to start at least 12 bytes before the end.
+	constexpr size_t LastLiterals = 5u;
+	constexpr size_t MatchFindLimit = 12u;
+	constexpr size_t MaxOffset = 65535u;
+
+	constexpr uint32_t HashLog = 12u;
+
+	FORCEINLINE uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	FORCEINLINE uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32u - HashLog);
+	}
+
+	// Length bytes follow the token when the nibble saturates at 15.
+	FORCEINLINE size_t GetLengthSize(size_t length)
+	{
+		return length >= 15u ? (length - 15u) / 255u + 1u : 0u;
+	}
+
+	FORCEINLINE uint8_t* WriteLength(uint8_t* op, size_t length)
+	{
+		for (length -= 15u; length >= 255u; length -= 255u)
+		{
+			*op++ = 255u;
+		}
+		*op++ = (uint8_t)length;
+		return op;
+	}
+
+	// Emits a sequence, a match length of 0 means the final literal-only one. Returns nullptr if it does not fit.
+	uint8_t* WriteSequence(uint8_t* op, const uint8_t* opEnd, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		const size_t matchCode = matchLength > 0u ? matchLength - MinMatch : 0u;
+		const size_t sequenceSize = 1u + GetLengthSize(literalLength) + literalLength + (matchLength > 0u ? 2u + GetLengthSize(matchCode) : 0u);
+		if ((size_t)(opEnd - op) < sequenceSize)
+		{
+			return nullptr;
+		}
+
+		uint8_t* token = op++;
+		*token = (uint8_t)(std::min<size_t>(literalLength, 15u) << 4u);
+		if (literalLength >= 15u)
+		{
+			op = WriteLength(op, literalLength);
+		}
+		if (literalLength > 0u)
+		{
+			memcpy(op, literals, literalLength);
+			op += literalLength;
+		}
+
+		if (matchLength > 0u)
+		{
+			*op++ = (uint8_t)(offset & 0xFFu);
+			*op++ = (uint8_t)(offset >> 8u);
+
+			*token |= (uint8_t)std::min<size_t>(matchCode, 15u);
+			if (matchCode >= 15u)
+			{
+				op = WriteLength(op, matchCode);
+			}
+		}
+
+		return op;
+	}
+
+	// Reads the extra length bytes of a saturated nibble. Returns false on truncated input.
+	FORCEINLINE bool ReadLength(const uint8_t*& ip, const uint8_t* ipEnd, size_t& length)
+	{
+		uint8_t value;
+		do
+		{
+			if (ip == ipEnd)
+			{
+				return false;
+			}
+			value = *ip++;
+			length += value;
+		} while (value == 255u);
+
+		return true;
+	}
+}
+
+size_t LZ4Block::GetMaxCompressedSize(size_t srcSize)
+{
+	return srcSize + srcSize / 255u + 16u;
+}
+
+size_t LZ4Block::Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+	uint8_t* op = dst;
+	const uint8_t* opEnd = dst + dstCapacity;
+
+	size_t anchor = 0u;
+	if (srcSize > MatchFindLimit)
+	{
+		// Position of the last occurrence of every hashed 4 byte sequence.
+		uint32_t table[1u << HashLog] = {};
+
+		const size_t matchLimit = srcSize - LastLiterals;
+		const size_t findLimit = srcSize - MatchFindLimit;
+
+		size_t ip = 0u;
+		while (ip < findLimit)
+		{
+			const uint32_t sequence = Read32(src + ip);
+			const uint32_t hash = Hash(sequence);
+			size_t match = table[hash];
+			table[hash] = (uint32_t)ip;
+
+			if (match >= ip || ip - match > MaxOffset || Read32(src + match) != sequence)
+			{
+				// Skip faster through data that does not compress.
+				ip += 1u + ((ip - anchor) >> 6u);
+				continue;
+			}
+
+			// Catch up with the literals preceding the match.
+			while (ip > anchor && match > 0u && src[ip - 1u] == src[match - 1u])
+			{
+				--ip;
+				--match;
+			}
+
+			size_t matchLength = MinMatch;
+			while (ip + matchLength < matchLimit && src[match + matchLength] == src[ip + matchLength])
+			{
+				++matchLength;
+			}
+
+			op = WriteSequence(op, opEnd, src + anchor, ip - anchor, ip - match, matchLength);
+			if (!op)
+			{
+				return 0u;
+			}
+
+			ip += matchLength;
+			anchor = ip;
+
+			// Keeps the positions inside the match findable.
+			if (ip < findLimit)
+			{
+				table[Hash(Read32(src + ip - 2u))] = (uint32_t)(ip - 2u);
+			}
+		}
+	}
+
+	op = WriteSequence(op, opEnd, src + anchor, srcSize - anchor, 0u, 0u);
+	return op ? (size_t)(op - dst) : 0u;
+}
+
+bool LZ4Block::Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+	const uint8_t* ip = src;
+	const uint8_t* ipEnd = src + srcSize;
+	uint8_t* op = dst;
+	uint8_t* opEnd = dst + dstSize;
+
+	while (ip < ipEnd)
+	{
+		const uint8_t token = *ip++;
+
+		size_t literalLength = token >> 4u;
+		if (literalLength == 15u && !ReadLength(ip, ipEnd, literalLength))
+		{
+			return false;
+		}
+		if (literalLength > (size_t)(ipEnd - ip) || literalLength > (size_t)(opEnd - op))
+		{
+			return false;
+		}
+		if (literalLength > 0u)
+		{
+			memcpy(op, ip, literalLength);
+			ip += literalLength;
+			op += literalLength;
+		}
+
+		// The last sequence has no match.
+		if (ip == ipEnd)
+		{
+			break;
+		}
+
+		if (ipEnd - ip < 2)
+		{
+			return false;
+		}
+		const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8u);
+		ip += 2u;
+		if (offset == 0u || offset > (size_t)(op - dst))
+		{
+			return false;
+		}
+
+		size_t matchLength = token & 0xFu;
+		if (matchLength == 15u && !ReadLength(ip, ipEnd, matchLength))
+		{
+			return false;
+		}
+		matchLength += MinMatch;
+		if (matchLength > (size_t)(opEnd - op))
+		{
+			return false;
+		}
+
+		// Source and destination overlap for offsets shorter than the match, which repeats the last offset bytes.
+		const uint8_t* match = op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(op, match, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			for (size_t i = 0u; i < matchLength; ++i)
+			{
+				*op++ = *match++;
+			}
+		}
+	}
+
+	return op == opEnd;
+}
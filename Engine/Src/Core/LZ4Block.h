@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block format (no frame header, no checksums): sequences of literals followed by a match of at least 4 bytes
+// at an offset up to 64 KB back. Output is readable by any LZ4 block decoder and the other way round.
+// Compression is a single pass greedy search, decompression is bounds checked, so corrupt input cannot write out of dst.
+class LZ4Block
+{
+public:
+	// Worst case size of incompressible input.
+	static size_t GetMaxCompressedSize(size_t srcSize);
+
+	// Returns the compressed size or 0, if dst is too small.
+	static size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+	// Fails on malformed input or when it does not decompress to exactly dstSize bytes.
+	static bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+};
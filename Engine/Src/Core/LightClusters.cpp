@@ -0,0 +1,247 @@
+#include "LightClusters.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Distance from value to [minValue, maxValue] along a single axis, 0 inside of it.
+	FORCEINLINE float AxisDistance(float value, float minValue, float maxValue)
+	{
+		return std::max(std::max(minValue - value, 0.0f), value - maxValue);
+	}
+}
+
+void LightClusters::Build(float fovYRad, float aspectRatio, float nearZ, float farZ, UINT tilesX, UINT tilesY, UINT slicesZ)
+{
+	assert(nearZ > 0.0f && farZ > nearZ);
+	assert(tilesX > 0u && tilesY > 0u && slicesZ > 0u);
+
+	if (fovYRad == m_fovYRad && aspectRatio == m_aspectRatio && nearZ == m_nearZ && farZ == m_farZ
+		&& tilesX == m_tilesX && tilesY == m_tilesY && slicesZ == m_slicesZ)
+	{
+		return;
+	}
+
+	m_fovYRad = fovYRad;
+	m_aspectRatio = aspectRatio;
+	m_nearZ = nearZ;
+	m_farZ = farZ;
+	m_tilesX = tilesX;
+	m_tilesY = tilesY;
+	m_slicesZ = slicesZ;
+
+	const float logDepthRange = logf(farZ / nearZ);
+	m_depthSliceScale = (float)slicesZ / logDepthRange;
+	m_depthSliceBias = -(float)slicesZ * logf(nearZ) / logDepthRange;
+
+	m_sliceDepths.resize(slicesZ + 1u);
+	for (UINT slice = 0; slice <= slicesZ; ++slice)
+	{
+		m_sliceDepths[slice] = nearZ * powf(farZ / nearZ, (float)slice / (float)slicesZ);
+	}
+	// Exact planes, so no rounding leaves a gap in front of the near or behind the far plane.
+	m_sliceDepths.front() = nearZ;
+	m_sliceDepths.back() = farZ;
+
+	const float tanHalfFovY = tanf(0.5f * fovYRad);
+	const float tanHalfFovX = tanHalfFovY * aspectRatio;
+
+	m_columnMinX.resize(slicesZ * tilesX);
+	m_columnMaxX.resize(slicesZ * tilesX);
+	m_rowMinY.resize(slicesZ * tilesY);
+	m_rowMaxY.resize(slicesZ * tilesY);
+
+	for (UINT slice = 0; slice < slicesZ; ++slice)
+	{
+		const float zNear = m_sliceDepths[slice];
+		const float zFar = m_sliceDepths[slice + 1u];
+
+		// Side planes of a tile pass through the eye, so the cell is bounded by its corners on the slice's two depth planes.
+		for (UINT x = 0; x < tilesX; ++x)
+		{
+			const float left = (2.0f * x / tilesX - 1.0f) * tanHalfFovX;
+			const float right = (2.0f * (x + 1u) / tilesX - 1.0f) * tanHalfFovX;
+			m_columnMinX[slice * tilesX + x] = std::min(left * zNear, left * zFar);
+			m_columnMaxX[slice * tilesX + x] = std::max(right * zNear, right * zFar);
+		}
+
+		// Row 0 is the top of the screen.
+		for (UINT y = 0; y < tilesY; ++y)
+		{
+			const float top = (1.0f - 2.0f * y / tilesY) * tanHalfFovY;
+			const float bottom = (1.0f - 2.0f * (y + 1u) / tilesY) * tanHalfFovY;
+			m_rowMinY[slice * tilesY + y] = std::min(bottom * zNear, bottom * zFar);
+			m_rowMaxY[slice * tilesY + y] = std::max(top * zNear, top * zFar);
+		}
+	}
+
+	m_sliceBins.resize(slicesZ);
+	m_ranges.assign(GetNumClusters(), LightClusterRange());
+	m_lightIndices.clear();
+}
+
+void LightClusters::Assign(const XMFLOAT4* pLightSpheres, UINT numLights)
+{
+	assert(m_slicesZ > 0u && "Build has to be called first");
+	assert(pLightSpheres || numLights == 0u);
+
+	// One slice per batch spreads the work, a single batch keeps a few lights on the calling thread.
+	const UINT minBatchSize = numLights >= ParallelThreshold ? 1u : m_slicesZ;
+
+	JobSystem::Get().ParallelFor(m_slicesZ, minBatchSize, [this, pLightSpheres, numLights](UINT begin, UINT end)
+		{
+			for (UINT slice = begin; slice < end; ++slice)
+			{
+				AssignSlice(slice, pLightSpheres, numLights);
+			}
+		});
+
+	std::vector<UINT> sliceOffsets(m_slicesZ);
+	UINT numIndices = 0u;
+	for (UINT slice = 0; slice < m_slicesZ; ++slice)
+	{
+		sliceOffsets[slice] = numIndices;
+		numIndices += (UINT)m_sliceBins[slice].Indices.size();
+	}
+	m_lightIndices.resize(numIndices);
+
+	const UINT clustersPerSlice = m_tilesX * m_tilesY;
+	JobSystem::Get().ParallelFor(m_slicesZ, minBatchSize, [this, &sliceOffsets, clustersPerSlice](UINT begin, UINT end)
+		{
+			for (UINT slice = begin; slice < end; ++slice)
+			{
+				const std::vector<UINT>& indices = m_sliceBins[slice].Indices;
+				std::copy(indices.begin(), indices.end(), m_lightIndices.begin() + sliceOffsets[slice]);
+
+				LightClusterRange* pRanges = m_ranges.data() + slice * clustersPerSlice;
+				for (UINT i = 0; i < clustersPerSlice; ++i)
+				{
+					pRanges[i].Offset += sliceOffsets[slice];
+				}
+			}
+		});
+}
+
+void LightClusters::AssignSlice(UINT slice, const XMFLOAT4* pLightSpheres, UINT numLights)
+{
+	SliceBins& bins = m_sliceBins[slice];
+	bins.Pairs.clear();
+
+	const float minZ = m_sliceDepths[slice];
+	const float maxZ = m_sliceDepths[slice + 1u];
+	const float* pMinX = m_columnMinX.data() + slice * m_tilesX;
+	const float* pMaxX = m_columnMaxX.data() + slice * m_tilesX;
+	const float* pMinY = m_rowMinY.data() + slice * m_tilesY;
+	const float* pMaxY = m_rowMaxY.data() + slice * m_tilesY;
+
+	for (UINT light = 0; light < numLights; ++light)
+	{
+		const XMFLOAT4& sphere = pLightSpheres[light];
+		const float radiusSq = sphere.w * sphere.w;
+
+		// An axis term alone exceeding the radius rejects the cluster, the same way the full test would.
+		const float dz = AxisDistance(sphere.z, minZ, maxZ);
+		if (dz * dz > radiusSq)
+		{
+			continue;
+		}
+
+		auto OverlapsAxis = [radiusSq](float value, float minValue, float maxValue)
+			{
+				const float distance = AxisDistance(value, minValue, maxValue);
+				return distance * distance <= radiusSq;
+			};
+
+		// Bounds of the columns (rows) are monotonic, so the overlapped ones are a contiguous range.
+		UINT firstX = 0u;
+		while (firstX < m_tilesX && !OverlapsAxis(sphere.x, pMinX[firstX], pMaxX[firstX]))
+		{
+			++firstX;
+		}
+		UINT endX = firstX;
+		while (endX < m_tilesX && OverlapsAxis(sphere.x, pMinX[endX], pMaxX[endX]))
+		{
+			++endX;
+		}
+
+		UINT firstY = 0u;
+		while (firstY < m_tilesY && !OverlapsAxis(sphere.y, pMinY[firstY], pMaxY[firstY]))
+		{
+			++firstY;
+		}
+		UINT endY = firstY;
+		while (endY < m_tilesY && OverlapsAxis(sphere.y, pMinY[endY], pMaxY[endY]))
+		{
+			++endY;
+		}
+
+		for (UINT y = firstY; y < endY; ++y)
+		{
+			for (UINT x = firstX; x < endX; ++x)
+			{
+				const XMFLOAT3 boxMin(pMinX[x], pMinY[y], minZ);
+				const XMFLOAT3 boxMax(pMaxX[x], pMaxY[y], maxZ);
+				if (SphereIntersectsBox(sphere, boxMin, boxMax))
+				{
+					bins.Pairs.emplace_back(y * m_tilesX + x, light);
+				}
+			}
+		}
+	}
+
+	// Counting sort by cluster, stable, so the lights of a cluster stay in ascending order.
+	const UINT clustersPerSlice = m_tilesX * m_tilesY;
+	LightClusterRange* pRanges = m_ranges.data() + slice * clustersPerSlice;
+	for (UINT i = 0; i < clustersPerSlice; ++i)
+	{
+		pRanges[i] = LightClusterRange();
+	}
+	for (const auto& [cluster, light] : bins.Pairs)
+	{
+		pRanges[cluster].Count = std::min(pRanges[cluster].Count + 1u, MaxLightsPerCluster);
+	}
+
+	UINT numIndices = 0u;
+	for (UINT i = 0; i < clustersPerSlice; ++i)
+	{
+		pRanges[i].Offset = numIndices;
+		numIndices += pRanges[i].Count;
+	}
+
+	bins.Indices.resize(numIndices);
+	// Reuses Count as the write cursor, it ends up where it was.
+	for (UINT i = 0; i < clustersPerSlice; ++i)
+	{
+		pRanges[i].Count = 0u;
+	}
+	for (const auto& [cluster, light] : bins.Pairs)
+	{
+		LightClusterRange& range = pRanges[cluster];
+		if (range.Count < MaxLightsPerCluster)
+		{
+			bins.Indices[range.Offset + range.Count++] = light;
+		}
+	}
+}
+
+void LightClusters::GetClusterBounds(UINT clusterIndex, XMFLOAT3& outMin, XMFLOAT3& outMax) const
+{
+	assert(clusterIndex < GetNumClusters());
+
+	const UINT x = clusterIndex % m_tilesX;
+	const UINT y = (clusterIndex / m_tilesX) % m_tilesY;
+	const UINT slice = clusterIndex / (m_tilesX * m_tilesY);
+
+	outMin = XMFLOAT3(m_columnMinX[slice * m_tilesX + x], m_rowMinY[slice * m_tilesY + y], m_sliceDepths[slice]);
+	outMax = XMFLOAT3(m_columnMaxX[slice * m_tilesX + x], m_rowMaxY[slice * m_tilesY + y], m_sliceDepths[slice + 1u]);
+}
+
+bool LightClusters::SphereIntersectsBox(const XMFLOAT4& sphere, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	const float dx = AxisDistance(sphere.x, boxMin.x, boxMax.x);
+	const float dy = AxisDistance(sphere.y, boxMin.y, boxMax.y);
+	const float dz = AxisDistance(sphere.z, boxMin.z, boxMax.z);
+	return dx * dx + dy * dy + dz * dz <= sphere.w * sphere.w;
+}
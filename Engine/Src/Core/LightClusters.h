@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Common/ScaldMath.h"
+
+// Lights of a cluster are LightIndices[Offset, Offset + Count). Mirrored by the uint2 entries of gClusterLightRanges.
+struct LightClusterRange
+{
+	UINT Offset = 0u;
+	UINT Count = 0u;
+};
+
+// Clustered (froxel) light assignment. The view frustum is split into TilesX x TilesY screen tiles
+// and SlicesZ depth slices, exponentially spaced between the near and far planes, so clusters stay roughly cubic.
+// Every cluster is bounded by the view space AABB of its frustum cell, a light is assigned to the clusters
+// whose AABB its view space bounding sphere intersects.
+//
+// Tile x grows to the right of the screen, tile y downwards, cluster index is (slice * TilesY + y) * TilesX + x.
+// Slices are binned on the job system, each slice owns its clusters, so the result does not depend on scheduling:
+// lights of a cluster are listed in ascending order.
+class LightClusters
+{
+public:
+	static constexpr UINT DefaultTilesX = 16u;
+	static constexpr UINT DefaultTilesY = 9u;
+	static constexpr UINT DefaultSlicesZ = 24u;
+	// Lights past this count are dropped from a cluster (the ones with the highest indices), which bounds the index list.
+	static constexpr UINT MaxLightsPerCluster = 128u;
+
+	LightClusters() = default;
+	LightClusters(const LightClusters& lhs) = delete;
+	LightClusters& operator=(const LightClusters& lhs) = delete;
+
+	~LightClusters() noexcept = default;
+
+public:
+	// Rebuilds the cluster bounds for a perspective projection. Cheap no-op if nothing has changed.
+	void Build(float fovYRad, float aspectRatio, float nearZ, float farZ, UINT tilesX = DefaultTilesX, UINT tilesY = DefaultTilesY, UINT slicesZ = DefaultSlicesZ);
+
+	// Bins view space bounding spheres (xyz center, w radius) of the lights, light i is referenced as index i.
+	void Assign(const XMFLOAT4* pLightSpheres, UINT numLights);
+
+	FORCEINLINE UINT GetTilesX() const { return m_tilesX; }
+	FORCEINLINE UINT GetTilesY() const { return m_tilesY; }
+	FORCEINLINE UINT GetSlicesZ() const { return m_slicesZ; }
+	FORCEINLINE UINT GetNumClusters() const { return m_tilesX * m_tilesY * m_slicesZ; }
+	FORCEINLINE UINT GetClusterIndex(UINT x, UINT y, UINT slice) const { return (slice * m_tilesY + y) * m_tilesX + x; }
+
+	// slice = floor(log(viewZ) * scale + bias), the way the lighting shader finds the slice of a pixel.
+	FORCEINLINE float GetDepthSliceScale() const { return m_depthSliceScale; }
+	FORCEINLINE float GetDepthSliceBias() const { return m_depthSliceBias; }
+
+	// View space bounds the lights are tested against.
+	void GetClusterBounds(UINT clusterIndex, XMFLOAT3& outMin, XMFLOAT3& outMax) const;
+
+	// Results of the last Assign, indexed by cluster.
+	FORCEINLINE const std::vector<LightClusterRange>& GetRanges() const { return m_ranges; }
+	FORCEINLINE const std::vector<UINT>& GetLightIndices() const { return m_lightIndices; }
+
+public:
+	// Squared distance from the sphere center to the box against its squared radius, shared with the per-axis rejection in Assign.
+	static bool SphereIntersectsBox(const XMFLOAT4& sphere, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax);
+
+private:
+	struct SliceBins
+	{
+		// (cluster in slice, light) pairs in light order, sorted by cluster into Indices.
+		std::vector<std::pair<UINT, UINT>> Pairs;
+		std::vector<UINT> Indices;
+	};
+
+	// Fills the ranges of the slice's clusters relative to the slice's own index list.
+	void AssignSlice(UINT slice, const XMFLOAT4* pLightSpheres, UINT numLights);
+
+private:
+	// Below this count binning is cheaper than spreading it over the workers.
+	static constexpr UINT ParallelThreshold = 256u;
+
+	UINT m_tilesX = 0u;
+	UINT m_tilesY = 0u;
+	UINT m_slicesZ = 0u;
+
+	float m_fovYRad = 0.0f;
+	float m_aspectRatio = 0.0f;
+	float m_nearZ = 0.0f;
+	float m_farZ = 0.0f;
+
+	float m_depthSliceScale = 0.0f;
+	float m_depthSliceBias = 0.0f;
+
+	// Cluster AABBs are separable: the x extent only depends on the tile column and the slice, y on the row and the slice.
+	std::vector<float> m_sliceDepths;	// SlicesZ + 1 boundaries
+	std::vector<float> m_columnMinX;	// [slice * TilesX + x]
+	std::vector<float> m_columnMaxX;
+	std::vector<float> m_rowMinY;		// [slice * TilesY + y]
+	std::vector<float> m_rowMaxY;
+
+	std::vector<SliceBins> m_sliceBins;
+	std::vector<LightClusterRange> m_ranges;
+	std::vector<UINT> m_lightIndices;
+};
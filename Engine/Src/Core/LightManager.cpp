@@ -0,0 +1,173 @@
+#include "LightManager.h"
+
+#include <algorithm>
+
+LightManager::LightManager(CreateBufferFunc createBuffer, UINT numFrameResources, UINT initialCapacity)
+	:
+	m_createBuffer(std::move(createBuffer))
+{
+	assert(m_createBuffer);
+	assert(numFrameResources > 0u);
+
+	m_framePools.resize(numFrameResources);
+	for (FramePool& pool : m_framePools)
+	{
+		// Never empty, so the root SRV always points to a valid buffer.
+		CreatePoolBuffer(pool, std::max(initialCapacity, 1u));
+	}
+}
+
+PointLightHandle LightManager::AddPointLight(const LightData& light)
+{
+	UINT slot = 0u;
+	if (!m_freeSlots.empty())
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (UINT)m_slots.size();
+		m_slots.emplace_back();
+	}
+
+	const UINT denseIndex = GetNumPointLights();
+	m_slots[slot].DenseIndex = denseIndex;
+	m_instances.emplace_back();
+	m_denseToSlot.push_back(slot);
+	WriteInstance(denseIndex, light);
+
+	PointLightHandle handle;
+	handle.Slot = slot;
+	handle.Generation = m_slots[slot].Generation;
+	return handle;
+}
+
+void LightManager::RemovePointLight(PointLightHandle handle)
+{
+	assert(IsValid(handle));
+
+	const UINT denseIndex = m_slots[handle.Slot].DenseIndex;
+	const UINT lastIndex = GetNumPointLights() - 1u;
+	if (denseIndex != lastIndex)
+	{
+		// Swap-remove: the last light fills the hole, only its new place has to be uploaded.
+		m_instances[denseIndex] = m_instances[lastIndex];
+		m_denseToSlot[denseIndex] = m_denseToSlot[lastIndex];
+		m_slots[m_denseToSlot[denseIndex]].DenseIndex = denseIndex;
+		MarkDirty(denseIndex);
+	}
+	m_instances.pop_back();
+	m_denseToSlot.pop_back();
+
+	// Outdates the handles of the removed light.
+	++m_slots[handle.Slot].Generation;
+	m_freeSlots.push_back(handle.Slot);
+}
+
+void LightManager::SetPointLight(PointLightHandle handle, const LightData& light)
+{
+	assert(IsValid(handle));
+	WriteInstance(m_slots[handle.Slot].DenseIndex, light);
+}
+
+bool LightManager::IsValid(PointLightHandle handle) const
+{
+	return handle.Slot < (UINT)m_slots.size() && m_slots[handle.Slot].Generation == handle.Generation;
+}
+
+const LightData& LightManager::GetPointLight(PointLightHandle handle) const
+{
+	assert(IsValid(handle));
+	return m_instances[m_slots[handle.Slot].DenseIndex].Light;
+}
+
+UINT64 LightManager::Upload(UINT frameIndex)
+{
+	assert(frameIndex < (UINT)m_framePools.size());
+
+	FramePool& pool = m_framePools[frameIndex];
+	const UINT numLights = GetNumPointLights();
+	m_lastUploadBytes = 0u;
+
+	if (numLights > pool.Capacity)
+	{
+		// The old buffer is released right away, which is safe since the GPU is done with this frame resource.
+		CreatePoolBuffer(pool, std::max(numLights, 2u * pool.Capacity));
+		pool.DirtyRanges.assign(1u, { 0u, numLights });
+	}
+
+	if (!pool.DirtyRanges.empty())
+	{
+		std::sort(pool.DirtyRanges.begin(), pool.DirtyRanges.end());
+
+		// Overlapping and adjacent ranges are written with a single copy. Parts past the end belong to removed lights.
+		UINT begin = pool.DirtyRanges.front().first;
+		UINT end = pool.DirtyRanges.front().second;
+		auto CopyRange = [this, &pool, numLights](UINT rangeBegin, UINT rangeEnd)
+			{
+				rangeEnd = std::min(rangeEnd, numLights);
+				if (rangeBegin < rangeEnd)
+				{
+					pool.Buffer->CopyRange(rangeBegin, &m_instances[rangeBegin], rangeEnd - rangeBegin);
+					m_lastUploadBytes += (UINT64)(rangeEnd - rangeBegin) * sizeof(InstanceData);
+				}
+			};
+
+		for (const auto& [rangeBegin, rangeEnd] : pool.DirtyRanges)
+		{
+			if (rangeBegin > end)
+			{
+				CopyRange(begin, end);
+				begin = rangeBegin;
+			}
+			end = std::max(end, rangeEnd);
+		}
+		CopyRange(begin, end);
+
+		pool.DirtyRanges.clear();
+	}
+
+	return pool.Buffer->GetGPUVirtualAddress();
+}
+
+void LightManager::CreatePoolBuffer(FramePool& pool, UINT capacity)
+{
+	pool.Buffer = m_createBuffer(capacity);
+	assert(pool.Buffer);
+	pool.Capacity = capacity;
+}
+
+void LightManager::MarkDirty(UINT denseIndex)
+{
+	for (FramePool& pool : m_framePools)
+	{
+		auto& ranges = pool.DirtyRanges;
+		// Lights updated in order, like a whole animated set, extend a single range.
+		if (!ranges.empty() && ranges.back().first <= denseIndex && denseIndex <= ranges.back().second)
+		{
+			ranges.back().second = std::max(ranges.back().second, denseIndex + 1u);
+			continue;
+		}
+
+		// Scattered updates of the same few lights would otherwise grow the list for as long as the copy waits for its frame.
+		if (ranges.size() >= m_instances.size())
+		{
+			ranges.assign(1u, { 0u, (UINT)m_instances.size() });
+			continue;
+		}
+
+		ranges.emplace_back(denseIndex, denseIndex + 1u);
+	}
+}
+
+void LightManager::WriteInstance(UINT denseIndex, const LightData& light)
+{
+	const XMMATRIX world = XMMatrixScalingFromVector(XMVectorReplicate(light.FallOfEnd)) * XMMatrixTranslationFromVector(XMLoadFloat3(&light.Position));
+
+	InstanceData& instance = m_instances[denseIndex];
+	XMStoreFloat4x4(&instance.World, XMMatrixTranspose(world));
+	instance.Light = light;
+
+	MarkDirty(denseIndex);
+}
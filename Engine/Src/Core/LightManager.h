@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Common/ObjectConstants.h"
+
+#include <climits>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Refers to a light for as long as it lives, no matter how many lights are added or removed meanwhile.
+// A handle of a removed light is detected by its generation, its slot may already hold another light.
+struct PointLightHandle
+{
+	static constexpr UINT InvalidSlot = UINT_MAX;
+
+	UINT Slot = InvalidSlot;
+	UINT Generation = 0u;
+};
+
+// Persistently mapped copy of the point light instances, one per frame resource (see LightUploadBuffer).
+class PointLightBuffer
+{
+public:
+	virtual ~PointLightBuffer() noexcept = default;
+
+	virtual void CopyRange(UINT firstIndex, const InstanceData* data, UINT count) = 0;
+	// D3D12_GPU_VIRTUAL_ADDRESS
+	virtual UINT64 GetGPUVirtualAddress() const = 0;
+};
+
+// Owns the point lights and their structured buffer. Lights are densely packed in the order of the buffer,
+// removal moves the last light into the hole, so the instances the shaders index are always [0, GetNumPointLights()).
+//
+// Every frame resource has its own copy of the buffer, persistently mapped and grown on demand.
+// A copy only receives the ranges changed since it was last uploaded, so static lights cost nothing per frame.
+class LightManager
+{
+public:
+	static constexpr UINT DefaultCapacity = 1024u;
+
+	// Creates a buffer for capacity instances, called again whenever a frame resource's copy has to grow.
+	using CreateBufferFunc = std::function<std::unique_ptr<PointLightBuffer>(UINT capacity)>;
+
+	LightManager(CreateBufferFunc createBuffer, UINT numFrameResources, UINT initialCapacity = DefaultCapacity);
+	LightManager(const LightManager& lhs) = delete;
+	LightManager& operator=(const LightManager& lhs) = delete;
+
+	~LightManager() noexcept = default;
+
+public:
+	// The volume transform is derived from Position and FallOfEnd, the light has no effect past its range.
+	PointLightHandle AddPointLight(const LightData& light);
+	void RemovePointLight(PointLightHandle handle);
+	void SetPointLight(PointLightHandle handle, const LightData& light);
+
+	bool IsValid(PointLightHandle handle) const;
+	const LightData& GetPointLight(PointLightHandle handle) const;
+
+	FORCEINLINE UINT GetNumPointLights() const { return (UINT)m_instances.size(); }
+	// In the layout of the structured buffer (transposed World), reordered by RemovePointLight.
+	FORCEINLINE const std::vector<InstanceData>& GetPointLightInstances() const { return m_instances; }
+
+	// Writes the changed ranges to the frame resource's copy and returns its address.
+	// The GPU has to be done with the frame resource, the copy may be recreated when it has to grow.
+	UINT64 Upload(UINT frameIndex);
+
+	FORCEINLINE UINT64 GetLastUploadBytes() const { return m_lastUploadBytes; }
+
+private:
+	struct SlotEntry
+	{
+		UINT DenseIndex = 0u;
+		UINT Generation = 0u;
+	};
+
+	struct FramePool
+	{
+		std::unique_ptr<PointLightBuffer> Buffer;
+		UINT Capacity = 0u;
+		// [Begin, End) of dense indices, merged on upload.
+		std::vector<std::pair<UINT, UINT>> DirtyRanges;
+	};
+
+	void CreatePoolBuffer(FramePool& pool, UINT capacity);
+	void MarkDirty(UINT denseIndex);
+	void WriteInstance(UINT denseIndex, const LightData& light);
+
+private:
+	CreateBufferFunc m_createBuffer;
+
+	std::vector<InstanceData> m_instances;
+	// Slot of every dense instance, so the one moved by a removal can be redirected.
+	std::vector<UINT> m_denseToSlot;
+	std::vector<SlotEntry> m_slots;
+	std::vector<UINT> m_freeSlots;
+
+	std::vector<FramePool> m_framePools;
+	UINT64 m_lastUploadBytes = 0u;
+};
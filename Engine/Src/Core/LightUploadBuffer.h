@@ -0,0 +1,34 @@
+#pragma once
+
+#include "LightManager.h"
+#include "UploadBuffer.h"
+
+// Frame resource's copy of the point light instances in an upload heap buffer.
+class LightUploadBuffer : public PointLightBuffer
+{
+public:
+	LightUploadBuffer(ID3D12Device* device, UINT capacity)
+		:
+		m_buffer(device, capacity, false)
+	{
+	}
+
+	LightUploadBuffer(const LightUploadBuffer& lhs) = delete;
+	LightUploadBuffer& operator=(const LightUploadBuffer& lhs) = delete;
+
+	virtual ~LightUploadBuffer() noexcept override = default;
+
+public:
+	virtual void CopyRange(UINT firstIndex, const InstanceData* data, UINT count) override
+	{
+		m_buffer.CopyRange(firstIndex, data, count);
+	}
+
+	virtual UINT64 GetGPUVirtualAddress() const override
+	{
+		return m_buffer.Get()->GetGPUVirtualAddress();
+	}
+
+private:
+	UploadBuffer<InstanceData> m_buffer;
+};
@@ -0,0 +1,141 @@
+#include "LightVolumeClassifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LightVolumeClassifier::Classify(const XMFLOAT4* pViewSpheres, UINT count, float projScaleX, float projScaleY, float nearZ, float farZ, UINT width, UINT height)
+{
+	assert(pViewSpheres || count == 0u);
+	assert(nearZ > 0.0f && farZ > nearZ);
+
+	m_classes.resize(count);
+	m_scissorRects.resize(count);
+	for (UINT c = 0; c < NumClasses; ++c)
+	{
+		m_lights[c].clear();
+		m_classScissorRects[c] = LightScissorRect();
+	}
+
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR nearPlane = XMVectorReplicate(nearZ);
+	const XMVECTOR farPlane = XMVectorReplicate(farZ);
+	const XMVECTOR scaleX = XMVectorReplicate(projScaleX);
+	const XMVECTOR scaleY = XMVectorReplicate(projScaleY);
+	// Side planes have (+-scale, -1) normals in their axis and z, which are not unit length.
+	const XMVECTOR invNormalLengthX = XMVectorReplicate(1.0f / sqrtf(projScaleX * projScaleX + 1.0f));
+	const XMVECTOR invNormalLengthY = XMVectorReplicate(1.0f / sqrtf(projScaleY * projScaleY + 1.0f));
+
+	const XMVECTOR screenWidth = XMVectorReplicate((float)width);
+	const XMVECTOR screenHeight = XMVectorReplicate((float)height);
+	const XMVECTOR halfWidth = XMVectorReplicate(0.5f * width);
+	const XMVECTOR halfHeight = XMVectorReplicate(0.5f * height);
+	// Slope (view x / z) to pixels
+	const XMVECTOR pixelScaleX = XMVectorReplicate(0.5f * width * projScaleX);
+	const XMVECTOR pixelScaleY = XMVectorReplicate(0.5f * height * projScaleY);
+
+	const XMVECTOR culledClass = XMVectorReplicateInt(Culled);
+	const XMVECTOR withinFrustumClass = XMVectorReplicateInt(WithinFrustum);
+	const XMVECTOR intersectsFarPlaneClass = XMVectorReplicateInt(IntersectsFarPlane);
+	const XMVECTOR fullQuadClass = XMVectorReplicateInt(FullQuad);
+
+	for (UINT i = 0; i < count; i += SimdWidth)
+	{
+		const UINT numLanes = std::min(SimdWidth, count - i);
+
+		// Transposed to SoA, lanes past the end get a point behind the camera, which is culled.
+		XMVECTOR spheres[SimdWidth];
+		for (UINT lane = 0; lane < SimdWidth; ++lane)
+		{
+			spheres[lane] = lane < numLanes ? XMLoadFloat4(&pViewSpheres[i + lane]) : XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f);
+		}
+		const XMMATRIX soa = XMMatrixTranspose(XMMATRIX(spheres[0], spheres[1], spheres[2], spheres[3]));
+		const XMVECTOR x = soa.r[0];
+		const XMVECTOR y = soa.r[1];
+		const XMVECTOR z = soa.r[2];
+		const XMVECTOR radius = soa.r[3];
+
+		// Outside of a plane if its signed distance to the center exceeds the radius. The sides are symmetric, so |x| and |y| test both.
+		XMVECTOR culled = XMVectorGreater(XMVectorSubtract(nearPlane, z), radius);
+		culled = XMVectorOrInt(culled, XMVectorGreater(XMVectorSubtract(z, farPlane), radius));
+		culled = XMVectorOrInt(culled, XMVectorGreater(XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(XMVectorAbs(x), scaleX), z), invNormalLengthX), radius));
+		culled = XMVectorOrInt(culled, XMVectorGreater(XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(XMVectorAbs(y), scaleY), z), invNormalLengthY), radius));
+
+		const XMVECTOR crossesNear = XMVectorLess(XMVectorSubtract(z, nearPlane), radius);
+		const XMVECTOR crossesFar = XMVectorGreater(XMVectorAdd(z, radius), farPlane);
+
+		XMVECTOR classes = XMVectorSelect(withinFrustumClass, intersectsFarPlaneClass, crossesFar);
+		classes = XMVectorSelect(classes, fullQuadClass, XMVectorAndInt(crossesFar, crossesNear));
+		classes = XMVectorSelect(classes, culledClass, culled);
+
+		// Tangents from the eye: slope s = x / z of a line touching the sphere solves (x - s * z)^2 = r^2 * (1 + s^2).
+		// In front of the near plane z > r, so both roots exist.
+		const XMVECTOR zSqMinusRadiusSq = XMVectorSubtract(XMVectorMultiply(z, z), XMVectorMultiply(radius, radius));
+		const XMVECTOR invDenominator = XMVectorReciprocal(zSqMinusRadiusSq);
+		const XMVECTOR discriminantX = XMVectorMultiply(radius, XMVectorSqrt(XMVectorMax(XMVectorMultiplyAdd(x, x, zSqMinusRadiusSq), zero)));
+		const XMVECTOR discriminantY = XMVectorMultiply(radius, XMVectorSqrt(XMVectorMax(XMVectorMultiplyAdd(y, y, zSqMinusRadiusSq), zero)));
+		const XMVECTOR xz = XMVectorMultiply(x, z);
+		const XMVECTOR yz = XMVectorMultiply(y, z);
+
+		XMVECTOR left = XMVectorMultiplyAdd(XMVectorMultiply(XMVectorSubtract(xz, discriminantX), invDenominator), pixelScaleX, halfWidth);
+		XMVECTOR right = XMVectorMultiplyAdd(XMVectorMultiply(XMVectorAdd(xz, discriminantX), invDenominator), pixelScaleX, halfWidth);
+		// Screen y goes down
+		XMVECTOR top = XMVectorNegativeMultiplySubtract(XMVectorMultiply(XMVectorAdd(yz, discriminantY), invDenominator), pixelScaleY, halfHeight);
+		XMVECTOR bottom = XMVectorNegativeMultiplySubtract(XMVectorMultiply(XMVectorSubtract(yz, discriminantY), invDenominator), pixelScaleY, halfHeight);
+
+		// Volumes crossing the near plane project to infinity, they get the whole screen.
+		left = XMVectorSelect(left, zero, crossesNear);
+		top = XMVectorSelect(top, zero, crossesNear);
+		right = XMVectorSelect(right, screenWidth, crossesNear);
+		bottom = XMVectorSelect(bottom, screenHeight, crossesNear);
+
+		left = XMVectorClamp(XMVectorFloor(left), zero, screenWidth);
+		top = XMVectorClamp(XMVectorFloor(top), zero, screenHeight);
+		right = XMVectorClamp(XMVectorCeiling(right), zero, screenWidth);
+		bottom = XMVectorClamp(XMVectorCeiling(bottom), zero, screenHeight);
+
+		uint32_t laneClasses[SimdWidth];
+		XMFLOAT4 lefts, tops, rights, bottoms;
+		XMStoreInt4(laneClasses, classes);
+		XMStoreFloat4(&lefts, left);
+		XMStoreFloat4(&tops, top);
+		XMStoreFloat4(&rights, right);
+		XMStoreFloat4(&bottoms, bottom);
+
+		const float* pLefts = &lefts.x;
+		const float* pTops = &tops.x;
+		const float* pRights = &rights.x;
+		const float* pBottoms = &bottoms.x;
+		for (UINT lane = 0; lane < numLanes; ++lane)
+		{
+			const UINT light = i + lane;
+			const EVolumeClass volumeClass = (EVolumeClass)laneClasses[lane];
+			m_classes[light] = (UINT8)volumeClass;
+
+			LightScissorRect& rect = m_scissorRects[light];
+			rect = LightScissorRect();
+			if (volumeClass == Culled)
+			{
+				continue;
+			}
+
+			rect.Left = (UINT)pLefts[lane];
+			rect.Top = (UINT)pTops[lane];
+			rect.Right = (UINT)pRights[lane];
+			rect.Bottom = (UINT)pBottoms[lane];
+
+			LightScissorRect& classRect = m_classScissorRects[volumeClass];
+			if (m_lights[volumeClass].empty())
+			{
+				classRect = rect;
+			}
+			else
+			{
+				classRect.Left = std::min(classRect.Left, rect.Left);
+				classRect.Top = std::min(classRect.Top, rect.Top);
+				classRect.Right = std::max(classRect.Right, rect.Right);
+				classRect.Bottom = std::max(classRect.Bottom, rect.Bottom);
+			}
+			m_lights[volumeClass].push_back(light);
+		}
+	}
+}
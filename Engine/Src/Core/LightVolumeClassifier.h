@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Common/ScaldMath.h"
+
+// Pixel rect with exclusive right and bottom, same as D3D12_RECT.
+struct LightScissorRect
+{
+	UINT Left = 0u;
+	UINT Top = 0u;
+	UINT Right = 0u;
+	UINT Bottom = 0u;
+};
+
+// Sorts spherical light volumes by the pipeline state they can be correctly drawn with and bounds them on screen.
+// Works on view space spheres (xyz center, w radius) of a symmetric left handed perspective projection,
+// 4 lights at a time across SIMD lanes.
+class LightVolumeClassifier
+{
+public:
+	enum EVolumeClass : UINT
+	{
+		// Outside of the frustum.
+		Culled = 0u,
+		// In front of the far plane, back faces are depth tested against the scene. Camera may be inside of the volume.
+		WithinFrustum,
+		// Back faces are clipped by the far plane, front faces are drawn without depth test. In front of the near plane.
+		IntersectsFarPlane,
+		// Clipped by both the near and the far plane, so neither set of faces is complete. Drawn as a quad under its scissor.
+		FullQuad,
+
+		NumClasses
+	};
+
+	LightVolumeClassifier() = default;
+	LightVolumeClassifier(const LightVolumeClassifier& lhs) = delete;
+	LightVolumeClassifier& operator=(const LightVolumeClassifier& lhs) = delete;
+
+	~LightVolumeClassifier() noexcept = default;
+
+public:
+	// projScaleX/Y are the projection's [0][0] and [1][1], i.e. cot(fovX / 2) and cot(fovY / 2).
+	void Classify(const XMFLOAT4* pViewSpheres, UINT count, float projScaleX, float projScaleY, float nearZ, float farZ, UINT width, UINT height);
+
+	FORCEINLINE EVolumeClass GetClass(UINT light) const { return (EVolumeClass)m_classes[light]; }
+	// Bounds of the projected sphere, the whole screen for volumes crossing the near plane. Empty for culled ones.
+	FORCEINLINE const LightScissorRect& GetScissorRect(UINT light) const { return m_scissorRects[light]; }
+
+	// Lights of a class in ascending order and the union of their scissor rects. Culled lights are not listed.
+	FORCEINLINE const std::vector<UINT>& GetLights(EVolumeClass volumeClass) const { return m_lights[volumeClass]; }
+	FORCEINLINE const LightScissorRect& GetClassScissorRect(EVolumeClass volumeClass) const { return m_classScissorRects[volumeClass]; }
+
+private:
+	static constexpr UINT SimdWidth = 4u;
+
+	std::vector<UINT8> m_classes;
+	std::vector<LightScissorRect> m_scissorRects;
+
+	std::array<std::vector<UINT>, NumClasses> m_lights;
+	std::array<LightScissorRect, NumClasses> m_classScissorRects;
+};
@@ -0,0 +1,78 @@
+#include "LinearAllocator.h"
+
+LinearAllocator::LinearAllocator(UINT64 capacity)
+	: m_capacity(capacity)
+{
+}
+
+UINT64 LinearAllocator::Allocate(UINT64 size, UINT64 alignment)
+{
+	assert(size > 0u);
+	assert(alignment > 0u && (alignment & (alignment - 1u)) == 0u);
+
+	if (IsFull())
+	{
+		return InvalidOffset;
+	}
+
+	const UINT64 alignedHead = (m_head + alignment - 1u) & ~(alignment - 1u);
+
+	if (m_head >= m_tail)
+	{
+		// Free space is [head, capacity) and [0, tail)
+		if (alignedHead + size <= m_capacity)
+		{
+			const UINT64 allocatedSize = alignedHead + size - m_head;
+			m_head = alignedHead + size;
+			m_usedSize += allocatedSize;
+			m_currFrameSize += allocatedSize;
+			return alignedHead;
+		}
+
+		// Wrap around, the rest of the ring is wasted until this frame is retired. Offset 0 is aligned to anything.
+		if (size <= m_tail)
+		{
+			const UINT64 allocatedSize = (m_capacity - m_head) + size;
+			m_head = size;
+			m_usedSize += allocatedSize;
+			m_currFrameSize += allocatedSize;
+			return 0u;
+		}
+	}
+	else if (alignedHead + size <= m_tail)
+	{
+		// Free space is [head, tail)
+		const UINT64 allocatedSize = alignedHead + size - m_head;
+		m_head = alignedHead + size;
+		m_usedSize += allocatedSize;
+		m_currFrameSize += allocatedSize;
+		return alignedHead;
+	}
+
+	return InvalidOffset;
+}
+
+void LinearAllocator::FinishFrame(UINT64 fenceValue)
+{
+	m_finishedFrames.push({ fenceValue, m_head, m_currFrameSize });
+	m_currFrameSize = 0u;
+}
+
+void LinearAllocator::ReleaseCompletedFrames(UINT64 completedFenceValue)
+{
+	while (!m_finishedFrames.empty() && m_finishedFrames.front().FenceValue <= completedFenceValue)
+	{
+		const FrameTail& frame = m_finishedFrames.front();
+		assert(frame.Size <= m_usedSize);
+
+		m_usedSize -= frame.Size;
+		m_tail = frame.Tail;
+		m_finishedFrames.pop();
+	}
+
+	// Nothing is in flight, so start from the beginning to keep allocations contiguous.
+	if (IsEmpty())
+	{
+		m_head = m_tail = 0u;
+	}
+}
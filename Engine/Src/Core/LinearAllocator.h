@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+
+#include <queue>
+
+// Pure CPU bookkeeping of a per-frame linear (bump) allocator over a fixed size ring.
+// Allocations of a frame are bumped one after another and wrap around to the beginning of the ring, when its end is reached.
+// Space is given back a whole frame at a time, once the fence value of the frame has been completed by the GPU.
+// Works with offsets only, so the memory itself (e.g. mapped upload heap) is owned by the caller.
+class LinearAllocator
+{
+public:
+	static constexpr UINT64 InvalidOffset = UINT64_MAX;
+
+public:
+	explicit LinearAllocator(UINT64 capacity);
+	LinearAllocator(const LinearAllocator& lhs) = delete;
+	LinearAllocator& operator=(const LinearAllocator& lhs) = delete;
+
+	~LinearAllocator() noexcept = default;
+
+public:
+	// Returns offset of the allocation (aligned to alignment, which has to be a power of 2) or InvalidOffset if the ring is full.
+	UINT64 Allocate(UINT64 size, UINT64 alignment);
+
+	// Closes the current frame: everything allocated since the previous call is retired once fenceValue is completed.
+	void FinishFrame(UINT64 fenceValue);
+	// Frees memory of all finished frames with fence value <= completedFenceValue.
+	void ReleaseCompletedFrames(UINT64 completedFenceValue);
+
+	FORCEINLINE UINT64 GetCapacity() const { return m_capacity; }
+	FORCEINLINE UINT64 GetUsedSize() const { return m_usedSize; }
+	FORCEINLINE bool IsEmpty() const { return m_usedSize == 0u; }
+	FORCEINLINE bool IsFull() const { return m_usedSize == m_capacity; }
+
+private:
+	struct FrameTail
+	{
+		UINT64 FenceValue;
+		// Ring head at the end of the frame, becomes the tail once the frame is retired.
+		UINT64 Tail;
+		// Everything the frame has consumed, including alignment padding and wasted space at the end of the ring.
+		UINT64 Size;
+	};
+
+	std::queue<FrameTail> m_finishedFrames;
+
+	const UINT64 m_capacity = 0u;
+	UINT64 m_head = 0u;
+	UINT64 m_tail = 0u;
+	UINT64 m_usedSize = 0u;
+	UINT64 m_currFrameSize = 0u;
+};
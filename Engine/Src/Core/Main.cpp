@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "Engine.h"
+#include "AssetArchive.h"
+#include "JobSystem.h"
 
 INT WindowWidth;
 INT WindowHeight;
@@ -15,6 +17,22 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int nCmdShow)
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+    // Offline packing, no window: Engine.exe -pack <directory> <archive>
+    int argc;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    const bool bIsPacking = argc == 4 && _wcsicmp(argv[1], L"-pack") == 0;
+    std::wstring packDirectory = bIsPacking ? argv[2] : L"";
+    std::wstring packArchive = bIsPacking ? argv[3] : L"";
+    LocalFree(argv);
+
+    if (bIsPacking)
+    {
+        JobSystem::Get().Init();
+        const bool bIsPacked = AssetArchiveWriter::PackDirectory(packDirectory, packArchive);
+        JobSystem::Get().Shutdown();
+        return bIsPacked ? 0 : 1;
+    }
+
     wcscpy_s(WindowTitle, TEXT("Scald Engine"));
     wcscpy_s(WindowClass, TEXT("D3D12SampleClass"));
 
@@ -0,0 +1,358 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Forsyth's scoring parameters, see "Linear-Speed Vertex Cache Optimisation".
+	constexpr UINT ForsythCacheSize = 32u;
+	constexpr float CacheDecayPower = 1.5f;
+	constexpr float LastTriangleScore = 0.75f;
+	constexpr float ValenceBoostScale = 2.0f;
+	constexpr float ValenceBoostPower = 0.5f;
+
+	constexpr uint32_t InvalidTriangle = UINT32_MAX;
+
+	float VertexScore(int cachePosition, uint32_t numLiveTriangles)
+	{
+		if (numLiveTriangles == 0u)
+		{
+			// Nothing left to draw with this vertex
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// Vertices of the last triangle get a fixed score, so the next triangle does not just reuse the same edge.
+			score = cachePosition < 3 ? LastTriangleScore
+				: powf(1.0f - (float)(cachePosition - 3) / (ForsythCacheSize - 3u), CacheDecayPower);
+		}
+
+		// Vertices with few triangles left are prioritized, so they do not end up as lonely triangles in the end.
+		score += ValenceBoostScale * powf((float)numLiveTriangles, -ValenceBoostPower);
+		return score;
+	}
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, UINT cacheSize)
+{
+	VertexCacheStats stats;
+	if (indexCount == 0u)
+	{
+		return stats;
+	}
+
+	// A vertex is in the FIFO if fewer than cacheSize misses happened since it has been inserted.
+	std::vector<uint32_t> insertedAt(vertexCount, 0u);
+	std::vector<bool> isReferenced(vertexCount, false);
+	uint32_t time = cacheSize + 1u;
+	size_t numReferenced = 0u;
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const uint32_t index = pIndices[i];
+		if (time - insertedAt[index] > cacheSize)
+		{
+			insertedAt[index] = time++;
+			stats.NumTransformedVertices++;
+		}
+		if (!isReferenced[index])
+		{
+			isReferenced[index] = true;
+			numReferenced++;
+		}
+	}
+
+	stats.ACMR = (float)stats.NumTransformedVertices / (indexCount / 3u);
+	stats.ATVR = (float)stats.NumTransformedVertices / numReferenced;
+	return stats;
+}
+
+size_t MeshOptimizer::WeldVertices(const void* pVertices, size_t vertexCount, size_t vertexSize, std::vector<uint32_t>& outRemap)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pVertices);
+
+	// FNV-1a over the raw bytes, vertices are compared bitwise.
+	auto hashVertex = [pBytes, vertexSize](uint32_t index)
+		{
+			const uint8_t* pVertex = pBytes + index * vertexSize;
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < vertexSize; ++i)
+			{
+				hash = (hash ^ pVertex[i]) * 1099511628211ull;
+			}
+			return (size_t)hash;
+		};
+	auto equalVertices = [pBytes, vertexSize](uint32_t lhs, uint32_t rhs)
+		{
+			return memcmp(pBytes + lhs * vertexSize, pBytes + rhs * vertexSize, vertexSize) == 0;
+		};
+
+	std::unordered_map<uint32_t, uint32_t, decltype(hashVertex), decltype(equalVertices)> firstVertices(vertexCount, hashVertex, equalVertices);
+
+	outRemap.resize(vertexCount);
+	size_t numUnique = 0u;
+	for (uint32_t i = 0; i < (uint32_t)vertexCount; ++i)
+	{
+		auto [it, bInserted] = firstVertices.try_emplace(i, i);
+		outRemap[i] = it->second;
+		numUnique += bInserted ? 1u : 0u;
+	}
+	return numUnique;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+	assert(indexCount % 3u == 0u);
+	const size_t triangleCount = indexCount / 3u;
+	if (triangleCount == 0u)
+	{
+		return;
+	}
+
+	// Vertex to triangles adjacency (CSR), the first numLiveTriangles[v] entries of every range are the triangles not emitted yet.
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1u, 0u);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		adjacencyOffsets[pIndices[i] + 1u]++;
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1u] += adjacencyOffsets[v];
+	}
+
+	std::vector<uint32_t> numLiveTriangles(vertexCount, 0u);
+	std::vector<uint32_t> adjacency(indexCount);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const uint32_t v = pIndices[i];
+		adjacency[adjacencyOffsets[v] + numLiveTriangles[v]++] = (uint32_t)(i / 3u);
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		vertexScores[v] = VertexScore(-1, numLiveTriangles[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> isEmitted(triangleCount, false);
+	uint32_t bestTriangle = 0u;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScores[t] = vertexScores[pIndices[t * 3u + 0]] + vertexScores[pIndices[t * 3u + 1]] + vertexScores[pIndices[t * 3u + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+		{
+			bestTriangle = (uint32_t)t;
+		}
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indexCount);
+
+	// Cache can temporarily hold 3 more entries, the ones pushed out get their score updated once more.
+	std::array<uint32_t, ForsythCacheSize + 3u> cache;
+	std::array<uint32_t, ForsythCacheSize + 3u> newCache;
+	UINT cacheCount = 0u;
+	size_t scanCursor = 0u;
+
+	while (result.size() < indexCount)
+	{
+		if (bestTriangle == InvalidTriangle)
+		{
+			// Nothing in the cache has triangles left, continue with the next triangle in the original order.
+			while (isEmitted[scanCursor])
+			{
+				++scanCursor;
+			}
+			bestTriangle = (uint32_t)scanCursor;
+		}
+
+		const uint32_t* triangle = &pIndices[bestTriangle * 3u];
+		isEmitted[bestTriangle] = true;
+
+		UINT newCacheCount = 0u;
+		for (UINT k = 0; k < 3u; ++k)
+		{
+			const uint32_t v = triangle[k];
+			result.push_back(v);
+			newCache[newCacheCount++] = v;
+
+			// Remove the triangle from the live part of the vertex's adjacency
+			uint32_t* pBegin = &adjacency[adjacencyOffsets[v]];
+			uint32_t* pLast = pBegin + numLiveTriangles[v] - 1u;
+			*std::find(pBegin, pLast + 1, bestTriangle) = *pLast;
+			numLiveTriangles[v]--;
+		}
+
+		for (UINT i = 0; i < cacheCount; ++i)
+		{
+			const uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// Update scores of all cached vertices, including the ones which have just fallen out.
+		for (UINT i = 0; i < newCacheCount; ++i)
+		{
+			const uint32_t v = newCache[i];
+			cachePositions[v] = i < ForsythCacheSize ? (int)i : -1;
+			vertexScores[v] = VertexScore(cachePositions[v], numLiveTriangles[v]);
+		}
+
+		bestTriangle = InvalidTriangle;
+		float bestScore = -1.0f;
+		for (UINT i = 0; i < newCacheCount; ++i)
+		{
+			const uint32_t v = newCache[i];
+			for (uint32_t j = 0; j < numLiveTriangles[v]; ++j)
+			{
+				const uint32_t t = adjacency[adjacencyOffsets[v] + j];
+				const float score = vertexScores[pIndices[t * 3u + 0]] + vertexScores[pIndices[t * 3u + 1]] + vertexScores[pIndices[t * 3u + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCacheCount, ForsythCacheSize);
+		std::copy(newCache.begin(), newCache.begin() + cacheCount, cache.begin());
+	}
+
+	std::copy(result.begin(), result.end(), pIndices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* pIndices, size_t indexCount, const XMFLOAT3* pPositions, size_t positionStride, size_t vertexCount, float threshold)
+{
+	const size_t triangleCount = indexCount / 3u;
+	if (triangleCount < 2u)
+	{
+		return;
+	}
+
+	auto position = [pPositions, positionStride](uint32_t index)
+		{
+			return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pPositions) + index * positionStride));
+		};
+
+	const VertexCacheStats before = AnalyzeVertexCache(pIndices, indexCount, vertexCount);
+
+	// Cluster starts where a triangle misses the cache with all of its vertices, reordering whole clusters barely affects the cache.
+	std::vector<uint32_t> clusterStarts;
+	{
+		std::vector<uint32_t> insertedAt(vertexCount, 0u);
+		uint32_t time = DefaultCacheSize + 1u;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			UINT numMisses = 0u;
+			for (UINT k = 0; k < 3u; ++k)
+			{
+				const uint32_t index = pIndices[t * 3u + k];
+				if (time - insertedAt[index] > DefaultCacheSize)
+				{
+					insertedAt[index] = time++;
+					numMisses++;
+				}
+			}
+			if (numMisses == 3u || t == 0u)
+			{
+				clusterStarts.push_back((uint32_t)t);
+			}
+		}
+	}
+	if (clusterStarts.size() < 2u)
+	{
+		return;
+	}
+	clusterStarts.push_back((uint32_t)triangleCount);
+
+	const size_t numClusters = clusterStarts.size() - 1u;
+	std::vector<XMFLOAT3> clusterCentroids(numClusters);
+	std::vector<XMFLOAT3> clusterNormals(numClusters);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < numClusters; ++c)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1u]; ++t)
+		{
+			const XMVECTOR p0 = position(pIndices[t * 3u + 0]);
+			const XMVECTOR p1 = position(pIndices[t * 3u + 1]);
+			const XMVECTOR p2 = position(pIndices[t * 3u + 2]);
+
+			// Length of the cross product is twice the area, so normal sum is area weighted already.
+			const XMVECTOR triNormal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			const float triArea = 0.5f * XMVectorGetX(XMVector3Length(triNormal));
+
+			normal = XMVectorAdd(normal, triNormal);
+			centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), triArea / 3.0f));
+			area += triArea;
+		}
+
+		meshCentroid = XMVectorAdd(meshCentroid, centroid);
+		meshArea += area;
+
+		XMStoreFloat3(&clusterCentroids[c], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+	}
+
+	if (meshArea <= 0.0f)
+	{
+		return;
+	}
+	meshCentroid = XMVectorScale(meshCentroid, 1.0f / meshArea);
+
+	// The further a cluster is pushed out along its own normal, the more likely it occludes the others.
+	std::vector<float> sortKeys(numClusters);
+	std::vector<uint32_t> clusterOrder(numClusters);
+	for (size_t c = 0; c < numClusters; ++c)
+	{
+		const XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&clusterCentroids[c]), meshCentroid);
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[c])));
+		clusterOrder[c] = (uint32_t)c;
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t lhs, uint32_t rhs) { return sortKeys[lhs] > sortKeys[rhs]; });
+
+	std::vector<uint32_t> reordered;
+	reordered.reserve(indexCount);
+	for (uint32_t c : clusterOrder)
+	{
+		reordered.insert(reordered.end(), pIndices + clusterStarts[c] * 3u, pIndices + clusterStarts[c + 1u] * 3u);
+	}
+
+	const VertexCacheStats after = AnalyzeVertexCache(reordered.data(), indexCount, vertexCount);
+	if (after.ACMR <= before.ACMR * threshold)
+	{
+		std::copy(reordered.begin(), reordered.end(), pIndices);
+	}
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(uint32_t* pIndices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& outRemap)
+{
+	outRemap.assign(vertexCount, UINT32_MAX);
+
+	uint32_t nextVertex = 0u;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t& remapped = outRemap[pIndices[i]];
+		if (remapped == UINT32_MAX)
+		{
+			remapped = nextVertex++;
+		}
+		pIndices[i] = remapped;
+	}
+	return nextVertex;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Common/ScaldMath.h"
+#include "Common/MeshData.h"
+
+// Post-transform vertex cache efficiency of an index buffer.
+struct VertexCacheStats
+{
+	// Average cache miss ratio, transformed vertices per triangle (0.5 is ideal for large regular meshes, 3 is the worst case).
+	float ACMR = 0.0f;
+	// Average transform to vertex ratio, transformed vertices per referenced vertex (1 is ideal).
+	float ATVR = 0.0f;
+	UINT NumTransformedVertices = 0u;
+};
+
+struct MeshOptimizationStats
+{
+	VertexCacheStats Before;
+	VertexCacheStats After;
+};
+
+// CPU-only index/vertex buffer optimizations, all of them deterministic.
+class MeshOptimizer
+{
+public:
+	// Size of the FIFO cache used for analysis and overdraw clustering, close to what GPUs effectively give.
+	static constexpr UINT DefaultCacheSize = 16u;
+
+	// Simulates a FIFO post-transform cache.
+	static VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, UINT cacheSize = DefaultCacheSize);
+
+	// outRemap[i] is the first vertex bitwise identical to vertex i. Returns the number of unique vertices.
+	static size_t WeldVertices(const void* pVertices, size_t vertexCount, size_t vertexSize, std::vector<uint32_t>& outRemap);
+
+	// Forsyth's linear-speed vertex cache optimization, reorders triangles in place.
+	static void OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+
+	// Splits the cache optimized order into clusters at hard cache misses and sorts the clusters so that the outward facing ones go first
+	// (they tend to occlude the rest). Order is kept as is if the ACMR would get worse than threshold times the current one.
+	static void OptimizeOverdraw(uint32_t* pIndices, size_t indexCount, const XMFLOAT3* pPositions, size_t positionStride, size_t vertexCount, float threshold = 1.05f);
+
+	// Renumbers vertices in order of the first use, so vertex fetch walks memory linearly.
+	// outRemap[old] is the new index or UINT32_MAX for unreferenced vertices. Rewrites indices, returns the new vertex count.
+	static size_t OptimizeVertexFetch(uint32_t* pIndices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& outRemap);
+
+	// Runs the whole stage (weld, vertex cache, overdraw, vertex fetch) on every LOD of the mesh.
+	template<typename TVertex, typename TIndex>
+	static void Optimize(MeshData<TVertex, TIndex>& mesh, std::vector<MeshOptimizationStats>* outStats = nullptr)
+	{
+		if (outStats)
+		{
+			outStats->assign(mesh.NumLODs, MeshOptimizationStats());
+		}
+
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> remap;
+
+		for (UINT lod = 0; lod < mesh.NumLODs; ++lod)
+		{
+			std::vector<TVertex>& vertices = mesh.LODVertices[lod];
+			std::vector<TIndex>& lodIndices = mesh.LODIndices[lod];
+			if (vertices.empty() || lodIndices.empty())
+			{
+				continue;
+			}
+
+			indices.assign(lodIndices.begin(), lodIndices.end());
+			if (outStats)
+			{
+				(*outStats)[lod].Before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+			}
+
+			WeldVertices(vertices.data(), vertices.size(), sizeof(TVertex), remap);
+			for (uint32_t& index : indices)
+			{
+				index = remap[index];
+			}
+
+			OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+			OptimizeOverdraw(indices.data(), indices.size(), &vertices[0].position, sizeof(TVertex), vertices.size());
+
+			// Also drops the welded duplicates, nothing references them anymore.
+			const size_t newVertexCount = OptimizeVertexFetch(indices.data(), indices.size(), vertices.size(), remap);
+			std::vector<TVertex> newVertices(newVertexCount);
+			for (size_t i = 0; i < vertices.size(); ++i)
+			{
+				if (remap[i] != UINT32_MAX)
+				{
+					newVertices[remap[i]] = vertices[i];
+				}
+			}
+			vertices.swap(newVertices);
+			lodIndices.assign(indices.begin(), indices.end());
+
+			if (outStats)
+			{
+				(*outStats)[lod].After = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+			}
+		}
+	}
+};
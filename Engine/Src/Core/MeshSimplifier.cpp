@@ -0,0 +1,392 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Symmetric 4x4 matrix, weighted sum of squared distances to a set of planes.
+	struct Quadric
+	{
+		// a2, ab, ac, ad, b2, bc, bd, c2, cd, d2
+		double M[10] = {};
+		// Sum of the plane weights (areas), Evaluate divides by it.
+		double Weight = 0.0;
+
+		void AddPlane(double a, double b, double c, double d, double weight)
+		{
+			M[0] += weight * a * a; M[1] += weight * a * b; M[2] += weight * a * c; M[3] += weight * a * d;
+			M[4] += weight * b * b; M[5] += weight * b * c; M[6] += weight * b * d;
+			M[7] += weight * c * c; M[8] += weight * c * d;
+			M[9] += weight * d * d;
+			Weight += weight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			for (int i = 0; i < 10; ++i)
+			{
+				M[i] += q.M[i];
+			}
+			Weight += q.Weight;
+		}
+
+		// Weighted mean of squared distances, so the error is in squared length units whatever the weights are
+		// (area weights alone would give length^4 and scale differently than the error bound).
+		double Evaluate(const XMFLOAT3& p) const
+		{
+			if (Weight <= 0.0)
+			{
+				return 0.0;
+			}
+
+			const double x = p.x, y = p.y, z = p.z;
+			const double error =
+				M[0] * x * x + 2.0 * M[1] * x * y + 2.0 * M[2] * x * z + 2.0 * M[3] * x +
+				M[4] * y * y + 2.0 * M[5] * y * z + 2.0 * M[6] * y +
+				M[7] * z * z + 2.0 * M[8] * z +
+				M[9];
+			// Can go slightly negative due to rounding
+			return error > 0.0 ? error / Weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t From;
+		uint32_t To;
+		double Cost;
+	};
+
+	// Border planes are weighted heavier than surface ones, so open edges only collapse along themselves.
+	constexpr double BorderWeight = 10.0;
+
+	XMVECTOR TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		const XMVECTOR v0 = XMLoadFloat3(&p0);
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), v0), XMVectorSubtract(XMLoadFloat3(&p2), v0));
+	}
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return ((uint64_t)a << 32u) | b;
+	}
+}
+
+size_t MeshSimplifier::Simplify(
+	const XMFLOAT3* pPositions, size_t positionStride, size_t vertexCount,
+	const uint32_t* pIndices, size_t indexCount,
+	size_t targetIndexCount, float targetError,
+	std::vector<uint32_t>& outIndices, float* outError)
+{
+	assert(indexCount % 3u == 0u);
+
+	outIndices.assign(pIndices, pIndices + indexCount);
+	if (outError)
+	{
+		*outError = 0.0f;
+	}
+	if (indexCount <= targetIndexCount || vertexCount == 0u)
+	{
+		return indexCount;
+	}
+
+	std::vector<XMFLOAT3> positions(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		positions[i] = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pPositions) + i * positionStride);
+	}
+
+	// Errors are measured relative to the mesh size, so the same bound works for any scale.
+	// The mesh is moved into a unit-sized space around the origin, so all the costs are relative already
+	// and the order of collapses doesn't depend on the scale or placement of the mesh.
+	BoundingBox bounds;
+	BoundingBox::CreateFromPoints(bounds, vertexCount, positions.data(), sizeof(XMFLOAT3));
+	const float extent = 2.0f * std::max(bounds.Extents.x, std::max(bounds.Extents.y, bounds.Extents.z));
+	const XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	const XMVECTOR size = XMVectorReplicate(extent > 0.0f ? extent : 1.0f);
+	for (XMFLOAT3& position : positions)
+	{
+		XMStoreFloat3(&position, XMVectorDivide(XMVectorSubtract(XMLoadFloat3(&position), center), size));
+	}
+	const double maxCost = (double)targetError * targetError;
+
+#pragma region PositionGroups
+	// Vertices at the same position (split by normals or UVs) share a group, quadrics are accumulated per group.
+	std::vector<uint32_t> vertexGroup(vertexCount);
+	std::vector<uint32_t> groupSize;
+	{
+		struct PositionHash
+		{
+			size_t operator()(const XMFLOAT3& p) const
+			{
+				// + 0.0f turns -0.0f into +0.0f, they compare equal, so they must hash equal too.
+				const float coords[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+				uint32_t bits[3];
+				memcpy(bits, coords, sizeof(bits));
+				return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+		};
+
+		std::unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> groups;
+		groups.reserve(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			auto [it, bInserted] = groups.try_emplace(positions[i], (uint32_t)groupSize.size());
+			if (bInserted)
+			{
+				groupSize.push_back(0u);
+			}
+			vertexGroup[i] = it->second;
+			groupSize[it->second]++;
+		}
+	}
+	const size_t numGroups = groupSize.size();
+#pragma endregion PositionGroups
+
+#pragma region Quadrics
+	std::vector<Quadric> quadrics(numGroups);
+	std::unordered_set<uint64_t> groupEdges;
+	groupEdges.reserve(indexCount);
+
+	for (size_t t = 0; t < indexCount; t += 3u)
+	{
+		const XMFLOAT3& p0 = positions[pIndices[t + 0]];
+		const XMFLOAT3& p1 = positions[pIndices[t + 1]];
+		const XMFLOAT3& p2 = positions[pIndices[t + 2]];
+
+		const XMVECTOR normal = TriangleNormal(p0, p1, p2);
+		const float doubleArea = XMVectorGetX(XMVector3Length(normal));
+		if (doubleArea <= 0.0f)
+		{
+			continue;
+		}
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, XMVectorScale(normal, 1.0f / doubleArea));
+		const double d = -(n.x * p0.x + n.y * p0.y + n.z * p0.z);
+
+		for (UINT k = 0; k < 3u; ++k)
+		{
+			const uint32_t group = vertexGroup[pIndices[t + k]];
+			// Area weighted, so large triangles dominate the mean error of the vertex
+			quadrics[group].AddPlane(n.x, n.y, n.z, d, 0.5 * doubleArea);
+			groupEdges.insert(EdgeKey(group, vertexGroup[pIndices[t + (k + 1u) % 3u]]));
+		}
+	}
+
+	// An edge without its opposite half belongs to a single triangle, i.e. it is an open border.
+	// Constrain it with a plane through the edge, perpendicular to the triangle.
+	for (size_t t = 0; t < indexCount; t += 3u)
+	{
+		for (UINT k = 0; k < 3u; ++k)
+		{
+			const uint32_t i0 = pIndices[t + k];
+			const uint32_t i1 = pIndices[t + (k + 1u) % 3u];
+			if (groupEdges.count(EdgeKey(vertexGroup[i1], vertexGroup[i0])))
+			{
+				continue;
+			}
+
+			const XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+			const XMVECTOR edge = XMVectorSubtract(XMLoadFloat3(&positions[i1]), p0);
+			const XMVECTOR triNormal = TriangleNormal(positions[pIndices[t + 0]], positions[pIndices[t + 1]], positions[pIndices[t + 2]]);
+			const XMVECTOR borderNormal = XMVector3Normalize(XMVector3Cross(edge, triNormal));
+
+			XMFLOAT3 n;
+			XMStoreFloat3(&n, borderNormal);
+			const double d = -XMVectorGetX(XMVector3Dot(borderNormal, p0));
+			const double weight = BorderWeight * XMVectorGetX(XMVector3LengthSq(edge));
+
+			quadrics[vertexGroup[i0]].AddPlane(n.x, n.y, n.z, d, weight);
+			quadrics[vertexGroup[i1]].AddPlane(n.x, n.y, n.z, d, weight);
+		}
+	}
+#pragma endregion Quadrics
+
+	double resultCost = 0.0;
+
+	std::vector<uint32_t> triangleOffsets;
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> isGroupLocked(numGroups);
+
+	// Every pass collapses a batch of independent edges, cheapest first, then rebuilds the index buffer.
+	while (outIndices.size() > targetIndexCount)
+	{
+		const size_t triangleCount = outIndices.size() / 3u;
+
+		// Vertex to triangles adjacency (CSR)
+		triangleOffsets.assign(vertexCount + 1u, 0u);
+		for (uint32_t index : outIndices)
+		{
+			triangleOffsets[index + 1u]++;
+		}
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			triangleOffsets[i + 1u] += triangleOffsets[i];
+		}
+		vertexTriangles.resize(outIndices.size());
+		{
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < outIndices.size(); ++i)
+			{
+				vertexTriangles[fill[outIndices[i]]++] = (uint32_t)(i / 3u);
+			}
+		}
+
+		// Collapse candidates. Seam vertices (groups of several vertices) can be collapsed into, but never moved themselves.
+		collapses.clear();
+		for (size_t t = 0; t < outIndices.size(); t += 3u)
+		{
+			for (UINT k = 0; k < 3u; ++k)
+			{
+				const uint32_t a = outIndices[t + k];
+				const uint32_t b = outIndices[t + (k + 1u) % 3u];
+				// Every interior edge is seen from both triangles, keep one of them (borders are seen once, so keep them either way).
+				const uint32_t ga = vertexGroup[a];
+				const uint32_t gb = vertexGroup[b];
+				if (ga == gb || (a > b && groupEdges.count(EdgeKey(gb, ga))))
+				{
+					continue;
+				}
+
+				Quadric q = quadrics[ga];
+				q.Add(quadrics[gb]);
+
+				const double costAB = groupSize[ga] == 1u ? q.Evaluate(positions[b]) : DBL_MAX;
+				const double costBA = groupSize[gb] == 1u ? q.Evaluate(positions[a]) : DBL_MAX;
+				if (costAB == DBL_MAX && costBA == DBL_MAX)
+				{
+					continue;
+				}
+
+				collapses.push_back(costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.Cost < rhs.Cost; });
+
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			remap[i] = (uint32_t)i;
+		}
+		std::fill(isGroupLocked.begin(), isGroupLocked.end(), false);
+
+		const size_t targetTriangleCount = targetIndexCount / 3u;
+		size_t removedTriangles = 0u;
+		size_t numCollapses = 0u;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.Cost > maxCost || triangleCount - removedTriangles <= targetTriangleCount)
+			{
+				break;
+			}
+
+			const uint32_t from = collapse.From;
+			const uint32_t to = collapse.To;
+			if (isGroupLocked[vertexGroup[from]] || isGroupLocked[vertexGroup[to]])
+			{
+				continue;
+			}
+
+			// Reject collapses flipping any of the remaining triangles around the moved vertex.
+			bool bIsValid = true;
+			size_t collapsedTriangles = 0u;
+			for (uint32_t j = triangleOffsets[from]; j < triangleOffsets[from + 1u] && bIsValid; ++j)
+			{
+				const uint32_t* triangle = &outIndices[vertexTriangles[j] * 3u];
+				uint32_t corners[3] = { remap[triangle[0]], remap[triangle[1]], remap[triangle[2]] };
+				if (corners[0] == to || corners[1] == to || corners[2] == to)
+				{
+					collapsedTriangles++;
+					continue;
+				}
+
+				const XMVECTOR before = TriangleNormal(positions[corners[0]], positions[corners[1]], positions[corners[2]]);
+				for (uint32_t& corner : corners)
+				{
+					corner = corner == from ? to : corner;
+				}
+				const XMVECTOR after = TriangleNormal(positions[corners[0]], positions[corners[1]], positions[corners[2]]);
+
+				bIsValid = XMVectorGetX(XMVector3Dot(before, after)) > 0.0f;
+			}
+			if (!bIsValid)
+			{
+				continue;
+			}
+
+			remap[from] = to;
+			quadrics[vertexGroup[to]].Add(quadrics[vertexGroup[from]]);
+			resultCost = std::max(resultCost, collapse.Cost);
+			removedTriangles += collapsedTriangles;
+			numCollapses++;
+
+			// Lock the whole one-ring, flip checks of the next collapses rely on unchanged neighbourhoods.
+			for (uint32_t j = triangleOffsets[from]; j < triangleOffsets[from + 1u]; ++j)
+			{
+				const uint32_t* triangle = &outIndices[vertexTriangles[j] * 3u];
+				isGroupLocked[vertexGroup[triangle[0]]] = true;
+				isGroupLocked[vertexGroup[triangle[1]]] = true;
+				isGroupLocked[vertexGroup[triangle[2]]] = true;
+			}
+		}
+
+		if (numCollapses == 0u)
+		{
+			break;
+		}
+
+		// Apply the remap and drop degenerate triangles
+		size_t writeIndex = 0u;
+		for (size_t t = 0; t < outIndices.size(); t += 3u)
+		{
+			const uint32_t i0 = remap[outIndices[t + 0]];
+			const uint32_t i1 = remap[outIndices[t + 1]];
+			const uint32_t i2 = remap[outIndices[t + 2]];
+			if (i0 != i1 && i1 != i2 && i0 != i2)
+			{
+				outIndices[writeIndex++] = i0;
+				outIndices[writeIndex++] = i1;
+				outIndices[writeIndex++] = i2;
+			}
+		}
+		outIndices.resize(writeIndex);
+	}
+
+	if (outError)
+	{
+		*outError = (float)std::sqrt(resultCost);
+	}
+	return outIndices.size();
+}
+
+float MeshSimplifier::ComputeScreenSize(float radius, float distance, float fovY)
+{
+	assert(distance > 0.0f);
+
+	// Screen height at distance 1
+	const float screenHeightAtUnitDistance = 2.0f * tanf(0.5f * fovY);
+	return 2.0f * radius / (distance * screenHeightAtUnitDistance);
+}
+
+UINT MeshSimplifier::SelectLOD(float screenSize, UINT numLODs, float lod1ScreenSize)
+{
+	assert(numLODs > 0u);
+
+	UINT lod = 0u;
+	for (float threshold = lod1ScreenSize; lod + 1u < numLODs && screenSize < threshold; threshold *= 0.5f)
+	{
+		++lod;
+	}
+	return lod;
+}
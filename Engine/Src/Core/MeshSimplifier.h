@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Common/ScaldMath.h"
+#include "Common/MeshData.h"
+
+// Quadric error metric (Garland-Heckbert) simplifier, pure CPU.
+// Uses half-edge collapses (a vertex is merged into one of its neighbours), so no new vertices are created
+// and all vertex attributes stay intact. Vertices sharing a position with a different attributes (UV seams) and open borders are preserved.
+class MeshSimplifier
+{
+public:
+	// Simplifies the triangle list until targetIndexCount is reached or no collapse is cheaper than targetError.
+	// targetError and outError are relative to the mesh extent (largest side of its bounding box).
+	// outIndices reference the same vertices as the input indices. Returns the resulting index count.
+	static size_t Simplify(
+		const XMFLOAT3* pPositions, size_t positionStride, size_t vertexCount,
+		const uint32_t* pIndices, size_t indexCount,
+		size_t targetIndexCount, float targetError,
+		std::vector<uint32_t>& outIndices, float* outError = nullptr);
+
+	// Projected size of a bounding sphere, its diameter over the screen height, for a vertical field of view of fovY.
+	static float ComputeScreenSize(float radius, float distance, float fovY);
+	// LOD for a projected size: LOD 0 down to lod1ScreenSize, every halving below it one level coarser, up to the last of numLODs.
+	static UINT SelectLOD(float screenSize, UINT numLODs, float lod1ScreenSize);
+
+	// Fills LODs 1..numLODs-1 from LOD 0, every level has about reductionPerLOD of the triangles of the previous one.
+	// Each LOD gets its own compacted vertex array. Every level is simplified from LOD 0, so maxError bounds its distance
+	// to the original rather than adding up along the chain. The chain ends early once the error bound stops further reduction,
+	// NumLODs holds the actual number of levels.
+	template<typename TVertex, typename TIndex>
+	static void BuildLODChain(MeshData<TVertex, TIndex>& mesh, UINT numLODs, float reductionPerLOD = 0.5f, float maxError = 0.05f)
+	{
+		assert(numLODs > 0u && reductionPerLOD > 0.0f && reductionPerLOD < 1.0f);
+
+		mesh.LODVertices.resize(1u);
+		mesh.LODIndices.resize(1u);
+		mesh.LODBounds.resize(1u);
+		// No reallocation, baseVertices has to stay valid while LODs are appended.
+		mesh.LODVertices.reserve(numLODs);
+		mesh.LODIndices.reserve(numLODs);
+		mesh.LODBounds.reserve(numLODs);
+
+		const std::vector<TVertex>& baseVertices = mesh.LODVertices[0];
+		const std::vector<uint32_t> baseIndices(mesh.LODIndices[0].begin(), mesh.LODIndices[0].end());
+		size_t prevIndexCount = baseIndices.size();
+		std::vector<uint32_t> lodIndices;
+		std::vector<uint32_t> vertexRemap;
+
+		for (UINT lod = 1; lod < numLODs; ++lod)
+		{
+			const size_t targetIndexCount = (size_t)(prevIndexCount / 3u * reductionPerLOD) * 3u;
+
+			Simplify(&baseVertices[0].position, sizeof(TVertex), baseVertices.size(), baseIndices.data(), baseIndices.size(),
+				targetIndexCount, maxError, lodIndices);
+
+			// Not worth another level
+			if (lodIndices.empty() || lodIndices.size() * 10u > prevIndexCount * 9u)
+			{
+				break;
+			}
+
+			// Compact used vertices, so every LOD is a standalone mesh.
+			std::vector<TVertex> vertices;
+			std::vector<TIndex> indices(lodIndices.size());
+			vertexRemap.assign(baseVertices.size(), UINT32_MAX);
+			for (size_t i = 0; i < lodIndices.size(); ++i)
+			{
+				uint32_t& remapped = vertexRemap[lodIndices[i]];
+				if (remapped == UINT32_MAX)
+				{
+					remapped = (uint32_t)vertices.size();
+					vertices.push_back(baseVertices[lodIndices[i]]);
+				}
+				indices[i] = (TIndex)remapped;
+			}
+
+			BoundingBox bounds;
+			BoundingBox::CreateFromPoints(bounds, vertices.size(), &vertices[0].position, sizeof(TVertex));
+
+			mesh.LODVertices.push_back(std::move(vertices));
+			mesh.LODIndices.push_back(std::move(indices));
+			mesh.LODBounds.push_back(bounds);
+
+			prevIndexCount = lodIndices.size();
+		}
+
+		mesh.NumLODs = (UINT)mesh.LODVertices.size();
+	}
+};
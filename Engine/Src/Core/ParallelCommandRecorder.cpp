@@ -0,0 +1,46 @@
+#include "ParallelCommandRecorder.h"
+
+void RecordingScheduler::Schedule(const UINT* numDrawsPerPass, UINT numPasses, UINT maxTasks, UINT minDrawsPerTask, std::vector<RecordingTask>& outTasks)
+{
+	assert(numPasses <= maxTasks && "Every pass needs at least one task");
+	assert(minDrawsPerTask > 0u);
+
+	outTasks.clear();
+
+	UINT totalDraws = 0u;
+	for (UINT pass = 0; pass < numPasses; ++pass)
+	{
+		totalDraws += numDrawsPerPass[pass];
+	}
+
+	const UINT spareTasks = maxTasks - numPasses;
+
+	for (UINT pass = 0; pass < numPasses; ++pass)
+	{
+		const UINT numDraws = numDrawsPerPass[pass];
+
+		// Proportional share of spare tasks, rounded down, so the total never exceeds maxTasks.
+		const UINT share = totalDraws > 0u ? (UINT)((UINT64)spareTasks * numDraws / totalDraws) : 0u;
+		// Whole chunks only, so no chunk gets fewer than minDrawsPerTask draws.
+		const UINT wantedTasks = std::max(numDraws / minDrawsPerTask, 1u);
+		const UINT numTasks = std::min(wantedTasks, 1u + share);
+
+		// Spread remainder over the first chunks, so chunk sizes differ by one draw at most.
+		const UINT drawsPerTask = numDraws / numTasks;
+		const UINT remainder = numDraws % numTasks;
+
+		UINT drawBegin = 0u;
+		for (UINT i = 0; i < numTasks; ++i)
+		{
+			RecordingTask task;
+			task.PassIndex = pass;
+			task.DrawBegin = drawBegin;
+			task.DrawEnd = drawBegin + drawsPerTask + (i < remainder ? 1u : 0u);
+			task.bIsFirstInPass = (i == 0u);
+			task.bIsLastInPass = (i == numTasks - 1u);
+			outTasks.push_back(task);
+
+			drawBegin = task.DrawEnd;
+		}
+	}
+}
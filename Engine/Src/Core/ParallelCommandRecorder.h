@@ -0,0 +1,111 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <functional>
+
+// Single recording job: a contiguous range of draws of one pass, recorded into its own command list.
+struct RecordingTask
+{
+	UINT PassIndex = 0u;
+	UINT DrawBegin = 0u;
+	UINT DrawEnd = 0u;
+	bool bIsFirstInPass = false;
+	bool bIsLastInPass = false;
+};
+
+class RecordingScheduler
+{
+public:
+	// Every pass gets at least one task. Passes with many draws are split into chunks of at least minDrawsPerTask draws,
+	// spare tasks (up to maxTasks in total) are shared between passes proportionally to their draw counts.
+	// Tasks are ordered by pass and then by draw range, which is also the order their command lists have to be submitted in.
+	static void Schedule(const UINT* numDrawsPerPass, UINT numPasses, UINT maxTasks, UINT minDrawsPerTask, std::vector<RecordingTask>& outTasks);
+};
+
+// Records passes into several command lists at once. Command lists (and their allocators) are owned by the caller,
+// the recorder knows nothing about D3D, so it works with any type exposing the calls used by the pass callbacks.
+template<typename TCommandList>
+class ParallelCommandRecorder
+{
+public:
+	struct Pass
+	{
+		// Draws of the pass are split between tasks. Passes with no draws are recorded as a single task.
+		UINT NumDraws = 0u;
+
+		// Recorded first in every task of the pass, command lists do not inherit any state from each other.
+		std::function<void(TCommandList*)> BindState;
+		// Recorded once, in the first task of the pass, before any draw. Barriers and clears go here.
+		std::function<void(TCommandList*)> Begin;
+		// Records draws [begin, end).
+		std::function<void(TCommandList*, UINT, UINT)> DrawRange;
+		// Recorded once, in the last task of the pass.
+		std::function<void(TCommandList*)> End;
+	};
+
+public:
+	ParallelCommandRecorder() = default;
+	ParallelCommandRecorder(const ParallelCommandRecorder& lhs) = delete;
+	ParallelCommandRecorder& operator=(const ParallelCommandRecorder& lhs) = delete;
+
+	~ParallelCommandRecorder() noexcept = default;
+
+public:
+	const std::vector<RecordingTask>& Schedule(const std::vector<Pass>& passes, UINT maxTasks)
+	{
+		m_numDraws.resize(passes.size());
+		for (size_t i = 0; i < passes.size(); ++i)
+		{
+			m_numDraws[i] = passes[i].NumDraws;
+		}
+
+		RecordingScheduler::Schedule(m_numDraws.data(), (UINT)m_numDraws.size(), maxTasks, MinDrawsPerTask, m_tasks);
+		return m_tasks;
+	}
+
+	FORCEINLINE const std::vector<RecordingTask>& GetTasks() const { return m_tasks; }
+
+	// Records the scheduled tasks, commandLists[i] receives the commands of GetTasks()[i].
+	// Tasks run as jobs, the calling thread helps with them and returns when all of the tasks are recorded.
+	void Record(const std::vector<Pass>& passes, TCommandList* const* commandLists) const
+	{
+		JobSystem::Get().ParallelFor((UINT)m_tasks.size(), 1u, [this, &passes, commandLists](UINT begin, UINT end)
+			{
+				for (UINT i = begin; i < end; ++i)
+				{
+					RecordTask(passes, m_tasks[i], commandLists[i]);
+				}
+			});
+	}
+
+private:
+	static void RecordTask(const std::vector<Pass>& passes, const RecordingTask& task, TCommandList* pCommandList)
+	{
+		const Pass& pass = passes[task.PassIndex];
+
+		if (pass.BindState)
+		{
+			pass.BindState(pCommandList);
+		}
+		if (task.bIsFirstInPass && pass.Begin)
+		{
+			pass.Begin(pCommandList);
+		}
+		if (pass.DrawRange && task.DrawBegin < task.DrawEnd)
+		{
+			pass.DrawRange(pCommandList, task.DrawBegin, task.DrawEnd);
+		}
+		if (task.bIsLastInPass && pass.End)
+		{
+			pass.End(pCommandList);
+		}
+	}
+
+private:
+	// Fewer draws than that are not worth a separate command list.
+	static constexpr UINT MinDrawsPerTask = 64u;
+
+	std::vector<RecordingTask> m_tasks;
+	std::vector<UINT> m_numDraws;
+};
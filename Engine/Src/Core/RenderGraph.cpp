@@ -0,0 +1,416 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	FORCEINLINE UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+
+	FORCEINLINE bool DoRangesOverlap(UINT beginA, UINT endA, UINT beginB, UINT endB)
+	{
+		return beginA <= endB && beginB <= endA;
+	}
+
+	FORCEINLINE RenderGraphBarrier MakeTransition(UINT resource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+	{
+		RenderGraphBarrier barrier;
+		barrier.Type = RenderGraphBarrier::Transition;
+		barrier.Resource = resource;
+		barrier.StateBefore = stateBefore;
+		barrier.StateAfter = stateAfter;
+		return barrier;
+	}
+}
+
+UINT RenderGraph::AddResource(const RenderGraphResourceDesc& desc)
+{
+	assert(!desc.bIsTransient || (desc.SizeInBytes > 0u && desc.Alignment > 0u));
+
+	Resource resource;
+	resource.Desc = desc;
+	m_resources.push_back(resource);
+	return (UINT)m_resources.size() - 1u;
+}
+
+UINT RenderGraph::AddPass(const std::string& name, bool bHasSideEffects)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.bHasSideEffects = bHasSideEffects;
+	m_passes.push_back(pass);
+	return (UINT)m_passes.size() - 1u;
+}
+
+void RenderGraph::SetTransientSize(UINT resource, UINT64 sizeInBytes, UINT64 alignment)
+{
+	assert(resource < GetNumResources());
+	assert(m_resources[resource].Desc.bIsTransient && sizeInBytes > 0u && alignment > 0u);
+
+	m_resources[resource].Desc.SizeInBytes = sizeInBytes;
+	m_resources[resource].Desc.Alignment = alignment;
+}
+
+void RenderGraph::Read(UINT pass, UINT resource, D3D12_RESOURCE_STATES state)
+{
+	AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(UINT pass, UINT resource, D3D12_RESOURCE_STATES state)
+{
+	AddAccess(pass, resource, state, true);
+}
+
+void RenderGraph::AddAccess(UINT pass, UINT resource, D3D12_RESOURCE_STATES state, bool bIsWrite)
+{
+	assert(pass < GetNumPasses());
+	assert(resource < GetNumResources());
+
+	for (Access& access : m_passes[pass].Accesses)
+	{
+		if (access.Resource == resource)
+		{
+			// Read only states combine, a written resource is in exactly one state.
+			assert(!access.bIsWrite && !bIsWrite);
+			access.State |= state;
+			return;
+		}
+	}
+
+	Access access;
+	access.Resource = resource;
+	access.State = state;
+	access.bIsWrite = bIsWrite;
+	m_passes[pass].Accesses.push_back(access);
+}
+
+void RenderGraph::Compile()
+{
+	m_stats = {};
+	m_stats.NumPasses = GetNumPasses();
+
+	CullPasses();
+	ComputeLifetimes();
+	PlaceTransients();
+	BuildBarriers();
+}
+
+void RenderGraph::CullPasses()
+{
+	// Walking backwards, a pass is needed if a needed pass reads what it writes. Imported resources are the frame's outputs.
+	std::vector<bool> isResourceNeeded(m_resources.size(), false);
+	for (UINT i = GetNumPasses(); i-- > 0u;)
+	{
+		Pass& pass = m_passes[i];
+
+		bool bIsNeeded = pass.bHasSideEffects;
+		for (const Access& access : pass.Accesses)
+		{
+			if (access.bIsWrite && (!m_resources[access.Resource].Desc.bIsTransient || isResourceNeeded[access.Resource]))
+			{
+				bIsNeeded = true;
+			}
+		}
+
+		pass.bIsCulled = !bIsNeeded;
+		if (pass.bIsCulled)
+		{
+			++m_stats.NumCulledPasses;
+			continue;
+		}
+
+		for (const Access& access : pass.Accesses)
+		{
+			if (!access.bIsWrite)
+			{
+				isResourceNeeded[access.Resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (Resource& resource : m_resources)
+	{
+		resource.FirstPass = InvalidIndex;
+		resource.LastPass = InvalidIndex;
+	}
+
+	for (UINT i = 0; i < GetNumPasses(); ++i)
+	{
+		if (m_passes[i].bIsCulled)
+		{
+			continue;
+		}
+
+		for (const Access& access : m_passes[i].Accesses)
+		{
+			Resource& resource = m_resources[access.Resource];
+			if (resource.FirstPass == InvalidIndex)
+			{
+				resource.FirstPass = i;
+			}
+			resource.LastPass = i;
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients()
+{
+	std::vector<UINT> transients;
+	for (UINT i = 0; i < GetNumResources(); ++i)
+	{
+		Resource& resource = m_resources[i];
+		resource.HeapOffset = InvalidOffset;
+		if (resource.Desc.bIsTransient && resource.FirstPass != InvalidIndex)
+		{
+			transients.push_back(i);
+			m_stats.TransientBytes += resource.Desc.SizeInBytes;
+		}
+	}
+
+	// Greedy first fit, largest first: a resource goes to the lowest offset not taken by the placed ones it lives along with.
+	std::sort(transients.begin(), transients.end(), [this](UINT lhs, UINT rhs)
+		{
+			const UINT64 lhsSize = m_resources[lhs].Desc.SizeInBytes;
+			const UINT64 rhsSize = m_resources[rhs].Desc.SizeInBytes;
+			return lhsSize != rhsSize ? lhsSize > rhsSize : lhs < rhs;
+		});
+
+	std::vector<std::pair<UINT64, UINT64>> takenRanges;
+	for (size_t i = 0; i < transients.size(); ++i)
+	{
+		Resource& resource = m_resources[transients[i]];
+
+		takenRanges.clear();
+		for (size_t j = 0; j < i; ++j)
+		{
+			const Resource& placed = m_resources[transients[j]];
+			if (DoRangesOverlap(resource.FirstPass, resource.LastPass, placed.FirstPass, placed.LastPass))
+			{
+				takenRanges.emplace_back(placed.HeapOffset, placed.HeapOffset + placed.Desc.SizeInBytes);
+			}
+		}
+		std::sort(takenRanges.begin(), takenRanges.end());
+
+		UINT64 offset = 0u;
+		for (const auto& [takenBegin, takenEnd] : takenRanges)
+		{
+			offset = AlignUp(offset, resource.Desc.Alignment);
+			if (offset + resource.Desc.SizeInBytes <= takenBegin)
+			{
+				break;
+			}
+			offset = std::max(offset, takenEnd);
+		}
+
+		resource.HeapOffset = AlignUp(offset, resource.Desc.Alignment);
+		m_stats.TransientHeapBytes = std::max(m_stats.TransientHeapBytes, resource.HeapOffset + resource.Desc.SizeInBytes);
+	}
+}
+
+void RenderGraph::BuildBarriers()
+{
+	struct Use
+	{
+		UINT Pass = 0u;
+		D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+		bool bIsWrite = false;
+	};
+
+	// States the alive passes need every resource in, in the order they run.
+	std::vector<std::vector<Use>> uses(m_resources.size());
+	for (UINT i = 0; i < GetNumPasses(); ++i)
+	{
+		Pass& pass = m_passes[i];
+		pass.Barriers.clear();
+		if (pass.bIsCulled)
+		{
+			continue;
+		}
+
+		for (const Access& access : pass.Accesses)
+		{
+			uses[access.Resource].push_back({ i, access.State, access.bIsWrite });
+
+			if (access.State != m_resources[access.Resource].Desc.InitialState)
+			{
+				// Into the pass's state and back
+				m_stats.NumUnmergedTransitions += 2u;
+			}
+		}
+	}
+
+	// Consecutive reads are done in the union of their states, so the resource is transitioned once for all of them.
+	for (std::vector<Use>& resourceUses : uses)
+	{
+		for (size_t begin = 0; begin < resourceUses.size();)
+		{
+			size_t end = begin;
+			D3D12_RESOURCE_STATES readState = D3D12_RESOURCE_STATE_COMMON;
+			while (end < resourceUses.size() && !resourceUses[end].bIsWrite)
+			{
+				readState |= resourceUses[end++].State;
+			}
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				resourceUses[i].State = readState;
+			}
+			begin = std::max(end, begin + 1u);
+		}
+	}
+
+	// Aliasing barriers go first in a batch, before the transitions of the resources taking over the memory.
+	for (UINT i = 0; i < GetNumResources(); ++i)
+	{
+		const Resource& resource = m_resources[i];
+		if (resource.HeapOffset == InvalidOffset)
+		{
+			continue;
+		}
+
+		// Memory is reused every frame, so it has to be taken over from the previous user even if that ran in the previous frame.
+		UINT resourceBefore = InvalidIndex;
+		UINT numResourcesBefore = 0u;
+		for (UINT j = 0; j < GetNumResources(); ++j)
+		{
+			const Resource& other = m_resources[j];
+			if (j == i || other.HeapOffset == InvalidOffset)
+			{
+				continue;
+			}
+
+			if (resource.HeapOffset < other.HeapOffset + other.Desc.SizeInBytes && other.HeapOffset < resource.HeapOffset + resource.Desc.SizeInBytes)
+			{
+				resourceBefore = j;
+				++numResourcesBefore;
+			}
+		}
+
+		if (numResourcesBefore > 0u)
+		{
+			RenderGraphBarrier barrier;
+			barrier.Type = RenderGraphBarrier::Aliasing;
+			barrier.Resource = i;
+			barrier.ResourceBefore = numResourcesBefore == 1u ? resourceBefore : InvalidIndex;
+			m_passes[resource.FirstPass].Barriers.push_back(barrier);
+			++m_stats.NumAliasingBarriers;
+		}
+	}
+
+	m_endBarriers.clear();
+	m_setupBarriers.clear();
+	for (UINT i = 0; i < GetNumResources(); ++i)
+	{
+		const std::vector<Use>& resourceUses = uses[i];
+		if (resourceUses.empty())
+		{
+			continue;
+		}
+
+		const RenderGraphResourceDesc& desc = m_resources[i].Desc;
+		D3D12_RESOURCE_STATES state = desc.InitialState;
+		if (desc.bIsTransient)
+		{
+			// Memory of a transient may have been used by another resource, it has to be written before it is read.
+			assert(resourceUses.front().bIsWrite);
+
+			// The previous frame left it in the state of its last use
+			state = resourceUses.back().State;
+			if (state != desc.InitialState)
+			{
+				m_setupBarriers.push_back(MakeTransition(i, desc.InitialState, state));
+			}
+		}
+
+		for (const Use& use : resourceUses)
+		{
+			if (use.State != state)
+			{
+				m_passes[use.Pass].Barriers.push_back(MakeTransition(i, state, use.State));
+				state = use.State;
+				++m_stats.NumTransitions;
+			}
+		}
+
+		if (!desc.bIsTransient && state != desc.InitialState)
+		{
+			m_endBarriers.push_back(MakeTransition(i, state, desc.InitialState));
+			++m_stats.NumTransitions;
+		}
+	}
+
+	for (const Pass& pass : m_passes)
+	{
+		m_stats.NumBarrierBatches += pass.Barriers.empty() ? 0u : 1u;
+	}
+	m_stats.NumBarrierBatches += m_endBarriers.empty() ? 0u : 1u;
+}
+
+std::string RenderGraph::BuildReport() const
+{
+	constexpr double BytesPerMB = 1024.0 * 1024.0;
+
+	std::string report;
+	char line[256] = {};
+	auto AppendLine = [&report, &line]()
+		{
+			report += line;
+			report += '\n';
+		};
+
+	snprintf(line, sizeof(line), "RenderGraph: %u passes, %u culled", m_stats.NumPasses, m_stats.NumCulledPasses);
+	AppendLine();
+	snprintf(line, sizeof(line), "Barriers: %u transitions and %u aliasing barriers in %u batches, %u transitions unmerged",
+		m_stats.NumTransitions, m_stats.NumAliasingBarriers, m_stats.NumBarrierBatches, m_stats.NumUnmergedTransitions);
+	AppendLine();
+
+	for (const Pass& pass : m_passes)
+	{
+		if (pass.bIsCulled)
+		{
+			snprintf(line, sizeof(line), "  %s: culled", pass.Name.c_str());
+		}
+		else
+		{
+			snprintf(line, sizeof(line), "  %s: %u barriers", pass.Name.c_str(), (UINT)pass.Barriers.size());
+		}
+		AppendLine();
+
+		for (const RenderGraphBarrier& barrier : pass.Barriers)
+		{
+			const char* name = m_resources[barrier.Resource].Desc.Name.c_str();
+			if (barrier.Type == RenderGraphBarrier::Aliasing)
+			{
+				snprintf(line, sizeof(line), "    %s: aliasing", name);
+			}
+			else
+			{
+				snprintf(line, sizeof(line), "    %s: 0x%x -> 0x%x", name, (UINT)barrier.StateBefore, (UINT)barrier.StateAfter);
+			}
+			AppendLine();
+		}
+	}
+	snprintf(line, sizeof(line), "  End: %u barriers", (UINT)m_endBarriers.size());
+	AppendLine();
+
+	snprintf(line, sizeof(line), "Transient memory: %.2f MB placed in %.2f MB",
+		m_stats.TransientBytes / BytesPerMB, m_stats.TransientHeapBytes / BytesPerMB);
+	AppendLine();
+	for (const Resource& resource : m_resources)
+	{
+		if (resource.HeapOffset != InvalidOffset)
+		{
+			snprintf(line, sizeof(line), "  %s: %.2f MB at %.2f MB, passes %u-%u", resource.Desc.Name.c_str(),
+				resource.Desc.SizeInBytes / BytesPerMB, resource.HeapOffset / BytesPerMB, resource.FirstPass, resource.LastPass);
+			AppendLine();
+		}
+	}
+
+	return report;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "Common/ScaldD3DTypes.h"
+
+#include <climits>
+
+// Transient resources only live within a frame: their memory may be shared with other transients whose passes
+// don't overlap, and they are left in the state of their last use. Imported resources (e.g. the back buffer)
+// keep their memory and are returned to InitialState at the end of the frame.
+struct RenderGraphResourceDesc
+{
+	std::string Name;
+	bool bIsTransient = false;
+	// State the resource is created in
+	D3D12_RESOURCE_STATES InitialState = D3D12_RESOURCE_STATE_COMMON;
+
+	// Placement requirements of transients, as returned by ID3D12Device::GetResourceAllocationInfo.
+	// On resource heap tier 1 render targets and depth stencils can't share a heap with other textures,
+	// so transients of one graph should be of a single kind there.
+	UINT64 SizeInBytes = 0u;
+	UINT64 Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+};
+
+struct RenderGraphBarrier
+{
+	enum EType : UINT8
+	{
+		Transition = 0u,
+		// Resource takes over memory last used by ResourceBefore, or by one of several resources if it is InvalidIndex.
+		Aliasing
+	};
+
+	EType Type = Transition;
+	UINT Resource = 0u;
+	UINT ResourceBefore = UINT_MAX;
+	D3D12_RESOURCE_STATES StateBefore = D3D12_RESOURCE_STATE_COMMON;
+	D3D12_RESOURCE_STATES StateAfter = D3D12_RESOURCE_STATE_COMMON;
+};
+
+struct RenderGraphStats
+{
+	UINT NumPasses = 0u;
+	UINT NumCulledPasses = 0u;
+
+	// Per frame
+	UINT NumTransitions = 0u;
+	UINT NumAliasingBarriers = 0u;
+	// ResourceBarrier calls, one per pass with barriers plus the end of the frame.
+	UINT NumBarrierBatches = 0u;
+	// Transitions if every pass moved its resources out of their initial state and back on its own.
+	UINT NumUnmergedTransitions = 0u;
+
+	// Sum of the transient resources' sizes and the heap they are placed in.
+	UINT64 TransientBytes = 0u;
+	UINT64 TransientHeapBytes = 0u;
+};
+
+// Declarative frame description: passes, in the order they run, declare the states they need their resources in.
+// Compiling culls the passes nothing depends on, places transient resources in a shared heap and builds barriers,
+// batched into a single ResourceBarrier call per pass. Nothing here touches the device, the caller records
+// the barriers and creates the placed resources at the offsets returned.
+class RenderGraph
+{
+public:
+	static constexpr UINT InvalidIndex = UINT_MAX;
+	static constexpr UINT64 InvalidOffset = UINT64_MAX;
+
+	RenderGraph() = default;
+	RenderGraph(const RenderGraph& lhs) = delete;
+	RenderGraph& operator=(const RenderGraph& lhs) = delete;
+
+	~RenderGraph() noexcept = default;
+
+public:
+	// Both return consecutive indices starting from 0, by which resources and passes are referred to.
+	UINT AddResource(const RenderGraphResourceDesc& desc);
+	// Passes with side effects (e.g. readbacks) are never culled, neither are the ones writing imported resources.
+	UINT AddPass(const std::string& name, bool bHasSideEffects = false);
+	// Placement requirements change with the resource (e.g. on resize), Compile again to place it.
+	void SetTransientSize(UINT resource, UINT64 sizeInBytes, UINT64 alignment);
+
+	// A pass may read a resource in several states at once (e.g. depth test and shader sampling), but not read and write it.
+	void Read(UINT pass, UINT resource, D3D12_RESOURCE_STATES state);
+	void Write(UINT pass, UINT resource, D3D12_RESOURCE_STATES state);
+
+	void Compile();
+
+	FORCEINLINE UINT GetNumPasses() const { return (UINT)m_passes.size(); }
+	FORCEINLINE UINT GetNumResources() const { return (UINT)m_resources.size(); }
+	FORCEINLINE const RenderGraphResourceDesc& GetResourceDesc(UINT resource) const { return m_resources[resource].Desc; }
+
+	FORCEINLINE bool IsPassCulled(UINT pass) const { return m_passes[pass].bIsCulled; }
+	// To be recorded right before the pass. Empty for culled passes.
+	FORCEINLINE const std::vector<RenderGraphBarrier>& GetPassBarriers(UINT pass) const { return m_passes[pass].Barriers; }
+	// To be recorded after the last pass, returns imported resources to their initial state.
+	FORCEINLINE const std::vector<RenderGraphBarrier>& GetEndBarriers() const { return m_endBarriers; }
+	// To be recorded once before the first frame, moves transients from their initial state to the one every frame leaves them in.
+	FORCEINLINE const std::vector<RenderGraphBarrier>& GetSetupBarriers() const { return m_setupBarriers; }
+
+	// Placement of a transient resource in the heap, InvalidOffset if it is imported or unused.
+	FORCEINLINE UINT64 GetHeapOffset(UINT resource) const { return m_resources[resource].HeapOffset; }
+	FORCEINLINE UINT64 GetTransientHeapSize() const { return m_stats.TransientHeapBytes; }
+
+	FORCEINLINE const RenderGraphStats& GetStats() const { return m_stats; }
+	// Passes with their barriers and the transients' placement, one per line.
+	std::string BuildReport() const;
+
+private:
+	struct Access
+	{
+		UINT Resource = 0u;
+		D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+		bool bIsWrite = false;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		bool bHasSideEffects = false;
+		bool bIsCulled = false;
+		// One per resource, reads of the same resource are merged.
+		std::vector<Access> Accesses;
+		std::vector<RenderGraphBarrier> Barriers;
+	};
+
+	struct Resource
+	{
+		RenderGraphResourceDesc Desc;
+		// Alive passes using it, InvalidIndex if none
+		UINT FirstPass = InvalidIndex;
+		UINT LastPass = InvalidIndex;
+		UINT64 HeapOffset = InvalidOffset;
+	};
+
+	void AddAccess(UINT pass, UINT resource, D3D12_RESOURCE_STATES state, bool bIsWrite);
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void PlaceTransients();
+	void BuildBarriers();
+
+private:
+	std::vector<Pass> m_passes;
+	std::vector<Resource> m_resources;
+
+	std::vector<RenderGraphBarrier> m_endBarriers;
+	std::vector<RenderGraphBarrier> m_setupBarriers;
+
+	RenderGraphStats m_stats;
+};
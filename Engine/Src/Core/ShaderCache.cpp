@@ -0,0 +1,329 @@
+#include "ShaderCache.h"
+#include "AssetArchive.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+	struct ShaderCacheEntryHeader
+	{
+		static constexpr UINT32 MagicValue = 0x48534353u; // "SCSH"
+
+		UINT32 Magic = MagicValue;
+		UINT32 Version = ShaderCache::Version;
+		UINT64 Key = 0u;
+		UINT64 ByteCodeSize = 0u;
+	};
+
+	constexpr UINT64 FnvOffsetBasis = 14695981039346656037ull;
+	constexpr UINT64 FnvPrime = 1099511628211ull;
+
+	// FNV-1a
+	UINT64 HashBytes(UINT64 hash, const void* pData, size_t size)
+	{
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= pBytes[i];
+			hash *= FnvPrime;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	FORCEINLINE UINT64 HashValue(UINT64 hash, const T& value)
+	{
+		return HashBytes(hash, &value, sizeof(value));
+	}
+
+	// Length prefixed, so ("AB", "C") and ("A", "BC") hash differently.
+	FORCEINLINE UINT64 HashString(UINT64 hash, std::string_view str)
+	{
+		hash = HashValue(hash, (UINT64)str.size());
+		return HashBytes(hash, str.data(), str.size());
+	}
+
+	std::string GetSourceKey(const std::filesystem::path& fileName)
+	{
+		return fileName.lexically_normal().generic_u8string();
+	}
+}
+
+ShaderCache::ShaderCache(const std::filesystem::path& directory, const AssetArchive* pArchive)
+	: m_directory(directory)
+	, m_pArchive(pArchive)
+{
+	// A missing directory only turns every Store into a failure.
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+}
+
+bool ShaderCache::ComputeKey(const ShaderCompileDesc& desc, UINT64& outKey)
+{
+	UINT64 hash = HashValue(FnvOffsetBasis, Version);
+
+	// Depth first in include order, so the key does not depend on how the includes were discovered.
+	std::vector<std::filesystem::path> pending = { desc.FileName };
+	std::unordered_set<std::string> visited;
+	while (!pending.empty())
+	{
+		const std::filesystem::path fileName = std::move(pending.back());
+		pending.pop_back();
+
+		std::string sourceKey = GetSourceKey(fileName);
+		if (!visited.insert(sourceKey).second)
+		{
+			continue;
+		}
+
+		const SourceFile& source = GetSourceFile(fileName);
+		if (!source.bIsValid)
+		{
+			return false;
+		}
+
+		hash = HashString(hash, sourceKey);
+		hash = HashValue(hash, source.ContentHash);
+
+		pending.insert(pending.end(), source.Includes.rbegin(), source.Includes.rend());
+	}
+
+	hash = HashValue(hash, (UINT64)desc.Defines.size());
+	for (const ShaderDefine& define : desc.Defines)
+	{
+		hash = HashString(hash, define.Name);
+		hash = HashString(hash, define.Value);
+	}
+
+	hash = HashString(hash, desc.EntryPoint);
+	hash = HashString(hash, desc.Target);
+	hash = HashValue(hash, desc.Flags);
+	hash = HashValue(hash, desc.CompilerVersion);
+
+	outKey = hash;
+	return true;
+}
+
+bool ShaderCache::Load(UINT64 key, std::vector<uint8_t>& outByteCode) const
+{
+	std::ifstream file(GetEntryFileName(key), std::ios::binary | std::ios::ate);
+	const UINT64 fileSize = file ? (UINT64)file.tellg() : 0u;
+	file.seekg(0, std::ios::beg);
+
+	ShaderCacheEntryHeader header;
+	const bool bIsValid = fileSize >= sizeof(header)
+		&& file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		&& header.Magic == ShaderCacheEntryHeader::MagicValue
+		&& header.Version == Version
+		&& header.Key == key
+		&& header.ByteCodeSize == fileSize - sizeof(header);
+
+	if (bIsValid)
+	{
+		outByteCode.resize((size_t)header.ByteCodeSize);
+		if (file.read(reinterpret_cast<char*>(outByteCode.data()), (std::streamsize)outByteCode.size()))
+		{
+			m_numHits.fetch_add(1u, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	outByteCode.clear();
+	m_numMisses.fetch_add(1u, std::memory_order_relaxed);
+	return false;
+}
+
+bool ShaderCache::Store(UINT64 key, const void* pByteCode, size_t byteCodeSize) const
+{
+	const std::filesystem::path fileName = GetEntryFileName(key);
+	std::filesystem::path tempFileName = fileName;
+	tempFileName += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	{
+		std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		ShaderCacheEntryHeader header;
+		header.Key = key;
+		header.ByteCodeSize = byteCodeSize;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(static_cast<const char*>(pByteCode), (std::streamsize)byteCodeSize);
+
+		if (!file.good())
+		{
+			file.close();
+			std::error_code error;
+			std::filesystem::remove(tempFileName, error);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempFileName, fileName, error);
+	if (error)
+	{
+		std::filesystem::remove(tempFileName, error);
+		return false;
+	}
+
+	return true;
+}
+
+ShaderCacheStats ShaderCache::GetStats() const
+{
+	ShaderCacheStats stats;
+	stats.NumHits = m_numHits.load(std::memory_order_relaxed);
+	stats.NumMisses = m_numMisses.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void ShaderCache::ScanIncludes(std::string_view source, std::vector<std::string>& outIncludes)
+{
+	auto SkipBlanks = [&source](size_t i)
+		{
+			while (i < source.size() && (source[i] == ' ' || source[i] == '\t'))
+			{
+				++i;
+			}
+			return i;
+		};
+
+	// Only whitespace (or comments) since the last line break, so a '#' starts a directive.
+	bool bIsLineStart = true;
+	size_t i = 0;
+	while (i < source.size())
+	{
+		const char c = source[i];
+		const char next = i + 1u < source.size() ? source[i + 1u] : '\0';
+
+		if (c == '\n')
+		{
+			bIsLineStart = true;
+			++i;
+		}
+		else if (c == ' ' || c == '\t' || c == '\r')
+		{
+			++i;
+		}
+		else if (c == '/' && next == '/')
+		{
+			i = source.find('\n', i);
+			i = i == std::string_view::npos ? source.size() : i;
+		}
+		else if (c == '/' && next == '*')
+		{
+			i = source.find("*/", i + 2u);
+			i = i == std::string_view::npos ? source.size() : i + 2u;
+		}
+		else if (c == '"')
+		{
+			// String literals may contain anything comment or directive like.
+			for (++i; i < source.size() && source[i] != '"' && source[i] != '\n'; ++i)
+			{
+				if (source[i] == '\\')
+				{
+					++i;
+				}
+			}
+			++i;
+			bIsLineStart = false;
+		}
+		else if (c == '#' && bIsLineStart)
+		{
+			constexpr std::string_view IncludeDirective = "include";
+
+			i = SkipBlanks(i + 1u);
+			if (source.substr(i, IncludeDirective.size()) == IncludeDirective)
+			{
+				i = SkipBlanks(i + IncludeDirective.size());
+				if (i < source.size() && (source[i] == '"' || source[i] == '<'))
+				{
+					const char closing = source[i] == '"' ? '"' : '>';
+					const size_t begin = i + 1u;
+					const size_t end = source.find_first_of(closing == '"' ? "\"\n" : ">\n", begin);
+					if (end != std::string_view::npos && source[end] == closing)
+					{
+						outIncludes.emplace_back(source.substr(begin, end - begin));
+						i = end + 1u;
+					}
+				}
+			}
+			bIsLineStart = false;
+		}
+		else
+		{
+			bIsLineStart = false;
+			++i;
+		}
+	}
+}
+
+bool ShaderCache::ReadSource(const AssetArchive* pArchive, const std::filesystem::path& fileName, std::string& outSource)
+{
+	if (const AssetArchiveEntry* pEntry = pArchive ? pArchive->Find(fileName) : nullptr)
+	{
+		std::unique_ptr<uint8_t[]> decompressed;
+		const uint8_t* pData = pArchive->Load(*pEntry, decompressed);
+		if (!pData)
+		{
+			return false;
+		}
+
+		outSource.assign(reinterpret_cast<const char*>(pData), (size_t)pEntry->Size);
+		return true;
+	}
+
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return false;
+	}
+
+	outSource.resize((size_t)file.tellg());
+	file.seekg(0, std::ios::beg);
+	return (bool)file.read(outSource.data(), (std::streamsize)outSource.size());
+}
+
+const ShaderCache::SourceFile& ShaderCache::GetSourceFile(const std::filesystem::path& fileName)
+{
+	const std::string sourceKey = GetSourceKey(fileName);
+	{
+		std::lock_guard<std::mutex> lock(m_sourcesMutex);
+		auto it = m_sources.find(sourceKey);
+		if (it != m_sources.end())
+		{
+			return it->second;
+		}
+	}
+
+	// Read outside of the lock, two threads may scan the same file, the first one to finish wins.
+	SourceFile source;
+	std::string contents;
+	if (ReadSource(m_pArchive, fileName, contents))
+	{
+		source.bIsValid = true;
+		source.ContentHash = HashBytes(FnvOffsetBasis, contents.data(), contents.size());
+
+		std::vector<std::string> includes;
+		ScanIncludes(contents, includes);
+		for (const std::string& include : includes)
+		{
+			source.Includes.push_back(fileName.parent_path() / std::filesystem::u8path(include));
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_sourcesMutex);
+	return m_sources.emplace(sourceKey, std::move(source)).first->second;
+}
+
+std::filesystem::path ShaderCache::GetEntryFileName(UINT64 key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)key);
+	return m_directory / name;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+
+#include <atomic>
+#include <filesystem>
+#include <string_view>
+
+class AssetArchive;
+
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Value;
+};
+
+// Everything the compiled bytecode depends on, besides the contents of the source files.
+struct ShaderCompileDesc
+{
+	std::filesystem::path FileName;
+	std::vector<ShaderDefine> Defines;
+	std::string EntryPoint;
+	std::string Target;
+	UINT Flags = 0u;
+	UINT CompilerVersion = 0u;
+};
+
+struct ShaderCacheStats
+{
+	UINT64 NumHits = 0u;
+	UINT64 NumMisses = 0u;
+};
+
+// Persistent cache of compiled shaders. The key hashes the shader source and the sources of its transitive
+// #include closure, the defines, entry point, target, compile flags and compiler version, so any change to them
+// is a miss and stale bytecode is never loaded. Each entry is a file named after its key in the cache directory.
+//
+// The sources are read and scanned once per cache instance, so a header shared by all shaders is read once.
+// Sources packed into the asset archive take precedence over the loose files, the same as for compilation.
+// Thread safe.
+class ShaderCache
+{
+public:
+	// Bumped whenever the key or the file layout changes, invalidating every existing entry.
+	static constexpr UINT Version = 1u;
+
+	ShaderCache(const std::filesystem::path& directory, const AssetArchive* pArchive = nullptr);
+	ShaderCache(const ShaderCache& lhs) = delete;
+	ShaderCache& operator=(const ShaderCache& lhs) = delete;
+
+	~ShaderCache() noexcept = default;
+
+	// Fails if the shader or one of its includes cannot be read, such a shader should be compiled without the cache.
+	bool ComputeKey(const ShaderCompileDesc& desc, UINT64& outKey);
+
+	bool Load(UINT64 key, std::vector<uint8_t>& outByteCode) const;
+	// Written to a temporary file first, so a concurrent or interrupted store never leaves a partial entry behind.
+	bool Store(UINT64 key, const void* pByteCode, size_t byteCodeSize) const;
+
+	ShaderCacheStats GetStats() const;
+
+public:
+	// Appends the files named by the #include directives of an HLSL source, commented out directives are skipped.
+	// Directives inside of disabled #if blocks are still reported, which can only cause unnecessary misses.
+	static void ScanIncludes(std::string_view source, std::vector<std::string>& outIncludes);
+
+	// Reads a shader source out of the archive if it packs it, otherwise from disk. pArchive may be null.
+	static bool ReadSource(const AssetArchive* pArchive, const std::filesystem::path& fileName, std::string& outSource);
+
+private:
+	struct SourceFile
+	{
+		bool bIsValid = false;
+		UINT64 ContentHash = 0u;
+		// Resolved like D3D_COMPILE_STANDARD_FILE_INCLUDE does, relative to the including file.
+		std::vector<std::filesystem::path> Includes;
+	};
+
+	const SourceFile& GetSourceFile(const std::filesystem::path& fileName);
+	std::filesystem::path GetEntryFileName(UINT64 key) const;
+
+private:
+	std::filesystem::path m_directory;
+	const AssetArchive* m_pArchive = nullptr;
+
+	std::mutex m_sourcesMutex;
+	// Keyed by the normalized path. Node based, references stay valid while other files are added.
+	std::unordered_map<std::string, SourceFile> m_sources;
+
+	mutable std::atomic<UINT64> m_numHits = 0u;
+	mutable std::atomic<UINT64> m_numMisses = 0u;
+};
@@ -0,0 +1,200 @@
+#include "ShaderPermutations.h"
+
+ShaderPermutations::ShaderPermutations(CompileFunc compile)
+	: m_compile(std::move(compile))
+{
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+	WaitForLazyCompiles();
+}
+
+ShaderPermutations::ShaderId ShaderPermutations::Declare(const std::filesystem::path& fileName, const std::string& entryPoint, const std::string& target, const std::vector<std::string>& features)
+{
+	assert(features.size() <= MaxFeatures);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (ShaderId shader = 0; shader < (ShaderId)m_declarations.size(); ++shader)
+	{
+		const Declaration& declaration = m_declarations[shader];
+		if (declaration.FileName == fileName && declaration.EntryPoint == entryPoint && declaration.Target == target && declaration.Features == features)
+		{
+			return shader;
+		}
+	}
+
+	m_declarations.push_back({ fileName, entryPoint, target, features });
+	return (ShaderId)m_declarations.size() - 1u;
+}
+
+UINT64 ShaderPermutations::MakeKey(ShaderId shader, UINT features) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return MakeKeyLocked(shader, features);
+}
+
+UINT64 ShaderPermutations::MakeKeyLocked(ShaderId shader, UINT features) const
+{
+	assert(shader < m_declarations.size());
+
+	const UINT numFeatures = (UINT)m_declarations[shader].Features.size();
+	const UINT featureMask = numFeatures < MaxFeatures ? (1u << numFeatures) - 1u : ~0u;
+	return ((UINT64)shader << 32u) | (features & featureMask);
+}
+
+ShaderCompileDesc ShaderPermutations::GetCompileDesc(UINT64 key) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return GetCompileDescLocked(key);
+}
+
+ShaderCompileDesc ShaderPermutations::GetCompileDescLocked(UINT64 key) const
+{
+	const Declaration& declaration = m_declarations[GetShader(key)];
+	const UINT features = GetFeatures(key);
+
+	ShaderCompileDesc desc;
+	desc.FileName = declaration.FileName;
+	desc.EntryPoint = declaration.EntryPoint;
+	desc.Target = declaration.Target;
+	for (UINT bit = 0; bit < (UINT)declaration.Features.size(); ++bit)
+	{
+		if (features & (1u << bit))
+		{
+			desc.Defines.push_back({ declaration.Features[bit], "1" });
+		}
+	}
+
+	return desc;
+}
+
+UINT64 ShaderPermutations::Require(ShaderId shader, UINT features)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const UINT64 key = MakeKeyLocked(shader, features);
+	m_variants.try_emplace(key);
+	return key;
+}
+
+bool ShaderPermutations::CompileRequired()
+{
+	std::vector<std::pair<UINT64, ShaderCompileDesc>> compiles;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& [key, variant] : m_variants)
+		{
+			if (variant.State == EVariantState::Required)
+			{
+				variant.State = EVariantState::Compiling;
+				compiles.emplace_back(key, GetCompileDescLocked(key));
+			}
+		}
+	}
+
+	// The map order is arbitrary, this keeps the work order the same from run to run.
+	std::sort(compiles.begin(), compiles.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	std::vector<std::vector<uint8_t>> byteCodes(compiles.size());
+	std::vector<UINT8> results(compiles.size(), 0u);
+	JobSystem::Get().ParallelFor((UINT)compiles.size(), 1u, [&](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; ++i)
+			{
+				results[i] = m_compile(compiles[i].second, byteCodes[i]) ? 1u : 0u;
+			}
+		});
+
+	bool bAreAllCompiled = true;
+	for (size_t i = 0; i < compiles.size(); ++i)
+	{
+		OnCompiled(compiles[i].first, results[i] != 0u, std::move(byteCodes[i]));
+		bAreAllCompiled &= results[i] != 0u;
+	}
+
+	return bAreAllCompiled;
+}
+
+const std::vector<uint8_t>* ShaderPermutations::Find(UINT64 key) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_variants.find(key);
+	return it != m_variants.end() && it->second.State == EVariantState::Compiled ? &it->second.ByteCode : nullptr;
+}
+
+const std::vector<uint8_t>* ShaderPermutations::FindOrFallback(UINT64 key)
+{
+	bool bShouldCompile = false;
+	ShaderCompileDesc desc;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Bits the shader does not declare are dropped, like Require does, so they never make variants of their own.
+		key = MakeKeyLocked(GetShader(key), GetFeatures(key));
+		Variant& variant = m_variants[key];
+		if (variant.State == EVariantState::Compiled)
+		{
+			return &variant.ByteCode;
+		}
+
+		if (variant.State == EVariantState::Required)
+		{
+			variant.State = EVariantState::Compiling;
+			desc = GetCompileDescLocked(key);
+			bShouldCompile = true;
+		}
+	}
+
+	// Outside of the lock, the job runs inline when the job system is not running.
+	if (bShouldCompile)
+	{
+		JobSystem::Get().Run([this, key, desc = std::move(desc)]()
+			{
+				std::vector<uint8_t> byteCode;
+				const bool bIsCompiled = m_compile(desc, byteCode);
+				OnCompiled(key, bIsCompiled, std::move(byteCode));
+			}, &m_lazyCompiles);
+	}
+
+	const UINT64 fallbackKey = MakeKey(GetShader(key), 0u);
+	return fallbackKey != key ? Find(fallbackKey) : Find(key);
+}
+
+void ShaderPermutations::WaitForLazyCompiles()
+{
+	JobSystem::Get().Wait(m_lazyCompiles);
+}
+
+UINT ShaderPermutations::GetNumVariants() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (UINT)m_variants.size();
+}
+
+UINT ShaderPermutations::GetNumCompiled() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	UINT numCompiled = 0u;
+	for (const auto& [key, variant] : m_variants)
+	{
+		numCompiled += variant.State == EVariantState::Compiled ? 1u : 0u;
+	}
+	return numCompiled;
+}
+
+void ShaderPermutations::OnCompiled(UINT64 key, bool bIsCompiled, std::vector<uint8_t>&& byteCode)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Variant& variant = m_variants.at(key);
+	assert(variant.State == EVariantState::Compiling);
+	if (bIsCompiled)
+	{
+		variant.ByteCode = std::move(byteCode);
+	}
+	variant.State = bIsCompiled ? EVariantState::Compiled : EVariantState::Failed;
+}
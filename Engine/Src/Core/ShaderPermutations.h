@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ShaderCache.h"
+#include "JobSystem.h"
+
+#include <functional>
+
+// Variants of declared shaders. A shader is declared once with the list of its feature defines,
+// a variant is then addressed by a permutation key: the shader in the upper 32 bits, its feature mask in the lower ones,
+// where bit i turns on the i-th declared define. Bits the shader does not declare are dropped, so equal variants share a key.
+//
+// Required variants are compiled together on the job system, so startup scales with the cores, not the shader count.
+// Other variants can be compiled lazily in the background, the featureless variant of the shader stands in meanwhile.
+// Compiling goes through a callback, this class itself knows nothing about D3D. Thread safe.
+class ShaderPermutations
+{
+public:
+	using ShaderId = UINT;
+	// Must be thread safe and must not throw, as it runs on the workers.
+	using CompileFunc = std::function<bool(const ShaderCompileDesc& desc, std::vector<uint8_t>& outByteCode)>;
+
+	static constexpr UINT MaxFeatures = 32u;
+
+	ShaderPermutations(CompileFunc compile);
+	ShaderPermutations(const ShaderPermutations& lhs) = delete;
+	ShaderPermutations& operator=(const ShaderPermutations& lhs) = delete;
+
+	// Waits for the lazy compiles, they reference this object.
+	~ShaderPermutations();
+
+	// Declaring the same file, entry point, target and features again returns the existing shader.
+	ShaderId Declare(const std::filesystem::path& fileName, const std::string& entryPoint, const std::string& target, const std::vector<std::string>& features = {});
+
+	UINT64 MakeKey(ShaderId shader, UINT features) const;
+	static FORCEINLINE ShaderId GetShader(UINT64 key) { return (ShaderId)(key >> 32u); }
+	static FORCEINLINE UINT GetFeatures(UINT64 key) { return (UINT)key; }
+
+	// Defines are listed in feature bit order, each defined to 1.
+	ShaderCompileDesc GetCompileDesc(UINT64 key) const;
+
+	// Adds the variant to the next CompileRequired. Requiring it again is a no-op.
+	UINT64 Require(ShaderId shader, UINT features);
+	// Compiles every variant required and not compiled yet, and returns once all of them are done.
+	// Returns false if any of them failed to compile.
+	bool CompileRequired();
+
+	// nullptr until the variant is compiled, or if it failed to.
+	const std::vector<uint8_t>* Find(UINT64 key) const;
+	// The variant if it is compiled, otherwise starts compiling it in the background and returns its shader's featureless
+	// variant, or nullptr if that one is not compiled either. Returned bytecode does not change for the lifetime of this object.
+	const std::vector<uint8_t>* FindOrFallback(UINT64 key);
+	void WaitForLazyCompiles();
+
+	UINT GetNumVariants() const;
+	UINT GetNumCompiled() const;
+
+private:
+	enum class EVariantState : UINT8
+	{
+		Required,
+		Compiling,
+		Compiled,
+		Failed,
+	};
+
+	struct Declaration
+	{
+		std::filesystem::path FileName;
+		std::string EntryPoint;
+		std::string Target;
+		std::vector<std::string> Features;
+	};
+
+	struct Variant
+	{
+		EVariantState State = EVariantState::Required;
+		// Written once, before State becomes Compiled.
+		std::vector<uint8_t> ByteCode;
+	};
+
+	// m_mutex must be held.
+	UINT64 MakeKeyLocked(ShaderId shader, UINT features) const;
+	ShaderCompileDesc GetCompileDescLocked(UINT64 key) const;
+	void OnCompiled(UINT64 key, bool bIsCompiled, std::vector<uint8_t>&& byteCode);
+
+private:
+	CompileFunc m_compile;
+
+	mutable std::mutex m_mutex;
+	std::vector<Declaration> m_declarations;
+	// Node based, so bytecode handed out stays where it is.
+	std::unordered_map<UINT64, Variant> m_variants;
+
+	JobCounter m_lazyCompiles;
+};
@@ -55,21 +55,17 @@ void ShadowMap::OnResize(UINT newWidth, UINT newHeight)
 	}
 }
 
-void ShadowMap::CreateShadowCascadeSplits(float nearZ, float farZ)
+void ShadowMap::CreateShadowCascadeSplits(float nearZ, float farZ, float lambda)
 {
-	const float minZ = nearZ;
-	const float maxZ = farZ;
-
-	const float range = maxZ - minZ;
-	const float ratio = maxZ / minZ;
+	const float range = farZ - nearZ;
+	const float ratio = farZ / nearZ;
 
 	for (int i = 0; i < MaxCascades; i++)
 	{
-		float p = (i + 1) / (float)(MaxCascades);
-		float log = (float)(minZ * pow(ratio, p));
-		float uniform = minZ + range * p;
-		float d = 0.95f * (log - uniform) + uniform; // 0.95f - idk, just magic value
-		m_shadowCascadeLevels[i] = ((d - minZ) / range) * maxZ;
+		const float p = (i + 1) / (float)(MaxCascades);
+		const float log = nearZ * powf(ratio, p);
+		const float uniform = nearZ + range * p;
+		m_shadowCascadeLevels[i] = lambda * (log - uniform) + uniform;
 	}
 }
 
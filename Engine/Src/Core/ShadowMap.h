@@ -36,8 +36,8 @@ public:
 		return m_shadowCascadeLevels[level];
 	}
 
-	// could be updatable if we are changing frustum in runtime 
-	void CreateShadowCascadeSplits(float nearZ, float farZ);
+	// Practical split scheme: lambda blends uniform (0) and logarithmic (1) splits.
+	void CreateShadowCascadeSplits(float nearZ, float farZ, float lambda = 0.95f);
 
 protected:
 	virtual void CreateDescriptors();
@@ -1,9 +1,23 @@
-#include "stdafx.h"
 #include "Shapes.h"
+#include "JobSystem.h"
 
-MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateBox(float width, float height, float depth)
+namespace
 {
-    MeshData<VertexPositionNormalTangentUV, uint16_t> meshData;
+	// Rows, rings and faces per job
+	constexpr UINT MinRowsPerJob = 16u;
+	constexpr UINT MinFacesPerJob = 4096u;
+	constexpr UINT MinVerticesPerJob = 4096u;
+
+	uint64_t EdgeKey(uint32_t v0, uint32_t v1)
+	{
+		return v0 < v1 ? ((uint64_t)v0 << 32u) | v1 : ((uint64_t)v1 << 32u) | v0;
+	}
+}
+
+template<typename TIndex>
+MeshData<VertexPositionNormalTangentUV, TIndex> Shapes::CreateBox(float width, float height, float depth)
+{
+    MeshData<VertexPositionNormalTangentUV, TIndex> meshData;
 
     VertexPositionNormalTangentUV v[24];
 
@@ -49,7 +63,7 @@ MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateBox(float width,
 
 	meshData.LODVertices[0].assign(&v[0], &v[24]);
 
-	uint16_t i[36];
+	TIndex i[36];
 
 	// Fill in the front face index data
 	i[0] = 0; i[1] = 1; i[2] = 2;
@@ -85,91 +99,160 @@ MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateBox(float width,
 	return meshData;
 }
 
-MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateSphere(float radius, UINT sliceCount, UINT stackCount)
+template<typename TIndex>
+MeshData<VertexPositionNormalTangentUV, TIndex> Shapes::CreateSphere(float radius, UINT sliceCount, UINT stackCount)
 {
-	MeshData<VertexPositionNormalTangentUV, uint16_t> meshData;
-	
-	VertexPositionNormalTangentUV topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	VertexPositionNormalTangentUV bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	MeshData<VertexPositionNormalTangentUV, TIndex> meshData;
 
-	meshData.LODVertices[0].push_back(topVertex);
+	const UINT ringVertexCount = sliceCount + 1;
+	// Poles are not counted as rings
+	const UINT ringCount = stackCount - 1;
+	std::vector<VertexPositionNormalTangentUV>& vertices = meshData.LODVertices[0];
+	std::vector<TIndex>& indices = meshData.LODIndices[0];
 
-	float phiStep = XM_PI / stackCount;
-	float thetaStep = 2.0f * XM_PI / sliceCount;
+	vertices.resize(ringCount * ringVertexCount + 2);
+	indices.resize(6 * sliceCount * ringCount);
+	CheckIndexRange<TIndex>(vertices.size());
 
-	// Compute vertices for each stack ring (do not count the poles as rings).
-	for (UINT i = 1; i <= stackCount - 1; ++i)
-	{
-		float phi = i * phiStep;
+	const float phiStep = XM_PI / stackCount;
+	const float thetaStep = 2.0f * XM_PI / sliceCount;
 
-		// Vertices of ring.
-		for (UINT j = 0; j <= sliceCount; ++j)
-		{
-			float theta = j * thetaStep;
+	vertices.front() = VertexPositionNormalTangentUV(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+	vertices.back() = VertexPositionNormalTangentUV(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-			VertexPositionNormalTangentUV v;
+	// Compute vertices for each stack ring, top pole vertex is skipped.
+	JobSystem::Get().ParallelFor(ringCount, MinRowsPerJob, [&](UINT firstRing, UINT lastRing)
+		{
+			for (UINT ring = firstRing; ring < lastRing; ++ring)
+			{
+				const float phi = (ring + 1) * phiStep;
 
-			// spherical to cartesian
-			v.position.x = radius * sinf(phi) * cosf(theta);
-			v.position.y = radius * cosf(phi);
-			v.position.z = radius * sinf(phi) * sinf(theta);
+				for (UINT j = 0; j <= sliceCount; ++j)
+				{
+					const float theta = j * thetaStep;
 
-			// Partial derivative of P with respect to theta
-			v.tangent.x = -radius * sinf(phi) * sinf(theta);
-			v.tangent.y = 0.0f;
-			v.tangent.z = +radius * sinf(phi) * cosf(theta);
+					VertexPositionNormalTangentUV& v = vertices[1 + ring * ringVertexCount + j];
 
-			XMVECTOR T = XMLoadFloat3(&v.tangent);
-			XMStoreFloat3(&v.tangent, XMVector3Normalize(T));
+					// spherical to cartesian
+					v.position.x = radius * sinf(phi) * cosf(theta);
+					v.position.y = radius * cosf(phi);
+					v.position.z = radius * sinf(phi) * sinf(theta);
 
-			XMVECTOR p = XMLoadFloat3(&v.position);
-			XMStoreFloat3(&v.normal, XMVector3Normalize(p));
+					// Partial derivative of P with respect to theta
+					v.tangent.x = -radius * sinf(phi) * sinf(theta);
+					v.tangent.y = 0.0f;
+					v.tangent.z = +radius * sinf(phi) * cosf(theta);
 
-			v.texCoord.x = theta / XM_2PI;
-			v.texCoord.y = phi / XM_PI;
+					XMVECTOR T = XMLoadFloat3(&v.tangent);
+					XMStoreFloat3(&v.tangent, XMVector3Normalize(T));
 
-			meshData.LODVertices[0].push_back(v);
-		}
-	}
+					XMVECTOR p = XMLoadFloat3(&v.position);
+					XMStoreFloat3(&v.normal, XMVector3Normalize(p));
 
-	meshData.LODVertices[0].push_back(bottomVertex);
+					v.texCoord.x = theta / XM_2PI;
+					v.texCoord.y = phi / XM_PI;
+				}
+			}
+		});
 
+	// Top cap
 	for (UINT i = 1; i <= sliceCount; ++i)
 	{
-		meshData.LODIndices[0].push_back(0);
-		meshData.LODIndices[0].push_back(i + 1);
-		meshData.LODIndices[0].push_back(i);
+		indices[(i - 1) * 3 + 0] = 0;
+		indices[(i - 1) * 3 + 1] = i + 1;
+		indices[(i - 1) * 3 + 2] = i;
 	}
 
 	// Offset the indices to the index of the first vertex in the first ring.
 	// This is just skipping the top pole vertex.
-	UINT baseIndex = 1;
-	UINT ringVertexCount = sliceCount + 1;
-	for (UINT i = 0; i < stackCount - 2; ++i)
-	{
-		for (UINT j = 0; j < sliceCount; ++j)
+	const UINT baseIndex = 1;
+	const UINT capIndexCount = 3 * sliceCount;
+	JobSystem::Get().ParallelFor(ringCount - 1, MinRowsPerJob, [&](UINT firstStack, UINT lastStack)
 		{
-			meshData.LODIndices[0].push_back(baseIndex + i * ringVertexCount + j);
-			meshData.LODIndices[0].push_back(baseIndex + i * ringVertexCount + j + 1);
-			meshData.LODIndices[0].push_back(baseIndex + (i + 1) * ringVertexCount + j);
+			for (UINT i = firstStack; i < lastStack; ++i)
+			{
+				UINT k = capIndexCount + 6 * sliceCount * i;
+				for (UINT j = 0; j < sliceCount; ++j)
+				{
+					indices[k++] = baseIndex + i * ringVertexCount + j;
+					indices[k++] = baseIndex + i * ringVertexCount + j + 1;
+					indices[k++] = baseIndex + (i + 1) * ringVertexCount + j;
+
+					indices[k++] = baseIndex + (i + 1) * ringVertexCount + j;
+					indices[k++] = baseIndex + i * ringVertexCount + j + 1;
+					indices[k++] = baseIndex + (i + 1) * ringVertexCount + j + 1;
+				}
+			}
+		});
+
+	// South pole vertex is the last one, bottom cap uses the last ring.
+	const UINT southPoleIndex = (UINT)vertices.size() - 1;
+	const UINT lastRingIndex = southPoleIndex - ringVertexCount;
+
+	UINT k = (UINT)indices.size() - capIndexCount;
+	for (UINT i = 0; i < sliceCount; ++i)
+	{
+		indices[k++] = southPoleIndex;
+		indices[k++] = lastRingIndex + i;
+		indices[k++] = lastRingIndex + i + 1;
+	}
 
-			meshData.LODIndices[0].push_back(baseIndex + (i + 1) * ringVertexCount + j);
-			meshData.LODIndices[0].push_back(baseIndex + i * ringVertexCount + j + 1);
-			meshData.LODIndices[0].push_back(baseIndex + (i + 1) * ringVertexCount + j + 1);
-		}
+	for (UINT i = 0; i < meshData.NumLODs; ++i)
+	{
+		BoundingBox::CreateFromPoints(meshData.LODBounds[i], meshData.LODVertices[i].size(), &meshData.LODVertices[i][0].position, sizeof(VertexPositionNormalTangentUV));
 	}
 
-	// South pole vertex was added last.
-	UINT southPoleIndex = (UINT)meshData.LODVertices[0].size() - 1;
+	return meshData;
+}
 
-	// Offset the indices to the index of the first vertex in the last ring.
-	baseIndex = southPoleIndex - ringVertexCount;
+template<typename TIndex>
+MeshData<VertexPositionNormalTangentUV, TIndex> Shapes::CreateCone(float radius, float height, UINT sliceCount)
+{
+	MeshData<VertexPositionNormalTangentUV, TIndex> meshData;
 
-	for (UINT i = 0; i < sliceCount; ++i)
+	const UINT ringVertexCount = sliceCount + 1;
+	std::vector<VertexPositionNormalTangentUV>& vertices = meshData.LODVertices[0];
+	std::vector<TIndex>& indices = meshData.LODIndices[0];
+
+	// Side: an apex and a base vertex per slice edge, so every edge has its own normal. Cap: center and its own ring.
+	vertices.resize(2 * ringVertexCount + 1 + ringVertexCount);
+	indices.resize(6 * sliceCount);
+	CheckIndexRange<TIndex>(vertices.size());
+
+	const float thetaStep = 2.0f * XM_PI / sliceCount;
+	// Side normal leans back towards the apex by the cone's half angle.
+	const float slantLength = sqrtf(radius * radius + height * height);
+	const float normalRadial = height / slantLength;
+	const float normalZ = -radius / slantLength;
+
+	const UINT capCenterIndex = 2 * ringVertexCount;
+	const UINT capRingIndex = capCenterIndex + 1;
+	vertices[capCenterIndex] = VertexPositionNormalTangentUV(0.0f, 0.0f, height, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f);
+
+	for (UINT j = 0; j <= sliceCount; ++j)
 	{
-		meshData.LODIndices[0].push_back(southPoleIndex);
-		meshData.LODIndices[0].push_back(baseIndex + i);
-		meshData.LODIndices[0].push_back(baseIndex + i + 1);
+		const float theta = j * thetaStep;
+		const float c = cosf(theta);
+		const float s = sinf(theta);
+
+		// Apex vertices come first, then the base ring of the side.
+		vertices[j] = VertexPositionNormalTangentUV(0.0f, 0.0f, 0.0f, normalRadial * c, normalRadial * s, normalZ, -s, c, 0.0f, theta / XM_2PI, 0.0f);
+		vertices[ringVertexCount + j] = VertexPositionNormalTangentUV(radius * c, radius * s, height, normalRadial * c, normalRadial * s, normalZ, -s, c, 0.0f, theta / XM_2PI, 1.0f);
+		vertices[capRingIndex + j] = VertexPositionNormalTangentUV(radius * c, radius * s, height, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.5f + 0.5f * c, 0.5f - 0.5f * s);
+	}
+
+	UINT k = 0;
+	for (UINT j = 0; j < sliceCount; ++j)
+	{
+		indices[k++] = j;
+		indices[k++] = ringVertexCount + j + 1;
+		indices[k++] = ringVertexCount + j;
+	}
+	for (UINT j = 0; j < sliceCount; ++j)
+	{
+		indices[k++] = capCenterIndex;
+		indices[k++] = capRingIndex + j;
+		indices[k++] = capRingIndex + j + 1;
 	}
 
 	for (UINT i = 0; i < meshData.NumLODs; ++i)
@@ -180,82 +263,100 @@ MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateSphere(float rad
 	return meshData;
 }
 
-MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateGrid(float width, float depth, UINT m, UINT n)
+template<typename TIndex>
+MeshData<VertexPositionNormalTangentUV, TIndex> Shapes::CreateGrid(float width, float depth, UINT m, UINT n)
 {
-	MeshData<VertexPositionNormalTangentUV, uint16_t> meshData;
+	MeshData<VertexPositionNormalTangentUV, TIndex> meshData;
+
+	const UINT vertexCount = m * n;
+	const UINT faceCount = (m - 1) * (n - 1) * 2;
 
-	UINT vertexCount = m * n;
-	UINT faceCount = (m - 1) * (n - 1) * 2;
+	std::vector<VertexPositionNormalTangentUV>& vertices = meshData.LODVertices[0];
+	std::vector<TIndex>& indices = meshData.LODIndices[0];
+
+	vertices.resize(vertexCount);
+	indices.resize(faceCount * 3); // 3 indices per face
+	CheckIndexRange<TIndex>(vertices.size());
 
 	//
 	// Create the vertices.
 	//
 
-	float halfWidth = 0.5f * width;
-	float halfDepth = 0.5f * depth;
+	const float halfWidth = 0.5f * width;
+	const float halfDepth = 0.5f * depth;
 
-	float dx = width / (n - 1);
-	float dz = depth / (m - 1);
+	const float dx = width / (n - 1);
+	const float dz = depth / (m - 1);
 
-	float du = 1.0f / (n - 1);
-	float dv = 1.0f / (m - 1);
+	const float du = 1.0f / (n - 1);
+	const float dv = 1.0f / (m - 1);
 
-	meshData.LODVertices[0].resize(vertexCount);
-	for (UINT i = 0; i < m; ++i)
-	{
-		float z = halfDepth - i * dz;
-		for (UINT j = 0; j < n; ++j)
+	JobSystem::Get().ParallelFor(m, MinRowsPerJob, [&](UINT firstRow, UINT lastRow)
 		{
-			float x = -halfWidth + j * dx;
-
-			meshData.LODVertices[0][i * n + j].position = XMFLOAT3(x, 0.0f, z);
-			meshData.LODVertices[0][i * n + j].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.LODVertices[0][i * n + j].tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			// Stretch texture over grid.
-			meshData.LODVertices[0][i * n + j].texCoord.x = j * du;
-			meshData.LODVertices[0][i * n + j].texCoord.y = i * dv;
-		}
-	}
+			for (UINT i = firstRow; i < lastRow; ++i)
+			{
+				const float z = halfDepth - i * dz;
+				for (UINT j = 0; j < n; ++j)
+				{
+					const float x = -halfWidth + j * dx;
+
+					VertexPositionNormalTangentUV& v = vertices[i * n + j];
+					v.position = XMFLOAT3(x, 0.0f, z);
+					v.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+					v.tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+					// Stretch texture over grid.
+					v.texCoord.x = j * du;
+					v.texCoord.y = i * dv;
+				}
+			}
+		});
 
 	//
 	// Create the indices.
 	//
 
-	meshData.LODIndices[0].resize(faceCount * 3); // 3 indices per face
-
-	// Iterate over each quad and compute indices.
-	UINT k = 0;
-	for (UINT i = 0; i < m - 1; ++i)
-	{
-		for (UINT j = 0; j < n - 1; ++j)
+	// Iterate over each quad and compute indices, every row of quads writes its own range.
+	JobSystem::Get().ParallelFor(m - 1, MinRowsPerJob, [&](UINT firstRow, UINT lastRow)
 		{
-			meshData.LODIndices[0][k] = i * n + j;
-			meshData.LODIndices[0][k + 1] = i * n + j + 1;
-			meshData.LODIndices[0][k + 2] = (i + 1) * n + j;
+			for (UINT i = firstRow; i < lastRow; ++i)
+			{
+				UINT k = i * (n - 1) * 6;
+				for (UINT j = 0; j < n - 1; ++j)
+				{
+					indices[k] = i * n + j;
+					indices[k + 1] = i * n + j + 1;
+					indices[k + 2] = (i + 1) * n + j;
+
+					indices[k + 3] = (i + 1) * n + j;
+					indices[k + 4] = i * n + j + 1;
+					indices[k + 5] = (i + 1) * n + j + 1;
+
+					k += 6; // next quad
+				}
+			}
+		});
 
-			meshData.LODIndices[0][k + 3] = (i + 1) * n + j;
-			meshData.LODIndices[0][k + 4] = i * n + j + 1;
-			meshData.LODIndices[0][k + 5] = (i + 1) * n + j + 1;
-
-			k += 6; // next quad
-		}
+	for (UINT i = 0; i < meshData.NumLODs; ++i)
+	{
+		BoundingBox::CreateFromPoints(meshData.LODBounds[i], meshData.LODVertices[i].size(), &meshData.LODVertices[i][0].position, sizeof(VertexPositionNormalTangentUV));
 	}
 
 	return meshData;
 }
 
-MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateGeosphere(float radius, UINT numSubdivisions)
+template<typename TIndex>
+MeshData<VertexPositionNormalTangentUV, TIndex> Shapes::CreateGeosphere(float radius, UINT numSubdivisions)
 {
-	MeshData meshData;
+	MeshData<VertexPositionNormalTangentUV, TIndex> meshData;
+
+	numSubdivisions = std::min(numSubdivisions, GetMaxGeosphereSubdivisions<TIndex>());
 
-	numSubdivisions = std::min<UINT>(numSubdivisions, 6u);
-	
 	// Approximate a sphere by tessellating an icosahedron.
 	const float X = 0.525731f;
 	const float Z = 0.850651f;
 
-	XMFLOAT3 pos[12] =
+	const XMFLOAT3 pos[12] =
 	{
 		XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),
 		XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
@@ -265,7 +366,7 @@ MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateGeosphere(float
 		XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
 	};
 
-	UINT k[60] =
+	const uint32_t k[60] =
 	{
 		1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
 		1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
@@ -273,139 +374,173 @@ MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateGeosphere(float
 		10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
 	};
 
-	meshData.LODVertices[0].resize(12);
-	meshData.LODIndices[0].assign(&k[0], &k[60]);
+	// Final sizes are known up front, so subdivision never reallocates.
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> subdividedIndices;
+	positions.reserve((size_t)GetGeosphereVertexCount(numSubdivisions));
+	indices.reserve((size_t)GetGeosphereIndexCount(numSubdivisions));
+	subdividedIndices.reserve((size_t)GetGeosphereIndexCount(numSubdivisions));
 
-	for (UINT i = 0; i < 12; ++i)
-		meshData.LODVertices[0][i].position = pos[i];
+	positions.assign(&pos[0], &pos[12]);
+	indices.assign(&k[0], &k[60]);
 
 	for (UINT i = 0; i < numSubdivisions; ++i)
-		Subdivide(meshData);
+	{
+		Subdivide(positions, indices, subdividedIndices);
+		indices.swap(subdividedIndices);
+	}
+
+	std::vector<VertexPositionNormalTangentUV>& vertices = meshData.LODVertices[0];
+	vertices.resize(positions.size());
+	meshData.LODIndices[0].assign(indices.begin(), indices.end());
+	CheckIndexRange<TIndex>(vertices.size());
 
 	// Project vertices onto sphere and scale.
-	for (UINT i = 0; i < meshData.LODVertices[0].size(); ++i)
-	{
-		// Project onto unit sphere.
-		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.LODVertices[0][i].position));
+	JobSystem::Get().ParallelFor((UINT)vertices.size(), MinVerticesPerJob, [&](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; ++i)
+			{
+				VertexPositionNormalTangentUV& v = vertices[i];
 
-		// Project onto sphere.
-		XMVECTOR p = radius * n;
+				// Project onto unit sphere.
+				XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&positions[i]));
 
-		XMStoreFloat3(&meshData.LODVertices[0][i].position, p);
-		XMStoreFloat3(&meshData.LODVertices[0][i].normal, n);
+				// Project onto sphere.
+				XMVECTOR p = radius * n;
 
-		// Derive texture coordinates from spherical coordinates.
-		float theta = atan2f(meshData.LODVertices[0][i].position.z, meshData.LODVertices[0][i].position.x);
+				XMStoreFloat3(&v.position, p);
+				XMStoreFloat3(&v.normal, n);
 
-		// Put in [0, 2pi].
-		if (theta < 0.0f)
-			theta += XM_2PI;
+				// Derive texture coordinates from spherical coordinates.
+				float theta = atan2f(v.position.z, v.position.x);
 
-		float phi = acosf(meshData.LODVertices[0][i].position.y / radius);
+				// Put in [0, 2pi].
+				if (theta < 0.0f)
+					theta += XM_2PI;
 
-		meshData.LODVertices[0][i].texCoord.x = theta / XM_2PI;
-		meshData.LODVertices[0][i].texCoord.y = phi / XM_PI;
+				float phi = acosf(v.position.y / radius);
 
-		// Partial derivative of P with respect to theta
-		meshData.LODVertices[0][i].tangent.x = -radius * sinf(phi) * sinf(theta);
-		meshData.LODVertices[0][i].tangent.y = 0.0f;
-		meshData.LODVertices[0][i].tangent.z = +radius * sinf(phi) * cosf(theta);
+				v.texCoord.x = theta / XM_2PI;
+				v.texCoord.y = phi / XM_PI;
 
-		XMVECTOR T = XMLoadFloat3(&meshData.LODVertices[0][i].tangent);
-		XMStoreFloat3(&meshData.LODVertices[0][i].tangent, XMVector3Normalize(T));
+				// Partial derivative of P with respect to theta
+				v.tangent.x = -radius * sinf(phi) * sinf(theta);
+				v.tangent.y = 0.0f;
+				v.tangent.z = +radius * sinf(phi) * cosf(theta);
+
+				XMVECTOR T = XMLoadFloat3(&v.tangent);
+				XMStoreFloat3(&v.tangent, XMVector3Normalize(T));
+			}
+		});
+
+	for (UINT i = 0; i < meshData.NumLODs; ++i)
+	{
+		BoundingBox::CreateFromPoints(meshData.LODBounds[i], meshData.LODVertices[i].size(), &meshData.LODVertices[i][0].position, sizeof(VertexPositionNormalTangentUV));
 	}
 
 	return meshData;
 }
 
-void Shapes::Subdivide(MeshData<>& meshData)
+void Shapes::Subdivide(std::vector<XMFLOAT3>& positions, const std::vector<uint32_t>& indices, std::vector<uint32_t>& outIndices)
 {
-	// Save a copy of the input geometry.
-	MeshData<> inputCopy = meshData;
-
-	meshData.LODVertices[0].resize(0);
-	meshData.LODVertices[0].resize(0);
-
-	//       v1
-	//       *
-	//      / \
-	//     /   \
-	//  m0*-----*m1
-	//   / \   / \
-	//  /   \ /   \
-	// *-----*-----*
-	// v0    m2     v2
-
-	UINT numTris = (UINT)inputCopy.LODIndices[0].size() / 3;
+	/*
+	        v1
+	        *
+	       / \
+	      /   \
+	   m0*-----*m1
+	    / \   / \
+	   /   \ /   \
+	  *-----*-----*
+	  v0    m2     v2
+	*/
+
+	const UINT numTris = (UINT)indices.size() / 3;
+	const uint32_t numInputVertices = (uint32_t)positions.size();
+
+	// Closed mesh, every edge is shared by two triangles
+	std::unordered_map<uint64_t, uint32_t> edgeMidpoints;
+	edgeMidpoints.reserve(indices.size() / 2);
+
+	// Numbering midpoints is the only serial part, the rest is written per edge and per face.
+	std::vector<uint32_t> faceMidpoints(indices.size());
+	std::vector<uint32_t> edgeVertices;
+	edgeVertices.reserve(indices.size());
+
 	for (UINT i = 0; i < numTris; ++i)
 	{
-		VertexPositionNormalTangentUV v0 = inputCopy.LODVertices[0][inputCopy.LODIndices[0][i * 3 + 0]];
-		VertexPositionNormalTangentUV v1 = inputCopy.LODVertices[0][inputCopy.LODIndices[0][i * 3 + 1]];
-		VertexPositionNormalTangentUV v2 = inputCopy.LODVertices[0][inputCopy.LODIndices[0][i * 3 + 2]];
-
-		//
-		// Generate the midpoints.
-		//
-
-		VertexPositionNormalTangentUV m0 = MidPoint(v0, v1);
-		VertexPositionNormalTangentUV m1 = MidPoint(v1, v2);
-		VertexPositionNormalTangentUV m2 = MidPoint(v0, v2);
-
-		//
-		// Add new geometry.
-		//
-
-		meshData.LODVertices[0].push_back(v0); // 0
-		meshData.LODVertices[0].push_back(v1); // 1
-		meshData.LODVertices[0].push_back(v2); // 2
-		meshData.LODVertices[0].push_back(m0); // 3
-		meshData.LODVertices[0].push_back(m1); // 4
-		meshData.LODVertices[0].push_back(m2); // 5
-
-		meshData.LODIndices[0].push_back(i * 6 + 0);
-		meshData.LODIndices[0].push_back(i * 6 + 3);
-		meshData.LODIndices[0].push_back(i * 6 + 5);
-
-		meshData.LODIndices[0].push_back(i * 6 + 3);
-		meshData.LODIndices[0].push_back(i * 6 + 4);
-		meshData.LODIndices[0].push_back(i * 6 + 5);
-
-		meshData.LODIndices[0].push_back(i * 6 + 5);
-		meshData.LODIndices[0].push_back(i * 6 + 4);
-		meshData.LODIndices[0].push_back(i * 6 + 2);
-
-		meshData.LODIndices[0].push_back(i * 6 + 3);
-		meshData.LODIndices[0].push_back(i * 6 + 1);
-		meshData.LODIndices[0].push_back(i * 6 + 4);
+		for (UINT e = 0; e < 3; ++e)
+		{
+			// Edge e goes from corner e to the next one: m0 = (v0, v1), m1 = (v1, v2), m2 = (v2, v0)
+			const uint32_t v0 = indices[i * 3 + e];
+			const uint32_t v1 = indices[i * 3 + (e + 1) % 3];
+
+			auto [it, bInserted] = edgeMidpoints.try_emplace(EdgeKey(v0, v1), numInputVertices + (uint32_t)edgeMidpoints.size());
+			if (bInserted)
+			{
+				edgeVertices.push_back(v0);
+				edgeVertices.push_back(v1);
+			}
+			faceMidpoints[i * 3 + e] = it->second;
+		}
 	}
-}
 
-VertexPositionNormalTangentUV Shapes::MidPoint(const VertexPositionNormalTangentUV& v0, const VertexPositionNormalTangentUV& v1)
-{
-	XMVECTOR p0 = XMLoadFloat3(&v0.position);
-	XMVECTOR p1 = XMLoadFloat3(&v1.position);
-
-	XMVECTOR n0 = XMLoadFloat3(&v0.normal);
-	XMVECTOR n1 = XMLoadFloat3(&v1.normal);
-
-	XMVECTOR tan0 = XMLoadFloat3(&v0.tangent);
-	XMVECTOR tan1 = XMLoadFloat3(&v1.tangent);
-
-	XMVECTOR tex0 = XMLoadFloat2(&v0.texCoord);
-	XMVECTOR tex1 = XMLoadFloat2(&v1.texCoord);
+	const UINT numEdges = (UINT)edgeMidpoints.size();
+	positions.resize(numInputVertices + numEdges);
 
-	// Compute the midpoints of all the attributes.  Vectors need to be normalized
-	// since linear interpolating can make them not unit length.  
-	XMVECTOR pos = 0.5f * (p0 + p1);
-	XMVECTOR normal = XMVector3Normalize(0.5f * (n0 + n1));
-	XMVECTOR tangent = XMVector3Normalize(0.5f * (tan0 + tan1));
-	XMVECTOR tex = 0.5f * (tex0 + tex1);
-
-	VertexPositionNormalTangentUV v;
-	XMStoreFloat3(&v.position, pos);
-	XMStoreFloat3(&v.normal, normal);
-	XMStoreFloat3(&v.tangent, tangent);
-	XMStoreFloat2(&v.texCoord, tex);
+	JobSystem::Get().ParallelFor(numEdges, MinFacesPerJob, [&](UINT begin, UINT end)
+		{
+			for (UINT edge = begin; edge < end; ++edge)
+			{
+				const XMVECTOR p0 = XMLoadFloat3(&positions[edgeVertices[edge * 2 + 0]]);
+				const XMVECTOR p1 = XMLoadFloat3(&positions[edgeVertices[edge * 2 + 1]]);
+				XMStoreFloat3(&positions[numInputVertices + edge], 0.5f * (p0 + p1));
+			}
+		});
+
+	outIndices.resize(indices.size() * 4);
+	JobSystem::Get().ParallelFor(numTris, MinFacesPerJob, [&](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; ++i)
+			{
+				const uint32_t v0 = indices[i * 3 + 0];
+				const uint32_t v1 = indices[i * 3 + 1];
+				const uint32_t v2 = indices[i * 3 + 2];
+				const uint32_t m0 = faceMidpoints[i * 3 + 0];
+				const uint32_t m1 = faceMidpoints[i * 3 + 1];
+				const uint32_t m2 = faceMidpoints[i * 3 + 2];
+
+				uint32_t* pOut = &outIndices[i * 12];
+
+				pOut[0] = v0;
+				pOut[1] = m0;
+				pOut[2] = m2;
+
+				pOut[3] = m0;
+				pOut[4] = m1;
+				pOut[5] = m2;
+
+				pOut[6] = m2;
+				pOut[7] = m1;
+				pOut[8] = v2;
+
+				pOut[9] = m0;
+				pOut[10] = v1;
+				pOut[11] = m1;
+			}
+		});
+}
 
-	return v;
-}
\ No newline at end of file
+#pragma region Instantiations
+template MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateBox<uint16_t>(float, float, float);
+template MeshData<VertexPositionNormalTangentUV, uint32_t> Shapes::CreateBox<uint32_t>(float, float, float);
+template MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateSphere<uint16_t>(float, UINT, UINT);
+template MeshData<VertexPositionNormalTangentUV, uint32_t> Shapes::CreateSphere<uint32_t>(float, UINT, UINT);
+template MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateCone<uint16_t>(float, float, UINT);
+template MeshData<VertexPositionNormalTangentUV, uint32_t> Shapes::CreateCone<uint32_t>(float, float, UINT);
+template MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateGrid<uint16_t>(float, float, UINT, UINT);
+template MeshData<VertexPositionNormalTangentUV, uint32_t> Shapes::CreateGrid<uint32_t>(float, float, UINT, UINT);
+template MeshData<VertexPositionNormalTangentUV, uint16_t> Shapes::CreateGeosphere<uint16_t>(float, UINT);
+template MeshData<VertexPositionNormalTangentUV, uint32_t> Shapes::CreateGeosphere<uint32_t>(float, UINT);
+#pragma endregion Instantiations
@@ -1,24 +1,62 @@
 #pragma once
 
-#include "Common/ScaldCoreTypes.h"
-#include "Common/DXHelper.h"
+#include "Common/MeshData.h"
 
+#include <limits>
+
+// Generators are instantiated for uint16_t and uint32_t indices, the vertex count must fit the index type.
 class Shapes
 {
 public:
-	static MeshData<VertexPositionNormalTangentUV, uint16_t> CreateBox(float width, float height, float depth);
+	template<typename TIndex = uint16_t>
+	static MeshData<VertexPositionNormalTangentUV, TIndex> CreateBox(float width, float height, float depth);
+
+	template<typename TIndex = uint16_t>
+	static MeshData<VertexPositionNormalTangentUV, TIndex> CreateSphere(float radius, UINT sliceCount, UINT stackCount);
 
-	static MeshData<VertexPositionNormalTangentUV, uint16_t> CreateSphere(float radius, UINT sliceCount, UINT stackCount);
+	// Apex at the origin, opening along +z to a base of the given radius at z = height, which is capped.
+	// Base vertices lie on the circle, so the mesh is inside of the round cone.
+	template<typename TIndex = uint16_t>
+	static MeshData<VertexPositionNormalTangentUV, TIndex> CreateCone(float radius, float height, UINT sliceCount);
 
 	///<summary>
 	/// Creates an mxn grid in the xz-plane with m rows and n columns, centered
 	/// at the origin with the specified width and depth.
 	///</summary>
-	static MeshData<VertexPositionNormalTangentUV, uint16_t> CreateGrid(float width, float depth, UINT m, UINT n);
+	template<typename TIndex = uint16_t>
+	static MeshData<VertexPositionNormalTangentUV, TIndex> CreateGrid(float width, float depth, UINT m, UINT n);
+
+	// numSubdivisions is clamped to GetMaxGeosphereSubdivisions<TIndex>()
+	template<typename TIndex = uint16_t>
+	static MeshData<VertexPositionNormalTangentUV, TIndex> CreateGeosphere(float radius, UINT numSubdivisions);
 
-	static MeshData<VertexPositionNormalTangentUV, uint16_t> CreateGeosphere(float radius, UINT numSubdivisions);
+	// Highest subdivision level whose vertices can still be addressed with TIndex
+	template<typename TIndex>
+	static constexpr UINT GetMaxGeosphereSubdivisions()
+	{
+		UINT numSubdivisions = 0u;
+		while (numSubdivisions < MaxGeosphereSubdivisions && GetGeosphereVertexCount(numSubdivisions + 1u) - 1u <= std::numeric_limits<TIndex>::max())
+		{
+			++numSubdivisions;
+		}
+		return numSubdivisions;
+	}
 
 private:
-	static void Subdivide(MeshData<>& meshData);
-	static VertexPositionNormalTangentUV MidPoint(const VertexPositionNormalTangentUV& v0, const VertexPositionNormalTangentUV& v1);
-};
\ No newline at end of file
+	// 10.5M vertices, more than that is a memory problem rather than an index one
+	static constexpr UINT MaxGeosphereSubdivisions = 10u;
+
+	// Every subdivision quadruples faces, an icosahedron starts with 20 faces, 30 edges and 12 vertices.
+	static constexpr uint64_t GetGeosphereVertexCount(UINT numSubdivisions) { return 10ull * (1ull << (2u * numSubdivisions)) + 2ull; }
+	static constexpr uint64_t GetGeosphereIndexCount(UINT numSubdivisions) { return 60ull * (1ull << (2u * numSubdivisions)); }
+
+	template<typename TIndex>
+	static void CheckIndexRange(size_t vertexCount)
+	{
+		assert(vertexCount == 0u || vertexCount - 1u <= std::numeric_limits<TIndex>::max());
+	}
+
+	// Splits every triangle into 4. Midpoint of an edge is shared by both of its triangles.
+	// Only positions are subdivided, the rest of the attributes are derived after projection onto the sphere.
+	static void Subdivide(std::vector<XMFLOAT3>& positions, const std::vector<uint32_t>& indices, std::vector<uint32_t>& outIndices);
+};
@@ -0,0 +1,201 @@
+#include "SpotLightCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	// Right and up axes around the cone's direction, in the proxy mesh's x and y order.
+	void ComputeConeBasis(FXMVECTOR direction, XMVECTOR& outRight, XMVECTOR& outUp)
+	{
+		const XMVECTOR worldUp = fabsf(XMVectorGetY(direction)) < 0.99f ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+		outRight = XMVector3Normalize(XMVector3Cross(worldUp, direction));
+		outUp = XMVector3Cross(direction, outRight);
+	}
+
+	// Radius of a polygon with flat sides touching a circle of the given radius.
+	FORCEINLINE float GetCircumscribedRadius(float radius, UINT sliceCount)
+	{
+		return radius / cosf(XM_PI / sliceCount);
+	}
+
+	constexpr UINT NumProxyPoints = SpotLightCuller::ProxySliceCount + 1u;
+
+	// Apex and the proxy's base polygon, the proxy is their convex hull.
+	void ComputeProxyPoints(const SpotLightCone& cone, XMFLOAT3 (&outPoints)[NumProxyPoints])
+	{
+		outPoints[0] = cone.Apex;
+
+		const XMVECTOR direction = XMLoadFloat3(&cone.Direction);
+		XMVECTOR coneRight, coneUp;
+		ComputeConeBasis(direction, coneRight, coneUp);
+
+		const XMVECTOR baseCenter = XMVectorMultiplyAdd(direction, XMVectorReplicate(cone.Range), XMLoadFloat3(&cone.Apex));
+		const float proxyRadius = GetCircumscribedRadius(cone.BaseRadius, SpotLightCuller::ProxySliceCount);
+		for (UINT j = 0; j < SpotLightCuller::ProxySliceCount; ++j)
+		{
+			const float theta = j * XM_2PI / SpotLightCuller::ProxySliceCount;
+			const XMVECTOR offset = XMVectorAdd(XMVectorScale(coneRight, proxyRadius * cosf(theta)), XMVectorScale(coneUp, proxyRadius * sinf(theta)));
+			XMStoreFloat3(&outPoints[1u + j], XMVectorAdd(baseCenter, offset));
+		}
+	}
+}
+
+float SpotLightCuller::GetHalfAngle(float spotPower)
+{
+	if (spotPower <= 0.0f)
+	{
+		return MaxHalfAngle;
+	}
+
+	// pow(cos(angle), spotPower) = MinSpotFactor
+	return std::min(acosf(powf(MinSpotFactor, 1.0f / spotPower)), MaxHalfAngle);
+}
+
+SpotLightCone SpotLightCuller::ComputeCone(const LightData& light)
+{
+	assert(XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&light.Direction))) > 0.0f);
+
+	SpotLightCone cone;
+	cone.Apex = light.Position;
+	XMStoreFloat3(&cone.Direction, XMVector3Normalize(XMLoadFloat3(&light.Direction)));
+	cone.Range = light.FallOfEnd;
+	cone.BaseRadius = light.FallOfEnd * tanf(GetHalfAngle(light.SpotPower));
+	return cone;
+}
+
+SpotLightCone SpotLightCuller::TransformCone(const SpotLightCone& cone, const XMMATRIX& m)
+{
+	SpotLightCone transformed = cone;
+	XMStoreFloat3(&transformed.Apex, XMVector3TransformCoord(XMLoadFloat3(&cone.Apex), m));
+	XMStoreFloat3(&transformed.Direction, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&cone.Direction), m)));
+	return transformed;
+}
+
+XMMATRIX SpotLightCuller::ComputeProxyWorld(const SpotLightCone& cone)
+{
+	const XMVECTOR direction = XMLoadFloat3(&cone.Direction);
+	XMVECTOR right, up;
+	ComputeConeBasis(direction, right, up);
+
+	const float proxyRadius = GetCircumscribedRadius(cone.BaseRadius, ProxySliceCount);
+	return XMMATRIX(
+		XMVectorScale(right, proxyRadius),
+		XMVectorScale(up, proxyRadius),
+		XMVectorScale(direction, cone.Range),
+		XMVectorSetW(XMLoadFloat3(&cone.Apex), 1.0f));
+}
+
+bool SpotLightCuller::IsOutside(const SpotLightCone& cone, const CullingVolume& volume)
+{
+	const XMVECTOR apex = XMLoadFloat3(&cone.Apex);
+	const XMVECTOR direction = XMLoadFloat3(&cone.Direction);
+	const XMVECTOR baseCenter = XMVectorMultiplyAdd(direction, XMVectorReplicate(cone.Range), apex);
+
+	for (UINT i = 0; i < volume.NumPlanes; ++i)
+	{
+		const XMVECTOR plane = XMLoadFloat4(&volume.Planes[i]);
+		if (XMVectorGetX(XMPlaneDotCoord(plane, apex)) <= 0.0f)
+		{
+			continue;
+		}
+
+		// The cone is the hull of its apex and base disk, the disk's point deepest behind the plane is
+		// off its center against the plane normal projected onto the disk.
+		const XMVECTOR normal = XMVectorSetW(plane, 0.0f);
+		const XMVECTOR inDiskNormal = XMVectorSubtract(normal, XMVectorMultiply(direction, XMVector3Dot(normal, direction)));
+		const float inDiskLength = XMVectorGetX(XMVector3Length(inDiskNormal));
+
+		XMVECTOR deepestPoint = baseCenter;
+		if (inDiskLength > 1e-6f)
+		{
+			deepestPoint = XMVectorSubtract(baseCenter, XMVectorScale(inDiskNormal, cone.BaseRadius / inDiskLength));
+		}
+
+		if (XMVectorGetX(XMPlaneDotCoord(plane, deepestPoint)) > 0.0f)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SpotLightCuller::CrossesNearPlane(const SpotLightCone& viewCone, float nearZ)
+{
+	// The rasterized proxy, its base corners reach past the round cone's base disk.
+	XMFLOAT3 points[NumProxyPoints];
+	ComputeProxyPoints(viewCone, points);
+	return std::any_of(std::begin(points), std::end(points), [nearZ](const XMFLOAT3& p) { return p.z < nearZ; });
+}
+
+LightScissorRect SpotLightCuller::ComputeScissorRect(const SpotLightCone& viewCone, float projScaleX, float projScaleY, float nearZ, UINT width, UINT height)
+{
+	XMFLOAT3 points[NumProxyPoints];
+	ComputeProxyPoints(viewCone, points);
+
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+	auto AddPoint = [&](float x, float y, float z)
+		{
+			const float ndcX = x * projScaleX / z;
+			const float ndcY = y * projScaleY / z;
+			minX = std::min(minX, ndcX);
+			maxX = std::max(maxX, ndcX);
+			minY = std::min(minY, ndcY);
+			maxY = std::max(maxY, ndcY);
+		};
+
+	bool bIsAnyBehind = false;
+	for (const XMFLOAT3& p : points)
+	{
+		if (p.z >= nearZ)
+		{
+			AddPoint(p.x, p.y, p.z);
+		}
+		else
+		{
+			bIsAnyBehind = true;
+		}
+	}
+
+	// The hull's cut by the near plane is the hull of where the segments between its points cross the plane.
+	if (bIsAnyBehind)
+	{
+		for (UINT i = 0; i < NumProxyPoints; ++i)
+		{
+			for (UINT j = i + 1u; j < NumProxyPoints; ++j)
+			{
+				const XMFLOAT3& a = points[i];
+				const XMFLOAT3& b = points[j];
+				if ((a.z < nearZ) == (b.z < nearZ))
+				{
+					continue;
+				}
+
+				const float t = (nearZ - a.z) / (b.z - a.z);
+				AddPoint(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y), nearZ);
+			}
+		}
+	}
+
+	LightScissorRect rect;
+	if (minX > maxX)
+	{
+		return rect;
+	}
+
+	// Screen y goes down
+	const float left = floorf((0.5f + 0.5f * minX) * width);
+	const float right = ceilf((0.5f + 0.5f * maxX) * width);
+	const float top = floorf((0.5f - 0.5f * maxY) * height);
+	const float bottom = ceilf((0.5f - 0.5f * minY) * height);
+
+	rect.Left = (UINT)std::clamp(left, 0.0f, (float)width);
+	rect.Right = (UINT)std::clamp(right, 0.0f, (float)width);
+	rect.Top = (UINT)std::clamp(top, 0.0f, (float)height);
+	rect.Bottom = (UINT)std::clamp(bottom, 0.0f, (float)height);
+	return rect;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Common/ObjectConstants.h"
+#include "FrustumCuller.h"
+#include "LightVolumeClassifier.h"
+
+// Bounds the lit part of a spot light: the round cone with the apex at the light, Range along Direction
+// and a base disk of BaseRadius. Points the light reaches (within range and the cone's half angle) are inside of it.
+struct SpotLightCone
+{
+	XMFLOAT3 Apex = { 0.0f, 0.0f, 0.0f };
+	float Range = 0.0f;
+	// Unit length
+	XMFLOAT3 Direction = { 0.0f, 0.0f, 1.0f };
+	float BaseRadius = 0.0f;
+};
+
+// Culling and screen bounds of spot light cones. Spot lights are drawn as instanced low-poly cones
+// (Shapes::CreateCone with ProxySliceCount slices), the proxy circumscribes the round cone.
+class SpotLightCuller
+{
+public:
+	// Spot factor pow(cos(angle), SpotPower) below which a pixel is left unlit, it bounds the cone's angle.
+	static constexpr float MinSpotFactor = 1.0f / 256.0f;
+	// Wider cones (SpotPower below ~3) are clipped, past 90 degrees a cone no longer bounds anything.
+	static constexpr float MaxHalfAngle = 1.3962634f; // 80 degrees
+	static constexpr UINT ProxySliceCount = 12u;
+
+	// Half angle at which the spot factor falls to MinSpotFactor.
+	static float GetHalfAngle(float spotPower);
+	static SpotLightCone ComputeCone(const LightData& light);
+	// m has to be rigid (rotation and translation), e.g. a view matrix.
+	static SpotLightCone TransformCone(const SpotLightCone& cone, const XMMATRIX& m);
+
+	// World transform of the unit proxy cone (radius 1, height 1), scaled out so its flat sides touch the round cone.
+	static XMMATRIX ComputeProxyWorld(const SpotLightCone& cone);
+
+	// True if the cone is completely behind one of the volume's planes. The test is exact for a single plane.
+	static bool IsOutside(const SpotLightCone& cone, const CullingVolume& volume);
+
+	// View space proxy reaching in front of the near plane, the camera may be inside of it.
+	static bool CrossesNearPlane(const SpotLightCone& viewCone, float nearZ);
+
+	// Pixel bounds of the proxy in view space of a symmetric left handed perspective projection,
+	// clipped by the near plane. projScaleX/Y are the projection's [0][0] and [1][1]. Empty if nothing is in front of the near plane.
+	static LightScissorRect ComputeScissorRect(const SpotLightCone& viewCone, float projScaleX, float projScaleY, float nearZ, UINT width, UINT height);
+};
@@ -0,0 +1,158 @@
+#include "stdafx.h"
+#include "TextureLoader.h"
+#include "CommandQueue.h"
+#include "TextureStreamer.h"
+#include "Common/ScaldUtil.h"
+
+TextureLoader::TextureLoader(const ComPtr<ID3D12Device2>& device, const AssetArchive* pArchive)
+	: m_device(device)
+	, m_parser([pArchive](const std::wstring& fileName, DirectX::DDSTextureData& outData) { return TextureParser::ReadTextureData(pArchive, fileName, outData); })
+{
+	m_copyQueue = std::make_unique<CommandQueue>(m_device, D3D12_COMMAND_LIST_TYPE_COPY);
+}
+
+TextureLoader::~TextureLoader()
+{
+	// Workers write into requests owned by us, and the GPU still reads upload heaps of the in-flight batches.
+	m_parser.Wait();
+	m_copyQueue->Flush();
+}
+
+void TextureLoader::Request(Texture* pTexture, OnLoadedCallback onLoaded, bool bIsStreamed)
+{
+	assert(pTexture && !pTexture->Filename.empty());
+
+	++m_numPending;
+
+	auto request = std::make_unique<LoadRequest>();
+	request->FileName = pTexture->Filename;
+	request->pTexture = pTexture;
+	request->OnLoaded = std::move(onLoaded);
+	request->bIsStreamed = bIsStreamed;
+
+	m_parser.Parse(std::move(request));
+}
+
+void TextureLoader::RequestMips(Texture* pTexture, UINT firstMip, OnLoadedCallback onLoaded)
+{
+	assert(pTexture && pTexture->SourceData && pTexture->bIsResident);
+
+	++m_numPending;
+
+	// Already parsed, goes straight to the upload.
+	auto request = std::make_unique<LoadRequest>();
+	request->pTexture = pTexture;
+	request->OnLoaded = std::move(onLoaded);
+	request->bIsStreamed = true;
+	request->FirstMip = firstMip;
+
+	m_parser.Push(std::move(request));
+}
+
+void TextureLoader::Update(CommandQueue& graphicsQueue)
+{
+	if (m_numPending == 0u)
+	{
+		return;
+	}
+
+	RetireCompletedBatches();
+	SubmitParsed(graphicsQueue);
+}
+
+void TextureLoader::Flush(CommandQueue& graphicsQueue)
+{
+	m_parser.Wait();
+	SubmitParsed(graphicsQueue);
+
+	m_copyQueue->Flush();
+	RetireCompletedBatches();
+
+	assert(m_numPending == 0u);
+}
+
+void TextureLoader::SubmitParsed(CommandQueue& graphicsQueue)
+{
+	std::vector<std::unique_ptr<TextureParser::Request>> parsed = m_parser.TakeParsed();
+	if (parsed.empty())
+	{
+		return;
+	}
+
+	UploadBatch batch;
+	batch.CommandAllocator = AcquireCommandAllocator();
+
+	auto commandList = m_copyQueue->GetCommandList(batch.CommandAllocator.Get());
+	for (auto& parsedRequest : parsed)
+	{
+		LoadRequest* request = static_cast<LoadRequest*>(parsedRequest.get());
+		ThrowIfFailed(request->Result);
+
+		Texture* pTexture = request->pTexture;
+		if (request->bIsStreamed && !pTexture->SourceData)
+		{
+			const auto& data = request->Data;
+			request->FirstMip = TextureStreamer::ComputeTailMip((UINT)data.Width, (UINT)data.Height, (UINT)data.MipCount);
+			pTexture->SourceData = std::make_unique<DirectX::DDSTextureData>(std::move(request->Data));
+		}
+
+		const DirectX::DDSTextureData& data = pTexture->SourceData ? *pTexture->SourceData : request->Data;
+		ThrowIfFailed(DirectX::CreateDDSTextureFromData12(m_device.Get(), commandList.Get(), data, request->Resource, request->UploadHeap, request->FirstMip));
+		SCALD_NAME_D3D12_OBJECT(request->Resource, pTexture->Filename.c_str());
+	}
+	m_copyQueue->ExecuteCommandList(commandList);
+
+	batch.FenceValue = m_copyQueue->Signal();
+	graphicsQueue.Wait(*m_copyQueue, batch.FenceValue);
+
+	batch.Requests = std::move(parsed);
+	m_inFlight.push_back(std::move(batch));
+}
+
+void TextureLoader::RetireCompletedBatches()
+{
+	while (!m_inFlight.empty() && m_copyQueue->IsFenceComplete(m_inFlight.front().FenceValue))
+	{
+		UploadBatch batch = std::move(m_inFlight.front());
+		m_inFlight.pop_front();
+
+		m_freeCommandAllocators.push_back(std::move(batch.CommandAllocator));
+
+		for (auto& parsedRequest : batch.Requests)
+		{
+			LoadRequest* request = static_cast<LoadRequest*>(parsedRequest.get());
+			// The copy is done, the staging memory goes away with the request.
+			Texture* pTexture = request->pTexture;
+			pTexture->PreviousResource = std::move(pTexture->Resource);
+			pTexture->Resource = std::move(request->Resource);
+			pTexture->FirstResidentMip = request->FirstMip;
+			pTexture->bIsResident = true;
+
+			--m_numPending;
+
+			if (request->OnLoaded)
+			{
+				request->OnLoaded(*pTexture);
+			}
+		}
+	}
+}
+
+ComPtr<ID3D12CommandAllocator> TextureLoader::AcquireCommandAllocator()
+{
+	ComPtr<ID3D12CommandAllocator> commandAllocator;
+	if (!m_freeCommandAllocators.empty())
+	{
+		commandAllocator = std::move(m_freeCommandAllocators.back());
+		m_freeCommandAllocators.pop_back();
+
+		ThrowIfFailed(commandAllocator->Reset());
+	}
+	else
+	{
+		ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&commandAllocator)));
+		SCALD_NAME_D3D12_OBJECT(commandAllocator, L"Texture Upload Allocator");
+	}
+
+	return commandAllocator;
+}
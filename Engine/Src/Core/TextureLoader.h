@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Common/DXHelper.h"
+#include "Common/DDSTextureLoader.h"
+#include "TextureParser.h"
+#include "AssetArchive.h"
+
+#include <deque>
+#include <functional>
+
+class CommandQueue;
+struct Texture;
+
+// Loads DDS textures in the background. Reading and parsing the files runs on the job system workers (see TextureParser),
+// the main thread only creates the resources and records the uploads on a dedicated copy queue.
+class TextureLoader
+{
+public:
+	// Called on the main thread once the texture is resident.
+	using OnLoadedCallback = std::function<void(Texture&)>;
+
+	// Textures found in pArchive are read from it instead of the loose files. The archive has to outlive the textures,
+	// as stored entries are referenced in place.
+	TextureLoader(const ComPtr<ID3D12Device2>& device, const AssetArchive* pArchive = nullptr);
+	TextureLoader(const TextureLoader& lhs) = delete;
+	TextureLoader& operator=(const TextureLoader& lhs) = delete;
+	~TextureLoader();
+
+	// The texture must outlive the request.
+	// Streamed textures keep their parsed file and start with only the mip tail resident, see TextureStreamer.
+	void Request(Texture* pTexture, OnLoadedCallback onLoaded = nullptr, bool bIsStreamed = false);
+	// Re-creates a streamed texture with mips [firstMip, MipCount). The old resource is moved to PreviousResource
+	// right before onLoaded is called, it is up to the caller to keep it alive while the GPU uses it.
+	void RequestMips(Texture* pTexture, UINT firstMip, OnLoadedCallback onLoaded);
+
+	// Uploads textures parsed since the last call and reports the ones whose upload has finished.
+	// graphicsQueue is made to wait for the copies on the GPU, so anything submitted to it afterwards may sample them.
+	void Update(CommandQueue& graphicsQueue);
+
+	// Blocks until every requested texture is resident.
+	void Flush(CommandQueue& graphicsQueue);
+
+	FORCEINLINE bool IsIdle() const { return m_numPending == 0u; }
+	FORCEINLINE UINT GetNumPending() const { return m_numPending; }
+
+private:
+	struct LoadRequest : TextureParser::Request
+	{
+		Texture* pTexture = nullptr;
+		OnLoadedCallback OnLoaded;
+
+		bool bIsStreamed = false;
+		UINT FirstMip = 0u;
+		ComPtr<ID3D12Resource> Resource;
+		ComPtr<ID3D12Resource> UploadHeap;
+	};
+
+	struct UploadBatch
+	{
+		UINT64 FenceValue = 0u;
+		ComPtr<ID3D12CommandAllocator> CommandAllocator;
+		std::vector<std::unique_ptr<TextureParser::Request>> Requests;
+	};
+
+	void SubmitParsed(CommandQueue& graphicsQueue);
+	void RetireCompletedBatches();
+	ComPtr<ID3D12CommandAllocator> AcquireCommandAllocator();
+
+private:
+	ComPtr<ID3D12Device2> m_device;
+	std::unique_ptr<CommandQueue> m_copyQueue;
+
+	TextureParser m_parser;
+
+	// Submitted uploads, in fence order.
+	std::deque<UploadBatch> m_inFlight;
+	std::vector<ComPtr<ID3D12CommandAllocator>> m_freeCommandAllocators;
+
+	// Requested, but not resident yet. Main thread only.
+	UINT m_numPending = 0u;
+};
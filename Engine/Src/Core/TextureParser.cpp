@@ -0,0 +1,75 @@
+#include "TextureParser.h"
+#include "AssetArchive.h"
+
+TextureParser::TextureParser(ReadFunc read)
+	: m_read(std::move(read))
+{
+	if (!m_read)
+	{
+		m_read = [](const std::wstring& fileName, DirectX::DDSTextureData& outData)
+			{
+				return DirectX::LoadDDSTextureDataFromFile(fileName.c_str(), outData);
+			};
+	}
+}
+
+TextureParser::~TextureParser()
+{
+	Wait();
+}
+
+void TextureParser::Parse(std::unique_ptr<Request> request)
+{
+	// std::function needs a copyable callable, ownership passes to m_parsed once parsing is done.
+	Request* pRequest = request.release();
+
+	JobSystem::Get().Run([this, pRequest]()
+		{
+			pRequest->Result = m_read(pRequest->FileName, pRequest->Data);
+
+			std::lock_guard<std::mutex> lock(m_parsedMutex);
+			m_parsed.emplace_back(pRequest);
+		}, &m_parseJobs);
+}
+
+void TextureParser::Push(std::unique_ptr<Request> request)
+{
+	std::lock_guard<std::mutex> lock(m_parsedMutex);
+	m_parsed.push_back(std::move(request));
+}
+
+std::vector<std::unique_ptr<TextureParser::Request>> TextureParser::TakeParsed()
+{
+	std::vector<std::unique_ptr<Request>> parsed;
+	{
+		std::lock_guard<std::mutex> lock(m_parsedMutex);
+		parsed.swap(m_parsed);
+	}
+	return parsed;
+}
+
+void TextureParser::Wait()
+{
+	JobSystem::Get().Wait(m_parseJobs);
+}
+
+HRESULT TextureParser::ReadTextureData(const AssetArchive* pArchive, const std::wstring& fileName, DirectX::DDSTextureData& outData)
+{
+	const AssetArchiveEntry* pEntry = pArchive ? pArchive->Find(fileName) : nullptr;
+	if (!pEntry)
+	{
+		return DirectX::LoadDDSTextureDataFromFile(fileName.c_str(), outData);
+	}
+
+	std::unique_ptr<uint8_t[]> decompressed;
+	const uint8_t* pData = pArchive->Load(*pEntry, decompressed);
+	if (!pData)
+	{
+		return E_FAIL;
+	}
+
+	const HRESULT hr = DirectX::LoadDDSTextureDataFromMemory(pData, (size_t)pEntry->Size, outData);
+	// Subresources point into pData, compressed entries are kept alive by the texture data, stored ones by the mapping.
+	outData.FileData = std::move(decompressed);
+	return hr;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+#include "Common/DDSTextureData.h"
+#include "JobSystem.h"
+
+#include <functional>
+
+class AssetArchive;
+
+// Worker side of the TextureLoader: reads and parses DDS files on the job system and hands the results back
+// to the owning thread. Knows nothing about the device, see TextureLoader for the uploads.
+class TextureParser
+{
+public:
+	// Derived by the owner to carry its own state along, it gets the same object back from TakeParsed.
+	struct Request
+	{
+		virtual ~Request() noexcept = default;
+
+		std::wstring FileName;
+		DirectX::DDSTextureData Data;
+		// Jobs must not throw, failures are reported to the owner.
+		HRESULT Result = S_OK;
+	};
+
+	// Called on the workers, so it has to be thread safe.
+	using ReadFunc = std::function<HRESULT(const std::wstring& fileName, DirectX::DDSTextureData& outData)>;
+
+public:
+	// Without a read function the files are read from disk.
+	explicit TextureParser(ReadFunc read = nullptr);
+	TextureParser(const TextureParser& lhs) = delete;
+	TextureParser& operator=(const TextureParser& lhs) = delete;
+	// Waits for the jobs still writing into requests.
+	~TextureParser();
+
+	void Parse(std::unique_ptr<Request> request);
+	// Queues a request that needs no parsing, it is returned by the next TakeParsed in order with the parsed ones.
+	void Push(std::unique_ptr<Request> request);
+
+	// Requests finished since the last call, in completion order.
+	std::vector<std::unique_ptr<Request>> TakeParsed();
+
+	// Blocks until every request passed to Parse is finished.
+	void Wait();
+
+public:
+	// Reads the file out of the archive if it packs it, otherwise from disk. pArchive may be null.
+	// Thread safe, it is the read function of the TextureLoader.
+	static HRESULT ReadTextureData(const AssetArchive* pArchive, const std::wstring& fileName, DirectX::DDSTextureData& outData);
+
+private:
+	ReadFunc m_read;
+
+	// Filled by the workers, drained by the owner.
+	std::mutex m_parsedMutex;
+	std::vector<std::unique_ptr<Request>> m_parsed;
+
+	JobCounter m_parseJobs;
+};
@@ -0,0 +1,216 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+TextureStreamer::TextureStreamer(UINT64 budgetBytes)
+	: m_budgetBytes(budgetBytes)
+{
+}
+
+UINT TextureStreamer::ComputeTailMip(UINT width, UINT height, UINT mipCount, UINT minResidentSize)
+{
+	assert(mipCount > 0u);
+
+	UINT mip = 0u;
+	while (mip + 1u < mipCount && std::max(width >> mip, height >> mip) > minResidentSize)
+	{
+		++mip;
+	}
+	return mip;
+}
+
+float TextureStreamer::ComputeRequiredMip(UINT width, UINT height, float uvScale, float projectedSize)
+{
+	const float texels = (float)std::max(width, height) * uvScale;
+	const float texelsPerPixel = texels / std::max(projectedSize, 1.0f);
+
+	return texelsPerPixel > 1.0f ? log2f(texelsPerPixel) : 0.0f;
+}
+
+UINT TextureStreamer::Register(UINT width, UINT height, UINT mipCount, const UINT64* pMipByteSizes, UINT minResidentSize)
+{
+	const UINT handle = (UINT)m_textures.size();
+	StreamedTexture& texture = m_textures.emplace_back();
+
+	texture.ResidentBytes.resize(mipCount + 1u, 0u);
+	for (UINT mip = mipCount; mip-- > 0u;)
+	{
+		texture.ResidentBytes[mip] = texture.ResidentBytes[mip + 1u] + pMipByteSizes[mip];
+	}
+
+	texture.TailMip = ComputeTailMip(width, height, mipCount, minResidentSize);
+	texture.FirstResidentMip = texture.TailMip;
+	texture.WantedMip = texture.TailMip;
+	texture.LastUsedFrame = m_frame;
+
+	m_residentBytes += texture.ResidentBytes[texture.TailMip];
+	m_stats.ResidentBytes = m_residentBytes;
+
+	return handle;
+}
+
+void TextureStreamer::SetBudget(UINT64 budgetBytes)
+{
+	m_budgetBytes = budgetBytes;
+}
+
+void TextureStreamer::BeginFrame()
+{
+	++m_frame;
+
+	for (StreamedTexture& texture : m_textures)
+	{
+		texture.WantedMip = texture.TailMip;
+	}
+}
+
+void TextureStreamer::RequestMip(UINT handle, float mip)
+{
+	assert(handle < m_textures.size());
+	StreamedTexture& texture = m_textures[handle];
+
+	// Rounded down, so the texture is never blurrier than it should be.
+	const UINT wantedMip = (UINT)std::min(floorf(std::max(mip, 0.0f)), (float)texture.TailMip);
+	texture.WantedMip = std::min(texture.WantedMip, wantedMip);
+	texture.LastUsedFrame = m_frame;
+}
+
+void TextureStreamer::Update(std::vector<TextureStreamingRequest>& outRequests, UINT maxRequests)
+{
+	outRequests.clear();
+
+	// Budget could have been lowered.
+	if (m_residentBytes > m_budgetBytes)
+	{
+		MakeRoom(0u, UINT_MAX, outRequests, maxRequests);
+	}
+
+	m_upgrades.clear();
+	m_stats.WantedBytes = 0u;
+	for (UINT i = 0; i < (UINT)m_textures.size(); ++i)
+	{
+		const StreamedTexture& texture = m_textures[i];
+		m_stats.WantedBytes += texture.ResidentBytes[texture.WantedMip];
+
+		if (!texture.bIsStreaming && texture.WantedMip < texture.FirstResidentMip)
+		{
+			m_upgrades.push_back(i);
+		}
+	}
+
+	// Biggest shortfall first, handle breaks ties so the order is deterministic.
+	std::sort(m_upgrades.begin(), m_upgrades.end(), [this](UINT a, UINT b)
+		{
+			const UINT missingA = m_textures[a].FirstResidentMip - m_textures[a].WantedMip;
+			const UINT missingB = m_textures[b].FirstResidentMip - m_textures[b].WantedMip;
+			return missingA != missingB ? missingA > missingB : a < b;
+		});
+
+	for (UINT handle : m_upgrades)
+	{
+		if (outRequests.size() >= maxRequests)
+		{
+			break;
+		}
+
+		const StreamedTexture& texture = m_textures[handle];
+		// Settle for a coarser mip, if the wanted one does not fit.
+		for (UINT mip = texture.WantedMip; mip < texture.FirstResidentMip; ++mip)
+		{
+			const UINT64 neededBytes = texture.ResidentBytes[mip] - texture.ResidentBytes[texture.FirstResidentMip];
+			// One request is left for the upgrade itself.
+			if (MakeRoom(neededBytes, handle, outRequests, maxRequests - 1u))
+			{
+				SetResidency(handle, mip, outRequests);
+				++m_stats.NumStreamedIn;
+				break;
+			}
+		}
+	}
+
+	m_stats.ResidentBytes = m_residentBytes;
+}
+
+void TextureStreamer::OnRequestComplete(UINT handle)
+{
+	assert(handle < m_textures.size() && m_textures[handle].bIsStreaming);
+	m_textures[handle].bIsStreaming = false;
+}
+
+UINT TextureStreamer::GetFirstResidentMip(UINT handle) const
+{
+	assert(handle < m_textures.size());
+	return m_textures[handle].FirstResidentMip;
+}
+
+bool TextureStreamer::MakeRoom(UINT64 neededBytes, UINT exclude, std::vector<TextureStreamingRequest>& outRequests, UINT maxRequests)
+{
+	if (m_residentBytes + neededBytes <= m_budgetBytes)
+	{
+		return true;
+	}
+
+	// Mips above what the texture needs this frame (everything above the tail for unused textures) can go.
+	auto GetEvictionTarget = [this](const StreamedTexture& texture)
+		{
+			return texture.LastUsedFrame == m_frame ? texture.WantedMip : texture.TailMip;
+		};
+
+	m_evictions.clear();
+	UINT64 evictableBytes = 0u;
+	for (UINT i = 0; i < (UINT)m_textures.size(); ++i)
+	{
+		const StreamedTexture& texture = m_textures[i];
+		const UINT target = GetEvictionTarget(texture);
+		if (i != exclude && !texture.bIsStreaming && texture.FirstResidentMip < target)
+		{
+			m_evictions.push_back(i);
+			evictableBytes += texture.ResidentBytes[texture.FirstResidentMip] - texture.ResidentBytes[target];
+		}
+	}
+
+	// Going over budget without a request (the budget was lowered) still evicts as much as it can.
+	if (neededBytes > 0u && m_residentBytes + neededBytes > m_budgetBytes + evictableBytes)
+	{
+		return false;
+	}
+
+	// Mips the current frame does not need first (used textures have LastUsedFrame == m_frame, so they go last), then least recently used.
+	std::sort(m_evictions.begin(), m_evictions.end(), [this](UINT a, UINT b)
+		{
+			const bool bIsUsedA = m_textures[a].LastUsedFrame == m_frame;
+			const bool bIsUsedB = m_textures[b].LastUsedFrame == m_frame;
+			if (bIsUsedA != bIsUsedB)
+			{
+				return bIsUsedB;
+			}
+			return m_textures[a].LastUsedFrame != m_textures[b].LastUsedFrame ? m_textures[a].LastUsedFrame < m_textures[b].LastUsedFrame : a < b;
+		});
+
+	for (UINT handle : m_evictions)
+	{
+		if (m_residentBytes + neededBytes <= m_budgetBytes || outRequests.size() >= maxRequests)
+		{
+			break;
+		}
+
+		SetResidency(handle, GetEvictionTarget(m_textures[handle]), outRequests);
+		++m_stats.NumEvicted;
+	}
+
+	return m_residentBytes + neededBytes <= m_budgetBytes;
+}
+
+void TextureStreamer::SetResidency(UINT handle, UINT firstResidentMip, std::vector<TextureStreamingRequest>& outRequests)
+{
+	StreamedTexture& texture = m_textures[handle];
+	assert(!texture.bIsStreaming && firstResidentMip <= texture.TailMip);
+
+	m_residentBytes = m_residentBytes - texture.ResidentBytes[texture.FirstResidentMip] + texture.ResidentBytes[firstResidentMip];
+	texture.FirstResidentMip = firstResidentMip;
+	texture.bIsStreaming = true;
+
+	outRequests.push_back({ handle, firstResidentMip });
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+
+// New resident range of a streamed texture: mips [FirstResidentMip, MipCount) have to be on the GPU.
+struct TextureStreamingRequest
+{
+	UINT Handle = 0u;
+	UINT FirstResidentMip = 0u;
+};
+
+struct TextureStreamerStats
+{
+	UINT64 ResidentBytes = 0u;
+	// What would be resident this frame without the budget.
+	UINT64 WantedBytes = 0u;
+	UINT64 NumStreamedIn = 0u;
+	UINT64 NumEvicted = 0u;
+};
+
+// Decides which mips of the streamed textures are resident. CPU only, it knows nothing about D3D:
+// every frame the caller reports the mips the visible items need, applies the returned requests
+// and reports back once a request is done (old mips released), see OnRequestComplete.
+//
+// Mips the frame wants are streamed in, largest shortfall first. When that would go over the budget, mips are evicted,
+// first the ones above what their texture currently needs, then the ones of textures unused for the longest time.
+// Mips which are not needed any more stay resident until the memory is needed.
+class TextureStreamer
+{
+public:
+	// Mips with the longer side up to this many texels are always resident.
+	static constexpr UINT DefaultMinResidentSize = 64u;
+	static constexpr UINT DefaultMaxRequestsPerUpdate = 4u;
+
+	TextureStreamer(UINT64 budgetBytes);
+	TextureStreamer(const TextureStreamer& lhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& lhs) = delete;
+
+	~TextureStreamer() noexcept = default;
+
+public:
+	// Coarsest mip, which is still resident at all times.
+	static UINT ComputeTailMip(UINT width, UINT height, UINT mipCount, UINT minResidentSize = DefaultMinResidentSize);
+	// Mip whose texels map 1:1 to pixels, for a texture repeated uvScale times across projectedSize pixels.
+	static float ComputeRequiredMip(UINT width, UINT height, float uvScale, float projectedSize);
+
+	// pMipByteSizes[i] is the size of mip i over all array slices. The texture starts with only its tail resident.
+	UINT Register(UINT width, UINT height, UINT mipCount, const UINT64* pMipByteSizes, UINT minResidentSize = DefaultMinResidentSize);
+
+	void SetBudget(UINT64 budgetBytes);
+	FORCEINLINE UINT64 GetBudget() const { return m_budgetBytes; }
+
+	void BeginFrame();
+	// Keeps the most detailed mip requested during the frame.
+	void RequestMip(UINT handle, float mip);
+	// Writes up to maxRequests residency changes, which are accounted as resident right away.
+	void Update(std::vector<TextureStreamingRequest>& outRequests, UINT maxRequests = DefaultMaxRequestsPerUpdate);
+	// The texture takes no requests until its previous one is complete.
+	void OnRequestComplete(UINT handle);
+
+	UINT GetFirstResidentMip(UINT handle) const;
+	FORCEINLINE UINT GetCount() const { return (UINT)m_textures.size(); }
+	FORCEINLINE const TextureStreamerStats& GetStats() const { return m_stats; }
+
+private:
+	struct StreamedTexture
+	{
+		// ResidentBytes[i] is the size of mips [i, MipCount).
+		std::vector<UINT64> ResidentBytes;
+		UINT TailMip = 0u;
+		UINT FirstResidentMip = 0u;
+		// Most detailed mip requested this frame, TailMip if the texture is unused.
+		UINT WantedMip = 0u;
+		UINT64 LastUsedFrame = 0u;
+		bool bIsStreaming = false;
+	};
+
+	// Evicts mips until neededBytes more fit the budget. Evicts nothing if they cannot fit anyway. exclude keeps its mips.
+	bool MakeRoom(UINT64 neededBytes, UINT exclude, std::vector<TextureStreamingRequest>& outRequests, UINT maxRequests);
+	void SetResidency(UINT handle, UINT firstResidentMip, std::vector<TextureStreamingRequest>& outRequests);
+
+private:
+	std::vector<StreamedTexture> m_textures;
+	UINT64 m_budgetBytes = 0u;
+	UINT64 m_residentBytes = 0u;
+	UINT64 m_frame = 0u;
+
+	TextureStreamerStats m_stats;
+
+	// Scratch, kept to avoid per frame allocations.
+	std::vector<UINT> m_upgrades;
+	std::vector<UINT> m_evictions;
+};
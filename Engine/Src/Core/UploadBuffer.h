@@ -41,11 +41,22 @@ public:
 		return m_uploadBuffer.Get();
 	}
 
+	FORCEINLINE UINT GetElementByteSize() const
+	{
+		return m_elementByteSize;
+	}
+
 	void CopyData(int elementIndex, const T& data)
 	{
 		memcpy(&m_mappedData[elementIndex * m_elementByteSize], &data, sizeof(T));
 	}
 
+	// Copies elementCount contiguous elements at once. Source must be laid out with GetElementByteSize() stride.
+	void CopyRange(int firstElementIndex, const void* data, UINT elementCount)
+	{
+		memcpy(&m_mappedData[firstElementIndex * m_elementByteSize], data, (size_t)elementCount * m_elementByteSize);
+	}
+
 private:
 	ComPtr<ID3D12Resource> m_uploadBuffer; // either constant or vertex/index buffer
 	BYTE* m_mappedData = nullptr;
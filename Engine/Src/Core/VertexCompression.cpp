@@ -0,0 +1,90 @@
+#include "VertexCompression.h"
+
+using namespace DirectX::PackedVector;
+
+PositionDequantization PositionDequantization::FromBounds(const BoundingBox& bounds)
+{
+	const XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+
+	PositionDequantization dequantization;
+	XMStoreFloat3(&dequantization.Scale, XMVectorAdd(extents, extents));
+	XMStoreFloat3(&dequantization.Bias, XMVectorSubtract(XMLoadFloat3(&bounds.Center), extents));
+	return dequantization;
+}
+
+XMVECTOR XM_CALLCONV VertexCompression::OctahedralEncode(FXMVECTOR unitVector)
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1
+	const XMVECTOR l1Norm = XMVectorMax(XMVector3Dot(XMVectorAbs(unitVector), g_XMOne), g_XMEpsilon);
+	const XMVECTOR p = XMVectorDivide(unitVector, l1Norm);
+
+	// Lower hemisphere is folded over the diagonals onto the outer triangles of the square
+	const XMVECTOR signs = XMVectorSelect(g_XMNegativeOne, g_XMOne, XMVectorGreaterOrEqual(p, g_XMZero));
+	const XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(g_XMOne, XMVectorAbs(XMVectorSwizzle<1, 0, 3, 2>(p))), signs);
+
+	return XMVectorSelect(p, folded, XMVectorLess(XMVectorSplatZ(p), g_XMZero));
+}
+
+XMVECTOR XM_CALLCONV VertexCompression::OctahedralDecode(FXMVECTOR encoded)
+{
+	const XMVECTOR absEncoded = XMVectorAbs(encoded);
+	const XMVECTOR z = XMVectorSubtract(g_XMOne, XMVectorAdd(XMVectorSplatX(absEncoded), XMVectorSplatY(absEncoded)));
+
+	// Unfold the lower hemisphere, t is 0 for the upper one
+	const XMVECTOR t = XMVectorMax(XMVectorNegate(z), g_XMZero);
+	const XMVECTOR xy = XMVectorAdd(encoded, XMVectorSelect(t, XMVectorNegate(t), XMVectorGreaterOrEqual(encoded, g_XMZero)));
+
+	return XMVector3Normalize(XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Y, XM_PERMUTE_1Z, XM_PERMUTE_1W>(xy, z));
+}
+
+void VertexCompression::Encode(const VertexPositionNormalTangentUV* pSrc, size_t count, const PositionDequantization& dequantization,
+	VertexPositionNormalTangentUVPacked* pDst, float bitangentSign)
+{
+	// Flat dimensions (e.g. a grid's height) have zero scale, everything quantizes to 0 there.
+	const XMVECTOR scale = XMLoadFloat3(&dequantization.Scale);
+	const XMVECTOR invScale = XMVectorSelect(XMVectorReciprocal(scale), g_XMZero, XMVectorLessOrEqual(scale, g_XMZero));
+	const XMVECTOR bias = XMLoadFloat3(&dequantization.Bias);
+	const XMVECTOR signW = XMVectorReplicate(bitangentSign < 0.0f ? 0.0f : 1.0f);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionNormalTangentUV& src = pSrc[i];
+		VertexPositionNormalTangentUVPacked& dst = pDst[i];
+
+		const XMVECTOR posQ = XMVectorSaturate(XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&src.position), bias), invScale));
+		XMStoreUShortN4(&dst.position, XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Y, XM_PERMUTE_0Z, XM_PERMUTE_1W>(posQ, signW));
+
+		const XMVECTOR normal = OctahedralEncode(XMVector3Normalize(XMLoadFloat3(&src.normal)));
+		const XMVECTOR tangent = OctahedralEncode(XMVector3Normalize(XMLoadFloat3(&src.tangent)));
+		XMStoreShortN4(&dst.normalTangent, XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Y, XM_PERMUTE_1X, XM_PERMUTE_1Y>(normal, tangent));
+
+		XMStoreHalf2(&dst.texCoord, XMLoadFloat2(&src.texCoord));
+	}
+}
+
+void VertexCompression::Decode(const VertexPositionNormalTangentUVPacked* pSrc, size_t count, const PositionDequantization& dequantization,
+	VertexPositionNormalTangentUV* pDst, float* pOutBitangentSigns)
+{
+	const XMVECTOR scale = XMLoadFloat3(&dequantization.Scale);
+	const XMVECTOR bias = XMLoadFloat3(&dequantization.Bias);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const VertexPositionNormalTangentUVPacked& src = pSrc[i];
+		VertexPositionNormalTangentUV& dst = pDst[i];
+
+		const XMVECTOR posQ = XMLoadUShortN4(&src.position);
+		XMStoreFloat3(&dst.position, XMVectorMultiplyAdd(posQ, scale, bias));
+
+		const XMVECTOR normalTangent = XMLoadShortN4(&src.normalTangent);
+		XMStoreFloat3(&dst.normal, OctahedralDecode(normalTangent));
+		XMStoreFloat3(&dst.tangent, OctahedralDecode(XMVectorSwizzle<2, 3, 0, 1>(normalTangent)));
+
+		XMStoreFloat2(&dst.texCoord, XMLoadHalf2(&src.texCoord));
+
+		if (pOutBitangentSigns)
+		{
+			pOutBitangentSigns[i] = XMVectorGetW(posQ) * 2.0f - 1.0f;
+		}
+	}
+}
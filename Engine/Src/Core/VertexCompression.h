@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Common/ScaldMath.h"
+#include "Common/VertexTypes.h"
+
+// Maps quantized [0, 1] positions back to the mesh space: p = posQ * Scale + Bias.
+struct PositionDequantization
+{
+	XMFLOAT3 Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	XMFLOAT3 Bias = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	static PositionDequantization FromBounds(const BoundingBox& bounds);
+};
+
+// Converts vertices to and from VertexPositionNormalTangentUVPacked:
+// positions are 16 bit unorm within the mesh bounds, normal and tangent are 16 bit snorm octahedral, UVs are halfs.
+// Decoding must match the one in Common.hlsl.
+class VertexCompression
+{
+public:
+	// Source vertices have no handedness, so the same bitangent sign is written for all of them.
+	static void Encode(const VertexPositionNormalTangentUV* pSrc, size_t count, const PositionDequantization& dequantization,
+		VertexPositionNormalTangentUVPacked* pDst, float bitangentSign = 1.0f);
+
+	static void Decode(const VertexPositionNormalTangentUVPacked* pSrc, size_t count, const PositionDequantization& dequantization,
+		VertexPositionNormalTangentUV* pDst, float* pOutBitangentSigns = nullptr);
+
+	// Unit vector to octahedral coordinates in xy, [-1, 1] each. zw are undefined.
+	static XMVECTOR XM_CALLCONV OctahedralEncode(FXMVECTOR unitVector);
+	// Octahedral coordinates in xy to unit vector.
+	static XMVECTOR XM_CALLCONV OctahedralDecode(FXMVECTOR encoded);
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Chase-Lev work-stealing deque ("Dynamic Circular Work-Stealing Deque", with the C11 memory orders of Le et al.).
+// The owner thread pushes and pops at the bottom without locks, any other thread may steal from the top.
+// Holds pointers, so a slot is a single atomic word which a thief can read while the owner writes the neighbouring ones.
+template<typename T>
+class WorkStealingDeque
+{
+public:
+	explicit WorkStealingDeque(UINT capacity = DefaultCapacity)
+	{
+		assert(capacity > 0u && (capacity & (capacity - 1u)) == 0u && "Capacity must be a power of two");
+		m_buffers.push_back(std::make_unique<Buffer>(capacity));
+		m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque& lhs) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque& lhs) = delete;
+
+	~WorkStealingDeque() noexcept = default;
+
+	// Owner only
+	void Push(T* item)
+	{
+		const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		const int64_t top = m_top.load(std::memory_order_acquire);
+		Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+
+		if (bottom - top >= (int64_t)buffer->Capacity)
+		{
+			buffer = Grow(buffer, top, bottom);
+		}
+
+		buffer->Store(bottom, item);
+		// Thieves acquire bottom before reading the slot, so the item is visible to them once they see it counted.
+		m_bottom.store(bottom + 1, std::memory_order_release);
+	}
+
+	// Owner only. Takes the most recently pushed item, nullptr if the deque is empty (or the last item has been stolen meanwhile).
+	T* Pop()
+	{
+		const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* item = buffer->Load(bottom);
+		if (top == bottom)
+		{
+			// Last item, race with thieves for it.
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				item = nullptr;
+			}
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// Any thread. Takes the oldest item, nullptr if the deque is empty or another thread has won the race for it.
+	T* Steal()
+	{
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		// Buffer is loaded after bottom, so it is at least as new as the one the item has been pushed into.
+		Buffer* buffer = m_buffer.load(std::memory_order_acquire);
+		T* item = buffer->Load(top);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return item;
+	}
+
+	// Approximate if other threads are using the deque.
+	FORCEINLINE bool IsEmpty() const
+	{
+		return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct Buffer
+	{
+		explicit Buffer(UINT capacity) : Capacity(capacity), Mask(capacity - 1u), Items(new std::atomic<T*>[capacity]) {}
+
+		FORCEINLINE T* Load(int64_t index) const { return Items[index & Mask].load(std::memory_order_relaxed); }
+		FORCEINLINE void Store(int64_t index, T* item) { Items[index & Mask].store(item, std::memory_order_relaxed); }
+
+		const UINT Capacity;
+		const UINT Mask;
+		std::unique_ptr<std::atomic<T*>[]> Items;
+	};
+
+	Buffer* Grow(Buffer* buffer, int64_t top, int64_t bottom)
+	{
+		m_buffers.push_back(std::make_unique<Buffer>(buffer->Capacity * 2u));
+		Buffer* grown = m_buffers.back().get();
+		for (int64_t i = top; i < bottom; ++i)
+		{
+			grown->Store(i, buffer->Load(i));
+		}
+		m_buffer.store(grown, std::memory_order_release);
+		return grown;
+	}
+
+private:
+	static constexpr UINT DefaultCapacity = 1024u;
+
+	// Top and bottom are hammered by different threads, keep them on separate cache lines.
+	alignas(64) std::atomic<int64_t> m_top = 0;
+	alignas(64) std::atomic<int64_t> m_bottom = 0;
+	std::atomic<Buffer*> m_buffer = nullptr;
+
+	// Outgrown buffers are kept until the deque is destroyed, a thief may still be reading from one of them.
+	std::vector<std::unique_ptr<Buffer>> m_buffers;
+};
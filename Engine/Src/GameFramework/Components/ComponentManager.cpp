@@ -0,0 +1,45 @@
+#include "ComponentManager.h"
+
+Scald::Entity Scald::ComponentManager::CreateEntity()
+{
+	Entity entity;
+
+	if (!m_freeIndices.empty())
+	{
+		entity.Index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+	}
+	else
+	{
+		entity.Index = (uint32_t)m_generations.size();
+		m_generations.push_back(0u);
+	}
+
+	entity.Generation = m_generations[entity.Index];
+	return entity;
+}
+
+void Scald::ComponentManager::DestroyEntity(Entity entity)
+{
+	if (!IsAlive(entity))
+	{
+		return;
+	}
+
+	for (auto& pool : m_pools)
+	{
+		if (pool)
+		{
+			pool->Remove(entity);
+		}
+	}
+
+	// Invalidate all outstanding handles and recycle the index.
+	m_generations[entity.Index]++;
+	m_freeIndices.push_back(entity.Index);
+}
+
+bool Scald::ComponentManager::IsAlive(Entity entity) const
+{
+	return entity.Index < m_generations.size() && m_generations[entity.Index] == entity.Generation;
+}
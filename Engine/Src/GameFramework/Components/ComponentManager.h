@@ -1,12 +1,13 @@
 #pragma once
 
-#include "Common/DXHelper.h"
+#include "Common/ScaldPlatform.h"
+#include "ComponentPool.h"
+
+#include <tuple>
 
 namespace Scald
 {
-	class SComponent;
-	class SObject;
-	
+	// Entity registry. Entities are plain handles, their components live in typed sparse set pools.
 	class ComponentManager
 	{
 	public:
@@ -16,10 +17,83 @@ namespace Scald
 			return inst;
 		}
 
-		template<typename T = SComponent, typename... Args>
-		std::shared_ptr<T> CreateDefaultSubobject(std::shared_ptr<SObject> owner, Args&&... args)
+		Entity CreateEntity();
+		// Removes all components of the entity and invalidates its handle.
+		void DestroyEntity(Entity entity);
+		bool IsAlive(Entity entity) const;
+
+		template<typename T, typename... Args>
+		T& AddComponent(Entity entity, Args&&... args)
+		{
+			assert(IsAlive(entity));
+			return GetPool<T>().Add(entity, std::forward<Args>(args)...);
+		}
+
+		template<typename T>
+		void RemoveComponent(Entity entity)
+		{
+			GetPool<T>().Remove(entity);
+		}
+
+		template<typename T>
+		T* GetComponent(Entity entity)
+		{
+			return GetPool<T>().Get(entity);
+		}
+
+		template<typename T>
+		bool HasComponent(Entity entity)
+		{
+			return GetPool<T>().Has(entity);
+		}
+
+		template<typename T>
+		ComponentPool<T>& GetPool()
+		{
+			const ComponentTypeID typeID = GetComponentTypeID<T>();
+
+			if (typeID >= m_pools.size())
+			{
+				m_pools.resize(typeID + 1u);
+			}
+			if (!m_pools[typeID])
+			{
+				m_pools[typeID] = std::make_unique<ComponentPool<T>>();
+			}
+
+			// Pool at typeID is always created for T, so no RTTI cast is needed.
+			return *static_cast<ComponentPool<T>*>(m_pools[typeID].get());
+		}
+
+		// Calls func(Entity, T&, Others&...) for every entity which has all of the components.
+		// Walks the dense array of T, so T should be the rarest of the components.
+		template<typename T, typename... Others, typename Func>
+		void Each(Func&& func)
 		{
-			return std::make_shared<T>(owner, std::forward<Args>(args)...);
+			ComponentPool<T>& pool = GetPool<T>();
+			const std::vector<Entity>& entities = pool.GetEntities();
+			std::vector<T>& components = pool.GetComponents();
+
+			if constexpr (sizeof...(Others) == 0)
+			{
+				for (size_t i = 0; i < components.size(); ++i)
+				{
+					func(entities[i], components[i]);
+				}
+			}
+			else
+			{
+				std::tuple<ComponentPool<Others>*...> otherPools(&GetPool<Others>()...);
+
+				for (size_t i = 0; i < components.size(); ++i)
+				{
+					const Entity entity = entities[i];
+					if ((std::get<ComponentPool<Others>*>(otherPools)->Has(entity) && ...))
+					{
+						func(entity, components[i], std::get<ComponentPool<Others>*>(otherPools)->GetUnchecked(entity)...);
+					}
+				}
+			}
 		}
 
 	private:
@@ -30,5 +104,13 @@ namespace Scald
 		ComponentManager& operator=(const ComponentManager&) = delete;
 		ComponentManager(ComponentManager&&) = delete;
 		ComponentManager& operator=(ComponentManager&&) = delete;
+
+	private:
+		// Current generation of every entity index
+		std::vector<uint32_t> m_generations;
+		std::vector<uint32_t> m_freeIndices;
+
+		// Indexed by ComponentTypeID
+		std::vector<std::unique_ptr<IComponentPool>> m_pools;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Common/ScaldPlatform.h"
+#include "GameFramework/Objects/Entity.h"
+
+namespace Scald
+{
+	using ComponentTypeID = uint32_t;
+
+	inline ComponentTypeID NextComponentTypeID()
+	{
+		static ComponentTypeID counter = 0u;
+		return counter++;
+	}
+
+	// Unique id per component type, assigned on first use. Used to find the pool of a type without RTTI.
+	template<typename T>
+	ComponentTypeID GetComponentTypeID()
+	{
+		static const ComponentTypeID id = NextComponentTypeID();
+		return id;
+	}
+
+	// Type erased interface, so the registry can clean up all the pools of a destroyed entity.
+	class IComponentPool
+	{
+	public:
+		virtual ~IComponentPool() noexcept = default;
+
+		virtual bool Has(Entity entity) const = 0;
+		virtual void Remove(Entity entity) = 0;
+	};
+
+	// Sparse set storage: sparse array maps entity index to position in dense arrays.
+	// Components are tightly packed in a contiguous array, so iteration touches only live components.
+	template<typename T>
+	class ComponentPool final : public IComponentPool
+	{
+	public:
+		ComponentPool() = default;
+		ComponentPool(const ComponentPool& lhs) = delete;
+		ComponentPool& operator=(const ComponentPool& lhs) = delete;
+
+		virtual ~ComponentPool() noexcept override = default;
+
+	public:
+		template<typename... Args>
+		T& Add(Entity entity, Args&&... args)
+		{
+			assert(!Has(entity));
+
+			if (entity.Index >= m_sparse.size())
+			{
+				m_sparse.resize(entity.Index + 1u, InvalidDenseIndex);
+			}
+
+			m_sparse[entity.Index] = (uint32_t)m_dense.size();
+			m_dense.push_back(entity);
+			m_components.emplace_back(std::forward<Args>(args)...);
+			++m_version;
+			return m_components.back();
+		}
+
+		// Swaps the last component into the hole, so the dense arrays stay packed.
+		virtual void Remove(Entity entity) override
+		{
+			if (!Has(entity))
+			{
+				return;
+			}
+
+			const uint32_t denseIndex = m_sparse[entity.Index];
+			const uint32_t lastIndex = (uint32_t)m_dense.size() - 1u;
+
+			if (denseIndex != lastIndex)
+			{
+				m_dense[denseIndex] = m_dense[lastIndex];
+				m_components[denseIndex] = std::move(m_components[lastIndex]);
+				m_sparse[m_dense[denseIndex].Index] = denseIndex;
+			}
+
+			m_dense.pop_back();
+			m_components.pop_back();
+			m_sparse[entity.Index] = InvalidDenseIndex;
+			++m_version;
+		}
+
+		virtual bool Has(Entity entity) const override
+		{
+			return entity.Index < m_sparse.size()
+				&& m_sparse[entity.Index] != InvalidDenseIndex
+				&& m_dense[m_sparse[entity.Index]] == entity;
+		}
+
+		T* Get(Entity entity)
+		{
+			return Has(entity) ? &m_components[m_sparse[entity.Index]] : nullptr;
+		}
+
+		// Entity has to have the component.
+		FORCEINLINE T& GetUnchecked(Entity entity)
+		{
+			assert(Has(entity));
+			return m_components[m_sparse[entity.Index]];
+		}
+
+		FORCEINLINE size_t Size() const { return m_dense.size(); }
+		// Bumped on every add and remove, so systems can tell when data they derived from the pool is stale.
+		FORCEINLINE uint64_t GetVersion() const { return m_version; }
+
+		// Dense arrays, entities[i] owns components[i].
+		FORCEINLINE const std::vector<Entity>& GetEntities() const { return m_dense; }
+		FORCEINLINE std::vector<T>& GetComponents() { return m_components; }
+
+	private:
+		static constexpr uint32_t InvalidDenseIndex = UINT32_MAX;
+
+		std::vector<uint32_t> m_sparse;
+		std::vector<Entity> m_dense;
+		std::vector<T> m_components;
+
+		uint64_t m_version = 0u;
+	};
+}
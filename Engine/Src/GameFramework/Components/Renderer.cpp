@@ -1,12 +0,0 @@
-#include "stdafx.h"
-#include "Renderer.h"
-
-Scald::Renderer::Renderer(std::shared_ptr<SObject> owner)
-	: Super(owner)
-{
-
-}
-
-Scald::Renderer::~Renderer() noexcept
-{
-}
@@ -1,21 +1,18 @@
 #pragma once
 
-#include "SComponent.h"
+#include "Common/ScaldMath.h"
 
 namespace Scald
 {
-	class Renderer : public SComponent
+	// Data component, stored by value in the ComponentManager's pool.
+	struct Renderer
 	{
-		using Super = SComponent;
-	public:
-		Renderer(std::shared_ptr<SObject> owner);
-		virtual ~Renderer() noexcept override;
-
 		// For frustum culling
 		BoundingBox Bounds;
 
-		XMMATRIX World = XMMatrixIdentity();
+		// Slot in the objects' constant buffer, the TransformSystem writes world matrices straight into it.
+		UINT ObjCBIndex = -1;
 		// could be used for texture tiling
 		XMMATRIX TexTransform = XMMatrixIdentity();
 	};
-}
\ No newline at end of file
+}
@@ -1,22 +0,0 @@
-#include "stdafx.h"
-#include "SComponent.h"
-
-Scald::SComponent::~SComponent() noexcept
-{
-
-}
-
-void Scald::SComponent::OnUpdate()
-{
-
-}
-
-void Scald::SComponent::OnAttach()
-{
-
-}
-
-void Scald::SComponent::OnDestroy()
-{
-
-}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "Scene.h"
+#include "Core/MeshSimplifier.h"
+#include "Core/MeshOptimizer.h"
 
 Scald::Scene::Scene()
 {
@@ -16,6 +18,7 @@ MeshID Scald::Scene::AddMesh(const MeshData<>& mesh)
     // !!!!!!! need a mutex
     MeshID id = LAST_USED_MESH_ID++;
     m_meshes[id] = mesh;
+    MeshOptimizer::Optimize(m_meshes[id]);
     return id;
 }
 
@@ -23,7 +26,8 @@ MeshID Scald::Scene::AddMesh(MeshData<>&& mesh)
 {
     // !!!!!!! need a mutex
     MeshID id = LAST_USED_MESH_ID++;
-    m_meshes[id] = mesh;
+    m_meshes[id] = std::move(mesh);
+    MeshOptimizer::Optimize(m_meshes[id]);
     return id;
 }
 
@@ -33,4 +37,14 @@ void Scald::Scene::CreateBuildInMeshes()
     m_buildInMeshes[EBuiltInMeshes::SPHERE] = Shapes::CreateSphere(1.0f, 16u, 16u);
     m_buildInMeshes[EBuiltInMeshes::GEOSPHERE] = Shapes::CreateGeosphere(1.0f, 3u);
     m_buildInMeshes[EBuiltInMeshes::GRID] = Shapes::CreateGrid(100.0f, 100.0f, 2u, 2u);
+
+    // Sky reuses the sphere's LOD 0 only
+    MeshSimplifier::BuildLODChain(m_buildInMeshes[EBuiltInMeshes::SPHERE], 4u);
+    MeshSimplifier::BuildLODChain(m_buildInMeshes[EBuiltInMeshes::GEOSPHERE], 4u);
+
+    // Generated index buffers come in generation order, which is far from cache friendly
+    for (UINT meshType = 0; meshType < EBuiltInMeshes::NUM_BUILTIN_MESHES; ++meshType)
+    {
+        MeshOptimizer::Optimize(m_buildInMeshes[meshType]);
+    }
 }
\ No newline at end of file
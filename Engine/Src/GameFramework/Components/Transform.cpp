@@ -1,27 +1,33 @@
-#include "stdafx.h"
 #include "Transform.h"
 
-Scald::Transform::Transform(std::shared_ptr<Scald::SObject> owner, XMVECTOR pos, XMVECTOR rot, XMVECTOR scale)
-	: Super(owner)
+Scald::Transform::Transform(XMVECTOR pos, XMVECTOR rot, XMVECTOR scale)
 {
 	XMStoreFloat3(&m_translation, pos);
-	XMStoreFloat3(&m_euler, rot);
+	XMStoreFloat4(&m_orient, XMQuaternionRotationRollPitchYawFromVector(rot));
 	XMStoreFloat3(&m_scale, scale);
-	XMStoreFloat4(&m_orient, XMVectorZero());
+	XMStoreFloat4x4(&m_world, XMMatrixIdentity());
 }
 
-Scald::Transform::~Transform() noexcept
+void Scald::Transform::SetScale(XMVECTOR scale)
 {
+	XMStoreFloat3(&m_scale, scale);
+	m_isDirty = true;
 }
 
-void Scald::Transform::OnUpdate()
+void Scald::Transform::SetOrientation(XMVECTOR quat)
 {
+	XMStoreFloat4(&m_orient, XMQuaternionNormalize(quat));
+	m_isDirty = true;
 }
 
-void Scald::Transform::OnAttach()
+void Scald::Transform::SetEulerRot(XMVECTOR rot)
 {
+	XMStoreFloat4(&m_orient, XMQuaternionRotationRollPitchYawFromVector(rot));
+	m_isDirty = true;
 }
 
-void Scald::Transform::OnDestroy()
+void Scald::Transform::SetTranslation(XMVECTOR pos)
 {
+	XMStoreFloat3(&m_translation, pos);
+	m_isDirty = true;
 }
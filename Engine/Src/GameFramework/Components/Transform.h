@@ -1,48 +1,67 @@
 #pragma once
 
-#include "SComponent.h"
+#include "Common/ScaldMath.h"
+#include "GameFramework/Objects/Entity.h"
 
 namespace Scald
 {
-	class SObject;
-
-	class Transform : public SComponent
+	// Data component, stored by value in the ComponentManager's pool.
+	// Local TRS is relative to the parent transform, world matrix is cached and refreshed by the TransformSystem.
+	class Transform
 	{
-		using Super = SComponent;
 	public:
-		Transform(std::shared_ptr<SObject> owner, XMVECTOR pos, XMVECTOR rot, XMVECTOR scale);
-		virtual ~Transform() noexcept override;
+		// rot is Euler angles (pitch, yaw, roll)
+		Transform(XMVECTOR pos, XMVECTOR rot, XMVECTOR scale);
 
-		FORCEINLINE XMVECTOR GetScale()
+		FORCEINLINE XMVECTOR GetScale() const
 		{
 			return XMLoadFloat3(&m_scale);
 		}
 
-		FORCEINLINE XMVECTOR GetEulerRot()
-		{
-			return XMLoadFloat3(&m_euler);
-		}
-
-		FORCEINLINE XMVECTOR GetOrientation()
+		FORCEINLINE XMVECTOR GetOrientation() const
 		{
 			return XMLoadFloat4(&m_orient);
 		}
 		
-		FORCEINLINE XMVECTOR GetTranslation()
+		FORCEINLINE XMVECTOR GetTranslation() const
 		{
 			return XMLoadFloat3(&m_translation);
 		}
 
-	public:
-		virtual void OnUpdate() override;
-		virtual void OnAttach() override;
-		virtual void OnDestroy() override;
+		FORCEINLINE Entity GetParent() const
+		{
+			return m_parent;
+		}
+
+		// Valid after the TransformSystem has processed the transform at least once.
+		FORCEINLINE XMMATRIX GetWorldMatrix() const
+		{
+			return XMLoadFloat4x4(&m_world);
+		}
+
+		FORCEINLINE XMMATRIX GetLocalMatrix() const
+		{
+			return XMMatrixAffineTransformation(GetScale(), XMVectorZero(), GetOrientation(), GetTranslation());
+		}
 
+		void SetScale(XMVECTOR scale);
+		void SetOrientation(XMVECTOR quat);
+		void SetEulerRot(XMVECTOR rot);
+		void SetTranslation(XMVECTOR pos);
 
 	private:
+		friend class TransformSystem;
+
 		XMFLOAT3 m_scale;
-		XMFLOAT3 m_euler;
 		XMFLOAT4 m_orient;
 		XMFLOAT3 m_translation;
+
+		// Parent is changed only through the TransformSystem, since it owns the hierarchy levels.
+		Entity m_parent;
+
+		XMFLOAT4X4 m_world;
+		// TransformSystem frame at which m_world has been recomputed last time, children compare it against the current frame.
+		uint64_t m_worldUpdateFrame = 0u;
+		bool m_isDirty = true;
 	};
-}
\ No newline at end of file
+}
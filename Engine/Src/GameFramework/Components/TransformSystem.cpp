@@ -0,0 +1,202 @@
+#include "TransformSystem.h"
+#include "ComponentManager.h"
+#include "Transform.h"
+#include "Renderer.h"
+#include "Common/ScaldMath.h"
+#include "Core/JobSystem.h"
+
+bool Scald::TransformSystem::SetParent(Entity child, Entity parent)
+{
+	ComponentPool<Transform>& transforms = ComponentManager::Get().GetPool<Transform>();
+	assert(transforms.Has(child));
+	assert(!parent.IsValid() || transforms.Has(parent));
+
+	// Parenting to own descendant would create a cycle, which has no valid world matrix.
+	// Hierarchy is kept acyclic here, so the walk up always ends at a root.
+	for (Entity ancestor = parent; transforms.Has(ancestor); ancestor = transforms.GetUnchecked(ancestor).m_parent)
+	{
+		if (ancestor == child)
+		{
+			return false;
+		}
+	}
+
+	Transform& transform = transforms.GetUnchecked(child);
+	transform.m_parent = parent;
+	transform.m_isDirty = true;
+	m_isHierarchyDirty = true;
+	return true;
+}
+
+void Scald::TransformSystem::Update(PaddedObjectConstants* objectsCB, std::vector<UINT>& outChangedObjCBIndices)
+{
+	ComponentManager& componentManager = ComponentManager::Get();
+	// Pools are fetched on this thread, workers must never create them.
+	ComponentPool<Transform>& transforms = componentManager.GetPool<Transform>();
+	ComponentPool<Renderer>& renderers = componentManager.GetPool<Renderer>();
+
+	if (m_isHierarchyDirty || m_levelledPoolVersion != transforms.GetVersion())
+	{
+		RebuildLevels(transforms);
+	}
+
+	++m_frame;
+
+	JobSystem& jobSystem = JobSystem::Get();
+	// Indexed by job system thread, a thread may run several batches of a level.
+	// Job system may be not initialized, then ParallelFor runs everything on the calling thread 0.
+	const UINT numThreads = ScaldMath::Max(jobSystem.GetNumThreads(), 1u);
+	m_threadChangedIndices.resize(numThreads);
+	m_threadInverseBatches.resize(numThreads);
+
+	// Every level reads only world matrices of the previous one, so levels are processed in order and entities within a level in parallel.
+	for (const std::vector<Entity>& level : m_levels)
+	{
+		if (level.size() < ParallelThreshold)
+		{
+			UpdateRange(transforms, renderers, level.data(), level.size(), objectsCB, outChangedObjCBIndices, m_threadInverseBatches[0]);
+			continue;
+		}
+
+		for (std::vector<UINT>& threadChangedIndices : m_threadChangedIndices)
+		{
+			threadChangedIndices.clear();
+		}
+
+		jobSystem.ParallelFor((UINT)level.size(), BatchSize, [this, &transforms, &renderers, &level, objectsCB](UINT begin, UINT end)
+			{
+				const UINT threadIndex = JobSystem::GetThreadIndex();
+				UpdateRange(transforms, renderers, level.data() + begin, end - begin, objectsCB, m_threadChangedIndices[threadIndex], m_threadInverseBatches[threadIndex]);
+			});
+
+		for (const std::vector<UINT>& threadChangedIndices : m_threadChangedIndices)
+		{
+			outChangedObjCBIndices.insert(outChangedObjCBIndices.end(), threadChangedIndices.begin(), threadChangedIndices.end());
+		}
+	}
+}
+
+void Scald::TransformSystem::RebuildLevels(ComponentPool<Transform>& transforms)
+{
+	static constexpr uint32_t UnknownDepth = UINT32_MAX;
+	// Entity is on the chain being walked, meeting it again means the parent links form a cycle.
+	static constexpr uint32_t VisitingDepth = UINT32_MAX - 1u;
+
+	const std::vector<Entity>& entities = transforms.GetEntities();
+
+	uint32_t maxEntityIndex = 0u;
+	for (Entity entity : entities)
+	{
+		maxEntityIndex = ScaldMath::Max(maxEntityIndex, entity.Index);
+	}
+	m_depthScratch.assign(maxEntityIndex + 1u, UnknownDepth);
+
+	for (std::vector<Entity>& level : m_levels)
+	{
+		level.clear();
+	}
+
+	for (Entity entity : entities)
+	{
+		// Walk up until an ancestor with known depth or a root is found, then assign depths on the way back.
+		m_chainScratch.clear();
+		Entity curr = entity;
+		while (m_depthScratch[curr.Index] == UnknownDepth)
+		{
+			m_depthScratch[curr.Index] = VisitingDepth;
+			m_chainScratch.push_back(curr);
+
+			Transform& transform = transforms.GetUnchecked(curr);
+			// Parent without a transform (or a destroyed one) is treated as the world root.
+			if (!transforms.Has(transform.m_parent))
+			{
+				break;
+			}
+			// SetParent never creates a cycle, but if one slips in anyway the link is cut, so the walk ends and curr becomes a root.
+			if (m_depthScratch[transform.m_parent.Index] == VisitingDepth)
+			{
+				assert(false && "Transform hierarchy has a cycle");
+				transform.m_parent = Entity{};
+				transform.m_isDirty = true;
+				break;
+			}
+			curr = transform.m_parent;
+		}
+
+		// Loop stops either at the last pushed entity (a root) or at an ancestor with already known depth.
+		uint32_t depth = (m_depthScratch[curr.Index] == VisitingDepth) ? 0u : m_depthScratch[curr.Index] + 1u;
+		for (auto it = m_chainScratch.rbegin(); it != m_chainScratch.rend(); ++it, ++depth)
+		{
+			m_depthScratch[it->Index] = depth;
+		}
+
+		const uint32_t entityDepth = m_depthScratch[entity.Index];
+		if (entityDepth >= m_levels.size())
+		{
+			m_levels.resize(entityDepth + 1u);
+		}
+		m_levels[entityDepth].push_back(entity);
+	}
+
+	// Drop empty trailing levels left from a deeper hierarchy.
+	while (!m_levels.empty() && m_levels.back().empty())
+	{
+		m_levels.pop_back();
+	}
+
+	m_isHierarchyDirty = false;
+	m_levelledPoolVersion = transforms.GetVersion();
+}
+
+void Scald::TransformSystem::UpdateRange(ComponentPool<Transform>& transforms, ComponentPool<Renderer>& renderers, const Entity* entities, size_t count,
+	PaddedObjectConstants* objectsCB, std::vector<UINT>& outChangedObjCBIndices, InverseBatch& batch) const
+{
+	batch.Worlds.clear();
+	batch.ObjCBIndices.clear();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Entity entity = entities[i];
+		Transform& transform = transforms.GetUnchecked(entity);
+		const Transform* parent = transforms.Get(transform.m_parent);
+
+		// Parent has been processed on the previous level, so its frame stamp is final by now.
+		const bool isParentChanged = parent && parent->m_worldUpdateFrame == m_frame;
+		if (!transform.m_isDirty && !isParentChanged)
+		{
+			continue;
+		}
+
+		XMMATRIX world = transform.GetLocalMatrix();
+		if (parent)
+		{
+			world = XMMatrixMultiply(world, parent->GetWorldMatrix());
+		}
+		XMStoreFloat4x4(&transform.m_world, world);
+		transform.m_isDirty = false;
+		transform.m_worldUpdateFrame = m_frame;
+
+		const Renderer* renderer = renderers.Get(entity);
+		if (objectsCB && renderer && renderer->ObjCBIndex != (UINT)-1)
+		{
+			XMStoreFloat4x4(&objectsCB[renderer->ObjCBIndex].World, XMMatrixTranspose(world));
+			batch.Worlds.push_back(transform.m_world);
+			batch.ObjCBIndices.push_back(renderer->ObjCBIndex);
+		}
+	}
+
+	if (batch.Worlds.empty())
+	{
+		return;
+	}
+
+	// Inverses of the whole range at once, then scattered to the constant buffer slots.
+	// transpose(inverse(transpose(W))) == inverse(W)
+	batch.Inverses.resize(batch.Worlds.size());
+	ScaldMath::InverseAffineBatch(batch.Worlds.data(), batch.Inverses.data(), batch.Worlds.size());
+	for (size_t i = 0; i < batch.ObjCBIndices.size(); ++i)
+	{
+		objectsCB[batch.ObjCBIndices[i]].InvTransposeWorld = batch.Inverses[i];
+	}
+	outChangedObjCBIndices.insert(outChangedObjCBIndices.end(), batch.ObjCBIndices.begin(), batch.ObjCBIndices.end());
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Common/ObjectConstants.h"
+#include "ComponentPool.h"
+
+namespace Scald
+{
+	class Transform;
+	struct Renderer;
+
+	// Keeps cached world matrices of the Transform components up to date.
+	// Transforms are grouped by their depth in the hierarchy, so every parent is resolved before its children
+	// and all the transforms of a single level can be processed in parallel.
+	class TransformSystem
+	{
+	public:
+		TransformSystem() = default;
+		TransformSystem(const TransformSystem& lhs) = delete;
+		TransformSystem& operator=(const TransformSystem& lhs) = delete;
+
+		~TransformSystem() noexcept = default;
+
+	public:
+		// Pass an invalid entity to detach the child. Both entities must have a Transform.
+		// Returns false and keeps the old parent if parent is the child itself or one of its descendants.
+		bool SetParent(Entity child, Entity parent);
+
+		// Recomputes world matrices of changed transforms and of all their descendants.
+		// For entities with a Renderer the world and inverse transpose world matrices are written into objectsCB[ObjCBIndex],
+		// and the index is appended to outChangedObjCBIndices (in no particular order).
+		void Update(PaddedObjectConstants* objectsCB, std::vector<UINT>& outChangedObjCBIndices);
+
+	private:
+		// World matrices of the renderers changed within one UpdateRange call, inverted with a single batched call at its end.
+		struct InverseBatch
+		{
+			std::vector<XMFLOAT4X4> Worlds;
+			std::vector<XMFLOAT4X4> Inverses;
+			std::vector<UINT> ObjCBIndices;
+		};
+
+		void RebuildLevels(ComponentPool<Transform>& transforms);
+		void UpdateRange(ComponentPool<Transform>& transforms, ComponentPool<Renderer>& renderers, const Entity* entities, size_t count,
+			PaddedObjectConstants* objectsCB, std::vector<UINT>& outChangedObjCBIndices, InverseBatch& batch) const;
+
+	private:
+		// Below this count the job of spawning workers costs more than the update itself.
+		static constexpr size_t ParallelThreshold = 2048u;
+		static constexpr UINT BatchSize = 512u;
+
+		// m_levels[d] holds the entities at depth d, roots are at depth 0.
+		std::vector<std::vector<Entity>> m_levels;
+		// Levels are rebuilt when a parent changes or transforms are added/removed.
+		bool m_isHierarchyDirty = true;
+		uint64_t m_levelledPoolVersion = UINT64_MAX;
+
+		// Scratch, per job system thread lists of changed CB indices
+		std::vector<std::vector<UINT>> m_threadChangedIndices;
+		std::vector<InverseBatch> m_threadInverseBatches;
+		std::vector<uint32_t> m_depthScratch;
+		std::vector<Entity> m_chainScratch;
+
+		uint64_t m_frame = 0u;
+	};
+}
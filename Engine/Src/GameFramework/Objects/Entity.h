@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Common/ScaldCoreDefines.h"
+
+#include <cstdint>
+
+namespace Scald
+{
+	// Lightweight handle to an entity. Index addresses component storage and is reused after the entity is destroyed,
+	// generation is bumped on every reuse, so stale handles to a destroyed entity never match a new one.
+	struct Entity
+	{
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+		uint32_t Index = InvalidIndex;
+		uint32_t Generation = 0u;
+
+		FORCEINLINE bool IsValid() const { return Index != InvalidIndex; }
+
+		FORCEINLINE bool operator==(const Entity& rhs) const { return Index == rhs.Index && Generation == rhs.Generation; }
+		FORCEINLINE bool operator!=(const Entity& rhs) const { return !(*this == rhs); }
+	};
+}
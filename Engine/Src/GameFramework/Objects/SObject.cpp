@@ -0,0 +1,29 @@
+#include "stdafx.h"
+#include "SObject.h"
+
+Scald::SObject::SObject()
+	: m_entity(ComponentManager::Get().CreateEntity())
+{
+}
+
+Scald::SObject::SObject(SObject&& rhs) noexcept
+	: m_entity(rhs.m_entity)
+{
+	rhs.m_entity = Entity();
+}
+
+Scald::SObject& Scald::SObject::operator=(SObject&& rhs) noexcept
+{
+	if (this != &rhs)
+	{
+		ComponentManager::Get().DestroyEntity(m_entity);
+		m_entity = rhs.m_entity;
+		rhs.m_entity = Entity();
+	}
+	return *this;
+}
+
+Scald::SObject::~SObject() noexcept
+{
+	ComponentManager::Get().DestroyEntity(m_entity);
+}
@@ -6,62 +6,50 @@
 
 namespace Scald
 {
-    class SComponent;
-
-    class SObject : public std::enable_shared_from_this<SObject>
+    // Owns an entity in the ComponentManager. Components are not stored here, SObject is just a handle wrapper around them.
+    class SObject
 	{
 	public:
-		SObject() = default;
-		virtual ~SObject() noexcept = default;
+		SObject();
+		SObject(const SObject& lhs) = delete;
+		SObject& operator=(const SObject& lhs) = delete;
+		SObject(SObject&& rhs) noexcept;
+		SObject& operator=(SObject&& rhs) noexcept;
+
+		virtual ~SObject() noexcept;
 	
 		virtual void OnInit() {};
         virtual void OnUpdate() {};
 		virtual void OnBegin() {};
 		virtual void OnDestroy() {};
 
+        FORCEINLINE Entity GetEntity() const { return m_entity; }
+
         template <typename T>
-        const std::vector<std::shared_ptr<T>>& GetComponents() const
+        T* GetComponent() const
         {
-            return m_components;
+            return ComponentManager::Get().GetComponent<T>(m_entity);
         }
 
         template <typename T>
-        std::vector<std::shared_ptr<T>> GetComponents() const
+        bool HasComponent() const
         {
-            std::vector<std::shared_ptr<T>> foundComps;
-
-            for (auto&& comp : m_components)
-            {
-                if (std::shared_ptr<T> castedComp = std::dynamic_pointer_cast<T>(comp))
-                {
-                    foundComps.push_back(castedComp);
-                }
-            }
-            return foundComps;
+            return ComponentManager::Get().HasComponent<T>(m_entity);
         }
 
-        template <typename T>
-        std::shared_ptr<T> GetComponent() const
+        template<typename T, typename... Args>
+        T& AddComponent(Args&&... args)
         {
-            for (auto&& comp : m_components)
-            {
-                if (std::shared_ptr<T> castedComp = std::dynamic_pointer_cast<T>(comp))
-                {
-                    return castedComp;
-                }
-            }
-            return nullptr;
+            return ComponentManager::Get().AddComponent<T>(m_entity, std::forward<Args>(args)...);
         }
 
-        template<typename T, typename... Args>
-        void AddComponent(Args&&... args)
+        template<typename T>
+        void RemoveComponent()
         {
-            auto comp = ComponentManager::Get().CreateDefaultSubobject<T>(shared_from_this(), std::forward<Args>(args)...);
-            comp->OnAttach();
-            m_components.push_back(comp);
+            ComponentManager::Get().RemoveComponent<T>(m_entity);
         }
 
 	protected:
-		std::vector<std::shared_ptr<SComponent>> m_components;
+		Entity m_entity;
 	};
-}
\ No newline at end of file
+}
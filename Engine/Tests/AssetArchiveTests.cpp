@@ -0,0 +1,281 @@
+#include "TestHarness.h"
+#include "DDSTestFiles.h"
+#include "TestData.h"
+#include "Core/AssetArchive.h"
+#include "Core/JobSystem.h"
+
+using DDSTestFiles::TempDirectory;
+using TestData::MakeCompressible;
+using TestData::MakeRandom;
+
+namespace
+{
+	constexpr UINT NumWorkers = 3u;
+	// Small chunks, so a few KB of data already spread over several chunks and jobs.
+	constexpr UINT ChunkSize = 4096u;
+
+	std::vector<uint8_t> Read(const AssetArchive& archive, const AssetArchiveEntry& entry)
+	{
+		std::unique_ptr<uint8_t[]> storage;
+		const uint8_t* pData = archive.Load(entry, storage);
+		return pData ? std::vector<uint8_t>(pData, pData + entry.Size) : std::vector<uint8_t>{};
+	}
+
+	struct TestFile
+	{
+		const char* Path;
+		std::vector<uint8_t> Data;
+		bool bIsCompressed;
+	};
+
+	std::vector<TestFile> MakeTestFiles()
+	{
+		// Half text, half noise: the chunks of the noise half do not compress and are stored raw inside a compressed entry.
+		std::vector<uint8_t> mixed = MakeCompressible(6u * ChunkSize, 3u);
+		const std::vector<uint8_t> noise = MakeRandom(5u * ChunkSize + 123u, 4u);
+		mixed.insert(mixed.end(), noise.begin(), noise.end());
+
+		return {
+			{ "Assets/Shaders/Common.hlsl", MakeCompressible(100u, 1u), true },
+			{ "Assets/Shaders/PixelShader.hlsl", MakeCompressible(20u * ChunkSize + 17u, 2u), true },
+			{ "Assets/Textures/noise.dds", MakeRandom(3u * ChunkSize, 5u), false },
+			{ "Assets/Models/mixed.bin", mixed, true },
+			{ "Assets/empty.txt", {}, false },
+		};
+	}
+
+	bool WriteArchive(const std::vector<TestFile>& files, const std::filesystem::path& fileName)
+	{
+		AssetArchiveWriter writer(ChunkSize);
+		for (const TestFile& file : files)
+		{
+			writer.AddFile(file.Path, file.Data);
+		}
+		return writer.Write(fileName);
+	}
+}
+
+SCALD_TEST(EveryFileIsFoundAndReadBack)
+{
+	JobSystem::Get().Init(NumWorkers);
+	const TempDirectory directory("ScaldAssetArchiveTests");
+
+	const std::vector<TestFile> files = MakeTestFiles();
+	CHECK(WriteArchive(files, directory / "Assets.pak"));
+
+	AssetArchive archive;
+	CHECK(archive.Open(directory / "Assets.pak"));
+	CHECK_EQ(archive.GetNumEntries(), (UINT)files.size());
+
+	for (const TestFile& file : files)
+	{
+		const AssetArchiveEntry* pEntry = archive.Find(file.Path);
+		CHECK(pEntry);
+		if (!pEntry)
+		{
+			continue;
+		}
+
+		CHECK_EQ(pEntry->Size, (UINT64)file.Data.size());
+		CHECK_EQ(pEntry->IsCompressed(), file.bIsCompressed);
+		CHECK(pEntry->StoredSize <= (file.bIsCompressed ? file.Data.size() - file.Data.size() / 8u : file.Data.size()));
+		CHECK(Read(archive, *pEntry) == file.Data);
+		CHECK(archive.GetPath(*pEntry) == AssetArchive::NormalizePath(file.Path));
+	}
+
+	// Lookups are normalized the same way as the packed paths.
+	CHECK_EQ(archive.Find("./assets/SHADERS/common.hlsl"), archive.Find("Assets/Shaders/Common.hlsl"));
+	CHECK_EQ(archive.Find("Assets/Textures/../Shaders/Common.hlsl"), archive.Find("Assets/Shaders/Common.hlsl"));
+	CHECK(!archive.Find("Assets/Shaders/Missing.hlsl"));
+	CHECK(!archive.Find("Assets/Shaders"));
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(StoredEntriesAreMappedInPlace)
+{
+	const TempDirectory directory("ScaldAssetArchiveTests");
+
+	const std::vector<TestFile> files = MakeTestFiles();
+	CHECK(WriteArchive(files, directory / "Assets.pak"));
+
+	AssetArchive archive;
+	CHECK(archive.Open(directory / "Assets.pak"));
+
+	const AssetArchiveEntry* pStored = archive.Find("Assets/Textures/noise.dds");
+	CHECK(pStored && !pStored->IsCompressed());
+	const uint8_t* pMapped = archive.GetMappedData(*pStored);
+	CHECK(pMapped);
+	// The mapping starts on a page and so does every entry, the data can go to the GPU upload as is.
+	CHECK_EQ((uintptr_t)pMapped % AssetArchive::EntryAlignment, (uintptr_t)0u);
+	CHECK(std::equal(files[2].Data.begin(), files[2].Data.end(), pMapped));
+
+	// Load hands out the mapping instead of a copy.
+	std::unique_ptr<uint8_t[]> storage;
+	CHECK_EQ(archive.Load(*pStored, storage), pMapped);
+	CHECK(!storage);
+
+	const AssetArchiveEntry* pCompressed = archive.Find("Assets/Shaders/PixelShader.hlsl");
+	CHECK(pCompressed && pCompressed->IsCompressed());
+	CHECK(!archive.GetMappedData(*pCompressed));
+	CHECK(archive.Load(*pCompressed, storage) == storage.get() && storage);
+
+	// Nothing is found once closed, opening again maps the same contents.
+	archive.Close();
+	CHECK(!archive.IsOpen());
+	CHECK(!archive.Find("Assets/Textures/noise.dds"));
+	CHECK(archive.Open(directory / "Assets.pak"));
+	CHECK(Read(archive, *archive.Find("Assets/Textures/noise.dds")) == files[2].Data);
+}
+
+SCALD_TEST(ChunksDecompressOnWorkers)
+{
+	JobSystem::Get().Init(NumWorkers);
+	const TempDirectory directory("ScaldAssetArchiveTests");
+
+	const std::vector<TestFile> files = MakeTestFiles();
+	CHECK(WriteArchive(files, directory / "Assets.pak"));
+
+	AssetArchive archive;
+	CHECK(archive.Open(directory / "Assets.pak"));
+
+	const AssetArchiveEntry* pEntry = archive.Find("Assets/Models/mixed.bin");
+	CHECK(pEntry && pEntry->IsCompressed());
+	CHECK_EQ(pEntry->NumChunks, 12u);
+
+	// Concurrent reads of the same entry, each decompressing its chunks in parallel.
+	constexpr UINT NumReads = 16u;
+	std::vector<std::vector<uint8_t>> reads(NumReads);
+	JobCounter counter;
+	for (UINT i = 0; i < NumReads; ++i)
+	{
+		JobSystem::Get().Run([&, i]() { reads[i] = Read(archive, *pEntry); }, &counter);
+	}
+	JobSystem::Get().Wait(counter);
+
+	UINT numWrong = 0u;
+	for (const std::vector<uint8_t>& read : reads)
+	{
+		numWrong += read == files[3].Data ? 0u : 1u;
+	}
+	CHECK_EQ(numWrong, 0u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(LastAddedDuplicateIsKept)
+{
+	const TempDirectory directory("ScaldAssetArchiveTests");
+
+	AssetArchiveWriter writer(ChunkSize);
+	writer.AddFile("Assets/Textures/stone.dds", MakeRandom(100u, 1u));
+	writer.AddFile("Assets/Textures/bricks.dds", MakeRandom(100u, 2u));
+	writer.AddFile("./assets/textures/STONE.dds", MakeRandom(200u, 3u));
+	CHECK(writer.Write(directory / "Assets.pak"));
+
+	AssetArchive archive;
+	CHECK(archive.Open(directory / "Assets.pak"));
+	CHECK_EQ(archive.GetNumEntries(), 2u);
+
+	const AssetArchiveEntry* pEntry = archive.Find("Assets/Textures/stone.dds");
+	CHECK(pEntry && Read(archive, *pEntry) == MakeRandom(200u, 3u));
+}
+
+SCALD_TEST(PackedDirectoryKeepsRelativePaths)
+{
+	JobSystem::Get().Init(NumWorkers);
+	const TempDirectory directory("ScaldAssetArchiveTests");
+
+	// Packed from the working directory, like the engine references the files.
+	const std::filesystem::path workingDirectory = std::filesystem::current_path();
+	std::filesystem::current_path(directory / "");
+
+	std::filesystem::create_directories("Assets/Shaders");
+	std::filesystem::create_directories("Assets/Textures");
+	const std::vector<uint8_t> shader = MakeCompressible(5000u, 1u);
+	const std::vector<uint8_t> texture = MakeRandom(5000u, 2u);
+	CHECK(DDSTestFiles::Write("Assets/Shaders/Sky.hlsl", shader));
+	CHECK(DDSTestFiles::Write("Assets/Textures/ice.dds", texture));
+
+	CHECK(AssetArchiveWriter::PackDirectory("./Assets", "Assets.pak"));
+	CHECK(!AssetArchiveWriter::PackDirectory("./Missing", "Missing.pak"));
+
+	AssetArchive archive;
+	CHECK(archive.Open("Assets.pak"));
+	CHECK_EQ(archive.GetNumEntries(), 2u);
+	const AssetArchiveEntry* pShader = archive.Find(L"./Assets/Shaders/Sky.hlsl");
+	const AssetArchiveEntry* pTexture = archive.Find(L"./Assets/Textures/ice.dds");
+	CHECK(pShader && Read(archive, *pShader) == shader);
+	CHECK(pTexture && Read(archive, *pTexture) == texture);
+
+	archive.Close();
+	std::filesystem::current_path(workingDirectory);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(MalformedArchivesAreRejected)
+{
+	const TempDirectory directory("ScaldAssetArchiveTests");
+
+	AssetArchive archive;
+	CHECK(!archive.Open(directory / "Missing.pak"));
+	CHECK(!archive.IsOpen());
+
+	const std::vector<TestFile> files = MakeTestFiles();
+	CHECK(WriteArchive(files, directory / "Assets.pak"));
+
+	std::vector<uint8_t> contents;
+	{
+		std::ifstream file(directory / "Assets.pak", std::ios::binary);
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	AssetArchiveHeader header;
+	std::memcpy(&header, contents.data(), sizeof(header));
+
+	auto OpensWith = [&](const std::vector<uint8_t>& corrupt)
+		{
+			CHECK(DDSTestFiles::Write(directory / "Corrupt.pak", corrupt));
+			const bool bIsOpen = archive.Open(directory / "Corrupt.pak");
+			archive.Close();
+			return bIsOpen;
+		};
+
+	CHECK(OpensWith(contents));
+	CHECK(!OpensWith({}));
+	CHECK(!OpensWith(std::vector<uint8_t>(contents.begin(), contents.begin() + sizeof(AssetArchiveHeader) - 1u)));
+
+	std::vector<uint8_t> badMagic = contents;
+	badMagic[0] ^= 0xFFu;
+	CHECK(!OpensWith(badMagic));
+
+	std::vector<uint8_t> badVersion = contents;
+	reinterpret_cast<AssetArchiveHeader*>(badVersion.data())->Version = AssetArchiveHeader::CurrentVersion + 1u;
+	CHECK(!OpensWith(badVersion));
+
+	// Cut into the path table.
+	CHECK(!OpensWith(std::vector<uint8_t>(contents.begin(), contents.end() - 1u)));
+
+	// Entries out of hash order would break the binary search.
+	std::vector<uint8_t> unsorted = contents;
+	auto* pEntries = reinterpret_cast<AssetArchiveEntry*>(unsorted.data() + header.TocOffset);
+	std::swap(pEntries[0], pEntries[header.NumEntries - 1u]);
+	CHECK(!OpensWith(unsorted));
+
+	// A chunk size table pointing past the entry opens, but reading it fails.
+	CHECK(archive.Open(directory / "Assets.pak"));
+	const AssetArchiveEntry entry = *archive.Find("Assets/Shaders/PixelShader.hlsl");
+	archive.Close();
+
+	std::vector<uint8_t> badChunk = contents;
+	auto* pChunkSizes = reinterpret_cast<UINT32*>(badChunk.data() + entry.Offset);
+	pChunkSizes[0] = (UINT32)entry.StoredSize;
+	CHECK(DDSTestFiles::Write(directory / "Corrupt.pak", badChunk));
+	CHECK(archive.Open(directory / "Corrupt.pak"));
+
+	std::unique_ptr<uint8_t[]> storage;
+	CHECK(!archive.Load(*archive.Find("Assets/Shaders/PixelShader.hlsl"), storage));
+	CHECK(!storage);
+	// The other entries are still fine.
+	CHECK(Read(archive, *archive.Find("Assets/Shaders/Common.hlsl")) == files[0].Data);
+}
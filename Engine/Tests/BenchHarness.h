@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Benchmarks are plain executables (not run by ctest), build them in Release.
+namespace ScaldBench
+{
+	// Best of numRuns wall times of func, in milliseconds.
+	template<typename Func>
+	double Measure(int numRuns, Func&& func)
+	{
+		double best = 1e30;
+		for (int run = 0; run < numRuns; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			func();
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	inline void Report(const char* name, double milliseconds)
+	{
+		std::printf("%-48s %10.3f ms\n", name, milliseconds);
+	}
+
+	// Keeps the optimizer from dropping results that are otherwise unused.
+	template<typename T>
+	void DoNotOptimize(const T& value)
+	{
+#if defined(_MSC_VER)
+		const volatile char sink = *reinterpret_cast<const volatile char*>(&value);
+		(void)sink;
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+}
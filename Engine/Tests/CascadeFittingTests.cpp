@@ -0,0 +1,161 @@
+#include "TestHarness.h"
+#include "Core/CascadeFitting.h"
+
+namespace
+{
+	static constexpr UINT MapSize = 2048u;
+	static constexpr float TanHalfFovY = 0.41421356f; // 45 degrees vertical FOV
+	static constexpr float AspectRatio = 16.0f / 9.0f;
+
+	struct Slice
+	{
+		float NearZ;
+		float FarZ;
+	};
+	static constexpr Slice Slices[] = { { 1.0f, 12.0f }, { 12.0f, 45.0f }, { 45.0f, 160.0f } };
+
+	XMVECTOR GetLightDir()
+	{
+		return XMVector3Normalize(XMVectorSet(0.3f, -1.0f, 0.6f, 0.0f));
+	}
+
+	XMMATRIX MakeInvView(FXMVECTOR position, FXMVECTOR forward)
+	{
+		const XMMATRIX view = XMMatrixLookToLH(position, forward, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		return XMMatrixInverse(nullptr, view);
+	}
+
+	CascadeFit FitSlice(const Slice& slice, FXMMATRIX invView)
+	{
+		return CascadeFitting::Fit(invView, GetLightDir(), TanHalfFovY, AspectRatio, slice.NearZ, slice.FarZ, MapSize, MapSize);
+	}
+
+	// Shadow map texel coordinates of a world point
+	XMFLOAT2 ToTexels(const CascadeFit& fit, FXMVECTOR worldPoint)
+	{
+		const XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&fit.View), XMLoadFloat4x4(&fit.Proj));
+		const XMVECTOR ndc = XMVector3TransformCoord(worldPoint, viewProj);
+		return XMFLOAT2(XMVectorGetX(ndc) * 0.5f * MapSize, XMVectorGetY(ndc) * 0.5f * MapSize);
+	}
+
+	// World points the texel grid is checked at, spread over the slices.
+	const XMFLOAT3 ProbePoints[] = { { 0.0f, 0.0f, 0.0f }, { 3.7f, 0.25f, 8.1f }, { -21.3f, 4.0f, 30.6f }, { 55.5f, -2.0f, 97.25f } };
+}
+
+SCALD_TEST(ProjectionSizeDoesNotDependOnCameraPose)
+{
+	const XMMATRIX poses[] = {
+		MakeInvView(XMVectorSet(0.0f, 2.0f, -5.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f)),
+		MakeInvView(XMVectorSet(13.1f, 2.7f, 4.2f, 1.0f), XMVectorSet(0.7f, -0.2f, 0.3f, 0.0f)),
+		MakeInvView(XMVectorSet(-40.0f, 9.0f, 71.0f, 1.0f), XMVectorSet(-0.4f, 0.1f, -0.9f, 0.0f)),
+	};
+
+	for (const Slice& slice : Slices)
+	{
+		const float radius = FitSlice(slice, poses[0]).Radius;
+		for (const XMMATRIX& invView : poses)
+		{
+			CHECK_EQ(FitSlice(slice, invView).Radius, radius);
+		}
+	}
+}
+
+SCALD_TEST(CascadeCoversFrustumSlice)
+{
+	const XMMATRIX invView = MakeInvView(XMVectorSet(6.0f, 3.0f, -2.0f, 1.0f), XMVectorSet(0.5f, -0.1f, 1.0f, 0.0f));
+
+	for (const Slice& slice : Slices)
+	{
+		const CascadeFit fit = FitSlice(slice, invView);
+		const XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&fit.View), XMLoadFloat4x4(&fit.Proj));
+
+		// Snapping moves the projection by less than a texel, which the radius rounding doesn't have to absorb.
+		const float texelNdc = 2.0f / MapSize;
+		for (float z : { slice.NearZ, slice.FarZ })
+		{
+			for (UINT corner = 0; corner < 4u; ++corner)
+			{
+				const float x = ((corner & 1u) ? 1.0f : -1.0f) * z * TanHalfFovY * AspectRatio;
+				const float y = ((corner & 2u) ? 1.0f : -1.0f) * z * TanHalfFovY;
+				const XMVECTOR world = XMVector3TransformCoord(XMVectorSet(x, y, z, 1.0f), invView);
+
+				XMFLOAT3 ndc;
+				XMStoreFloat3(&ndc, XMVector3TransformCoord(world, viewProj));
+				CHECK(fabsf(ndc.x) <= 1.0f + texelNdc);
+				CHECK(fabsf(ndc.y) <= 1.0f + texelNdc);
+				CHECK(ndc.z >= 0.0f && ndc.z <= 1.0f);
+			}
+		}
+	}
+}
+
+SCALD_TEST(SubTexelCameraTranslationKeepsTexelGrid)
+{
+	const XMVECTOR basePosition = XMVectorSet(4.0f, 2.0f, -3.0f, 1.0f);
+	const XMVECTOR forward = XMVectorSet(0.2f, -0.1f, 1.0f, 0.0f);
+
+	for (const Slice& slice : Slices)
+	{
+		const CascadeFit baseFit = FitSlice(slice, MakeInvView(basePosition, forward));
+		const float texelSize = 2.0f * baseFit.Radius / MapSize;
+
+		XMFLOAT2 baseTexels[std::size(ProbePoints)];
+		for (UINT p = 0; p < (UINT)std::size(ProbePoints); ++p)
+		{
+			baseTexels[p] = ToTexels(baseFit, XMLoadFloat3(&ProbePoints[p]));
+		}
+
+		// Camera drifts by fractions of a texel along every axis, like a slowly walking player.
+		for (UINT step = 1; step <= 24u; ++step)
+		{
+			const float t = 0.037f * step * texelSize;
+			const XMVECTOR position = XMVectorAdd(basePosition, XMVectorSet(t, -0.5f * t, 0.75f * t, 0.0f));
+			const CascadeFit fit = FitSlice(slice, MakeInvView(position, forward));
+
+			CHECK_EQ(fit.Radius, baseFit.Radius);
+
+			for (UINT p = 0; p < (UINT)std::size(ProbePoints); ++p)
+			{
+				// A world point stays at the same spot within its texel, the grid only ever moves by whole texels...
+				const XMFLOAT2 texels = ToTexels(fit, XMLoadFloat3(&ProbePoints[p]));
+				const float shiftX = texels.x - baseTexels[p].x;
+				const float shiftY = texels.y - baseTexels[p].y;
+				CHECK_NEAR(shiftX, roundf(shiftX), 0.02f);
+				CHECK_NEAR(shiftY, roundf(shiftY), 0.02f);
+
+				// ...and a camera move under a texel shifts it by at most one.
+				CHECK(fabsf(shiftX) <= 1.02f);
+				CHECK(fabsf(shiftY) <= 1.02f);
+			}
+		}
+	}
+}
+
+SCALD_TEST(LightSpaceBoundsMoveInWholeTexels)
+{
+	const XMVECTOR forward = XMVectorSet(-0.3f, 0.0f, 1.0f, 0.0f);
+	const Slice& slice = Slices[1];
+
+	const CascadeFit baseFit = FitSlice(slice, MakeInvView(XMVectorZero(), forward));
+	const float texelSize = 2.0f * baseFit.Radius / MapSize;
+
+	const XMMATRIX baseViewProj = XMMatrixMultiply(XMLoadFloat4x4(&baseFit.View), XMLoadFloat4x4(&baseFit.Proj));
+
+	// Larger moves, including whole and fractional multiples of a texel.
+	for (float texels : { 0.5f, 1.0f, 3.25f, 17.8f, 140.1f })
+	{
+		const XMVECTOR position = XMVectorSet(texels * texelSize, 0.0f, 0.3f * texels * texelSize, 1.0f);
+		const CascadeFit fit = FitSlice(slice, MakeInvView(position, forward));
+		const XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&fit.View), XMLoadFloat4x4(&fit.Proj));
+
+		// Corner of the new light space window, expressed in texels of the old one.
+		const XMVECTOR windowCorner = XMVector3TransformCoord(XMVectorSet(-1.0f, -1.0f, 0.5f, 1.0f), XMMatrixInverse(nullptr, viewProj));
+		XMFLOAT3 oldNdc;
+		XMStoreFloat3(&oldNdc, XMVector3TransformCoord(windowCorner, baseViewProj));
+
+		const float cornerX = (oldNdc.x + 1.0f) * 0.5f * MapSize;
+		const float cornerY = (oldNdc.y + 1.0f) * 0.5f * MapSize;
+		CHECK_NEAR(cornerX, roundf(cornerX), 0.05f);
+		CHECK_NEAR(cornerY, roundf(cornerY), 0.05f);
+	}
+}
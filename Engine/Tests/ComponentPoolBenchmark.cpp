@@ -0,0 +1,110 @@
+#include "BenchHarness.h"
+#include "GameFramework/Components/ComponentManager.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace Scald;
+
+namespace
+{
+	struct Position
+	{
+		float X = 0.0f, Y = 0.0f, Z = 0.0f;
+	};
+
+	struct Velocity
+	{
+		float X = 0.0f, Y = 0.0f, Z = 0.0f;
+	};
+
+	// Per entity heap allocated components, as the engine stored them before the sparse sets.
+	struct SharedEntity
+	{
+		std::shared_ptr<Position> Pos;
+		std::shared_ptr<Velocity> Vel;
+	};
+}
+
+int main()
+{
+	static constexpr UINT NumEntities = 1000000u;
+	static constexpr float DeltaTime = 1.0f / 60.0f;
+
+	ComponentManager& manager = ComponentManager::Get();
+	std::vector<Entity> entities(NumEntities);
+
+	ScaldBench::Report("create 1M entities with 2 components", ScaldBench::Measure(1, [&]()
+		{
+			for (UINT i = 0; i < NumEntities; ++i)
+			{
+				entities[i] = manager.CreateEntity();
+				manager.AddComponent<Position>(entities[i], Position{ (float)i, 0.0f, 0.0f });
+				// Every other one moves, so the joined walk has to skip.
+				if (i % 2u == 0u)
+				{
+					manager.AddComponent<Velocity>(entities[i], Velocity{ 1.0f, 2.0f, 3.0f });
+				}
+			}
+		}));
+
+	ScaldBench::Report("iterate 1M positions", ScaldBench::Measure(10, [&]()
+		{
+			float sum = 0.0f;
+			manager.Each<Position>([&sum](Entity, Position& position) { sum += position.X; });
+			ScaldBench::DoNotOptimize(sum);
+		}));
+
+	ScaldBench::Report("integrate 500k velocity x position", ScaldBench::Measure(10, [&]()
+		{
+			manager.Each<Velocity, Position>([](Entity, Velocity& velocity, Position& position)
+				{
+					position.X += velocity.X * DeltaTime;
+					position.Y += velocity.Y * DeltaTime;
+					position.Z += velocity.Z * DeltaTime;
+				});
+		}));
+
+	std::vector<SharedEntity> sharedEntities(NumEntities);
+	for (UINT i = 0; i < NumEntities; ++i)
+	{
+		sharedEntities[i].Pos = std::make_shared<Position>(Position{ (float)i, 0.0f, 0.0f });
+		if (i % 2u == 0u)
+		{
+			sharedEntities[i].Vel = std::make_shared<Velocity>(Velocity{ 1.0f, 2.0f, 3.0f });
+		}
+	}
+
+	ScaldBench::Report("integrate 500k, shared_ptr components", ScaldBench::Measure(10, [&]()
+		{
+			for (SharedEntity& entity : sharedEntities)
+			{
+				if (entity.Vel)
+				{
+					entity.Pos->X += entity.Vel->X * DeltaTime;
+					entity.Pos->Y += entity.Vel->Y * DeltaTime;
+					entity.Pos->Z += entity.Vel->Z * DeltaTime;
+				}
+			}
+		}));
+
+	std::mt19937 rng(1u);
+	std::shuffle(entities.begin(), entities.end(), rng);
+
+	ScaldBench::Report("destroy 100k random entities", ScaldBench::Measure(1, [&]()
+		{
+			for (UINT i = 0; i < NumEntities / 10u; ++i)
+			{
+				manager.DestroyEntity(entities[i]);
+			}
+		}));
+
+	ScaldBench::Report("iterate 900k positions after removals", ScaldBench::Measure(10, [&]()
+		{
+			float sum = 0.0f;
+			manager.Each<Position>([&sum](Entity, Position& position) { sum += position.X; });
+			ScaldBench::DoNotOptimize(sum);
+		}));
+
+	return manager.GetPool<Position>().Size() == NumEntities - NumEntities / 10u ? 0 : 1;
+}
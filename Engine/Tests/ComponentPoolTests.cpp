@@ -0,0 +1,227 @@
+#include "TestHarness.h"
+#include "GameFramework/Components/ComponentManager.h"
+
+#include <map>
+#include <random>
+
+using namespace Scald;
+
+namespace
+{
+	// Component types of this file only, so the tests don't see each other's pools.
+	struct Health
+	{
+		int Value = 0;
+	};
+
+	struct Armor
+	{
+		int Value = 0;
+	};
+
+	struct Tag
+	{
+		uint32_t Id = 0u;
+	};
+
+	struct Probe
+	{
+		uint32_t Id = 0u;
+	};
+}
+
+SCALD_TEST(AddGetRemove)
+{
+	ComponentManager& manager = ComponentManager::Get();
+	const Entity entity = manager.CreateEntity();
+
+	CHECK(!manager.HasComponent<Health>(entity));
+	CHECK(manager.GetComponent<Health>(entity) == nullptr);
+
+	manager.AddComponent<Health>(entity, Health{ 10 });
+	CHECK(manager.HasComponent<Health>(entity));
+	CHECK_EQ(manager.GetComponent<Health>(entity)->Value, 10);
+
+	manager.RemoveComponent<Health>(entity);
+	CHECK(!manager.HasComponent<Health>(entity));
+	CHECK_EQ(manager.GetPool<Health>().Size(), 0u);
+
+	// Removing a missing component is a no-op.
+	manager.RemoveComponent<Health>(entity);
+	manager.DestroyEntity(entity);
+}
+
+SCALD_TEST(StaleHandleDoesNotSeeReusedIndex)
+{
+	ComponentManager& manager = ComponentManager::Get();
+	const Entity old = manager.CreateEntity();
+	manager.AddComponent<Health>(old, Health{ 1 });
+	manager.DestroyEntity(old);
+
+	CHECK(!manager.IsAlive(old));
+	CHECK(!manager.HasComponent<Health>(old));
+
+	// The index is recycled with a new generation.
+	const Entity reused = manager.CreateEntity();
+	CHECK_EQ(reused.Index, old.Index);
+	CHECK(reused.Generation != old.Generation);
+	manager.AddComponent<Health>(reused, Health{ 2 });
+
+	CHECK(manager.IsAlive(reused));
+	CHECK(!manager.IsAlive(old));
+	CHECK(!manager.HasComponent<Health>(old));
+	CHECK(manager.GetComponent<Health>(old) == nullptr);
+	CHECK_EQ(manager.GetComponent<Health>(reused)->Value, 2);
+
+	// Destroying through the stale handle must not touch the new entity.
+	manager.DestroyEntity(old);
+	CHECK(manager.IsAlive(reused));
+	CHECK_EQ(manager.GetComponent<Health>(reused)->Value, 2);
+
+	manager.DestroyEntity(reused);
+}
+
+SCALD_TEST(DestroyEntityRemovesAllComponents)
+{
+	ComponentManager& manager = ComponentManager::Get();
+	const Entity entity = manager.CreateEntity();
+	manager.AddComponent<Health>(entity, Health{ 5 });
+	manager.AddComponent<Armor>(entity, Armor{ 7 });
+
+	manager.DestroyEntity(entity);
+	CHECK_EQ(manager.GetPool<Health>().Size(), 0u);
+	CHECK_EQ(manager.GetPool<Armor>().Size(), 0u);
+}
+
+SCALD_TEST(SwapRemoveKeepsDenseArraysPacked)
+{
+	ComponentPool<Tag> pool;
+	Entity entities[5];
+	for (uint32_t i = 0; i < 5u; ++i)
+	{
+		entities[i] = Entity{ i * 3u, 0u };
+		pool.Add(entities[i], Tag{ i });
+	}
+
+	const uint64_t version = pool.GetVersion();
+	pool.Remove(entities[1]);
+	CHECK(pool.GetVersion() > version);
+
+	// The last one fills the hole.
+	CHECK_EQ(pool.Size(), 4u);
+	CHECK(pool.GetEntities()[1] == entities[4]);
+	CHECK_EQ(pool.GetComponents()[1].Id, 4u);
+
+	for (uint32_t i = 0; i < 5u; ++i)
+	{
+		CHECK_EQ(pool.Has(entities[i]), i != 1u);
+		if (i != 1u)
+		{
+			CHECK_EQ(pool.GetUnchecked(entities[i]).Id, i);
+		}
+	}
+
+	// Removing the last one doesn't move anything.
+	pool.Remove(entities[3]);
+	CHECK_EQ(pool.Size(), 3u);
+	CHECK(pool.GetEntities()[2] == entities[2]);
+}
+
+SCALD_TEST(EachMatchesReferenceModelAfterRandomChurn)
+{
+	ComponentManager& manager = ComponentManager::Get();
+	std::mt19937 rng(5u);
+
+	// Expected components of live entities, keyed by index.
+	std::map<uint32_t, std::pair<Entity, uint32_t>> probes;
+	std::map<uint32_t, int> healths;
+	std::vector<Entity> alive;
+	uint32_t nextId = 0u;
+
+	for (UINT step = 0; step < 20000u; ++step)
+	{
+		const UINT action = rng() % 10u;
+		if (action < 5u || alive.empty())
+		{
+			const Entity entity = manager.CreateEntity();
+			manager.AddComponent<Probe>(entity, Probe{ nextId });
+			probes[entity.Index] = { entity, nextId++ };
+			if (rng() % 2u)
+			{
+				manager.AddComponent<Health>(entity, Health{ (int)entity.Index });
+				healths[entity.Index] = (int)entity.Index;
+			}
+			alive.push_back(entity);
+		}
+		else if (action < 8u)
+		{
+			const size_t victim = rng() % alive.size();
+			const Entity entity = alive[victim];
+			manager.DestroyEntity(entity);
+			probes.erase(entity.Index);
+			healths.erase(entity.Index);
+			alive[victim] = alive.back();
+			alive.pop_back();
+		}
+		else
+		{
+			const Entity entity = alive[rng() % alive.size()];
+			manager.RemoveComponent<Health>(entity);
+			healths.erase(entity.Index);
+		}
+	}
+
+	// Single pool walk visits every live component once, with the right data.
+	std::map<uint32_t, uint32_t> visited;
+	manager.Each<Probe>([&](Entity entity, Probe& probe)
+		{
+			CHECK(manager.IsAlive(entity));
+			CHECK(visited.count(entity.Index) == 0u);
+			visited[entity.Index] = probe.Id;
+		});
+	CHECK_EQ(visited.size(), probes.size());
+	for (const auto& [index, expected] : probes)
+	{
+		CHECK(visited.count(index) == 1u && visited[index] == expected.second);
+	}
+
+	// Joined walk visits exactly the entities having both.
+	size_t numJoined = 0u;
+	manager.Each<Health, Probe>([&](Entity entity, Health& health, Probe& probe)
+		{
+			CHECK(healths.count(entity.Index) == 1u);
+			CHECK_EQ(health.Value, (int)entity.Index);
+			CHECK_EQ(probe.Id, probes[entity.Index].second);
+			++numJoined;
+		});
+	CHECK_EQ(numJoined, healths.size());
+
+	for (const Entity& entity : alive)
+	{
+		manager.DestroyEntity(entity);
+	}
+	CHECK_EQ(manager.GetPool<Probe>().Size(), 0u);
+	CHECK_EQ(manager.GetPool<Health>().Size(), 0u);
+}
+
+SCALD_TEST(IterationOrderIsStableWithoutChanges)
+{
+	ComponentPool<Tag> pool;
+	for (uint32_t i = 0; i < 100u; ++i)
+	{
+		pool.Add(Entity{ 99u - i, 0u }, Tag{ i });
+	}
+	pool.Remove(Entity{ 50u, 0u });
+
+	const std::vector<Entity> order = pool.GetEntities();
+	const uint64_t version = pool.GetVersion();
+
+	// Lookups and in-place writes don't reorder anything or bump the version.
+	for (const Entity& entity : order)
+	{
+		pool.GetUnchecked(entity).Id += 1000u;
+		CHECK(pool.Get(entity) != nullptr);
+	}
+	CHECK(pool.GetEntities() == order);
+	CHECK_EQ(pool.GetVersion(), version);
+}
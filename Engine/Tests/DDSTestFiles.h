@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Common/DDS.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// Builds DDS files for the texture loading tests. Sizes are computed here independently of the loader,
+// and every byte of pixel data is distinct (mod 251), so a subresource pointing to the wrong place is noticed.
+namespace DDSTestFiles
+{
+	struct Desc
+	{
+		UINT Width = 1u;
+		UINT Height = 1u;
+		// Volume texture, if above 1
+		UINT Depth = 1u;
+		// 0 is written as is, the loader reads it as 1
+		UINT MipCount = 1u;
+		UINT ArraySize = 1u;
+		DXGI_FORMAT Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		bool bIsCubeMap = false;
+		// Legacy headers only know R8G8B8A8_UNORM (as RGB masks), BC1 and BC3 (as FourCC).
+		bool bUseDX10Header = true;
+		UINT AlphaMode = 0u;
+	};
+
+	struct SurfaceSize
+	{
+		size_t RowPitch;
+		size_t SlicePitch;
+	};
+
+	inline SurfaceSize GetSurfaceSize(DXGI_FORMAT format, size_t width, size_t height)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+		{
+			const size_t blockSize = (format == DXGI_FORMAT_BC1_UNORM || format == DXGI_FORMAT_BC1_UNORM_SRGB) ? 8u : 16u;
+			const size_t rowPitch = ((width + 3u) / 4u) * blockSize;
+			return { rowPitch, rowPitch * ((height + 3u) / 4u) };
+		}
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			return { width * 8u, width * height * 8u };
+		default:
+			return { width * 4u, width * height * 4u };
+		}
+	}
+
+	inline size_t MipExtent(size_t extent, size_t mip)
+	{
+		return std::max<size_t>(extent >> mip, 1u);
+	}
+
+	// Bytes of pixel data of the whole file: array slices, each with its mip chain, each mip with its depth slices.
+	inline size_t GetPixelDataSize(const Desc& desc)
+	{
+		const size_t numSlices = desc.ArraySize * (desc.bIsCubeMap ? 6u : 1u);
+		size_t size = 0u;
+		for (size_t mip = 0; mip < std::max(desc.MipCount, 1u); ++mip)
+		{
+			size += GetSurfaceSize(desc.Format, MipExtent(desc.Width, mip), MipExtent(desc.Height, mip)).SlicePitch * MipExtent(desc.Depth, mip);
+		}
+		return size * numSlices;
+	}
+
+	constexpr size_t LegacyHeaderSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+	constexpr size_t DX10HeaderSize = LegacyHeaderSize + sizeof(DDS_HEADER_DXT10);
+
+	inline std::vector<uint8_t> Make(const Desc& desc)
+	{
+		DDS_HEADER header = {};
+		header.size = sizeof(DDS_HEADER);
+		header.flags = DDS_HEIGHT | DDS_WIDTH | (desc.Depth > 1u ? DDS_HEADER_FLAGS_VOLUME : 0u);
+		header.width = desc.Width;
+		header.height = desc.Height;
+		header.depth = desc.Depth;
+		header.mipMapCount = desc.MipCount;
+		header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+
+		DDS_HEADER_DXT10 header10 = {};
+		if (desc.bUseDX10Header)
+		{
+			header.ddspf.flags = DDS_FOURCC;
+			header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+			header10.dxgiFormat = desc.Format;
+			header10.resourceDimension = desc.Depth > 1u ? DDS_DIMENSION_TEXTURE3D : DDS_DIMENSION_TEXTURE2D;
+			header10.miscFlag = desc.bIsCubeMap ? (uint32_t)DDS_RESOURCE_MISC_TEXTURECUBE : 0u;
+			header10.arraySize = desc.ArraySize;
+			header10.miscFlags2 = desc.AlphaMode;
+		}
+		else if (desc.Format == DXGI_FORMAT_BC1_UNORM || desc.Format == DXGI_FORMAT_BC3_UNORM)
+		{
+			header.ddspf.flags = DDS_FOURCC;
+			header.ddspf.fourCC = desc.Format == DXGI_FORMAT_BC1_UNORM ? MAKEFOURCC('D', 'X', 'T', '1') : MAKEFOURCC('D', 'X', 'T', '5');
+		}
+		else
+		{
+			header.ddspf.flags = DDS_RGB;
+			header.ddspf.RGBBitCount = 32u;
+			header.ddspf.RBitMask = 0x000000ff;
+			header.ddspf.GBitMask = 0x0000ff00;
+			header.ddspf.BBitMask = 0x00ff0000;
+			header.ddspf.ABitMask = 0xff000000;
+		}
+		if (!desc.bUseDX10Header && desc.bIsCubeMap)
+		{
+			header.caps2 = DDS_CUBEMAP_ALLFACES;
+		}
+
+		const size_t headerSize = desc.bUseDX10Header ? DX10HeaderSize : LegacyHeaderSize;
+		std::vector<uint8_t> file(headerSize + GetPixelDataSize(desc));
+		std::memcpy(file.data(), &DDS_MAGIC, sizeof(uint32_t));
+		std::memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+		if (desc.bUseDX10Header)
+		{
+			std::memcpy(file.data() + LegacyHeaderSize, &header10, sizeof(header10));
+		}
+		for (size_t i = headerSize; i < file.size(); ++i)
+		{
+			file[i] = (uint8_t)((i - headerSize) % 251u);
+		}
+		return file;
+	}
+
+	inline bool Write(const std::filesystem::path& path, const std::vector<uint8_t>& file)
+	{
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(file.data()), (std::streamsize)file.size());
+		return (bool)stream;
+	}
+
+	// Fresh directory under the system temp directory, removed with the object.
+	class TempDirectory
+	{
+	public:
+		explicit TempDirectory(const char* name)
+			: m_path(std::filesystem::temp_directory_path() / name)
+		{
+			std::filesystem::remove_all(m_path);
+			std::filesystem::create_directories(m_path);
+		}
+		TempDirectory(const TempDirectory& lhs) = delete;
+		TempDirectory& operator=(const TempDirectory& lhs) = delete;
+
+		~TempDirectory()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(m_path, error);
+		}
+
+		std::filesystem::path operator/(const char* fileName) const { return m_path / fileName; }
+
+	private:
+		std::filesystem::path m_path;
+	};
+}
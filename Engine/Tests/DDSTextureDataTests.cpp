@@ -0,0 +1,324 @@
+#include "TestHarness.h"
+#include "DDSTestFiles.h"
+#include "Common/DDSTextureData.h"
+
+#include <climits>
+#include <cstddef>
+
+using namespace DirectX;
+using namespace DDSTestFiles;
+
+namespace
+{
+	struct ExpectedSubresource
+	{
+		size_t Offset;
+		size_t RowPitch;
+		size_t SlicePitch;
+	};
+
+	// Where the subresources of desc are in its file, slice-major like the loader lays them out. Mips above maxsize are left out.
+	std::vector<ExpectedSubresource> ExpectedLayout(const Desc& desc, size_t maxsize = 0u)
+	{
+		std::vector<ExpectedSubresource> layout;
+		size_t offset = desc.bUseDX10Header ? DX10HeaderSize : LegacyHeaderSize;
+		const size_t numSlices = desc.ArraySize * (desc.bIsCubeMap ? 6u : 1u);
+		for (size_t slice = 0; slice < numSlices; ++slice)
+		{
+			for (size_t mip = 0; mip < std::max(desc.MipCount, 1u); ++mip)
+			{
+				const size_t width = MipExtent(desc.Width, mip);
+				const size_t height = MipExtent(desc.Height, mip);
+				const size_t depth = MipExtent(desc.Depth, mip);
+				const SurfaceSize size = GetSurfaceSize(desc.Format, width, height);
+				if (!maxsize || (width <= maxsize && height <= maxsize && depth <= maxsize))
+				{
+					layout.push_back({ offset, size.RowPitch, size.SlicePitch });
+				}
+				offset += size.SlicePitch * depth;
+			}
+		}
+		return layout;
+	}
+
+	// Counts the subresources that differ from the expected layout.
+	UINT CountLayoutMismatches(const std::vector<uint8_t>& file, const DDSTextureData& data, const std::vector<ExpectedSubresource>& expected)
+	{
+		if (data.Subresources.size() != expected.size())
+		{
+			return UINT_MAX;
+		}
+
+		UINT numWrong = 0u;
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			const D3D12_SUBRESOURCE_DATA& subresource = data.Subresources[i];
+			numWrong += (static_cast<const uint8_t*>(subresource.pData) == file.data() + expected[i].Offset &&
+				(size_t)subresource.RowPitch == expected[i].RowPitch && (size_t)subresource.SlicePitch == expected[i].SlicePitch) ? 0u : 1u;
+		}
+		return numWrong;
+	}
+
+	HRESULT Parse(const std::vector<uint8_t>& file, DDSTextureData& outData, size_t maxsize = 0u)
+	{
+		return LoadDDSTextureDataFromMemory(file.data(), file.size(), outData, maxsize);
+	}
+}
+
+SCALD_TEST(LegacyHeaderRGBA8MipChain)
+{
+	Desc desc;
+	desc.Width = 64u;
+	desc.Height = 32u;
+	desc.MipCount = 7u;
+	desc.bUseDX10Header = false;
+	const std::vector<uint8_t> file = Make(desc);
+
+	DDSTextureData data;
+	CHECK_EQ(Parse(file, data), S_OK);
+	CHECK_EQ(data.Format, DXGI_FORMAT_R8G8B8A8_UNORM);
+	CHECK_EQ(data.Dimension, D3D12_RESOURCE_DIMENSION_TEXTURE2D);
+	CHECK_EQ(data.Width, 64u);
+	CHECK_EQ(data.Height, 32u);
+	CHECK_EQ(data.Depth, 1u);
+	CHECK_EQ(data.MipCount, 7u);
+	CHECK_EQ(data.ArraySize, 1u);
+	CHECK(!data.IsCubeMap);
+	CHECK_EQ(data.AlphaMode, DDS_ALPHA_MODE_UNKNOWN);
+	// Parsed in place
+	CHECK(!data.FileData);
+	CHECK_EQ(CountLayoutMismatches(file, data, ExpectedLayout(desc)), 0u);
+}
+
+SCALD_TEST(ZeroMipCountMeansOneMip)
+{
+	Desc desc;
+	desc.Width = 16u;
+	desc.Height = 16u;
+	desc.MipCount = 0u;
+	const std::vector<uint8_t> file = Make(desc);
+
+	DDSTextureData data;
+	CHECK_EQ(Parse(file, data), S_OK);
+	CHECK_EQ(data.MipCount, 1u);
+	CHECK_EQ(CountLayoutMismatches(file, data, ExpectedLayout(desc)), 0u);
+}
+
+SCALD_TEST(BlockCompressedPitchesRoundUpToBlocks)
+{
+	// Neither extent is a multiple of 4, and the last mips are smaller than a block.
+	for (DXGI_FORMAT format : { DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC3_UNORM })
+	{
+		Desc desc;
+		desc.Width = 10u;
+		desc.Height = 6u;
+		desc.MipCount = 4u;
+		desc.Format = format;
+		desc.bUseDX10Header = false;
+		const std::vector<uint8_t> file = Make(desc);
+
+		DDSTextureData data;
+		CHECK_EQ(Parse(file, data), S_OK);
+		CHECK_EQ(data.Format, format);
+		CHECK_EQ(data.MipCount, 4u);
+		CHECK_EQ(CountLayoutMismatches(file, data, ExpectedLayout(desc)), 0u);
+		// 1x1 still takes a whole block
+		CHECK_EQ((size_t)data.Subresources[3].SlicePitch, format == DXGI_FORMAT_BC1_UNORM ? 8u : 16u);
+	}
+}
+
+SCALD_TEST(DX10HeaderArrayIsSliceMajor)
+{
+	Desc desc;
+	desc.Width = 32u;
+	desc.Height = 32u;
+	desc.MipCount = 5u;
+	desc.ArraySize = 3u;
+	desc.Format = DXGI_FORMAT_BC7_UNORM_SRGB;
+	const std::vector<uint8_t> file = Make(desc);
+
+	DDSTextureData data;
+	CHECK_EQ(Parse(file, data), S_OK);
+	CHECK_EQ(data.Format, DXGI_FORMAT_BC7_UNORM_SRGB);
+	CHECK_EQ(data.ArraySize, 3u);
+	CHECK_EQ(data.MipCount, 5u);
+	CHECK_EQ(data.Subresources.size(), 15u);
+	CHECK_EQ(CountLayoutMismatches(file, data, ExpectedLayout(desc)), 0u);
+}
+
+SCALD_TEST(CubeMaps)
+{
+	for (bool bUseDX10Header : { false, true })
+	{
+		Desc desc;
+		desc.Width = 16u;
+		desc.Height = 16u;
+		desc.MipCount = 5u;
+		desc.bIsCubeMap = true;
+		desc.bUseDX10Header = bUseDX10Header;
+		const std::vector<uint8_t> file = Make(desc);
+
+		DDSTextureData data;
+		CHECK_EQ(Parse(file, data), S_OK);
+		CHECK(data.IsCubeMap);
+		CHECK_EQ(data.ArraySize, 6u);
+		CHECK_EQ(data.Dimension, D3D12_RESOURCE_DIMENSION_TEXTURE2D);
+		CHECK_EQ(CountLayoutMismatches(file, data, ExpectedLayout(desc)), 0u);
+	}
+
+	// Legacy cube maps have to have all faces.
+	Desc desc;
+	desc.Width = 16u;
+	desc.Height = 16u;
+	desc.bUseDX10Header = false;
+	std::vector<uint8_t> file = Make(desc);
+	const uint32_t someFaces = DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX;
+	std::memcpy(file.data() + sizeof(uint32_t) + offsetof(DDS_HEADER, caps2), &someFaces, sizeof(someFaces));
+
+	DDSTextureData data;
+	CHECK_EQ(Parse(file, data), HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+}
+
+SCALD_TEST(VolumeMipsShrinkInDepth)
+{
+	for (bool bUseDX10Header : { false, true })
+	{
+		Desc desc;
+		desc.Width = 8u;
+		desc.Height = 4u;
+		desc.Depth = 8u;
+		desc.MipCount = 4u;
+		desc.bUseDX10Header = bUseDX10Header;
+		const std::vector<uint8_t> file = Make(desc);
+
+		DDSTextureData data;
+		CHECK_EQ(Parse(file, data), S_OK);
+		CHECK_EQ(data.Dimension, D3D12_RESOURCE_DIMENSION_TEXTURE3D);
+		CHECK_EQ(data.Depth, 8u);
+		CHECK_EQ(data.ArraySize, 1u);
+		// Slice pitch is one depth slice, the next mip starts after all of them.
+		CHECK_EQ(CountLayoutMismatches(file, data, ExpectedLayout(desc)), 0u);
+	}
+}
+
+SCALD_TEST(MaxSizeSkipsLargeMips)
+{
+	Desc desc;
+	desc.Width = 256u;
+	desc.Height = 128u;
+	desc.MipCount = 9u;
+	desc.ArraySize = 2u;
+	const std::vector<uint8_t> file = Make(desc);
+
+	DDSTextureData data;
+	CHECK_EQ(Parse(file, data, 64u), S_OK);
+	// 256x128 and 128x64 are skipped in both slices
+	CHECK_EQ(data.Width, 64u);
+	CHECK_EQ(data.Height, 32u);
+	CHECK_EQ(data.MipCount, 7u);
+	CHECK_EQ(data.ArraySize, 2u);
+	CHECK_EQ(CountLayoutMismatches(file, data, ExpectedLayout(desc, 64u)), 0u);
+
+	// A single mip is kept even when it's too big.
+	desc.MipCount = 1u;
+	const std::vector<uint8_t> singleMipFile = Make(desc);
+	CHECK_EQ(Parse(singleMipFile, data, 64u), S_OK);
+	CHECK_EQ(data.Width, 256u);
+	CHECK_EQ(data.MipCount, 1u);
+}
+
+SCALD_TEST(AlphaModeFromHeader)
+{
+	Desc desc;
+	desc.AlphaMode = DDS_ALPHA_MODE_PREMULTIPLIED;
+	DDSTextureData data;
+	CHECK_EQ(Parse(Make(desc), data), S_OK);
+	CHECK_EQ(data.AlphaMode, DDS_ALPHA_MODE_PREMULTIPLIED);
+
+	desc.AlphaMode = DDS_ALPHA_MODE_OPAQUE;
+	CHECK_EQ(Parse(Make(desc), data), S_OK);
+	CHECK_EQ(data.AlphaMode, DDS_ALPHA_MODE_OPAQUE);
+}
+
+SCALD_TEST(InvalidFilesAreRejected)
+{
+	Desc desc;
+	desc.Width = 16u;
+	desc.Height = 16u;
+	desc.MipCount = 5u;
+	const std::vector<uint8_t> valid = Make(desc);
+	DDSTextureData data;
+
+	CHECK_EQ(LoadDDSTextureDataFromMemory(nullptr, valid.size(), data), E_INVALIDARG);
+	// Shorter than the header
+	CHECK_EQ(LoadDDSTextureDataFromMemory(valid.data(), LegacyHeaderSize - 1u, data), E_FAIL);
+	// Header is there, the DX10 extension isn't
+	CHECK_EQ(LoadDDSTextureDataFromMemory(valid.data(), LegacyHeaderSize + 4u, data), E_FAIL);
+	// Pixel data is cut off in the last mip
+	CHECK_EQ(LoadDDSTextureDataFromMemory(valid.data(), valid.size() - 1u, data), HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+	CHECK(data.Subresources.empty());
+
+	std::vector<uint8_t> file = valid;
+	file[0] = 'X';
+	CHECK_EQ(Parse(file, data), E_FAIL);
+
+	file = valid;
+	const uint32_t wrongHeaderSize = sizeof(DDS_HEADER) + 4u;
+	std::memcpy(file.data() + sizeof(uint32_t) + offsetof(DDS_HEADER, size), &wrongHeaderSize, sizeof(uint32_t));
+	CHECK_EQ(Parse(file, data), E_FAIL);
+
+	// More mips than D3D12 allows
+	file = valid;
+	const uint32_t mipCount = D3D12_REQ_MIP_LEVELS + 1u;
+	std::memcpy(file.data() + sizeof(uint32_t) + offsetof(DDS_HEADER, mipMapCount), &mipCount, sizeof(uint32_t));
+	CHECK_EQ(Parse(file, data), HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+
+	file = valid;
+	const uint32_t arraySize = 0u;
+	std::memcpy(file.data() + LegacyHeaderSize + offsetof(DDS_HEADER_DXT10, arraySize), &arraySize, sizeof(uint32_t));
+	CHECK_EQ(Parse(file, data), HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+	// Palettized formats aren't supported by D3D12
+	Desc paletteDesc = desc;
+	paletteDesc.Format = DXGI_FORMAT_P8;
+	CHECK_EQ(Parse(Make(paletteDesc), data), HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+}
+
+SCALD_TEST(FileOwnsItsData)
+{
+	const TempDirectory directory("ScaldDDSTextureDataTests");
+
+	Desc desc;
+	desc.Width = 64u;
+	desc.Height = 64u;
+	desc.MipCount = 7u;
+	desc.ArraySize = 2u;
+	desc.Format = DXGI_FORMAT_BC1_UNORM;
+	const std::vector<uint8_t> file = Make(desc);
+	CHECK(Write(directory / "bc1.dds", file));
+
+	DDSTextureData data;
+	CHECK_EQ(LoadDDSTextureDataFromFile((directory / "bc1.dds").wstring().c_str(), data), S_OK);
+	CHECK(data.FileData);
+	CHECK_EQ(data.MipCount, 7u);
+	CHECK_EQ(data.ArraySize, 2u);
+
+	// Same layout as in memory, relative to the loaded copy, and the copy has the file's contents.
+	const std::vector<ExpectedSubresource> expected = ExpectedLayout(desc);
+	CHECK_EQ(data.Subresources.size(), expected.size());
+	UINT numWrong = 0u;
+	for (size_t i = 0; i < std::min(expected.size(), data.Subresources.size()); ++i)
+	{
+		const uint8_t* pData = static_cast<const uint8_t*>(data.Subresources[i].pData);
+		numWrong += (pData == data.FileData.get() + expected[i].Offset && std::memcmp(pData, file.data() + expected[i].Offset, expected[i].SlicePitch) == 0) ? 0u : 1u;
+	}
+	CHECK_EQ(numWrong, 0u);
+
+	CHECK_EQ(LoadDDSTextureDataFromFile((directory / "missing.dds").wstring().c_str(), data), E_FAIL);
+	CHECK(!data.FileData);
+	CHECK_EQ(LoadDDSTextureDataFromFile(nullptr, data), E_INVALIDARG);
+
+	const std::vector<uint8_t> truncated(file.begin(), file.begin() + 64);
+	CHECK(Write(directory / "truncated.dds", truncated));
+	CHECK_EQ(LoadDDSTextureDataFromFile((directory / "truncated.dds").wstring().c_str(), data), E_FAIL);
+}
@@ -0,0 +1,84 @@
+#include "TestHarness.h"
+#include "Core/DynamicUploadRing.h"
+
+#include <stdexcept>
+
+namespace
+{
+	static constexpr UINT64 GpuBase = 0x10000000ull;
+
+	struct TestConstants
+	{
+		float Values[12];
+		UINT Index;
+	};
+}
+
+SCALD_TEST(AddressesFollowOffsets)
+{
+	std::vector<BYTE> memory(4096u);
+	DynamicUploadRing ring(memory.data(), GpuBase, memory.size());
+
+	const DynamicAllocation first = ring.Allocate(100u);
+	const DynamicAllocation second = ring.Allocate(100u);
+	const DynamicAllocation third = ring.Allocate(8u, 16u);
+
+	CHECK(first.CpuAddress == memory.data());
+	CHECK_EQ(first.GpuAddress, GpuBase);
+	CHECK_EQ(first.Size, 100u);
+
+	// Constant buffer placement by default
+	CHECK(second.CpuAddress == memory.data() + 256u);
+	CHECK_EQ(second.GpuAddress, GpuBase + 256u);
+
+	CHECK(third.CpuAddress == memory.data() + 368u);
+	CHECK_EQ(third.GpuAddress, GpuBase + 368u);
+}
+
+SCALD_TEST(AllocateConstantsCopiesData)
+{
+	std::vector<BYTE> memory(1024u);
+	DynamicUploadRing ring(memory.data(), GpuBase, memory.size());
+
+	TestConstants constants = {};
+	for (UINT i = 0; i < 12u; ++i)
+	{
+		constants.Values[i] = 0.5f * i;
+	}
+	constants.Index = 42u;
+
+	ring.Allocate(4u);
+	const UINT64 gpuAddress = ring.AllocateConstants(constants);
+	CHECK_EQ(gpuAddress, GpuBase + 256u);
+	CHECK(memcmp(memory.data() + 256u, &constants, sizeof(TestConstants)) == 0);
+}
+
+SCALD_TEST(MemoryOfFramesInFlightIsKept)
+{
+	std::vector<BYTE> memory(1024u);
+	DynamicUploadRing ring(memory.data(), GpuBase, memory.size());
+
+	// Two frames in flight fill the ring.
+	ring.Allocate(512u);
+	ring.FinishFrame(1u);
+	ring.Allocate(512u);
+	ring.FinishFrame(2u);
+
+	bool bHasThrown = false;
+	try
+	{
+		ring.Allocate(1u);
+	}
+	catch (const std::runtime_error&)
+	{
+		bHasThrown = true;
+	}
+	CHECK(bHasThrown);
+
+	// Once the GPU is done with frame 1 its memory is handed out again.
+	ring.ReleaseCompletedFrames(1u);
+	CHECK_EQ(ring.GetUsedSize(), 512u);
+	const DynamicAllocation allocation = ring.Allocate(256u);
+	CHECK(allocation.CpuAddress == memory.data());
+	CHECK_EQ(allocation.GpuAddress, GpuBase);
+}
@@ -0,0 +1,81 @@
+#include "BenchHarness.h"
+#include "Core/FrustumCuller.h"
+#include "Core/JobSystem.h"
+
+#include <random>
+
+namespace
+{
+	// The per item loop the engine culled with before FrustumCuller: array of boxes, one box against all planes at a time.
+	void CullScalar(const CullingVolume& volume, const std::vector<BoundingBox>& boxes, std::vector<UINT>& outVisible)
+	{
+		outVisible.clear();
+		for (UINT i = 0; i < (UINT)boxes.size(); ++i)
+		{
+			const BoundingBox& box = boxes[i];
+
+			bool bIsOutside = false;
+			for (UINT p = 0; p < volume.NumPlanes && !bIsOutside; ++p)
+			{
+				const XMFLOAT4& plane = volume.Planes[p];
+				const float distance = plane.x * box.Center.x + plane.y * box.Center.y + plane.z * box.Center.z + plane.w;
+				const float radius = fabsf(plane.x) * box.Extents.x + fabsf(plane.y) * box.Extents.y + fabsf(plane.z) * box.Extents.z;
+				bIsOutside = distance > radius;
+			}
+
+			if (!bIsOutside)
+			{
+				outVisible.push_back(i);
+			}
+		}
+	}
+}
+
+int main()
+{
+	const XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 20.0f, -200.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const XMMATRIX viewProj = XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 500.0f));
+	const CullingVolume volume = CullingVolume::FromViewProjection(viewProj);
+
+	std::mt19937 rng(1u);
+	std::uniform_real_distribution<float> position(-400.0f, 400.0f);
+	std::uniform_real_distribution<float> extent(0.5f, 4.0f);
+
+	for (UINT count : { 1000u, 10000u, 100000u, 1000000u })
+	{
+		std::vector<BoundingBox> boxes(count);
+		FrustumCuller culler;
+		culler.Resize(count);
+		for (UINT i = 0; i < count; ++i)
+		{
+			boxes[i].Center = XMFLOAT3(position(rng), position(rng), position(rng));
+			boxes[i].Extents = XMFLOAT3(extent(rng), extent(rng), extent(rng));
+			culler.SetBounds(i, boxes[i]);
+		}
+
+		const int numRuns = count >= 100000u ? 10 : 100;
+		std::vector<UINT> scalarVisible;
+		std::vector<UINT> simdVisible;
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "scalar AoS, %u boxes", count);
+		ScaldBench::Report(name, ScaldBench::Measure(numRuns, [&]() { CullScalar(volume, boxes, scalarVisible); }));
+
+		// Without Init the job system runs everything on the calling thread.
+		std::snprintf(name, sizeof(name), "SIMD SoA, 1 thread, %u boxes", count);
+		ScaldBench::Report(name, ScaldBench::Measure(numRuns, [&]() { culler.Cull(volume, simdVisible); }));
+
+		JobSystem::Get().Init();
+		std::snprintf(name, sizeof(name), "SIMD SoA, job system (%u), %u boxes", JobSystem::Get().GetNumThreads(), count);
+		ScaldBench::Report(name, ScaldBench::Measure(numRuns, [&]() { culler.Cull(volume, simdVisible); }));
+		JobSystem::Get().Shutdown();
+
+		if (scalarVisible != simdVisible)
+		{
+			std::printf("visible sets differ: %zu scalar vs %zu SIMD\n", scalarVisible.size(), simdVisible.size());
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,217 @@
+#include "TestHarness.h"
+#include "Core/FrustumCuller.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	enum EBruteForceResult
+	{
+		Inside,
+		Outside,
+		// A corner lies within epsilon of the deciding plane, float rounding may go either way.
+		Ambiguous
+	};
+
+	// Independent of plane extraction: a box is outside if all of its corners violate the same clip space inequality.
+	EBruteForceResult BruteForceTest(const XMMATRIX& viewProj, bool bIncludeNearPlane, const BoundingBox& box)
+	{
+		static constexpr float Epsilon = 1e-3f;
+
+		XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+		box.GetCorners(corners);
+
+		float maxInside[6];
+		std::fill(std::begin(maxInside), std::end(maxInside), -FLT_MAX);
+		for (const XMFLOAT3& corner : corners)
+		{
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(corner.x, corner.y, corner.z, 1.0f), viewProj));
+
+			// Positive when the corner is on the inner side of -w <= x <= w, -w <= y <= w, 0 <= z <= w
+			const float inside[6] = { clip.w + clip.x, clip.w - clip.x, clip.w + clip.y, clip.w - clip.y, clip.w - clip.z, clip.z };
+			for (UINT i = 0; i < 6u; ++i)
+			{
+				maxInside[i] = std::max(maxInside[i], inside[i]);
+			}
+		}
+
+		EBruteForceResult result = Inside;
+		for (UINT i = 0; i < (bIncludeNearPlane ? 6u : 5u); ++i)
+		{
+			if (maxInside[i] < -Epsilon)
+			{
+				return Outside;
+			}
+			if (maxInside[i] <= Epsilon)
+			{
+				result = Ambiguous;
+			}
+		}
+		return result;
+	}
+
+	std::vector<BoundingBox> MakeRandomBoxes(UINT count, UINT seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+		std::uniform_real_distribution<float> extent(0.1f, 6.0f);
+
+		std::vector<BoundingBox> boxes(count);
+		for (BoundingBox& box : boxes)
+		{
+			box.Center = XMFLOAT3(position(rng), position(rng), position(rng));
+			box.Extents = XMFLOAT3(extent(rng), extent(rng), extent(rng));
+		}
+		return boxes;
+	}
+
+	void FillCuller(FrustumCuller& culler, const std::vector<BoundingBox>& boxes)
+	{
+		culler.Resize((UINT)boxes.size());
+		for (UINT i = 0; i < (UINT)boxes.size(); ++i)
+		{
+			culler.SetBounds(i, boxes[i]);
+		}
+	}
+
+	// Light space cascades of growing size along a tilted light direction, like CascadeShadowMap builds them.
+	std::vector<XMMATRIX> MakeCascadeViewProjs()
+	{
+		const XMVECTOR lightDir = XMVector3Normalize(XMVectorSet(0.4f, -1.0f, 0.3f, 0.0f));
+		const float radii[] = { 10.0f, 25.0f, 50.0f, 100.0f };
+
+		std::vector<XMMATRIX> viewProjs;
+		for (UINT i = 0; i < 4u; ++i)
+		{
+			const XMVECTOR center = XMVectorSet(5.0f * i, 0.0f, 10.0f * i, 1.0f);
+			const XMMATRIX view = XMMatrixLookAtLH(XMVectorSubtract(center, XMVectorScale(lightDir, 2.0f * radii[i])), center, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			const XMMATRIX proj = XMMatrixOrthographicOffCenterLH(-radii[i], radii[i], -radii[i], radii[i], 0.0f, 4.0f * radii[i]);
+			viewProjs.push_back(XMMatrixMultiply(view, proj));
+		}
+		return viewProjs;
+	}
+}
+
+SCALD_TEST(CullMasksMatchesBruteForce)
+{
+	// Not a multiple of the SIMD width, so the padded tail is exercised too.
+	const std::vector<BoundingBox> boxes = MakeRandomBoxes(10003u, 7u);
+	FrustumCuller culler;
+	FillCuller(culler, boxes);
+
+	const std::vector<XMMATRIX> viewProjs = MakeCascadeViewProjs();
+	std::vector<CullingVolume> volumes;
+	for (const XMMATRIX& viewProj : viewProjs)
+	{
+		// As the shadow pass does, casters in front of the near plane are kept.
+		volumes.push_back(CullingVolume::FromViewProjection(viewProj, false));
+	}
+
+	std::vector<UINT> masks;
+	culler.CullMasks(volumes.data(), (UINT)volumes.size(), masks);
+	CHECK_EQ(masks.size(), boxes.size());
+
+	UINT numMismatches = 0u;
+	UINT numSetBits = 0u;
+	for (UINT i = 0; i < (UINT)boxes.size(); ++i)
+	{
+		CHECK((masks[i] >> volumes.size()) == 0u);
+		for (UINT v = 0; v < (UINT)volumes.size(); ++v)
+		{
+			const EBruteForceResult expected = BruteForceTest(viewProjs[v], false, boxes[i]);
+			const bool bIsSet = (masks[i] & (1u << v)) != 0u;
+			numSetBits += bIsSet ? 1u : 0u;
+			if (expected != Ambiguous && bIsSet != (expected == Inside))
+			{
+				++numMismatches;
+			}
+		}
+	}
+
+	CHECK_EQ(numMismatches, 0u);
+	// Sanity check of the setup, some boxes must hit some cascades.
+	CHECK(numSetBits > 0u);
+}
+
+SCALD_TEST(CullMasksSkipsNearPlaneOnlyWhenAsked)
+{
+	const XMMATRIX viewProj = MakeCascadeViewProjs()[0];
+	const CullingVolume volumes[2] = { CullingVolume::FromViewProjection(viewProj, true), CullingVolume::FromViewProjection(viewProj, false) };
+	CHECK_EQ(volumes[0].NumPlanes, 6u);
+	CHECK_EQ(volumes[1].NumPlanes, 5u);
+
+	// A box between the light and the near plane, inside the cascade's x/y extent.
+	const XMVECTOR lightDir = XMVector3Normalize(XMVectorSet(0.4f, -1.0f, 0.3f, 0.0f));
+	BoundingBox box;
+	XMStoreFloat3(&box.Center, XMVectorScale(lightDir, -30.0f));
+	box.Extents = XMFLOAT3(0.5f, 0.5f, 0.5f);
+
+	FrustumCuller culler;
+	FillCuller(culler, { box });
+
+	std::vector<UINT> masks;
+	culler.CullMasks(volumes, 2u, masks);
+	CHECK_EQ(masks.size(), 1u);
+	CHECK_EQ(masks[0], 2u);
+}
+
+SCALD_TEST(CullMatchesBruteForceInParallel)
+{
+	JobSystem::Get().Init(3u);
+
+	// Above the parallel threshold, so chunks are culled by workers and compacted.
+	const std::vector<BoundingBox> boxes = MakeRandomBoxes(20001u, 11u);
+	FrustumCuller culler;
+	FillCuller(culler, boxes);
+
+	const XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -80.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const XMMATRIX viewProj = XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 150.0f));
+
+	std::vector<UINT> visible;
+	culler.Cull(CullingVolume::FromViewProjection(viewProj), visible);
+	CHECK(std::is_sorted(visible.begin(), visible.end()));
+	CHECK(std::adjacent_find(visible.begin(), visible.end()) == visible.end());
+
+	std::vector<bool> bIsVisible(boxes.size(), false);
+	for (UINT index : visible)
+	{
+		CHECK(index < boxes.size());
+		bIsVisible[index] = true;
+	}
+
+	UINT numMismatches = 0u;
+	for (UINT i = 0; i < (UINT)boxes.size(); ++i)
+	{
+		const EBruteForceResult expected = BruteForceTest(viewProj, true, boxes[i]);
+		if (expected != Ambiguous && bIsVisible[i] != (expected == Inside))
+		{
+			++numMismatches;
+		}
+	}
+	CHECK_EQ(numMismatches, 0u);
+	CHECK(!visible.empty());
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(ShrinkingInvalidatesPaddedTail)
+{
+	// Every box covers the whole volume.
+	std::vector<BoundingBox> boxes(7u, BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1000.0f, 1000.0f, 1000.0f)));
+	FrustumCuller culler;
+	FillCuller(culler, boxes);
+	culler.Resize(5u);
+
+	const CullingVolume volume = CullingVolume::FromViewProjection(MakeCascadeViewProjs()[1]);
+
+	std::vector<UINT> visible;
+	culler.Cull(volume, visible);
+	CHECK_EQ(visible, std::vector<UINT>({ 0u, 1u, 2u, 3u, 4u }));
+
+	std::vector<UINT> masks;
+	culler.CullMasks(&volume, 1u, masks);
+	CHECK_EQ(masks, std::vector<UINT>(5u, 1u));
+}
@@ -0,0 +1,138 @@
+#include "TestHarness.h"
+#include "Core/GBufferPacking.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	double AngleBetween(FXMVECTOR a, const XMFLOAT3& b)
+	{
+		XMFLOAT3 unpacked;
+		XMStoreFloat3(&unpacked, a);
+		const double length = std::sqrt((double)b.x * b.x + (double)b.y * b.y + (double)b.z * b.z);
+		const double dot = ((double)unpacked.x * b.x + (double)unpacked.y * b.y + (double)unpacked.z * b.z) / length;
+		return std::acos(std::clamp(dot, -1.0, 1.0));
+	}
+
+	struct RoundTripErrors
+	{
+		double MaxNormalError = 0.0;
+		double MaxShininessError = 0.0;
+		double MaxLengthError = 0.0;
+	};
+
+	void RoundTrip(const XMFLOAT3& normal, float shininess, RoundTripErrors& errors)
+	{
+		const UINT packed = GBufferPacking::PackNormal(XMLoadFloat3(&normal), shininess);
+		const XMVECTOR unpacked = GBufferPacking::UnpackNormal(packed);
+
+		errors.MaxNormalError = std::max(errors.MaxNormalError, AngleBetween(unpacked, normal));
+		errors.MaxShininessError = std::max(errors.MaxShininessError, (double)std::fabs(GBufferPacking::UnpackShininess(packed) - std::clamp(shininess, 0.0f, 1.0f)));
+		errors.MaxLengthError = std::max(errors.MaxLengthError, (double)std::fabs(XMVectorGetX(XMVector3Length(unpacked)) - 1.0f));
+	}
+
+	// Within the bounds, shininess up to the float error of the dequantization.
+	void CheckErrors(const RoundTripErrors& errors)
+	{
+		CHECK(errors.MaxNormalError <= GBufferPacking::MaxNormalError);
+		CHECK(errors.MaxShininessError <= GBufferPacking::MaxShininessError + 1e-6);
+		CHECK(errors.MaxLengthError < 1e-5);
+	}
+}
+
+SCALD_TEST(RandomNormalsWithinTheErrorBounds)
+{
+	std::mt19937 random(1u);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	RoundTripErrors errors;
+	for (UINT i = 0; i < 200000u; ++i)
+	{
+		// Uniform on the sphere, scaled since the normal doesn't have to be unit length.
+		XMFLOAT3 normal(gaussian(random), gaussian(random), gaussian(random));
+		if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f)
+		{
+			continue;
+		}
+		const float scale = 0.1f + 10.0f * unit(random);
+		normal = XMFLOAT3(normal.x * scale, normal.y * scale, normal.z * scale);
+		RoundTrip(normal, unit(random), errors);
+	}
+	CheckErrors(errors);
+
+	// The bounds are not much looser than what the quantization gives.
+	CHECK(errors.MaxNormalError > 0.5 * GBufferPacking::MaxNormalError);
+	CHECK(errors.MaxShininessError > 0.9 * GBufferPacking::MaxShininessError);
+}
+
+SCALD_TEST(AxesAndPolesRoundTrip)
+{
+	// The octahedron's vertices. 0.5 has no exact code with an odd ChannelMax, so the zero coordinates are off by half a step.
+	const XMFLOAT3 axes[] =
+	{
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+	};
+
+	RoundTripErrors errors;
+	for (const XMFLOAT3& axis : axes)
+	{
+		RoundTrip(axis, 0.5f, errors);
+		CHECK(AngleBetween(GBufferPacking::UnpackNormal(GBufferPacking::PackNormal(XMLoadFloat3(&axis), 0.5f)), axis) < 2e-3);
+	}
+	CheckErrors(errors);
+
+	// Lengths don't matter.
+	const XMFLOAT3 longAxis(0.0f, 0.0f, 42.0f);
+	CHECK_EQ(GBufferPacking::PackNormal(XMLoadFloat3(&longAxis), 0.25f), GBufferPacking::PackNormal(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), 0.25f));
+}
+
+SCALD_TEST(FoldSeamsWithinTheErrorBounds)
+{
+	std::mt19937 random(2u);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	RoundTripErrors errors;
+	for (UINT i = 0; i < 20000u; ++i)
+	{
+		const float phi = XM_PI * unit(random);
+
+		// Around the equator, where the lower hemisphere folds over the diagonals.
+		const float equatorZ = 0.02f * unit(random);
+		const float equatorRadius = std::sqrt(1.0f - equatorZ * equatorZ);
+		RoundTrip(XMFLOAT3(equatorRadius * cosf(phi), equatorRadius * sinf(phi), equatorZ), 0.0f, errors);
+
+		// Around the lower pole, the corners of the encoded square.
+		const float poleZ = -1.0f + 0.001f * (unit(random) + 1.0f);
+		const float poleRadius = std::sqrt(1.0f - poleZ * poleZ);
+		RoundTrip(XMFLOAT3(poleRadius * cosf(phi), poleRadius * sinf(phi), poleZ), 1.0f, errors);
+
+		// Across the x and y axes on the lower hemisphere, where the fold flips the signs.
+		const float side = 1e-3f * unit(random);
+		const float lowerZ = -std::fabs(unit(random));
+		const float lowerRadius = std::sqrt(std::max(1.0f - lowerZ * lowerZ - side * side, 0.0f));
+		RoundTrip(XMFLOAT3(side, i % 2u ? lowerRadius : -lowerRadius, lowerZ), 0.5f, errors);
+		RoundTrip(XMFLOAT3(i % 2u ? lowerRadius : -lowerRadius, side, lowerZ), 0.5f, errors);
+	}
+	CheckErrors(errors);
+}
+
+SCALD_TEST(ShininessIsClampedAndAlphaUnused)
+{
+	const XMVECTOR normal = XMVectorSet(0.3f, -0.4f, -0.8f, 0.0f);
+	CHECK_EQ(GBufferPacking::UnpackShininess(GBufferPacking::PackNormal(normal, -1.0f)), 0.0f);
+	CHECK_EQ(GBufferPacking::UnpackShininess(GBufferPacking::PackNormal(normal, 2.0f)), 1.0f);
+
+	// Shininess doesn't disturb the normal's channels, and nothing is written to the 2 bit alpha.
+	for (UINT step = 0; step <= GBufferPacking::ChannelMax; ++step)
+	{
+		const float shininess = (float)step / GBufferPacking::ChannelMax;
+		const UINT packed = GBufferPacking::PackNormal(normal, shininess);
+		CHECK_EQ(packed >> (3u * GBufferPacking::ChannelBits), 0u);
+		CHECK_EQ(packed & ((1u << (2u * GBufferPacking::ChannelBits)) - 1u), GBufferPacking::PackNormal(normal, 0.0f));
+		CHECK_EQ(GBufferPacking::UnpackShininess(packed), shininess);
+	}
+}
@@ -0,0 +1,346 @@
+#include "BenchHarness.h"
+#include "Core/Shapes.h"
+#include "Core/JobSystem.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+// Heap usage of the whole process, every allocation is prefixed with its size.
+namespace
+{
+	std::atomic<size_t> g_currBytes = 0u;
+	std::atomic<size_t> g_peakBytes = 0u;
+
+	constexpr size_t HeaderSize = alignof(std::max_align_t);
+
+	void* TrackedAlloc(size_t size)
+	{
+		uint8_t* pBlock = static_cast<uint8_t*>(std::malloc(size + HeaderSize));
+		if (!pBlock)
+		{
+			throw std::bad_alloc();
+		}
+		*reinterpret_cast<size_t*>(pBlock) = size;
+
+		const size_t curr = g_currBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		size_t peak = g_peakBytes.load(std::memory_order_relaxed);
+		while (curr > peak && !g_peakBytes.compare_exchange_weak(peak, curr, std::memory_order_relaxed))
+		{
+		}
+		return pBlock + HeaderSize;
+	}
+
+	void TrackedFree(void* p)
+	{
+		if (p)
+		{
+			uint8_t* pBlock = static_cast<uint8_t*>(p) - HeaderSize;
+			g_currBytes.fetch_sub(*reinterpret_cast<size_t*>(pBlock), std::memory_order_relaxed);
+			std::free(pBlock);
+		}
+	}
+}
+
+void* operator new(size_t size) { return TrackedAlloc(size); }
+void* operator new[](size_t size) { return TrackedAlloc(size); }
+void operator delete(void* p) noexcept { TrackedFree(p); }
+void operator delete[](void* p) noexcept { TrackedFree(p); }
+void operator delete(void* p, size_t) noexcept { TrackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { TrackedFree(p); }
+
+// The generators as they were before midpoints were shared: every subdivision copies the whole mesh and
+// emits 6 vertices per triangle, nothing is reserved. Only uint16_t existed, they are templated here to go past 65k vertices.
+// The original Subdivide resized the vertices twice instead of clearing the indices, fixed so it builds the same sphere.
+// Neither computed LODBounds, the current generators do (a pass over the vertices).
+namespace Baseline
+{
+	VertexPositionNormalTangentUV MidPoint(const VertexPositionNormalTangentUV& v0, const VertexPositionNormalTangentUV& v1)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&v0.position);
+		XMVECTOR p1 = XMLoadFloat3(&v1.position);
+
+		XMVECTOR n0 = XMLoadFloat3(&v0.normal);
+		XMVECTOR n1 = XMLoadFloat3(&v1.normal);
+
+		XMVECTOR tan0 = XMLoadFloat3(&v0.tangent);
+		XMVECTOR tan1 = XMLoadFloat3(&v1.tangent);
+
+		XMVECTOR tex0 = XMLoadFloat2(&v0.texCoord);
+		XMVECTOR tex1 = XMLoadFloat2(&v1.texCoord);
+
+		XMVECTOR pos = 0.5f * (p0 + p1);
+		XMVECTOR normal = XMVector3Normalize(0.5f * (n0 + n1));
+		XMVECTOR tangent = XMVector3Normalize(0.5f * (tan0 + tan1));
+		XMVECTOR tex = 0.5f * (tex0 + tex1);
+
+		VertexPositionNormalTangentUV v;
+		XMStoreFloat3(&v.position, pos);
+		XMStoreFloat3(&v.normal, normal);
+		XMStoreFloat3(&v.tangent, tangent);
+		XMStoreFloat2(&v.texCoord, tex);
+
+		return v;
+	}
+
+	template<typename TIndex>
+	void Subdivide(MeshData<VertexPositionNormalTangentUV, TIndex>& meshData)
+	{
+		// Save a copy of the input geometry.
+		MeshData<VertexPositionNormalTangentUV, TIndex> inputCopy = meshData;
+
+		meshData.LODVertices[0].resize(0);
+		meshData.LODIndices[0].resize(0);
+
+		UINT numTris = (UINT)inputCopy.LODIndices[0].size() / 3;
+		for (UINT i = 0; i < numTris; ++i)
+		{
+			VertexPositionNormalTangentUV v0 = inputCopy.LODVertices[0][inputCopy.LODIndices[0][i * 3 + 0]];
+			VertexPositionNormalTangentUV v1 = inputCopy.LODVertices[0][inputCopy.LODIndices[0][i * 3 + 1]];
+			VertexPositionNormalTangentUV v2 = inputCopy.LODVertices[0][inputCopy.LODIndices[0][i * 3 + 2]];
+
+			VertexPositionNormalTangentUV m0 = MidPoint(v0, v1);
+			VertexPositionNormalTangentUV m1 = MidPoint(v1, v2);
+			VertexPositionNormalTangentUV m2 = MidPoint(v0, v2);
+
+			meshData.LODVertices[0].push_back(v0); // 0
+			meshData.LODVertices[0].push_back(v1); // 1
+			meshData.LODVertices[0].push_back(v2); // 2
+			meshData.LODVertices[0].push_back(m0); // 3
+			meshData.LODVertices[0].push_back(m1); // 4
+			meshData.LODVertices[0].push_back(m2); // 5
+
+			const TIndex indices[12] = { 0, 3, 5, 3, 4, 5, 5, 4, 2, 3, 1, 4 };
+			for (TIndex index : indices)
+			{
+				meshData.LODIndices[0].push_back((TIndex)(i * 6 + index));
+			}
+		}
+	}
+
+	template<typename TIndex>
+	MeshData<VertexPositionNormalTangentUV, TIndex> CreateGeosphere(float radius, UINT numSubdivisions)
+	{
+		MeshData<VertexPositionNormalTangentUV, TIndex> meshData;
+
+		const float X = 0.525731f;
+		const float Z = 0.850651f;
+
+		XMFLOAT3 pos[12] =
+		{
+			XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),
+			XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
+			XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X),
+			XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),
+			XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f),
+			XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
+		};
+
+		TIndex k[60] =
+		{
+			1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+			1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+			3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+			10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+		};
+
+		meshData.LODVertices[0].resize(12);
+		meshData.LODIndices[0].assign(&k[0], &k[60]);
+
+		for (UINT i = 0; i < 12; ++i)
+			meshData.LODVertices[0][i].position = pos[i];
+
+		for (UINT i = 0; i < numSubdivisions; ++i)
+			Subdivide(meshData);
+
+		for (UINT i = 0; i < meshData.LODVertices[0].size(); ++i)
+		{
+			VertexPositionNormalTangentUV& v = meshData.LODVertices[0][i];
+
+			XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&v.position));
+			XMVECTOR p = radius * n;
+
+			XMStoreFloat3(&v.position, p);
+			XMStoreFloat3(&v.normal, n);
+
+			float theta = atan2f(v.position.z, v.position.x);
+			if (theta < 0.0f)
+				theta += XM_2PI;
+
+			float phi = acosf(v.position.y / radius);
+
+			v.texCoord.x = theta / XM_2PI;
+			v.texCoord.y = phi / XM_PI;
+
+			v.tangent.x = -radius * sinf(phi) * sinf(theta);
+			v.tangent.y = 0.0f;
+			v.tangent.z = +radius * sinf(phi) * cosf(theta);
+
+			XMVECTOR T = XMLoadFloat3(&v.tangent);
+			XMStoreFloat3(&v.tangent, XMVector3Normalize(T));
+		}
+
+		return meshData;
+	}
+
+	template<typename TIndex>
+	MeshData<VertexPositionNormalTangentUV, TIndex> CreateGrid(float width, float depth, UINT m, UINT n)
+	{
+		MeshData<VertexPositionNormalTangentUV, TIndex> meshData;
+
+		UINT vertexCount = m * n;
+		UINT faceCount = (m - 1) * (n - 1) * 2;
+
+		float halfWidth = 0.5f * width;
+		float halfDepth = 0.5f * depth;
+
+		float dx = width / (n - 1);
+		float dz = depth / (m - 1);
+
+		float du = 1.0f / (n - 1);
+		float dv = 1.0f / (m - 1);
+
+		meshData.LODVertices[0].resize(vertexCount);
+		for (UINT i = 0; i < m; ++i)
+		{
+			float z = halfDepth - i * dz;
+			for (UINT j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j * dx;
+
+				meshData.LODVertices[0][i * n + j].position = XMFLOAT3(x, 0.0f, z);
+				meshData.LODVertices[0][i * n + j].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				meshData.LODVertices[0][i * n + j].tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+				meshData.LODVertices[0][i * n + j].texCoord.x = j * du;
+				meshData.LODVertices[0][i * n + j].texCoord.y = i * dv;
+			}
+		}
+
+		meshData.LODIndices[0].resize(faceCount * 3);
+
+		UINT k = 0;
+		for (UINT i = 0; i < m - 1; ++i)
+		{
+			for (UINT j = 0; j < n - 1; ++j)
+			{
+				meshData.LODIndices[0][k] = i * n + j;
+				meshData.LODIndices[0][k + 1] = i * n + j + 1;
+				meshData.LODIndices[0][k + 2] = (i + 1) * n + j;
+
+				meshData.LODIndices[0][k + 3] = (i + 1) * n + j;
+				meshData.LODIndices[0][k + 4] = i * n + j + 1;
+				meshData.LODIndices[0][k + 5] = (i + 1) * n + j + 1;
+
+				k += 6;
+			}
+		}
+
+		return meshData;
+	}
+
+	// Vertex count of the baseline sphere: 12, then 6 per triangle of the previous level.
+	constexpr uint64_t GetGeosphereVertexCount(UINT numSubdivisions)
+	{
+		return numSubdivisions == 0u ? 12ull : 6ull * 20ull * (1ull << (2u * (numSubdivisions - 1u)));
+	}
+}
+
+namespace
+{
+	struct MeshStats
+	{
+		double Milliseconds = 0.0;
+		size_t NumVertices = 0u;
+		size_t NumIndices = 0u;
+		size_t ResultBytes = 0u;
+		size_t PeakBytes = 0u;
+	};
+
+	template<typename TIndex, typename Func>
+	MeshStats Measure(int numRuns, Func&& create)
+	{
+		MeshStats stats;
+		stats.Milliseconds = ScaldBench::Measure(numRuns, [&create]()
+			{
+				ScaldBench::DoNotOptimize(create());
+			});
+
+		// Peak of one more run, over what's allocated before it (the job system's queues).
+		const size_t baseBytes = g_currBytes.load();
+		g_peakBytes = baseBytes;
+		const MeshData<VertexPositionNormalTangentUV, TIndex> mesh = create();
+		stats.PeakBytes = g_peakBytes.load() - baseBytes;
+		stats.NumVertices = mesh.LODVertices[0].size();
+		stats.NumIndices = mesh.LODIndices[0].size();
+		stats.ResultBytes = stats.NumVertices * sizeof(VertexPositionNormalTangentUV) + stats.NumIndices * sizeof(TIndex);
+		return stats;
+	}
+
+	void Report(const char* name, const MeshStats& baseline, const MeshStats& current)
+	{
+		char line[128];
+		std::snprintf(line, sizeof(line), "%s, baseline", name);
+		ScaldBench::Report(line, baseline.Milliseconds);
+		ScaldBench::Report(name, current.Milliseconds);
+
+		for (const MeshStats* stats : { &baseline, &current })
+		{
+			std::printf("    %-8s %9zu vertices, %9zu indices, result %8.2f MB, peak %8.2f MB (%.2fx)\n", stats == &baseline ? "baseline" : "current",
+				stats->NumVertices, stats->NumIndices, stats->ResultBytes / 1048576.0, stats->PeakBytes / 1048576.0, (double)stats->PeakBytes / stats->ResultBytes);
+		}
+		std::printf("    current takes %.2fx the time and %.2fx the peak memory of the baseline\n", current.Milliseconds / baseline.Milliseconds, (double)current.PeakBytes / baseline.PeakBytes);
+	}
+
+	template<typename TIndex>
+	void RunLevels(const char* indexName, UINT maxSubdivisions, const char* suffix)
+	{
+		char name[96];
+		for (UINT subdivisions = 0; subdivisions <= maxSubdivisions; ++subdivisions)
+		{
+			const int numRuns = subdivisions >= 7u ? 3 : 10;
+			std::snprintf(name, sizeof(name), "geosphere %u, %s%s", subdivisions, indexName, suffix);
+
+			// The baseline duplicates midpoints, its vertices run out of indices a level earlier.
+			const MeshStats current = Measure<TIndex>(numRuns, [subdivisions]() { return Shapes::CreateGeosphere<TIndex>(1.0f, subdivisions); });
+			if (Baseline::GetGeosphereVertexCount(subdivisions) - 1u > std::numeric_limits<TIndex>::max())
+			{
+				ScaldBench::Report(name, current.Milliseconds);
+				std::printf("    baseline needs more than %s indices\n", indexName);
+				continue;
+			}
+			const MeshStats baseline = Measure<TIndex>(numRuns, [subdivisions]() { return Baseline::CreateGeosphere<TIndex>(1.0f, subdivisions); });
+			Report(name, baseline, current);
+		}
+	}
+
+	void RunGrid(UINT size, const char* suffix)
+	{
+		char name[96];
+		std::snprintf(name, sizeof(name), "grid %ux%u, 32 bit%s", size, size, suffix);
+		const MeshStats current = Measure<uint32_t>(3, [size]() { return Shapes::CreateGrid<uint32_t>(100.0f, 100.0f, size, size); });
+		const MeshStats baseline = Measure<uint32_t>(3, [size]() { return Baseline::CreateGrid<uint32_t>(100.0f, 100.0f, size, size); });
+		Report(name, baseline, current);
+	}
+
+	void RunAll(const char* suffix)
+	{
+		RunLevels<uint16_t>("16 bit", Shapes::GetMaxGeosphereSubdivisions<uint16_t>(), suffix);
+		RunLevels<uint32_t>("32 bit", 8u, suffix);
+		RunGrid(1024u, suffix);
+	}
+}
+
+int main()
+{
+	// Not initialized: everything runs inline on this thread.
+	RunAll(", inline");
+
+	JobSystem::Get().Init();
+	char suffix[32];
+	std::snprintf(suffix, sizeof(suffix), ", %u job threads", JobSystem::Get().GetNumThreads());
+	RunAll(suffix);
+	JobSystem::Get().Shutdown();
+	return 0;
+}
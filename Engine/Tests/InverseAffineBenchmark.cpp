@@ -0,0 +1,95 @@
+#include "BenchHarness.h"
+#include "Common/ScaldMath.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Scale, rotation and translation, like the world matrices of render items.
+	std::vector<XMFLOAT4X4> MakeTransforms(size_t count)
+	{
+		std::mt19937 random(1u);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		std::vector<XMFLOAT4X4> matrices(count);
+		for (XMFLOAT4X4& m : matrices)
+		{
+			const XMVECTOR axis = XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random) + 2.0f, 0.0f));
+			const XMMATRIX world = XMMatrixScaling(1.5f + unit(random), 1.5f + unit(random), 1.5f + unit(random))
+				* XMMatrixRotationAxis(axis, XM_PI * unit(random))
+				* XMMatrixTranslation(100.0f * unit(random), 100.0f * unit(random), 100.0f * unit(random));
+			XMStoreFloat4x4(&m, world);
+		}
+		return matrices;
+	}
+
+	float MaxDifference(const std::vector<XMFLOAT4X4>& a, const std::vector<XMFLOAT4X4>& b)
+	{
+		float maxDifference = 0.0f;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			for (UINT r = 0; r < 4u; ++r)
+			{
+				for (UINT c = 0; c < 4u; ++c)
+				{
+					maxDifference = std::max(maxDifference, std::fabs(a[i].m[r][c] - b[i].m[r][c]));
+				}
+			}
+		}
+		return maxDifference;
+	}
+
+	void Run(size_t count)
+	{
+		const std::vector<XMFLOAT4X4> worlds = MakeTransforms(count);
+		std::vector<XMFLOAT4X4> general(count);
+		std::vector<XMFLOAT4X4> affine(count);
+		std::vector<XMFLOAT4X4> batched(count);
+		const int numRuns = count >= 100000u ? 10 : 50;
+
+		char name[96];
+		std::snprintf(name, sizeof(name), "XMMatrixInverse, %zu", count);
+		const double generalMs = ScaldBench::Measure(numRuns, [&]()
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					XMStoreFloat4x4(&general[i], XMMatrixInverse(nullptr, XMLoadFloat4x4(&worlds[i])));
+				}
+				ScaldBench::DoNotOptimize(general[0]);
+			});
+		ScaldBench::Report(name, generalMs);
+
+		std::snprintf(name, sizeof(name), "InverseAffine per matrix, %zu", count);
+		const double affineMs = ScaldBench::Measure(numRuns, [&]()
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					XMStoreFloat4x4(&affine[i], ScaldMath::InverseAffine(XMLoadFloat4x4(&worlds[i])));
+				}
+				ScaldBench::DoNotOptimize(affine[0]);
+			});
+		ScaldBench::Report(name, affineMs);
+
+		std::snprintf(name, sizeof(name), "InverseAffineBatch SoA, %zu", count);
+		const double batchedMs = ScaldBench::Measure(numRuns, [&]()
+			{
+				ScaldMath::InverseAffineBatch(worlds.data(), batched.data(), count);
+				ScaldBench::DoNotOptimize(batched[0]);
+			});
+		ScaldBench::Report(name, batchedMs);
+
+		std::printf("    %.1f M matrices/s batched, %.2fx XMMatrixInverse, %.2fx per matrix; max difference to XMMatrixInverse %g\n",
+			count / batchedMs / 1000.0, generalMs / batchedMs, affineMs / batchedMs, MaxDifference(general, batched));
+	}
+}
+
+int main()
+{
+	// 50k dynamic objects is the target, smaller batches are what a job's range gets.
+	for (size_t count : { 1000u, 10000u, 50000u, 200000u })
+	{
+		Run(count);
+	}
+	return 0;
+}
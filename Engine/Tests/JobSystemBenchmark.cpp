@@ -0,0 +1,106 @@
+#include "BenchHarness.h"
+#include "Core/JobSystem.h"
+
+#include <numeric>
+
+namespace
+{
+	UINT64 ForkJoinSum(const UINT* values, UINT begin, UINT end)
+	{
+		if (end - begin <= 256u)
+		{
+			UINT64 sum = 0u;
+			for (UINT i = begin; i < end; ++i)
+			{
+				sum += values[i];
+			}
+			return sum;
+		}
+
+		const UINT middle = begin + (end - begin) / 2u;
+		UINT64 left = 0u;
+		JobCounter counter;
+		JobSystem::Get().Run([values, &left, begin, middle]() { left = ForkJoinSum(values, begin, middle); }, &counter);
+		const UINT64 right = ForkJoinSum(values, middle, end);
+		JobSystem::Get().Wait(counter);
+		return left + right;
+	}
+
+	void RunAll(const char* suffix, const std::vector<UINT>& values)
+	{
+		char name[96];
+
+		// Scheduling overhead: jobs doing next to nothing.
+		std::snprintf(name, sizeof(name), "100k empty jobs, run + wait%s", suffix);
+		ScaldBench::Report(name, ScaldBench::Measure(10, []()
+			{
+				JobCounter counter;
+				for (UINT i = 0; i < 100000u; ++i)
+				{
+					JobSystem::Get().Run([]() {}, &counter);
+				}
+				JobSystem::Get().Wait(counter);
+			}));
+
+		// Fork-join recursion: owner pops its own jobs, idle threads steal the big halves.
+		std::snprintf(name, sizeof(name), "fork-join sum of 16M, 64k leaf jobs%s", suffix);
+		ScaldBench::Report(name, ScaldBench::Measure(10, [&values]()
+			{
+				ScaldBench::DoNotOptimize(ForkJoinSum(values.data(), 0u, (UINT)values.size()));
+			}));
+
+		std::snprintf(name, sizeof(name), "ParallelFor sum of 16M%s", suffix);
+		ScaldBench::Report(name, ScaldBench::Measure(10, [&values]()
+			{
+				std::atomic<UINT64> total = 0u;
+				JobSystem::Get().ParallelFor((UINT)values.size(), 4096u, [&values, &total](UINT begin, UINT end)
+					{
+						UINT64 sum = 0u;
+						for (UINT i = begin; i < end; ++i)
+						{
+							sum += values[i];
+						}
+						total.fetch_add(sum, std::memory_order_relaxed);
+					});
+				ScaldBench::DoNotOptimize(total.load());
+			}));
+
+		// Many small fork-joins back to back, as the engine does every frame (culling, transforms, recording).
+		std::snprintf(name, sizeof(name), "1000 ParallelFor of 64 batches%s", suffix);
+		ScaldBench::Report(name, ScaldBench::Measure(10, [&values]()
+			{
+				for (UINT frame = 0; frame < 1000u; ++frame)
+				{
+					JobSystem::Get().ParallelFor(64u * 256u, 256u, [&values](UINT begin, UINT end)
+						{
+							UINT64 sum = 0u;
+							for (UINT i = begin; i < end; ++i)
+							{
+								sum += values[i];
+							}
+							ScaldBench::DoNotOptimize(sum);
+						});
+				}
+			}));
+	}
+}
+
+int main()
+{
+	std::vector<UINT> values(16u << 20);
+	std::iota(values.begin(), values.end(), 0u);
+
+	// Not initialized: everything runs inline on this thread.
+	RunAll(", inline", values);
+
+	JobSystem::Get().Init();
+	char suffix[32];
+	std::snprintf(suffix, sizeof(suffix), ", %u job threads", JobSystem::Get().GetNumThreads());
+	JobSystem::Get().ResetStats();
+	RunAll(suffix, values);
+
+	const JobSystemStats stats = JobSystem::Get().GetStats();
+	std::printf("executed %llu jobs, stolen %llu\n", (unsigned long long)stats.NumExecutedJobs, (unsigned long long)stats.NumStolenJobs);
+	JobSystem::Get().Shutdown();
+	return 0;
+}
@@ -0,0 +1,267 @@
+#include "TestHarness.h"
+#include "Core/JobSystem.h"
+#include "Core/WorkStealingDeque.h"
+
+#include <chrono>
+#if defined(__linux__)
+#include <ctime>
+#endif
+
+namespace
+{
+	static constexpr UINT NumWorkers = 3u;
+
+	// Forks two halves as jobs until the range is small, sums the values with nested waits.
+	UINT64 ForkJoinSum(UINT begin, UINT end)
+	{
+		if (end - begin <= 64u)
+		{
+			UINT64 sum = 0u;
+			for (UINT i = begin; i < end; ++i)
+			{
+				sum += i;
+			}
+			return sum;
+		}
+
+		const UINT middle = begin + (end - begin) / 2u;
+		UINT64 left = 0u;
+		JobCounter counter;
+		JobSystem::Get().Run([&left, begin, middle]() { left = ForkJoinSum(begin, middle); }, &counter);
+		const UINT64 right = ForkJoinSum(middle, end);
+		JobSystem::Get().Wait(counter);
+		return left + right;
+	}
+
+#if defined(__linux__)
+	double GetThreadCpuMs()
+	{
+		timespec time;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+		return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+	}
+#endif
+}
+
+SCALD_TEST(DequeOwnerIsLifoThiefIsFifo)
+{
+	WorkStealingDeque<UINT> deque(4u);
+	std::vector<UINT> items(100u);
+	for (UINT i = 0; i < 100u; ++i)
+	{
+		items[i] = i;
+		// Grows past the initial capacity of 4 items.
+		deque.Push(&items[i]);
+	}
+
+	CHECK_EQ(deque.Steal(), &items[0]);
+	CHECK_EQ(deque.Steal(), &items[1]);
+	CHECK_EQ(deque.Pop(), &items[99]);
+	CHECK_EQ(deque.Pop(), &items[98]);
+
+	UINT numTaken = 4u;
+	while (deque.Pop())
+	{
+		++numTaken;
+	}
+	CHECK_EQ(numTaken, 100u);
+	CHECK(deque.IsEmpty());
+	CHECK(deque.Steal() == nullptr);
+	CHECK(deque.Pop() == nullptr);
+}
+
+SCALD_TEST(DequeHandsOutEveryItemOnce)
+{
+	static constexpr UINT NumItems = 200000u;
+	static constexpr UINT NumThieves = 3u;
+
+	std::vector<UINT> items(NumItems);
+	std::vector<std::atomic<UINT>> numTaken(NumItems);
+	for (UINT i = 0; i < NumItems; ++i)
+	{
+		items[i] = i;
+		numTaken[i] = 0u;
+	}
+
+	// Small initial capacity, so the owner grows the buffer while thieves read from it.
+	WorkStealingDeque<UINT> deque(16u);
+	std::atomic<bool> bIsPushing = true;
+	std::atomic<UINT> numStolen = 0u;
+
+	std::vector<std::thread> thieves;
+	for (UINT t = 0; t < NumThieves; ++t)
+	{
+		thieves.emplace_back([&]()
+			{
+				while (bIsPushing || !deque.IsEmpty())
+				{
+					if (UINT* item = deque.Steal())
+					{
+						numTaken[*item].fetch_add(1u);
+						numStolen.fetch_add(1u);
+					}
+				}
+			});
+	}
+
+	// Owner pushes in bursts and pops some back, racing with thieves for the last items.
+	for (UINT i = 0; i < NumItems; ++i)
+	{
+		deque.Push(&items[i]);
+		if (i % 3u == 0u)
+		{
+			if (UINT* item = deque.Pop())
+			{
+				numTaken[*item].fetch_add(1u);
+			}
+		}
+	}
+	while (UINT* item = deque.Pop())
+	{
+		numTaken[*item].fetch_add(1u);
+	}
+	bIsPushing = false;
+
+	for (std::thread& thief : thieves)
+	{
+		thief.join();
+	}
+
+	UINT numWrong = 0u;
+	for (UINT i = 0; i < NumItems; ++i)
+	{
+		numWrong += numTaken[i] != 1u ? 1u : 0u;
+	}
+	CHECK_EQ(numWrong, 0u);
+	CHECK(numStolen > 0u);
+}
+
+SCALD_TEST(ParallelForCoversRangeOnce)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	for (UINT count : { 1u, 7u, 1000u, 100000u })
+	{
+		std::vector<std::atomic<UINT>> hits(count);
+		for (std::atomic<UINT>& hit : hits)
+		{
+			hit = 0u;
+		}
+
+		JobSystem::Get().ParallelFor(count, 16u, [&hits](UINT begin, UINT end)
+			{
+				for (UINT i = begin; i < end; ++i)
+				{
+					hits[i].fetch_add(1u, std::memory_order_relaxed);
+				}
+			});
+
+		UINT numWrong = 0u;
+		for (std::atomic<UINT>& hit : hits)
+		{
+			numWrong += hit != 1u ? 1u : 0u;
+		}
+		CHECK_EQ(numWrong, 0u);
+	}
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(NestedWaitsInsideJobs)
+{
+	JobSystem::Get().Init(NumWorkers);
+	JobSystem::Get().ResetStats();
+
+	static constexpr UINT Count = 1u << 18;
+	CHECK_EQ(ForkJoinSum(0u, Count), (UINT64)Count * (Count - 1u) / 2u);
+	CHECK(JobSystem::Get().GetStats().NumExecutedJobs > 0u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(ContinuationsRunAfterDependency)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	for (int repeat = 0; repeat < 100; ++repeat)
+	{
+		std::atomic<UINT> numFirst = 0u;
+		std::atomic<bool> bHasRunEarly = false;
+		std::atomic<UINT> numSecond = 0u;
+
+		JobCounter first;
+		JobCounter second;
+		for (UINT i = 0; i < 8u; ++i)
+		{
+			JobSystem::Get().Run([&numFirst]() { numFirst.fetch_add(1u); }, &first);
+		}
+		JobSystem::Get().RunAfter(first, [&]()
+			{
+				bHasRunEarly = numFirst != 8u;
+				numSecond.fetch_add(1u);
+			}, &second);
+
+		JobSystem::Get().Wait(second);
+		CHECK(!bHasRunEarly);
+		CHECK_EQ(numSecond.load(), 1u);
+	}
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(ForeignThreadCanRunAndWait)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	// A thread the job system doesn't own has no deque, its jobs go through the shared queue.
+	UINT64 sum = 0u;
+	std::thread foreign([&sum]()
+		{
+			std::atomic<UINT64> total = 0u;
+			JobCounter counter;
+			for (UINT i = 0; i < 1000u; ++i)
+			{
+				JobSystem::Get().Run([&total, i]() { total.fetch_add(i); }, &counter);
+			}
+			JobSystem::Get().Wait(counter);
+			sum = total;
+		});
+	foreign.join();
+	CHECK_EQ(sum, 1000u * 999u / 2u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(WorksWithoutInit)
+{
+	// Not initialized: jobs run inline, counters are done immediately.
+	std::atomic<UINT> numRuns = 0u;
+	JobCounter counter;
+	JobSystem::Get().Run([&numRuns]() { numRuns.fetch_add(1u); }, &counter);
+	JobSystem::Get().RunAfter(counter, [&numRuns]() { numRuns.fetch_add(1u); });
+	JobSystem::Get().Wait(counter);
+	CHECK_EQ(numRuns.load(), 2u);
+	CHECK_EQ(ForkJoinSum(0u, 1000u), 1000u * 999u / 2u);
+}
+
+#if defined(__linux__)
+SCALD_TEST(WaitSleepsInsteadOfSpinning)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	JobCounter counter;
+	JobSystem::Get().Run([]() { std::this_thread::sleep_for(std::chrono::milliseconds(300)); }, &counter);
+	// Let a worker pick the job up, so there is nothing left for this thread to run.
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	const double cpuStart = GetThreadCpuMs();
+	JobSystem::Get().Wait(counter);
+	const double cpuMs = GetThreadCpuMs() - cpuStart;
+
+	CHECK(counter.IsDone());
+	// Spinning would burn about the whole 280 ms.
+	CHECK(cpuMs < 50.0);
+
+	JobSystem::Get().Shutdown();
+}
+#endif
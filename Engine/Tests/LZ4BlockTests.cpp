@@ -0,0 +1,146 @@
+#include "TestHarness.h"
+#include "TestData.h"
+#include "Core/LZ4Block.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using TestData::MakeCompressible;
+using TestData::MakeRandom;
+
+namespace
+{
+	std::vector<uint8_t> Compress(const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> compressed(LZ4Block::GetMaxCompressedSize(data.size()));
+		compressed.resize(LZ4Block::Compress(data.data(), data.size(), compressed.data(), compressed.size()));
+		return compressed;
+	}
+
+	bool RoundTrips(const std::vector<uint8_t>& data)
+	{
+		const std::vector<uint8_t> compressed = Compress(data);
+		std::vector<uint8_t> decompressed(data.size());
+		return !compressed.empty()
+			&& LZ4Block::Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size())
+			&& decompressed == data;
+	}
+}
+
+SCALD_TEST(CompressibleDataRoundTrips)
+{
+	const std::vector<uint8_t> data = MakeCompressible(256u * 1024u, 1u);
+	const std::vector<uint8_t> compressed = Compress(data);
+
+	CHECK(compressed.size() < data.size() / 2u);
+	CHECK(RoundTrips(data));
+}
+
+SCALD_TEST(IncompressibleDataStaysWithinTheBound)
+{
+	for (size_t size : { 1u, 13u, 4096u, 65536u + 7u })
+	{
+		const std::vector<uint8_t> data = MakeRandom(size, (uint32_t)size);
+		const std::vector<uint8_t> compressed = Compress(data);
+
+		CHECK(compressed.size() > 0u);
+		CHECK(compressed.size() <= LZ4Block::GetMaxCompressedSize(size));
+		CHECK(RoundTrips(data));
+	}
+}
+
+SCALD_TEST(EdgeSizesRoundTrip)
+{
+	// Below, at and just past the sizes where matches are allowed at all.
+	uint32_t numFailed = 0u;
+	for (size_t size = 1u; size <= 40u; ++size)
+	{
+		numFailed += RoundTrips(std::vector<uint8_t>(size, (uint8_t)'a')) ? 0u : 1u;
+		numFailed += RoundTrips(MakeCompressible(size, (uint32_t)size)) ? 0u : 1u;
+	}
+	CHECK_EQ(numFailed, 0u);
+
+	// Empty input is a single literal-only token.
+	const std::vector<uint8_t> compressed = Compress({});
+	CHECK_EQ(compressed.size(), 1u);
+	CHECK(LZ4Block::Decompress(compressed.data(), compressed.size(), nullptr, 0u));
+}
+
+SCALD_TEST(LongRunsAndLengthsRoundTrip)
+{
+	// A run compresses to an offset 1 match overlapping its own output, with length bytes well past 255.
+	std::vector<uint8_t> run(100000u, 0x5Au);
+	CHECK(Compress(run).size() < 500u);
+	CHECK(RoundTrips(run));
+
+	// Literal runs longer than 15 + 255 between matches.
+	std::vector<uint8_t> mixed = MakeRandom(1000u, 2u);
+	const std::vector<uint8_t> text = MakeCompressible(3000u, 3u);
+	mixed.insert(mixed.end(), text.begin(), text.end());
+	const std::vector<uint8_t> noise = MakeRandom(700u, 4u);
+	mixed.insert(mixed.end(), noise.begin(), noise.end());
+	mixed.insert(mixed.end(), text.begin(), text.end());
+	CHECK(RoundTrips(mixed));
+}
+
+SCALD_TEST(DecodesReferenceBlock)
+{
+	// Written by hand per the format: 4 literals and a match of 8 at offset 4, then 5 final literals.
+	const uint8_t block[] = { 0x44, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x50, 'x', 'y', 'z', 'w', 'v' };
+	const char expected[] = "abcdabcdabcdxyzwv";
+
+	std::vector<uint8_t> decompressed(sizeof(expected) - 1u);
+	CHECK(LZ4Block::Decompress(block, sizeof(block), decompressed.data(), decompressed.size()));
+	CHECK(std::equal(decompressed.begin(), decompressed.end(), expected));
+}
+
+SCALD_TEST(CompressFailsWhenOutputDoesNotFit)
+{
+	const std::vector<uint8_t> data = MakeRandom(4096u, 5u);
+	std::vector<uint8_t> compressed(data.size() / 2u);
+	CHECK_EQ(LZ4Block::Compress(data.data(), data.size(), compressed.data(), compressed.size()), (size_t)0u);
+}
+
+SCALD_TEST(DecompressRejectsWrongSizes)
+{
+	const std::vector<uint8_t> data = MakeCompressible(10000u, 6u);
+	const std::vector<uint8_t> compressed = Compress(data);
+
+	std::vector<uint8_t> smaller(data.size() - 1u);
+	CHECK(!LZ4Block::Decompress(compressed.data(), compressed.size(), smaller.data(), smaller.size()));
+	std::vector<uint8_t> larger(data.size() + 1u);
+	CHECK(!LZ4Block::Decompress(compressed.data(), compressed.size(), larger.data(), larger.size()));
+}
+
+SCALD_TEST(CorruptInputNeverWritesOutOfBounds)
+{
+	const std::vector<uint8_t> data = MakeCompressible(8192u, 7u);
+	const std::vector<uint8_t> compressed = Compress(data);
+
+	constexpr size_t GuardSize = 64u;
+	constexpr uint8_t GuardValue = 0xCDu;
+	std::mt19937 random(8u);
+
+	uint32_t numGuardsHit = 0u;
+	uint32_t numAccepted = 0u;
+	for (uint32_t i = 0; i < 2000u; ++i)
+	{
+		std::vector<uint8_t> corrupt = compressed;
+		if (i % 2u == 0u)
+		{
+			corrupt[random() % corrupt.size()] = (uint8_t)random();
+		}
+		else
+		{
+			corrupt.resize(random() % corrupt.size());
+		}
+
+		std::vector<uint8_t> output(data.size() + GuardSize, GuardValue);
+		numAccepted += LZ4Block::Decompress(corrupt.data(), corrupt.size(), output.data(), data.size()) ? 1u : 0u;
+		numGuardsHit += std::all_of(output.end() - GuardSize, output.end(), [=](uint8_t value) { return value == GuardValue; }) ? 0u : 1u;
+	}
+	CHECK_EQ(numGuardsHit, 0u);
+	// A flipped literal byte still decodes to the right size, truncated blocks never do.
+	CHECK(numAccepted < 1000u);
+}
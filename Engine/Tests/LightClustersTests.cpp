@@ -0,0 +1,209 @@
+#include "TestHarness.h"
+#include "Core/LightClusters.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	constexpr UINT NumWorkers = 3u;
+
+	constexpr float FovY = 0.25f * XM_PI;
+	constexpr float AspectRatio = 16.0f / 9.0f;
+	constexpr float NearZ = 0.1f;
+	constexpr float FarZ = 500.0f;
+
+	// Spread over the view volume with a few outside of it, sizes from small lamps to lights covering many clusters.
+	std::vector<XMFLOAT4> MakeLights(UINT numLights, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		const float tanHalfFovY = tanf(0.5f * FovY);
+		std::vector<XMFLOAT4> lights(numLights);
+		for (XMFLOAT4& light : lights)
+		{
+			// Denser close to the camera, like the slices.
+			const float z = NearZ * powf(1.1f * FarZ / NearZ, unit(random)) - 0.5f;
+			const float halfHeight = std::max(z, NearZ) * tanHalfFovY * 1.2f;
+			light.x = (2.0f * unit(random) - 1.0f) * halfHeight * AspectRatio;
+			light.y = (2.0f * unit(random) - 1.0f) * halfHeight;
+			light.z = z;
+			light.w = unit(random) < 0.01f ? 2.0f + 10.0f * unit(random) : 0.02f + 0.5f * unit(random);
+		}
+		return lights;
+	}
+
+	// Every cluster against every light, keeping the lowest indices past the cap.
+	std::vector<std::vector<UINT>> BruteForceAssign(const LightClusters& clusters, const std::vector<XMFLOAT4>& lights)
+	{
+		std::vector<std::vector<UINT>> result(clusters.GetNumClusters());
+		for (UINT cluster = 0; cluster < clusters.GetNumClusters(); ++cluster)
+		{
+			XMFLOAT3 boxMin, boxMax;
+			clusters.GetClusterBounds(cluster, boxMin, boxMax);
+			for (UINT light = 0; light < (UINT)lights.size() && result[cluster].size() < LightClusters::MaxLightsPerCluster; ++light)
+			{
+				if (LightClusters::SphereIntersectsBox(lights[light], boxMin, boxMax))
+				{
+					result[cluster].push_back(light);
+				}
+			}
+		}
+		return result;
+	}
+
+	std::vector<UINT> GetClusterLights(const LightClusters& clusters, UINT cluster)
+	{
+		const LightClusterRange& range = clusters.GetRanges()[cluster];
+		return std::vector<UINT>(clusters.GetLightIndices().begin() + range.Offset, clusters.GetLightIndices().begin() + range.Offset + range.Count);
+	}
+}
+
+SCALD_TEST(ParallelAssignMatchesBruteForce)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	LightClusters clusters;
+	clusters.Build(FovY, AspectRatio, NearZ, FarZ);
+	const std::vector<XMFLOAT4> lights = MakeLights(12000u, 1u);
+	clusters.Assign(lights.data(), (UINT)lights.size());
+
+	const std::vector<std::vector<UINT>> expected = BruteForceAssign(clusters, lights);
+
+	UINT numWrongClusters = 0u;
+	UINT numCapped = 0u;
+	size_t numIndices = 0u;
+	for (UINT cluster = 0; cluster < clusters.GetNumClusters(); ++cluster)
+	{
+		numWrongClusters += GetClusterLights(clusters, cluster) == expected[cluster] ? 0u : 1u;
+		numCapped += expected[cluster].size() == LightClusters::MaxLightsPerCluster ? 1u : 0u;
+		numIndices += expected[cluster].size();
+	}
+	CHECK_EQ(numWrongClusters, 0u);
+	CHECK_EQ(clusters.GetLightIndices().size(), numIndices);
+	// The scene exercises the cap, and most clusters are not capped.
+	CHECK(numCapped > 0u);
+	CHECK(numCapped < clusters.GetNumClusters() / 2u);
+
+	// Ranges are packed back to back in cluster order.
+	UINT offset = 0u;
+	for (const LightClusterRange& range : clusters.GetRanges())
+	{
+		CHECK_EQ(range.Offset, offset);
+		offset += range.Count;
+	}
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(ResultDoesNotDependOnScheduling)
+{
+	const std::vector<XMFLOAT4> lights = MakeLights(10000u, 2u);
+
+	// Inline, without workers.
+	LightClusters serial;
+	serial.Build(FovY, AspectRatio, NearZ, FarZ, 24u, 12u, 32u);
+	serial.Assign(lights.data(), (UINT)lights.size());
+
+	JobSystem::Get().Init(NumWorkers);
+	LightClusters parallel;
+	parallel.Build(FovY, AspectRatio, NearZ, FarZ, 24u, 12u, 32u);
+	for (UINT run = 0; run < 5u; ++run)
+	{
+		// Reassigning reuses the bins, the result is the same every time.
+		parallel.Assign(lights.data(), (UINT)lights.size());
+		CHECK(parallel.GetLightIndices() == serial.GetLightIndices());
+		CHECK(std::equal(parallel.GetRanges().begin(), parallel.GetRanges().end(), serial.GetRanges().begin(),
+			[](const LightClusterRange& a, const LightClusterRange& b) { return a.Offset == b.Offset && a.Count == b.Count; }));
+	}
+
+	// Fewer lights than the parallel threshold take the single batch path.
+	parallel.Assign(lights.data(), 100u);
+	serial.Assign(lights.data(), 100u);
+	CHECK(parallel.GetLightIndices() == serial.GetLightIndices());
+
+	parallel.Assign(nullptr, 0u);
+	CHECK(parallel.GetLightIndices().empty());
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(LitPointsFindTheirLightsLikeTheShader)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	LightClusters clusters;
+	clusters.Build(FovY, AspectRatio, NearZ, FarZ);
+	const std::vector<XMFLOAT4> lights = MakeLights(2000u, 3u);
+	clusters.Assign(lights.data(), (UINT)lights.size());
+
+	// Points inside of lights, looked up the way the lighting shader does: the slice from the log of the depth,
+	// the tile from the projected position. Unless the cluster is capped, the light must be listed.
+	std::mt19937 random(4u);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	const float tanHalfFovY = tanf(0.5f * FovY);
+
+	UINT numTested = 0u;
+	UINT numMissing = 0u;
+	for (UINT light = 0; light < (UINT)lights.size(); ++light)
+	{
+		for (UINT sample = 0; sample < 16u; ++sample)
+		{
+			const XMFLOAT4& sphere = lights[light];
+			const XMFLOAT3 point(sphere.x + unit(random) * sphere.w * 0.57f, sphere.y + unit(random) * sphere.w * 0.57f, sphere.z + unit(random) * sphere.w * 0.57f);
+			const float ndcX = point.x / (point.z * tanHalfFovY * AspectRatio);
+			const float ndcY = point.y / (point.z * tanHalfFovY);
+			if (point.z <= NearZ || point.z >= FarZ || fabsf(ndcX) >= 1.0f || fabsf(ndcY) >= 1.0f)
+			{
+				continue;
+			}
+
+			const UINT slice = std::min((UINT)std::max(floorf(logf(point.z) * clusters.GetDepthSliceScale() + clusters.GetDepthSliceBias()), 0.0f), clusters.GetSlicesZ() - 1u);
+			const UINT x = std::min((UINT)((ndcX * 0.5f + 0.5f) * clusters.GetTilesX()), clusters.GetTilesX() - 1u);
+			const UINT y = std::min((UINT)((0.5f - ndcY * 0.5f) * clusters.GetTilesY()), clusters.GetTilesY() - 1u);
+			const UINT cluster = clusters.GetClusterIndex(x, y, slice);
+
+			const std::vector<UINT> clusterLights = GetClusterLights(clusters, cluster);
+			if (clusterLights.size() < LightClusters::MaxLightsPerCluster)
+			{
+				++numTested;
+				numMissing += std::binary_search(clusterLights.begin(), clusterLights.end(), light) ? 0u : 1u;
+			}
+		}
+	}
+	CHECK(numTested > 10000u);
+	CHECK_EQ(numMissing, 0u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(SlicesCoverTheDepthRange)
+{
+	LightClusters clusters;
+	clusters.Build(FovY, AspectRatio, NearZ, FarZ, 4u, 3u, 16u);
+	CHECK_EQ(clusters.GetNumClusters(), 4u * 3u * 16u);
+
+	XMFLOAT3 boxMin, boxMax;
+	clusters.GetClusterBounds(clusters.GetClusterIndex(0u, 0u, 0u), boxMin, boxMax);
+	CHECK_EQ(boxMin.z, NearZ);
+	clusters.GetClusterBounds(clusters.GetClusterIndex(3u, 2u, 15u), boxMin, boxMax);
+	CHECK_EQ(boxMax.z, FarZ);
+
+	// Adjacent slices share their boundary, and the shader's formula maps the middle of a slice to that slice.
+	float previousMaxZ = NearZ;
+	for (UINT slice = 0; slice < 16u; ++slice)
+	{
+		clusters.GetClusterBounds(clusters.GetClusterIndex(1u, 1u, slice), boxMin, boxMax);
+		CHECK_EQ(boxMin.z, previousMaxZ);
+		CHECK_NEAR(logf(0.5f * (boxMin.z + boxMax.z)) * clusters.GetDepthSliceScale() + clusters.GetDepthSliceBias(), slice + 0.5f, 0.1f);
+		previousMaxZ = boxMax.z;
+	}
+
+	// Rebuilding with other parameters takes effect, the same ones are a no-op.
+	clusters.Build(FovY, AspectRatio, NearZ, FarZ, 8u, 8u, 8u);
+	CHECK_EQ(clusters.GetNumClusters(), 512u);
+	clusters.Build(FovY, AspectRatio, NearZ, FarZ, 8u, 8u, 8u);
+	CHECK_EQ(clusters.GetRanges().size(), (size_t)512u);
+}
@@ -0,0 +1,315 @@
+#include "TestHarness.h"
+#include "Core/LightManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+	constexpr UINT NumFrameResources = 3u;
+
+	class FakeLightBuffer;
+
+	struct UploadLog
+	{
+		UINT NumCreated = 0u;
+		// Released ones are removed by LightManager when a copy grows.
+		std::vector<FakeLightBuffer*> LiveBuffers;
+		// [Begin, End) of every copy, in the order they were made.
+		std::vector<std::pair<UINT, UINT>> Copies;
+	};
+
+	// Mapped memory in a vector, every buffer with its own address.
+	class FakeLightBuffer : public PointLightBuffer
+	{
+	public:
+		FakeLightBuffer(UploadLog& log, UINT capacity)
+			:
+			m_log(log),
+			m_data(capacity),
+			m_address((UINT64)++log.NumCreated << 20u)
+		{
+			m_log.LiveBuffers.push_back(this);
+		}
+
+		virtual ~FakeLightBuffer() noexcept override
+		{
+			m_log.LiveBuffers.erase(std::find(m_log.LiveBuffers.begin(), m_log.LiveBuffers.end(), this));
+		}
+
+		virtual void CopyRange(UINT firstIndex, const InstanceData* data, UINT count) override
+		{
+			CHECK(count > 0u);
+			CHECK(firstIndex + count <= (UINT)m_data.size());
+			if (firstIndex + count <= (UINT)m_data.size())
+			{
+				memcpy(&m_data[firstIndex], data, (size_t)count * sizeof(InstanceData));
+			}
+			m_log.Copies.emplace_back(firstIndex, firstIndex + count);
+		}
+
+		virtual UINT64 GetGPUVirtualAddress() const override { return m_address; }
+
+		UINT GetCapacity() const { return (UINT)m_data.size(); }
+
+		// The GPU's view of the first numLights instances matches the CPU copy.
+		bool Matches(const std::vector<InstanceData>& instances) const
+		{
+			return instances.size() <= m_data.size() && (instances.empty() || memcmp(m_data.data(), instances.data(), instances.size() * sizeof(InstanceData)) == 0);
+		}
+
+	private:
+		UploadLog& m_log;
+		std::vector<InstanceData> m_data;
+		UINT64 m_address = 0u;
+	};
+
+	// Finds the buffers of the frame resources by the address Upload returns.
+	struct FakeUploader
+	{
+		UploadLog Log;
+
+		LightManager::CreateBufferFunc GetCreateFunc()
+		{
+			return [this](UINT capacity) { return std::make_unique<FakeLightBuffer>(Log, capacity); };
+		}
+
+		const FakeLightBuffer* Find(UINT64 address) const
+		{
+			for (const FakeLightBuffer* buffer : Log.LiveBuffers)
+			{
+				if (buffer->GetGPUVirtualAddress() == address)
+				{
+					return buffer;
+				}
+			}
+			return nullptr;
+		}
+
+		std::vector<std::pair<UINT, UINT>> TakeCopies()
+		{
+			return std::exchange(Log.Copies, {});
+		}
+	};
+
+	LightData MakeLight(float id)
+	{
+		LightData light;
+		light.Position = XMFLOAT3(id, 2.0f * id, -id);
+		light.Strength = XMFLOAT3(id, id, id);
+		light.FallOfEnd = 1.0f + id;
+		return light;
+	}
+
+	using Ranges = std::vector<std::pair<UINT, UINT>>;
+}
+
+SCALD_TEST(RemovedHandlesStayStale)
+{
+	FakeUploader uploader;
+	LightManager lights(uploader.GetCreateFunc(), NumFrameResources);
+
+	const PointLightHandle a = lights.AddPointLight(MakeLight(1.0f));
+	const PointLightHandle b = lights.AddPointLight(MakeLight(2.0f));
+	CHECK(lights.IsValid(a));
+	CHECK(!lights.IsValid(PointLightHandle()));
+
+	lights.RemovePointLight(a);
+	CHECK(!lights.IsValid(a));
+	CHECK(lights.IsValid(b));
+
+	// The freed slot is reused, the old handle still does not resolve to the new light.
+	const PointLightHandle c = lights.AddPointLight(MakeLight(3.0f));
+	CHECK_EQ(c.Slot, a.Slot);
+	CHECK(c.Generation != a.Generation);
+	CHECK(!lights.IsValid(a));
+	CHECK(lights.IsValid(c));
+	CHECK_EQ(lights.GetPointLight(c).FallOfEnd, 4.0f);
+	CHECK_EQ(lights.GetPointLight(b).FallOfEnd, 3.0f);
+
+	// Every generation of the slot is outdated by its removal.
+	lights.RemovePointLight(c);
+	const PointLightHandle d = lights.AddPointLight(MakeLight(4.0f));
+	CHECK_EQ(d.Slot, a.Slot);
+	CHECK(!lights.IsValid(a));
+	CHECK(!lights.IsValid(c));
+	CHECK(lights.IsValid(d));
+	CHECK_EQ(lights.GetNumPointLights(), 2u);
+}
+
+SCALD_TEST(SwapRemoveRedirectsTheMovedLight)
+{
+	FakeUploader uploader;
+	LightManager lights(uploader.GetCreateFunc(), 1u);
+
+	std::vector<PointLightHandle> handles;
+	for (UINT i = 0; i < 6u; ++i)
+	{
+		handles.push_back(lights.AddPointLight(MakeLight((float)i)));
+	}
+	lights.Upload(0u);
+	CHECK(uploader.TakeCopies() == (Ranges{ { 0u, 6u } }));
+
+	// The last light fills the hole of the second, only that place is uploaded.
+	lights.RemovePointLight(handles[1]);
+	CHECK_EQ(lights.GetNumPointLights(), 5u);
+	CHECK_EQ(lights.GetPointLight(handles[5]).FallOfEnd, 6.0f);
+	CHECK_EQ(lights.GetPointLightInstances()[1].Light.FallOfEnd, 6.0f);
+
+	const UINT64 address = lights.Upload(0u);
+	CHECK(uploader.TakeCopies() == (Ranges{ { 1u, 2u } }));
+	CHECK_EQ(lights.GetLastUploadBytes(), (UINT64)sizeof(InstanceData));
+	CHECK(uploader.Find(address)->Matches(lights.GetPointLightInstances()));
+
+	// Updating the moved light goes to its new place.
+	lights.SetPointLight(handles[5], MakeLight(10.0f));
+	lights.Upload(0u);
+	CHECK(uploader.TakeCopies() == (Ranges{ { 1u, 2u } }));
+	CHECK_EQ(lights.GetPointLightInstances()[1].Light.FallOfEnd, 11.0f);
+
+	// Removing the last light moves nothing and uploads nothing.
+	lights.RemovePointLight(handles[4]);
+	lights.Upload(0u);
+	CHECK(uploader.TakeCopies().empty());
+	CHECK_EQ(lights.GetLastUploadBytes(), 0u);
+
+	// Every remaining handle resolves to its own light.
+	for (UINT i : { 0u, 2u, 3u, 5u })
+	{
+		CHECK(lights.IsValid(handles[i]));
+		CHECK_EQ(lights.GetPointLight(handles[i]).FallOfEnd, i == 5u ? 11.0f : 1.0f + i);
+	}
+
+	// The volume follows position and range.
+	const InstanceData& instance = lights.GetPointLightInstances()[1];
+	CHECK_EQ(instance.World._11, 11.0f);
+	CHECK_EQ(instance.World._14, 10.0f);
+	CHECK_EQ(instance.World._24, 20.0f);
+	CHECK_EQ(instance.World._34, -10.0f);
+}
+
+SCALD_TEST(DirtyRangesMergePerFrameInFlight)
+{
+	FakeUploader uploader;
+	LightManager lights(uploader.GetCreateFunc(), NumFrameResources);
+
+	std::vector<PointLightHandle> handles;
+	for (UINT i = 0; i < 100u; ++i)
+	{
+		handles.push_back(lights.AddPointLight(MakeLight((float)i)));
+	}
+	for (UINT frame = 0; frame < NumFrameResources; ++frame)
+	{
+		CHECK(uploader.Find(lights.Upload(frame))->Matches(lights.GetPointLightInstances()));
+		CHECK(uploader.TakeCopies() == (Ranges{ { 0u, 100u } }));
+	}
+
+	// Frame 0 goes around while the other copies wait for their frames, which accumulate every change meanwhile.
+	lights.SetPointLight(handles[10], MakeLight(-1.0f));
+	lights.Upload(0u);
+	CHECK(uploader.TakeCopies() == (Ranges{ { 10u, 11u } }));
+
+	// In order updates extend one range, adjacent and overlapping ones are merged on upload.
+	for (UINT i : { 20u, 21u, 22u, 50u, 31u, 30u, 21u })
+	{
+		lights.SetPointLight(handles[i], MakeLight(-(float)i));
+	}
+	lights.Upload(0u);
+	CHECK(uploader.TakeCopies() == (Ranges{ { 20u, 23u }, { 30u, 32u }, { 50u, 51u } }));
+	CHECK_EQ(lights.GetLastUploadBytes(), (UINT64)6u * sizeof(InstanceData));
+
+	// Frame 1 gets both sets of changes.
+	CHECK(uploader.Find(lights.Upload(1u))->Matches(lights.GetPointLightInstances()));
+	CHECK(uploader.TakeCopies() == (Ranges{ { 10u, 11u }, { 20u, 23u }, { 30u, 32u }, { 50u, 51u } }));
+
+	// Parts of ranges of removed lights are clipped.
+	lights.SetPointLight(handles[99], MakeLight(-99.0f));
+	lights.RemovePointLight(handles[99]);
+	lights.RemovePointLight(handles[98]);
+	CHECK(uploader.Find(lights.Upload(2u))->Matches(lights.GetPointLightInstances()));
+	CHECK(uploader.TakeCopies() == (Ranges{ { 10u, 11u }, { 20u, 23u }, { 30u, 32u }, { 50u, 51u } }));
+
+	// Nothing changed since the last upload of frame 1 and 0 but the removals, which did not move any light.
+	lights.Upload(1u);
+	CHECK(uploader.TakeCopies().empty());
+	CHECK(uploader.Find(lights.Upload(0u))->Matches(lights.GetPointLightInstances()));
+	CHECK(uploader.TakeCopies().empty());
+}
+
+SCALD_TEST(ScatteredUpdatesCollapseToOneRange)
+{
+	FakeUploader uploader;
+	LightManager lights(uploader.GetCreateFunc(), 2u);
+
+	std::vector<PointLightHandle> handles;
+	for (UINT i = 0; i < 4u; ++i)
+	{
+		handles.push_back(lights.AddPointLight(MakeLight((float)i)));
+	}
+	lights.Upload(0u);
+	lights.Upload(1u);
+	uploader.TakeCopies();
+
+	// Frame 1 waits for many frames of the same two lights updated back and forth,
+	// its list stops growing once it has as many ranges as there are lights.
+	for (UINT frame = 0; frame < 50u; ++frame)
+	{
+		lights.SetPointLight(handles[3], MakeLight(3.0f + frame));
+		lights.SetPointLight(handles[1], MakeLight(1.0f + frame));
+		lights.Upload(0u);
+		CHECK(uploader.TakeCopies() == (Ranges{ { 1u, 2u }, { 3u, 4u } }));
+	}
+	CHECK(uploader.Find(lights.Upload(1u))->Matches(lights.GetPointLightInstances()));
+	CHECK(uploader.TakeCopies() == (Ranges{ { 0u, 4u } }));
+}
+
+SCALD_TEST(PoolsGrowOnUpload)
+{
+	FakeUploader uploader;
+	LightManager lights(uploader.GetCreateFunc(), NumFrameResources, 4u);
+	CHECK_EQ(uploader.Log.NumCreated, NumFrameResources);
+
+	// Every copy is valid right away, even without lights.
+	const UINT64 firstAddress = lights.Upload(0u);
+	CHECK(uploader.Find(firstAddress) != nullptr);
+	CHECK(uploader.TakeCopies().empty());
+
+	for (UINT i = 0; i < 5u; ++i)
+	{
+		lights.AddPointLight(MakeLight((float)i));
+	}
+
+	// Doubled, and the new buffer receives every light.
+	const UINT64 grownAddress = lights.Upload(0u);
+	CHECK(grownAddress != firstAddress);
+	CHECK_EQ(uploader.Find(grownAddress)->GetCapacity(), 8u);
+	CHECK(uploader.Find(grownAddress)->Matches(lights.GetPointLightInstances()));
+	CHECK(uploader.TakeCopies() == (Ranges{ { 0u, 5u } }));
+	CHECK_EQ(uploader.Log.NumCreated, NumFrameResources + 1u);
+
+	// Past double the capacity, it grows to what is needed.
+	for (UINT i = 5; i < 20u; ++i)
+	{
+		lights.AddPointLight(MakeLight((float)i));
+	}
+	const UINT64 largeAddress = lights.Upload(0u);
+	CHECK_EQ(uploader.Find(largeAddress)->GetCapacity(), 20u);
+	CHECK(uploader.Find(largeAddress)->Matches(lights.GetPointLightInstances()));
+	CHECK(uploader.TakeCopies() == (Ranges{ { 0u, 20u } }));
+
+	// Other frame resources grow when they are uploaded, straight to the size needed.
+	const UINT64 otherAddress = lights.Upload(1u);
+	CHECK(otherAddress != largeAddress);
+	CHECK_EQ(uploader.Find(otherAddress)->GetCapacity(), 20u);
+	CHECK(uploader.Find(otherAddress)->Matches(lights.GetPointLightInstances()));
+	CHECK(uploader.TakeCopies() == (Ranges{ { 0u, 20u } }));
+
+	// Buffers with room are kept.
+	lights.AddPointLight(MakeLight(20.0f));
+	CHECK_EQ(uploader.Find(lights.Upload(0u))->GetCapacity(), 40u);
+	CHECK(lights.Upload(0u) == lights.Upload(0u));
+	const UINT numCreated = uploader.Log.NumCreated;
+	lights.Upload(0u);
+	CHECK_EQ(uploader.Log.NumCreated, numCreated);
+}
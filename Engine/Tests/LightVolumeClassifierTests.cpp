@@ -0,0 +1,238 @@
+#include "TestHarness.h"
+#include "Core/LightVolumeClassifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+
+namespace
+{
+	// 90 degrees vertical, 16:9, so the projection scales are exact.
+	constexpr float ScaleY = 1.0f;
+	constexpr float ScaleX = 9.0f / 16.0f;
+	constexpr float NearZ = 1.0f;
+	constexpr float FarZ = 100.0f;
+	constexpr UINT Width = 1600u;
+	constexpr UINT Height = 900u;
+
+	using EVolumeClass = LightVolumeClassifier::EVolumeClass;
+
+	EVolumeClass ClassifyOne(LightVolumeClassifier& classifier, const XMFLOAT4& sphere)
+	{
+		classifier.Classify(&sphere, 1u, ScaleX, ScaleY, NearZ, FarZ, Width, Height);
+		return classifier.GetClass(0u);
+	}
+
+	bool IsFullScreen(const LightScissorRect& rect)
+	{
+		return rect.Left == 0u && rect.Top == 0u && rect.Right == Width && rect.Bottom == Height;
+	}
+
+	bool IsEqual(const LightScissorRect& a, const LightScissorRect& b)
+	{
+		return a.Left == b.Left && a.Top == b.Top && a.Right == b.Right && a.Bottom == b.Bottom;
+	}
+
+	// Pixel bounds of points on the sphere, projected one by one. Only meaningful in front of the near plane.
+	void ProjectSurface(const XMFLOAT4& sphere, float& outLeft, float& outTop, float& outRight, float& outBottom)
+	{
+		outLeft = outTop = FLT_MAX;
+		outRight = outBottom = -FLT_MAX;
+		for (UINT i = 0; i < 64u; ++i)
+		{
+			for (UINT j = 0; j <= 64u; ++j)
+			{
+				const float phi = XM_2PI * i / 64.0f;
+				const float theta = XM_PI * j / 64.0f;
+				const float x = sphere.x + sphere.w * sinf(theta) * cosf(phi);
+				const float y = sphere.y + sphere.w * sinf(theta) * sinf(phi);
+				const float z = sphere.z + sphere.w * cosf(theta);
+
+				const float pixelX = (x * ScaleX / z * 0.5f + 0.5f) * Width;
+				const float pixelY = (0.5f - y * ScaleY / z * 0.5f) * Height;
+				outLeft = std::min(outLeft, pixelX);
+				outRight = std::max(outRight, pixelX);
+				outTop = std::min(outTop, pixelY);
+				outBottom = std::max(outBottom, pixelY);
+			}
+		}
+	}
+}
+
+SCALD_TEST(TouchingTheNearPlaneDoesNotCrossIt)
+{
+	LightVolumeClassifier classifier;
+
+	// z - r == near exactly: not crossing, so it is bounded by its projection, not the whole screen.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 3.0f, 2.0f)), LightVolumeClassifier::WithinFrustum);
+	CHECK(!IsFullScreen(classifier.GetScissorRect(0u)));
+
+	// A hair closer and it crosses, which makes it full screen.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 2.999f, 2.0f)), LightVolumeClassifier::WithinFrustum);
+	CHECK(IsFullScreen(classifier.GetScissorRect(0u)));
+
+	// Touching it from behind is still inside.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, -1.0f, 2.0f)), LightVolumeClassifier::WithinFrustum);
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, -1.001f, 2.0f)), LightVolumeClassifier::Culled);
+}
+
+SCALD_TEST(TouchingTheFarPlaneDoesNotCrossIt)
+{
+	LightVolumeClassifier classifier;
+
+	// z + r == far exactly.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 98.0f, 2.0f)), LightVolumeClassifier::WithinFrustum);
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 98.5f, 2.0f)), LightVolumeClassifier::IntersectsFarPlane);
+	CHECK(!IsFullScreen(classifier.GetScissorRect(0u)));
+
+	// Touching it from beyond is still inside, a hair further is culled.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 102.0f, 2.0f)), LightVolumeClassifier::IntersectsFarPlane);
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 102.01f, 2.0f)), LightVolumeClassifier::Culled);
+	CHECK_EQ(classifier.GetScissorRect(0u).Right, 0u);
+}
+
+SCALD_TEST(CrossingBothPlanesIsAFullScreenQuad)
+{
+	LightVolumeClassifier classifier;
+
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 50.0f, 60.0f)), LightVolumeClassifier::FullQuad);
+	CHECK(IsFullScreen(classifier.GetScissorRect(0u)));
+
+	// Off to the side it still crosses both, as long as it reaches into the frustum.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(80.0f, 0.0f, 50.0f, 60.0f)), LightVolumeClassifier::FullQuad);
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(500.0f, 0.0f, 50.0f, 60.0f)), LightVolumeClassifier::Culled);
+}
+
+SCALD_TEST(CameraInsideTheVolume)
+{
+	LightVolumeClassifier classifier;
+
+	// Centered on the camera and around it: back faces are in front, so it is drawn within the frustum, full screen.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 0.0f, 5.0f)), LightVolumeClassifier::WithinFrustum);
+	CHECK(IsFullScreen(classifier.GetScissorRect(0u)));
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(1.0f, -2.0f, 0.5f, 5.0f)), LightVolumeClassifier::WithinFrustum);
+	CHECK(IsFullScreen(classifier.GetScissorRect(0u)));
+
+	// Around the camera and past the far plane.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 0.0f, 150.0f)), LightVolumeClassifier::FullQuad);
+	CHECK(IsFullScreen(classifier.GetScissorRect(0u)));
+}
+
+SCALD_TEST(PartialTailMatchesOneByOne)
+{
+	std::mt19937 random(1u);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<XMFLOAT4> spheres(11u);
+	for (XMFLOAT4& sphere : spheres)
+	{
+		sphere = XMFLOAT4(unit(random) * 40.0f, unit(random) * 25.0f, 50.0f + unit(random) * 55.0f, 2.0f + 10.0f * (unit(random) + 1.0f));
+	}
+
+	LightVolumeClassifier single;
+	for (UINT count : { 1u, 2u, 3u, 5u, 6u, 7u, 11u })
+	{
+		// The lanes past the end of the last group of 4 must not show up anywhere.
+		LightVolumeClassifier classifier;
+		classifier.Classify(spheres.data(), count, ScaleX, ScaleY, NearZ, FarZ, Width, Height);
+
+		UINT numListed = 0u;
+		for (UINT c = LightVolumeClassifier::WithinFrustum; c < LightVolumeClassifier::NumClasses; ++c)
+		{
+			const std::vector<UINT>& lights = classifier.GetLights((EVolumeClass)c);
+			numListed += (UINT)lights.size();
+			CHECK(std::is_sorted(lights.begin(), lights.end()));
+			CHECK(std::all_of(lights.begin(), lights.end(), [count](UINT light) { return light < count; }));
+		}
+
+		UINT numCulled = 0u;
+		for (UINT light = 0; light < count; ++light)
+		{
+			const EVolumeClass volumeClass = ClassifyOne(single, spheres[light]);
+			CHECK_EQ(classifier.GetClass(light), volumeClass);
+			CHECK(IsEqual(classifier.GetScissorRect(light), single.GetScissorRect(0u)));
+			numCulled += volumeClass == LightVolumeClassifier::Culled ? 1u : 0u;
+		}
+		CHECK_EQ(numListed + numCulled, count);
+	}
+
+	// Reclassifying fewer lights drops the old ones.
+	LightVolumeClassifier classifier;
+	classifier.Classify(spheres.data(), 11u, ScaleX, ScaleY, NearZ, FarZ, Width, Height);
+	classifier.Classify(spheres.data(), 0u, ScaleX, ScaleY, NearZ, FarZ, Width, Height);
+	for (UINT c = 0; c < LightVolumeClassifier::NumClasses; ++c)
+	{
+		CHECK(classifier.GetLights((EVolumeClass)c).empty());
+	}
+}
+
+SCALD_TEST(ScissorIsClampedAtTheScreenEdges)
+{
+	LightVolumeClassifier classifier;
+
+	// Half off the left and the top edge.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(-17.0f, 9.5f, 10.0f, 2.0f)), LightVolumeClassifier::WithinFrustum);
+	LightScissorRect rect = classifier.GetScissorRect(0u);
+	CHECK_EQ(rect.Left, 0u);
+	CHECK_EQ(rect.Top, 0u);
+	CHECK(rect.Right > 0u && rect.Right < Width / 2u);
+	CHECK(rect.Bottom > 0u && rect.Bottom < Height / 2u);
+
+	// Half off the right and the bottom edge.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(17.0f, -9.5f, 10.0f, 2.0f)), LightVolumeClassifier::WithinFrustum);
+	rect = classifier.GetScissorRect(0u);
+	CHECK_EQ(rect.Right, Width);
+	CHECK_EQ(rect.Bottom, Height);
+	CHECK(rect.Left > Width / 2u && rect.Left < Width);
+	CHECK(rect.Top > Height / 2u && rect.Top < Height);
+
+	// Bigger than the screen in front of the camera.
+	CHECK_EQ(ClassifyOne(classifier, XMFLOAT4(0.0f, 0.0f, 12.0f, 11.0f)), LightVolumeClassifier::WithinFrustum);
+	CHECK(IsFullScreen(classifier.GetScissorRect(0u)));
+}
+
+SCALD_TEST(ScissorContainsTheProjectedSphere)
+{
+	std::mt19937 random(2u);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<XMFLOAT4> spheres(1000u);
+	for (XMFLOAT4& sphere : spheres)
+	{
+		const float z = 5.0f + 90.0f * (unit(random) * 0.5f + 0.5f);
+		sphere = XMFLOAT4(unit(random) * z / ScaleX, unit(random) * z / ScaleY, z, 0.1f + 3.9f * (unit(random) * 0.5f + 0.5f));
+	}
+
+	LightVolumeClassifier classifier;
+	classifier.Classify(spheres.data(), (UINT)spheres.size(), ScaleX, ScaleY, NearZ, FarZ, Width, Height);
+
+	UINT numTested = 0u;
+	UINT numNotContained = 0u;
+	UINT numLoose = 0u;
+	LightScissorRect classRect = {};
+	bool bHasClassRect = false;
+	for (UINT light = 0; light < (UINT)spheres.size(); ++light)
+	{
+		if (classifier.GetClass(light) != LightVolumeClassifier::WithinFrustum)
+		{
+			continue;
+		}
+		++numTested;
+
+		float left, top, right, bottom;
+		ProjectSurface(spheres[light], left, top, right, bottom);
+		const LightScissorRect& rect = classifier.GetScissorRect(light);
+
+		// Contains every sampled surface point on screen, and is not more than a few pixels bigger than needed.
+		numNotContained += (rect.Left <= std::max(left, 0.0f) && rect.Top <= std::max(top, 0.0f)
+			&& rect.Right >= std::min(right, (float)Width) && rect.Bottom >= std::min(bottom, (float)Height)) ? 0u : 1u;
+		numLoose += (rect.Left + 3.0f < std::max(left, 0.0f) || rect.Right > std::min(right, (float)Width) + 3.0f) ? 1u : 0u;
+
+		classRect = bHasClassRect ? LightScissorRect{ std::min(classRect.Left, rect.Left), std::min(classRect.Top, rect.Top),
+			std::max(classRect.Right, rect.Right), std::max(classRect.Bottom, rect.Bottom) } : rect;
+		bHasClassRect = true;
+	}
+	CHECK(numTested > 500u);
+	CHECK_EQ(numNotContained, 0u);
+	CHECK_EQ(numLoose, 0u);
+	CHECK(IsEqual(classifier.GetClassScissorRect(LightVolumeClassifier::WithinFrustum), classRect));
+}
@@ -0,0 +1,147 @@
+#include "TestHarness.h"
+#include "Core/LinearAllocator.h"
+
+#include <algorithm>
+#include <random>
+
+SCALD_TEST(AllocationsAreAlignedAndPaddingIsAccounted)
+{
+	LinearAllocator allocator(4096u);
+
+	CHECK_EQ(allocator.Allocate(10u, 1u), 0u);
+	CHECK_EQ(allocator.Allocate(16u, 16u), 16u);
+	CHECK_EQ(allocator.Allocate(1u, 256u), 256u);
+	CHECK_EQ(allocator.Allocate(4u, 4u), 260u);
+
+	// Padding counts as used until the frame is released.
+	CHECK_EQ(allocator.GetUsedSize(), 264u);
+
+	for (UINT64 alignment = 1u; alignment <= 1024u; alignment *= 2u)
+	{
+		const UINT64 offset = allocator.Allocate(3u, alignment);
+		CHECK(offset != LinearAllocator::InvalidOffset);
+		CHECK_EQ(offset % alignment, 0u);
+	}
+}
+
+SCALD_TEST(FullRingFailsUntilFrameIsReleased)
+{
+	LinearAllocator allocator(1024u);
+
+	CHECK_EQ(allocator.Allocate(1024u, 256u), 0u);
+	CHECK(allocator.IsFull());
+	CHECK_EQ(allocator.Allocate(1u, 1u), LinearAllocator::InvalidOffset);
+
+	allocator.FinishFrame(1u);
+	allocator.ReleaseCompletedFrames(0u);
+	CHECK(allocator.IsFull());
+
+	allocator.ReleaseCompletedFrames(1u);
+	CHECK(allocator.IsEmpty());
+	// Nothing in flight, allocations start from the beginning again.
+	CHECK_EQ(allocator.Allocate(8u, 8u), 0u);
+}
+
+SCALD_TEST(AllocationWrapsAroundBehindTail)
+{
+	LinearAllocator allocator(1024u);
+
+	// Frame 1 takes [0, 512), frame 2 takes [512, 896).
+	CHECK_EQ(allocator.Allocate(512u, 256u), 0u);
+	allocator.FinishFrame(1u);
+	CHECK_EQ(allocator.Allocate(384u, 256u), 512u);
+	allocator.FinishFrame(2u);
+
+	// Frame 1 completes, 256 bytes are left at the end of the ring.
+	allocator.ReleaseCompletedFrames(1u);
+	CHECK_EQ(allocator.GetUsedSize(), 384u);
+
+	// Doesn't fit at the end, goes to the beginning and wastes [896, 1024) until frame 3 is released.
+	CHECK_EQ(allocator.Allocate(256u, 256u), 0u);
+	CHECK_EQ(allocator.GetUsedSize(), 384u + 128u + 256u);
+
+	// Free space is now [256, 512) only.
+	CHECK_EQ(allocator.Allocate(256u, 256u), 256u);
+	CHECK_EQ(allocator.Allocate(1u, 1u), LinearAllocator::InvalidOffset);
+	allocator.FinishFrame(3u);
+
+	allocator.ReleaseCompletedFrames(2u);
+	CHECK_EQ(allocator.GetUsedSize(), 128u + 512u);
+	allocator.ReleaseCompletedFrames(3u);
+	CHECK(allocator.IsEmpty());
+}
+
+SCALD_TEST(WrapAroundFailsIfTailIsTooClose)
+{
+	LinearAllocator allocator(1024u);
+
+	CHECK_EQ(allocator.Allocate(256u, 1u), 0u);
+	allocator.FinishFrame(1u);
+	CHECK_EQ(allocator.Allocate(640u, 1u), 256u);
+	allocator.FinishFrame(2u);
+	allocator.ReleaseCompletedFrames(1u);
+
+	// 128 bytes at the end and 256 at the beginning, neither fits 300.
+	CHECK_EQ(allocator.Allocate(300u, 1u), LinearAllocator::InvalidOffset);
+	CHECK_EQ(allocator.GetUsedSize(), 640u);
+}
+
+SCALD_TEST(FramesInFlightNeverOverlap)
+{
+	static constexpr UINT64 Capacity = 64u * 1024u;
+	static constexpr UINT64 FramesInFlight = 3u;
+
+	struct Range
+	{
+		UINT64 Begin;
+		UINT64 End;
+		UINT64 FenceValue;
+	};
+
+	LinearAllocator allocator(Capacity);
+	std::vector<Range> live;
+	std::mt19937 rng(3u);
+	std::uniform_int_distribution<UINT64> size(1u, 3000u);
+	std::uniform_int_distribution<UINT> alignmentShift(0u, 8u);
+	std::uniform_int_distribution<UINT> numAllocations(1u, 12u);
+
+	UINT64 numFailures = 0u;
+	for (UINT64 fence = 1u; fence <= 2000u; ++fence)
+	{
+		// GPU is FramesInFlight frames behind.
+		if (fence > FramesInFlight)
+		{
+			const UINT64 completed = fence - FramesInFlight;
+			allocator.ReleaseCompletedFrames(completed);
+			live.erase(std::remove_if(live.begin(), live.end(), [completed](const Range& r) { return r.FenceValue <= completed; }), live.end());
+		}
+
+		for (UINT i = numAllocations(rng); i > 0u; --i)
+		{
+			const UINT64 allocationSize = size(rng);
+			const UINT64 alignment = 1ull << alignmentShift(rng);
+			const UINT64 offset = allocator.Allocate(allocationSize, alignment);
+			if (offset == LinearAllocator::InvalidOffset)
+			{
+				++numFailures;
+				continue;
+			}
+
+			CHECK_EQ(offset % alignment, 0u);
+			CHECK(offset + allocationSize <= Capacity);
+			for (const Range& r : live)
+			{
+				CHECK(offset + allocationSize <= r.Begin || offset >= r.End);
+			}
+			live.push_back(Range{ offset, offset + allocationSize, fence });
+		}
+
+		allocator.FinishFrame(fence);
+	}
+
+	// The ring is big enough for this load, so it must never run out.
+	CHECK_EQ(numFailures, 0u);
+
+	allocator.ReleaseCompletedFrames(UINT64_MAX);
+	CHECK(allocator.IsEmpty());
+}
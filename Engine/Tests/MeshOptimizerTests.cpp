@@ -0,0 +1,233 @@
+#include "TestHarness.h"
+#include "Core/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+	struct Mesh
+	{
+		std::vector<XMFLOAT3> Positions;
+		std::vector<uint32_t> Indices;
+	};
+
+	// UV sphere of the given radius, triangles wound counter-clockwise seen from outside. Vertices start at baseVertex.
+	void AppendSphere(Mesh& mesh, UINT numSlices, UINT numStacks, float radius)
+	{
+		const uint32_t baseVertex = (uint32_t)mesh.Positions.size();
+		for (UINT stack = 0; stack <= numStacks; ++stack)
+		{
+			const float phi = XM_PI * stack / numStacks;
+			for (UINT slice = 0; slice <= numSlices; ++slice)
+			{
+				const float theta = XM_2PI * slice / numSlices;
+				mesh.Positions.push_back(XMFLOAT3(radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi), radius * std::sin(phi) * std::sin(theta)));
+			}
+		}
+
+		for (UINT stack = 0; stack < numStacks; ++stack)
+		{
+			for (UINT slice = 0; slice < numSlices; ++slice)
+			{
+				const uint32_t i0 = baseVertex + stack * (numSlices + 1u) + slice;
+				const uint32_t i1 = i0 + 1u;
+				const uint32_t i2 = i0 + numSlices + 1u;
+				const uint32_t i3 = i2 + 1u;
+				mesh.Indices.insert(mesh.Indices.end(), { i0, i1, i2, i1, i3, i2 });
+			}
+		}
+	}
+
+	// Fisher-Yates with a fixed LCG, so the shuffled order is the same on every platform.
+	void ShuffleTriangles(std::vector<uint32_t>& indices, uint32_t seed)
+	{
+		const size_t triangleCount = indices.size() / 3u;
+		for (size_t t = triangleCount - 1u; t > 0u; --t)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			const size_t other = (seed >> 8) % (t + 1u);
+			std::swap_ranges(indices.begin() + t * 3u, indices.begin() + t * 3u + 3u, indices.begin() + other * 3u);
+		}
+	}
+
+	// Triangles rotated so the smallest index goes first, keeps the winding. Sorted, so two index buffers
+	// with the same triangles in different order compare equal.
+	std::vector<std::array<uint32_t, 3>> CanonicalTriangles(const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t t = 0; t < indices.size(); t += 3u)
+		{
+			std::array<uint32_t, 3> triangle = { indices[t + 0], indices[t + 1], indices[t + 2] };
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	float ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		return MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount).ACMR;
+	}
+}
+
+SCALD_TEST(AnalyzeVertexCacheSimulatesFifo)
+{
+	// Cache of 3: 0 1 2 miss, 2 hits, 3 misses and pushes 0 out, 0 misses again.
+	const uint32_t indices[] = { 0u, 1u, 2u, 2u, 3u, 0u };
+	const VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(indices, 6u, 4u, 3u);
+	CHECK_EQ(stats.NumTransformedVertices, 5u);
+	CHECK_NEAR(stats.ACMR, 2.5f, 1e-6f);
+	CHECK_NEAR(stats.ATVR, 1.25f, 1e-6f);
+
+	// FIFO, not LRU: hits don't refresh entries, so 3 pushes out 0 although it's just been used, and every vertex after misses.
+	const uint32_t fifoIndices[] = { 0u, 1u, 2u, 0u, 1u, 3u, 0u, 1u, 2u };
+	CHECK_EQ(MeshOptimizer::AnalyzeVertexCache(fifoIndices, 9u, 4u, 3u).NumTransformedVertices, 7u);
+
+	// Big enough cache: every vertex is transformed once.
+	const VertexCacheStats bigCacheStats = MeshOptimizer::AnalyzeVertexCache(fifoIndices, 9u, 4u, 16u);
+	CHECK_EQ(bigCacheStats.NumTransformedVertices, 4u);
+	CHECK_NEAR(bigCacheStats.ATVR, 1.0f, 1e-6f);
+}
+
+SCALD_TEST(WeldVerticesMapsToFirstDuplicate)
+{
+	const XMFLOAT3 vertices[] = {
+		{ 0.0f, 0.0f, 0.0f },
+		{ 1.0f, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, 0.0f },
+		// Equal as floats, but not bitwise: stays a separate vertex.
+		{ -0.0f, 0.0f, 0.0f },
+		{ 1.0f, 0.0f, 0.0f },
+	};
+
+	std::vector<uint32_t> remap;
+	CHECK_EQ(MeshOptimizer::WeldVertices(vertices, 5u, sizeof(XMFLOAT3), remap), 3u);
+	CHECK(remap == std::vector<uint32_t>({ 0u, 1u, 0u, 3u, 1u }));
+}
+
+SCALD_TEST(VertexCacheOptimizationKeepsTrianglesAndImprovesACMR)
+{
+	Mesh mesh;
+	AppendSphere(mesh, 48u, 24u, 1.0f);
+	ShuffleTriangles(mesh.Indices, 12345u);
+	const size_t vertexCount = mesh.Positions.size();
+
+	std::vector<uint32_t> indices = mesh.Indices;
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+
+	// Same triangles with the same winding, only the order changes.
+	CHECK(CanonicalTriangles(indices) == CanonicalTriangles(mesh.Indices));
+
+	// A shuffled order misses nearly every vertex, Forsyth gets a regular mesh well below 1.
+	const float acmrBefore = ComputeACMR(mesh.Indices, vertexCount);
+	const float acmrAfter = ComputeACMR(indices, vertexCount);
+	CHECK(acmrBefore > 2.0f);
+	CHECK(acmrAfter < 0.8f);
+
+	// Deterministic: the same input gives the same order, also when it's already optimized once.
+	std::vector<uint32_t> again = mesh.Indices;
+	MeshOptimizer::OptimizeVertexCache(again.data(), again.size(), vertexCount);
+	CHECK(again == indices);
+
+	std::vector<uint32_t> twice = indices;
+	MeshOptimizer::OptimizeVertexCache(twice.data(), twice.size(), vertexCount);
+	CHECK(ComputeACMR(twice, vertexCount) <= acmrAfter * 1.05f);
+}
+
+SCALD_TEST(OverdrawOptimizationDrawsOuterShellFirst)
+{
+	// Inner sphere comes first in the buffer, it's completely hidden by the outer one.
+	Mesh mesh;
+	AppendSphere(mesh, 32u, 16u, 0.5f);
+	const size_t innerTriangleCount = mesh.Indices.size() / 3u;
+	const uint32_t firstOuterVertex = (uint32_t)mesh.Positions.size();
+	AppendSphere(mesh, 32u, 16u, 1.0f);
+	const size_t vertexCount = mesh.Positions.size();
+
+	std::vector<uint32_t> indices = mesh.Indices;
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+	const float acmrBefore = ComputeACMR(indices, vertexCount);
+	std::vector<uint32_t> cacheOptimized = indices;
+
+	MeshOptimizer::OptimizeOverdraw(indices.data(), indices.size(), mesh.Positions.data(), sizeof(XMFLOAT3), vertexCount);
+
+	CHECK(CanonicalTriangles(indices) == CanonicalTriangles(mesh.Indices));
+	CHECK(ComputeACMR(indices, vertexCount) <= acmrBefore * 1.05f);
+
+	// Half the triangles belong to the outer sphere, most of them should now be in the first half of the buffer.
+	size_t numOuterInFirstHalf = 0u;
+	for (size_t t = 0; t < innerTriangleCount; ++t)
+	{
+		numOuterInFirstHalf += indices[t * 3u] >= firstOuterVertex ? 1u : 0u;
+	}
+	CHECK(numOuterInFirstHalf > innerTriangleCount * 3u / 4u);
+
+	std::vector<uint32_t> again = cacheOptimized;
+	MeshOptimizer::OptimizeOverdraw(again.data(), again.size(), mesh.Positions.data(), sizeof(XMFLOAT3), vertexCount);
+	CHECK(again == indices);
+}
+
+SCALD_TEST(OverdrawOptimizationRespectsThreshold)
+{
+	Mesh mesh;
+	AppendSphere(mesh, 32u, 16u, 0.5f);
+	AppendSphere(mesh, 32u, 16u, 1.0f);
+	const size_t vertexCount = mesh.Positions.size();
+	MeshOptimizer::OptimizeVertexCache(mesh.Indices.data(), mesh.Indices.size(), vertexCount);
+
+	// Any reordering of clusters costs at least the misses at the new cluster boundaries, a threshold below 1 keeps the order.
+	std::vector<uint32_t> indices = mesh.Indices;
+	MeshOptimizer::OptimizeOverdraw(indices.data(), indices.size(), mesh.Positions.data(), sizeof(XMFLOAT3), vertexCount, 0.5f);
+	CHECK(indices == mesh.Indices);
+}
+
+SCALD_TEST(VertexFetchOptimizationRenumbersByFirstUse)
+{
+	std::vector<uint32_t> indices = { 5u, 2u, 4u, 2u, 5u, 0u };
+	std::vector<uint32_t> remap;
+	CHECK_EQ(MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), 7u, remap), 4u);
+
+	CHECK(indices == std::vector<uint32_t>({ 0u, 1u, 2u, 1u, 0u, 3u }));
+	// Vertices 1, 3 and 6 aren't referenced.
+	CHECK(remap == std::vector<uint32_t>({ 3u, UINT32_MAX, 1u, UINT32_MAX, 2u, 0u, UINT32_MAX }));
+}
+
+SCALD_TEST(VertexFetchOptimizationMakesFetchesLinear)
+{
+	Mesh mesh;
+	AppendSphere(mesh, 48u, 24u, 1.0f);
+	ShuffleTriangles(mesh.Indices, 777u);
+	const size_t vertexCount = mesh.Positions.size();
+
+	std::vector<uint32_t> indices = mesh.Indices;
+	std::vector<uint32_t> remap;
+	const size_t newVertexCount = MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+
+	// Every generated vertex is used by some triangle.
+	CHECK_EQ(newVertexCount, vertexCount);
+
+	// Every index is at most one past the highest seen so far, and the remapped triangles are the original ones.
+	uint32_t maxSeen = 0u;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		CHECK(indices[i] <= maxSeen + (i == 0u ? 0u : 1u));
+		maxSeen = std::max(maxSeen, indices[i]);
+	}
+	CHECK_EQ((size_t)maxSeen + 1u, newVertexCount);
+
+	std::vector<uint32_t> inverse(newVertexCount, UINT32_MAX);
+	for (uint32_t v = 0; v < (uint32_t)vertexCount; ++v)
+	{
+		if (remap[v] != UINT32_MAX)
+		{
+			inverse[remap[v]] = v;
+		}
+	}
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		CHECK_EQ(inverse[indices[i]], mesh.Indices[i]);
+	}
+}
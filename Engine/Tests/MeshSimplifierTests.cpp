@@ -0,0 +1,275 @@
+#include "TestHarness.h"
+#include "Core/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+	struct Grid
+	{
+		std::vector<XMFLOAT3> Positions;
+		std::vector<uint32_t> Indices;
+	};
+
+	// Open height field of size x size quads over [0, 1]^2, heights are smooth bumps of the given amplitude.
+	Grid MakeGrid(UINT size, float amplitude, float scale)
+	{
+		Grid grid;
+		for (UINT y = 0; y <= size; ++y)
+		{
+			for (UINT x = 0; x <= size; ++x)
+			{
+				const float u = (float)x / size;
+				const float v = (float)y / size;
+				float height = amplitude * (std::sin(u * 7.3f) * std::cos(v * 5.1f) + 0.3f * std::sin(u * v * 23.0f));
+				// Snapped to 1/1024, so scaled coordinates are exact and a scaled grid is exactly the same shape.
+				height = std::round(height * 1024.0f) / 1024.0f;
+				grid.Positions.push_back(XMFLOAT3(u * scale, height * scale, v * scale));
+			}
+		}
+
+		for (UINT y = 0; y < size; ++y)
+		{
+			for (UINT x = 0; x < size; ++x)
+			{
+				const uint32_t i0 = y * (size + 1u) + x;
+				const uint32_t i1 = i0 + 1u;
+				const uint32_t i2 = i0 + size + 1u;
+				const uint32_t i3 = i2 + 1u;
+				grid.Indices.insert(grid.Indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+		return grid;
+	}
+
+	float DistanceToSegment(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b)
+	{
+		const XMVECTOR ab = XMVectorSubtract(b, a);
+		const float t = XMVectorGetX(XMVector3Dot(XMVectorSubtract(p, a), ab)) / XMVectorGetX(XMVector3LengthSq(ab));
+		const XMVECTOR closest = XMVectorAdd(a, XMVectorScale(ab, std::min(1.0f, std::max(0.0f, t))));
+		return XMVectorGetX(XMVector3Length(XMVectorSubtract(p, closest)));
+	}
+
+	float DistanceToTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		const XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a)));
+		const float planeDistance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(p, a), normal));
+		const XMVECTOR projected = XMVectorSubtract(p, XMVectorScale(normal, planeDistance));
+
+		// Projection inside of all three edges
+		auto isInside = [&](FXMVECTOR e0, FXMVECTOR e1)
+			{
+				return XMVectorGetX(XMVector3Dot(XMVector3Cross(XMVectorSubtract(e1, e0), XMVectorSubtract(projected, e0)), normal)) >= 0.0f;
+			};
+		if (isInside(a, b) && isInside(b, c) && isInside(c, a))
+		{
+			return std::fabs(planeDistance);
+		}
+		return std::min(DistanceToSegment(p, a, b), std::min(DistanceToSegment(p, b, c), DistanceToSegment(p, c, a)));
+	}
+
+	// Largest distance of an original vertex to the simplified surface
+	float MaxDeviation(const Grid& grid, const std::vector<uint32_t>& indices)
+	{
+		float maxDistance = 0.0f;
+		for (const XMFLOAT3& position : grid.Positions)
+		{
+			float distance = FLT_MAX;
+			for (size_t t = 0; t < indices.size(); t += 3u)
+			{
+				distance = std::min(distance, DistanceToTriangle(XMLoadFloat3(&position), XMLoadFloat3(&grid.Positions[indices[t + 0]]),
+					XMLoadFloat3(&grid.Positions[indices[t + 1]]), XMLoadFloat3(&grid.Positions[indices[t + 2]])));
+			}
+			maxDistance = std::max(maxDistance, distance);
+		}
+		return maxDistance;
+	}
+
+	size_t Simplify(const Grid& grid, size_t targetIndexCount, float targetError, std::vector<uint32_t>& outIndices, float& outError)
+	{
+		return MeshSimplifier::Simplify(grid.Positions.data(), sizeof(XMFLOAT3), grid.Positions.size(), grid.Indices.data(), grid.Indices.size(),
+			targetIndexCount, targetError, outIndices, &outError);
+	}
+}
+
+SCALD_TEST(ScaledMeshCollapsesIdentically)
+{
+	// Error bound is the only limit (target count 0), so every decision depends on cost against bound.
+	for (float targetError : { 0.002f, 0.01f, 0.03f })
+	{
+		const Grid grid = MakeGrid(32u, 0.05f, 1.0f);
+		const Grid scaledGrid = MakeGrid(32u, 0.05f, 10.0f);
+
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> scaledIndices;
+		float error = 0.0f;
+		float scaledError = 0.0f;
+		Simplify(grid, 0u, targetError, indices, error);
+		Simplify(scaledGrid, 0u, targetError, scaledIndices, scaledError);
+
+		CHECK(indices.size() < grid.Indices.size());
+		CHECK(indices == scaledIndices);
+		// Both are relative to the extent, so they match too.
+		CHECK_NEAR(error, scaledError, 1e-4f * targetError + 1e-7f);
+		CHECK(error <= targetError);
+		CHECK(error > 0.0f);
+	}
+}
+
+SCALD_TEST(ErrorBoundLimitsSurfaceDeviation)
+{
+	// The bound is a mean squared distance, so the worst vertex may stray a few times further, but not by orders of magnitude.
+	// With area weighted quadrics (length^4 units against a length^2 bound) it strayed 15 times further.
+	for (float targetError : { 0.0005f, 0.001f })
+	{
+		const Grid grid = MakeGrid(32u, 0.05f, 1.0f);
+
+		std::vector<uint32_t> indices;
+		float error = 0.0f;
+		Simplify(grid, 0u, targetError, indices, error);
+		CHECK(indices.size() < grid.Indices.size());
+		// Extent of the grid is 1
+		CHECK(MaxDeviation(grid, indices) <= 6.0f * targetError);
+	}
+}
+
+SCALD_TEST(LargerErrorBoundRemovesMore)
+{
+	const Grid grid = MakeGrid(32u, 0.05f, 3.0f);
+
+	size_t prevCount = grid.Indices.size();
+	for (float targetError : { 0.0005f, 0.002f, 0.01f, 0.05f })
+	{
+		std::vector<uint32_t> indices;
+		float error = 0.0f;
+		const size_t count = Simplify(grid, 0u, targetError, indices, error);
+		CHECK(count <= prevCount);
+		CHECK(error <= targetError);
+		prevCount = count;
+	}
+	CHECK(prevCount < grid.Indices.size() / 4u);
+}
+
+SCALD_TEST(FlatGridCollapsesWithoutError)
+{
+	const Grid grid = MakeGrid(16u, 0.0f, 5.0f);
+
+	std::vector<uint32_t> indices;
+	float error = 1.0f;
+	Simplify(grid, 0u, 1e-4f, indices, error);
+
+	// Coplanar interior vertices cost nothing, borders keep the rest in place.
+	CHECK(indices.size() < grid.Indices.size() / 4u);
+	CHECK_NEAR(error, 0.0f, 1e-5f);
+}
+
+SCALD_TEST(TargetCountStopsCollapsing)
+{
+	const Grid grid = MakeGrid(32u, 0.05f, 1.0f);
+
+	std::vector<uint32_t> indices;
+	float error = 0.0f;
+	const size_t targetIndexCount = grid.Indices.size() / 2u;
+	const size_t count = Simplify(grid, targetIndexCount, 1.0f, indices, error);
+
+	CHECK(count <= targetIndexCount);
+	// A pass overshoots by at most the triangles of one collapse.
+	CHECK(count + 3u * 8u >= targetIndexCount);
+	CHECK_EQ(count % 3u, 0u);
+	for (uint32_t index : indices)
+	{
+		CHECK(index < grid.Positions.size());
+	}
+}
+
+SCALD_TEST(LODChainStaysCloseToLOD0)
+{
+	const Grid grid = MakeGrid(32u, 0.05f, 1.0f);
+	constexpr float MaxError = 0.002f;
+
+	MeshData<VertexPositionNormalTangentUV, uint32_t> mesh;
+	for (const XMFLOAT3& p : grid.Positions)
+	{
+		mesh.LODVertices[0].push_back(VertexPositionNormalTangentUV(p.x, p.y, p.z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, p.x, p.z));
+	}
+	mesh.LODIndices[0] = grid.Indices;
+	MeshSimplifier::BuildLODChain(mesh, 6u, 0.5f, MaxError);
+
+	// What the error bound allows in one go from LOD 0, no level may go past it.
+	std::vector<uint32_t> coarsest;
+	float coarsestError = 0.0f;
+	Simplify(grid, 0u, MaxError, coarsest, coarsestError);
+
+	CHECK(mesh.NumLODs > 2u);
+	CHECK_EQ(mesh.LODVertices.size(), mesh.NumLODs);
+	CHECK_EQ(mesh.LODIndices.size(), mesh.NumLODs);
+	CHECK_EQ(mesh.LODBounds.size(), mesh.NumLODs);
+	for (UINT lod = 1; lod < mesh.NumLODs; ++lod)
+	{
+		const std::vector<VertexPositionNormalTangentUV>& vertices = mesh.LODVertices[lod];
+		const std::vector<uint32_t>& indices = mesh.LODIndices[lod];
+
+		// Strictly coarser than the level before, by no more than the reduction asked for.
+		CHECK(indices.size() < mesh.LODIndices[lod - 1u].size());
+		CHECK(vertices.size() < mesh.LODVertices[lod - 1u].size());
+		CHECK(indices.size() * 10u <= mesh.LODIndices[lod - 1u].size() * 9u);
+		CHECK(indices.size() / 3u >= mesh.LODIndices[lod - 1u].size() / 3u / 2u - 8u);
+
+		// Standalone and compacted: every vertex is used.
+		std::vector<bool> bIsUsed(vertices.size(), false);
+		for (uint32_t index : indices)
+		{
+			CHECK(index < vertices.size());
+			bIsUsed[std::min<size_t>(index, vertices.size() - 1u)] = true;
+		}
+		CHECK(std::find(bIsUsed.begin(), bIsUsed.end(), false) == bIsUsed.end());
+
+		// Against the original surface, not the level it was simplified from, so drift over the chain counts.
+		// Vertices are LOD 0's, in the index space of the grid.
+		std::vector<uint32_t> gridIndices(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			const XMFLOAT3& p = vertices[indices[i]].position;
+			gridIndices[i] = (uint32_t)(std::find_if(grid.Positions.begin(), grid.Positions.end(),
+				[&p](const XMFLOAT3& q) { return p.x == q.x && p.y == q.y && p.z == q.z; }) - grid.Positions.begin());
+			CHECK(gridIndices[i] < grid.Positions.size());
+		}
+		CHECK(MaxDeviation(grid, gridIndices) <= 6.0f * MaxError);
+		CHECK(indices.size() >= coarsest.size());
+	}
+}
+
+SCALD_TEST(ScreenSizeSelectsTheLOD)
+{
+	// A sphere of radius 1 at distance 1 under 90 degrees spans the screen height.
+	CHECK_NEAR(MeshSimplifier::ComputeScreenSize(1.0f, 1.0f, XM_PIDIV2), 1.0f, 1e-6f);
+	// Halves with twice the distance, doubles with twice the radius.
+	CHECK_NEAR(MeshSimplifier::ComputeScreenSize(1.0f, 8.0f, XM_PIDIV2), 0.125f, 1e-6f);
+	CHECK_NEAR(MeshSimplifier::ComputeScreenSize(3.0f, 6.0f, XM_PIDIV2), 0.5f, 1e-6f);
+
+	constexpr float LOD1ScreenSize = 0.5f;
+	CHECK_EQ(MeshSimplifier::SelectLOD(2.0f, 4u, LOD1ScreenSize), 0u);
+	// Thresholds are inclusive on the finer side: exactly at one, the finer LOD is kept.
+	CHECK_EQ(MeshSimplifier::SelectLOD(0.5f, 4u, LOD1ScreenSize), 0u);
+	CHECK_EQ(MeshSimplifier::SelectLOD(0.499f, 4u, LOD1ScreenSize), 1u);
+	CHECK_EQ(MeshSimplifier::SelectLOD(0.25f, 4u, LOD1ScreenSize), 1u);
+	CHECK_EQ(MeshSimplifier::SelectLOD(0.249f, 4u, LOD1ScreenSize), 2u);
+	CHECK_EQ(MeshSimplifier::SelectLOD(0.125f, 4u, LOD1ScreenSize), 2u);
+	CHECK_EQ(MeshSimplifier::SelectLOD(0.124f, 4u, LOD1ScreenSize), 3u);
+
+	// Clamped to the last LOD, however small.
+	CHECK_EQ(MeshSimplifier::SelectLOD(1e-6f, 4u, LOD1ScreenSize), 3u);
+	CHECK_EQ(MeshSimplifier::SelectLOD(0.0f, 2u, LOD1ScreenSize), 1u);
+	CHECK_EQ(MeshSimplifier::SelectLOD(0.0f, 1u, LOD1ScreenSize), 0u);
+
+	// Moving away never selects a finer LOD.
+	UINT prevLOD = 0u;
+	for (float distance = 0.5f; distance < 500.0f; distance *= 1.01f)
+	{
+		const UINT lod = MeshSimplifier::SelectLOD(MeshSimplifier::ComputeScreenSize(1.0f, distance, 1.0471976f), 5u, LOD1ScreenSize);
+		CHECK(lod >= prevLOD);
+		prevLOD = lod;
+	}
+	CHECK_EQ(prevLOD, 4u);
+}
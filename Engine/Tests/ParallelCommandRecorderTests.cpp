@@ -0,0 +1,198 @@
+#include "TestHarness.h"
+#include "Core/ParallelCommandRecorder.h"
+
+namespace
+{
+	// Stands in for ID3D12GraphicsCommandList: remembers what the pass callbacks recorded into it.
+	struct MockCommandList
+	{
+		enum ECommand
+		{
+			BindStateCmd,
+			BeginCmd,
+			DrawCmd,
+			EndCmd
+		};
+
+		struct Command
+		{
+			ECommand Type;
+			UINT Pass;
+			UINT DrawBegin;
+			UINT DrawEnd;
+		};
+
+		std::vector<Command> Commands;
+	};
+
+	using Recorder = ParallelCommandRecorder<MockCommandList>;
+
+	std::vector<Recorder::Pass> MakePasses(const std::vector<UINT>& numDrawsPerPass)
+	{
+		std::vector<Recorder::Pass> passes(numDrawsPerPass.size());
+		for (UINT p = 0; p < (UINT)passes.size(); ++p)
+		{
+			Recorder::Pass& pass = passes[p];
+			pass.NumDraws = numDrawsPerPass[p];
+			pass.BindState = [p](MockCommandList* list) { list->Commands.push_back({ MockCommandList::BindStateCmd, p, 0u, 0u }); };
+			pass.Begin = [p](MockCommandList* list) { list->Commands.push_back({ MockCommandList::BeginCmd, p, 0u, 0u }); };
+			pass.DrawRange = [p](MockCommandList* list, UINT begin, UINT end) { list->Commands.push_back({ MockCommandList::DrawCmd, p, begin, end }); };
+			pass.End = [p](MockCommandList* list) { list->Commands.push_back({ MockCommandList::EndCmd, p, 0u, 0u }); };
+		}
+		return passes;
+	}
+
+	// Records the passes and checks the command lists, concatenated in submission order, replay every pass
+	// as Begin, its draws in order without gaps or overlaps, End, one pass after another.
+	void RecordAndCheck(const std::vector<UINT>& numDrawsPerPass, UINT maxTasks)
+	{
+		const std::vector<Recorder::Pass> passes = MakePasses(numDrawsPerPass);
+
+		Recorder recorder;
+		const std::vector<RecordingTask>& tasks = recorder.Schedule(passes, maxTasks);
+		CHECK(tasks.size() >= passes.size());
+		CHECK(tasks.size() <= maxTasks);
+
+		std::vector<MockCommandList> lists(tasks.size());
+		std::vector<MockCommandList*> listPtrs;
+		for (MockCommandList& list : lists)
+		{
+			listPtrs.push_back(&list);
+		}
+		recorder.Record(passes, listPtrs.data());
+
+		std::vector<UINT> numBegins(passes.size(), 0u);
+		std::vector<UINT> numEnds(passes.size(), 0u);
+		UINT currPass = 0u;
+		UINT nextDraw = 0u;
+		for (size_t t = 0; t < tasks.size(); ++t)
+		{
+			const std::vector<MockCommandList::Command>& commands = lists[t].Commands;
+
+			// State is bound first in every list, since lists don't inherit it.
+			CHECK(!commands.empty() && commands[0].Type == MockCommandList::BindStateCmd && commands[0].Pass == tasks[t].PassIndex);
+
+			for (const MockCommandList::Command& command : commands)
+			{
+				if (command.Pass != currPass)
+				{
+					// Submission order moves to the next pass only after the previous one has been ended and fully drawn.
+					CHECK_EQ(command.Pass, currPass + 1u);
+					CHECK_EQ(numEnds[currPass], 1u);
+					CHECK_EQ(nextDraw, numDrawsPerPass[currPass]);
+					currPass = command.Pass;
+					nextDraw = 0u;
+				}
+
+				switch (command.Type)
+				{
+				case MockCommandList::BeginCmd:
+					++numBegins[command.Pass];
+					CHECK_EQ(nextDraw, 0u);
+					break;
+				case MockCommandList::DrawCmd:
+					CHECK_EQ(numBegins[command.Pass], 1u);
+					CHECK_EQ(command.DrawBegin, nextDraw);
+					CHECK(command.DrawBegin < command.DrawEnd);
+					nextDraw = command.DrawEnd;
+					break;
+				case MockCommandList::EndCmd:
+					++numEnds[command.Pass];
+					CHECK_EQ(nextDraw, numDrawsPerPass[command.Pass]);
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		CHECK_EQ(currPass + 1u, (UINT)passes.size());
+		for (size_t p = 0; p < passes.size(); ++p)
+		{
+			CHECK_EQ(numBegins[p], 1u);
+			CHECK_EQ(numEnds[p], 1u);
+		}
+	}
+
+	const std::vector<UINT> PassSizes[] = {
+		{ 0u },
+		{ 1u },
+		{ 5000u },
+		{ 10u, 0u, 3000u },
+		{ 64u, 65u, 127u, 128u },
+		{ 20000u, 1u, 700u, 0u, 4096u },
+	};
+}
+
+SCALD_TEST(ScheduleSplitsPassesIntoContiguousRanges)
+{
+	for (const std::vector<UINT>& sizes : PassSizes)
+	{
+		for (UINT maxTasks : { (UINT)sizes.size(), 8u, 32u })
+		{
+			if (maxTasks < sizes.size())
+			{
+				continue;
+			}
+
+			std::vector<RecordingTask> tasks;
+			RecordingScheduler::Schedule(sizes.data(), (UINT)sizes.size(), maxTasks, 64u, tasks);
+			CHECK(tasks.size() <= maxTasks);
+
+			size_t t = 0;
+			for (UINT p = 0; p < (UINT)sizes.size(); ++p)
+			{
+				// Tasks of a pass are consecutive, start at draw 0 and end at the last draw, flagged first and last once.
+				CHECK(t < tasks.size() && tasks[t].PassIndex == p && tasks[t].bIsFirstInPass);
+				UINT nextDraw = 0u;
+				UINT numTasks = 0u;
+				for (; t < tasks.size() && tasks[t].PassIndex == p; ++t, ++numTasks)
+				{
+					CHECK_EQ(tasks[t].DrawBegin, nextDraw);
+					CHECK(tasks[t].DrawEnd >= tasks[t].DrawBegin);
+					CHECK_EQ(tasks[t].bIsFirstInPass, numTasks == 0u);
+					// A split pass never gets chunks below the minimum.
+					CHECK(numTasks == 0u || tasks[t].DrawEnd - tasks[t].DrawBegin >= 64u);
+					nextDraw = tasks[t].DrawEnd;
+				}
+				CHECK(tasks[t - 1u].bIsLastInPass);
+				CHECK_EQ(nextDraw, sizes[p]);
+			}
+			CHECK_EQ(t, tasks.size());
+		}
+	}
+}
+
+SCALD_TEST(BigPassesAreSplit)
+{
+	const UINT sizes[] = { 10000u, 10u };
+	std::vector<RecordingTask> tasks;
+	RecordingScheduler::Schedule(sizes, 2u, 16u, 64u, tasks);
+
+	// The small pass doesn't need more than one task, so the big one gets the spare ones (shares are rounded down).
+	CHECK_EQ(tasks.size(), 15u);
+	CHECK_EQ(tasks.back().PassIndex, 1u);
+	CHECK(tasks.back().bIsFirstInPass && tasks.back().bIsLastInPass);
+}
+
+SCALD_TEST(RecordOnCallingThread)
+{
+	// Job system is not initialized, ParallelFor records everything on this thread.
+	for (const std::vector<UINT>& sizes : PassSizes)
+	{
+		RecordAndCheck(sizes, 24u);
+	}
+}
+
+SCALD_TEST(RecordOnJobSystem)
+{
+	JobSystem::Get().Init(3u);
+	for (int repeat = 0; repeat < 20; ++repeat)
+	{
+		for (const std::vector<UINT>& sizes : PassSizes)
+		{
+			RecordAndCheck(sizes, 24u);
+		}
+	}
+	JobSystem::Get().Shutdown();
+}
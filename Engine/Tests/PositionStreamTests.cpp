@@ -0,0 +1,104 @@
+#include "TestHarness.h"
+#include "Core/VertexCompression.h"
+
+#include <cstring>
+
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	std::vector<VertexPositionNormalTangentUV> MakeVertices(UINT count)
+	{
+		std::vector<VertexPositionNormalTangentUV> vertices;
+		for (UINT i = 0; i < count; ++i)
+		{
+			const float t = (float)i;
+			vertices.emplace_back(std::sin(t) * 3.0f, std::cos(t * 0.7f) * 2.0f, t * 0.01f - 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, t * 0.1f, 1.0f - t * 0.1f);
+		}
+		return vertices;
+	}
+
+	std::vector<VertexPositionNormalTangentUVPacked> Pack(const std::vector<VertexPositionNormalTangentUV>& vertices)
+	{
+		const BoundingBox bounds(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(3.0f, 2.0f, 2.0f));
+		std::vector<VertexPositionNormalTangentUVPacked> packed(vertices.size());
+		VertexCompression::Encode(vertices.data(), vertices.size(), PositionDequantization::FromBounds(bounds), packed.data(), -1.0f);
+		return packed;
+	}
+
+	// What the input assembler fetches for vertex i: the first element of the layout, at offset 0 of a stride sized record.
+	XMUSHORTN4 FetchPosition(const void* pBuffer, size_t stride, size_t i)
+	{
+		XMUSHORTN4 position;
+		memcpy(&position, static_cast<const uint8_t*>(pBuffer) + i * stride, sizeof(position));
+		return position;
+	}
+
+	bool operator==(const XMUSHORTN4& lhs, const XMUSHORTN4& rhs)
+	{
+		return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z && lhs.w == rhs.w;
+	}
+}
+
+SCALD_TEST(SplitKeepsVertexCountAndOrder)
+{
+	const std::vector<VertexPositionNormalTangentUVPacked> vertices = Pack(MakeVertices(1000u));
+
+	std::vector<VertexPositionPacked> positions;
+	SplitPositionStream(vertices, positions);
+
+	// Same vertex count and order, so the draw arguments of the interleaved buffer work for the stream as is.
+	CHECK_EQ(positions.size(), vertices.size());
+	UINT numWrong = 0u;
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		// Bitangent sign in w included, the stream is a bitwise copy.
+		numWrong += positions[i].position == vertices[i].position ? 0u : 1u;
+	}
+	CHECK_EQ(numWrong, 0u);
+	CHECK_EQ(sizeof(VertexPositionPacked), 8u);
+}
+
+SCALD_TEST(SplitReplacesPreviousContent)
+{
+	std::vector<VertexPositionPacked> positions(5u);
+	SplitPositionStream(std::vector<VertexPositionNormalTangentUVPacked>(), positions);
+	CHECK(positions.empty());
+
+	SplitPositionStream(Pack(MakeVertices(3u)), positions);
+	CHECK_EQ(positions.size(), 3u);
+	SplitPositionStream(Pack(MakeVertices(2u)), positions);
+	CHECK_EQ(positions.size(), 2u);
+}
+
+SCALD_TEST(SplitUnpackedVertices)
+{
+	const std::vector<VertexPositionNormalTangentUV> vertices = MakeVertices(100u);
+
+	std::vector<VertexPosition> positions;
+	SplitPositionStream(vertices, positions);
+
+	CHECK_EQ(positions.size(), vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		CHECK_EQ(memcmp(&positions[i].position, &vertices[i].position, sizeof(XMFLOAT3)), 0);
+	}
+}
+
+SCALD_TEST(InterleavedFallbackFetchesSamePositions)
+{
+	// Geometry without a position stream is drawn by the shadow pass from the interleaved buffer, with the
+	// position stream's input layout. Both buffers have to give the same position for every vertex.
+	const std::vector<VertexPositionNormalTangentUVPacked> vertices = Pack(MakeVertices(257u));
+	std::vector<VertexPositionPacked> positions;
+	SplitPositionStream(vertices, positions);
+
+	UINT numWrong = 0u;
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const XMUSHORTN4 fromStream = FetchPosition(positions.data(), sizeof(VertexPositionPacked), i);
+		const XMUSHORTN4 fromInterleaved = FetchPosition(vertices.data(), sizeof(VertexPositionNormalTangentUVPacked), i);
+		numWrong += fromStream == fromInterleaved ? 0u : 1u;
+	}
+	CHECK_EQ(numWrong, 0u);
+}
@@ -0,0 +1,503 @@
+#include "TestHarness.h"
+#include "Core/RenderGraph.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	constexpr UINT64 MB = 1024u * 1024u;
+
+	RenderGraphResourceDesc MakeTransient(const char* name, UINT64 sizeInBytes, UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+	{
+		RenderGraphResourceDesc desc;
+		desc.Name = name;
+		desc.bIsTransient = true;
+		desc.InitialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+		desc.SizeInBytes = sizeInBytes;
+		desc.Alignment = alignment;
+		return desc;
+	}
+
+	RenderGraphResourceDesc MakeBackBuffer()
+	{
+		RenderGraphResourceDesc desc;
+		desc.Name = "Back Buffer";
+		desc.InitialState = D3D12_RESOURCE_STATE_PRESENT;
+		return desc;
+	}
+
+	bool IsTransition(const RenderGraphBarrier& barrier, UINT resource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+	{
+		return barrier.Type == RenderGraphBarrier::Transition && barrier.Resource == resource && barrier.StateBefore == stateBefore && barrier.StateAfter == stateAfter;
+	}
+
+	bool IsAliasing(const RenderGraphBarrier& barrier, UINT resource, UINT resourceBefore)
+	{
+		return barrier.Type == RenderGraphBarrier::Aliasing && barrier.Resource == resource && barrier.ResourceBefore == resourceBefore;
+	}
+
+	// What the test declared, to check the compiled graph against.
+	struct DeclaredAccess
+	{
+		UINT Pass = 0u;
+		UINT Resource = 0u;
+		D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+		bool bIsWrite = false;
+	};
+
+	// Records the barriers of two frames like the engine does, tracking every resource's state. Each barrier has to start
+	// from the state the resource is in, every pass finds its resources in the states it declared.
+	UINT CountStateMismatches(const RenderGraph& graph, const std::vector<DeclaredAccess>& accesses)
+	{
+		UINT numMismatches = 0u;
+		std::vector<D3D12_RESOURCE_STATES> states(graph.GetNumResources());
+		for (UINT i = 0; i < graph.GetNumResources(); ++i)
+		{
+			states[i] = graph.GetResourceDesc(i).InitialState;
+		}
+
+		auto Record = [&](const std::vector<RenderGraphBarrier>& barriers)
+			{
+				for (const RenderGraphBarrier& barrier : barriers)
+				{
+					if (barrier.Type == RenderGraphBarrier::Transition)
+					{
+						numMismatches += states[barrier.Resource] == barrier.StateBefore ? 0u : 1u;
+						states[barrier.Resource] = barrier.StateAfter;
+					}
+				}
+			};
+
+		Record(graph.GetSetupBarriers());
+		for (UINT frame = 0; frame < 2u; ++frame)
+		{
+			for (UINT pass = 0; pass < graph.GetNumPasses(); ++pass)
+			{
+				Record(graph.GetPassBarriers(pass));
+				if (graph.IsPassCulled(pass))
+				{
+					continue;
+				}
+
+				for (const DeclaredAccess& access : accesses)
+				{
+					if (access.Pass == pass)
+					{
+						// Reads may be in a combined state, writes in exactly the one declared.
+						const D3D12_RESOURCE_STATES state = states[access.Resource];
+						numMismatches += (access.bIsWrite ? state == access.State : (state & access.State) == access.State) ? 0u : 1u;
+					}
+				}
+			}
+			Record(graph.GetEndBarriers());
+
+			// Imported resources are back where they started.
+			for (UINT i = 0; i < graph.GetNumResources(); ++i)
+			{
+				if (!graph.GetResourceDesc(i).bIsTransient)
+				{
+					numMismatches += states[i] == graph.GetResourceDesc(i).InitialState ? 0u : 1u;
+				}
+			}
+		}
+		return numMismatches;
+	}
+}
+
+SCALD_TEST(PassesNothingDependsOnAreCulled)
+{
+	RenderGraph graph;
+	const UINT scene = graph.AddResource(MakeTransient("Scene", 4u * MB));
+	const UINT unused = graph.AddResource(MakeTransient("Unused", 4u * MB));
+	const UINT chainA = graph.AddResource(MakeTransient("Chain A", 4u * MB));
+	const UINT chainB = graph.AddResource(MakeTransient("Chain B", 4u * MB));
+	const UINT readback = graph.AddResource(MakeTransient("Readback", 1u * MB));
+	const UINT backBuffer = graph.AddResource(MakeBackBuffer());
+
+	const UINT draw = graph.AddPass("Draw");
+	const UINT debugDraw = graph.AddPass("Debug Draw");
+	const UINT chainFirst = graph.AddPass("Chain First");
+	const UINT chainSecond = graph.AddPass("Chain Second");
+	const UINT capture = graph.AddPass("Capture", true);
+	const UINT present = graph.AddPass("Present");
+
+	graph.Write(draw, scene, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Write(debugDraw, unused, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	// Feeds a pass which is culled itself.
+	graph.Write(chainFirst, chainA, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(chainSecond, chainA, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(chainSecond, chainB, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	// Side effects keep a pass and what it reads.
+	graph.Read(capture, scene, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	graph.Write(capture, readback, D3D12_RESOURCE_STATE_COPY_DEST);
+	graph.Read(present, scene, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(present, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+
+	CHECK(!graph.IsPassCulled(draw));
+	CHECK(graph.IsPassCulled(debugDraw));
+	CHECK(graph.IsPassCulled(chainFirst));
+	CHECK(graph.IsPassCulled(chainSecond));
+	CHECK(!graph.IsPassCulled(capture));
+	CHECK(!graph.IsPassCulled(present));
+	CHECK_EQ(graph.GetStats().NumPasses, 6u);
+	CHECK_EQ(graph.GetStats().NumCulledPasses, 3u);
+
+	// Culled passes have no barriers and their resources take no memory.
+	for (UINT pass : { debugDraw, chainFirst, chainSecond })
+	{
+		CHECK(graph.GetPassBarriers(pass).empty());
+	}
+	for (UINT resource : { unused, chainA, chainB })
+	{
+		CHECK_EQ(graph.GetHeapOffset(resource), RenderGraph::InvalidOffset);
+	}
+	CHECK_EQ(graph.GetHeapOffset(backBuffer), RenderGraph::InvalidOffset);
+	CHECK(graph.GetHeapOffset(scene) != RenderGraph::InvalidOffset);
+	CHECK(graph.GetHeapOffset(readback) != RenderGraph::InvalidOffset);
+	CHECK_EQ(graph.GetStats().TransientBytes, 5u * MB);
+
+	// The report lists culled passes.
+	CHECK(graph.BuildReport().find("Debug Draw: culled") != std::string::npos);
+
+	// Recompiling after a consumer is added keeps the pass.
+	const UINT overlay = graph.AddPass("Overlay");
+	graph.Read(overlay, unused, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(overlay, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+	CHECK(!graph.IsPassCulled(debugDraw));
+	CHECK_EQ(graph.GetStats().NumCulledPasses, 2u);
+}
+
+SCALD_TEST(ConsecutiveReadsShareOneTransition)
+{
+	RenderGraph graph;
+	const UINT depth = graph.AddResource(MakeTransient("Depth", 8u * MB));
+	const UINT backBuffer = graph.AddResource(MakeBackBuffer());
+
+	const UINT prepass = graph.AddPass("Depth Prepass");
+	const UINT occlusion = graph.AddPass("Occlusion");
+	const UINT lighting = graph.AddPass("Lighting");
+	const UINT sky = graph.AddPass("Sky");
+	const UINT decals = graph.AddPass("Decals");
+
+	graph.Write(prepass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	graph.Read(occlusion, depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	graph.Write(occlusion, backBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	// Several states in one pass combine.
+	graph.Read(lighting, depth, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Read(lighting, depth, D3D12_RESOURCE_STATE_DEPTH_READ);
+	graph.Write(lighting, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(sky, depth, D3D12_RESOURCE_STATE_DEPTH_READ);
+	graph.Write(sky, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	// Written again, which ends the run of reads.
+	graph.Write(decals, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	graph.Write(decals, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+
+	const D3D12_RESOURCE_STATES readState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_DEPTH_READ;
+
+	// Left in depth write by the previous frame's decals, so it starts there.
+	CHECK_EQ(graph.GetSetupBarriers().size(), (size_t)1u);
+	CHECK(IsTransition(graph.GetSetupBarriers()[0], depth, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+	CHECK(graph.GetPassBarriers(prepass).empty());
+
+	// One transition into the union of the three reads.
+	CHECK_EQ(graph.GetPassBarriers(occlusion).size(), (size_t)2u);
+	CHECK(IsTransition(graph.GetPassBarriers(occlusion)[0], depth, D3D12_RESOURCE_STATE_DEPTH_WRITE, readState));
+	CHECK(IsTransition(graph.GetPassBarriers(occlusion)[1], backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	CHECK_EQ(graph.GetPassBarriers(lighting).size(), (size_t)1u);
+	CHECK(IsTransition(graph.GetPassBarriers(lighting)[0], backBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	CHECK(graph.GetPassBarriers(sky).empty());
+	CHECK_EQ(graph.GetPassBarriers(decals).size(), (size_t)1u);
+	CHECK(IsTransition(graph.GetPassBarriers(decals)[0], depth, readState, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+
+	CHECK_EQ(graph.GetEndBarriers().size(), (size_t)1u);
+	CHECK(IsTransition(graph.GetEndBarriers()[0], backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+
+	const RenderGraphStats& stats = graph.GetStats();
+	CHECK_EQ(stats.NumTransitions, 5u);
+	CHECK_EQ(stats.NumBarrierBatches, 4u);
+	// Every access out of the initial state and back.
+	CHECK_EQ(stats.NumUnmergedTransitions, 18u);
+
+	std::vector<DeclaredAccess> accesses =
+	{
+		{ prepass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE, true },
+		{ occlusion, depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, false },
+		{ occlusion, backBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true },
+		{ lighting, depth, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_DEPTH_READ, false },
+		{ lighting, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true },
+		{ sky, depth, D3D12_RESOURCE_STATE_DEPTH_READ, false },
+		{ sky, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true },
+		{ decals, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE, true },
+		{ decals, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true },
+	};
+	CHECK_EQ(CountStateMismatches(graph, accesses), 0u);
+}
+
+SCALD_TEST(EngineFrameBarriers)
+{
+	// The deferred frame the engine builds, with one GBuffer layer.
+	RenderGraph graph;
+	const UINT albedo = graph.AddResource(MakeTransient("Diffuse Albedo", 8u * MB));
+	const UINT depth = graph.AddResource(MakeTransient("GBuffer Depth", 8u * MB));
+	const UINT shadowMap = graph.AddResource(MakeTransient("Cascade Shadow Map", 16u * MB));
+	const UINT backBuffer = graph.AddResource(MakeBackBuffer());
+
+	const UINT shadow = graph.AddPass("Shadow Depth");
+	const UINT geometry = graph.AddPass("GBuffer Geometry");
+	const UINT lighting = graph.AddPass("Lighting");
+	const UINT sky = graph.AddPass("Sky Box");
+
+	graph.Write(shadow, shadowMap, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	graph.Write(geometry, albedo, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Write(geometry, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	graph.Read(lighting, albedo, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Read(lighting, depth, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Read(lighting, shadowMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(lighting, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(sky, depth, D3D12_RESOURCE_STATE_DEPTH_READ);
+	graph.Write(sky, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+
+	const D3D12_RESOURCE_STATES depthReadState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_DEPTH_READ;
+
+	CHECK_EQ(graph.GetSetupBarriers().size(), (size_t)3u);
+	CHECK(IsTransition(graph.GetSetupBarriers()[0], albedo, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	CHECK(IsTransition(graph.GetSetupBarriers()[1], depth, D3D12_RESOURCE_STATE_GENERIC_READ, depthReadState));
+	CHECK(IsTransition(graph.GetSetupBarriers()[2], shadowMap, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+	CHECK_EQ(graph.GetPassBarriers(shadow).size(), (size_t)1u);
+	CHECK(IsTransition(graph.GetPassBarriers(shadow)[0], shadowMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+	CHECK_EQ(graph.GetPassBarriers(geometry).size(), (size_t)2u);
+	CHECK(IsTransition(graph.GetPassBarriers(geometry)[0], albedo, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	CHECK(IsTransition(graph.GetPassBarriers(geometry)[1], depth, depthReadState, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+	CHECK_EQ(graph.GetPassBarriers(lighting).size(), (size_t)4u);
+	CHECK(IsTransition(graph.GetPassBarriers(lighting)[0], albedo, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	CHECK(IsTransition(graph.GetPassBarriers(lighting)[1], depth, D3D12_RESOURCE_STATE_DEPTH_WRITE, depthReadState));
+	CHECK(IsTransition(graph.GetPassBarriers(lighting)[2], shadowMap, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	CHECK(IsTransition(graph.GetPassBarriers(lighting)[3], backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	// Depth is already readable for the depth test.
+	CHECK(graph.GetPassBarriers(sky).empty());
+	CHECK_EQ(graph.GetEndBarriers().size(), (size_t)1u);
+
+	const RenderGraphStats& stats = graph.GetStats();
+	CHECK_EQ(stats.NumCulledPasses, 0u);
+	CHECK_EQ(stats.NumTransitions, 8u);
+	CHECK_EQ(stats.NumAliasingBarriers, 0u);
+	CHECK_EQ(stats.NumBarrierBatches, 4u);
+	CHECK_EQ(stats.NumUnmergedTransitions, 18u);
+
+	// Every transient lives along with the others, nothing is shared.
+	CHECK_EQ(stats.TransientBytes, 32u * MB);
+	CHECK_EQ(stats.TransientHeapBytes, 32u * MB);
+}
+
+SCALD_TEST(DisjointLifetimesShareMemory)
+{
+	RenderGraph graph;
+	const UINT a = graph.AddResource(MakeTransient("A", 4u * MB));
+	const UINT b = graph.AddResource(MakeTransient("B", 4u * MB));
+	const UINT c = graph.AddResource(MakeTransient("C", 2u * MB));
+	const UINT backBuffer = graph.AddResource(MakeBackBuffer());
+
+	const UINT passes[] = { graph.AddPass("0"), graph.AddPass("1"), graph.AddPass("2"), graph.AddPass("3") };
+	graph.Write(passes[0], a, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(passes[1], a, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(passes[1], b, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(passes[2], b, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(passes[2], c, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	graph.Read(passes[3], c, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(passes[3], backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+
+	// A and C never live at once, so C goes to A's memory, B next to both.
+	CHECK_EQ(graph.GetHeapOffset(a), 0u);
+	CHECK_EQ(graph.GetHeapOffset(b), 4u * MB);
+	CHECK_EQ(graph.GetHeapOffset(c), 0u);
+	CHECK_EQ(graph.GetStats().TransientBytes, 10u * MB);
+	CHECK_EQ(graph.GetTransientHeapSize(), 8u * MB);
+
+	// Each takes the memory over from the other, A from the previous frame's C. Aliasing goes first in the batch.
+	CHECK_EQ(graph.GetStats().NumAliasingBarriers, 2u);
+	CHECK(IsAliasing(graph.GetPassBarriers(passes[0]).front(), a, c));
+	CHECK(IsAliasing(graph.GetPassBarriers(passes[2]).front(), c, a));
+	CHECK(std::none_of(graph.GetPassBarriers(passes[1]).begin(), graph.GetPassBarriers(passes[1]).end(),
+		[](const RenderGraphBarrier& barrier) { return barrier.Type == RenderGraphBarrier::Aliasing; }));
+
+	// A resource sharing memory with several others doesn't name one.
+	RenderGraph shared;
+	const UINT big = shared.AddResource(MakeTransient("Big", 8u * MB));
+	const UINT small0 = shared.AddResource(MakeTransient("Small 0", 4u * MB));
+	const UINT small1 = shared.AddResource(MakeTransient("Small 1", 4u * MB));
+	const UINT sharedBackBuffer = shared.AddResource(MakeBackBuffer());
+	const UINT first = shared.AddPass("First");
+	const UINT second = shared.AddPass("Second");
+	const UINT third = shared.AddPass("Third");
+	shared.Write(first, small0, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	shared.Write(first, small1, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	shared.Read(second, small0, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	shared.Read(second, small1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	shared.Write(second, sharedBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	shared.Write(third, big, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	shared.Write(third, sharedBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	shared.Compile();
+
+	CHECK_EQ(shared.GetTransientHeapSize(), 8u * MB);
+	CHECK(IsAliasing(shared.GetPassBarriers(third).front(), big, RenderGraph::InvalidIndex));
+	CHECK(IsAliasing(shared.GetPassBarriers(first)[0], small0, big));
+	CHECK(IsAliasing(shared.GetPassBarriers(first)[1], small1, big));
+}
+
+SCALD_TEST(ResizedTransientsArePlacedAgain)
+{
+	RenderGraph graph;
+	const UINT albedo = graph.AddResource(MakeTransient("Diffuse Albedo", 8u * MB));
+	const UINT shadowMap = graph.AddResource(MakeTransient("Cascade Shadow Map", 16u * MB));
+	const UINT backBuffer = graph.AddResource(MakeBackBuffer());
+
+	const UINT shadow = graph.AddPass("Shadow Depth");
+	const UINT geometry = graph.AddPass("GBuffer Geometry");
+	const UINT lighting = graph.AddPass("Lighting");
+	graph.Write(shadow, shadowMap, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	graph.Write(geometry, albedo, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Read(lighting, albedo, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Read(lighting, shadowMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(lighting, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+
+	CHECK_EQ(graph.GetHeapOffset(shadowMap), 0u);
+	CHECK_EQ(graph.GetHeapOffset(albedo), 16u * MB);
+	CHECK_EQ(graph.GetTransientHeapSize(), 24u * MB);
+	const std::vector<RenderGraphBarrier> setupBarriers = graph.GetSetupBarriers();
+	const RenderGraphStats stats = graph.GetStats();
+
+	// A window grown past the shadow map moves the GBuffer layer to the front.
+	graph.SetTransientSize(albedo, 20u * MB, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+	graph.Compile();
+
+	CHECK_EQ(graph.GetResourceDesc(albedo).SizeInBytes, 20u * MB);
+	CHECK_EQ(graph.GetHeapOffset(albedo), 0u);
+	CHECK_EQ(graph.GetHeapOffset(shadowMap), 20u * MB);
+	CHECK_EQ(graph.GetTransientHeapSize(), 36u * MB);
+	CHECK_EQ(graph.GetStats().TransientBytes, 36u * MB);
+
+	// Only the placement changes, the barriers are built the same again rather than appended to.
+	CHECK_EQ(graph.GetSetupBarriers().size(), setupBarriers.size());
+	for (size_t i = 0; i < setupBarriers.size(); ++i)
+	{
+		CHECK(IsTransition(graph.GetSetupBarriers()[i], setupBarriers[i].Resource, setupBarriers[i].StateBefore, setupBarriers[i].StateAfter));
+	}
+	CHECK_EQ(graph.GetStats().NumTransitions, stats.NumTransitions);
+	CHECK_EQ(graph.GetStats().NumAliasingBarriers, 0u);
+	CHECK_EQ(graph.GetStats().NumBarrierBatches, stats.NumBarrierBatches);
+	CHECK_EQ(graph.GetPassBarriers(lighting).size(), (size_t)3u);
+}
+
+SCALD_TEST(RandomGraphsPlaceAndTransitionConsistently)
+{
+	std::mt19937 random(1u);
+	std::uniform_int_distribution<UINT> sizes(1u, 64u);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	const D3D12_RESOURCE_STATES readStates[] = { D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_READ, D3D12_RESOURCE_STATE_COPY_SOURCE };
+	const D3D12_RESOURCE_STATES writeStates[] = { D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST };
+	const UINT64 alignments[] = { 64u * 1024u, 4u * MB };
+
+	UINT numMismatches = 0u;
+	UINT numOverlaps = 0u;
+	UINT numMisaligned = 0u;
+	UINT numShared = 0u;
+	for (UINT test = 0; test < 200u; ++test)
+	{
+		RenderGraph graph;
+		std::vector<DeclaredAccess> accesses;
+		const UINT backBuffer = graph.AddResource(MakeBackBuffer());
+
+		// Every pass writes a new transient, reads a few earlier ones and sometimes the back buffer.
+		const UINT numPasses = 4u + test % 24u;
+		for (UINT pass = 0; pass < numPasses; ++pass)
+		{
+			graph.AddPass(std::to_string(pass), unit(random) < 0.05f);
+
+			const UINT written = graph.AddResource(MakeTransient("T", sizes(random) * 64u * 1024u, alignments[random() % 2u]));
+			accesses.push_back({ pass, written, writeStates[random() % 4u], true });
+
+			std::vector<UINT> read;
+			for (UINT i = 0; i < 3u && written > 1u; ++i)
+			{
+				const UINT resource = 1u + random() % (written - 1u);
+				if (std::find(read.begin(), read.end(), resource) == read.end())
+				{
+					read.push_back(resource);
+					accesses.push_back({ pass, resource, readStates[random() % 4u], false });
+				}
+			}
+			if (unit(random) < 0.2f || pass == numPasses - 1u)
+			{
+				accesses.push_back({ pass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true });
+			}
+		}
+		for (const DeclaredAccess& access : accesses)
+		{
+			if (access.bIsWrite)
+			{
+				graph.Write(access.Pass, access.Resource, access.State);
+			}
+			else
+			{
+				graph.Read(access.Pass, access.Resource, access.State);
+			}
+		}
+		graph.Compile();
+
+		numMismatches += CountStateMismatches(graph, accesses);
+
+		// Lifetimes over the passes left.
+		std::vector<std::pair<UINT, UINT>> lifetimes(graph.GetNumResources(), { UINT_MAX, 0u });
+		for (const DeclaredAccess& access : accesses)
+		{
+			if (!graph.IsPassCulled(access.Pass))
+			{
+				lifetimes[access.Resource].first = std::min(lifetimes[access.Resource].first, access.Pass);
+				lifetimes[access.Resource].second = std::max(lifetimes[access.Resource].second, access.Pass);
+			}
+		}
+
+		UINT64 worstHeapSize = 0u;
+		for (UINT i = 1; i < graph.GetNumResources(); ++i)
+		{
+			const UINT64 offset = graph.GetHeapOffset(i);
+			const RenderGraphResourceDesc& desc = graph.GetResourceDesc(i);
+			CHECK_EQ(offset == RenderGraph::InvalidOffset, lifetimes[i].first == UINT_MAX);
+			if (offset == RenderGraph::InvalidOffset)
+			{
+				continue;
+			}
+			worstHeapSize += desc.SizeInBytes + desc.Alignment;
+			numMisaligned += offset % desc.Alignment == 0u && offset + desc.SizeInBytes <= graph.GetTransientHeapSize() ? 0u : 1u;
+
+			for (UINT j = 1; j < i; ++j)
+			{
+				const UINT64 otherOffset = graph.GetHeapOffset(j);
+				if (otherOffset == RenderGraph::InvalidOffset)
+				{
+					continue;
+				}
+
+				const bool bDoMemoriesOverlap = offset < otherOffset + graph.GetResourceDesc(j).SizeInBytes && otherOffset < offset + desc.SizeInBytes;
+				const bool bDoLifetimesOverlap = lifetimes[i].first <= lifetimes[j].second && lifetimes[j].first <= lifetimes[i].second;
+				numOverlaps += bDoMemoriesOverlap && bDoLifetimesOverlap ? 1u : 0u;
+				numShared += bDoMemoriesOverlap ? 1u : 0u;
+			}
+		}
+		// No worse than every resource in its own aligned range.
+		CHECK(graph.GetTransientHeapSize() <= worstHeapSize);
+	}
+	CHECK_EQ(numMismatches, 0u);
+	CHECK_EQ(numOverlaps, 0u);
+	CHECK_EQ(numMisaligned, 0u);
+	CHECK(numShared > 100u);
+}
@@ -0,0 +1,87 @@
+#include "TestHarness.h"
+#include "Common/ScaldMath.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+	XMMATRIX MakeTransform(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const XMVECTOR axis = XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random) + 2.0f, 0.0f));
+		return XMMatrixScaling(1.5f + unit(random), 1.5f + unit(random), 1.5f + unit(random))
+			* XMMatrixRotationAxis(axis, XM_PI * unit(random))
+			* XMMatrixTranslation(100.0f * unit(random), 100.0f * unit(random), 100.0f * unit(random));
+	}
+
+	// Relative to the magnitude of the entries, translations are up to ~200.
+	bool IsNear(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		for (UINT r = 0; r < 4u; ++r)
+		{
+			for (UINT c = 0; c < 4u; ++c)
+			{
+				if (std::fabs(a.m[r][c] - b.m[r][c]) > 1e-5f * std::max(1.0f, std::fabs(b.m[r][c])))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+SCALD_TEST(InverseAffineMatchesGeneralInverse)
+{
+	std::mt19937 random(1u);
+	for (UINT i = 0; i < 1000u; ++i)
+	{
+		const XMMATRIX m = MakeTransform(random);
+		XMFLOAT4X4 affine, general;
+		XMStoreFloat4x4(&affine, ScaldMath::InverseAffine(m));
+		XMStoreFloat4x4(&general, XMMatrixInverse(nullptr, m));
+		CHECK(IsNear(affine, general));
+	}
+}
+
+SCALD_TEST(InverseAffineBatchMatchesForAnyCount)
+{
+	std::mt19937 random(2u);
+
+	// Whole groups of four, and every tail length.
+	for (size_t count = 0; count <= 13u; ++count)
+	{
+		std::vector<XMFLOAT4X4> matrices(count);
+		std::vector<XMFLOAT4X4> expected(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const XMMATRIX m = MakeTransform(random);
+			XMStoreFloat4x4(&matrices[i], m);
+			XMStoreFloat4x4(&expected[i], XMMatrixInverse(nullptr, m));
+		}
+
+		// Past the end is left alone.
+		std::vector<XMFLOAT4X4> inverses(count + 1u);
+		XMStoreFloat4x4(&inverses[count], XMMatrixIdentity());
+		inverses[count].m[0][1] = 42.0f;
+		ScaldMath::InverseAffineBatch(matrices.data(), inverses.data(), count);
+
+		UINT numWrong = 0u;
+		for (size_t i = 0; i < count; ++i)
+		{
+			numWrong += IsNear(inverses[i], expected[i]) ? 0u : 1u;
+		}
+		CHECK_EQ(numWrong, 0u);
+		CHECK_EQ(inverses[count].m[0][1], 42.0f);
+
+		// In place.
+		ScaldMath::InverseAffineBatch(matrices.data(), matrices.data(), count);
+		numWrong = 0u;
+		for (size_t i = 0; i < count; ++i)
+		{
+			numWrong += IsNear(matrices[i], expected[i]) ? 0u : 1u;
+		}
+		CHECK_EQ(numWrong, 0u);
+	}
+}
@@ -0,0 +1,300 @@
+#include "TestHarness.h"
+#include "DDSTestFiles.h"
+#include "Core/AssetArchive.h"
+#include "Core/ShaderCache.h"
+
+#include <algorithm>
+#include <fstream>
+
+using DDSTestFiles::TempDirectory;
+
+namespace
+{
+	// Reference FNV-1a, written out independently of the cache.
+	UINT64 Fnv1a(UINT64 hash, const void* pData, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash = (hash ^ static_cast<const uint8_t*>(pData)[i]) * 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	constexpr UINT64 FnvOffsetBasis = 0xcbf29ce484222325ull;
+
+	template<typename T>
+	UINT64 Fnv1aValue(UINT64 hash, T value)
+	{
+		return Fnv1a(hash, &value, sizeof(value));
+	}
+
+	UINT64 Fnv1aString(UINT64 hash, const std::string& str)
+	{
+		return Fnv1a(Fnv1aValue(hash, (UINT64)str.size()), str.data(), str.size());
+	}
+
+	bool WriteText(const std::filesystem::path& fileName, const std::string& text)
+	{
+		return DDSTestFiles::Write(fileName, std::vector<uint8_t>(text.begin(), text.end()));
+	}
+
+	ShaderCompileDesc MakeDesc(const std::filesystem::path& fileName)
+	{
+		ShaderCompileDesc desc;
+		desc.FileName = fileName;
+		desc.Defines = { { "FOG", "1" }, { "ALPHA_TEST", "" } };
+		desc.EntryPoint = "main";
+		desc.Target = "ps_5_1";
+		desc.Flags = 1u;
+		desc.CompilerVersion = 47u;
+		return desc;
+	}
+
+	UINT64 ComputeKey(ShaderCache& cache, const ShaderCompileDesc& desc)
+	{
+		UINT64 key = 0u;
+		CHECK(cache.ComputeKey(desc, key));
+		return key;
+	}
+
+	// Shader including Common.hlsl, which includes Lighting.hlsl from a subdirectory.
+	void WriteShaders(const TempDirectory& directory)
+	{
+		std::filesystem::create_directories(directory / "Shaders/Include");
+		CHECK(WriteText(directory / "Shaders/PixelShader.hlsl", "#include \"Common.hlsl\"\n// #include \"Unused.hlsl\"\nfloat4 main() : SV_Target { return Shade(); }\n"));
+		CHECK(WriteText(directory / "Shaders/Common.hlsl", "#include \"Include/Lighting.hlsl\"\n"));
+		CHECK(WriteText(directory / "Shaders/Include/Lighting.hlsl", "float4 Shade() { return 1.0f; }\n"));
+	}
+}
+
+SCALD_TEST(KeyIsFnv1aOfEverythingTheBytecodeDependsOn)
+{
+	// Known FNV-1a 64 answers, so the reference below is the real thing.
+	CHECK_EQ(Fnv1a(FnvOffsetBasis, "", 0u), 0xcbf29ce484222325ull);
+	CHECK_EQ(Fnv1a(FnvOffsetBasis, "a", 1u), 0xaf63dc4c8601ec8cull);
+	CHECK_EQ(Fnv1a(FnvOffsetBasis, "foobar", 6u), 0x85944171f73967e8ull);
+
+	const TempDirectory directory("ScaldShaderCacheTests");
+	const std::string source = "float4 main() : SV_Target { return 0.0f; }\n";
+	CHECK(WriteText(directory / "Flat.hlsl", source));
+
+	ShaderCache cache(directory / "Cache");
+	const ShaderCompileDesc desc = MakeDesc(directory / "Flat.hlsl");
+
+	// Version, then per source its normalized path and content hash, then the defines, entry point, target, flags and compiler.
+	UINT64 expected = Fnv1aValue(FnvOffsetBasis, ShaderCache::Version);
+	expected = Fnv1aString(expected, desc.FileName.lexically_normal().generic_u8string());
+	expected = Fnv1aValue(expected, Fnv1a(FnvOffsetBasis, source.data(), source.size()));
+	expected = Fnv1aValue(expected, (UINT64)desc.Defines.size());
+	for (const ShaderDefine& define : desc.Defines)
+	{
+		expected = Fnv1aString(Fnv1aString(expected, define.Name), define.Value);
+	}
+	expected = Fnv1aString(Fnv1aString(expected, desc.EntryPoint), desc.Target);
+	expected = Fnv1aValue(Fnv1aValue(expected, desc.Flags), desc.CompilerVersion);
+
+	CHECK_EQ(ComputeKey(cache, desc), expected);
+	// Stable across instances, so across launches.
+	ShaderCache otherCache(directory / "Cache");
+	CHECK_EQ(ComputeKey(otherCache, desc), expected);
+}
+
+SCALD_TEST(EveryInputChangesTheKey)
+{
+	const TempDirectory directory("ScaldShaderCacheTests");
+	WriteShaders(directory);
+
+	ShaderCache cache(directory / "Cache");
+	const ShaderCompileDesc desc = MakeDesc(directory / "Shaders/PixelShader.hlsl");
+	const UINT64 key = ComputeKey(cache, desc);
+
+	std::vector<ShaderCompileDesc> changed(8u, desc);
+	changed[0].Defines[0].Value = "0";
+	std::swap(changed[1].Defines[0], changed[1].Defines[1]);
+	changed[2].Defines.pop_back();
+	// Length prefixed: moving a character from the name to the value is a different define.
+	changed[3].Defines[0] = { "FO", "G1" };
+	changed[4].EntryPoint = "PSMain";
+	changed[5].Target = "ps_6_0";
+	changed[6].Flags = 0u;
+	changed[7].CompilerVersion = 48u;
+
+	std::vector<UINT64> keys = { key };
+	for (const ShaderCompileDesc& changedDesc : changed)
+	{
+		keys.push_back(ComputeKey(cache, changedDesc));
+	}
+	std::sort(keys.begin(), keys.end());
+	CHECK(std::adjacent_find(keys.begin(), keys.end()) == keys.end());
+
+	// The same file through another path is the same source.
+	ShaderCompileDesc samePath = desc;
+	samePath.FileName = directory / "Shaders/Include/../PixelShader.hlsl";
+	CHECK_EQ(ComputeKey(cache, samePath), key);
+}
+
+SCALD_TEST(IncludeClosureIsHashed)
+{
+	const TempDirectory directory("ScaldShaderCacheTests");
+	WriteShaders(directory);
+	const ShaderCompileDesc desc = MakeDesc(directory / "Shaders/PixelShader.hlsl");
+
+	UINT64 key;
+	{
+		ShaderCache cache(directory / "Cache");
+		key = ComputeKey(cache, desc);
+	}
+
+	// Sources are read once per instance, a new one picks up edits.
+	auto KeyAfter = [&]()
+		{
+			ShaderCache cache(directory / "Cache");
+			return ComputeKey(cache, desc);
+		};
+
+	// The commented out include and files nobody includes do not matter.
+	CHECK(WriteText(directory / "Shaders/Unused.hlsl", "garbage"));
+	CHECK(WriteText(directory / "Shaders/Other.hlsl", "float4 main() { return 0.0f; }"));
+	CHECK_EQ(KeyAfter(), key);
+
+	// An edit two includes deep does.
+	CHECK(WriteText(directory / "Shaders/Include/Lighting.hlsl", "float4 Shade() { return 0.5f; }\n"));
+	const UINT64 editedKey = KeyAfter();
+	CHECK(editedKey != key);
+
+	// A missing include fails the key, the shader is then compiled without the cache.
+	std::filesystem::remove(directory / "Shaders/Include/Lighting.hlsl");
+	ShaderCache cache(directory / "Cache");
+	UINT64 missingKey = 0u;
+	CHECK(!cache.ComputeKey(desc, missingKey));
+}
+
+SCALD_TEST(HitsMissesAndInvalidation)
+{
+	const TempDirectory directory("ScaldShaderCacheTests");
+	WriteShaders(directory);
+	const ShaderCompileDesc desc = MakeDesc(directory / "Shaders/PixelShader.hlsl");
+	const std::vector<uint8_t> byteCode = { 'D', 'X', 'B', 'C', 1, 2, 3, 4, 5 };
+
+	UINT64 key;
+	{
+		ShaderCache cache(directory / "Cache");
+		key = ComputeKey(cache, desc);
+
+		std::vector<uint8_t> loaded = { 1 };
+		CHECK(!cache.Load(key, loaded));
+		CHECK(loaded.empty());
+		CHECK(cache.Store(key, byteCode.data(), byteCode.size()));
+		CHECK(cache.Load(key, loaded));
+		CHECK(loaded == byteCode);
+
+		CHECK_EQ(cache.GetStats().NumHits, 1u);
+		CHECK_EQ(cache.GetStats().NumMisses, 1u);
+	}
+
+	// Next launch: still a hit, and no temporary files were left behind.
+	{
+		ShaderCache cache(directory / "Cache");
+		CHECK_EQ(ComputeKey(cache, desc), key);
+		std::vector<uint8_t> loaded;
+		CHECK(cache.Load(key, loaded));
+		CHECK(loaded == byteCode);
+
+		size_t numFiles = 0u;
+		for (const auto& entry : std::filesystem::directory_iterator(directory / "Cache"))
+		{
+			numFiles += entry.path().extension() == ".cso" ? 1u : 100u;
+		}
+		CHECK_EQ(numFiles, (size_t)1u);
+	}
+
+	// Editing an include is a miss under the new key, the old entry is never looked at.
+	CHECK(WriteText(directory / "Shaders/Common.hlsl", "#include \"Include/Lighting.hlsl\"\n#define EDITED\n"));
+	{
+		ShaderCache cache(directory / "Cache");
+		const UINT64 editedKey = ComputeKey(cache, desc);
+		CHECK(editedKey != key);
+		std::vector<uint8_t> loaded;
+		CHECK(!cache.Load(editedKey, loaded));
+		CHECK_EQ(cache.GetStats().NumMisses, 1u);
+	}
+
+	// Damaged entries are misses, not garbage bytecode.
+	const std::filesystem::path entryFileName = *std::filesystem::directory_iterator(directory / "Cache");
+	std::vector<uint8_t> entry;
+	{
+		std::ifstream file(entryFileName, std::ios::binary);
+		entry.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	auto LoadsWith = [&](const std::vector<uint8_t>& contents)
+		{
+			CHECK(DDSTestFiles::Write(entryFileName, contents));
+			ShaderCache cache(directory / "Cache");
+			std::vector<uint8_t> loaded;
+			return cache.Load(key, loaded);
+		};
+
+	CHECK(LoadsWith(entry));
+	CHECK(!LoadsWith(std::vector<uint8_t>(entry.begin(), entry.end() - 1u)));
+	CHECK(!LoadsWith(std::vector<uint8_t>(entry.begin(), entry.begin() + 8u)));
+	std::vector<uint8_t> oldVersion = entry;
+	oldVersion[4] ^= 0xFFu;
+	CHECK(!LoadsWith(oldVersion));
+	std::vector<uint8_t> otherKey = entry;
+	otherKey[8] ^= 0xFFu;
+	CHECK(!LoadsWith(otherKey));
+}
+
+SCALD_TEST(ArchivedSourcesTakePrecedence)
+{
+	const TempDirectory directory("ScaldShaderCacheTests");
+	WriteShaders(directory);
+	const ShaderCompileDesc desc = MakeDesc(directory / "Shaders/PixelShader.hlsl");
+
+	// Same contents packed: the same key, wherever the sources come from.
+	AssetArchiveWriter writer;
+	for (const char* fileName : { "Shaders/PixelShader.hlsl", "Shaders/Common.hlsl", "Shaders/Include/Lighting.hlsl" })
+	{
+		std::string source;
+		CHECK(ShaderCache::ReadSource(nullptr, directory / fileName, source));
+		writer.AddFile(directory / fileName, std::vector<uint8_t>(source.begin(), source.end()));
+	}
+	CHECK(writer.Write(directory / "Assets.pak"));
+
+	AssetArchive archive;
+	CHECK(archive.Open(directory / "Assets.pak"));
+
+	ShaderCache looseCache(directory / "Cache");
+	ShaderCache packedCache(directory / "Cache", &archive);
+	const UINT64 key = ComputeKey(looseCache, desc);
+	CHECK_EQ(ComputeKey(packedCache, desc), key);
+
+	// Loose edits do not affect the packed sources, and with the loose files gone the packed ones still work.
+	std::filesystem::remove_all(directory / "Shaders");
+	ShaderCache packedOnlyCache(directory / "Cache", &archive);
+	CHECK_EQ(ComputeKey(packedOnlyCache, desc), key);
+
+	std::string source;
+	CHECK(ShaderCache::ReadSource(&archive, directory / "Shaders/Include/Lighting.hlsl", source));
+	CHECK(source == "float4 Shade() { return 1.0f; }\n");
+	CHECK(!ShaderCache::ReadSource(nullptr, directory / "Shaders/Include/Lighting.hlsl", source));
+}
+
+SCALD_TEST(ScanIncludesSkipsComments)
+{
+	const std::string source =
+		"#include \"A.hlsl\"\n"
+		"  #  include <B.hlsl>\n"
+		"// #include \"C.hlsl\"\n"
+		"/* #include \"D.hlsl\"\n"
+		"#include \"E.hlsl\" */\n"
+		"static const char* s = \"#include \\\"F.hlsl\\\"\";\n"
+		"float x; #include \"G.hlsl\"\n"
+		"/**/ #include \"H.hlsl\"\n"
+		"#include \"Unterminated.hlsl\n";
+
+	std::vector<std::string> includes;
+	ShaderCache::ScanIncludes(source, includes);
+	CHECK(includes == std::vector<std::string>({ "A.hlsl", "B.hlsl", "H.hlsl" }));
+}
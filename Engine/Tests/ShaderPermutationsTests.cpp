@@ -0,0 +1,113 @@
+#include "TestHarness.h"
+#include "Core/ShaderPermutations.h"
+
+#include <atomic>
+
+namespace
+{
+	constexpr UINT NumWorkers = 3u;
+
+	// Bytecode is the list of defines, so every variant tells which one it is.
+	bool FakeCompile(const ShaderCompileDesc& desc, std::vector<uint8_t>& outByteCode)
+	{
+		std::string byteCode = desc.EntryPoint;
+		for (const ShaderDefine& define : desc.Defines)
+		{
+			byteCode += " " + define.Name;
+		}
+		outByteCode.assign(byteCode.begin(), byteCode.end());
+		return desc.EntryPoint != "broken";
+	}
+
+	std::string ToString(const std::vector<uint8_t>* pByteCode)
+	{
+		return pByteCode ? std::string(pByteCode->begin(), pByteCode->end()) : std::string("<null>");
+	}
+}
+
+SCALD_TEST(UndeclaredBitsMapToTheSameVariant)
+{
+	std::atomic<UINT> numCompiles = 0u;
+	ShaderPermutations permutations([&](const ShaderCompileDesc& desc, std::vector<uint8_t>& outByteCode)
+		{
+			numCompiles.fetch_add(1u);
+			return FakeCompile(desc, outByteCode);
+		});
+
+	const ShaderPermutations::ShaderId shader = permutations.Declare("PixelShader.hlsl", "main", "ps_5_1", { "ALPHA_TEST", "FOG" });
+	constexpr UINT UndeclaredBit = 1u << 5u;
+
+	CHECK_EQ(permutations.MakeKey(shader, 0b10u | UndeclaredBit), permutations.MakeKey(shader, 0b10u));
+	CHECK_EQ(permutations.Require(shader, 0b10u | UndeclaredBit), permutations.MakeKey(shader, 0b10u));
+
+	// A key built by hand with the extra bit finds the declared variant too, instead of compiling a duplicate.
+	const UINT64 rawKey = ((UINT64)shader << 32u) | 0b10u | UndeclaredBit;
+	const UINT64 fogKey = permutations.MakeKey(shader, 0b10u);
+	CHECK(permutations.CompileRequired());
+	CHECK_EQ(numCompiles.load(), 1u);
+	CHECK_EQ(ToString(permutations.FindOrFallback(rawKey)), std::string("main FOG"));
+	CHECK_EQ(permutations.FindOrFallback(rawKey), permutations.Find(fogKey));
+
+	// Not compiled yet: the lazy compile is of the masked key as well.
+	const UINT64 rawAlphaKey = ((UINT64)shader << 32u) | 0b01u | UndeclaredBit;
+	permutations.FindOrFallback(rawAlphaKey);
+	permutations.FindOrFallback(rawAlphaKey);
+	permutations.WaitForLazyCompiles();
+	CHECK_EQ(numCompiles.load(), 2u);
+	CHECK_EQ(permutations.GetNumVariants(), 2u);
+	CHECK_EQ(ToString(permutations.Find(permutations.MakeKey(shader, 0b01u))), std::string("main ALPHA_TEST"));
+	CHECK_EQ(ToString(permutations.FindOrFallback(rawAlphaKey)), std::string("main ALPHA_TEST"));
+}
+
+SCALD_TEST(RequiredVariantsCompileTogether)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	ShaderPermutations permutations(FakeCompile);
+	const ShaderPermutations::ShaderId shader = permutations.Declare("PixelShader.hlsl", "main", "ps_5_1", { "A", "B", "C" });
+	CHECK_EQ(permutations.Declare("PixelShader.hlsl", "main", "ps_5_1", { "A", "B", "C" }), shader);
+	const ShaderPermutations::ShaderId other = permutations.Declare("PixelShader.hlsl", "main", "ps_5_1", { "A" });
+	CHECK(other != shader);
+
+	for (UINT features = 0; features < 8u; ++features)
+	{
+		permutations.Require(shader, features);
+		permutations.Require(shader, features);
+	}
+	CHECK_EQ(permutations.GetNumVariants(), 8u);
+	CHECK(permutations.CompileRequired());
+	CHECK_EQ(permutations.GetNumCompiled(), 8u);
+
+	// Defines follow the feature bit order.
+	CHECK_EQ(ToString(permutations.Find(permutations.MakeKey(shader, 0b101u))), std::string("main A C"));
+	CHECK(permutations.GetCompileDesc(permutations.MakeKey(shader, 0b110u)).Defines.size() == 2u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(FallbackStandsInUntilCompiled)
+{
+	ShaderPermutations permutations(FakeCompile);
+	const ShaderPermutations::ShaderId shader = permutations.Declare("Lighting.hlsl", "main", "ps_5_1", { "FOG" });
+	const ShaderPermutations::ShaderId broken = permutations.Declare("Lighting.hlsl", "broken", "ps_5_1", { "FOG" });
+
+	// Nothing compiled, not even the fallback.
+	JobSystem::Get().Init(NumWorkers);
+	permutations.Require(shader, 0u);
+	CHECK(permutations.CompileRequired());
+
+	const UINT64 fogKey = permutations.MakeKey(shader, 1u);
+	const std::vector<uint8_t>* pFirst = permutations.FindOrFallback(fogKey);
+	CHECK(pFirst == permutations.Find(permutations.MakeKey(shader, 0u)) || pFirst == permutations.Find(fogKey));
+	permutations.WaitForLazyCompiles();
+	CHECK_EQ(ToString(permutations.FindOrFallback(fogKey)), std::string("main FOG"));
+	JobSystem::Get().Shutdown();
+
+	// Failures are not retried and fall back for good.
+	permutations.Require(broken, 0u);
+	CHECK(!permutations.CompileRequired());
+	CHECK(!permutations.FindOrFallback(permutations.MakeKey(broken, 1u)));
+	permutations.WaitForLazyCompiles();
+	CHECK(!permutations.Find(permutations.MakeKey(broken, 1u)));
+	CHECK_EQ(permutations.GetNumCompiled(), 2u);
+}
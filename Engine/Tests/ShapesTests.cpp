@@ -0,0 +1,121 @@
+#include "TestHarness.h"
+#include "Core/Shapes.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace
+{
+	constexpr size_t GetGeosphereVertexCount(UINT numSubdivisions) { return 10u * ((size_t)1u << (2u * numSubdivisions)) + 2u; }
+	constexpr size_t GetGeosphereIndexCount(UINT numSubdivisions) { return 60u * ((size_t)1u << (2u * numSubdivisions)); }
+
+	// Every index in range, and every vertex used.
+	template<typename TIndex>
+	bool IsCompact(const MeshData<VertexPositionNormalTangentUV, TIndex>& mesh)
+	{
+		std::vector<bool> bIsUsed(mesh.LODVertices[0].size(), false);
+		for (TIndex index : mesh.LODIndices[0])
+		{
+			if (index >= bIsUsed.size())
+			{
+				return false;
+			}
+			bIsUsed[index] = true;
+		}
+		return std::find(bIsUsed.begin(), bIsUsed.end(), false) == bIsUsed.end();
+	}
+
+	template<typename TIndex>
+	void CheckGeosphere(const MeshData<VertexPositionNormalTangentUV, TIndex>& mesh, UINT numSubdivisions, float radius)
+	{
+		const std::vector<VertexPositionNormalTangentUV>& vertices = mesh.LODVertices[0];
+		const std::vector<TIndex>& indices = mesh.LODIndices[0];
+
+		// 10 * 4^n + 2 vertices and 20 * 4^n faces, the buffers hold exactly that.
+		CHECK_EQ(vertices.size(), GetGeosphereVertexCount(numSubdivisions));
+		CHECK_EQ(indices.size(), GetGeosphereIndexCount(numSubdivisions));
+		CHECK_EQ(vertices.capacity(), vertices.size());
+		CHECK_EQ(indices.capacity(), indices.size());
+		CHECK(IsCompact(mesh));
+
+		// Midpoints are shared: no two vertices in the same place.
+		std::vector<std::tuple<float, float, float>> positions;
+		positions.reserve(vertices.size());
+		for (const VertexPositionNormalTangentUV& v : vertices)
+		{
+			positions.emplace_back(v.position.x, v.position.y, v.position.z);
+			CHECK_NEAR(XMVectorGetX(XMVector3Length(XMLoadFloat3(&v.position))), radius, 1e-4f * radius);
+		}
+		std::sort(positions.begin(), positions.end());
+		CHECK(std::adjacent_find(positions.begin(), positions.end()) == positions.end());
+
+		// Closed two-manifold: every directed edge appears once and its opposite once, V - E + F = 2.
+		std::map<std::pair<TIndex, TIndex>, UINT> directedEdges;
+		for (size_t t = 0; t < indices.size(); t += 3u)
+		{
+			for (UINT e = 0; e < 3u; ++e)
+			{
+				++directedEdges[{ indices[t + e], indices[t + (e + 1u) % 3u] }];
+			}
+		}
+		UINT numBadEdges = 0u;
+		for (const auto& [edge, count] : directedEdges)
+		{
+			const auto opposite = directedEdges.find({ edge.second, edge.first });
+			numBadEdges += (count == 1u && opposite != directedEdges.end() && opposite->second == 1u) ? 0u : 1u;
+		}
+		CHECK_EQ(numBadEdges, 0u);
+		const size_t numEdges = directedEdges.size() / 2u;
+		CHECK_EQ(vertices.size() + indices.size() / 3u, numEdges + 2u);
+	}
+}
+
+SCALD_TEST(GeosphereCountsPerLevel)
+{
+	for (UINT numSubdivisions = 0; numSubdivisions <= Shapes::GetMaxGeosphereSubdivisions<uint16_t>(); ++numSubdivisions)
+	{
+		CheckGeosphere(Shapes::CreateGeosphere<uint16_t>(2.5f, numSubdivisions), numSubdivisions, 2.5f);
+	}
+}
+
+SCALD_TEST(MaxSubdivisionsFitTheIndexType)
+{
+	// 40962 vertices at 6, 163842 at 7.
+	CHECK_EQ(Shapes::GetMaxGeosphereSubdivisions<uint16_t>(), 6u);
+	CHECK(GetGeosphereVertexCount(6u) - 1u <= UINT16_MAX);
+	CHECK(GetGeosphereVertexCount(7u) - 1u > UINT16_MAX);
+	// 32 bit indices are limited by memory, not by the index range.
+	CHECK_EQ(Shapes::GetMaxGeosphereSubdivisions<uint32_t>(), 10u);
+
+	// Asking for more is clamped.
+	const MeshData<VertexPositionNormalTangentUV, uint16_t> clamped = Shapes::CreateGeosphere<uint16_t>(1.0f, 9u);
+	CHECK_EQ(clamped.LODVertices[0].size(), GetGeosphereVertexCount(6u));
+}
+
+SCALD_TEST(ThirtyTwoBitMeshesPast65kVertices)
+{
+	JobSystem::Get().Init(3u);
+
+	// Above the job size, so vertices, midpoints and faces are filled by workers.
+	const UINT numSubdivisions = Shapes::GetMaxGeosphereSubdivisions<uint16_t>() + 1u;
+	const MeshData<VertexPositionNormalTangentUV, uint32_t> geosphere = Shapes::CreateGeosphere<uint32_t>(1.0f, numSubdivisions);
+	CHECK(geosphere.LODVertices[0].size() > 65536u);
+	CheckGeosphere(geosphere, numSubdivisions, 1.0f);
+	CHECK_EQ(*std::max_element(geosphere.LODIndices[0].begin(), geosphere.LODIndices[0].end()), geosphere.LODVertices[0].size() - 1u);
+
+	const MeshData<VertexPositionNormalTangentUV, uint32_t> grid = Shapes::CreateGrid<uint32_t>(10.0f, 20.0f, 300u, 400u);
+	CHECK_EQ(grid.LODVertices[0].size(), 300u * 400u);
+	CHECK_EQ(grid.LODIndices[0].size(), 299u * 399u * 6u);
+	CHECK(IsCompact(grid));
+	CHECK_NEAR(grid.LODBounds[0].Extents.x, 5.0f, 1e-5f);
+	CHECK_NEAR(grid.LODBounds[0].Extents.z, 10.0f, 1e-5f);
+
+	const MeshData<VertexPositionNormalTangentUV, uint32_t> sphere = Shapes::CreateSphere<uint32_t>(1.0f, 400u, 200u);
+	CHECK_EQ(sphere.LODVertices[0].size(), 199u * 401u + 2u);
+	CHECK_EQ(sphere.LODIndices[0].size(), 6u * 400u * 199u);
+	CHECK(IsCompact(sphere));
+
+	JobSystem::Get().Shutdown();
+}
@@ -0,0 +1,330 @@
+#include "TestHarness.h"
+#include "Core/SpotLightCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+
+namespace
+{
+	// 90 degrees vertical, 16:9, so the projection scales are exact.
+	constexpr float FovY = XM_PIDIV2;
+	constexpr float ScaleY = 1.0f;
+	constexpr float ScaleX = 9.0f / 16.0f;
+	constexpr float NearZ = 1.0f;
+	constexpr float FarZ = 100.0f;
+	constexpr UINT Width = 1600u;
+	constexpr UINT Height = 900u;
+
+	constexpr UINT NumRimSamples = 720u;
+
+	SpotLightCone MakeCone(const XMFLOAT3& apex, const XMFLOAT3& direction, float range, float baseRadius)
+	{
+		SpotLightCone cone;
+		cone.Apex = apex;
+		XMStoreFloat3(&cone.Direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+		cone.Range = range;
+		cone.BaseRadius = baseRadius;
+		return cone;
+	}
+
+	SpotLightCone MakeRandomCone(std::mt19937& random, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		const XMFLOAT3 apex(
+			boxMin.x + (boxMax.x - boxMin.x) * unit(random),
+			boxMin.y + (boxMax.y - boxMin.y) * unit(random),
+			boxMin.z + (boxMax.z - boxMin.z) * unit(random));
+		const XMFLOAT3 direction(2.0f * unit(random) - 1.0f, 2.0f * unit(random) - 1.0f, 2.0f * unit(random) - 1.0f + 1e-3f);
+		const float range = 0.5f + 5.0f * unit(random);
+		const float halfAngle = XMConvertToRadians(5.0f + 75.0f * unit(random));
+		return MakeCone(apex, direction, range, range * tanf(halfAngle));
+	}
+
+	// Points of the round cone's surface: the apex, lines from it to the base rim and the base disk.
+	// The cone is their hull, so planes and projections bound them the same way.
+	std::vector<XMFLOAT3> SampleSurface(const SpotLightCone& cone, UINT numRimSamples, UINT numLineSamples)
+	{
+		const XMVECTOR apex = XMLoadFloat3(&cone.Apex);
+		const XMVECTOR direction = XMLoadFloat3(&cone.Direction);
+		const XMVECTOR other = fabsf(cone.Direction.x) < 0.9f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		const XMVECTOR u = XMVector3Normalize(XMVector3Cross(direction, other));
+		const XMVECTOR v = XMVector3Cross(direction, u);
+		const XMVECTOR baseCenter = XMVectorMultiplyAdd(direction, XMVectorReplicate(cone.Range), apex);
+
+		std::vector<XMFLOAT3> points;
+		points.reserve(1u + numRimSamples * (2u * numLineSamples + 1u));
+		XMFLOAT3 point;
+		XMStoreFloat3(&point, apex);
+		points.push_back(point);
+		for (UINT i = 0; i < numRimSamples; ++i)
+		{
+			const float theta = XM_2PI * i / numRimSamples;
+			const XMVECTOR rim = XMVectorAdd(baseCenter, XMVectorAdd(XMVectorScale(u, cone.BaseRadius * cosf(theta)), XMVectorScale(v, cone.BaseRadius * sinf(theta))));
+			for (UINT j = 1; j <= numLineSamples; ++j)
+			{
+				const float t = (float)j / numLineSamples;
+				XMStoreFloat3(&point, XMVectorLerp(apex, rim, t));
+				points.push_back(point);
+				XMStoreFloat3(&point, XMVectorLerp(baseCenter, rim, t - 1.0f / numLineSamples));
+				points.push_back(point);
+			}
+		}
+		return points;
+	}
+
+	// Vertices of the rasterized proxy: the unit cone's apex and base ring (as Shapes::CreateCone places them) in world space.
+	std::vector<XMFLOAT3> GetProxyVertices(const SpotLightCone& cone)
+	{
+		const XMMATRIX world = SpotLightCuller::ComputeProxyWorld(cone);
+
+		std::vector<XMFLOAT3> vertices(1u + SpotLightCuller::ProxySliceCount);
+		XMStoreFloat3(&vertices[0], XMVector3TransformCoord(XMVectorZero(), world));
+		for (UINT j = 0; j < SpotLightCuller::ProxySliceCount; ++j)
+		{
+			const float theta = j * XM_2PI / SpotLightCuller::ProxySliceCount;
+			XMStoreFloat3(&vertices[1u + j], XMVector3TransformCoord(XMVectorSet(cosf(theta), sinf(theta), 1.0f, 1.0f), world));
+		}
+		return vertices;
+	}
+
+	float GetMinDistance(const std::vector<XMFLOAT3>& points, const XMFLOAT4& plane)
+	{
+		float minDistance = FLT_MAX;
+		for (const XMFLOAT3& p : points)
+		{
+			minDistance = std::min(minDistance, plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w);
+		}
+		return minDistance;
+	}
+
+	// The point on the plane closest to p.
+	XMFLOAT3 ProjectOntoPlane(const XMFLOAT4& plane, const XMFLOAT3& p)
+	{
+		const float distance = plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+		return XMFLOAT3(p.x - plane.x * distance, p.y - plane.y * distance, p.z - plane.z * distance);
+	}
+
+	XMFLOAT3 Offset(const XMFLOAT3& p, const XMFLOAT3& direction, float distance)
+	{
+		return XMFLOAT3(p.x + direction.x * distance, p.y + direction.y * distance, p.z + direction.z * distance);
+	}
+
+	CullingVolume MakeViewFrustum()
+	{
+		return CullingVolume::FromViewProjection(XMMatrixPerspectiveFovLH(FovY, (float)Width / Height, NearZ, FarZ));
+	}
+
+	bool IsEmpty(const LightScissorRect& rect)
+	{
+		return rect.Left >= rect.Right || rect.Top >= rect.Bottom;
+	}
+
+	LightScissorRect ComputeRect(const SpotLightCone& viewCone)
+	{
+		return SpotLightCuller::ComputeScissorRect(viewCone, ScaleX, ScaleY, NearZ, Width, Height);
+	}
+}
+
+SCALD_TEST(ConesStraddlingEachPlaneAreKept)
+{
+	const CullingVolume frustum = MakeViewFrustum();
+	CHECK_EQ(frustum.NumPlanes, 6u);
+
+	for (UINT i = 0; i < frustum.NumPlanes; ++i)
+	{
+		const XMFLOAT4& plane = frustum.Planes[i];
+		// Outward normal, and a point on the plane at the frustum's border.
+		const XMFLOAT3 normal(plane.x, plane.y, plane.z);
+		const XMFLOAT3 inverseNormal(-plane.x, -plane.y, -plane.z);
+		const XMFLOAT3 onPlane = ProjectOntoPlane(plane, XMFLOAT3(0.0f, 0.0f, 10.0f));
+
+		// Apex outside, pointing in.
+		CHECK(!SpotLightCuller::IsOutside(MakeCone(Offset(onPlane, normal, 0.5f), inverseNormal, 2.0f, 0.5f), frustum));
+		// Apex outside, pointing away.
+		CHECK(SpotLightCuller::IsOutside(MakeCone(Offset(onPlane, normal, 0.5f), normal, 2.0f, 0.5f), frustum));
+		// Apex inside, the whole base outside.
+		CHECK(!SpotLightCuller::IsOutside(MakeCone(Offset(onPlane, normal, -0.5f), normal, 5.0f, 1.0f), frustum));
+
+		// Apex outside and the axis along the plane: only the side of the base disk can reach in.
+		XMFLOAT3 along;
+		XMStoreFloat3(&along, XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&normal), XMVectorSet(0.3f, 0.5f, 0.7f, 0.0f))));
+		CHECK(!SpotLightCuller::IsOutside(MakeCone(Offset(onPlane, normal, 0.5f), along, 2.0f, 1.0f), frustum));
+		CHECK(SpotLightCuller::IsOutside(MakeCone(Offset(onPlane, normal, 0.5f), along, 2.0f, 0.3f), frustum));
+
+		// Tilted towards the plane, so the base's near edge is what crosses it.
+		XMFLOAT3 tilted;
+		XMStoreFloat3(&tilted, XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&along), XMVectorScale(XMLoadFloat3(&normal), 0.2f))));
+		CHECK(!SpotLightCuller::IsOutside(MakeCone(Offset(onPlane, normal, 0.5f), tilted, 2.0f, 0.3f), frustum));
+	}
+
+	// Inside, and around the camera with the apex behind it.
+	CHECK(!SpotLightCuller::IsOutside(MakeCone(XMFLOAT3(0.0f, 0.0f, 10.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 1.0f, 0.5f), frustum));
+	CHECK(!SpotLightCuller::IsOutside(MakeCone(XMFLOAT3(0.0f, 0.0f, -2.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 10.0f, 10.0f), frustum));
+}
+
+SCALD_TEST(IsOutsideIsExactForOnePlane)
+{
+	std::mt19937 random(1u);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	UINT numCompared = 0u;
+	UINT numOutside = 0u;
+	UINT numWrong = 0u;
+	for (UINT test = 0; test < 4000u; ++test)
+	{
+		CullingVolume volume;
+		XMStoreFloat4(&volume.Planes[0], XMPlaneNormalize(XMVectorSet(unit(random), unit(random), unit(random), 2.0f * unit(random))));
+		volume.NumPlanes = 1u;
+
+		const SpotLightCone cone = MakeRandomCone(random, XMFLOAT3(-4.0f, -4.0f, -4.0f), XMFLOAT3(4.0f, 4.0f, 4.0f));
+		const float minDistance = GetMinDistance(SampleSurface(cone, NumRimSamples, 1u), volume.Planes[0]);
+		// Sampling the rim finds the minimum up to a tiny error.
+		if (fabsf(minDistance) < 1e-3f)
+		{
+			continue;
+		}
+
+		++numCompared;
+		numOutside += minDistance > 0.0f ? 1u : 0u;
+		numWrong += SpotLightCuller::IsOutside(cone, volume) == (minDistance > 0.0f) ? 0u : 1u;
+	}
+	CHECK_EQ(numWrong, 0u);
+	CHECK(numCompared > 3900u);
+	CHECK(numOutside > numCompared / 10u);
+	CHECK(numOutside < numCompared * 9u / 10u);
+}
+
+SCALD_TEST(CrossesNearPlaneFindsTheLowestPoint)
+{
+	// Apex behind the near plane.
+	CHECK(SpotLightCuller::CrossesNearPlane(MakeCone(XMFLOAT3(0.0f, 0.0f, 0.5f), XMFLOAT3(0.0f, 0.0f, 1.0f), 10.0f, 1.0f), NearZ));
+	// Pointing at the camera, the base reaches behind the near plane.
+	CHECK(SpotLightCuller::CrossesNearPlane(MakeCone(XMFLOAT3(0.0f, 0.0f, 5.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), 4.5f, 1.0f), NearZ));
+	CHECK(!SpotLightCuller::CrossesNearPlane(MakeCone(XMFLOAT3(0.0f, 0.0f, 5.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), 3.5f, 1.0f), NearZ));
+	// Sideways, only the rim of the base dips in front.
+	CHECK(SpotLightCuller::CrossesNearPlane(MakeCone(XMFLOAT3(0.0f, 0.0f, 3.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 4.0f, 2.5f), NearZ));
+	CHECK(!SpotLightCuller::CrossesNearPlane(MakeCone(XMFLOAT3(0.0f, 0.0f, 3.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 4.0f, 1.5f), NearZ));
+
+	// Random cones against the proxy's lowest vertex.
+	std::mt19937 random(2u);
+	const XMFLOAT4 nearPlane(0.0f, 0.0f, 1.0f, -NearZ);
+	UINT numCompared = 0u;
+	UINT numCrossing = 0u;
+	UINT numWrong = 0u;
+	for (UINT test = 0; test < 4000u; ++test)
+	{
+		const SpotLightCone cone = MakeRandomCone(random, XMFLOAT3(-4.0f, -4.0f, -3.0f), XMFLOAT3(4.0f, 4.0f, 6.0f));
+		const float minDistance = GetMinDistance(GetProxyVertices(cone), nearPlane);
+		if (fabsf(minDistance) < 1e-3f)
+		{
+			continue;
+		}
+
+		++numCompared;
+		numCrossing += minDistance < 0.0f ? 1u : 0u;
+		numWrong += SpotLightCuller::CrossesNearPlane(cone, NearZ) == (minDistance < 0.0f) ? 0u : 1u;
+	}
+	CHECK_EQ(numWrong, 0u);
+	CHECK(numCompared > 3900u);
+	CHECK(numCrossing > numCompared / 10u);
+	CHECK(numCrossing < numCompared * 9u / 10u);
+}
+
+SCALD_TEST(CrossesNearPlaneWithTheProxyOnly)
+{
+	// Sideways, a proxy corner points at the camera and reaches 1/cos(pi/12) further than the round base.
+	const SpotLightCone cone = MakeCone(XMFLOAT3(0.0f, 0.0f, 3.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), 4.0f, 1.98f);
+	const XMFLOAT4 nearPlane(0.0f, 0.0f, 1.0f, -NearZ);
+	CHECK(GetMinDistance(SampleSurface(cone, NumRimSamples, 1u), nearPlane) > 0.0f);
+	CHECK(GetMinDistance(GetProxyVertices(cone), nearPlane) < 0.0f);
+
+	// Drawing its front faces would clip the corner away, the back faces have to be drawn.
+	CHECK(SpotLightCuller::CrossesNearPlane(cone, NearZ));
+}
+
+SCALD_TEST(ScissorRectContainsTheCone)
+{
+	std::mt19937 random(3u);
+
+	UINT numOutsidePixels = 0u;
+	UINT numLoose = 0u;
+	UINT numCrossing = 0u;
+	UINT numEmpty = 0u;
+	for (UINT test = 0; test < 3000u; ++test)
+	{
+		const SpotLightCone cone = MakeRandomCone(random, XMFLOAT3(-8.0f, -5.0f, -3.0f), XMFLOAT3(8.0f, 5.0f, 20.0f));
+		const LightScissorRect rect = ComputeRect(cone);
+		CHECK(rect.Right <= Width && rect.Bottom <= Height);
+
+		// Points in front of the near plane, and where the lines between the sampled points cross it.
+		const std::vector<XMFLOAT3> surface = SampleSurface(cone, 90u, 8u);
+		std::vector<XMFLOAT3> visible;
+		for (const XMFLOAT3& p : surface)
+		{
+			if (p.z >= NearZ)
+			{
+				visible.push_back(p);
+			}
+			const XMFLOAT3& apex = surface.front();
+			if ((apex.z < NearZ) != (p.z < NearZ))
+			{
+				const float t = (NearZ - apex.z) / (p.z - apex.z);
+				visible.emplace_back(apex.x + t * (p.x - apex.x), apex.y + t * (p.y - apex.y), NearZ);
+			}
+		}
+
+		if (visible.empty())
+		{
+			numEmpty += IsEmpty(rect) ? 1u : 0u;
+			CHECK(IsEmpty(rect));
+			continue;
+		}
+		numCrossing += visible.size() < surface.size() ? 1u : 0u;
+
+		float left = FLT_MAX, top = FLT_MAX, right = -FLT_MAX, bottom = -FLT_MAX;
+		for (const XMFLOAT3& p : visible)
+		{
+			const float pixelX = std::clamp((p.x * ScaleX / p.z * 0.5f + 0.5f) * Width, 0.0f, (float)Width);
+			const float pixelY = std::clamp((0.5f - p.y * ScaleY / p.z * 0.5f) * Height, 0.0f, (float)Height);
+			left = std::min(left, pixelX);
+			right = std::max(right, pixelX);
+			top = std::min(top, pixelY);
+			bottom = std::max(bottom, pixelY);
+		}
+
+		// Within a rounding error of the projection.
+		constexpr float Tolerance = 0.01f;
+		const bool bIsContained = rect.Left <= left + Tolerance && right - Tolerance <= rect.Right && rect.Top <= top + Tolerance && bottom - Tolerance <= rect.Bottom;
+		numOutsidePixels += bIsContained ? 0u : 1u;
+
+		// Not much larger than the round cone for the ones fully in front and on screen: the proxy is a little wider.
+		const bool bIsOnScreen = left > 0.0f && top > 0.0f && right < Width && bottom < Height;
+		if (bIsOnScreen && visible.size() == surface.size())
+		{
+			const float slack = 0.2f * std::max(right - left, bottom - top) + 2.0f;
+			numLoose += (rect.Left + slack < left || right + slack < rect.Right || rect.Top + slack < top || bottom + slack < rect.Bottom) ? 1u : 0u;
+		}
+	}
+	CHECK_EQ(numOutsidePixels, 0u);
+	CHECK_EQ(numLoose, 0u);
+	CHECK(numCrossing > 100u);
+	CHECK(numEmpty > 10u);
+}
+
+SCALD_TEST(ScissorRectAroundTheCamera)
+{
+	// The camera is inside: the whole screen.
+	const LightScissorRect inside = ComputeRect(MakeCone(XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 20.0f, 40.0f));
+	CHECK(inside.Left == 0u && inside.Top == 0u && inside.Right == Width && inside.Bottom == Height);
+
+	// Behind the camera, or behind the near plane.
+	CHECK(IsEmpty(ComputeRect(MakeCone(XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), 20.0f, 40.0f))));
+	CHECK(IsEmpty(ComputeRect(MakeCone(XMFLOAT3(0.0f, 0.0f, 0.5f), XMFLOAT3(1.0f, 0.0f, 0.0f), 2.0f, 0.4f))));
+
+	// Straight ahead, centered on the screen.
+	const LightScissorRect ahead = ComputeRect(MakeCone(XMFLOAT3(0.0f, 0.0f, 10.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 5.0f, 1.0f));
+	CHECK(!IsEmpty(ahead));
+	CHECK_NEAR(ahead.Left + ahead.Right, Width, 2.0f);
+	CHECK_NEAR(ahead.Top + ahead.Bottom, Height, 2.0f);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Byte buffers for the compression and archive tests, the same for a seed on every platform.
+namespace TestData
+{
+	// Text like data: words out of a small vocabulary, so there are matches at all kinds of offsets and lengths.
+	inline std::vector<uint8_t> MakeCompressible(size_t size, uint32_t seed)
+	{
+		static const char* Words[] = { "float4 ", "position", " = ", "mul(", "gWorld", ", ", "normal", ");\n", "return ", "texcoord" };
+		constexpr uint32_t NumWords = sizeof(Words) / sizeof(Words[0]);
+
+		std::mt19937 random(seed);
+		std::vector<uint8_t> data;
+		while (data.size() < size)
+		{
+			for (const char* c = Words[random() % NumWords]; *c && data.size() < size; ++c)
+			{
+				data.push_back((uint8_t)*c);
+			}
+		}
+		return data;
+	}
+
+	// Incompressible
+	inline std::vector<uint8_t> MakeRandom(size_t size, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<uint8_t> data(size);
+		for (uint8_t& value : data)
+		{
+			value = (uint8_t)random();
+		}
+		return data;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Minimal test harness of the CPU-only test target. Every test executable links TestMain.cpp,
+// which runs the tests registered with SCALD_TEST and returns the number of failed checks.
+namespace ScaldTest
+{
+	struct TestCase
+	{
+		const char* Name;
+		void (*Func)();
+	};
+
+	inline std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	inline int& GetNumFailures()
+	{
+		static int numFailures = 0;
+		return numFailures;
+	}
+
+	struct Registrar
+	{
+		Registrar(const char* name, void (*func)())
+		{
+			GetTests().push_back(TestCase{ name, func });
+		}
+	};
+
+	inline void ReportFailure(const char* file, int line, const char* expression)
+	{
+		std::printf("%s(%d): check failed: %s\n", file, line, expression);
+		++GetNumFailures();
+	}
+}
+
+#define SCALD_TEST(name) \
+	static void name(); \
+	static ScaldTest::Registrar name##Registrar(#name, &name); \
+	static void name()
+
+#define CHECK(expr) \
+	do { if (!(expr)) ScaldTest::ReportFailure(__FILE__, __LINE__, #expr); } while (0)
+
+#define CHECK_EQ(a, b) \
+	do { if (!((a) == (b))) ScaldTest::ReportFailure(__FILE__, __LINE__, #a " == " #b); } while (0)
+
+#define CHECK_NEAR(a, b, eps) \
+	do { if (!(std::fabs((double)(a) - (double)(b)) <= (double)(eps))) ScaldTest::ReportFailure(__FILE__, __LINE__, #a " ~= " #b); } while (0)
@@ -0,0 +1,14 @@
+#include "TestHarness.h"
+
+int main()
+{
+	for (const ScaldTest::TestCase& test : ScaldTest::GetTests())
+	{
+		const int numFailuresBefore = ScaldTest::GetNumFailures();
+		test.Func();
+		std::printf("[%s] %s\n", ScaldTest::GetNumFailures() == numFailuresBefore ? "  OK  " : "FAILED", test.Name);
+	}
+
+	std::printf("%d test(s), %d failed check(s)\n", (int)ScaldTest::GetTests().size(), ScaldTest::GetNumFailures());
+	return ScaldTest::GetNumFailures() == 0 ? 0 : 1;
+}
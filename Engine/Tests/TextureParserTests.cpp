@@ -0,0 +1,295 @@
+#include "TestHarness.h"
+#include "DDSTestFiles.h"
+#include "Core/AssetArchive.h"
+#include "Core/TextureParser.h"
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+
+using namespace DDSTestFiles;
+
+namespace
+{
+	constexpr UINT NumWorkers = 3u;
+
+	// What the TextureLoader does too: its own state rides along with the parse.
+	struct IndexedRequest : TextureParser::Request
+	{
+		UINT Index = 0u;
+	};
+
+	std::unique_ptr<TextureParser::Request> MakeRequest(const std::wstring& fileName, UINT index)
+	{
+		auto request = std::make_unique<IndexedRequest>();
+		request->FileName = fileName;
+		request->Index = index;
+		return request;
+	}
+
+	UINT GetIndex(const std::unique_ptr<TextureParser::Request>& request)
+	{
+		return static_cast<const IndexedRequest*>(request.get())->Index;
+	}
+
+	// Square RGBA8 texture of 2^(2 + index % 6) texels with a full mip chain.
+	Desc MakeDesc(UINT index)
+	{
+		Desc desc;
+		desc.Width = desc.Height = 4u << (index % 6u);
+		desc.MipCount = 3u + index % 6u;
+		return desc;
+	}
+}
+
+SCALD_TEST(EveryRequestIsParsedOnce)
+{
+	JobSystem::Get().Init(NumWorkers);
+	const TempDirectory directory("ScaldTextureParserTests");
+
+	constexpr UINT NumFiles = 6u;
+	for (UINT i = 0; i < NumFiles; ++i)
+	{
+		CHECK(Write(directory / std::to_string(i).c_str(), Make(MakeDesc(i))));
+	}
+
+	TextureParser parser;
+	constexpr UINT NumRequests = 64u;
+	for (UINT i = 0; i < NumRequests; ++i)
+	{
+		parser.Parse(MakeRequest((directory / std::to_string(i % NumFiles).c_str()).wstring(), i));
+	}
+
+	// Collected while the workers are still at it, like the loader does once per frame.
+	std::vector<std::unique_ptr<TextureParser::Request>> parsed;
+	while (parsed.size() < NumRequests)
+	{
+		for (auto& request : parser.TakeParsed())
+		{
+			parsed.push_back(std::move(request));
+		}
+	}
+	parser.Wait();
+	CHECK(parser.TakeParsed().empty());
+
+	std::set<UINT> indices;
+	UINT numWrong = 0u;
+	for (const auto& request : parsed)
+	{
+		const UINT index = GetIndex(request);
+		indices.insert(index);
+
+		const Desc desc = MakeDesc(index % NumFiles);
+		numWrong += (request->Result == S_OK && request->Data.FileData && request->Data.Width == desc.Width && request->Data.MipCount == desc.MipCount) ? 0u : 1u;
+	}
+	CHECK_EQ(indices.size(), (size_t)NumRequests);
+	CHECK_EQ(numWrong, 0u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(FailuresAreReportedPerRequest)
+{
+	JobSystem::Get().Init(NumWorkers);
+	const TempDirectory directory("ScaldTextureParserTests");
+
+	const std::vector<uint8_t> file = Make(MakeDesc(2u));
+	CHECK(Write(directory / "valid.dds", file));
+	CHECK(Write(directory / "truncated.dds", std::vector<uint8_t>(file.begin(), file.end() - 1)));
+
+	TextureParser parser;
+	parser.Parse(MakeRequest((directory / "valid.dds").wstring(), 0u));
+	parser.Parse(MakeRequest((directory / "missing.dds").wstring(), 1u));
+	parser.Parse(MakeRequest((directory / "truncated.dds").wstring(), 2u));
+	parser.Wait();
+
+	std::vector<std::unique_ptr<TextureParser::Request>> parsed = parser.TakeParsed();
+	CHECK_EQ(parsed.size(), 3u);
+	for (const auto& request : parsed)
+	{
+		switch (GetIndex(request))
+		{
+		case 0u:
+			CHECK_EQ(request->Result, S_OK);
+			break;
+		case 1u:
+			CHECK_EQ(request->Result, E_FAIL);
+			break;
+		default:
+			CHECK_EQ(request->Result, HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+			CHECK(request->Data.Subresources.empty());
+			break;
+		}
+	}
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(ReadFunctionRunsOnWorkers)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	// In-memory source, the way the loader reads textures out of an asset archive.
+	const std::vector<uint8_t> file = Make(MakeDesc(4u));
+	std::atomic<UINT> numReads = 0u;
+	TextureParser parser([&](const std::wstring& fileName, DirectX::DDSTextureData& outData)
+		{
+			numReads.fetch_add(1u);
+			return fileName == L"archived" ? DirectX::LoadDDSTextureDataFromMemory(file.data(), file.size(), outData) : E_FAIL;
+		});
+
+	constexpr UINT NumRequests = 100u;
+	for (UINT i = 0; i < NumRequests; ++i)
+	{
+		parser.Parse(MakeRequest(i % 10u == 0u ? L"unknown" : L"archived", i));
+	}
+	parser.Wait();
+
+	CHECK_EQ(numReads.load(), NumRequests);
+	UINT numFailed = 0u;
+	for (const auto& request : parser.TakeParsed())
+	{
+		numFailed += FAILED(request->Result) ? 1u : 0u;
+		CHECK_EQ(FAILED(request->Result), GetIndex(request) % 10u == 0u);
+		CHECK(FAILED(request->Result) || request->Data.Subresources[0].pData == file.data() + DX10HeaderSize);
+	}
+	CHECK_EQ(numFailed, NumRequests / 10u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(ArchivedFilesTakePrecedence)
+{
+	JobSystem::Get().Init(NumWorkers);
+	const TempDirectory directory("ScaldTextureParserTests");
+
+	// A stored and a compressed entry, a loose file only on disk and a stale loose copy of an archived one.
+	const std::vector<uint8_t> stored = Make(MakeDesc(5u));
+	const std::vector<uint8_t> compressed = Make(MakeDesc(4u));
+	AssetArchiveWriter writer;
+	writer.AddFile(directory / "stored.dds", stored, false);
+	writer.AddFile(directory / "compressed.dds", compressed);
+	CHECK(writer.Write(directory / "Assets.pak"));
+	CHECK(Write(directory / "loose.dds", Make(MakeDesc(3u))));
+	CHECK(Write(directory / "compressed.dds", Make(MakeDesc(0u))));
+
+	AssetArchive archive;
+	CHECK(archive.Open(directory / "Assets.pak"));
+	const AssetArchiveEntry* pStored = archive.Find(directory / "stored.dds");
+	const AssetArchiveEntry* pCompressed = archive.Find(directory / "compressed.dds");
+	CHECK(pStored && !pStored->IsCompressed());
+	CHECK(pCompressed && pCompressed->IsCompressed());
+
+	// What the TextureLoader reads with.
+	TextureParser parser([&archive](const std::wstring& fileName, DirectX::DDSTextureData& outData)
+		{
+			return TextureParser::ReadTextureData(&archive, fileName, outData);
+		});
+
+	const char* fileNames[] = { "stored.dds", "compressed.dds", "loose.dds", "missing.dds" };
+	for (UINT i = 0; i < 4u; ++i)
+	{
+		parser.Parse(MakeRequest((directory / fileNames[i]).wstring(), i));
+	}
+	parser.Wait();
+
+	std::vector<std::unique_ptr<TextureParser::Request>> parsed = parser.TakeParsed();
+	CHECK_EQ(parsed.size(), 4u);
+	for (const auto& request : parsed)
+	{
+		const DirectX::DDSTextureData& data = request->Data;
+		switch (GetIndex(request))
+		{
+		case 0u:
+			// Zero copy: straight out of the mapping, nothing owned by the texture data.
+			CHECK_EQ(request->Result, S_OK);
+			CHECK(!data.FileData);
+			CHECK(data.Subresources[0].pData == archive.GetMappedData(*pStored) + DX10HeaderSize);
+			CHECK_EQ(data.Width, MakeDesc(5u).Width);
+			break;
+		case 1u:
+			// Decompressed into storage that lives as long as the texture data, not the stale loose file.
+			CHECK_EQ(request->Result, S_OK);
+			CHECK(data.FileData);
+			CHECK(data.Subresources[0].pData == data.FileData.get() + DX10HeaderSize);
+			CHECK_EQ(data.Width, MakeDesc(4u).Width);
+			CHECK(std::equal(compressed.begin() + DX10HeaderSize, compressed.end(), static_cast<const uint8_t*>(data.Subresources[0].pData)));
+			break;
+		case 2u:
+			CHECK_EQ(request->Result, S_OK);
+			CHECK_EQ(data.Width, MakeDesc(3u).Width);
+			break;
+		default:
+			CHECK(FAILED(request->Result));
+			break;
+		}
+	}
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(PushedRequestsSkipTheRead)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	std::atomic<UINT> numReads = 0u;
+	TextureParser parser([&](const std::wstring&, DirectX::DDSTextureData&)
+		{
+			numReads.fetch_add(1u);
+			return S_OK;
+		});
+
+	std::unique_ptr<TextureParser::Request> request = MakeRequest(L"resident", 7u);
+	const TextureParser::Request* pRequest = request.get();
+	parser.Push(std::move(request));
+
+	std::vector<std::unique_ptr<TextureParser::Request>> parsed = parser.TakeParsed();
+	CHECK_EQ(parsed.size(), 1u);
+	// Same object, so the owner's state comes back with it.
+	CHECK(parsed[0].get() == pRequest);
+	CHECK_EQ(GetIndex(parsed[0]), 7u);
+	CHECK_EQ(numReads.load(), 0u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(DestructionWaitsForWorkers)
+{
+	JobSystem::Get().Init(NumWorkers);
+
+	std::atomic<UINT> numFinished = 0u;
+	{
+		TextureParser parser([&](const std::wstring&, DirectX::DDSTextureData&)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				numFinished.fetch_add(1u);
+				return S_OK;
+			});
+
+		for (UINT i = 0; i < 16u; ++i)
+		{
+			parser.Parse(MakeRequest(L"slow", i));
+		}
+		// Nothing taken: the parsed requests are freed with the parser, once the workers are done with them.
+	}
+	CHECK_EQ(numFinished.load(), 16u);
+
+	JobSystem::Get().Shutdown();
+}
+
+SCALD_TEST(ParsesInlineWithoutJobSystem)
+{
+	const std::vector<uint8_t> file = Make(MakeDesc(0u));
+	TextureParser parser([&](const std::wstring&, DirectX::DDSTextureData& outData)
+		{
+			return DirectX::LoadDDSTextureDataFromMemory(file.data(), file.size(), outData);
+		});
+
+	parser.Parse(MakeRequest(L"inline", 0u));
+	// Done by the time Parse returns
+	std::vector<std::unique_ptr<TextureParser::Request>> parsed = parser.TakeParsed();
+	CHECK_EQ(parsed.size(), 1u);
+	CHECK_EQ(parsed[0]->Result, S_OK);
+	CHECK_EQ(parsed[0]->Data.Width, 4u);
+}
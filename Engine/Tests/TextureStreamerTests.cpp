@@ -0,0 +1,358 @@
+#include "TestHarness.h"
+#include "Core/TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+namespace
+{
+	constexpr UINT TextureSize = 2048u;
+	constexpr UINT MipCount = 12u;
+	constexpr UINT TailMip = 5u;
+	constexpr float ScreenHeight = 1080.0f;
+	constexpr float NearZ = 0.1f;
+	// Frames between a request and the release of its old mips, like the loader and the fence wait in the engine.
+	constexpr UINT RequestLatency = 3u;
+
+	// BC1, 8 bytes per 4x4 block
+	UINT64 GetMipBytes(UINT mip)
+	{
+		const UINT64 blocks = std::max<UINT64>((TextureSize >> mip) / 4u, 1u);
+		return blocks * blocks * 8u;
+	}
+
+	UINT64 GetResidentBytes(UINT firstMip)
+	{
+		UINT64 bytes = 0u;
+		for (UINT mip = firstMip; mip < MipCount; ++mip)
+		{
+			bytes += GetMipBytes(mip);
+		}
+		return bytes;
+	}
+
+	struct Item
+	{
+		float Z;
+		float Radius;
+		UINT Texture;
+	};
+
+	// A corridor of items along +z, each with its own texture, and a camera looking down +z.
+	// Reports the mips like Engine::UpdateTextureStreaming and completes requests RequestLatency frames later.
+	class Scene
+	{
+	public:
+		Scene(UINT numItems, float spacing, UINT64 budgetBytes)
+			: Streamer(budgetBytes)
+		{
+			std::vector<UINT64> sizes(MipCount);
+			for (UINT mip = 0; mip < MipCount; ++mip)
+			{
+				sizes[mip] = GetMipBytes(mip);
+			}
+			for (UINT i = 0; i < numItems; ++i)
+			{
+				Items.push_back({ spacing * (i + 1u), 1.0f, Streamer.Register(TextureSize, TextureSize, MipCount, sizes.data()) });
+			}
+		}
+
+		bool IsVisible(const Item& item) const
+		{
+			return item.Z + item.Radius > CameraZ;
+		}
+
+		float GetRequiredMip(const Item& item) const
+		{
+			const float screenHeightAtUnitDistance = 2.0f * std::tan(0.5f * FovY);
+			const float distance = std::max(item.Z - CameraZ, NearZ);
+			const float projectedSize = 2.0f * item.Radius / (distance * screenHeightAtUnitDistance) * ScreenHeight;
+			return TextureStreamer::ComputeRequiredMip(TextureSize, TextureSize, UVScale, projectedSize);
+		}
+
+		// Resident size the frame would like, with unlimited memory
+		UINT GetWantedMip(const Item& item) const
+		{
+			return IsVisible(item) ? std::min((UINT)std::floor(std::max(GetRequiredMip(item), 0.0f)), TailMip) : TailMip;
+		}
+
+		void Frame()
+		{
+			++FrameIndex;
+			while (!InFlight.empty() && InFlight.front().second + RequestLatency <= FrameIndex)
+			{
+				Streamer.OnRequestComplete(InFlight.front().first);
+				bIsStreaming[InFlight.front().first] = false;
+				InFlight.pop_front();
+			}
+
+			Streamer.BeginFrame();
+			for (const Item& item : Items)
+			{
+				if (IsVisible(item))
+				{
+					Streamer.RequestMip(item.Texture, GetRequiredMip(item));
+				}
+			}
+
+			Streamer.Update(Requests);
+			bIsStreaming.resize(Items.size(), false);
+			for (const TextureStreamingRequest& request : Requests)
+			{
+				// At most one request per texture in flight
+				NumDoubleRequests += bIsStreaming[request.Handle] ? 1u : 0u;
+				bIsStreaming[request.Handle] = true;
+				InFlight.push_back({ request.Handle, FrameIndex });
+			}
+			MaxRequestsPerFrame = std::max(MaxRequestsPerFrame, (UINT)Requests.size());
+			TotalRequests += Requests.size();
+
+			// Accounting matches the resident mips
+			UINT64 residentBytes = 0u;
+			for (const Item& item : Items)
+			{
+				residentBytes += GetResidentBytes(Streamer.GetFirstResidentMip(item.Texture));
+			}
+			NumAccountingErrors += residentBytes == Streamer.GetStats().ResidentBytes ? 0u : 1u;
+			MaxResidentBytes = std::max(MaxResidentBytes, residentBytes);
+		}
+
+		void Frames(UINT count)
+		{
+			for (UINT i = 0; i < count; ++i)
+			{
+				Frame();
+			}
+		}
+
+		UINT CountAtWantedMip() const
+		{
+			UINT count = 0u;
+			for (const Item& item : Items)
+			{
+				count += Streamer.GetFirstResidentMip(item.Texture) <= GetWantedMip(item) ? 1u : 0u;
+			}
+			return count;
+		}
+
+		void ResetCounters()
+		{
+			MaxRequestsPerFrame = 0u;
+			TotalRequests = 0u;
+			MaxResidentBytes = 0u;
+		}
+
+	public:
+		TextureStreamer Streamer;
+		std::vector<Item> Items;
+		float CameraZ = 0.0f;
+		float FovY = 1.0471976f;
+		float UVScale = 1.0f;
+
+		UINT64 FrameIndex = 0u;
+		std::vector<TextureStreamingRequest> Requests;
+		std::deque<std::pair<UINT, UINT64>> InFlight;
+		std::vector<bool> bIsStreaming;
+
+		UINT NumDoubleRequests = 0u;
+		UINT NumAccountingErrors = 0u;
+		UINT MaxRequestsPerFrame = 0u;
+		size_t TotalRequests = 0u;
+		UINT64 MaxResidentBytes = 0u;
+	};
+}
+
+SCALD_TEST(TailMipKeepsSmallMipsResident)
+{
+	CHECK_EQ(TextureStreamer::ComputeTailMip(2048u, 2048u, 12u), 5u);
+	CHECK_EQ(TextureStreamer::ComputeTailMip(2048u, 512u, 12u), 5u);
+	CHECK_EQ(TextureStreamer::ComputeTailMip(64u, 64u, 7u), 0u);
+	// Chain stops before the minimum size
+	CHECK_EQ(TextureStreamer::ComputeTailMip(2048u, 2048u, 3u), 2u);
+
+	// One texel per pixel up close, every halving of the projected size drops a mip.
+	CHECK_NEAR(TextureStreamer::ComputeRequiredMip(1024u, 1024u, 1.0f, 1024.0f), 0.0f, 1e-6f);
+	CHECK_NEAR(TextureStreamer::ComputeRequiredMip(1024u, 1024u, 1.0f, 2048.0f), 0.0f, 1e-6f);
+	CHECK_NEAR(TextureStreamer::ComputeRequiredMip(1024u, 1024u, 1.0f, 256.0f), 2.0f, 1e-5f);
+	// Tiled four times, every repeat covers a quarter of the pixels
+	CHECK_NEAR(TextureStreamer::ComputeRequiredMip(1024u, 1024u, 4.0f, 1024.0f), 2.0f, 1e-5f);
+}
+
+SCALD_TEST(StationaryCameraConvergesWithEnoughBudget)
+{
+	Scene scene(32u, 4.0f, UINT64_MAX);
+	scene.Frames(100u);
+
+	CHECK_EQ(scene.CountAtWantedMip(), 32u);
+	CHECK_EQ(scene.Streamer.GetStats().ResidentBytes, scene.Streamer.GetStats().WantedBytes);
+	CHECK(scene.MaxRequestsPerFrame <= TextureStreamer::DefaultMaxRequestsPerUpdate);
+	CHECK_EQ(scene.NumDoubleRequests, 0u);
+	CHECK_EQ(scene.NumAccountingErrors, 0u);
+
+	// Nothing left to do, so nothing is requested
+	scene.ResetCounters();
+	scene.Frames(20u);
+	CHECK_EQ(scene.TotalRequests, 0u);
+}
+
+SCALD_TEST(TightBudgetIsNeverExceeded)
+{
+	// Room for the tails and a fraction of what the view wants
+	const UINT64 tailBytes = 32u * GetResidentBytes(TailMip);
+	Scene probe(32u, 4.0f, UINT64_MAX);
+	probe.Frame();
+	const UINT64 wantedBytes = probe.Streamer.GetStats().WantedBytes;
+	const UINT64 budget = tailBytes + (wantedBytes - tailBytes) / 3u;
+
+	Scene scene(32u, 4.0f, budget);
+	scene.Frames(200u);
+
+	CHECK(scene.MaxResidentBytes <= budget);
+	CHECK(scene.Streamer.GetStats().WantedBytes > budget);
+	CHECK_EQ(scene.NumDoubleRequests, 0u);
+	CHECK_EQ(scene.NumAccountingErrors, 0u);
+
+	// The budget goes to the items that need it most: upgrades are incremental, so the nearest item may stop
+	// a mip short when the next one does not fit, but it is the sharpest one and residency never gets finer with distance.
+	const UINT nearestMip = scene.Streamer.GetFirstResidentMip(scene.Items[0].Texture);
+	CHECK(nearestMip < TailMip);
+	CHECK(nearestMip <= scene.GetWantedMip(scene.Items[0]) + 1u);
+	UINT numInversions = 0u;
+	for (size_t i = 1; i < scene.Items.size(); ++i)
+	{
+		numInversions += scene.Streamer.GetFirstResidentMip(scene.Items[i].Texture) < scene.Streamer.GetFirstResidentMip(scene.Items[i - 1].Texture) ? 1u : 0u;
+	}
+	CHECK_EQ(numInversions, 0u);
+
+	// Settled: no mips traded back and forth
+	scene.ResetCounters();
+	scene.Frames(50u);
+	CHECK_EQ(scene.TotalRequests, 0u);
+}
+
+SCALD_TEST(FlyThroughEvictsWhatsBehind)
+{
+	const UINT64 budget = 48u * 1024u * 1024u;
+	Scene scene(64u, 6.0f, budget);
+
+	// Moving down the corridor, items passed by are behind the camera and unused.
+	for (UINT frame = 0; frame < 600u; ++frame)
+	{
+		scene.CameraZ += 0.5f;
+		scene.Frame();
+	}
+	CHECK(scene.MaxResidentBytes <= budget);
+	CHECK_EQ(scene.NumDoubleRequests, 0u);
+	CHECK_EQ(scene.NumAccountingErrors, 0u);
+	CHECK(scene.Streamer.GetStats().NumEvicted > 0u);
+
+	// Stop and let it settle. What the view wants did not fit next to everything passed by, so the items
+	// passed first went back to the tail to make room, and every visible item got all it wants.
+	scene.Frames(60u);
+	UINT numBehindAtTail = 0u;
+	UINT numVisibleNotWanted = 0u;
+	for (const Item& item : scene.Items)
+	{
+		const UINT firstMip = scene.Streamer.GetFirstResidentMip(item.Texture);
+		if (!scene.IsVisible(item))
+		{
+			numBehindAtTail += firstMip == TailMip ? 1u : 0u;
+		}
+		else
+		{
+			numVisibleNotWanted += firstMip != scene.GetWantedMip(item) ? 1u : 0u;
+		}
+	}
+	CHECK(numBehindAtTail > 0u);
+	CHECK_EQ(numVisibleNotWanted, 0u);
+	CHECK_EQ(scene.Streamer.GetFirstResidentMip(scene.Items[0].Texture), TailMip);
+	CHECK(scene.Streamer.GetStats().ResidentBytes <= budget);
+}
+
+SCALD_TEST(UnusedMipsStayUntilMemoryIsNeeded)
+{
+	Scene scene(8u, 4.0f, UINT64_MAX);
+	scene.Frames(60u);
+	const UINT firstMip = scene.Streamer.GetFirstResidentMip(scene.Items[0].Texture);
+	CHECK(firstMip < TailMip);
+
+	// Turn around: nothing is visible, but with memory to spare nothing is evicted either.
+	scene.CameraZ = 1000.0f;
+	scene.Frames(30u);
+	CHECK_EQ(scene.Streamer.GetFirstResidentMip(scene.Items[0].Texture), firstMip);
+	CHECK_EQ(scene.Streamer.GetStats().NumEvicted, 0u);
+
+	// Lowering the budget evicts right away, even without new requests.
+	const UINT64 tailBytes = 8u * GetResidentBytes(TailMip);
+	scene.Streamer.SetBudget(tailBytes);
+	scene.Frames(30u);
+	CHECK_EQ(scene.Streamer.GetStats().ResidentBytes, tailBytes);
+	CHECK_EQ(scene.NumAccountingErrors, 0u);
+}
+
+SCALD_TEST(ZoomingInRaisesTheWantedMips)
+{
+	Scene scene(16u, 8.0f, UINT64_MAX);
+	scene.Frames(60u);
+	const UINT64 wideBytes = scene.Streamer.GetStats().ResidentBytes;
+
+	// Narrower field of view: items cover more pixels and need finer mips.
+	scene.FovY = 0.25f;
+	scene.Frames(60u);
+	CHECK(scene.Streamer.GetStats().ResidentBytes > wideBytes);
+	CHECK_EQ(scene.CountAtWantedMip(), 16u);
+
+	// Tiled textures need coarser mips. The finer ones aren't needed, but stay, as there's no memory pressure.
+	const TextureStreamerStats zoomedStats = scene.Streamer.GetStats();
+	scene.UVScale = 4.0f;
+	scene.Frames(60u);
+	CHECK(scene.Streamer.GetStats().WantedBytes < zoomedStats.WantedBytes);
+	CHECK_EQ(scene.Streamer.GetStats().ResidentBytes, zoomedStats.ResidentBytes);
+	CHECK_EQ(scene.Streamer.GetStats().NumEvicted, 0u);
+}
+
+SCALD_TEST(UnusedTexturesAreEvictedBeforeUsedOnes)
+{
+	std::vector<UINT64> sizes(MipCount);
+	for (UINT mip = 0; mip < MipCount; ++mip)
+	{
+		sizes[mip] = GetMipBytes(mip);
+	}
+	TextureStreamer streamer(UINT64_MAX);
+	const UINT unused = streamer.Register(TextureSize, TextureSize, MipCount, sizes.data());
+	const UINT used = streamer.Register(TextureSize, TextureSize, MipCount, sizes.data());
+
+	// Both fully resident.
+	std::vector<TextureStreamingRequest> requests;
+	streamer.BeginFrame();
+	streamer.RequestMip(unused, 0.0f);
+	streamer.RequestMip(used, 0.0f);
+	streamer.Update(requests);
+	CHECK_EQ(requests.size(), 2u);
+	for (const TextureStreamingRequest& request : requests)
+	{
+		streamer.OnRequestComplete(request.Handle);
+	}
+
+	// Only one is still drawn, and needs less than it has, so both have mips to give back.
+	for (UINT frame = 0; frame < 3u; ++frame)
+	{
+		streamer.BeginFrame();
+		streamer.RequestMip(used, 2.0f);
+		streamer.Update(requests);
+		CHECK(requests.empty());
+	}
+
+	// Either eviction alone makes room: the least recently used texture goes, the one used this frame keeps its mips.
+	const UINT64 residentBytes = streamer.GetStats().ResidentBytes;
+	streamer.SetBudget(residentBytes - (GetResidentBytes(0u) - GetResidentBytes(2u)));
+	streamer.BeginFrame();
+	streamer.RequestMip(used, 2.0f);
+	streamer.Update(requests);
+	CHECK_EQ(requests.size(), 1u);
+	CHECK_EQ(requests[0].Handle, unused);
+	CHECK_EQ(streamer.GetFirstResidentMip(unused), TailMip);
+	CHECK_EQ(streamer.GetFirstResidentMip(used), 0u);
+	CHECK_EQ(streamer.GetStats().NumEvicted, 1u);
+}
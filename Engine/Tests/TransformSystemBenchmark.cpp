@@ -0,0 +1,150 @@
+#include "BenchHarness.h"
+#include "GameFramework/Components/ComponentManager.h"
+#include "GameFramework/Components/Transform.h"
+#include "GameFramework/Components/Renderer.h"
+#include "GameFramework/Components/TransformSystem.h"
+#include "Core/JobSystem.h"
+
+#include <random>
+
+using namespace Scald;
+
+namespace
+{
+	// 100k transforms in three levels: 1000 roots with 9 children each, every child with 10 renderable leaves.
+	static constexpr UINT NumRoots = 1000u;
+	static constexpr UINT ChildrenPerRoot = 9u;
+	static constexpr UINT LeavesPerChild = 10u;
+	static constexpr UINT NumTransforms = NumRoots * (1u + ChildrenPerRoot * (1u + LeavesPerChild));
+
+	struct Hierarchy
+	{
+		std::vector<Entity> Roots;
+		std::vector<Entity> All;
+		UINT NumRenderers = 0u;
+	};
+
+	Hierarchy CreateHierarchy(TransformSystem& system)
+	{
+		ComponentManager& manager = ComponentManager::Get();
+		std::mt19937 rng(3u);
+		std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+		std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+
+		Hierarchy hierarchy;
+		auto create = [&](Entity parent)
+			{
+				const Entity entity = manager.CreateEntity();
+				manager.AddComponent<Transform>(entity, XMVectorSet(offset(rng), offset(rng), offset(rng), 0.0f),
+					XMVectorSet(angle(rng), angle(rng), angle(rng), 0.0f), XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f));
+				if (parent.IsValid())
+				{
+					system.SetParent(entity, parent);
+				}
+				hierarchy.All.push_back(entity);
+				return entity;
+			};
+
+		for (UINT r = 0; r < NumRoots; ++r)
+		{
+			const Entity root = create(Entity{});
+			hierarchy.Roots.push_back(root);
+			for (UINT c = 0; c < ChildrenPerRoot; ++c)
+			{
+				const Entity child = create(root);
+				for (UINT l = 0; l < LeavesPerChild; ++l)
+				{
+					manager.AddComponent<Renderer>(create(child)).ObjCBIndex = hierarchy.NumRenderers++;
+				}
+			}
+		}
+		return hierarchy;
+	}
+
+	void MoveRoots(const Hierarchy& hierarchy, UINT stride, float t)
+	{
+		ComponentManager& manager = ComponentManager::Get();
+		for (UINT r = 0; r < (UINT)hierarchy.Roots.size(); r += stride)
+		{
+			manager.GetComponent<Transform>(hierarchy.Roots[r])->SetTranslation(XMVectorSet(t, (float)r, 0.0f, 0.0f));
+		}
+	}
+
+	void RunUpdates(const char* suffix, TransformSystem& system, const Hierarchy& hierarchy, std::vector<PaddedObjectConstants>& objectsCB)
+	{
+		std::vector<UINT> changed;
+		changed.reserve(objectsCB.size());
+		float t = 0.0f;
+		char name[96];
+
+		std::snprintf(name, sizeof(name), "update 100k, all dirty%s", suffix);
+		ScaldBench::Report(name, ScaldBench::Measure(20, [&]()
+			{
+				MoveRoots(hierarchy, 1u, t += 1.0f);
+				changed.clear();
+				system.Update(objectsCB.data(), changed);
+			}));
+
+		std::snprintf(name, sizeof(name), "update 100k, 1%% of subtrees dirty%s", suffix);
+		ScaldBench::Report(name, ScaldBench::Measure(20, [&]()
+			{
+				MoveRoots(hierarchy, 100u, t += 1.0f);
+				changed.clear();
+				system.Update(objectsCB.data(), changed);
+			}));
+
+		std::snprintf(name, sizeof(name), "update 100k, nothing dirty%s", suffix);
+		ScaldBench::Report(name, ScaldBench::Measure(20, [&]()
+			{
+				changed.clear();
+				system.Update(objectsCB.data(), changed);
+			}));
+	}
+}
+
+int main()
+{
+	TransformSystem system;
+	const Hierarchy hierarchy = CreateHierarchy(system);
+	std::vector<PaddedObjectConstants> objectsCB(hierarchy.NumRenderers);
+
+	std::vector<UINT> changed;
+	ScaldBench::Report("build levels + first update of 100k", ScaldBench::Measure(1, [&]()
+		{
+			system.Update(objectsCB.data(), changed);
+		}));
+
+	// Job system is not initialized yet, so every level runs on this thread.
+	RunUpdates(", 1 thread", system, hierarchy, objectsCB);
+
+	JobSystem::Get().Init();
+	char suffix[32];
+	std::snprintf(suffix, sizeof(suffix), ", %u job threads", JobSystem::Get().GetNumThreads());
+	RunUpdates(suffix, system, hierarchy, objectsCB);
+	JobSystem::Get().Shutdown();
+
+	// Cost of the inversion itself: one call per matrix, as UpdateRange did before, against one call per batch.
+	std::vector<XMFLOAT4X4> worlds(hierarchy.NumRenderers);
+	std::vector<XMFLOAT4X4> inverses(hierarchy.NumRenderers);
+	for (UINT i = 0; i < hierarchy.NumRenderers; ++i)
+	{
+		XMStoreFloat4x4(&worlds[i], XMMatrixTranspose(XMLoadFloat4x4(&objectsCB[i].World)));
+	}
+
+	ScaldBench::Report("invert 90k, one call per matrix", ScaldBench::Measure(20, [&]()
+		{
+			for (size_t i = 0; i < worlds.size(); ++i)
+			{
+				ScaldMath::InverseAffineBatch(&worlds[i], &inverses[i], 1u);
+			}
+			ScaldBench::DoNotOptimize(inverses[0]);
+		}));
+
+	ScaldBench::Report("invert 90k, one batched call", ScaldBench::Measure(20, [&]()
+		{
+			ScaldMath::InverseAffineBatch(worlds.data(), inverses.data(), worlds.size());
+			ScaldBench::DoNotOptimize(inverses[0]);
+		}));
+
+	return (UINT)hierarchy.All.size() == NumTransforms ? 0 : 1;
+}
@@ -0,0 +1,329 @@
+#include "TestHarness.h"
+#include "GameFramework/Components/ComponentManager.h"
+#include "GameFramework/Components/Transform.h"
+#include "GameFramework/Components/Renderer.h"
+#include "GameFramework/Components/TransformSystem.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace Scald;
+
+namespace
+{
+	static constexpr float Epsilon = 1e-4f;
+
+	Entity CreateTransform(FXMVECTOR pos, FXMVECTOR rot = XMVectorZero(), FXMVECTOR scale = XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f))
+	{
+		ComponentManager& manager = ComponentManager::Get();
+		const Entity entity = manager.CreateEntity();
+		manager.AddComponent<Transform>(entity, pos, rot, scale);
+		return entity;
+	}
+
+	void AddRenderer(Entity entity, UINT objCBIndex)
+	{
+		ComponentManager::Get().AddComponent<Renderer>(entity).ObjCBIndex = objCBIndex;
+	}
+
+	Transform& GetTransform(Entity entity)
+	{
+		return *ComponentManager::Get().GetComponent<Transform>(entity);
+	}
+
+	// Reference world matrix: local matrices multiplied up the parent chain.
+	XMMATRIX ComputeWorld(Entity entity)
+	{
+		ComponentManager& manager = ComponentManager::Get();
+		XMMATRIX world = XMMatrixIdentity();
+		for (const Transform* transform = manager.GetComponent<Transform>(entity); transform; transform = manager.GetComponent<Transform>(transform->GetParent()))
+		{
+			world = XMMatrixMultiply(world, transform->GetLocalMatrix());
+		}
+		return world;
+	}
+
+	bool IsNear(FXMMATRIX a, CXMMATRIX b, float eps = Epsilon)
+	{
+		for (int r = 0; r < 4; ++r)
+		{
+			if (!XMVector4NearEqual(a.r[r], b.r[r], XMVectorReplicate(eps)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Contains(const std::vector<UINT>& indices, UINT index)
+	{
+		return std::find(indices.begin(), indices.end(), index) != indices.end();
+	}
+
+	// Pools are shared by all the tests of the executable, so every test cleans up its entities.
+	void DestroyAll(const std::vector<Entity>& entities)
+	{
+		for (Entity entity : entities)
+		{
+			ComponentManager::Get().DestroyEntity(entity);
+		}
+	}
+}
+
+SCALD_TEST(WorldMatricesFollowHierarchy)
+{
+	const Entity root = CreateTransform(XMVectorSet(10.0f, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, XM_PIDIV2, 0.0f, 0.0f));
+	const Entity child = CreateTransform(XMVectorSet(0.0f, 0.0f, 5.0f, 0.0f), XMVectorZero(), XMVectorSet(2.0f, 2.0f, 2.0f, 0.0f));
+	const Entity grandChild = CreateTransform(XMVectorSet(1.0f, 2.0f, 3.0f, 0.0f), XMVectorSet(0.3f, 0.0f, 0.1f, 0.0f));
+
+	TransformSystem system;
+	// Grandchild is parented before its parent is, levels must not depend on the order of the calls.
+	CHECK(system.SetParent(grandChild, child));
+	CHECK(system.SetParent(child, root));
+
+	std::vector<UINT> changed;
+	system.Update(nullptr, changed);
+
+	for (Entity entity : { root, child, grandChild })
+	{
+		CHECK(IsNear(GetTransform(entity).GetWorldMatrix(), ComputeWorld(entity)));
+	}
+
+	// Child's origin is rotated by the root: +Z turns into +X.
+	const XMVECTOR childOrigin = GetTransform(child).GetWorldMatrix().r[3];
+	CHECK(XMVector3NearEqual(childOrigin, XMVectorSet(15.0f, 0.0f, 0.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	DestroyAll({ root, child, grandChild });
+}
+
+SCALD_TEST(DirtyRootPropagatesToDescendantsOnly)
+{
+	const Entity root = CreateTransform(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+	const Entity child = CreateTransform(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const Entity grandChild = CreateTransform(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
+	const Entity other = CreateTransform(XMVectorSet(-3.0f, 0.0f, 0.0f, 0.0f));
+	AddRenderer(root, 0u);
+	AddRenderer(child, 1u);
+	AddRenderer(grandChild, 2u);
+	AddRenderer(other, 3u);
+
+	TransformSystem system;
+	system.SetParent(child, root);
+	system.SetParent(grandChild, child);
+
+	std::vector<PaddedObjectConstants> objectsCB(4u);
+	std::vector<UINT> changed;
+
+	// First update computes everything.
+	system.Update(objectsCB.data(), changed);
+	CHECK_EQ(changed.size(), 4u);
+
+	// Nothing has changed since.
+	changed.clear();
+	system.Update(objectsCB.data(), changed);
+	CHECK(changed.empty());
+
+	// Moving the root refreshes the whole subtree, but not the unrelated root.
+	GetTransform(root).SetTranslation(XMVectorSet(7.0f, 0.0f, 0.0f, 0.0f));
+	changed.clear();
+	system.Update(objectsCB.data(), changed);
+	CHECK_EQ(changed.size(), 3u);
+	CHECK(Contains(changed, 0u) && Contains(changed, 1u) && Contains(changed, 2u));
+	CHECK(XMVector3NearEqual(GetTransform(grandChild).GetWorldMatrix().r[3], XMVectorSet(7.0f, 1.0f, 1.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	// Moving the middle one leaves its parent alone.
+	GetTransform(child).SetScale(XMVectorSet(3.0f, 3.0f, 3.0f, 0.0f));
+	changed.clear();
+	system.Update(objectsCB.data(), changed);
+	CHECK_EQ(changed.size(), 2u);
+	CHECK(Contains(changed, 1u) && Contains(changed, 2u));
+	CHECK(XMVector3NearEqual(GetTransform(grandChild).GetWorldMatrix().r[3], XMVectorSet(7.0f, 1.0f, 3.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	DestroyAll({ root, child, grandChild, other });
+}
+
+SCALD_TEST(ObjectConstantsHoldTransposedWorldAndInverse)
+{
+	const Entity root = CreateTransform(XMVectorSet(4.0f, -2.0f, 9.0f, 0.0f), XMVectorSet(0.4f, 1.1f, -0.3f, 0.0f), XMVectorSet(1.0f, 2.0f, 0.5f, 0.0f));
+	const Entity child = CreateTransform(XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f), XMVectorSet(-0.2f, 0.6f, 0.9f, 0.0f), XMVectorSet(3.0f, 3.0f, 3.0f, 0.0f));
+	AddRenderer(root, 1u);
+	AddRenderer(child, 0u);
+
+	TransformSystem system;
+	system.SetParent(child, root);
+
+	std::vector<PaddedObjectConstants> objectsCB(2u);
+	std::vector<UINT> changed;
+	system.Update(objectsCB.data(), changed);
+
+	for (Entity entity : { root, child })
+	{
+		const PaddedObjectConstants& constants = objectsCB[ComponentManager::Get().GetComponent<Renderer>(entity)->ObjCBIndex];
+		const XMMATRIX world = ComputeWorld(entity);
+
+		CHECK(IsNear(XMMatrixTranspose(XMLoadFloat4x4(&constants.World)), world));
+		// Shader transforms normals by transpose of InvTransposeWorld, which must be inverse(World).
+		CHECK(IsNear(XMLoadFloat4x4(&constants.InvTransposeWorld), XMMatrixInverse(nullptr, world)));
+	}
+
+	DestroyAll({ root, child });
+}
+
+SCALD_TEST(ReparentingMovesSubtree)
+{
+	const Entity a = CreateTransform(XMVectorSet(100.0f, 0.0f, 0.0f, 0.0f));
+	const Entity b = CreateTransform(XMVectorSet(0.0f, 100.0f, 0.0f, 0.0f));
+	const Entity child = CreateTransform(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+	const Entity grandChild = CreateTransform(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	AddRenderer(grandChild, 0u);
+
+	TransformSystem system;
+	system.SetParent(child, a);
+	system.SetParent(grandChild, child);
+
+	std::vector<PaddedObjectConstants> objectsCB(1u);
+	std::vector<UINT> changed;
+	system.Update(objectsCB.data(), changed);
+	CHECK(XMVector3NearEqual(GetTransform(grandChild).GetWorldMatrix().r[3], XMVectorSet(101.0f, 1.0f, 0.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	// Only the child is reparented, its untouched descendant follows.
+	CHECK(system.SetParent(child, b));
+	changed.clear();
+	system.Update(objectsCB.data(), changed);
+	CHECK(Contains(changed, 0u));
+	CHECK(XMVector3NearEqual(GetTransform(grandChild).GetWorldMatrix().r[3], XMVectorSet(1.0f, 101.0f, 0.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	// Deeper new parent: b under a, so child and grandChild go one level down.
+	CHECK(system.SetParent(b, a));
+	changed.clear();
+	system.Update(objectsCB.data(), changed);
+	CHECK(IsNear(GetTransform(grandChild).GetWorldMatrix(), ComputeWorld(grandChild)));
+	CHECK(XMVector3NearEqual(GetTransform(grandChild).GetWorldMatrix().r[3], XMVectorSet(101.0f, 101.0f, 0.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	// Detached child keeps only its local transform.
+	CHECK(system.SetParent(child, Entity{}));
+	system.Update(objectsCB.data(), changed);
+	CHECK(XMVector3NearEqual(GetTransform(grandChild).GetWorldMatrix().r[3], XMVectorSet(1.0f, 1.0f, 0.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	DestroyAll({ a, b, child, grandChild });
+}
+
+SCALD_TEST(CyclicParentIsRejected)
+{
+	const Entity root = CreateTransform(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+	const Entity child = CreateTransform(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const Entity grandChild = CreateTransform(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
+
+	TransformSystem system;
+	CHECK(system.SetParent(child, root));
+	CHECK(system.SetParent(grandChild, child));
+
+	CHECK(!system.SetParent(root, grandChild));
+	CHECK(!system.SetParent(root, child));
+	CHECK(!system.SetParent(child, child));
+	CHECK(GetTransform(root).GetParent() == Entity{});
+
+	// Update must still terminate and the hierarchy is intact.
+	std::vector<UINT> changed;
+	system.Update(nullptr, changed);
+	CHECK(XMVector3NearEqual(GetTransform(grandChild).GetWorldMatrix().r[3], XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	DestroyAll({ root, child, grandChild });
+}
+
+SCALD_TEST(DestroyedParentMakesChildRoot)
+{
+	const Entity root = CreateTransform(XMVectorSet(5.0f, 0.0f, 0.0f, 0.0f));
+	const Entity child = CreateTransform(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+	TransformSystem system;
+	system.SetParent(child, root);
+	std::vector<UINT> changed;
+	system.Update(nullptr, changed);
+
+	ComponentManager::Get().DestroyEntity(root);
+	// Index of the destroyed parent is reused, the stale parent handle must not resolve to it.
+	const Entity reused = CreateTransform(XMVectorSet(-50.0f, 0.0f, 0.0f, 0.0f));
+	GetTransform(child).SetTranslation(XMVectorSet(0.0f, 2.0f, 0.0f, 0.0f));
+	system.Update(nullptr, changed);
+	CHECK(XMVector3NearEqual(GetTransform(child).GetWorldMatrix().r[3], XMVectorSet(0.0f, 2.0f, 0.0f, 0.0f), XMVectorReplicate(Epsilon)));
+
+	DestroyAll({ child, reused });
+}
+
+SCALD_TEST(ParallelLevelsMatchReference)
+{
+	// Wide levels go through ParallelFor and the per-thread inverse batches.
+	static constexpr UINT NumRoots = 64u;
+	static constexpr UINT NumChildren = 6000u;
+	static constexpr UINT NumGrandChildren = 6000u;
+
+	JobSystem::Get().Init(3u);
+
+	std::mt19937 rng(7u);
+	std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+
+	std::vector<Entity> entities;
+	// Parents are passed by reference while new entities are appended.
+	entities.reserve(NumRoots + NumChildren + NumGrandChildren);
+	auto createRandom = [&]()
+		{
+			const Entity entity = CreateTransform(XMVectorSet(offset(rng), offset(rng), offset(rng), 0.0f), XMVectorSet(angle(rng), angle(rng), angle(rng), 0.0f));
+			AddRenderer(entity, (UINT)entities.size());
+			entities.push_back(entity);
+			return entity;
+		};
+
+	TransformSystem system;
+	for (UINT i = 0; i < NumRoots; ++i)
+	{
+		createRandom();
+	}
+	for (UINT i = 0; i < NumChildren; ++i)
+	{
+		system.SetParent(createRandom(), entities[i % NumRoots]);
+	}
+	for (UINT i = 0; i < NumGrandChildren; ++i)
+	{
+		system.SetParent(createRandom(), entities[NumRoots + (i * 7u) % NumChildren]);
+	}
+
+	std::vector<PaddedObjectConstants> objectsCB(entities.size());
+	std::vector<UINT> changed;
+	system.Update(objectsCB.data(), changed);
+
+	std::sort(changed.begin(), changed.end());
+	CHECK_EQ(changed.size(), entities.size());
+	CHECK(std::adjacent_find(changed.begin(), changed.end()) == changed.end());
+
+	auto checkAll = [&]()
+		{
+			int numMismatches = 0;
+			for (UINT i = 0; i < (UINT)entities.size(); ++i)
+			{
+				const XMMATRIX world = ComputeWorld(entities[i]);
+				if (!IsNear(XMMatrixTranspose(XMLoadFloat4x4(&objectsCB[i].World)), world, 1e-3f) ||
+					!IsNear(XMMatrixMultiply(world, XMLoadFloat4x4(&objectsCB[i].InvTransposeWorld)), XMMatrixIdentity(), 1e-3f))
+				{
+					++numMismatches;
+				}
+			}
+			CHECK_EQ(numMismatches, 0);
+		};
+	checkAll();
+
+	// A few dirty roots: only their subtrees are reported.
+	for (UINT i = 0; i < NumRoots; i += 8u)
+	{
+		GetTransform(entities[i]).SetTranslation(XMVectorSet(0.0f, (float)i, 0.0f, 0.0f));
+	}
+	changed.clear();
+	system.Update(objectsCB.data(), changed);
+	CHECK(!changed.empty() && changed.size() < entities.size());
+	checkAll();
+
+	DestroyAll(entities);
+	JobSystem::Get().Shutdown();
+}
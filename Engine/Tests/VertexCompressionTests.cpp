@@ -0,0 +1,305 @@
+#include "TestHarness.h"
+#include "Core/VertexCompression.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// What the input assembler hands to the vertex shader for the packed formats.
+	float UnormToFloat(uint16_t value)
+	{
+		return value / 65535.0f;
+	}
+
+	float SnormToFloat(int16_t value)
+	{
+		return std::max(value / 32767.0f, -1.0f);
+	}
+
+	// Line by line port of the decoding in Common.hlsl, so the tests check the CPU encoder against what the shaders read.
+	struct Shader
+	{
+		static XMFLOAT3 DequantizePosition(const XMFLOAT3& posQ, const PositionDequantization& dequantization)
+		{
+			return XMFLOAT3(
+				posQ.x * dequantization.Scale.x + dequantization.Bias.x,
+				posQ.y * dequantization.Scale.y + dequantization.Bias.y,
+				posQ.z * dequantization.Scale.z + dequantization.Bias.z);
+		}
+
+		static XMFLOAT3 OctahedralDecode(float ex, float ey)
+		{
+			float nx = ex;
+			float ny = ey;
+			const float nz = 1.0f - std::fabs(ex) - std::fabs(ey);
+			const float t = std::min(std::max(-nz, 0.0f), 1.0f);
+			nx += nx >= 0.0f ? -t : t;
+			ny += ny >= 0.0f ? -t : t;
+			const float invLength = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+			return XMFLOAT3(nx * invLength, ny * invLength, nz * invLength);
+		}
+
+		static float BitangentSign(float posW)
+		{
+			return posW * 2.0f - 1.0f;
+		}
+	};
+
+	struct Rng
+	{
+		uint32_t State;
+
+		float Next()
+		{
+			State = State * 1664525u + 1013904223u;
+			return (State >> 8) / 16777216.0f;
+		}
+
+		float Next(float a, float b)
+		{
+			return a + Next() * (b - a);
+		}
+	};
+
+	XMFLOAT3 Normalized(float x, float y, float z)
+	{
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+		return result;
+	}
+
+	// atan2 of the cross and dot products in double, acos of a float dot product can't resolve angles below ~5e-4.
+	float AngleBetween(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		const double cx = (double)a.y * b.z - (double)a.z * b.y;
+		const double cy = (double)a.z * b.x - (double)a.x * b.z;
+		const double cz = (double)a.x * b.y - (double)a.y * b.x;
+		const double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+		return (float)std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot);
+	}
+
+	// Axes, diagonals and points right on the seams of the octahedral map: the equator (z = 0), where the lower
+	// hemisphere is folded, and the x = 0 / y = 0 planes, where the fold flips sign. Random directions after that.
+	std::vector<XMFLOAT3> MakeDirections(UINT numRandom)
+	{
+		std::vector<XMFLOAT3> directions = {
+			{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+		};
+		for (float sx : { -1.0f, 1.0f })
+		{
+			for (float sy : { -1.0f, 1.0f })
+			{
+				for (float sz : { -1.0f, 0.0f, 1.0f })
+				{
+					directions.push_back(Normalized(sx, sy, sz));
+				}
+				directions.push_back(Normalized(sx, 0.0f, sy));
+				directions.push_back(Normalized(0.0f, sx, sy));
+				// Just below and above the equator
+				directions.push_back(Normalized(sx, sy, -1e-4f));
+				directions.push_back(Normalized(sx, sy, 1e-4f));
+				directions.push_back(Normalized(sx * 1e-4f, sy, -1.0f));
+			}
+		}
+
+		Rng rng = { 42u };
+		while (directions.size() < numRandom)
+		{
+			const float x = rng.Next(-1.0f, 1.0f);
+			const float y = rng.Next(-1.0f, 1.0f);
+			const float z = rng.Next(-1.0f, 1.0f);
+			const float lengthSq = x * x + y * y + z * z;
+			if (lengthSq > 1e-4f && lengthSq <= 1.0f)
+			{
+				directions.push_back(Normalized(x, y, z));
+			}
+		}
+		return directions;
+	}
+
+	VertexPositionNormalTangentUV MakeVertex(const XMFLOAT3& position, const XMFLOAT3& normal)
+	{
+		// Any unit vector does for the tangent, the encoding doesn't need it orthogonal.
+		return VertexPositionNormalTangentUV(position, normal, XMFLOAT3(normal.y, normal.z, -normal.x), XMFLOAT2(0.0f, 0.0f));
+	}
+
+	// 16 bit snorm octahedral coordinates: steps of 1/32767, the map stretches them by up to a few times on the sphere.
+	static constexpr float MaxOctahedralAngleError = 1e-4f;
+}
+
+SCALD_TEST(OctahedralRoundTripThroughShaderDecode)
+{
+	const std::vector<XMFLOAT3> normals = MakeDirections(20000u);
+	std::vector<VertexPositionNormalTangentUV> vertices;
+	for (const XMFLOAT3& normal : normals)
+	{
+		vertices.push_back(MakeVertex(XMFLOAT3(0.0f, 0.0f, 0.0f), normal));
+	}
+
+	std::vector<VertexPositionNormalTangentUVPacked> packed(vertices.size());
+	VertexCompression::Encode(vertices.data(), vertices.size(), PositionDequantization(), packed.data());
+
+	float maxNormalError = 0.0f;
+	float maxTangentError = 0.0f;
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const XMSHORTN4& nt = packed[i].normalTangent;
+		const XMFLOAT3 normal = Shader::OctahedralDecode(SnormToFloat(nt.x), SnormToFloat(nt.y));
+		const XMFLOAT3 tangent = Shader::OctahedralDecode(SnormToFloat(nt.z), SnormToFloat(nt.w));
+
+		maxNormalError = std::max(maxNormalError, AngleBetween(normal, vertices[i].normal));
+		maxTangentError = std::max(maxTangentError, AngleBetween(tangent, vertices[i].tangent));
+	}
+	CHECK(maxNormalError < MaxOctahedralAngleError);
+	CHECK(maxTangentError < MaxOctahedralAngleError);
+}
+
+SCALD_TEST(OctahedralEncodeDecodeIsConsistent)
+{
+	// Unquantized the mapping is exact, seams included, and the encoded point stays inside of [-1, 1]^2.
+	for (const XMFLOAT3& direction : MakeDirections(5000u))
+	{
+		const XMVECTOR encoded = VertexCompression::OctahedralEncode(XMLoadFloat3(&direction));
+		const float ex = XMVectorGetX(encoded);
+		const float ey = XMVectorGetY(encoded);
+		CHECK(std::fabs(ex) <= 1.0f && std::fabs(ey) <= 1.0f);
+
+		XMFLOAT3 decoded;
+		XMStoreFloat3(&decoded, VertexCompression::OctahedralDecode(encoded));
+		CHECK(AngleBetween(decoded, direction) < 1e-5f);
+
+		// CPU and shader decode agree
+		const XMFLOAT3 shaderDecoded = Shader::OctahedralDecode(ex, ey);
+		CHECK_NEAR(decoded.x, shaderDecoded.x, 1e-6f);
+		CHECK_NEAR(decoded.y, shaderDecoded.y, 1e-6f);
+		CHECK_NEAR(decoded.z, shaderDecoded.z, 1e-6f);
+	}
+}
+
+SCALD_TEST(PositionQuantizationWithinHalfStep)
+{
+	const BoundingBox bounds(XMFLOAT3(3.0f, -20.0f, 0.5f), XMFLOAT3(10.0f, 0.25f, 100.0f));
+	const PositionDequantization dequantization = PositionDequantization::FromBounds(bounds);
+
+	std::vector<VertexPositionNormalTangentUV> vertices;
+	// Corners and center first, they must come back exactly.
+	for (float s : { -1.0f, 0.0f, 1.0f })
+	{
+		vertices.push_back(MakeVertex(XMFLOAT3(3.0f + s * 10.0f, -20.0f + s * 0.25f, 0.5f + s * 100.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)));
+	}
+	Rng rng = { 7u };
+	for (UINT i = 0; i < 10000u; ++i)
+	{
+		vertices.push_back(MakeVertex(XMFLOAT3(rng.Next(-7.0f, 13.0f), rng.Next(-20.25f, -19.75f), rng.Next(-99.5f, 100.5f)), XMFLOAT3(0.0f, 1.0f, 0.0f)));
+	}
+
+	std::vector<VertexPositionNormalTangentUVPacked> packed(vertices.size());
+	VertexCompression::Encode(vertices.data(), vertices.size(), dequantization, packed.data());
+
+	// Half a step of 16 bits over the extent, plus float rounding of the positions themselves.
+	const XMFLOAT3 maxError(
+		0.5f * 20.0f / 65535.0f + 1e-5f,
+		0.5f * 0.5f / 65535.0f + 1e-5f,
+		0.5f * 200.0f / 65535.0f + 1e-4f);
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const XMUSHORTN4& posQ = packed[i].position;
+		const XMFLOAT3 position = Shader::DequantizePosition(XMFLOAT3(UnormToFloat(posQ.x), UnormToFloat(posQ.y), UnormToFloat(posQ.z)), dequantization);
+		const XMFLOAT3& expected = vertices[i].position;
+
+		const bool bIsExact = i < 3u && i != 1u;
+		CHECK_NEAR(position.x, expected.x, bIsExact ? 1e-5f : maxError.x);
+		CHECK_NEAR(position.y, expected.y, bIsExact ? 1e-5f : maxError.y);
+		CHECK_NEAR(position.z, expected.z, bIsExact ? 1e-4f : maxError.z);
+	}
+}
+
+SCALD_TEST(FlatDimensionQuantizesToZero)
+{
+	// A grid: no height, the y extent is 0.
+	const BoundingBox bounds(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(5.0f, 0.0f, 5.0f));
+	const PositionDequantization dequantization = PositionDequantization::FromBounds(bounds);
+
+	const VertexPositionNormalTangentUV vertex = MakeVertex(XMFLOAT3(1.0f, 2.0f, -3.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	VertexPositionNormalTangentUVPacked packed;
+	VertexCompression::Encode(&vertex, 1u, dequantization, &packed);
+
+	CHECK_EQ(packed.position.y, 0u);
+	const XMFLOAT3 position = Shader::DequantizePosition(
+		XMFLOAT3(UnormToFloat(packed.position.x), UnormToFloat(packed.position.y), UnormToFloat(packed.position.z)), dequantization);
+	CHECK_NEAR(position.y, 2.0f, 0.0f);
+	CHECK_NEAR(position.x, 1.0f, 5e-5f);
+	CHECK_NEAR(position.z, -3.0f, 5e-5f);
+}
+
+SCALD_TEST(BitangentSignAndTexCoordsRoundTrip)
+{
+	const float texCoords[] = { 0.0f, 1.0f, 0.5f, 0.333f, 4.0f, -2.5f };
+	std::vector<VertexPositionNormalTangentUV> vertices;
+	for (size_t i = 0; i + 1u < std::size(texCoords); ++i)
+	{
+		VertexPositionNormalTangentUV vertex = MakeVertex(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f));
+		vertex.texCoord = XMFLOAT2(texCoords[i], texCoords[i + 1u]);
+		vertices.push_back(vertex);
+	}
+
+	for (float sign : { -1.0f, 1.0f })
+	{
+		std::vector<VertexPositionNormalTangentUVPacked> packed(vertices.size());
+		VertexCompression::Encode(vertices.data(), vertices.size(), PositionDequantization(), packed.data(), sign);
+
+		std::vector<VertexPositionNormalTangentUV> decoded(vertices.size());
+		std::vector<float> signs(vertices.size());
+		VertexCompression::Decode(packed.data(), packed.size(), PositionDequantization(), decoded.data(), signs.data());
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			CHECK_EQ(Shader::BitangentSign(UnormToFloat(packed[i].position.w)), sign);
+			CHECK_EQ(signs[i], sign);
+
+			// Halfs have 11 significant bits
+			const XMFLOAT2& uv = vertices[i].texCoord;
+			CHECK_NEAR(decoded[i].texCoord.x, uv.x, std::fabs(uv.x) / 2048.0f);
+			CHECK_NEAR(decoded[i].texCoord.y, uv.y, std::fabs(uv.y) / 2048.0f);
+		}
+	}
+}
+
+SCALD_TEST(CpuDecodeMatchesShader)
+{
+	const BoundingBox bounds(XMFLOAT3(0.0f, 1.0f, 2.0f), XMFLOAT3(4.0f, 5.0f, 6.0f));
+	const PositionDequantization dequantization = PositionDequantization::FromBounds(bounds);
+
+	const std::vector<XMFLOAT3> normals = MakeDirections(2000u);
+	std::vector<VertexPositionNormalTangentUV> vertices;
+	Rng rng = { 99u };
+	for (const XMFLOAT3& normal : normals)
+	{
+		vertices.push_back(MakeVertex(XMFLOAT3(rng.Next(-4.0f, 4.0f), rng.Next(-4.0f, 6.0f), rng.Next(-4.0f, 8.0f)), normal));
+	}
+
+	std::vector<VertexPositionNormalTangentUVPacked> packed(vertices.size());
+	VertexCompression::Encode(vertices.data(), vertices.size(), dequantization, packed.data());
+	std::vector<VertexPositionNormalTangentUV> decoded(vertices.size());
+	VertexCompression::Decode(packed.data(), packed.size(), dequantization, decoded.data());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const XMUSHORTN4& posQ = packed[i].position;
+		const XMFLOAT3 position = Shader::DequantizePosition(XMFLOAT3(UnormToFloat(posQ.x), UnormToFloat(posQ.y), UnormToFloat(posQ.z)), dequantization);
+		const XMFLOAT3 normal = Shader::OctahedralDecode(SnormToFloat(packed[i].normalTangent.x), SnormToFloat(packed[i].normalTangent.y));
+
+		CHECK_NEAR(decoded[i].position.x, position.x, 1e-5f);
+		CHECK_NEAR(decoded[i].position.y, position.y, 1e-5f);
+		CHECK_NEAR(decoded[i].position.z, position.z, 1e-5f);
+		CHECK_NEAR(decoded[i].normal.x, normal.x, 1e-6f);
+		CHECK_NEAR(decoded[i].normal.y, normal.y, 1e-6f);
+		CHECK_NEAR(decoded[i].normal.z, normal.z, 1e-6f);
+	}
+}